@@ -0,0 +1,76 @@
+#version 410 core
+
+in vec3 fWorldPos;
+in vec3 fNormal;
+
+// the same map variants as the forward programs (see ShaderVariants.hpp)
+#include "maps.glsl"
+
+// G-buffer layout, see Deferred.hpp
+layout (location = 0) out vec4 gAlbedo;
+layout (location = 1) out vec4 gSurface;
+layout (location = 2) out vec4 gAmbient;
+layout (location = 3) out vec2 gNormal;
+
+// members of both shading models, SetupMaterial() fills the ones of its type
+struct MaterialProperties
+{
+    // Blinn-Phong
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float shininess;
+
+    // PBR
+    vec3 albedo;
+    float metallic;
+    float roughness;
+    float ao;
+};
+
+uniform MaterialProperties uMaterial;
+uniform int uShadingModel;          // 0: Blinn-Phong, 1: PBR, kept in the alpha of gAmbient
+
+// octahedral mapping of a unit vector to [0, 1]^2
+vec2 encodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.xy;
+
+    if (n.z < 0.0)
+        e = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+
+    return 0.5 * e + 0.5;
+}
+
+void main()
+{
+    vec3 N = normalize(fNormal);
+
+    // scales the albedo (PBR) or the ambient and diffuse colors (Blinn-Phong), as in forward
+    vec3 baseColor = vec3(1.0);
+
+#ifdef HZGL_HAS_BASE_COLOR_MAP
+    baseColor = texture(uBaseColorMap, fTexCoord).rgb;
+#endif
+
+#ifdef HZGL_HAS_NORMAL_MAP
+    N = perturbNormal(N, fWorldPos, fTexCoord);
+#endif
+
+    gNormal = encodeNormal(N);
+
+    if (uShadingModel == 1) {
+        // the maps are stored as sRGB
+        vec3 albedo = uMaterial.albedo * pow(baseColor, vec3(2.2));
+
+        gAlbedo = vec4(albedo, uMaterial.ao);
+        gSurface = vec4(uMaterial.metallic, uMaterial.roughness, 0.0, 0.0);
+        gAmbient = vec4(0.0, 0.0, 0.0, 1.0);
+    }
+    else {
+        gAlbedo = vec4(uMaterial.diffuse * baseColor, uMaterial.shininess / 256.0);
+        gSurface = vec4(uMaterial.specular, 0.0);
+        gAmbient = vec4(uMaterial.ambient * baseColor, 0.0);
+    }
+}
@@ -0,0 +1,137 @@
+#version 410 core
+
+out vec4 FragColor;
+
+#include "lights.glsl"
+
+// material parameters
+struct MaterialProperties {
+    vec3 albedo;
+    float metallic;
+    float roughness;
+    float ao;
+};
+
+uniform vec3 uEyePosition;
+// G-buffer written by deferred_gbuffer.frag (layout in Deferred.hpp)
+uniform sampler2D uGBuffer0;
+uniform sampler2D uGBuffer1;
+uniform sampler2D uGBuffer2;
+uniform sampler2D uGBufferNormal;
+uniform sampler2D uGBufferDepth;
+uniform mat4 uInverseViewProjection;
+
+#include "pbr.glsl"
+
+#ifdef HZGL_HAS_IBL
+#include "ibl.glsl"
+#endif
+
+vec3 decodeNormal(vec2 e)
+{
+    e = 2.0 * e - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+
+    return normalize(n);
+}
+
+#include "shadows.glsl"
+
+vec3 shade(LightProperties light, MaterialProperties material, vec3 P, vec3 N, vec3 V, vec3 F0)
+{
+    vec3 L;
+    float attenuation = attenuate(light, P, L);
+
+    vec3 H = normalize(L + V);
+    vec3 radiance = light.color * attenuation * shadowFactor(light, P, N);
+
+    // Cook-Torrance BRDF
+    float NDF = D_GGX(N, H, material.roughness);   
+    float G   = G_Smith(N, V, L, material.roughness);      
+    vec3  F   = F_Schlick(clamp(dot(H, V), 0.0, 1.0), F0);
+       
+    vec3  numerator   = NDF * G * F; 
+    float denominator = 4 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001; // + 0.0001 to prevent divide by zero
+    vec3  specular    = numerator / denominator;
+    
+    // Energy conservation: kS + KD == 1.0
+    vec3 kS = F;
+    vec3 kD = vec3(1.0) - kS;
+
+    // No diffuse light if completely metallic
+    kD *= 1.0 - material.metallic;	  
+
+    // scale light by NdotL
+    float NdotL = max(dot(N, L), 0.0);        
+
+    // outgoing radiance
+    return 10 * (kD * material.albedo / PI + specular) * radiance * NdotL;
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy - uClusterViewport.xy);
+    float depth = texelFetch(uGBufferDepth, texel, 0).r;
+
+    // nothing was drawn here, the clear color shows through
+    if (depth == 1.0)
+        discard;
+
+    // shaded by the pass of the other model
+    vec4 g2 = texelFetch(uGBuffer2, texel, 0);
+    if (g2.a < 0.5)
+        discard;
+
+    vec4 g0 = texelFetch(uGBuffer0, texel, 0);
+    vec4 g1 = texelFetch(uGBuffer1, texel, 0);
+
+    MaterialProperties material;
+    material.albedo = g0.rgb;
+    material.ao = g0.a;
+    material.metallic = g1.r;
+    material.roughness = g1.g;
+
+    // world position from the depth of the pixel
+    vec2 uv = (gl_FragCoord.xy - uClusterViewport.xy) / uClusterViewport.zw;
+    vec4 world = uInverseViewProjection * vec4(2.0 * vec3(uv, depth) - 1.0, 1.0);
+    vec3 P = world.xyz / world.w;
+
+    vec3 N = decodeNormal(texelFetch(uGBufferNormal, texel, 0).xy);
+    vec3 V = normalize(uEyePosition - P);
+
+    // F0 = reflectance at normal incidence
+    //    - dia-electric: 0.04
+    //    - metal: the albedo color     
+    vec3 F0 = vec3(0.04); 
+    F0 = mix(F0, material.albedo, material.metallic);
+
+    // calculate per-light radiance
+    vec3 Lo = vec3(0.0);
+    for (int i = 0; i < uNumGlobalLights; i++)
+        Lo += shade(fetchLight(i), material, P, N, V, F0);
+
+    // only the local lights that reach this cluster
+    uvec2 list = clusterLights(depth);
+    for (uint k = 0u; k < list.y; k++)
+        Lo += shade(fetchLight(int(texelFetch(uLightIndices, int(list.x + k)).x)), material, P, N, V, F0);
+    
+    // Ambient light to prevent the scene from getting too dark, or the environment
+#ifdef HZGL_HAS_IBL
+    vec3 ambient = ambientIBL(N, V, F0, material.albedo, material.metallic, material.roughness) * material.ao;
+#else
+    vec3 ambient = vec3(0.03) * material.albedo * material.ao;
+#endif
+
+    vec3 color = ambient + Lo;
+
+    // HDR tonemapping
+    color = color / (color + vec3(1.0));
+    // Gamma correction
+    color = pow(color, vec3(1.0/2.2)); 
+
+    FragColor = vec4(color, 1.0);
+    gl_FragDepth = depth;
+}
@@ -0,0 +1,104 @@
+#version 410 core
+
+out vec4 FragColor;
+
+#include "lights.glsl"
+
+struct MaterialProperties
+{
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float shininess;
+};
+
+uniform vec3 uEyePosition;
+// G-buffer written by deferred_gbuffer.frag (layout in Deferred.hpp)
+uniform sampler2D uGBuffer0;
+uniform sampler2D uGBuffer1;
+uniform sampler2D uGBuffer2;
+uniform sampler2D uGBufferNormal;
+uniform sampler2D uGBufferDepth;
+uniform mat4 uInverseViewProjection;
+
+vec3 decodeNormal(vec2 e)
+{
+    e = 2.0 * e - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+
+    return normalize(n);
+}
+
+#include "shadows.glsl"
+
+vec3 shade(LightProperties light, MaterialProperties material, vec3 P, vec3 N, vec3 V)
+{
+    vec3 L;
+    float attenuation = attenuate(light, P, L);
+
+    vec3 H = normalize(L + V);
+    float diff = max(0.0, dot(N, L));
+    float spec = max(0.0, dot(N, H));
+
+    if (diff == 0.0)
+        spec = 0.0;
+    else
+        spec = pow(spec, material.shininess);
+
+    // Accumulate all the lights' effects
+    // shadows leave the ambient term alone
+    float visibility = attenuation * shadowFactor(light, P, N);
+
+    vec3 RGB = light.ambient * material.ambient * attenuation;
+    RGB += light.color * material.diffuse  * diff * visibility;
+    RGB += light.color * material.specular * spec * visibility;
+
+    return RGB;
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy - uClusterViewport.xy);
+    float depth = texelFetch(uGBufferDepth, texel, 0).r;
+
+    // nothing was drawn here, the clear color shows through
+    if (depth == 1.0)
+        discard;
+
+    // shaded by the pass of the other model
+    vec4 g2 = texelFetch(uGBuffer2, texel, 0);
+    if (g2.a > 0.5)
+        discard;
+
+    vec4 g0 = texelFetch(uGBuffer0, texel, 0);
+
+    MaterialProperties material;
+    material.diffuse = g0.rgb;
+    material.shininess = g0.a * 256.0;
+    material.specular = texelFetch(uGBuffer1, texel, 0).rgb;
+    material.ambient = g2.rgb;
+
+    // world position from the depth of the pixel
+    vec2 uv = (gl_FragCoord.xy - uClusterViewport.xy) / uClusterViewport.zw;
+    vec4 world = uInverseViewProjection * vec4(2.0 * vec3(uv, depth) - 1.0, 1.0);
+    vec3 P = world.xyz / world.w;
+
+    vec3 RGB = vec3(0.0);
+
+    vec3 N = decodeNormal(texelFetch(uGBufferNormal, texel, 0).xy);
+    vec3 V = normalize(uEyePosition - P);
+
+    for (int i = 0; i < uNumGlobalLights; i++)
+        RGB += shade(fetchLight(i), material, P, N, V);
+
+    // only the local lights that reach this cluster
+    uvec2 list = clusterLights(depth);
+    for (uint k = 0u; k < list.y; k++)
+        RGB += shade(fetchLight(int(texelFetch(uLightIndices, int(list.x + k)).x)), material, P, N, V);
+
+    FragColor = vec4(min(RGB, vec3(1.0)), 1.0);
+    gl_FragDepth = depth;
+}
@@ -0,0 +1,16 @@
+#version 410 core
+
+layout (location = 0) in vec3 vPosition;
+
+uniform mat4 Model;
+uniform mat4 View;
+uniform mat4 Projection;
+
+// the shading programs compute gl_Position the same way and declare it invariant too, so their
+// depth matches the pre-pass exactly
+invariant gl_Position;
+
+void main()
+{
+    gl_Position = Projection * View * Model * vec4(vPosition, 1.0);
+}
@@ -0,0 +1,8 @@
+#version 410 core
+
+// one triangle covering the viewport, drawn with glDrawArrays(GL_TRIANGLES, 0, 3) and no buffers
+void main()
+{
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(2.0 * position - 1.0, 0.0, 1.0);
+}
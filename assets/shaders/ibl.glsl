@@ -0,0 +1,44 @@
+// image-based lighting (see Environment.hpp): irradiance / pi as SH9, the environment
+// prefiltered with one roughness per mip level, and the split-sum BRDF LUT; pulled in with
+// #include "ibl.glsl" after pbr.glsl, under #ifdef HZGL_HAS_IBL
+uniform float uIBLIntensity;
+uniform float uIBLMaxLod;
+uniform vec3 uIBLSH[9];
+uniform sampler2D uIBLPrefiltered;
+uniform sampler2D uIBLBrdfLut;
+
+vec3 irradianceSH(vec3 n)
+{
+    return uIBLSH[0] * 0.282095
+         + uIBLSH[1] * (0.488603 * n.y) + uIBLSH[2] * (0.488603 * n.z) + uIBLSH[3] * (0.488603 * n.x)
+         + uIBLSH[4] * (1.092548 * n.x * n.y) + uIBLSH[5] * (1.092548 * n.y * n.z)
+         + uIBLSH[6] * (0.315392 * (3.0 * n.z * n.z - 1.0))
+         + uIBLSH[7] * (1.092548 * n.x * n.z) + uIBLSH[8] * (0.546274 * (n.x * n.x - n.y * n.y));
+}
+
+// longitude along u, the top row (u, 0) looks straight up
+vec2 equirect(vec3 d)
+{
+    return vec2(atan(d.x, -d.z) / (2.0 * PI) + 0.5, acos(clamp(d.y, -1.0, 1.0)) / PI);
+}
+
+vec3 F_SchlickRoughness(float cosTheta, vec3 F0, float roughness)
+{
+    return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+}
+
+// light from the environment, diffuse from the SH and specular from the split sum
+vec3 ambientIBL(vec3 N, vec3 V, vec3 F0, vec3 albedo, float metallic, float roughness)
+{
+    float NdotV = max(dot(N, V), 0.0);
+    vec3 F = F_SchlickRoughness(NdotV, F0, roughness);
+    vec3 kD = (1.0 - F) * (1.0 - metallic);
+
+    vec3 diffuse = max(irradianceSH(N), vec3(0.0)) * albedo;
+
+    vec3 R = reflect(-V, N);
+    vec3 prefiltered = textureLod(uIBLPrefiltered, equirect(R), roughness * uIBLMaxLod).rgb;
+    vec2 brdf = texture(uIBLBrdfLut, vec2(NdotV, roughness)).rg;
+
+    return uIBLIntensity * (kD * diffuse + prefiltered * (F * brdf.x + brdf.y));
+}
@@ -0,0 +1,113 @@
+// clustered light lookup shared by the lit fragment shaders, pulled in with #include "lights.glsl"
+// (see ReadShaderSource); shadows.glsl takes LightProperties from here, so it comes after
+
+struct LightProperties
+{
+    int isLocal;
+    int isSpot;
+
+    // position/direction
+    vec3 position;
+
+    // colors/intensities
+    vec3 color;
+    vec3 ambient;
+
+    // for spot light
+    vec3 coneDirection;
+    float spotExponent;
+    float spotCosCutoff;
+
+    // for local lights
+    float constantAttenuation;
+    float linearAttenuation;
+    float quadraticAttenuation;
+    float range;
+
+    // shadow views in uShadowViews, none when shadowCount is 0
+    int shadowFirst;
+    int shadowCount;
+};
+
+// clustered lights (see LightClusters.hpp): 6 texels per light, global lights first, then an
+// (offset, count) pair per cluster into the list of light indices
+uniform samplerBuffer uLightData;
+uniform usamplerBuffer uClusterGrid;
+uniform usamplerBuffer uLightIndices;
+uniform int uNumGlobalLights;
+uniform ivec3 uClusterDims;
+uniform vec4 uClusterViewport;      // x, y, width, height
+uniform vec4 uClusterDepth;         // near, far, slice scale, slice bias
+
+LightProperties fetchLight(int index)
+{
+    vec4 t0 = texelFetch(uLightData, 6 * index + 0);
+    vec4 t1 = texelFetch(uLightData, 6 * index + 1);
+    vec4 t2 = texelFetch(uLightData, 6 * index + 2);
+    vec4 t3 = texelFetch(uLightData, 6 * index + 3);
+    vec4 t4 = texelFetch(uLightData, 6 * index + 4);
+    vec4 t5 = texelFetch(uLightData, 6 * index + 5);
+
+    LightProperties light;
+    light.position = t0.xyz;
+    light.isLocal = int(t0.w);
+    light.color = t1.rgb;
+    light.isSpot = int(t1.w);
+    light.ambient = t2.rgb;
+    light.spotExponent = t2.w;
+    light.coneDirection = t3.xyz;
+    light.spotCosCutoff = t3.w;
+    light.constantAttenuation = t4.x;
+    light.linearAttenuation = t4.y;
+    light.quadraticAttenuation = t4.z;
+    light.range = t4.w;
+    light.shadowFirst = int(t5.x);
+    light.shadowCount = int(t5.y);
+
+    return light;
+}
+
+// offset and count of the light list of the cluster this pixel falls into, at window depth
+// (gl_FragCoord.z in a forward pass, the G-buffer depth in a deferred one)
+uvec2 clusterLights(float depth)
+{
+    vec2 tile = (gl_FragCoord.xy - uClusterViewport.xy) / uClusterViewport.zw * vec2(uClusterDims.xy);
+
+    float zNear = uClusterDepth.x;
+    float zFar = uClusterDepth.y;
+    float dist = zNear * zFar / (zFar - depth * (zFar - zNear));
+    int slice = int(floor(log(dist) * uClusterDepth.z + uClusterDepth.w));
+
+    ivec3 cluster = clamp(ivec3(ivec2(tile), slice), ivec3(0), uClusterDims - 1);
+    return texelFetch(uClusterGrid, cluster.x + uClusterDims.x * (cluster.y + uClusterDims.y * cluster.z)).xy;
+}
+
+// direction to the light and its attenuation at P
+float attenuate(LightProperties light, vec3 P, out vec3 L)
+{
+    float attenuation = 1.0;
+    L = normalize(-light.position);
+
+    if (light.isLocal == 1) {
+        L = normalize(light.position - P);
+
+        float dist = length(light.position - P);
+        attenuation = 1.0 / ( light.constantAttenuation 
+                            + light.linearAttenuation * dist 
+                            + light.quadraticAttenuation * dist * dist);
+
+        // fade out over the last tenth of the range, so cluster borders leave no seams
+        if (light.range > 0.0)
+            attenuation *= clamp(10.0 * (1.0 - dist / light.range), 0.0, 1.0);
+        
+        if (light.isSpot == 1) {
+            float spotCos = dot(L, -light.coneDirection);
+            if (spotCos < light.spotCosCutoff)
+                attenuation = 0.0;
+            else
+                attenuation *= pow(spotCos, light.spotExponent);
+        }
+    }
+
+    return attenuation;
+}
@@ -0,0 +1,47 @@
+// material maps shared by the lit fragment shaders, pulled in with #include "maps.glsl" (see
+// ReadShaderSource); the feature defines (see ShaderVariants.hpp) pick what is declared
+
+#ifdef HZGL_HAS_TEXCOORDS
+in vec2 fTexCoord;
+#endif
+
+#ifdef HZGL_HAS_BASE_COLOR_MAP
+uniform sampler2D uBaseColorMap;
+#endif
+
+#ifdef HZGL_HAS_NORMAL_MAP
+uniform sampler2D uNormalMap;
+
+#ifdef HZGL_HAS_TANGENTS
+in vec4 fTangent;
+
+// tangent frame of the mesh (MikkTSpace): the bitangent is rebuilt per fragment
+vec3 perturbNormal(vec3 N, vec3 P, vec2 uv)
+{
+    vec3 T = normalize(fTangent.xyz - dot(fTangent.xyz, N) * N);
+    vec3 B = fTangent.w * cross(N, T);
+    vec3 n = texture(uNormalMap, uv).xyz * 2.0 - 1.0;
+
+    return normalize(mat3(T, B, N) * n);
+}
+#else
+// tangent frame from screen-space derivatives, for meshes without tangents
+vec3 perturbNormal(vec3 N, vec3 P, vec2 uv)
+{
+    vec3 dp1 = dFdx(P);
+    vec3 dp2 = dFdy(P);
+    vec2 duv1 = dFdx(uv);
+    vec2 duv2 = dFdy(uv);
+
+    vec3 dp2perp = cross(dp2, N);
+    vec3 dp1perp = cross(N, dp1);
+    vec3 T = dp2perp * duv1.x + dp1perp * duv2.x;
+    vec3 B = dp2perp * duv1.y + dp1perp * duv2.y;
+
+    float invmax = inversesqrt(max(max(dot(T, T), dot(B, B)), 1e-20));
+    vec3 n = texture(uNormalMap, uv).xyz * 2.0 - 1.0;
+
+    return normalize(mat3(T * invmax, B * invmax, N) * n);
+}
+#endif
+#endif
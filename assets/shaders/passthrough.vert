@@ -1,9 +1,14 @@
 #version 410 core
 
 layout(location = 0) in vec3 vPosition;
-layout(location = 1) in vec3 vNormal;
 layout(location = 2) in vec2 vTexCoord;
 
+#ifdef HZGL_HAS_TANGENTS
+layout(location = 3) in vec4 vQTangent;    // the normal is the third column of its rotation
+#else
+layout(location = 1) in vec3 vNormal;
+#endif
+
 out vec3 fNormal;
 out vec2 fTexCoord;
 out vec3 fWorldPos;
@@ -13,10 +18,21 @@ uniform mat4 View;
 uniform mat4 Projection;
 uniform mat4 Normal;
 
+// matches depth_only.vert for the depth pre-pass
+invariant gl_Position;
+
 void main()
 {
     gl_Position = Projection * View * Model * vec4(vPosition, 1.0);
     fWorldPos = vec3(Model * vec4(vPosition, 1.0));
-    fNormal = mat3(Normal) * vNormal;
+
+#ifdef HZGL_HAS_TANGENTS
+    vec4 q = normalize(vQTangent);
+    vec3 N = vec3(2.0 * (q.x * q.z + q.w * q.y), 2.0 * (q.y * q.z - q.w * q.x), 1.0 - 2.0 * (q.x * q.x + q.y * q.y));
+#else
+    vec3 N = vNormal;
+#endif
+
+    fNormal = mat3(Normal) * N;
     fTexCoord = vTexCoord;
 }
\ No newline at end of file
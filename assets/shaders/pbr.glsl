@@ -0,0 +1,46 @@
+// Cook-Torrance terms shared by the PBR fragment shaders, pulled in with #include "pbr.glsl"
+
+const float PI = 3.14159265359;
+const float EPSILON = 0.000001;
+
+// Specular D: GGX/Trowbridge-Reitz
+float D_GGX(vec3 N, vec3 H, float roughness)
+{
+    float a = roughness * roughness;
+    float NdotH = max(dot(N, H), 0.0);
+
+    float nume = a * a;
+    float denom = (NdotH * NdotH * (a * a - 1.0) + 1.0);
+    denom = PI * denom * denom;
+
+    // prevent division by zero
+    return nume / max(denom, EPSILON);
+}
+
+// Specular G: Schlick
+float G_Schlick(vec3 N, vec3 V, float roughness)
+{
+    float r = (roughness + 1.0);
+    float k = (r*r) / 8.0;
+    float NdotV = max(dot(N, V), 0.0);
+
+    float nom = NdotV;
+    float denom = NdotV * (1.0 - k) + k;
+
+    return nom / denom;
+}
+
+// Specular G: Smith
+float G_Smith(vec3 N, vec3 V, vec3 L, float roughness)
+{
+    float ggx2 = G_Schlick(N, V, roughness);
+    float ggx1 = G_Schlick(N, V, roughness);
+
+    return ggx1 * ggx2;
+}
+
+// Specular F: Schlick
+vec3 F_Schlick(float cosTheta, vec3 F0)
+{
+    return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+}
@@ -3,31 +3,12 @@
 in vec3 fWorldPos;
 in vec3 fNormal;
 
+// feature defines (see ShaderVariants.hpp) are put right after the #version line
+#include "maps.glsl"
+
 out vec4 FragColor;
 
-struct LightProperties
-{
-    int isEnabled;
-    int isLocal;
-    int isSpot;
-
-    // position/direction
-    vec3 position;
-
-    // colors/intensities
-    vec3 color;
-    vec3 ambient;
-
-    // for spot light
-    vec3 coneDirection;
-    float spotExponent;
-    float spotCosCutoff;
-
-    // for local lights
-    float constantAttenuation;
-    float linearAttenuation;
-    float quadraticAttenuation;
-};
+#include "lights.glsl"
 
 // material parameters
 struct MaterialProperties {
@@ -37,54 +18,56 @@ struct MaterialProperties {
     float ao;
 };
 
-const int MAX_LIGHTS = 10;
 uniform vec3 uEyePosition;
 uniform MaterialProperties uMaterial;
-uniform LightProperties uLight[MAX_LIGHTS];
-
-const float PI = 3.14159265359;
-const float EPSILON = 0.000001;
 
-// Specular D: GGX/Trowbridge-Reitz
-float D_GGX(vec3 N, vec3 H, float roughness)
-{
-    float a = roughness * roughness;
-    float NdotH = max(dot(N, H), 0.0);
+// of the material, scaled by uBaseColorMap if there is one
+vec3 albedo;
 
-    float nume = a * a;
-    float denom = (NdotH * NdotH * (a * a - 1.0) + 1.0);
-    denom = PI * denom * denom;
+#include "pbr.glsl"
 
-    // prevent division by zero
-    return nume / max(denom, EPSILON);
-}
+#ifdef HZGL_HAS_IBL
+#include "ibl.glsl"
+#endif
 
-// Specular G: Schlick
-float G_Schlick(vec3 N, vec3 V, float roughness)
+#ifdef HZGL_HAS_SHADOWS
+#include "shadows.glsl"
+#else
+float shadowFactor(LightProperties light, vec3 P, vec3 N)
 {
-    float r = (roughness + 1.0);
-    float k = (r*r) / 8.0;
-    float NdotV = max(dot(N, V), 0.0);
-
-    float nom = NdotV;
-    float denom = NdotV * (1.0 - k) + k;
-
-    return nom / denom;
+    return 1.0;
 }
+#endif
 
-// Specular G: Smith
-float G_Smith(vec3 N, vec3 V, vec3 L, float roughness)
+vec3 shade(LightProperties light, vec3 N, vec3 V, vec3 F0)
 {
-    float ggx2 = G_Schlick(N, V, roughness);
-    float ggx1 = G_Schlick(N, V, roughness);
+    vec3 L;
+    float attenuation = attenuate(light, fWorldPos, L);
+
+    vec3 H = normalize(L + V);
+    vec3 radiance = light.color * attenuation * shadowFactor(light, fWorldPos, N);
+
+    // Cook-Torrance BRDF
+    float NDF = D_GGX(N, H, uMaterial.roughness);   
+    float G   = G_Smith(N, V, L, uMaterial.roughness);      
+    vec3  F   = F_Schlick(clamp(dot(H, V), 0.0, 1.0), F0);
+       
+    vec3  numerator   = NDF * G * F; 
+    float denominator = 4 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001; // + 0.0001 to prevent divide by zero
+    vec3  specular    = numerator / denominator;
+    
+    // Energy conservation: kS + KD == 1.0
+    vec3 kS = F;
+    vec3 kD = vec3(1.0) - kS;
 
-    return ggx1 * ggx2;
-}
+    // No diffuse light if completely metallic
+    kD *= 1.0 - uMaterial.metallic;	  
 
-// Specular F: Schlick
-vec3 F_Schlick(float cosTheta, vec3 F0)
-{
-    return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+    // scale light by NdotL
+    float NdotL = max(dot(N, L), 0.0);        
+
+    // outgoing radiance
+    return 10 * (kD * albedo / PI + specular) * radiance * NdotL;
 }
 
 void main()
@@ -92,67 +75,39 @@ void main()
     vec3 N = normalize(fNormal);
     vec3 V = normalize(uEyePosition - fWorldPos);
 
+    albedo = uMaterial.albedo;
+
+#ifdef HZGL_HAS_BASE_COLOR_MAP
+    // the maps are stored as sRGB
+    albedo *= pow(texture(uBaseColorMap, fTexCoord).rgb, vec3(2.2));
+#endif
+
+#ifdef HZGL_HAS_NORMAL_MAP
+    N = perturbNormal(N, fWorldPos, fTexCoord);
+#endif
+
     // F0 = reflectance at fNormal incidence
     //    - dia-electric: 0.04
     //    - metal: the albedo color     
     vec3 F0 = vec3(0.04); 
-    F0 = mix(F0, uMaterial.albedo, uMaterial.metallic);
+    F0 = mix(F0, albedo, uMaterial.metallic);
 
     // calculate per-light radiance
     vec3 Lo = vec3(0.0);
-    for(int i = 0; i < MAX_LIGHTS; ++i) 
-    {
-        if (uLight[i].isEnabled == 0)
-            continue;
-
-        float attenuation = 1.0;
-        vec3 L = normalize(-uLight[i].position);
-
-        if (uLight[i].isLocal == 1) {
-            L = normalize(uLight[i].position - fWorldPos);
-
-            float dist = length(uLight[i].position - fWorldPos);
-            attenuation = 1.0 / ( uLight[i].constantAttenuation 
-                                + uLight[i].linearAttenuation * dist 
-                                + uLight[i].quadraticAttenuation * dist * dist);
-            
-            if (uLight[i].isSpot == 1) {
-                float spotCos = dot(L, -uLight[i].coneDirection);
-                if (spotCos < uLight[i].spotCosCutoff)
-                    attenuation = 0.0;
-                else
-                    attenuation *= pow(spotCos, uLight[i].spotExponent);
-            }
-        }
-
-        vec3 H = normalize(L + V);
-        vec3 radiance = uLight[i].color * attenuation;
-
-        // Cook-Torrance BRDF
-        float NDF = D_GGX(N, H, uMaterial.roughness);   
-        float G   = G_Smith(N, V, L, uMaterial.roughness);      
-        vec3  F   = F_Schlick(clamp(dot(H, V), 0.0, 1.0), F0);
-           
-        vec3  numerator   = NDF * G * F; 
-        float denominator = 4 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001; // + 0.0001 to prevent divide by zero
-        vec3  specular    = numerator / denominator;
-        
-        // Energy conservation: kS + KD == 1.0
-        vec3 kS = F;
-        vec3 kD = vec3(1.0) - kS;
-
-        // No diffuse light if completely metallic
-        kD *= 1.0 - uMaterial.metallic;	  
-
-        // scale light by NdotL
-        float NdotL = max(dot(N, L), 0.0);        
-
-        // add to outgoing radiance Lo
-        Lo += 10 * (kD * uMaterial.albedo / PI + specular) * radiance * NdotL;
-    }   
+    for (int i = 0; i < uNumGlobalLights; i++)
+        Lo += shade(fetchLight(i), N, V, F0);
+
+    // only the local lights that reach this cluster
+    uvec2 list = clusterLights(gl_FragCoord.z);
+    for (uint k = 0u; k < list.y; k++)
+        Lo += shade(fetchLight(int(texelFetch(uLightIndices, int(list.x + k)).x)), N, V, F0);
     
-    // Ambient light to prevent the scene from getting too dark
-    vec3 ambient = vec3(0.03) * uMaterial.albedo * uMaterial.ao;
+    // Ambient light to prevent the scene from getting too dark, or the environment
+#ifdef HZGL_HAS_IBL
+    vec3 ambient = ambientIBL(N, V, F0, albedo, uMaterial.metallic, uMaterial.roughness) * uMaterial.ao;
+#else
+    vec3 ambient = vec3(0.03) * albedo * uMaterial.ao;
+#endif
 
     vec3 color = ambient + Lo;
 
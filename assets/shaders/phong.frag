@@ -3,31 +3,12 @@
 in vec3 fWorldPos;
 in vec3 fNormal;
 
-out vec4 FragColor;
-
-struct LightProperties
-{
-    int isEnabled;
-    int isLocal;
-    int isSpot;
-
-    // position/direction
-    vec3 position;
-
-    // colors/intensities
-    vec3 color;
-    vec3 ambient;
+// feature defines (see ShaderVariants.hpp) are put right after the #version line
+#include "maps.glsl"
 
-    // for spot light
-    vec3 coneDirection;
-    float spotExponent;
-    float spotCosCutoff;
+out vec4 FragColor;
 
-    // for local lights
-    float constantAttenuation;
-    float linearAttenuation;
-    float quadraticAttenuation;
-};
+#include "lights.glsl"
 
 struct MaterialProperties
 {
@@ -37,10 +18,45 @@ struct MaterialProperties
     float shininess;
 };
 
-const int MAX_LIGHTS = 10;
 uniform vec3 uEyePosition;
 uniform MaterialProperties uMaterial;
-uniform LightProperties uLight[MAX_LIGHTS];
+
+// scales the ambient and diffuse colors of the material, from uBaseColorMap if there is one
+vec3 baseColor = vec3(1.0);
+
+#ifdef HZGL_HAS_SHADOWS
+#include "shadows.glsl"
+#else
+float shadowFactor(LightProperties light, vec3 P, vec3 N)
+{
+    return 1.0;
+}
+#endif
+
+vec3 shade(LightProperties light, vec3 N, vec3 V)
+{
+    vec3 L;
+    float attenuation = attenuate(light, fWorldPos, L);
+
+    vec3 H = normalize(L + V);
+    float diff = max(0.0, dot(N, L));
+    float spec = max(0.0, dot(N, H));
+
+    if (diff == 0.0)
+        spec = 0.0;
+    else
+        spec = pow(spec, uMaterial.shininess);
+
+    // Accumulate all the lights' effects
+    // shadows leave the ambient term alone
+    float visibility = attenuation * shadowFactor(light, fWorldPos, N);
+
+    vec3 RGB = light.ambient * uMaterial.ambient * baseColor * attenuation;
+    RGB += light.color * uMaterial.diffuse * baseColor * diff * visibility;
+    RGB += light.color * uMaterial.specular * spec * visibility;
+
+    return RGB;
+}
 
 void main()
 {
@@ -49,44 +65,21 @@ void main()
     vec3 N = normalize(fNormal);
     vec3 V = normalize(uEyePosition - fWorldPos);
 
-    for (int i = 0; i < MAX_LIGHTS; i++) {
-        if (uLight[i].isEnabled == 0)
-            continue;
-
-        float attenuation = 1.0;
-        vec3 L = normalize(-uLight[i].position);
-
-        if (uLight[i].isLocal == 1) {
-            L = normalize(uLight[i].position - fWorldPos);
-
-            float dist = length(uLight[i].position - fWorldPos);
-            attenuation = 1.0 / ( uLight[i].constantAttenuation 
-                                + uLight[i].linearAttenuation * dist 
-                                + uLight[i].quadraticAttenuation * dist * dist);
-            
-            if (uLight[i].isSpot == 1) {
-                float spotCos = dot(L, -uLight[i].coneDirection);
-                if (spotCos < uLight[i].spotCosCutoff)
-                    attenuation = 0.0;
-                else
-                    attenuation *= pow(spotCos, uLight[i].spotExponent);
-            }
-        }
-
-        vec3 H = normalize(L + V);
-        float diff = max(0.0, dot(N, L));
-        float spec = max(0.0, dot(N, H));
-
-        if (diff == 0.0)
-            spec = 0.0;
-        else
-            spec = pow(spec, uMaterial.shininess);
-
-        // Accumulate all the lights' effects
-        RGB += uLight[i].ambient * uMaterial.ambient * attenuation;
-        RGB += uLight[i].color * uMaterial.diffuse  * diff * attenuation;
-        RGB += uLight[i].color * uMaterial.specular * spec * attenuation;
-    }
+#ifdef HZGL_HAS_BASE_COLOR_MAP
+    baseColor = texture(uBaseColorMap, fTexCoord).rgb;
+#endif
+
+#ifdef HZGL_HAS_NORMAL_MAP
+    N = perturbNormal(N, fWorldPos, fTexCoord);
+#endif
+
+    for (int i = 0; i < uNumGlobalLights; i++)
+        RGB += shade(fetchLight(i), N, V);
+
+    // only the local lights that reach this cluster
+    uvec2 list = clusterLights(gl_FragCoord.z);
+    for (uint k = 0u; k < list.y; k++)
+        RGB += shade(fetchLight(int(texelFetch(uLightIndices, int(list.x + k)).x)), N, V);
 
     FragColor = vec4(min(RGB, vec3(1.0)), 1.0);
 }
\ No newline at end of file
@@ -1,20 +1,49 @@
 #version 410 core
 
 layout (location = 0) in vec3 vPosition;
-layout (location = 1) in vec3 vNormal;
 
 out vec3 fWorldPos;
 out vec3 fNormal;
 
+#ifdef HZGL_HAS_TEXCOORDS
+layout (location = 2) in vec2 vTexCoord;
+out vec2 fTexCoord;
+#endif
+
+#ifdef HZGL_HAS_TANGENTS
+layout (location = 3) in vec4 vQTangent;   // tangent frame as a quaternion, w < 0: mirrored
+out vec4 fTangent;
+#else
+layout (location = 1) in vec3 vNormal;     // meshes with QTangents have no normal stream
+#endif
+
 uniform mat4 Model;
 uniform mat4 View;
 uniform mat4 Projection;
 uniform mat4 Normal;
 
+// matches depth_only.vert for the depth pre-pass
+invariant gl_Position;
+
 void main()
 {
     fWorldPos = vec3(Model * vec4(vPosition, 1.0));
-    fNormal = mat3(Normal) * vNormal;
+
+#ifdef HZGL_HAS_TEXCOORDS
+    fTexCoord = vTexCoord;
+#endif
+
+#ifdef HZGL_HAS_TANGENTS
+    // first and third column of the rotation (see DecodeQTangent)
+    vec4 q = normalize(vQTangent);
+    vec3 T = vec3(1.0 - 2.0 * (q.y * q.y + q.z * q.z), 2.0 * (q.x * q.y + q.w * q.z), 2.0 * (q.x * q.z - q.w * q.y));
+    vec3 N = vec3(2.0 * (q.x * q.z + q.w * q.y), 2.0 * (q.y * q.z - q.w * q.x), 1.0 - 2.0 * (q.x * q.x + q.y * q.y));
+    fTangent = vec4(mat3(Model) * T, (q.w < 0.0) ? -1.0 : 1.0);
+#else
+    vec3 N = vNormal;
+#endif
+
+    fNormal = mat3(Normal) * N;
     
     gl_Position = Projection * View * Model * vec4(vPosition, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,15 @@
+#version 410 core
+
+in vec4 fColor;
+
+out vec4 FragColor;
+
+void main()
+{
+    // round splats
+    vec2 d = 2.0 * gl_PointCoord - 1.0;
+    if (dot(d, d) > 1.0)
+        discard;
+
+    FragColor = vec4(fColor.rgb, 1.0);
+}
@@ -0,0 +1,25 @@
+#version 410 core
+
+layout (location = 0) in vec3 vPosition;
+layout (location = 1) in vec4 vColor;
+
+out vec4 fColor;
+
+uniform mat4 Model;
+uniform mat4 View;
+uniform mat4 Projection;
+
+uniform float uSpacing;             // between the points of the finest level drawn here, world units
+uniform float uPixelsPerUnit;       // a world unit at a distance of 1, in pixels
+uniform float uMaxPointSize;
+
+void main()
+{
+    vec4 viewPos = View * Model * vec4(vPosition, 1.0);
+
+    // the splats of a node cover the gaps between its points
+    gl_PointSize = clamp(uSpacing * uPixelsPerUnit / max(-viewPos.z, 1e-4), 1.0, uMaxPointSize);
+    gl_Position = Projection * viewPos;
+
+    fColor = vColor;
+}
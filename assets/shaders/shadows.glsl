@@ -0,0 +1,78 @@
+// shadow sampling shared by the lit fragment shaders, pulled in with #include "shadows.glsl"
+// (see ReadShaderSource) after lights.glsl, which declares LightProperties
+
+// shadow views (see Shadows.hpp): 6 texels each, the view-projection matrix, the tile in the
+// atlas (x, y, width, height) and the world-space size of a texel at distance 1
+uniform sampler2DShadow uShadowAtlas;
+uniform samplerBuffer uShadowViews;
+
+// atlas coordinates and depth of P in a shadow view, pushed along N by about a texel against acne
+vec3 shadowCoord(int view, vec3 P, vec3 N)
+{
+    mat4 M = mat4(texelFetch(uShadowViews, 6 * view + 0), texelFetch(uShadowViews, 6 * view + 1),
+                  texelFetch(uShadowViews, 6 * view + 2), texelFetch(uShadowViews, 6 * view + 3));
+    float texelSize = texelFetch(uShadowViews, 6 * view + 5).x;
+
+    float w = (M * vec4(P, 1.0)).w;
+    vec4 clip = M * vec4(P + N * (1.5 * texelSize * w), 1.0);
+
+    return 0.5 * clip.xyz / clip.w + 0.5;
+}
+
+// 2x2 comparisons (each filtered by the hardware), kept inside the tile of the view
+float shadowLookup(int view, vec3 coord)
+{
+    if (coord.z >= 1.0)
+        return 1.0;
+
+    vec4 tile = texelFetch(uShadowViews, 6 * view + 4);
+    vec2 texel = 1.0 / vec2(textureSize(uShadowAtlas, 0));
+    vec2 lo = tile.xy + texel;
+    vec2 hi = tile.xy + tile.zw - texel;
+    vec2 uv = tile.xy + clamp(coord.xy, 0.0, 1.0) * tile.zw;
+
+    float lit = 0.0;
+    lit += texture(uShadowAtlas, vec3(clamp(uv + vec2(-0.5, -0.5) * texel, lo, hi), coord.z));
+    lit += texture(uShadowAtlas, vec3(clamp(uv + vec2( 0.5, -0.5) * texel, lo, hi), coord.z));
+    lit += texture(uShadowAtlas, vec3(clamp(uv + vec2(-0.5,  0.5) * texel, lo, hi), coord.z));
+    lit += texture(uShadowAtlas, vec3(clamp(uv + vec2( 0.5,  0.5) * texel, lo, hi), coord.z));
+
+    return 0.25 * lit;
+}
+
+// fraction of the light that reaches P: cascades for directional lights, one of six cube faces
+// for point lights, a single view for spot lights
+float shadowFactor(LightProperties light, vec3 P, vec3 N)
+{
+    if (light.shadowCount == 0)
+        return 1.0;
+
+    if (light.isLocal == 0) {
+        // the first (finest) cascade that contains P
+        for (int k = 0; k < light.shadowCount; k++) {
+            vec3 coord = shadowCoord(light.shadowFirst + k, P, N);
+            if (all(greaterThanEqual(coord.xy, vec2(0.0))) && all(lessThanEqual(coord.xy, vec2(1.0))))
+                return shadowLookup(light.shadowFirst + k, coord);
+        }
+
+        return 1.0;
+    }
+
+    int face = 0;
+
+    if (light.isSpot == 0) {
+        // +X, -X, +Y, -Y, +Z, -Z by the major axis of the direction from the light
+        vec3 d = P - light.position;
+        vec3 a = abs(d);
+
+        if (a.x >= a.y && a.x >= a.z)
+            face = (d.x > 0.0) ? 0 : 1;
+        else if (a.y >= a.z)
+            face = (d.y > 0.0) ? 2 : 3;
+        else
+            face = (d.z > 0.0) ? 4 : 5;
+    }
+
+    int view = light.shadowFirst + face;
+    return shadowLookup(view, shadowCoord(view, P, N));
+}
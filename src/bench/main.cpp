@@ -0,0 +1,1807 @@
+// Microbenchmarks for the mesh import and processing pipeline and the occlusion culler.
+// Every case runs on the CPU only, except PointCloud/frame-*, which draws into an offscreen
+// target of a headless OpenGL context.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <assimp/scene.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+#include <glad/glad.h>
+
+#include "hzgl/Mesh.hpp"
+#include "hzgl/Timer.hpp"
+#include "hzgl/Context.hpp"
+#include "hzgl/Memory.hpp"
+#include "hzgl/Occlusion.hpp"
+#include "hzgl/Scene.hpp"
+#include "hzgl/Texture.hpp"
+#include "hzgl/IBL.hpp"
+#include "hzgl/Tangents.hpp"
+#include "hzgl/Gltf.hpp"
+#include "hzgl/MappedMesh.hpp"
+#include "hzgl/Streaming.hpp"
+#include "hzgl/PointCloud.hpp"
+#include "hzgl/ThreadPool.hpp"
+#include "hzgl/Filesystem.hpp"
+
+typedef struct
+{
+    std::string name;
+    double items = 0.0;      // triangles or pixels processed per iteration
+    double bytes = 0.0;      // input bytes per iteration
+    std::function<void()> run;
+} BenchCase;
+
+// a point octree drawn one frame per iteration, into a framebuffer of its own
+typedef struct
+{
+    hzgl::PointCloud cloud;
+    int width = 1280;
+    int height = 720;
+    int64_t point_budget = 3000000;
+    bool failed = false;
+    GLuint framebuffer = 0;
+    GLuint renderbuffers[2] = {0, 0};     // color, depth
+    int64_t frame = 0;
+} PointFrame;
+
+typedef struct
+{
+    std::string name;
+    int iterations = 0;
+    double min_ms = 0.0;
+    double median_ms = 0.0;
+    double mean_ms = 0.0;
+    double items_per_s = 0.0;
+    double mb_per_s = 0.0;
+    double allocs = 0.0;       // per iteration
+    double alloc_mb = 0.0;     // per iteration
+    double peak_rss_mb = 0.0;
+} BenchResult;
+
+typedef struct
+{
+    std::string output = "";
+    std::string filter = "";
+    std::string assets = "../assets";
+    double min_time = 0.5;     // seconds spent on each case (at least one iteration)
+    int64_t max_triangles = 50000000;   // synthetic meshes above this are skipped
+    int64_t max_points = 10000000;
+} BenchOptions;
+
+// reset the peak resident set size so that every case reports its own peak (Linux only)
+static void resetPeakRSS()
+{
+#if defined(__linux__)
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    if (clearRefs.is_open())
+        clearRefs << "5";
+#endif
+}
+
+static double peakRSSMegabytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+    return 0.0;
+#else
+#if defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, 6, "VmHWM:") == 0)
+            return std::stod(line.substr(6)) / 1024.0;
+    }
+#endif
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+    return usage.ru_maxrss / 1024.0;
+#endif
+#endif
+}
+
+// regular grid with roughly the requested number of triangles
+static void syntheticGrid(int64_t numTriangles, std::vector<float>& positions, std::vector<unsigned>& indices)
+{
+    int n = std::max(1, static_cast<int>(std::sqrt(numTriangles / 2.0)));
+
+    positions.clear();
+    indices.clear();
+    positions.reserve(3 * static_cast<size_t>(n + 1) * (n + 1));
+    indices.reserve(6 * static_cast<size_t>(n) * n);
+
+    for (int y = 0; y <= n; y++)
+    {
+        for (int x = 0; x <= n; x++)
+        {
+            float u = static_cast<float>(x) / n;
+            float v = static_cast<float>(y) / n;
+            positions.push_back(u - 0.5f);
+            positions.push_back(0.05f * std::sin(20.0f * u) * std::cos(20.0f * v));
+            positions.push_back(v - 0.5f);
+        }
+    }
+
+    for (int y = 0; y < n; y++)
+    {
+        for (int x = 0; x < n; x++)
+        {
+            unsigned i0 = y * (n + 1) + x;
+            unsigned i1 = i0 + 1;
+            unsigned i2 = i0 + (n + 1);
+            unsigned i3 = i2 + 1;
+
+            indices.insert(indices.end(), {i0, i2, i1, i1, i2, i3});
+        }
+    }
+}
+
+static bool writeBinaryPLY(const std::string& filepath, const std::vector<float>& positions, const std::vector<unsigned>& indices,
+                           bool bigEndian = false)
+{
+    std::ofstream file(filepath, std::ios::binary);
+
+    if (!file.is_open())
+        return false;
+
+    file << "ply\nformat " << (bigEndian ? "binary_big_endian" : "binary_little_endian") << " 1.0\n"
+         << "element vertex " << positions.size() / 3 << "\n"
+         << "property float x\nproperty float y\nproperty float z\n"
+         << "element face " << indices.size() / 3 << "\n"
+         << "property list uchar uint vertex_indices\nend_header\n";
+
+    // both arrays are 32-bit words
+    auto write = [&file, bigEndian](const void* data, size_t words) {
+        const char* p = static_cast<const char*>(data);
+
+        if (!bigEndian)
+        {
+            file.write(p, 4 * words);
+            return;
+        }
+
+        for (size_t w = 0; w < words; w++)
+        {
+            const char swapped[4] = {p[4 * w + 3], p[4 * w + 2], p[4 * w + 1], p[4 * w]};
+            file.write(swapped, 4);
+        }
+    };
+
+    write(positions.data(), positions.size());
+
+    const unsigned char three = 3;
+    for (size_t f = 0; f < indices.size(); f += 3)
+    {
+        file.write(reinterpret_cast<const char*>(&three), 1);
+        write(&indices[f], 3);
+    }
+
+    return file.good();
+}
+
+static bool writeBinarySTL(const std::string& filepath, const std::vector<float>& positions, const std::vector<unsigned>& indices)
+{
+    std::ofstream file(filepath, std::ios::binary);
+
+    if (!file.is_open())
+        return false;
+
+    // "solid" in the header of a binary file, as some exporters write it
+    char header[80] = "solid hzgl_bench";
+    uint32_t numTriangles = static_cast<uint32_t>(indices.size() / 3);
+
+    file.write(header, sizeof(header));
+    file.write(reinterpret_cast<const char*>(&numTriangles), sizeof(numTriangles));
+
+    std::vector<char> record(50, 0);
+    for (size_t t = 0; t < numTriangles; t++)
+    {
+        const float* p[3] = {&positions[3 * indices[3 * t]], &positions[3 * indices[3 * t + 1]], &positions[3 * indices[3 * t + 2]]};
+        glm::vec3 n = glm::cross(glm::vec3(p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2]),
+                                 glm::vec3(p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2]));
+        n = glm::normalize(n);
+
+        memcpy(&record[0], &n[0], 3 * sizeof(float));
+        for (int k = 0; k < 3; k++)
+            memcpy(&record[12 + 12 * k], p[k], 3 * sizeof(float));
+
+        file.write(record.data(), record.size());
+    }
+
+    return file.good();
+}
+
+// a .glb with one mesh (positions, normals up, indices of indexSize bytes) under a translated
+// node, laid out like exporters do: one binary chunk, a buffer view per stream
+static bool writeSyntheticGLB(const std::string& filepath, const std::vector<float>& positions, const std::vector<unsigned>& indices,
+                              int indexSize = 4)
+{
+    size_t numVertices = positions.size() / 3;
+    std::vector<float> normals(positions.size(), 0.0f);
+    for (size_t v = 0; v < numVertices; v++)
+        normals[3 * v + 1] = 1.0f;
+
+    glm::vec3 lo(INFINITY), hi(-INFINITY);
+    for (size_t v = 0; v < numVertices; v++)
+    {
+        lo = glm::min(lo, glm::vec3(positions[3 * v], positions[3 * v + 1], positions[3 * v + 2]));
+        hi = glm::max(hi, glm::vec3(positions[3 * v], positions[3 * v + 1], positions[3 * v + 2]));
+    }
+
+    std::vector<uint8_t> indexBytes(indices.size() * indexSize);
+    for (size_t i = 0; i < indices.size(); i++)
+        memcpy(&indexBytes[i * indexSize], &indices[i], indexSize);   // little endian
+
+    size_t vertexBytes = positions.size() * sizeof(float);
+    size_t indexPadded = (indexBytes.size() + 3) & ~static_cast<size_t>(3);
+    size_t binaryBytes = 2 * vertexBytes + indexPadded;
+    int componentType = (indexSize == 1) ? 5121 : (indexSize == 2) ? 5123 : 5125;
+
+    char bounds[256];
+    snprintf(bounds, sizeof(bounds), "\"min\":[%.9g,%.9g,%.9g],\"max\":[%.9g,%.9g,%.9g]", lo.x, lo.y, lo.z, hi.x, hi.y, hi.z);
+
+    std::string json = "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],"
+                       "\"nodes\":[{\"name\":\"grid\",\"mesh\":0,\"translation\":[1,2,3]}],"
+                       "\"meshes\":[{\"name\":\"grid\",\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1},\"indices\":2}]}],"
+                       "\"buffers\":[{\"byteLength\":" + std::to_string(binaryBytes) + "}],"
+                       "\"bufferViews\":["
+                       "{\"buffer\":0,\"byteLength\":" + std::to_string(vertexBytes) + ",\"target\":34962},"
+                       "{\"buffer\":0,\"byteOffset\":" + std::to_string(vertexBytes) + ",\"byteLength\":" + std::to_string(vertexBytes) + ",\"target\":34962},"
+                       "{\"buffer\":0,\"byteOffset\":" + std::to_string(2 * vertexBytes) + ",\"byteLength\":" + std::to_string(indexBytes.size()) + ",\"target\":34963}],"
+                       "\"accessors\":["
+                       "{\"bufferView\":0,\"componentType\":5126,\"count\":" + std::to_string(numVertices) + ",\"type\":\"VEC3\"," + bounds + "},"
+                       "{\"bufferView\":1,\"componentType\":5126,\"count\":" + std::to_string(numVertices) + ",\"type\":\"VEC3\"},"
+                       "{\"bufferView\":2,\"componentType\":" + std::to_string(componentType) + ",\"count\":" + std::to_string(indices.size()) + ",\"type\":\"SCALAR\"}]}";
+
+    while (json.size() % 4 != 0)
+        json += ' ';
+
+    std::ofstream file(filepath, std::ios::binary);
+
+    if (!file.is_open())
+        return false;
+
+    uint32_t header[3] = {0x46546c67, 2, static_cast<uint32_t>(12 + 8 + json.size() + 8 + binaryBytes)};
+    uint32_t jsonChunk[2] = {static_cast<uint32_t>(json.size()), 0x4e4f534a};
+    uint32_t binaryChunk[2] = {static_cast<uint32_t>(binaryBytes), 0x004e4942};
+    const char zeros[4] = {0, 0, 0, 0};
+
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(jsonChunk), sizeof(jsonChunk));
+    file.write(json.data(), json.size());
+    file.write(reinterpret_cast<const char*>(binaryChunk), sizeof(binaryChunk));
+    file.write(reinterpret_cast<const char*>(positions.data()), vertexBytes);
+    file.write(reinterpret_cast<const char*>(normals.data()), vertexBytes);
+    file.write(reinterpret_cast<const char*>(indexBytes.data()), indexBytes.size());
+    file.write(zeros, indexPadded - indexBytes.size());
+
+    return file.good();
+}
+
+// scanned-terrain-like points with colors, written in blocks so that a billion of them never
+// have to fit in memory; returns the bytes of the points
+static int64_t writePointCloudPLY(const std::string& filepath, int64_t numPoints)
+{
+    std::ofstream file(filepath, std::ios::binary);
+
+    if (!file.is_open())
+        return 0;
+
+    file << "ply\nformat binary_little_endian 1.0\n"
+         << "element vertex " << numPoints << "\n"
+         << "property float x\nproperty float y\nproperty float z\n"
+         << "property uchar red\nproperty uchar green\nproperty uchar blue\nend_header\n";
+
+    const size_t pointBytes = 3 * sizeof(float) + 3;
+    std::vector<char> block(65536 * pointBytes);
+    uint64_t state = 0x9e3779b97f4a7c15ull;
+
+    for (int64_t first = 0; first < numPoints; first += 65536)
+    {
+        int64_t count = std::min<int64_t>(65536, numPoints - first);
+        char* p = block.data();
+
+        for (int64_t i = 0; i < count; i++)
+        {
+            // xorshift, two coordinates per draw
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+
+            float u = static_cast<float>(state & 0xffffffffu) / 4294967296.0f;
+            float v = static_cast<float>(state >> 32) / 4294967296.0f;
+            float h = 20.0f * std::sin(12.0f * u) * std::cos(9.0f * v) + 5.0f * std::sin(80.0f * u + 40.0f * v);
+            float position[3] = {1000.0f * u, 1000.0f * v, h};
+            unsigned char color[3] = {static_cast<unsigned char>(128.0f + 5.0f * h), 140, static_cast<unsigned char>(255.0f * u)};
+
+            memcpy(p, position, sizeof(position));
+            memcpy(p + sizeof(position), color, sizeof(color));
+            p += pointBytes;
+        }
+
+        file.write(block.data(), count * pointBytes);
+    }
+
+    return file.good() ? numPoints * static_cast<int64_t>(pointBytes) : 0;
+}
+
+// build an in-memory Assimp scene with one mesh, as the importers would produce it
+static aiScene* syntheticScene(const std::vector<float>& positions, const std::vector<unsigned>& indices)
+{
+    unsigned numVertices = static_cast<unsigned>(positions.size() / 3);
+    unsigned numFaces = static_cast<unsigned>(indices.size() / 3);
+
+    aiMesh* mesh = new aiMesh();
+    mesh->mName = aiString("synthetic");
+    mesh->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+    mesh->mNumVertices = numVertices;
+    mesh->mVertices = new aiVector3D[numVertices];
+    mesh->mNormals = new aiVector3D[numVertices];
+    mesh->mTextureCoords[0] = new aiVector3D[numVertices];
+    mesh->mNumUVComponents[0] = 2;
+
+    for (unsigned i = 0; i < numVertices; i++)
+    {
+        mesh->mVertices[i] = aiVector3D(positions[3 * i + 0], positions[3 * i + 1], positions[3 * i + 2]);
+        mesh->mNormals[i] = aiVector3D(0.0f, 1.0f, 0.0f);
+        mesh->mTextureCoords[0][i] = aiVector3D(positions[3 * i + 0] + 0.5f, positions[3 * i + 2] + 0.5f, 0.0f);
+    }
+
+    mesh->mNumFaces = numFaces;
+    mesh->mFaces = new aiFace[numFaces];
+
+    for (unsigned f = 0; f < numFaces; f++)
+    {
+        mesh->mFaces[f].mNumIndices = 3;
+        mesh->mFaces[f].mIndices = new unsigned[3] { indices[3 * f + 0], indices[3 * f + 1], indices[3 * f + 2] };
+    }
+
+    aiScene* scene = new aiScene();
+    scene->mNumMeshes = 1;
+    scene->mMeshes = new aiMesh*[1] { mesh };
+    scene->mNumMaterials = 1;
+    scene->mMaterials = new aiMaterial*[1] { new aiMaterial() };
+    scene->mRootNode = new aiNode();
+
+    return scene;
+}
+
+// value noise so the PNG encoder cannot collapse the image into nothing
+static bool writeSyntheticTexture(const std::string& filepath, int size)
+{
+    std::vector<unsigned char> pixels(4 * static_cast<size_t>(size) * size);
+    uint32_t state = 12345u;
+
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            state = state * 1664525u + 1013904223u;
+            unsigned char* p = &pixels[4 * (static_cast<size_t>(y) * size + x)];
+            p[0] = static_cast<unsigned char>((x * 255) / size);
+            p[1] = static_cast<unsigned char>((y * 255) / size);
+            p[2] = static_cast<unsigned char>(state >> 24);
+            p[3] = 255;
+        }
+    }
+
+    return stbi_write_png(filepath.c_str(), size, size, 4, pixels.data(), 4 * size) != 0;
+}
+
+// equirectangular environment with value f(direction) per pixel, same layout as hzgl::LoadHDRImage
+static void syntheticEnvironment(int width, const std::function<glm::vec3(const glm::vec3&)>& f, hzgl::HDRImage* image)
+{
+    const float pi = 3.14159265f;
+
+    image->width = width;
+    image->height = width / 2;
+    image->pixels.resize(3 * static_cast<size_t>(image->width) * image->height);
+
+    for (int y = 0; y < image->height; y++)
+    {
+        float theta = pi * (y + 0.5f) / image->height;
+
+        for (int x = 0; x < image->width; x++)
+        {
+            float phi = 2.0f * pi * (x + 0.5f) / image->width - pi;
+            glm::vec3 dir(std::sin(theta) * std::sin(phi), std::cos(theta), -std::sin(theta) * std::cos(phi));
+            glm::vec3 value = f(dir);
+
+            float* p = &image->pixels[3 * (static_cast<size_t>(y) * image->width + x)];
+            p[0] = value.x;
+            p[1] = value.y;
+            p[2] = value.z;
+        }
+    }
+}
+
+static bool closeTo(const glm::vec3& a, const glm::vec3& b, float tolerance)
+{
+    glm::vec3 d = a - b;
+    return std::abs(d.x) <= tolerance && std::abs(d.y) <= tolerance && std::abs(d.z) <= tolerance;
+}
+
+// compare the IBL precompute against values known in closed form; prints every failure
+static bool checkIBLReference()
+{
+    bool ok = true;
+    hzgl::HDRImage image;
+    glm::vec3 sh[9];
+
+    // a constant environment L: the irradiance / pi is L for every normal
+    glm::vec3 L(0.5f, 1.0f, 2.0f);
+    syntheticEnvironment(256, [L](const glm::vec3&) { return L; }, &image);
+    hzgl::ProjectIrradianceSH9(image, sh);
+
+    for (const glm::vec3& n : {glm::vec3(0, 1, 0), glm::vec3(0, -1, 0), glm::vec3(1, 0, 0), glm::vec3(0, 0, -1)})
+    {
+        glm::vec3 e = hzgl::EvaluateIrradianceSH9(sh, n);
+        if (!closeTo(e, L, 1e-3f * L.z))
+        {
+            printf("IBL reference: constant SH irradiance at (%g, %g, %g) is (%g, %g, %g)\n", n.x, n.y, n.z, e.x, e.y, e.z);
+            ok = false;
+        }
+    }
+
+    // ... and every prefiltered level is L as well
+    hzgl::IBLOptions options;
+    options.base_width = 64;
+    options.samples = 64;
+
+    std::vector<hzgl::HDRImage> levels;
+    hzgl::PrefilterGGX(image, options, &levels);
+
+    for (size_t k = 0; k < levels.size(); k++)
+    {
+        for (size_t i = 0; i < levels[k].pixels.size(); i += 3)
+        {
+            glm::vec3 p(levels[k].pixels[i], levels[k].pixels[i + 1], levels[k].pixels[i + 2]);
+            if (!closeTo(p, L, 1e-2f))
+            {
+                printf("IBL reference: constant prefiltered level %d has (%g, %g, %g)\n", static_cast<int>(k), p.x, p.y, p.z);
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    // L(d) = 1 + d.y: the irradiance / pi is 1 + 2/3 n.y (only bands 0 and 1 involved)
+    syntheticEnvironment(256, [](const glm::vec3& d) { return glm::vec3(1.0f + d.y); }, &image);
+    hzgl::ProjectIrradianceSH9(image, sh);
+
+    for (const glm::vec3& n : {glm::vec3(0, 1, 0), glm::vec3(0, -1, 0), glm::vec3(1, 0, 0)})
+    {
+        glm::vec3 e = hzgl::EvaluateIrradianceSH9(sh, n);
+        glm::vec3 expected(1.0f + 2.0f / 3.0f * n.y);
+        if (!closeTo(e, expected, 2e-3f))
+        {
+            printf("IBL reference: linear SH irradiance at (%g, %g, %g) is %g, expected %g\n", n.x, n.y, n.z, e.x, expected.x);
+            ok = false;
+        }
+    }
+
+    // split-sum LUT: a smooth surface seen head-on reflects everything (scale + bias = 1), and
+    // no entry may reflect more than it receives
+    int size = 64;
+    std::vector<float> lut;
+    hzgl::ComputeBRDFLut(size, 256, &lut);
+
+    const float* smooth = &lut[2 * (size - 1)];
+    if (std::abs(smooth[0] + smooth[1] - 1.0f) > 0.02f)
+    {
+        printf("IBL reference: LUT(NdotV=1, roughness=0) sums to %g\n", smooth[0] + smooth[1]);
+        ok = false;
+    }
+
+    for (size_t i = 0; i < lut.size(); i += 2)
+    {
+        if (lut[i] < 0.0f || lut[i + 1] < 0.0f || lut[i] + lut[i + 1] > 1.0f + 1e-3f)
+        {
+            printf("IBL reference: LUT entry %d is (%g, %g)\n", static_cast<int>(i / 2), lut[i], lut[i + 1]);
+            ok = false;
+            break;
+        }
+    }
+
+    return ok;
+}
+
+// triangles with their own three vertices each (like an OBJ import); position(u, v) and the
+// parameter range set the surface, winding makes cross(p1 - p0, p2 - p0) point along outward(p)
+static void syntheticSurface(int columns, int rows, const std::function<glm::vec3(float, float)>& position,
+                             const std::function<glm::vec3(const glm::vec3&)>& outward, hzgl::MeshInfo* mesh)
+{
+    mesh->positions.clear();
+    mesh->texcoords.clear();
+    mesh->indices.clear();
+
+    auto corner = [&](int x, int y) {
+        glm::vec2 uv(static_cast<float>(x) / columns, static_cast<float>(y) / rows);
+        glm::vec3 p = position(uv.x, uv.y);
+
+        mesh->indices.push_back(static_cast<unsigned>(mesh->positions.size() / 3));
+        mesh->positions.insert(mesh->positions.end(), {p.x, p.y, p.z});
+        mesh->texcoords.insert(mesh->texcoords.end(), {uv.x, uv.y});
+    };
+
+    auto triangle = [&](int x0, int y0, int x1, int y1, int x2, int y2) {
+        glm::vec3 p0 = position(static_cast<float>(x0) / columns, static_cast<float>(y0) / rows);
+        glm::vec3 p1 = position(static_cast<float>(x1) / columns, static_cast<float>(y1) / rows);
+        glm::vec3 p2 = position(static_cast<float>(x2) / columns, static_cast<float>(y2) / rows);
+
+        corner(x0, y0);
+
+        if (glm::dot(glm::cross(p1 - p0, p2 - p0), outward((p0 + p1 + p2) / 3.0f)) >= 0.0f)
+        {
+            corner(x1, y1);
+            corner(x2, y2);
+        }
+        else
+        {
+            corner(x2, y2);
+            corner(x1, y1);
+        }
+    };
+
+    for (int y = 0; y < rows; y++)
+    {
+        for (int x = 0; x < columns; x++)
+        {
+            triangle(x, y, x + 1, y, x, y + 1);
+            triangle(x + 1, y, x + 1, y + 1, x, y + 1);
+        }
+    }
+
+    mesh->normals.clear();
+    mesh->qtangents.clear();
+    mesh->num_vertices = static_cast<int>(mesh->positions.size() / 3);
+}
+
+// compare the generated frames against the analytic ones of parametric surfaces; prints every
+// failure. The bitangent is rebuilt like the shaders do, sign * cross(normal, tangent).
+static bool checkTangentReference()
+{
+    bool ok = true;
+
+    auto check = [&ok](const char* name, const hzgl::MeshInfo& mesh, const std::function<bool(const glm::vec3&)>& skip,
+                       const std::function<glm::vec3(const glm::vec3&)>& normal,
+                       const std::function<glm::vec3(const glm::vec3&)>& dPdu,
+                       const std::function<glm::vec3(const glm::vec3&)>& dPdv, float tolerance) {
+        for (int v = 0; v < mesh.num_vertices; v++)
+        {
+            glm::vec3 p(mesh.positions[3 * v], mesh.positions[3 * v + 1], mesh.positions[3 * v + 2]);
+
+            if (skip(p))
+                continue;
+
+            glm::vec3 n, t;
+            float sign;
+            hzgl::DecodeQTangent(&mesh.qtangents[4 * v], &n, &t, &sign);
+
+            glm::vec3 stored(mesh.normals[3 * v], mesh.normals[3 * v + 1], mesh.normals[3 * v + 2]);
+            glm::vec3 b = sign * glm::cross(n, t);
+
+            if (!closeTo(stored, normal(p), tolerance) || !closeTo(n, normal(p), tolerance)
+                || !closeTo(t, glm::normalize(dPdu(p)), tolerance) || !closeTo(b, glm::normalize(dPdv(p)), tolerance))
+            {
+                printf("Tangent reference: %s at (%g, %g, %g) has N (%g, %g, %g), T (%g, %g, %g), B (%g, %g, %g)\n", name,
+                       p.x, p.y, p.z, n.x, n.y, n.z, t.x, t.y, t.z, b.x, b.y, b.z);
+                ok = false;
+                return;
+            }
+        }
+    };
+
+    // a plane with texcoords rotated by 30 degrees, and the same with u mirrored: all vertices
+    // at the same position are welded back, the mirrored one gets the other handedness
+    const float c = std::cos(glm::radians(30.0f));
+    const float s = std::sin(glm::radians(30.0f));
+
+    for (float mirror : {1.0f, -1.0f})
+    {
+        hzgl::MeshInfo plane;
+        syntheticSurface(16, 16, [](float u, float v) { return glm::vec3(u, 0.0f, v); },
+                         [](const glm::vec3&) { return glm::vec3(0.0f, 1.0f, 0.0f); }, &plane);
+
+        for (size_t i = 0; i < plane.texcoords.size(); i += 2)
+        {
+            float x = plane.texcoords[i], z = plane.texcoords[i + 1];
+            plane.texcoords[i] = mirror * (c * x + s * z);
+            plane.texcoords[i + 1] = -s * x + c * z;
+        }
+
+        hzgl::GenerateTangentFrames(plane);
+
+        if (plane.num_vertices != 17 * 17)
+        {
+            printf("Tangent reference: the plane has %d vertices after welding, expected %d\n", plane.num_vertices, 17 * 17);
+            ok = false;
+        }
+
+        // x = c u - s v, z = s u + c v (u mirrored: dP/du flips)
+        check(mirror > 0.0f ? "plane" : "mirrored plane", plane, [](const glm::vec3&) { return false; },
+              [](const glm::vec3&) { return glm::vec3(0.0f, 1.0f, 0.0f); },
+              [&](const glm::vec3&) { return mirror * glm::vec3(c, 0.0f, s); },
+              [&](const glm::vec3&) { return glm::vec3(-s, 0.0f, c); }, 1e-3f);
+    }
+
+    // a UV sphere: smooth normals along the radius, the tangent along the longitude; the seam is
+    // split by its texcoords (each side only sees its own faces, so it is skipped like the poles)
+    const float pi = 3.14159265f;
+    hzgl::MeshInfo sphere;
+    syntheticSurface(64, 32, [pi](float u, float v) {
+        float theta = pi * v, phi = 2.0f * pi * (u < 1.0f ? u : 0.0f);   // both sides of the seam match
+        return glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+    }, [](const glm::vec3& p) { return p; }, &sphere);
+
+    hzgl::GenerateTangentFrames(sphere);
+
+    check("sphere", sphere, [](const glm::vec3& p) { return std::abs(p.y) > 0.95f || (std::abs(p.z) < 1e-4f && p.x > 0.0f); },
+          [](const glm::vec3& p) { return glm::normalize(p); },
+          [](const glm::vec3& p) { return glm::vec3(-p.z, 0.0f, p.x); },
+          [](const glm::vec3& p) {
+              float r = std::sqrt(p.x * p.x + p.z * p.z);
+              return glm::vec3(p.y * p.x / r, -r, p.y * p.z / r);
+          }, 2e-2f);
+
+    // a cube: the crease angle keeps the faces flat (24 vertices), 180 degrees smooths the
+    // corners to the diagonals (8 vertices, every face contributes 90 degrees)
+    for (float crease : {60.0f, 180.0f})
+    {
+        hzgl::MeshInfo cube;
+        cube.positions = {-1, -1, -1, 1, -1, -1, 1, 1, -1, -1, 1, -1, -1, -1, 1, 1, -1, 1, 1, 1, 1, -1, 1, 1};
+        cube.indices = {0, 2, 1, 0, 3, 2, 4, 5, 6, 4, 6, 7, 0, 1, 5, 0, 5, 4, 3, 6, 2, 3, 7, 6, 0, 4, 7, 0, 7, 3, 1, 2, 6, 1, 6, 5};
+        cube.num_vertices = 8;
+
+        hzgl::TangentFrameOptions options;
+        options.crease_angle = crease;
+        hzgl::GenerateTangentFrames(cube, options);
+
+        int expected = (crease < 90.0f) ? 24 : 8;
+
+        if (cube.num_vertices != expected || !cube.qtangents.empty())
+        {
+            printf("Tangent reference: the cube (crease %g) has %d vertices, expected %d\n", crease, cube.num_vertices, expected);
+            ok = false;
+            continue;
+        }
+
+        for (int v = 0; v < cube.num_vertices; v++)
+        {
+            glm::vec3 p(cube.positions[3 * v], cube.positions[3 * v + 1], cube.positions[3 * v + 2]);
+            glm::vec3 n(cube.normals[3 * v], cube.normals[3 * v + 1], cube.normals[3 * v + 2]);
+
+            // flat: one coordinate of the normal is 1 and p has the same sign there
+            bool right = (crease < 90.0f) ? std::abs(glm::dot(n, p) - 1.0f) < 1e-5f && std::abs(glm::length(n) - 1.0f) < 1e-5f
+                                          : closeTo(n, p / std::sqrt(3.0f), 1e-5f);
+
+            if (!right)
+            {
+                printf("Tangent reference: cube (crease %g) normal (%g, %g, %g) at (%g, %g, %g)\n", crease, n.x, n.y, n.z, p.x, p.y, p.z);
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    // QTangent round trip, including a frame with w = 0 (half turn) in both handednesses
+    const glm::vec3 frames[][2] = {
+        {glm::vec3(0, 0, 1), glm::vec3(1, 0, 0)},
+        {glm::vec3(0, 0, -1), glm::vec3(1, 0, 0)},
+        {glm::normalize(glm::vec3(1, 2, 3)), glm::normalize(glm::vec3(3, 0, -1))},
+        {glm::normalize(glm::vec3(-1, -1, 0.1f)), glm::normalize(glm::vec3(0.5f, -0.5f, 1))},
+    };
+
+    for (const auto& frame : frames)
+    {
+        for (float sign : {1.0f, -1.0f})
+        {
+            int16_t q[4];
+            hzgl::EncodeQTangent(frame[0], frame[1], sign, q);
+
+            glm::vec3 n, t;
+            float decodedSign;
+            hzgl::DecodeQTangent(q, &n, &t, &decodedSign);
+
+            glm::vec3 expected = glm::normalize(frame[1] - glm::dot(frame[1], frame[0]) * frame[0]);
+
+            if (!closeTo(n, frame[0], 1e-3f) || !closeTo(t, expected, 1e-3f) || decodedSign != sign)
+            {
+                printf("Tangent reference: QTangent of N (%g, %g, %g) decodes to N (%g, %g, %g), T (%g, %g, %g), sign %g\n",
+                       frame[0].x, frame[0].y, frame[0].z, n.x, n.y, n.z, t.x, t.y, t.z, decodedSign);
+                ok = false;
+            }
+        }
+    }
+
+    return ok;
+}
+
+// the mapped PLY and STL readers against Assimp on the same files: the same triangles, corner by
+// corner, after LoadMeshesFromFile has made both into render-ready meshes
+static bool checkMeshReaderReference(const std::string& tmpdir)
+{
+    bool ok = true;
+
+    std::vector<float> positions;
+    std::vector<unsigned> indices;
+    syntheticGrid(20000, positions, indices);
+
+    const char* kinds[] = {"ply", "ply-be", "stl"};
+
+    for (const char* kind : kinds)
+    {
+        std::string name = kind;
+        std::string filepath = tmpdir + "/hzgl_bench_reference." + (name == "stl" ? "stl" : "ply");
+
+        bool written = (name == "stl") ? writeBinarySTL(filepath, positions, indices) : writeBinaryPLY(filepath, positions, indices, name == "ply-be");
+
+        if (!written)
+            return false;
+
+        hzgl::MeshInfo direct;
+        bool read = (name == "stl") ? hzgl::ReadStlMesh(filepath, direct) : hzgl::ReadPlyMesh(filepath, direct);
+
+        std::vector<hzgl::MeshInfo> mapped, assimp;
+        hzgl::LoadMeshesFromFile(filepath, mapped);
+        hzgl::LoadMeshesFromFile(filepath, assimp, nullptr, false);
+
+        if (!read || mapped.size() != 1 || assimp.size() != 1 || mapped[0].indices.size() != assimp[0].indices.size()
+            || mapped[0].indices.size() != indices.size())
+        {
+            printf("Mesh reader reference: %s read %d, %zu meshes against %zu from Assimp\n", kind, read, mapped.size(), assimp.size());
+            ok = false;
+            std::remove(filepath.c_str());
+            continue;
+        }
+
+        // STL welds to the vertices of the grid
+        if (name == "stl" && direct.positions.size() != positions.size())
+        {
+            printf("Mesh reader reference: STL welded to %zu vertices instead of %zu\n", direct.positions.size() / 3, positions.size() / 3);
+            ok = false;
+        }
+
+        for (size_t c = 0; c < indices.size(); c++)
+        {
+            const float* a = &mapped[0].positions[3 * mapped[0].indices[c]];
+            const float* b = &assimp[0].positions[3 * assimp[0].indices[c]];
+
+            if (!closeTo(glm::vec3(a[0], a[1], a[2]), glm::vec3(b[0], b[1], b[2]), 0.0f))
+            {
+                printf("Mesh reader reference: %s corner %zu at (%g, %g, %g), Assimp (%g, %g, %g)\n", kind, c, a[0], a[1], a[2], b[0], b[1], b[2]);
+                ok = false;
+                break;
+            }
+        }
+
+        std::remove(filepath.c_str());
+    }
+
+    return ok;
+}
+
+// the native glTF reader against the data written and against Assimp, for every index size
+static bool checkGltfReference(const std::string& tmpdir)
+{
+    bool ok = true;
+
+    std::vector<float> positions;
+    std::vector<unsigned> indices;
+    syntheticGrid(100, positions, indices);
+
+    for (int indexSize : {1, 2, 4})
+    {
+        std::string filepath = tmpdir + "/hzgl_bench_reference_" + std::to_string(indexSize) + ".glb";
+
+        if (!writeSyntheticGLB(filepath, positions, indices, indexSize))
+            return false;
+
+        hzgl::GltfAsset asset;
+        bool opened = asset.Open(filepath);
+
+        if (!opened || asset.Primitives().size() != 1 || asset.Nodes().size() != 2)
+        {
+            printf("glTF reference: %d-byte indices not read\n", indexSize);
+            ok = false;
+            std::remove(filepath.c_str());
+            continue;
+        }
+
+        const hzgl::GltfPrimitive& primitive = asset.Primitives()[0];
+        const hzgl::NodeInfo& node = asset.Nodes()[primitive.node];
+
+        if (node.parent != 0 || node.transform[12] != 1.0f || node.transform[13] != 2.0f || node.transform[14] != 3.0f)
+        {
+            printf("glTF reference: node %s has the wrong parent or translation\n", node.name.c_str());
+            ok = false;
+        }
+
+        if (asset.ElementSize(primitive.indices) != static_cast<size_t>(indexSize)
+            || asset.Accessors()[primitive.indices].count != indices.size())
+        {
+            printf("glTF reference: %d-byte indices read as %d-byte\n", indexSize, static_cast<int>(asset.ElementSize(primitive.indices)));
+            ok = false;
+        }
+
+        for (size_t i = 0; ok && i < indices.size(); i++)
+        {
+            unsigned index = 0;
+            memcpy(&index, asset.Data(primitive.indices) + i * indexSize, indexSize);
+
+            float p[3];
+            asset.Read(primitive.position, index, p, 3);
+
+            if (index != indices[i] || !closeTo(glm::vec3(p[0], p[1], p[2]), glm::vec3(positions[3 * index], positions[3 * index + 1], positions[3 * index + 2]), 0.0f))
+            {
+                printf("glTF reference: index %zu is %u at (%g, %g, %g)\n", i, index, p[0], p[1], p[2]);
+                ok = false;
+            }
+        }
+
+        // the same file through Assimp has the same triangles
+        std::vector<hzgl::MeshInfo> meshes;
+        hzgl::LoadMeshesFromFile(filepath, meshes);
+
+        if (meshes.size() != 1 || meshes[0].indices.size() != indices.size())
+        {
+            printf("glTF reference: Assimp reads %zu meshes from the %d-byte file\n", meshes.size(), indexSize);
+            ok = false;
+        }
+
+        // a cut-off file is turned down rather than read past its end
+        std::ifstream in(filepath, std::ios::binary);
+        std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+
+        std::ofstream(filepath, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size() - 64);
+
+        hzgl::GltfAsset truncated;
+        if (truncated.Open(filepath))
+        {
+            printf("glTF reference: a truncated file was opened\n");
+            ok = false;
+        }
+
+        std::remove(filepath.c_str());
+    }
+
+    return ok;
+}
+
+static BenchResult runCase(const BenchCase& bench, const BenchOptions& options)
+{
+    BenchResult result;
+    result.name = bench.name;
+
+    // warm up caches and lazy initialization (e.g. Assimp importer registry)
+    bench.run();
+
+    resetPeakRSS();
+
+    std::vector<double> times;
+    hzgl::HeapStats heapBefore = hzgl::GetHeapStats();
+    double total = 0.0;
+
+    while (times.empty() || (total < options.min_time && times.size() < 1000))
+    {
+        hzgl::SimpleTimer timer;
+        timer.Start();
+        bench.run();
+        double seconds = timer.End();
+
+        times.push_back(1000.0 * seconds);
+        total += seconds;
+    }
+
+    result.iterations = static_cast<int>(times.size());
+    hzgl::HeapStats heapAfter = hzgl::GetHeapStats();
+    result.allocs = static_cast<double>(heapAfter.total_allocations - heapBefore.total_allocations) / times.size();
+    result.alloc_mb = static_cast<double>(heapAfter.total_bytes - heapBefore.total_bytes) / times.size() / (1024.0 * 1024.0);
+    result.peak_rss_mb = peakRSSMegabytes();
+
+    std::sort(times.begin(), times.end());
+    result.min_ms = times.front();
+    result.median_ms = times[times.size() / 2];
+    result.mean_ms = 1000.0 * total / times.size();
+    result.items_per_s = bench.items / (result.median_ms / 1000.0);
+    result.mb_per_s = bench.bytes / (1024.0 * 1024.0) / (result.median_ms / 1000.0);
+
+    return result;
+}
+
+// names come from file names, which may hold anything JSON strings cannot
+static std::string jsonEscape(const std::string& str)
+{
+    std::string escaped;
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        }
+        else
+            escaped += c;
+    }
+    return escaped;
+}
+
+static bool writeResults(const std::string& filepath, const std::vector<BenchResult>& results)
+{
+    FILE* fp = fopen(filepath.c_str(), "w");
+
+    if (fp == nullptr)
+        return false;
+
+    fprintf(fp, "{\n  \"benchmarks\": [");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const auto& r = results[i];
+        fprintf(fp, "%s\n    {\"name\": \"%s\", \"iterations\": %d, \"min_ms\": %.4f, \"median_ms\": %.4f, \"mean_ms\": %.4f, "
+                    "\"items_per_s\": %.1f, \"mb_per_s\": %.2f, \"allocs\": %.1f, \"alloc_mb\": %.3f, \"peak_rss_mb\": %.2f}",
+                (i > 0 ? "," : ""), jsonEscape(r.name).c_str(), r.iterations, r.min_ms, r.median_ms, r.mean_ms,
+                r.items_per_s, r.mb_per_s, r.allocs, r.alloc_mb, r.peak_rss_mb);
+    }
+    fprintf(fp, "\n  ]\n}\n");
+
+    fclose(fp);
+
+    return true;
+}
+
+static std::string triangleLabel(int64_t numTriangles)
+{
+    if (numTriangles >= 1000000)
+        return std::to_string(numTriangles / 1000000) + "M";
+
+    return std::to_string(numTriangles / 1000) + "k";
+}
+
+static bool isModelFile(const std::string& filepath)
+{
+    std::string ext = hzgl::GetExtension(filepath);
+    return ext == "obj" || ext == "ply" || ext == "stl" || ext == "gltf" || ext == "glb" || ext == "fbx";
+}
+
+static bool isImageFile(const std::string& filepath)
+{
+    std::string ext = hzgl::GetExtension(filepath);
+    return ext == "png" || ext == "jpg" || ext == "jpeg" || ext == "tga" || ext == "bmp" || ext == "hdr";
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if (arg == "--output" && hasValue)
+            options.output = argv[++i];
+        else if (arg == "--filter" && hasValue)
+            options.filter = argv[++i];
+        else if (arg == "--assets" && hasValue)
+            options.assets = argv[++i];
+        else if (arg == "--min-time" && hasValue)
+            options.min_time = std::stod(argv[++i]);
+        else if (arg == "--max-triangles" && hasValue)
+            options.max_triangles = std::stoll(argv[++i]);
+        else if (arg == "--max-points" && hasValue)
+            options.max_points = std::stoll(argv[++i]);
+        else
+        {
+            std::cerr << "usage: hzgl_bench [--output file.json] [--filter substring] [--assets dir]"
+                      << " [--min-time seconds] [--max-triangles N] [--max-points N]" << std::endl;
+            return -1;
+        }
+    }
+
+    std::string tmpdir = hzgl::GetAbsolutePath(".");
+    std::vector<std::string> tmpfiles;
+    std::vector<BenchCase> cases;
+
+    // one pool for every LoadMeshesFromFile case, like the viewer has for its models
+    int meshThreads = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+    auto meshPool = std::make_shared<std::unique_ptr<hzgl::ThreadPool>>();
+    if (meshThreads > 0)
+        meshPool->reset(new hzgl::ThreadPool(meshThreads, 0, "Mesh"));
+
+    // bundled models (only Assimp-supported formats)
+    for (const auto& filepath : hzgl::ListFiles(options.assets + "/models", true))
+    {
+        std::string name = "LoadMeshesFromFile/" + filepath.substr(filepath.find_last_of('/') + 1);
+
+        // counting the triangles is a full import, not worth it for a case that is filtered out
+        if (!isModelFile(filepath) || (!options.filter.empty() && name.find(options.filter) == std::string::npos))
+            continue;
+
+        std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+
+        BenchCase bench;
+        bench.name = name;
+        bench.bytes = static_cast<double>(file.tellg());
+        bench.run = [filepath, meshPool]() {
+            std::vector<hzgl::MeshInfo> meshes;
+            hzgl::LoadMeshesFromFile(filepath, meshes, nullptr, true, meshPool->get());
+        };
+
+        // count triangles once so the throughput is meaningful
+        std::vector<hzgl::MeshInfo> meshes;
+        hzgl::LoadMeshesFromFile(filepath, meshes);
+        for (const auto& mesh : meshes)
+            bench.items += mesh.indices.size() / 3;
+
+        cases.push_back(bench);
+    }
+
+    // synthetic meshes, both through the importer and through the conversion alone
+    const int64_t sizes[] = {10000, 100000, 1000000, 10000000, 50000000};
+
+    for (int64_t numTriangles : sizes)
+    {
+        if (numTriangles > options.max_triangles)
+            break;
+
+        std::string label = triangleLabel(numTriangles);
+
+        // skip the (slow) generation for cases that are filtered out anyway
+        bool wantImport = options.filter.empty() || ("LoadMeshesFromFile/synthetic-" + label).find(options.filter) != std::string::npos;
+        bool wantProcess = options.filter.empty() || ("ProcessAiMesh/synthetic-" + label).find(options.filter) != std::string::npos;
+
+        if (!wantImport && !wantProcess)
+            continue;
+
+        auto positions = std::make_shared<std::vector<float>>();
+        auto indices = std::make_shared<std::vector<unsigned>>();
+        syntheticGrid(numTriangles, *positions, *indices);
+
+        double items = static_cast<double>(indices->size() / 3);
+
+        if (wantImport)
+        {
+            std::string filepath = tmpdir + "/hzgl_bench_synthetic_" + label + ".ply";
+
+            if (writeBinaryPLY(filepath, *positions, *indices))
+            {
+                tmpfiles.push_back(filepath);
+
+                BenchCase bench;
+                bench.name = "LoadMeshesFromFile/synthetic-" + label;
+                bench.items = items;
+                bench.bytes = positions->size() * sizeof(float) + (indices->size() / 3) * 13.0;
+                bench.run = [filepath, meshPool]() {
+                    std::vector<hzgl::MeshInfo> meshes;
+                    hzgl::LoadMeshesFromFile(filepath, meshes, nullptr, true, meshPool->get());
+                };
+                cases.push_back(bench);
+            }
+        }
+
+        if (wantProcess)
+        {
+            std::shared_ptr<aiScene> scene(syntheticScene(*positions, *indices));
+
+            BenchCase bench;
+            bench.name = "ProcessAiMesh/synthetic-" + label;
+            bench.items = items;
+            bench.bytes = positions->size() * sizeof(float) * 3 + indices->size() * sizeof(unsigned);
+            bench.run = [scene]() {
+                std::vector<hzgl::MeshInfo> meshes;
+                hzgl::ProcessAiMesh(scene.get(), scene->mMeshes[0], meshes);
+            };
+            cases.push_back(bench);
+        }
+    }
+
+    // texture decoding (the stb path of TextureFromFile), bundled and synthetic images
+    std::vector<std::string> images;
+    for (const auto& filepath : hzgl::ListFiles(options.assets, true))
+    {
+        if (isImageFile(filepath))
+            images.push_back(filepath);
+    }
+
+    for (int size : {512, 2048, 4096})
+    {
+        std::string filepath = tmpdir + "/hzgl_bench_texture_" + std::to_string(size) + ".png";
+
+        if (writeSyntheticTexture(filepath, size))
+        {
+            tmpfiles.push_back(filepath);
+            images.push_back(filepath);
+        }
+    }
+
+    for (const auto& filepath : images)
+    {
+        int width = 0, height = 0, n = 0;
+        unsigned char* data = hzgl::DecodeImage(filepath, &width, &height, &n);
+
+        if (data == nullptr)
+            continue;
+
+        hzgl::FreeImage(data);
+
+        std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+
+        BenchCase bench;
+        bench.name = "DecodeImage/" + filepath.substr(filepath.find_last_of('/') + 1);
+        bench.items = static_cast<double>(width) * height;
+        bench.bytes = static_cast<double>(file.tellg());
+        bench.run = [filepath]() {
+            int w, h, c;
+            hzgl::FreeImage(hzgl::DecodeImage(filepath, &w, &h, &c));
+        };
+        cases.push_back(bench);
+    }
+
+    // software occlusion culling: a synthetic grid seen from above fills the CPU depth buffer
+    glm::mat4 viewProj = glm::perspective(glm::radians(45.0f), 2.0f, 0.1f, 100.0f)
+                       * glm::lookAt(glm::vec3(0.0f, 1.2f, 0.8f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    int cullThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+    const int64_t occluderSizes[] = {1000, 10000, 100000};
+
+    for (int64_t numTriangles : occluderSizes)
+    {
+        auto occluder = std::make_shared<hzgl::OccluderMesh>();
+        syntheticGrid(numTriangles, occluder->positions, occluder->indices);
+        occluder->bounds = hzgl::ComputeBounds(occluder->positions);
+
+        for (int threads : {0, cullThreads})
+        {
+            auto culler = std::make_shared<hzgl::OcclusionCuller>(256, 128, threads);
+
+            BenchCase bench;
+            bench.name = "OcclusionCuller/raster-" + triangleLabel(numTriangles) + (threads > 0 ? "-mt" : "");
+            bench.items = static_cast<double>(occluder->indices.size() / 3);
+            bench.bytes = occluder->positions.size() * sizeof(float) + occluder->indices.size() * sizeof(unsigned);
+            bench.run = [culler, occluder, viewProj]() {
+                culler->BeginFrame(viewProj);
+                culler->AddOccluder(*occluder, glm::mat4(1.0f));
+                culler->RasterizeOccluders();
+            };
+            cases.push_back(bench);
+        }
+    }
+
+    // boxes hidden under the grid: every test scans its whole rectangle before the box is culled
+    {
+        auto culler = std::make_shared<hzgl::OcclusionCuller>(256, 128, 0);
+        auto boxes = std::make_shared<std::vector<hzgl::BoundingBox>>();
+
+        hzgl::OccluderMesh occluder;
+        syntheticGrid(10000, occluder.positions, occluder.indices);
+
+        culler->BeginFrame(viewProj);
+        culler->AddOccluder(occluder, glm::mat4(1.0f));
+        culler->RasterizeOccluders();
+
+        for (int z = 0; z < 32; z++)
+        {
+            for (int x = 0; x < 32; x++)
+            {
+                glm::vec3 lo(-0.4f + 0.025f * x, -0.3f, -0.4f + 0.025f * z);
+                boxes->push_back({lo, lo + glm::vec3(0.02f)});
+            }
+        }
+
+        BenchCase bench;
+        bench.name = "OcclusionCuller/test-1k-boxes";
+        bench.items = static_cast<double>(boxes->size());
+        bench.bytes = boxes->size() * sizeof(hzgl::BoundingBox);
+        bench.run = [culler, boxes]() {
+            for (const auto& box : *boxes)
+                culler->IsVisible(box, glm::mat4(1.0f));
+        };
+        cases.push_back(bench);
+    }
+
+    // scene graph: 1000 roots with 9 children and 90 grandchildren each (100k nodes), moving all
+    // or 1% of the roots every iteration
+    for (int threads : {0, cullThreads})
+    {
+        for (int percent : {100, 1})
+        {
+            auto graph = std::make_shared<hzgl::SceneGraph>(threads);
+            auto roots = std::make_shared<std::vector<hzgl::NodeId>>();
+
+            for (int r = 0; r < 1000; r++)
+            {
+                hzgl::NodeId root = graph->AddNode(hzgl::InvalidNode, glm::translate(glm::mat4(1.0f), glm::vec3(float(r), 0.0f, 0.0f)));
+                roots->push_back(root);
+
+                for (int c = 0; c < 9; c++)
+                {
+                    hzgl::NodeId child = graph->AddNode(root, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, float(c), 0.0f)));
+
+                    for (int g = 0; g < 10; g++)
+                        graph->AddNode(child, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, float(g))));
+                }
+            }
+
+            graph->Update();
+
+            int step = 100 / percent;
+
+            BenchCase bench;
+            bench.name = std::string("SceneGraph/update-100k-") + (percent == 100 ? "full" : "1pct") + (threads > 0 ? "-mt" : "");
+            bench.items = 100000.0 * percent / 100.0;
+            bench.bytes = bench.items * 2 * sizeof(glm::mat4);
+            bench.run = [graph, roots, step]() {
+                for (size_t r = 0; r < roots->size(); r += step)
+                {
+                    glm::mat4 local = graph->Local((*roots)[r]);
+                    local[3][1] += 0.001f;
+                    graph->SetLocal((*roots)[r], local);
+                }
+                graph->Update();
+            };
+            cases.push_back(bench);
+        }
+    }
+
+    // image-based lighting precompute on a synthetic sky (bright band near the horizon and a sun)
+    {
+        auto environment = std::make_shared<hzgl::HDRImage>();
+        syntheticEnvironment(512, [](const glm::vec3& d) {
+            float sun = std::pow(std::max(glm::dot(d, glm::normalize(glm::vec3(0.3f, 0.6f, -0.5f))), 0.0f), 256.0f);
+            return glm::vec3(0.3f, 0.5f, 0.9f) * (1.0f - 0.7f * std::abs(d.y)) + glm::vec3(50.0f * sun);
+        }, environment.get());
+
+        double pixels = static_cast<double>(environment->width) * environment->height;
+
+        for (int threads : {0, cullThreads})
+        {
+            auto pool = std::make_shared<std::unique_ptr<hzgl::ThreadPool>>();
+            if (threads > 0)
+                pool->reset(new hzgl::ThreadPool(threads, 0, "IBL"));
+
+            std::string suffix = (threads > 0 ? "-mt" : "");
+
+            BenchCase sh9;
+            sh9.name = "IBL/sh9-512" + suffix;
+            sh9.items = pixels;
+            sh9.bytes = pixels * 3 * sizeof(float);
+            sh9.run = [environment, pool]() {
+                glm::vec3 sh[9];
+                hzgl::ProjectIrradianceSH9(*environment, sh, pool->get());
+            };
+            cases.push_back(sh9);
+
+            hzgl::IBLOptions options;
+            BenchCase prefilter;
+            prefilter.name = "IBL/prefilter-256" + suffix;
+            prefilter.items = 0.0;
+            for (int k = 0, w = options.base_width; k < options.levels; k++, w = std::max(w / 2, 1))
+                prefilter.items += w * std::max(w / 2, 1);
+            prefilter.bytes = pixels * 3 * sizeof(float);
+            prefilter.run = [environment, pool, options]() {
+                std::vector<hzgl::HDRImage> levels;
+                hzgl::PrefilterGGX(*environment, options, &levels, pool->get());
+            };
+            cases.push_back(prefilter);
+
+            BenchCase lut;
+            lut.name = "IBL/brdf-lut-128" + suffix;
+            lut.items = 128.0 * 128.0;
+            lut.bytes = 0.0;
+            lut.run = [pool]() {
+                std::vector<float> data;
+                hzgl::ComputeBRDFLut(128, 256, &data, pool->get());
+            };
+            cases.push_back(lut);
+        }
+    }
+
+    // normals and tangent frames of the synthetic grid (welded, with texcoords); the input is
+    // copied every iteration since the mesh is rewritten in place
+    for (int64_t numTriangles : {100000, 1000000, 10000000})
+    {
+        std::string label = triangleLabel(numTriangles);
+
+        if (numTriangles > options.max_triangles
+            || (!options.filter.empty() && ("Tangents/synthetic-" + label + "-mt").find(options.filter) == std::string::npos))
+            continue;
+
+        auto mesh = std::make_shared<hzgl::MeshInfo>();
+        syntheticGrid(numTriangles, mesh->positions, mesh->indices);
+        mesh->num_vertices = static_cast<int>(mesh->positions.size() / 3);
+
+        for (size_t i = 0; i < mesh->positions.size(); i += 3)
+            mesh->texcoords.insert(mesh->texcoords.end(), {mesh->positions[i] + 0.5f, mesh->positions[i + 2] + 0.5f});
+
+        for (int threads : {0, cullThreads})
+        {
+            auto pool = std::make_shared<std::unique_ptr<hzgl::ThreadPool>>();
+            if (threads > 0)
+                pool->reset(new hzgl::ThreadPool(threads, 0, "Tangents"));
+
+            BenchCase bench;
+            bench.name = "Tangents/synthetic-" + label + (threads > 0 ? "-mt" : "");
+            bench.items = static_cast<double>(mesh->indices.size() / 3);
+            bench.bytes = mesh->positions.size() * sizeof(float) + mesh->texcoords.size() * sizeof(float)
+                        + mesh->indices.size() * sizeof(unsigned);
+            bench.run = [mesh, pool]() {
+                hzgl::MeshInfo copy = *mesh;
+                hzgl::GenerateTangentFrames(copy, hzgl::TangentFrameOptions(), pool->get());
+            };
+            cases.push_back(bench);
+        }
+    }
+
+    // out-of-core preprocessing of the synthetic grid from a binary PLY; the arrays are freed
+    // before the case runs, and the budget is below the size of the input for the larger ones
+    for (int64_t numTriangles : {1000000, 10000000, 50000000})
+    {
+        std::string label = triangleLabel(numTriangles);
+        std::string name = "Streaming/preprocess-" + label;
+
+        if (numTriangles > options.max_triangles || (!options.filter.empty() && name.find(options.filter) == std::string::npos))
+            continue;
+
+        std::string filepath = tmpdir + "/hzgl_bench_streaming_" + label + ".ply";
+        double items = 0.0, bytes = 0.0;
+
+        {
+            std::vector<float> positions;
+            std::vector<unsigned> indices;
+            syntheticGrid(numTriangles, positions, indices);
+
+            if (!writeBinaryPLY(filepath, positions, indices))
+                continue;
+
+            items = static_cast<double>(indices.size() / 3);
+            bytes = positions.size() * sizeof(float) + items * 13.0;
+        }
+
+        tmpfiles.push_back(filepath);
+        tmpfiles.push_back(filepath + ".hzchunks");
+
+        BenchCase bench;
+        bench.name = name;
+        bench.items = items;
+        bench.bytes = bytes;
+        bench.run = [filepath, cullThreads]() {
+            hzgl::ChunkBuildOptions build;
+            build.memory_budget_mb = 256;
+            build.threads = cullThreads;
+            hzgl::BuildChunkedMesh(filepath, filepath + ".hzchunks", build);
+        };
+        cases.push_back(bench);
+    }
+
+    // binary PLY (both byte orders) and STL through the mapped readers, on the calling thread and
+    // on the pool, against Assimp with its conversion to a MeshInfo (LoadMeshesFromFile also builds
+    // the tangent frames, which both sides share)
+    for (int64_t numTriangles : {100000, 1000000, 10000000})
+    {
+        std::string label = triangleLabel(numTriangles);
+
+        if (numTriangles > options.max_triangles)
+            continue;
+
+        const char* kinds[] = {"ply", "ply-be", "stl"};
+
+        for (const char* kind : kinds)
+        {
+            std::string name = kind;
+            bool stl = (name == "stl");
+            std::string reader = stl ? "ReadStlMesh/" : "ReadPlyMesh/";
+            std::string suffix = (name == "ply-be") ? "-be" : "";
+            std::string assimpName = std::string("MeshReader/assimp-") + kind + "-" + label;
+
+            if (!options.filter.empty() && (reader + "synthetic-" + label + suffix).find(options.filter) == std::string::npos
+                && assimpName.find(options.filter) == std::string::npos)
+                continue;
+
+            std::string filepath = tmpdir + "/hzgl_bench_reader_" + label + suffix + (stl ? ".stl" : ".ply");
+            double items = 0.0, bytes = 0.0;
+
+            {
+                std::vector<float> positions;
+                std::vector<unsigned> indices;
+                syntheticGrid(numTriangles, positions, indices);
+
+                if (!(stl ? writeBinarySTL(filepath, positions, indices) : writeBinaryPLY(filepath, positions, indices, name == "ply-be")))
+                    continue;
+
+                items = static_cast<double>(indices.size() / 3);
+                bytes = stl ? 84.0 + 50.0 * items : positions.size() * sizeof(float) + items * 13.0;
+            }
+
+            tmpfiles.push_back(filepath);
+
+            for (int threads : {0, cullThreads})
+            {
+                auto pool = std::make_shared<std::unique_ptr<hzgl::ThreadPool>>();
+                if (threads > 0)
+                    pool->reset(new hzgl::ThreadPool(threads, 0, "Mesh"));
+
+                BenchCase bench;
+                bench.name = reader + "synthetic-" + label + suffix + (threads > 0 ? "-mt" : "");
+                bench.items = items;
+                bench.bytes = bytes;
+                bench.run = [filepath, pool, stl]() {
+                    hzgl::MeshInfo mesh;
+                    if (stl)
+                        hzgl::ReadStlMesh(filepath, mesh, pool->get());
+                    else
+                        hzgl::ReadPlyMesh(filepath, mesh, pool->get());
+                };
+                cases.push_back(bench);
+            }
+
+            BenchCase bench;
+            bench.name = assimpName;
+            bench.items = items;
+            bench.bytes = bytes;
+            bench.run = [filepath, meshPool]() {
+                std::vector<hzgl::MeshInfo> meshes;
+                hzgl::LoadMeshesFromFile(filepath, meshes, nullptr, false, meshPool->get());
+            };
+            cases.push_back(bench);
+
+            bench.name = "LoadMeshesFromFile/mapped-" + std::string(kind) + "-" + label;
+            bench.run = [filepath, meshPool]() {
+                std::vector<hzgl::MeshInfo> meshes;
+                hzgl::LoadMeshesFromFile(filepath, meshes, nullptr, true, meshPool->get());
+            };
+            cases.push_back(bench);
+        }
+    }
+
+    // glTF: the native reader (parse, then one copy per buffer view as glBufferData would make)
+    // against Assimp on the same file, and a plain read of the file as the floor for both
+    for (int64_t numTriangles : {100000, 1000000, 10000000})
+    {
+        std::string label = triangleLabel(numTriangles);
+        std::string native = "Gltf/open-" + label;
+        std::string assimp = "Gltf/assimp-" + label;
+        std::string raw = "Gltf/read-raw-" + label;
+
+        if (numTriangles > options.max_triangles
+            || (!options.filter.empty() && native.find(options.filter) == std::string::npos && assimp.find(options.filter) == std::string::npos
+                && raw.find(options.filter) == std::string::npos))
+            continue;
+
+        std::string filepath = tmpdir + "/hzgl_bench_gltf_" + label + ".glb";
+        double items = 0.0, bytes = 0.0;
+
+        {
+            std::vector<float> positions;
+            std::vector<unsigned> indices;
+            syntheticGrid(numTriangles, positions, indices);
+
+            if (!writeSyntheticGLB(filepath, positions, indices))
+                continue;
+
+            items = static_cast<double>(indices.size() / 3);
+            bytes = 2.0 * positions.size() * sizeof(float) + indices.size() * sizeof(unsigned);
+        }
+
+        tmpfiles.push_back(filepath);
+
+        // the copies outlive the case, so they cannot be optimized away
+        auto uploads = std::make_shared<std::vector<std::vector<uint8_t>>>();
+
+        BenchCase bench;
+        bench.name = native;
+        bench.items = items;
+        bench.bytes = bytes;
+        bench.run = [filepath, uploads]() {
+            hzgl::GltfAsset asset;
+            asset.Open(filepath);
+
+            uploads->resize(asset.Views().size());
+
+            for (size_t i = 0; i < asset.Views().size(); i++)
+            {
+                const auto& view = asset.Views()[i];
+                (*uploads)[i].resize(view.length);
+                memcpy((*uploads)[i].data(), view.data, view.length);
+            }
+        };
+        cases.push_back(bench);
+
+        auto contents = std::make_shared<std::vector<char>>();
+
+        bench.name = raw;
+        bench.run = [filepath, contents]() {
+            std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+            contents->resize(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(contents->data(), contents->size());
+        };
+        cases.push_back(bench);
+
+        bench.name = assimp;
+        bench.run = [filepath, meshPool]() {
+            std::vector<hzgl::MeshInfo> meshes;
+            hzgl::LoadMeshesFromFile(filepath, meshes, nullptr, true, meshPool->get());
+        };
+        cases.push_back(bench);
+    }
+
+    // point cloud octrees from a binary PLY, with a budget well below the input at 100M and up;
+    // then frames of them at a fixed point budget, with the camera turning a little every frame
+    // so that nodes keep streaming in and out. The octree is built (untimed, in the warm-up run)
+    // by the frame case itself when the build case did not run
+    std::shared_ptr<hzgl::HeadlessContext> context;
+    std::vector<std::shared_ptr<PointFrame>> pointFrames;
+
+    for (int64_t numPoints : {10000000ll, 100000000ll, 1000000000ll})
+    {
+        std::string label = (numPoints >= 1000000000) ? std::to_string(numPoints / 1000000000) + "B" : triangleLabel(numPoints);
+        std::string name = "PointCloud/build-" + label;
+        std::string frameName = "PointCloud/frame-" + label;
+
+        bool wantBuild = options.filter.empty() || name.find(options.filter) != std::string::npos;
+        bool wantFrame = options.filter.empty() || frameName.find(options.filter) != std::string::npos;
+
+        if (numPoints > options.max_points || (!wantBuild && !wantFrame))
+            continue;
+
+        // one context for every frame case; without one they are left out
+        if (wantFrame && context == nullptr)
+        {
+            context = std::make_shared<hzgl::HeadlessContext>();
+
+            if (!hzgl::CreateHeadlessContext(context.get()))
+                std::cerr << "No OpenGL context, the PointCloud/frame cases are skipped" << std::endl;
+        }
+
+        wantFrame = wantFrame && (context->window != nullptr || context->context != nullptr);
+
+        std::string filepath = tmpdir + "/hzgl_bench_points_" + label + ".ply";
+        int64_t bytes = writePointCloudPLY(filepath, numPoints);
+
+        if (bytes == 0)
+            continue;
+
+        tmpfiles.push_back(filepath);
+        tmpfiles.push_back(filepath + ".hzpoints");
+
+        BenchCase bench;
+        bench.name = name;
+        bench.items = static_cast<double>(numPoints);
+        bench.bytes = static_cast<double>(bytes);
+        bench.run = [filepath, cullThreads]() {
+            hzgl::PointBuildOptions build;
+            build.memory_budget_mb = 512;
+            build.threads = cullThreads;
+            hzgl::BuildPointOctree(filepath, filepath + ".hzpoints", build);
+        };
+
+        if (wantBuild)
+            cases.push_back(bench);
+
+        if (!wantFrame)
+            continue;
+
+        auto state = std::make_shared<PointFrame>();
+        pointFrames.push_back(state);
+
+        std::string shaderDir = options.assets + "/shaders";
+
+        bench.name = frameName;
+        bench.items = static_cast<double>(state->point_budget);
+        bench.bytes = 0.0;
+        bench.run = [state, filepath, shaderDir, cullThreads]() {
+            if (state->failed)
+                return;
+
+            if (!state->cloud.IsOpen())
+            {
+                if (!std::ifstream(filepath + ".hzpoints").good())
+                {
+                    hzgl::PointBuildOptions build;
+                    build.memory_budget_mb = 512;
+                    build.threads = cullThreads;
+                    hzgl::BuildPointOctree(filepath, filepath + ".hzpoints", build);
+                }
+
+                hzgl::PointCloudOptions cloudOptions;
+                cloudOptions.point_budget = state->point_budget;
+
+                if (!state->cloud.Init(shaderDir) || !state->cloud.Open(filepath + ".hzpoints", cloudOptions))
+                {
+                    std::cerr << "Failed to open the point octree of " << filepath << std::endl;
+                    state->failed = true;
+                    return;
+                }
+
+                glGenRenderbuffers(2, state->renderbuffers);
+                glBindRenderbuffer(GL_RENDERBUFFER, state->renderbuffers[0]);
+                glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, state->width, state->height);
+                glBindRenderbuffer(GL_RENDERBUFFER, state->renderbuffers[1]);
+                glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, state->width, state->height);
+                glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+                glGenFramebuffers(1, &state->framebuffer);
+                glBindFramebuffer(GL_FRAMEBUFFER, state->framebuffer);
+                glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, state->renderbuffers[0]);
+                glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, state->renderbuffers[1]);
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            }
+
+            glm::vec3 center = state->cloud.Center();
+            float radius = state->cloud.Radius();
+            float angle = 0.002f * static_cast<float>(state->frame++);
+
+            glm::vec3 eye = center + radius * glm::vec3(1.2f * std::cos(angle), 1.2f * std::sin(angle), 0.5f);
+            glm::mat4 view = glm::lookAt(eye, center, glm::vec3(0.0f, 0.0f, 1.0f));
+            glm::mat4 projection = glm::perspective(glm::radians(45.0f), static_cast<float>(state->width) / state->height,
+                                                    0.01f * radius, 10.0f * radius);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, state->framebuffer);
+            glViewport(0, 0, state->width, state->height);
+            glEnable(GL_DEPTH_TEST);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            state->cloud.Update(glm::mat4(1.0f), view, projection, state->height);
+            state->cloud.Draw(view, projection);
+
+            // the frame is done when the GPU is
+            glFinish();
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        };
+        cases.push_back(bench);
+    }
+
+    printf("occlusion rasterizer: %s\n", hzgl::OcclusionSimdPath());
+    printf("scene graph: %s\n", hzgl::SceneSimdPath());
+    printf("IBL SH projection: %s\n", hzgl::IBLSimdPath());
+    printf("mesh reader byte swap: %s\n", hzgl::MappedMeshSimdPath());
+
+    // the IBL cases are only meaningful if the precompute is right
+    bool wantIBL = std::any_of(cases.begin(), cases.end(), [&options](const BenchCase& bench) {
+        return bench.name.rfind("IBL/", 0) == 0 && bench.name.find(options.filter) != std::string::npos;
+    });
+
+    if (wantIBL)
+    {
+        if (!checkIBLReference())
+        {
+            std::cerr << "IBL reference checks failed" << std::endl;
+            return -1;
+        }
+
+        printf("IBL reference checks: passed\n");
+    }
+
+    // and so are the tangent frames
+    bool wantTangents = std::any_of(cases.begin(), cases.end(), [&options](const BenchCase& bench) {
+        return bench.name.rfind("Tangents/", 0) == 0 && bench.name.find(options.filter) != std::string::npos;
+    });
+
+    if (wantTangents)
+    {
+        if (!checkTangentReference())
+        {
+            std::cerr << "Tangent reference checks failed" << std::endl;
+            return -1;
+        }
+
+        printf("Tangent reference checks: passed\n");
+    }
+
+    // and so are the mapped mesh readers
+    bool wantReaders = std::any_of(cases.begin(), cases.end(), [&options](const BenchCase& bench) {
+        return (bench.name.rfind("ReadPlyMesh/", 0) == 0 || bench.name.rfind("ReadStlMesh/", 0) == 0 || bench.name.rfind("MeshReader/", 0) == 0)
+            && bench.name.find(options.filter) != std::string::npos;
+    });
+
+    if (wantReaders)
+    {
+        if (!checkMeshReaderReference(tmpdir))
+        {
+            std::cerr << "Mesh reader reference checks failed" << std::endl;
+            return -1;
+        }
+
+        printf("Mesh reader reference checks: passed\n");
+    }
+
+    // and so is the glTF reader
+    bool wantGltf = std::any_of(cases.begin(), cases.end(), [&options](const BenchCase& bench) {
+        return bench.name.rfind("Gltf/", 0) == 0 && bench.name.find(options.filter) != std::string::npos;
+    });
+
+    if (wantGltf)
+    {
+        if (!checkGltfReference(tmpdir))
+        {
+            std::cerr << "glTF reference checks failed" << std::endl;
+            return -1;
+        }
+
+        printf("glTF reference checks: passed\n");
+    }
+
+    std::vector<BenchResult> results;
+
+    printf("%-44s %8s %12s %14s %10s %12s %10s\n", "benchmark", "iters", "median ms", "items/s", "MB/s", "allocs/iter", "peak MB");
+
+    for (const auto& bench : cases)
+    {
+        if (!options.filter.empty() && bench.name.find(options.filter) == std::string::npos)
+            continue;
+
+        BenchResult r = runCase(bench, options);
+        results.push_back(r);
+
+        printf("%-44s %8d %12.3f %14.0f %10.1f %12.0f %10.1f\n", r.name.c_str(), r.iterations, r.median_ms,
+               r.items_per_s, r.mb_per_s, r.allocs, r.peak_rss_mb);
+        fflush(stdout);
+    }
+
+    // the GL objects go while the context is still there, the files once nothing maps them
+    for (auto& state : pointFrames)
+    {
+        state->cloud.Release();
+        glDeleteFramebuffers(1, &state->framebuffer);
+        glDeleteRenderbuffers(2, state->renderbuffers);
+    }
+
+    pointFrames.clear();
+
+    if (context != nullptr)
+        hzgl::DestroyHeadlessContext(context.get());
+
+    for (const auto& filepath : tmpfiles)
+        std::remove(filepath.c_str());
+
+    if (!options.output.empty())
+    {
+        if (!writeResults(options.output, results))
+        {
+            std::cerr << "Failed to write " << options.output << std::endl;
+            return -1;
+        }
+
+        std::cout << "Results written to " << options.output << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,240 @@
+#include "Batch.hpp"
+
+#include "Mesh.hpp"
+#include "Timer.hpp"
+#include "Profiler.hpp"
+#include "Filesystem.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <algorithm>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#define HZGL_LOG_ERROR(msg) \
+    fprintf(stderr, "[ERROR] %s (line %d): %s\n", __FILE__, __LINE__, msg);
+
+// every vertex position of a parsed model in model space (placed by its node), from the shapes
+// or from a mapped glTF
+template <typename F>
+static void hzglForEachPosition(const hzgl::ParsedModel& model, F f)
+{
+    // parents come first, so one pass composes the world matrices
+    std::vector<glm::mat4> world(model.nodes.size());
+
+    for (size_t i = 0; i < model.nodes.size(); i++)
+    {
+        glm::mat4 local = glm::make_mat4(model.nodes[i].transform);
+        int parent = model.nodes[i].parent;
+        world[i] = (parent >= 0 && parent < static_cast<int>(i)) ? world[parent] * local : local;
+    }
+
+    auto nodeMatrix = [&world](int node) {
+        return (node >= 0 && node < static_cast<int>(world.size())) ? world[node] : glm::mat4(1.0f);
+    };
+
+    for (const auto& shape : model.shapes)
+    {
+        glm::mat4 M = nodeMatrix(shape.node);
+
+        for (size_t i = 0; i + 2 < shape.positions.size(); i += 3)
+            f(glm::vec3(M * glm::vec4(shape.positions[i], shape.positions[i + 1], shape.positions[i + 2], 1.0f)));
+    }
+
+    if (!model.gltf)
+        return;
+
+    for (const auto& primitive : model.gltf->Primitives())
+    {
+        // the ones that need tangents are among the shapes
+        if (hzgl::GltfNeedsTangents(primitive))
+            continue;
+
+        glm::mat4 M = nodeMatrix(primitive.node);
+
+        for (size_t v = 0; v < model.gltf->Accessors()[primitive.position].count; v++)
+        {
+            float p[3];
+            model.gltf->Read(primitive.position, v, p, 3);
+            f(glm::vec3(M * glm::vec4(p[0], p[1], p[2], 1.0f)));
+        }
+    }
+}
+
+// axis-aligned center and the farthest vertex from it
+static void hzglBoundingSphere(const hzgl::ParsedModel& model, glm::vec3* center, float* radius)
+{
+    glm::vec3 lo(INFINITY), hi(-INFINITY);
+
+    hzglForEachPosition(model, [&](const glm::vec3& p) {
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    });
+
+    if (lo.x > hi.x)
+    {
+        *center = glm::vec3(0.0f);
+        *radius = 0.0f;
+        return;
+    }
+
+    *center = 0.5f * (lo + hi);
+
+    float r2 = 0.0f;
+
+    hzglForEachPosition(model, [&](const glm::vec3& p) {
+        glm::vec3 d = p - *center;
+        r2 = std::max(r2, glm::dot(d, d));
+    });
+
+    // a single point still gets a usable frame
+    *radius = std::max(std::sqrt(r2), 1e-6f);
+}
+
+bool hzgl::CollectBatchInputs(const std::string& input, std::vector<std::string>& models)
+{
+    if (IsDirectory(input))
+    {
+        for (const auto& filepath : ListFiles(input, true))
+        {
+            if (IsSupportedMeshFormat(filepath))
+                models.push_back(filepath);
+        }
+
+        return true;
+    }
+
+    std::ifstream manifest(input);
+
+    if (!manifest.is_open())
+    {
+        HZGL_LOG_ERROR("Failed to open the batch manifest.")
+        return false;
+    }
+
+    std::string parent = GetParentPath(input);
+    std::string line;
+
+    while (std::getline(manifest, line))
+    {
+        line = line.substr(0, line.find('#'));
+
+        // trim whitespace (including a trailing '\r')
+        size_t first = line.find_first_not_of(" \t\r");
+        size_t last = line.find_last_not_of(" \t\r");
+
+        if (first == std::string::npos)
+            continue;
+
+        line = line.substr(first, last - first + 1);
+
+        bool absolute = (line[0] == '/' || line[0] == '\\' || (line.size() > 1 && line[1] == ':'));
+        models.push_back((absolute || parent.empty()) ? line : parent + "/" + line);
+    }
+
+    return true;
+}
+
+std::string hzgl::BatchOutputName(const std::string& root, const std::string& modelPath)
+{
+    std::string name = modelPath;
+
+    if (!root.empty() && name.compare(0, root.size(), root) == 0)
+        name = name.substr(root.size());
+
+    std::string ext = GetExtension(name);
+    if (!ext.empty())
+        name = name.substr(0, name.size() - ext.size() - 1);
+
+    // flatten the directory structure so that models with the same file name do not collide
+    std::replace(name.begin(), name.end(), '\\', '/');
+    name.erase(0, name.find_first_not_of("./"));
+    std::replace(name.begin(), name.end(), '/', '_');
+    std::replace(name.begin(), name.end(), ':', '_');
+
+    return name.empty() ? "model" : name;
+}
+
+glm::vec3 hzgl::BatchViewPosition(const BatchViewSpec& spec, int view, float vfov)
+{
+    float azimuth = glm::radians(spec.azimuth + 360.0f * view / std::max(spec.views, 1));
+    float elevation = glm::radians(spec.elevation);
+
+    // close enough for the unit sphere to fill the vertical field of view
+    float distance = spec.margin / std::sin(glm::radians(vfov) / 2.0f);
+
+    return distance * glm::vec3(std::cos(elevation) * std::sin(azimuth),
+                                std::sin(elevation),
+                                std::cos(elevation) * std::cos(azimuth));
+}
+
+hzgl::ModelPrefetcher::ModelPrefetcher(const std::vector<std::string>& paths, int numThreads, int depth)
+    : _paths(paths), _depth(static_cast<size_t>(std::max(depth, 1))), _submitted(0), _consumed(0)
+{
+    _workers.reset(new ThreadPool(std::max(numThreads, 1), 0, "Loader"));
+
+    // the cores the loaders leave free; a loader cannot split its model over its own pool
+    int meshThreads = static_cast<int>(std::thread::hardware_concurrency()) - 1 - std::max(numThreads, 1);
+
+    if (meshThreads > 0)
+        _meshWorkers.reset(new ThreadPool(meshThreads, 0, "Mesh"));
+
+    refill();
+}
+
+hzgl::ModelPrefetcher::~ModelPrefetcher()
+{
+    // finish (and discard) whatever is in flight before the members go away
+    _workers.reset();
+}
+
+void hzgl::ModelPrefetcher::refill()
+{
+    while (_submitted < _paths.size() && _submitted < _consumed + _depth)
+    {
+        size_t index = _submitted++;
+
+        _workers->Submit([this, index]() {
+            HZGL_PROFILE_SCOPE("PrefetchModel");
+
+            SimpleTimer parseTimer;
+            parseTimer.Start();
+
+            BatchItem item;
+            item.index = index;
+            ParseModel(_paths[index], item.model, true, _meshWorkers.get());
+            hzglBoundingSphere(item.model, &item.center, &item.radius);
+            item.parse_ms = 1000.0 * parseTimer.End();
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            _parsed[index] = std::move(item);
+            _ready.notify_all();
+        });
+    }
+}
+
+bool hzgl::ModelPrefetcher::Next(BatchItem& item)
+{
+    if (_consumed >= _paths.size())
+        return false;
+
+    {
+        HZGL_PROFILE_SCOPE("WaitForModel");
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _ready.wait(lock, [this]() { return _parsed.find(_consumed) != _parsed.end(); });
+
+        auto it = _parsed.find(_consumed);
+        item = std::move(it->second);
+        _parsed.erase(it);
+    }
+
+    _consumed++;
+    refill();
+
+    return true;
+}
+
+#undef HZGL_LOG_ERROR
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ThreadPool.hpp"
+#include "ResourceManager.hpp"
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <condition_variable>
+
+#include <glm/glm.hpp>
+
+namespace hzgl
+{
+    typedef struct
+    {
+        int views = 1;               // evenly spaced around the vertical axis
+        float azimuth = 30.0f;       // degrees, direction of the first view
+        float elevation = 20.0f;     // degrees above the horizon
+        float margin = 1.1f;         // > 1 leaves room around the bounding sphere
+    } BatchViewSpec;
+
+    typedef struct
+    {
+        size_t index = 0;            // position in the input list
+        ParsedModel model;
+        glm::vec3 center = glm::vec3(0.0f);
+        float radius = 0.0f;         // bounding sphere, 0 when nothing could be loaded
+        double parse_ms = 0.0;
+    } BatchItem;
+
+    // a directory is searched recursively for formats Assimp can import; any other file is a
+    // manifest with one model path per line (relative to the manifest, '#' starts a comment)
+    bool CollectBatchInputs(const std::string& input, std::vector<std::string>& models);
+
+    // file name for the renders of a model, e.g. root/chairs/a.obj -> "chairs_a"
+    std::string BatchOutputName(const std::string& root, const std::string& modelPath);
+
+    // the model is expected to be fitted into the unit sphere at the origin
+    glm::vec3 BatchViewPosition(const BatchViewSpec& spec, int view, float vfov);
+
+    // parses models on worker threads ahead of the renderer; at most `depth` models are
+    // parsed or waiting at any time, which bounds the CPU memory of the pipeline
+    class ModelPrefetcher
+    {
+    private:
+        std::vector<std::string> _paths;
+        size_t _depth;
+        size_t _submitted;
+        size_t _consumed;
+
+        std::mutex _mutex;
+        std::condition_variable _ready;
+        std::map<size_t, BatchItem> _parsed;
+
+        std::unique_ptr<ThreadPool> _meshWorkers;   // shared by the loaders for large meshes
+        std::unique_ptr<ThreadPool> _workers;       // one model each
+
+        void refill();
+
+    public:
+        ModelPrefetcher(const std::vector<std::string>& paths, int numThreads, int depth);
+        ~ModelPrefetcher();
+
+        ModelPrefetcher(const ModelPrefetcher&) = delete;
+        ModelPrefetcher& operator=(const ModelPrefetcher&) = delete;
+
+        // the next model in input order; blocks until it is parsed, false after the last one
+        bool Next(BatchItem& item);
+    };
+} // namespace hzgl
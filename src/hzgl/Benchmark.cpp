@@ -0,0 +1,317 @@
+#include "Benchmark.hpp"
+
+#include "Filesystem.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+#include "stb_image.h"
+#include "stb_image_write.h"
+
+#define HZGL_LOG_ERROR(msg) \
+    fprintf(stderr, "[ERROR] %s (line %d): %s\n", __FILE__, __LINE__, msg);
+
+// split a line into whitespace separated tokens, keeping "quoted strings" together
+static std::vector<std::string> hzglTokenize(const std::string& line)
+{
+    std::vector<std::string> tokens;
+    std::string current;
+    bool quoted = false;
+
+    for (char c : line)
+    {
+        if (c == '#' && !quoted)
+            break;
+
+        if (c == '"')
+        {
+            quoted = !quoted;
+            continue;
+        }
+
+        if (!quoted && (c == ' ' || c == '\t' || c == '\r'))
+        {
+            if (!current.empty())
+                tokens.push_back(current);
+            current.clear();
+            continue;
+        }
+
+        current += c;
+    }
+
+    if (!current.empty())
+        tokens.push_back(current);
+
+    return tokens;
+}
+
+static double hzglPercentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty())
+        return 0.0;
+
+    // nearest-rank method
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+    rank = std::min(std::max<size_t>(rank, 1), sorted.size());
+
+    return sorted[rank - 1];
+}
+
+static void hzglWriteSummary(FILE* fp, const hzgl::FrameTimeSummary& s)
+{
+    fprintf(fp, "{\"mean\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f}",
+            s.mean, s.min, s.p50, s.p90, s.p95, s.p99, s.max);
+}
+
+static std::string hzglEscape(const std::string& str)
+{
+    std::string escaped;
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+bool hzgl::LoadBenchmarkScript(const std::string& filepath, std::vector<BenchmarkStep>& steps)
+{
+    std::ifstream file(filepath);
+
+    if (!file.is_open())
+    {
+        HZGL_LOG_ERROR("Failed to open the benchmark script.")
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+
+        std::vector<std::string> tokens = hzglTokenize(line);
+        if (tokens.empty())
+            continue;
+
+        if (tokens.size() % 2 != 0)
+        {
+            std::cerr << filepath << ":" << lineNumber << ": expected \"key value\" pairs" << std::endl;
+            return false;
+        }
+
+        BenchmarkStep step;
+        for (size_t i = 0; i < tokens.size(); i += 2)
+        {
+            const std::string& key = tokens[i];
+            const std::string& value = tokens[i + 1];
+
+            if (key == "model")
+                step.model = std::stoi(value);
+            else if (key == "program")
+                step.program = value;
+            else if (key == "shading")
+            {
+                if (value != "forward" && value != "deferred")
+                {
+                    std::cerr << filepath << ":" << lineNumber << ": shading is \"forward\" or \"deferred\"" << std::endl;
+                    return false;
+                }
+
+                step.shading = value;
+            }
+            else if (key == "frames")
+                step.frames = std::max(1, std::stoi(value));
+            else if (key == "orbit")
+                step.orbit_degrees = std::stof(value);
+            else if (key == "radius")
+                step.radius = std::stof(value);
+            else if (key == "height")
+                step.height = std::stof(value);
+            else
+            {
+                std::cerr << filepath << ":" << lineNumber << ": unknown key \"" << key << "\"" << std::endl;
+                return false;
+            }
+        }
+
+        steps.push_back(step);
+    }
+
+    return !steps.empty();
+}
+
+hzgl::FrameTimeSummary hzgl::SummarizeFrameTimes(std::vector<double> frameTimes)
+{
+    FrameTimeSummary summary;
+
+    if (frameTimes.empty())
+        return summary;
+
+    std::sort(frameTimes.begin(), frameTimes.end());
+
+    double sum = 0.0;
+    for (double t : frameTimes)
+        sum += t;
+
+    summary.mean = sum / frameTimes.size();
+    summary.min = frameTimes.front();
+    summary.max = frameTimes.back();
+    summary.p50 = hzglPercentile(frameTimes, 50.0);
+    summary.p90 = hzglPercentile(frameTimes, 90.0);
+    summary.p95 = hzglPercentile(frameTimes, 95.0);
+    summary.p99 = hzglPercentile(frameTimes, 99.0);
+
+    return summary;
+}
+
+hzgl::ImageComparison hzgl::CompareWithGolden(const std::string& goldenPath, const unsigned char* rgba, int width, int height,
+                                              double tolerance, bool updateGolden)
+{
+    ImageComparison result;
+
+    if (updateGolden)
+    {
+        stbi_flip_vertically_on_write(1);
+        result.passed = stbi_write_png(goldenPath.c_str(), width, height, 4, rgba, 4 * width) != 0;
+
+        if (result.passed)
+            std::cout << "Golden image written to " << goldenPath << std::endl;
+        else
+            std::cerr << "Failed to write the golden image " << goldenPath << std::endl;
+
+        return result;
+    }
+
+    // a missing image is a failure, or a broken render would pass the first run and become the
+    // reference for every later one
+    if (!Exists(goldenPath))
+    {
+        std::cerr << "Golden image " << goldenPath << " is missing (--update-golden creates it)" << std::endl;
+        result.passed = false;
+        result.max_diff = 255;
+        result.rmse = 255.0;
+        return result;
+    }
+
+    int w, h, n;
+    stbi_set_flip_vertically_on_load_thread(true);
+    unsigned char* golden = stbi_load(goldenPath.c_str(), &w, &h, &n, 4);
+
+    result.compared = true;
+
+    if (golden == nullptr || w != width || h != height)
+    {
+        std::cerr << "Golden image " << goldenPath << " cannot be read or has a different size" << std::endl;
+        result.passed = false;
+        result.max_diff = 255;
+        result.rmse = 255.0;
+
+        if (golden != nullptr)
+            stbi_image_free(golden);
+
+        return result;
+    }
+
+    // alpha is ignored: it only depends on the clear color
+    double sumSq = 0.0;
+    size_t numPixels = static_cast<size_t>(width) * height;
+
+    for (size_t i = 0; i < numPixels; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            int diff = std::abs(static_cast<int>(rgba[4 * i + c]) - static_cast<int>(golden[4 * i + c]));
+            result.max_diff = std::max(result.max_diff, diff);
+            sumSq += static_cast<double>(diff) * diff;
+        }
+    }
+
+    stbi_image_free(golden);
+
+    result.rmse = std::sqrt(sumSq / (3.0 * numPixels));
+    result.passed = result.rmse <= tolerance;
+
+    return result;
+}
+
+bool hzgl::WriteBenchmarkReport(const std::string& filepath, const BenchmarkReport& report)
+{
+    FILE* fp = fopen(filepath.c_str(), "w");
+
+    if (fp == nullptr)
+    {
+        HZGL_LOG_ERROR("Failed to open the benchmark report.")
+        return false;
+    }
+
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"renderer\": \"%s\",\n", hzglEscape(report.renderer).c_str());
+    fprintf(fp, "  \"version\": \"%s\",\n", hzglEscape(report.version).c_str());
+    fprintf(fp, "  \"resolution\": [%d, %d],\n", report.width, report.height);
+    fprintf(fp, "  \"total_frames\": %d,\n", report.total_frames);
+    fprintf(fp, "  \"wall_time_s\": %.4f,\n", report.wall_time_s);
+    fprintf(fp, "  \"time_to_first_frame_ms\": %.3f,\n", report.time_to_first_frame_ms);
+    fprintf(fp, "  \"parallel_shader_compile\": %s,\n", (report.parallel_shader_compile ? "true" : "false"));
+
+    fprintf(fp, "  \"frame_time_ms\": ");
+    hzglWriteSummary(fp, report.frame_time_ms);
+    fprintf(fp, ",\n");
+
+    fprintf(fp, "  \"load_times_ms\": {");
+    for (size_t i = 0; i < report.load_times_ms.size(); i++)
+    {
+        fprintf(fp, "%s\n    \"%s\": %.3f", (i > 0 ? "," : ""),
+                hzglEscape(report.load_times_ms[i].first).c_str(), report.load_times_ms[i].second);
+    }
+    fprintf(fp, "\n  },\n");
+
+    fprintf(fp, "  \"steps\": [");
+    for (size_t i = 0; i < report.steps.size(); i++)
+    {
+        const auto& s = report.steps[i];
+
+        fprintf(fp, "%s\n    {\n", (i > 0 ? "," : ""));
+        fprintf(fp, "      \"model\": %d,\n", s.step.model);
+        fprintf(fp, "      \"program\": \"%s\",\n", hzglEscape(s.step.program).c_str());
+        fprintf(fp, "      \"shading\": \"%s\",\n", hzglEscape(s.step.shading).c_str());
+        fprintf(fp, "      \"frames\": %d,\n", s.step.frames);
+        fprintf(fp, "      \"draw_calls\": %d,\n", s.draw_stats.draw_calls);
+        fprintf(fp, "      \"triangles\": %lld,\n", static_cast<long long>(s.draw_stats.triangles));
+        fprintf(fp, "      \"points\": %lld,\n", static_cast<long long>(s.draw_stats.points));
+        fprintf(fp, "      \"culled\": %d,\n", s.draw_stats.culled);
+        fprintf(fp, "      \"prepass_draw_calls\": %d,\n", s.draw_stats.prepass_draw_calls);
+        fprintf(fp, "      \"shader_variants\": %d,\n", s.draw_stats.shader_variants);
+        fprintf(fp, "      \"shadow_views_rendered\": %d,\n", s.draw_stats.shadow_views_rendered);
+        fprintf(fp, "      \"shadow_hit_rate\": %.4f,\n", s.draw_stats.shadow_hit_rate);
+        fprintf(fp, "      \"shadow_ms\": %.4f,\n", s.draw_stats.shadow_ms);
+        fprintf(fp, "      \"lights\": %d,\n", s.draw_stats.lights);
+        fprintf(fp, "      \"light_bin_ms\": %.4f,\n", s.draw_stats.light_bin_ms);
+        fprintf(fp, "      \"lights_per_fragment\": %.2f,\n", s.draw_stats.lights_per_fragment);
+        fprintf(fp, "      \"frame_time_ms\": ");
+        hzglWriteSummary(fp, s.frame_time_ms);
+
+        if (s.golden.compared)
+        {
+            fprintf(fp, ",\n      \"golden\": {\"passed\": %s, \"rmse\": %.4f, \"max_diff\": %d}",
+                    s.golden.passed ? "true" : "false", s.golden.rmse, s.golden.max_diff);
+        }
+
+        fprintf(fp, "\n    }");
+    }
+    fprintf(fp, "\n  ]\n}\n");
+
+    fclose(fp);
+
+    return true;
+}
+
+#undef HZGL_LOG_ERROR
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace hzgl
+{
+    // one segment of a scripted run: the camera orbits the selected model
+    typedef struct
+    {
+        int model = 0;               // index into the loaded models
+        std::string program = "";    // program name (empty: keep the current one)
+        std::string shading = "";    // "forward" or "deferred" (empty: keep the current one)
+        int frames = 120;
+        float orbit_degrees = 360.0f;
+        float radius = 3.0f;
+        float height = 0.0f;
+    } BenchmarkStep;
+
+    typedef struct
+    {
+        int draw_calls = 0;
+        int64_t triangles = 0;
+        int64_t points = 0;     // of the point cloud (--points)
+        int culled = 0;         // shapes skipped by occlusion culling
+        int prepass_draw_calls = 0;  // depth-only draws of the depth pre-pass
+        int shader_variants = 0;     // programs the visible shapes were drawn with
+        int shadow_views_rendered = 0;  // shadow map views redrawn, the others came from the atlas
+        double shadow_hit_rate = 0.0;   // cached shadow views since the start
+        double shadow_ms = 0.0;         // shadow pass on the CPU
+        int lights = 0;
+        double light_bin_ms = 0.0;
+        double lights_per_fragment = -1.0;  // sampled from the depth buffer, -1 when unknown
+    } DrawStats;
+
+    typedef struct
+    {
+        double mean = 0.0;
+        double min = 0.0;
+        double p50 = 0.0;
+        double p90 = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    } FrameTimeSummary;
+
+    typedef struct
+    {
+        bool compared = false;  // false when the golden image was (re)written or missing
+        bool passed = true;
+        double rmse = 0.0;      // in 8-bit units
+        int max_diff = 0;
+    } ImageComparison;
+
+    typedef struct
+    {
+        BenchmarkStep step;
+        FrameTimeSummary frame_time_ms;
+        DrawStats draw_stats;   // per frame
+        ImageComparison golden;
+    } BenchmarkStepResult;
+
+    typedef struct
+    {
+        std::string renderer;
+        std::string version;
+        int width = 0;
+        int height = 0;
+        int total_frames = 0;
+        double wall_time_s = 0.0;
+        double time_to_first_frame_ms = 0.0;    // from the start of main(), shaders included
+        bool parallel_shader_compile = false;
+        FrameTimeSummary frame_time_ms;
+        std::vector<std::pair<std::string, double>> load_times_ms;
+        std::vector<BenchmarkStepResult> steps;
+    } BenchmarkReport;
+
+    // each non-empty line describes a step with "key value" pairs, e.g.
+    //   model 1 program "Blinn-Phong Shading" shading deferred frames 240 orbit 360 radius 3 height 0.5
+    bool LoadBenchmarkScript(const std::string& filepath, std::vector<BenchmarkStep>& steps);
+
+    FrameTimeSummary SummarizeFrameTimes(std::vector<double> frameTimes);
+
+    // compare an RGBA8 image (bottom-up, as read by glReadPixels) against a PNG on disk; a missing
+    // golden image fails, updateGolden writes it instead of comparing
+    ImageComparison CompareWithGolden(const std::string& goldenPath, const unsigned char* rgba, int width, int height,
+                                      double tolerance, bool updateGolden = false);
+
+    bool WriteBenchmarkReport(const std::string& filepath, const BenchmarkReport& report);
+} // namespace hzgl
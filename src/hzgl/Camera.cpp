@@ -27,6 +27,21 @@ glm::mat4 hzgl::Camera::GetProjMatrix()
     return glm::perspective(glm::radians(vfov), aspect_ratio, 0.1f, 100.0f);
 }
 
+glm::mat4 hzgl::Camera::GetTileProjMatrix(float x0, float y0, float x1, float y1)
+{
+    // scale and shift the clip space so that the tile fills [-1, 1]
+    float sx = 1.0f / (x1 - x0);
+    float sy = 1.0f / (y1 - y0);
+
+    glm::mat4 crop(1.0f);
+    crop[0][0] = sx;
+    crop[1][1] = sy;
+    crop[3][0] = (1.0f - x0 - x1) * sx;
+    crop[3][1] = (1.0f - y0 - y1) * sy;
+
+    return crop * GetProjMatrix();
+}
+
 void hzgl::Camera::Move(const glm::vec3 direction, float speed, float deltaTime = (1 / 60))
 {
     position += deltaTime * speed * direction;
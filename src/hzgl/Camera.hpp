@@ -13,6 +13,9 @@ namespace hzgl
         glm::mat4 GetViewMatrix();
         glm::mat4 GetProjMatrix();
 
+        // projection of the sub-rectangle [x0, x1] x [y0, y1] of the image (in [0, 1], origin at the bottom left)
+        glm::mat4 GetTileProjMatrix(float x0, float y0, float x1, float y1);
+
         void Move(const glm::vec3 direction, float speed, float deltaTime);
 
     public:
@@ -0,0 +1,322 @@
+#include "Capture.hpp"
+
+#include "Profiler.hpp"
+
+#include <cstdio>
+#include <vector>
+#include <iomanip>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+#define HZGL_LOG_ERROR(msg) \
+    fprintf(stderr, "[ERROR] %s (line %d): %s\n", __FILE__, __LINE__, msg);
+
+// BT.601 limited range, planar 4:4:4, top-down
+static void hzglRGBAToYUV444(const unsigned char* rgba, int width, int height, unsigned char* yuv)
+{
+    size_t planeSize = static_cast<size_t>(width) * height;
+    unsigned char* Y = yuv;
+    unsigned char* U = yuv + planeSize;
+    unsigned char* V = yuv + 2 * planeSize;
+
+    for (int y = 0; y < height; y++)
+    {
+        const unsigned char* row = rgba + static_cast<size_t>(height - 1 - y) * width * 4;
+
+        for (int x = 0; x < width; x++)
+        {
+            int r = row[4 * x + 0];
+            int g = row[4 * x + 1];
+            int b = row[4 * x + 2];
+
+            size_t i = static_cast<size_t>(y) * width + x;
+            Y[i] = static_cast<unsigned char>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+            U[i] = static_cast<unsigned char>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            V[i] = static_cast<unsigned char>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+}
+
+bool hzgl::CaptureFormatFromName(const std::string& name, CaptureFormat* format)
+{
+    if (name == "png")
+        *format = HZGL_CAPTURE_PNG;
+    else if (name == "qoi")
+        *format = HZGL_CAPTURE_QOI;
+    else if (name == "y4m")
+        *format = HZGL_CAPTURE_Y4M;
+    else
+        return false;
+
+    return true;
+}
+
+hzgl::FrameCapture::FrameCapture()
+{
+    _stream = nullptr;
+    _isPipe = false;
+    _nextWrite = 0;
+    _nextFrame = 0;
+    _written = 0;
+    _dropped = 0;
+    _maxQueued = 0;
+    _stall = 0.0;
+}
+
+hzgl::FrameCapture::~FrameCapture()
+{
+    // GL objects are deleted in End(), the context may be gone by now; the encoders still use
+    // the members below, so they finish first
+    if (_encoder != nullptr)
+        _encoder->Wait();
+
+    closeStream();
+}
+
+bool hzgl::FrameCapture::openStream()
+{
+    if (_options.output == "-")
+    {
+        _stream = stdout;
+    }
+    else if (!_options.output.empty() && _options.output[0] == '|')
+    {
+        _stream = popen(_options.output.substr(1).c_str(), "w");
+        _isPipe = true;
+    }
+    else
+    {
+        _stream = fopen(_options.output.c_str(), "wb");
+    }
+
+    if (_stream == nullptr)
+    {
+        HZGL_LOG_ERROR("Failed to open the capture output.")
+        return false;
+    }
+
+    fprintf(_stream, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", _options.width, _options.height, _options.fps);
+
+    return true;
+}
+
+void hzgl::FrameCapture::closeStream()
+{
+    if (_stream == nullptr)
+        return;
+
+    if (_isPipe)
+        pclose(_stream);
+    else if (_stream != stdout)
+        fclose(_stream);
+    else
+        fflush(_stream);
+
+    _stream = nullptr;
+    _isPipe = false;
+}
+
+bool hzgl::FrameCapture::Begin(const CaptureOptions& options)
+{
+    if (IsActive())
+        End();
+
+    _options = options;
+    _options.fps = std::max(1, options.fps);
+
+    if (_options.format == HZGL_CAPTURE_Y4M && !openStream())
+        return false;
+
+    if (_options.format == HZGL_CAPTURE_PNG)
+        SetPNGCompressionLevel(_options.png.compression_level);
+
+    _readback.reset(new AsyncReadback(_options.max_in_flight));
+    _encoder.reset(new ThreadPool(_options.encoder_threads, _options.max_queued, "Encoder"));
+
+    _reorder.clear();
+    _nextWrite = 0;
+    _nextFrame = 0;
+    _written = 0;
+    _dropped = 0;
+    _maxQueued = 0;
+    _stall = 0.0;
+    _timer.Start();
+
+    return true;
+}
+
+double hzgl::FrameCapture::TimeStep() const
+{
+    return 1.0 / _options.fps;
+}
+
+// write every frame that is next in sequence (the stream mutex is held); a dropped frame is an
+// empty entry that is only skipped
+void hzgl::FrameCapture::writeReady()
+{
+    for (auto it = _reorder.find(_nextWrite); it != _reorder.end(); it = _reorder.find(_nextWrite))
+    {
+        if (it->second != nullptr)
+        {
+            fputs("FRAME\n", _stream);
+            fwrite(it->second->data(), 1, it->second->size(), _stream);
+            _written.fetch_add(1);
+        }
+
+        _reorder.erase(it);
+        _nextWrite++;
+    }
+}
+
+void hzgl::FrameCapture::encodeFrame(const ReadbackImage& image)
+{
+    HZGL_PROFILE_SCOPE("EncodeFrame");
+
+    if (_options.format == HZGL_CAPTURE_Y4M)
+    {
+        size_t planeSize = static_cast<size_t>(image.width) * image.height;
+        auto yuv = std::make_shared<std::vector<unsigned char>>(3 * planeSize);
+        hzglRGBAToYUV444(image.pixels->data(), image.width, image.height, yuv->data());
+
+        // whoever completes the next frame in sequence writes every frame that is ready
+        std::lock_guard<std::mutex> lock(_streamMutex);
+        _reorder[image.tag] = yuv;
+        writeReady();
+
+        return;
+    }
+
+    std::ostringstream filepath;
+    filepath << _options.output << "-" << std::setw(5) << std::setfill('0') << image.tag
+             << (_options.format == HZGL_CAPTURE_QOI ? ".qoi" : ".png");
+
+    bool ok = (_options.format == HZGL_CAPTURE_QOI)
+            ? WriteQOI(filepath.str(), image.pixels->data(), image.width, image.height, 4)
+            : WritePNG(filepath.str(), image.pixels->data(), image.width, image.height, 4, _options.png);
+
+    if (ok)
+        _written.fetch_add(1);
+}
+
+// the frames after a lost one would otherwise wait for it forever
+void hzgl::FrameCapture::dropFrame(uint64_t tag)
+{
+    _dropped.fetch_add(1);
+
+    if (_options.format != HZGL_CAPTURE_Y4M)
+        return;
+
+    std::lock_guard<std::mutex> lock(_streamMutex);
+    _reorder[tag] = nullptr;
+    writeReady();
+}
+
+void hzgl::FrameCapture::submit(const ReadbackImage& image)
+{
+    SimpleTimer waitTimer;
+    waitTimer.Start();
+
+    _encoder->Submit([this, image]() { encodeFrame(image); });
+
+    _stall += waitTimer.End();
+    _maxQueued = std::max(_maxQueued, _encoder->QueueDepth());
+}
+
+void hzgl::FrameCapture::CaptureFrame(GLenum readBuffer)
+{
+    HZGL_PROFILE_SCOPE("CaptureFrame");
+
+    if (!IsActive())
+        return;
+
+    std::vector<ReadbackImage> images;
+    std::vector<uint64_t> failed;
+
+    // hand over whatever the GPU has finished without waiting
+    _readback->Collect(images, false, -1, &failed);
+
+    // every slot still in flight: wait for the oldest one
+    if (_readback->NumPending() == _readback->NumSlots())
+    {
+        SimpleTimer waitTimer;
+        waitTimer.Start();
+
+        _readback->Collect(images, true, 1, &failed);
+
+        _stall += waitTimer.End();
+    }
+
+    for (const auto& image : images)
+        submit(image);
+    for (uint64_t tag : failed)
+        dropFrame(tag);
+
+    _readback->Request(0, 0, _options.width, _options.height, readBuffer, _nextFrame++);
+}
+
+hzgl::CaptureStats hzgl::FrameCapture::End()
+{
+    if (!IsActive())
+        return CaptureStats();
+
+    HZGL_PROFILE_SCOPE("FrameCapture::End");
+
+    while (_readback->NumPending() > 0)
+    {
+        std::vector<ReadbackImage> images;
+        std::vector<uint64_t> failed;
+
+        if (_readback->Collect(images, true, 1, &failed) == 0)
+            break;
+
+        for (const auto& image : images)
+            submit(image);
+        for (uint64_t tag : failed)
+            dropFrame(tag);
+    }
+
+    _encoder->Wait();
+
+    CaptureStats stats = Stats();
+
+    _readback->Release();
+    _readback.reset();
+    _encoder.reset();
+
+    closeStream();
+
+    return stats;
+}
+
+bool hzgl::FrameCapture::IsActive() const
+{
+    return _readback != nullptr;
+}
+
+hzgl::CaptureStats hzgl::FrameCapture::Stats() const
+{
+    CaptureStats stats;
+
+    if (!IsActive())
+        return stats;
+
+    stats.frames_captured = static_cast<int>(_nextFrame);
+    stats.frames_written = _written.load();
+    stats.frames_dropped = _dropped.load();
+    stats.elapsed_s = _timer.Now();
+    stats.frames_per_s = (stats.elapsed_s > 0.0) ? stats.frames_written / stats.elapsed_s : 0.0;
+    stats.stall_s = _stall;
+    stats.pending_readbacks = _readback->NumPending();
+    stats.queued_encodes = _encoder->QueueDepth();
+    stats.max_queued_encodes = _maxQueued;
+
+    return stats;
+}
+
+#undef HZGL_LOG_ERROR
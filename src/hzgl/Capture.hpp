@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Image.hpp"
+#include "Timer.hpp"
+#include "Readback.hpp"
+#include "ThreadPool.hpp"
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <cstdio>
+
+#include <glad/glad.h>
+
+namespace hzgl
+{
+    typedef enum
+    {
+        HZGL_CAPTURE_PNG,
+        HZGL_CAPTURE_QOI,
+        HZGL_CAPTURE_Y4M
+    } CaptureFormat;
+
+    typedef struct
+    {
+        CaptureFormat format = HZGL_CAPTURE_PNG;
+
+        // PNG/QOI: file prefix, frames become <output>-00000.png, ...
+        // Y4M: a file path, "-" for stdout, or "|command" to pipe into e.g. ffmpeg
+        std::string output = "frame";
+
+        int width = 1280;
+        int height = 720;
+        int fps = 30;
+        int max_in_flight = 3;    // PBO ring size
+        int max_queued = 16;      // frames waiting for the encoders
+        int encoder_threads = 4;
+        PNGOptions png;
+    } CaptureOptions;
+
+    typedef struct
+    {
+        int frames_captured = 0;
+        int frames_written = 0;
+        int frames_dropped = 0;     // lost in a failed readback
+        double elapsed_s = 0.0;
+        double frames_per_s = 0.0;  // written frames over wall time
+        double stall_s = 0.0;       // time the render thread waited on readbacks or a full queue
+        int pending_readbacks = 0;
+        size_t queued_encodes = 0;
+        size_t max_queued_encodes = 0;
+    } CaptureStats;
+
+    // "png", "qoi" or "y4m"; false for any other name
+    bool CaptureFormatFromName(const std::string& name, CaptureFormat* format);
+
+    // renders are read back through a PBO ring and encoded on a thread pool; frames are not
+    // dropped to keep up, the render thread waits instead (only a failed readback loses its frame)
+    class FrameCapture
+    {
+    private:
+        CaptureOptions _options;
+        std::unique_ptr<AsyncReadback> _readback;
+        std::unique_ptr<ThreadPool> _encoder;
+
+        // Y4M frames are converted in parallel but written in order
+        FILE* _stream;
+        bool _isPipe;
+        std::mutex _streamMutex;
+        std::map<uint64_t, std::shared_ptr<std::vector<unsigned char>>> _reorder;
+        uint64_t _nextWrite;
+
+        uint64_t _nextFrame;
+        std::atomic<int> _written;
+        std::atomic<int> _dropped;
+        size_t _maxQueued;
+        double _stall;
+        mutable SimpleTimer _timer;
+
+        bool openStream();
+        void closeStream();
+        void writeReady();
+        void submit(const ReadbackImage& image);
+        void encodeFrame(const ReadbackImage& image);
+        void dropFrame(uint64_t tag);
+
+    public:
+        FrameCapture();
+        ~FrameCapture();
+
+        FrameCapture(const FrameCapture&) = delete;
+        FrameCapture& operator=(const FrameCapture&) = delete;
+
+        bool Begin(const CaptureOptions& options);
+
+        // simulation time step per frame (1 / fps)
+        double TimeStep() const;
+
+        // read back the current read framebuffer (e.g. GL_COLOR_ATTACHMENT0 of the bound FBO)
+        void CaptureFrame(GLenum readBuffer = GL_COLOR_ATTACHMENT0);
+
+        // wait for every frame to be written and release the PBOs (needs the context; the
+        // destructor does not call it)
+        CaptureStats End();
+
+        bool IsActive() const;
+        CaptureStats Stats() const;
+    };
+} // namespace hzgl
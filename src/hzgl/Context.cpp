@@ -0,0 +1,212 @@
+#include "Context.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <glad/glad.h>
+
+#ifdef HZGL_HAS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#define HZGL_LOG_ERROR(msg) \
+    fprintf(stderr, "[ERROR] %s (line %d): %s\n", __FILE__, __LINE__, msg);
+
+#ifdef HZGL_HAS_EGL
+static bool hzglHasExtension(const char* extensions, const char* name)
+{
+    if (extensions == nullptr)
+        return false;
+
+    size_t length = strlen(name);
+    for (const char* p = strstr(extensions, name); p != nullptr; p = strstr(p + length, name))
+    {
+        if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0'))
+            return true;
+    }
+
+    return false;
+}
+
+static EGLDisplay hzglGetEGLDisplay()
+{
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+    // prefer the surfaceless platform so no X11/Wayland server is needed
+    if (hzglHasExtension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+    {
+        auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+        if (getPlatformDisplay != nullptr)
+        {
+            EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (display != EGL_NO_DISPLAY)
+                return display;
+        }
+    }
+
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+static bool hzglCreateEGLContext(hzgl::HeadlessContext* ctx)
+{
+    EGLDisplay display = hzglGetEGLDisplay();
+
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+        return false;
+
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_ALPHA_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+
+    EGLConfig config;
+    EGLint numConfigs = 0;
+
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || numConfigs == 0 || !eglBindAPI(EGL_OPENGL_API))
+    {
+        eglTerminate(display);
+        return false;
+    }
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 1,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+
+    if (context == EGL_NO_CONTEXT)
+    {
+        eglTerminate(display);
+        return false;
+    }
+
+    // everything is rendered into FBOs, so a 1x1 pbuffer is only needed without EGL_KHR_surfaceless_context
+    EGLSurface surface = EGL_NO_SURFACE;
+
+    if (!hzglHasExtension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context"))
+    {
+        const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+    }
+
+    if (!eglMakeCurrent(display, surface, surface, context))
+    {
+        eglDestroyContext(display, context);
+        eglTerminate(display);
+        return false;
+    }
+
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+    {
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(display, context);
+        eglTerminate(display);
+        return false;
+    }
+
+    ctx->display = display;
+    ctx->context = context;
+    ctx->surface = surface;
+
+    return true;
+}
+#endif
+
+static bool hzglCreateHiddenWindow(hzgl::HeadlessContext* ctx)
+{
+    if (!glfwInit())
+        return false;
+
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    GLFWwindow* window = glfwCreateWindow(1, 1, "OBJ Viewer (headless)", NULL, NULL);
+
+    if (!window)
+    {
+        glfwTerminate();
+        return false;
+    }
+
+    glfwMakeContextCurrent(window);
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return false;
+    }
+
+    ctx->window = window;
+
+    return true;
+}
+
+bool hzgl::CreateHeadlessContext(HeadlessContext* ctx)
+{
+    if (ctx == nullptr)
+        return false;
+
+#ifdef HZGL_HAS_EGL
+    if (hzglCreateEGLContext(ctx))
+    {
+        std::cout << "Created surfaceless EGL context" << std::endl;
+        return true;
+    }
+
+    std::cout << "EGL unavailable, falling back to a hidden GLFW window" << std::endl;
+#endif
+
+    if (hzglCreateHiddenWindow(ctx))
+        return true;
+
+    HZGL_LOG_ERROR("Failed to create a headless OpenGL context.")
+    return false;
+}
+
+void hzgl::DestroyHeadlessContext(HeadlessContext* ctx)
+{
+    if (ctx == nullptr)
+        return;
+
+#ifdef HZGL_HAS_EGL
+    if (ctx->display != nullptr)
+    {
+        eglMakeCurrent(ctx->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+        if (ctx->surface != nullptr)
+            eglDestroySurface(ctx->display, ctx->surface);
+
+        eglDestroyContext(ctx->display, ctx->context);
+        eglTerminate(ctx->display);
+    }
+#endif
+
+    if (ctx->window != nullptr)
+    {
+        glfwDestroyWindow(ctx->window);
+        glfwTerminate();
+    }
+
+    *ctx = HeadlessContext();
+}
+
+#undef HZGL_LOG_ERROR
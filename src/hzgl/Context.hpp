@@ -0,0 +1,21 @@
+#pragma once
+
+#include <GLFW/glfw3.h>
+
+namespace hzgl
+{
+    typedef struct
+    {
+        // EGL handles (surfaceless context, e.g. Mesa llvmpipe)
+        void* display = nullptr;
+        void* context = nullptr;
+        void* surface = nullptr;
+
+        // fallback: an invisible GLFW window
+        GLFWwindow* window = nullptr;
+    } HeadlessContext;
+
+    // create an OpenGL 4.1 Core context without a visible window and load GL functions
+    bool CreateHeadlessContext(HeadlessContext* ctx);
+    void DestroyHeadlessContext(HeadlessContext* ctx);
+} // namespace hzgl
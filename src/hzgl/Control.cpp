@@ -1,7 +1,14 @@
 #include "Control.hpp"
+#include "FrameArena.hpp"
+#include "Filesystem.hpp"
 
 #include <ctime>
+#include <cmath>
+#include <cfloat>
+#include <cstdio>
+#include <cstdint>
 #include <iostream>
+#include <algorithm>
 #include <sstream>
 #include <string>
 
@@ -12,46 +19,6 @@
 #pragma warning(disable : 4996)
 #endif
 
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "stb_image_write.h"
-
-static std::string hzglScreenshotStem()
-{
-    const std::time_t now = std::time(nullptr);
-
-    const std::tm *now_tm = std::localtime(&now);
-
-    int year = now_tm->tm_year + 1900;
-    int month = now_tm->tm_mon + 1;
-    int day = now_tm->tm_mday;
-    int hour = now_tm->tm_hour;
-    int minute = now_tm->tm_min;
-    int second = now_tm->tm_sec;
-
-    std::stringstream timestamp;
-
-    timestamp << "Screenshot"
-              << "-" << year << "-" << month << "-" << day 
-              << "-" << hour << "-" << minute << "-" << second;
-
-    return timestamp.str();
-}
-
-void hzgl::TakeScreenshot(int x, int y, int w, int h)
-{
-    glReadBuffer(GL_FRONT);
-
-    GLubyte *pixels = new GLubyte[4 * w * h];
-    glReadPixels(x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
-
-    std::string stem = hzglScreenshotStem();
-
-    stbi_flip_vertically_on_write(1);
-    stbi_write_png((stem + ".png").c_str(), w, h, 4, pixels, 4 * w);
-
-    delete[] pixels;
-}
-
 void hzgl::ImGuiControl::setStyleOptions()
 {
     ImGuiIO &io = ImGui::GetIO();
@@ -109,12 +76,126 @@ void hzgl::ImGuiControl::helpMarker(const char *desc, bool sameLine)
     }
 }
 
-hzgl::ImGuiControl::ImGuiControl()
+// hash the marker name so it keeps the same color across frames
+static ImU32 hzglMarkerColor(const char* name)
+{
+    uint32_t hash = 2166136261u;
+    for (const char* c = name; *c != '\0'; c++)
+        hash = (hash ^ static_cast<unsigned char>(*c)) * 16777619u;
+
+    return IM_COL32(130 + (hash & 0x7F), 130 + ((hash >> 8) & 0x7F), 130 + ((hash >> 16) & 0x7F), 255);
+}
+
+void hzgl::ImGuiControl::flameGraph(const ProfileFrame& frame)
+{
+    // one lane per thread that recorded something, plus one for the GPU (kept across frames)
+    static std::vector<uint32_t> lanes;
+    static std::vector<uint32_t> laneDepth;
+    static std::vector<bool> laneIsGpu;
+
+    lanes.clear();
+    laneDepth.clear();
+    laneIsGpu.clear();
+
+    uint64_t rangeStart = frame.start_ns;
+    uint64_t rangeEnd = frame.end_ns;
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        const auto& events = (pass == 0) ? frame.cpu_events : frame.gpu_events;
+
+        for (const auto& event : events)
+        {
+            size_t l = 0;
+            while (l < lanes.size() && lanes[l] != event.thread_id)
+                l++;
+
+            if (l == lanes.size())
+            {
+                lanes.push_back(event.thread_id);
+                laneDepth.push_back(0);
+                laneIsGpu.push_back(pass == 1);
+            }
+
+            laneDepth[l] = std::max(laneDepth[l], event.depth + 1);
+            rangeStart = std::min(rangeStart, event.start_ns);
+            rangeEnd = std::max(rangeEnd, event.end_ns);
+        }
+    }
+
+    if (lanes.empty() || rangeEnd <= rangeStart)
+        return;
+
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+
+    float width = ImGui::GetContentRegionAvail().x;
+    float rowHeight = ImGui::GetTextLineHeight() + 2.0f;
+    float scale = width / static_cast<float>(rangeEnd - rangeStart);
+
+    float y = origin.y;
+    for (size_t l = 0; l < lanes.size(); l++)
+    {
+        drawList->AddText(ImVec2(origin.x, y), IM_COL32(80, 80, 80, 255), ProfilerThreadName(lanes[l]));
+        y += rowHeight;
+
+        const auto& events = laneIsGpu[l] ? frame.gpu_events : frame.cpu_events;
+
+        for (const auto& event : events)
+        {
+            if (event.thread_id != lanes[l])
+                continue;
+
+            ImVec2 pMin(origin.x + (event.start_ns - rangeStart) * scale, y + event.depth * rowHeight);
+            ImVec2 pMax(origin.x + (event.end_ns - rangeStart) * scale, pMin.y + rowHeight - 1.0f);
+            pMax.x = std::max(pMax.x, pMin.x + 1.0f);
+
+            drawList->AddRectFilled(pMin, pMax, hzglMarkerColor(event.name));
+
+            // only label the bars that are wide enough for the text
+            if (pMax.x - pMin.x > ImGui::CalcTextSize(event.name).x + 4.0f)
+                drawList->AddText(ImVec2(pMin.x + 2.0f, pMin.y + 1.0f), IM_COL32(20, 20, 20, 255), event.name);
+
+            if (ImGui::IsMouseHoveringRect(pMin, pMax))
+            {
+                if (event.allocations > 0)
+                    ImGui::SetTooltip("%s: %.3f ms, %u allocations", event.name, (event.end_ns - event.start_ns) / 1e6, event.allocations);
+                else
+                    ImGui::SetTooltip("%s: %.3f ms", event.name, (event.end_ns - event.start_ns) / 1e6);
+            }
+        }
+
+        y += laneDepth[l] * rowHeight + 4.0f;
+    }
+
+    ImGui::Dummy(ImVec2(width, y - origin.y));
+}
+
+// the text lives in the frame arena, so the memory panel formats without touching the heap
+static const char* hzglFormatBytes(double bytes)
+{
+    const char* units[] = {"B", "KB", "MB", "GB"};
+
+    int u = 0;
+    while (std::abs(bytes) >= 1024.0 && u < 3)
+    {
+        bytes /= 1024.0;
+        u++;
+    }
+
+    return hzgl::GetFrameArena().Format((u == 0) ? "%.0f %s" : "%.2f %s", bytes, units[u]);
+}
+
+hzgl::ImGuiControl::ImGuiControl() : _isActive(false)
 {
 }
 
 hzgl::ImGuiControl::~ImGuiControl()
 {
+    // nothing to clean up if Init() was never called (e.g. headless mode)
+    if (!_isActive)
+        return;
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -134,6 +215,8 @@ void hzgl::ImGuiControl::Init(GLFWwindow *window, const char *glslVersion)
     // Setup Platform/Renderer backends
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init(glslVersion);
+
+    _isActive = true;
 }
 
 void hzgl::ImGuiControl::BeginFrame(bool fixed_position)
@@ -184,26 +267,26 @@ void hzgl::ImGuiControl::EndFrame()
 
 void hzgl::ImGuiControl::RenderLightInfoWidget(Light& light)
 {
-    std::string btnText = light.isEnabled ? "Disable" : "Enable";
-    btnText += " this light##light-onoff";
+    const char* btnText = light.isEnabled ? "Disable this light##light-onoff" : "Enable this light##light-onoff";
 
     // hide everything if disabled
     if (light.isEnabled)
     {
-        ImGui::Text("Light type: %s", LightTypeName(light.type).c_str());
+        ImGui::Text("Light type: %s", LightTypeName(light.type));
         
-        std::string labelText = (light.type == HZGL_DIRECTIONAL_LIGHT)
+        const char* labelText = (light.type == HZGL_DIRECTIONAL_LIGHT)
                               ? "direction##light-direction"
                               : "position##light-position";
 
         // light position / direction
-        ImGui::DragFloat3(labelText.c_str(), &light.position[0], 0.01f);
+        ImGui::DragFloat3(labelText, &light.position[0], 0.01f);
 
         // light intensities
         ImGui::Text("%s", "Color/Intensities");
         ImGui::ColorEdit3("color##light-color", &light.color[0]);
         helpMarker("the diffuse and specular components are usually the same");
         ImGui::ColorEdit3("ambient##light-ambient", &light.ambient[0]);
+        ImGui::Checkbox("cast shadows##light-shadows", &light.castShadows);
 
         if (light.type == HZGL_POINT_LIGHT || light.type == HZGL_SPOT_LIGHT) {
             ImGui::Text("%s", "Attenuation Factors");
@@ -229,7 +312,7 @@ void hzgl::ImGuiControl::RenderLightInfoWidget(Light& light)
 
     // a button to enable/disable the current light
     ImGui::Spacing();
-    if (ImGui::Button(btnText.c_str(), ImVec2(-1, 0)))
+    if (ImGui::Button(btnText, ImVec2(-1, 0)))
         light.isEnabled = !light.isEnabled;
     ImGui::Spacing();
 }
@@ -242,18 +325,20 @@ void hzgl::ImGuiControl::RenderLightingConfigWidget(std::vector<Light>& lights,
     static int selected = 0;
     bool useFilter = filterType != HZGL_ANY_LIGHT;
 
-    std::vector<int> mapping;
-    std::vector<std::string> lightNames;
+    FrameArena& arena = GetFrameArena();
+
+    int numNames = 0;
+    int* mapping = arena.AllocateArray<int>(lights.size());
+    const char** lightNames = arena.AllocateArray<const char*>(lights.size());
     for (int i = 0; i < lights.size(); i++) 
     {
         if (!useFilter || lights[i].type == filterType) {
-            std::string lName = "#" + std::to_string(i+1) + ": " + LightTypeName(lights[i].type);
-            lightNames.push_back(lName);
-            mapping.push_back(i);
+            lightNames[numNames] = arena.Format("#%d: %s", i+1, LightTypeName(lights[i].type));
+            mapping[numNames++] = i;
         }
     }
     
-    if (lightNames.empty())
+    if (numNames == 0)
         return;
 
     ImGuiTreeNodeFlags flags = 0;
@@ -264,11 +349,11 @@ void hzgl::ImGuiControl::RenderLightingConfigWidget(std::vector<Light>& lights,
     
     if (ImGui::TreeNodeEx("Lighting", flags))
     {
-        if (selected >= lightNames.size())
-            selected = lightNames.size() - 1;
+        if (selected >= numNames)
+            selected = numNames - 1;
 
-        if (lightNames.size() > 1)
-            RenderListBox("Available Lights", lightNames, &selected);
+        if (numNames > 1)
+            RenderListBox("Available Lights", lightNames, numNames, &selected);
 
         RenderLightInfoWidget(lights[mapping[selected]]);
         *lIndex = mapping[selected];
@@ -280,7 +365,7 @@ void hzgl::ImGuiControl::RenderLightingConfigWidget(std::vector<Light>& lights,
 
 void hzgl::ImGuiControl::RenderMaterialInfoWidget(Material& material)
 {
-    ImGui::Text("Material type: %s", MaterialTypeName(material.type).c_str());
+    ImGui::Text("Material type: %s", MaterialTypeName(material.type));
     
     if (material.type == MaterialType::HZGL_PHONG_MATERIAL)
     {
@@ -306,18 +391,20 @@ void hzgl::ImGuiControl::RenderMaterialConfigWidget(std::vector<Material>& mater
     static int selected = 0;
     bool useFilter = filterType != HZGL_ANY_MATERIAL;
 
-    std::vector<int> mapping;
-    std::vector<std::string> materialNames;
+    FrameArena& arena = GetFrameArena();
+
+    int numNames = 0;
+    int* mapping = arena.AllocateArray<int>(materials.size());
+    const char** materialNames = arena.AllocateArray<const char*>(materials.size());
     for (int i = 0; i < materials.size(); i++) 
     {
         if (!useFilter || materials[i].type == filterType) {
-            std::string mName = "#" + std::to_string(i+1) + ": " + MaterialTypeName(materials[i].type);
-            materialNames.push_back(mName);
-            mapping.push_back(i);
+            materialNames[numNames] = arena.Format("#%d: %s", i+1, MaterialTypeName(materials[i].type));
+            mapping[numNames++] = i;
         }
     }
     
-    if (materialNames.empty())
+    if (numNames == 0)
         return;
 
     ImGuiTreeNodeFlags flags = 0;
@@ -328,11 +415,11 @@ void hzgl::ImGuiControl::RenderMaterialConfigWidget(std::vector<Material>& mater
 
     if (ImGui::TreeNodeEx("Materials", flags))
     {
-        if (selected >= materialNames.size())
-            selected = materialNames.size() - 1;
+        if (selected >= numNames)
+            selected = numNames - 1;
         
-        if (materialNames.size() > 1)
-            RenderListBox("Available Materials", materialNames, &selected);
+        if (numNames > 1)
+            RenderListBox("Available Materials", materialNames, numNames, &selected);
 
         RenderMaterialInfoWidget(materials[mapping[selected]]);
         *mIndex = mapping[selected];
@@ -390,10 +477,9 @@ void hzgl::ImGuiControl::RenderModelInfoWidget(const RenderObject& robj)
     for (int i = 0; i < robj.num_shapes; i++)
     {
         const auto& rshape = robj.shapes[i];
-        std::string label = "Mesh " + std::to_string(i+1)
-                          + ": " + rshape.name;
+        const char* label = GetFrameArena().Format("Mesh %d: %s", i+1, rshape.name.c_str());
 
-        if (ImGui::TreeNodeEx(label.c_str()))
+        if (ImGui::TreeNodeEx(label))
         {
             ImGui::Text("OpenGL VAO: %u", rshape.VAO);
 
@@ -402,6 +488,7 @@ void hzgl::ImGuiControl::RenderModelInfoWidget(const RenderObject& robj)
                 ImGui::Text("Number of vertices: %d", rshape.num_vertices);
                 ImGui::Text("Surface normals: %s", rshape.has_normals ? "Yes" : "No");
                 ImGui::Text("Texture coordinates: %s", rshape.has_texcoords ? "Yes" : "No");
+                ImGui::Text("Tangent frames: %s", rshape.has_tangents ? "Yes" : "No");
                 ImGui::TreePop();
             }
 
@@ -425,15 +512,22 @@ void hzgl::ImGuiControl::RenderModelInfoWidget(const RenderObject& robj)
 }
 
 
-void hzgl::ImGuiControl::RenderModelConfigWidget(std::vector<RenderObject>& objects, int* oIndex, bool collapsingHeader) {
-    if (objects.empty())
+void hzgl::ImGuiControl::RenderModelConfigWidget(std::vector<RenderObject>& objects, int* oIndex, const std::string& modelDir,
+                                                  std::string* loadPath, int* unloadIndex, bool collapsingHeader) {
+    if (objects.empty() && loadPath == nullptr)
         return;
 
     static int selected = 0;
+    static int picked = 0;
+    static std::vector<std::string> files;  // listed the first time the browser opens, and on "Rescan"
+    static bool listed = false;
+
+    // models may have been unloaded since the last frame
+    selected = std::min(selected, std::max((int)objects.size() - 1, 0));
 
-    std::vector<std::string> objectPaths;
+    const char** objectPaths = GetFrameArena().AllocateArray<const char*>(objects.size());
     for (int i = 0; i < objects.size(); i++)
-        objectPaths.push_back(objects[i].path);
+        objectPaths[i] = objects[i].path.c_str();
 
     ImGuiTreeNodeFlags flags = 0;
     flags |= ImGuiTreeNodeFlags_DefaultOpen;
@@ -443,12 +537,47 @@ void hzgl::ImGuiControl::RenderModelConfigWidget(std::vector<RenderObject>& obje
 
     if (ImGui::TreeNodeEx("Assets", flags))
     {
-        if (objects.size() > 1)
-            RenderListBox("Available Models", objectPaths, &selected);
+        if (!objects.empty())
+        {
+            if (objects.size() > 1)
+                RenderListBox("Available Models", objectPaths, (int)objects.size(), &selected);
+
+            RenderModelInfoWidget(objects[selected]);
+            *oIndex = selected;
+
+            // its buffers, VAOs and texture references go back to the resource manager
+            if (unloadIndex != nullptr && ImGui::Button("Unload model##assets", ImVec2(-1, 0)))
+                *unloadIndex = selected;
+        }
+
+        if (loadPath != nullptr && ImGui::TreeNodeEx("Browse##assets"))
+        {
+            if (!listed || ImGui::Button("Rescan##assets", ImVec2(-1, 0)))
+            {
+                files.clear();
+                for (const auto& filepath : ListFiles(modelDir, true))
+                {
+                    if (IsSupportedMeshFormat(filepath))
+                        files.push_back(filepath);
+                }
+
+                picked = 0;
+                listed = true;
+            }
+
+            if (files.empty())
+                ImGui::Text("No models under %s", modelDir.c_str());
+            else
+            {
+                RenderListBox("Model Files", files, &picked);
+
+                if (ImGui::Button("Load model##assets", ImVec2(-1, 0)))
+                    *loadPath = files[picked];
+            }
+
+            ImGui::TreePop();
+        }
 
-        RenderModelInfoWidget(objects[selected]);
-        *oIndex = selected;
-        
         if (!collapsingHeader)
             ImGui::TreePop();
     }
@@ -473,9 +602,9 @@ void hzgl::ImGuiControl::RenderShaderProgramConfigWidget(std::vector<ProgramInfo
 
     static int selected = 0;
 
-    std::vector<std::string> programNames;
+    const char** programNames = GetFrameArena().AllocateArray<const char*>(programs.size());
     for (int i = 0; i < programs.size(); i++)
-        programNames.push_back(programs[i].name);
+        programNames[i] = programs[i].name.c_str();
 
     ImGuiTreeNodeFlags flags = 0;
     flags |= ImGuiTreeNodeFlags_DefaultOpen;
@@ -486,7 +615,7 @@ void hzgl::ImGuiControl::RenderShaderProgramConfigWidget(std::vector<ProgramInfo
     if (ImGui::TreeNodeEx("Rendering", flags))
     {
         if (programs.size() > 1)
-            RenderListBox("Available Programs", programNames, &selected);
+            RenderListBox("Available Programs", programNames, (int)programs.size(), &selected);
 
         RenderShaderProgramInfoWidget(programs[selected]);
         *pIndex = selected;
@@ -496,40 +625,83 @@ void hzgl::ImGuiControl::RenderShaderProgramConfigWidget(std::vector<ProgramInfo
     }
 }
 
+void hzgl::ImGuiControl::RenderShaderVariantWidget(const ShaderVariantStats& stats, int drawnWith, bool collapsingHeader)
+{
+    ImGuiTreeNodeFlags flags = 0;
+
+    if (collapsingHeader)
+        flags |= ImGuiTreeNodeFlags_CollapsingHeader;
+
+    if (ImGui::TreeNodeEx("Shader Variants", flags))
+    {
+        ImGui::Text("Variants: %d of %d programs", stats.variants, stats.sources);
+        helpMarker("The lit programs are compiled once per set of features\n"
+                   "(texcoords, base color and normal maps, tangents, shadows,\n"
+                   "environment) that the shapes need, the first time a shape\n"
+                   "needs it or ahead of time from a queue filled when the\n"
+                   "models are loaded");
+
+        ImGui::BulletText("Used for the last frame: %d", drawnWith);
+        ImGui::BulletText("Queued: %d, failed: %d", stats.pending, stats.failed);
+        ImGui::BulletText("Shared by smaller feature sets: %d", stats.shared);
+
+        if (stats.requests > 0)
+            ImGui::BulletText("Cache hit rate: %.2f%%", 100.0 * stats.hits / stats.requests);
+
+        ImGui::BulletText("Compile time: %.1f ms (last %.1f ms)", stats.compile_ms, stats.last_compile_ms);
+
+        ImGui::Spacing();
+
+        if (!collapsingHeader)
+            ImGui::TreePop();
+    }
+}
+
 void hzgl::ImGuiControl::RenderDragMatrix3(const std::string& label, std::vector<float>& mat)
 {
     if (label.empty() || mat.size() != 9)
         return;
 
-    std::string identifier = "##" + label + "-drag-mat3";
+    FrameArena& arena = GetFrameArena();
 
     ImGui::Text("%s", label.c_str());
     helpMarker("shwon in row major order");
 
     ImGui::PushItemWidth(ImGui::GetContentRegionAvailWidth());
-        ImGui::DragFloat3((identifier+"-row1").c_str(), &mat[0], 0.01f, 0.0f, 0.0f, "%.2f");
-        ImGui::DragFloat3((identifier+"-row2").c_str(), &mat[3], 0.01f, 0.0f, 0.0f, "%.2f");
-        ImGui::DragFloat3((identifier+"-row3").c_str(), &mat[6], 0.01f, 0.0f, 0.0f, "%.2f");
+        ImGui::DragFloat3(arena.Format("##%s-drag-mat3-row1", label.c_str()), &mat[0], 0.01f, 0.0f, 0.0f, "%.2f");
+        ImGui::DragFloat3(arena.Format("##%s-drag-mat3-row2", label.c_str()), &mat[3], 0.01f, 0.0f, 0.0f, "%.2f");
+        ImGui::DragFloat3(arena.Format("##%s-drag-mat3-row3", label.c_str()), &mat[6], 0.01f, 0.0f, 0.0f, "%.2f");
     ImGui::PopItemWidth();
 }
 
 void hzgl::ImGuiControl::RenderListBox(const std::string &label, const std::vector<std::string> &options, int *selected)
 {
-    if (options.empty())
+    const char** optionNames = GetFrameArena().AllocateArray<const char*>(options.size());
+    for (int i = 0; i < options.size(); i++)
+        optionNames[i] = options[i].c_str();
+
+    RenderListBox(label.c_str(), optionNames, (int)options.size(), selected);
+}
+
+void hzgl::ImGuiControl::RenderListBox(const char* label, const char* const* options, int count, int* selected)
+{
+    if (count <= 0)
         return;
 
-    std::string identifier = "##" + label + "-listbox";
-    float listBoxHeight = ImGui::GetTextLineHeightWithSpacing() * (options.size() + 2);
+    FrameArena& arena = GetFrameArena();
 
-    if (!label.empty())
-        ImGui::Text("%s", label.c_str());
+    const char* identifier = arena.Format("##%s-listbox", label);
+    float listBoxHeight = ImGui::GetTextLineHeightWithSpacing() * (count + 2);
+
+    if (label[0] != '\0')
+        ImGui::Text("%s", label);
     
     ImGui::SetNextItemWidth(-1);
-    if (ImGui::BeginListBox(identifier.c_str(), ImVec2(0, listBoxHeight)))
+    if (ImGui::BeginListBox(identifier, ImVec2(0, listBoxHeight)))
     {
-        for (int i = 0; i < options.size(); i++)
+        for (int i = 0; i < count; i++)
         {
-            if (ImGui::Selectable((options[i] + identifier).c_str(), (selected && *selected == i)))
+            if (ImGui::Selectable(arena.Format("%s%s", options[i], identifier), (selected && *selected == i)))
             {
                 if (selected != nullptr)
                     *selected = i;
@@ -538,3 +710,574 @@ void hzgl::ImGuiControl::RenderListBox(const std::string &label, const std::vect
         ImGui::EndListBox();
     }
 }
+
+
+void hzgl::ImGuiControl::RenderProfilerWidget(bool collapsingHeader)
+{
+    const ProfileFrame* frame = ProfilerLatestFrame();
+
+    if (frame == nullptr)
+        return;
+
+    ImGuiTreeNodeFlags flags = 0;
+
+    if (collapsingHeader)
+        flags |= ImGuiTreeNodeFlags_CollapsingHeader;
+
+    if (ImGui::TreeNodeEx("Profiler", flags))
+    {
+        static std::vector<float> frameTimes;
+        ProfilerFrameTimes(frameTimes);
+
+        ImGui::Text("Frame %llu: %.2f ms (CPU)", static_cast<unsigned long long>(frame->index),
+                    (frame->end_ns - frame->start_ns) / 1e6);
+        helpMarker("GPU timings are read back a few frames late");
+
+        if (HeapTrackingEnabled())
+        {
+            AllocationCount allocs = LastFrameAllocations();
+            ImGui::Text("Heap allocations: %llu (%s)", static_cast<unsigned long long>(allocs.allocations),
+                        hzglFormatBytes(static_cast<double>(allocs.bytes)));
+            helpMarker("operator new calls of the render thread in the last frame;\n"
+                       "the steady state should not allocate at all");
+        }
+
+        ImGui::SetNextItemWidth(-1);
+        ImGui::PlotLines("##profiler-frame-times", frameTimes.data(), static_cast<int>(frameTimes.size()),
+                         0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 40));
+        ImGui::Spacing();
+
+        flameGraph(*frame);
+        ImGui::Spacing();
+
+        if (ImGui::Button("Export Chrome Trace##profiler-export", ImVec2(-1, 0)))
+            ExportChromeTrace(TimestampStem("Trace") + ".json");
+
+        ImGui::Spacing();
+
+        if (!collapsingHeader)
+            ImGui::TreePop();
+    }
+}
+
+void hzgl::ImGuiControl::RenderMemoryWidget(bool collapsingHeader)
+{
+    ImGuiTreeNodeFlags flags = 0;
+
+    if (collapsingHeader)
+        flags |= ImGuiTreeNodeFlags_CollapsingHeader;
+
+    if (ImGui::TreeNodeEx("Memory", flags))
+    {
+        HeapStats heap = GetHeapStats();
+
+        if (HeapTrackingEnabled())
+        {
+            ImGui::Text("CPU heap: %s (peak %s)", hzglFormatBytes(heap.current_bytes), hzglFormatBytes(heap.peak_bytes));
+            ImGui::Text("Live allocations: %llu", static_cast<unsigned long long>(heap.live_allocations));
+        }
+        else
+        {
+            ImGui::TextDisabled("CPU heap tracking is disabled");
+        }
+
+        ImGui::Text("GPU (estimated): %s", hzglFormatBytes(static_cast<double>(GetTotalGpuBytes())));
+        helpMarker("Sizes are computed from formats and dimensions; drivers may pad or compress");
+
+        for (int t = 0; t < HZGL_GPU_NUM_TYPES; t++)
+        {
+            GpuResourceType type = static_cast<GpuResourceType>(t);
+            ImGui::BulletText("%s: %s", GpuResourceTypeName(type), hzglFormatBytes(static_cast<double>(GetGpuBytes(type))));
+        }
+
+        ImGui::Spacing();
+
+        // the per-resource lists are copied from the registry only when asked for (and when the
+        // panel is first opened), not every frame
+        static std::vector<GpuResourceRecord> resources;
+        static std::vector<LoadMemoryRecord> loads;
+        static bool snapshotTaken = false;
+
+        if (ImGui::Button("Snapshot##memory-snapshot", ImVec2(-1, 0)) || !snapshotTaken)
+        {
+            GetGpuResources(resources);
+            GetLoadMemoryRecords(loads);
+            snapshotTaken = true;
+        }
+        ImGui::TextDisabled("%zu resources, %zu loads at the last snapshot", resources.size(), loads.size());
+
+        // owner -> shape -> resource, relying on the sort order of GetGpuResources()
+        for (size_t i = 0; i < resources.size();)
+        {
+            size_t ownerEnd = i;
+            size_t ownerBytes = 0;
+            while (ownerEnd < resources.size() && resources[ownerEnd].owner == resources[i].owner)
+                ownerBytes += resources[ownerEnd++].bytes;
+
+            bool ownerOpen = ImGui::TreeNode(resources[i].owner.c_str(), "%s (%s)", resources[i].owner.c_str(),
+                                             hzglFormatBytes(static_cast<double>(ownerBytes)));
+
+            for (size_t j = i; ownerOpen && j < ownerEnd;)
+            {
+                size_t shapeEnd = j;
+                size_t shapeBytes = 0;
+                while (shapeEnd < ownerEnd && resources[shapeEnd].shape == resources[j].shape)
+                    shapeBytes += resources[shapeEnd++].bytes;
+
+                bool shapeOpen = true;
+                if (!resources[j].shape.empty())
+                {
+                    shapeOpen = ImGui::TreeNode(resources[j].shape.c_str(), "%s (%s)", resources[j].shape.c_str(),
+                                                hzglFormatBytes(static_cast<double>(shapeBytes)));
+                }
+
+                for (size_t r = j; shapeOpen && r < shapeEnd; r++)
+                {
+                    ImGui::BulletText("%s %s #%u: %s", GpuResourceTypeName(resources[r].type), resources[r].label.c_str(),
+                                      resources[r].id, hzglFormatBytes(static_cast<double>(resources[r].bytes)));
+                }
+
+                if (shapeOpen && !resources[j].shape.empty())
+                    ImGui::TreePop();
+
+                j = shapeEnd;
+            }
+
+            if (ownerOpen)
+                ImGui::TreePop();
+
+            i = ownerEnd;
+        }
+
+        if (!loads.empty() && ImGui::TreeNode("Loads (CPU heap)"))
+        {
+            for (const auto& load : loads)
+            {
+                ImGui::BulletText("%s %s: peak %s, retained %s, %llu allocs", load.kind.c_str(), load.name.c_str(),
+                                  hzglFormatBytes(static_cast<double>(load.heap.peak_bytes)),
+                                  hzglFormatBytes(static_cast<double>(load.heap.retained_bytes)),
+                                  static_cast<unsigned long long>(load.heap.allocations));
+            }
+
+            ImGui::TreePop();
+        }
+
+        ImGui::Spacing();
+
+        if (ImGui::Button("Export JSON##memory-export", ImVec2(-1, 0)))
+            WriteMemoryReport(TimestampStem("Memory") + ".json");
+
+        ImGui::Spacing();
+
+        if (!collapsingHeader)
+            ImGui::TreePop();
+    }
+}
+
+void hzgl::ImGuiControl::RenderLightClustersWidget(std::vector<Light>& lights, size_t numDefaultLights, const ClusterStats& stats, bool* deferred, bool collapsingHeader)
+{
+    ImGuiTreeNodeFlags flags = 0;
+
+    if (collapsingHeader)
+        flags |= ImGuiTreeNodeFlags_CollapsingHeader;
+
+    if (ImGui::TreeNodeEx("Clustered Lighting", flags))
+    {
+        ImGui::Text("Lights: %d (%d global)", stats.lights, stats.global_lights);
+        helpMarker("Local lights are binned into 16 x 9 screen tiles x 24 depth slices;\n"
+                   "a fragment only evaluates the lights of its cluster. Directional\n"
+                   "lights are global and evaluated everywhere");
+
+        ImGui::BulletText("Occupied clusters: %d / %d", stats.occupied_clusters, stats.clusters);
+        ImGui::BulletText("Light indices: %d (at most %d per cluster)", stats.indices, stats.max_per_cluster);
+        ImGui::BulletText("Binning: %.3f ms (%s)", stats.bin_ms, LightClusterSimdPath());
+
+        if (stats.lights_per_fragment >= 0.0)
+            ImGui::BulletText("Lights per fragment: %.2f", stats.lights_per_fragment);
+
+        int path = *deferred ? 1 : 0;
+        ImGui::RadioButton("Forward##shading", &path, 0);
+        ImGui::SameLine();
+        ImGui::RadioButton("Deferred##shading", &path, 1);
+        *deferred = (path == 1);
+        helpMarker("Deferred: the geometry pass writes albedo, metallic/roughness/AO\n"
+                   "(or the Blinn-Phong colors) and an octahedral normal into a\n"
+                   "G-buffer, then a fullscreen pass shades every pixel once.\n"
+                   "Compare the Draw and Lighting GPU times in the profiler");
+
+        if (ImGui::Button("Add 100 point lights##clusters", ImVec2(-1, 0)))
+        {
+            unsigned seed = static_cast<unsigned>(lights.size());
+            AddRandomPointLights(lights, 100, glm::vec3(-3.0f, -1.0f, -3.0f), glm::vec3(3.0f, 2.0f, 3.0f), seed);
+        }
+
+        if (lights.size() > numDefaultLights && ImGui::Button("Remove added lights##clusters", ImVec2(-1, 0)))
+            lights.resize(numDefaultLights);
+
+        ImGui::Spacing();
+
+        if (!collapsingHeader)
+            ImGui::TreePop();
+    }
+}
+
+void hzgl::ImGuiControl::RenderOcclusionWidget(bool* enabled, const OcclusionStats& stats, bool collapsingHeader)
+{
+    ImGuiTreeNodeFlags flags = 0;
+
+    if (collapsingHeader)
+        flags |= ImGuiTreeNodeFlags_CollapsingHeader;
+
+    if (ImGui::TreeNodeEx("Occlusion Culling", flags))
+    {
+        ImGui::Checkbox("Enabled##occlusion", enabled);
+        helpMarker("Large shapes are rasterized into a low-resolution CPU depth buffer and\n"
+                   "the bounding box of every shape is tested against it before drawing");
+
+        if (*enabled)
+        {
+            ImGui::Text("Rasterizer: %s", OcclusionSimdPath());
+            ImGui::BulletText("Occluders: %d (%lld triangles)", stats.occluders, static_cast<long long>(stats.occluder_triangles));
+            ImGui::BulletText("Tested: %d", stats.tested);
+            ImGui::BulletText("Outside the frustum: %d", stats.frustum_culled);
+            ImGui::BulletText("Occluded: %d", stats.occlusion_culled);
+            ImGui::BulletText("Raster: %.3f ms, tests: %.3f ms", stats.raster_ms, stats.test_ms);
+        }
+
+        ImGui::Spacing();
+
+        if (!collapsingHeader)
+            ImGui::TreePop();
+    }
+}
+
+void hzgl::ImGuiControl::RenderDepthPrepassWidget(DepthPrepass& prepass, const std::vector<RenderObject>& objects, bool collapsingHeader)
+{
+    ImGuiTreeNodeFlags flags = 0;
+
+    if (collapsingHeader)
+        flags |= ImGuiTreeNodeFlags_CollapsingHeader;
+
+    if (ImGui::TreeNodeEx("Depth Pre-Pass", flags))
+    {
+        int mode = static_cast<int>(prepass.Mode());
+        ImGui::RadioButton("Off##prepass", &mode, HZGL_PREPASS_OFF);
+        ImGui::SameLine();
+        ImGui::RadioButton("On##prepass", &mode, HZGL_PREPASS_ON);
+        ImGui::SameLine();
+        ImGui::RadioButton("Auto##prepass", &mode, HZGL_PREPASS_AUTO);
+        prepass.SetMode(static_cast<PrepassMode>(mode));
+        helpMarker("Shapes are drawn depth-only from their position stream first, then\n"
+                   "shaded with GL_LEQUAL and depth writes off, so every visible sample\n"
+                   "is shaded once. Auto measures the overdraw of every model with\n"
+                   "occlusion queries every 120 frames and keeps the pre-pass for\n"
+                   "the models above the threshold");
+
+        if (prepass.Mode() == HZGL_PREPASS_AUTO)
+        {
+            float threshold = prepass.Threshold();
+            if (ImGui::SliderFloat("Overdraw threshold##prepass", &threshold, 1.0f, 4.0f, "%.2f"))
+                prepass.SetThreshold(threshold);
+        }
+
+        if (prepass.Mode() != HZGL_PREPASS_OFF)
+        {
+            const PrepassStats& stats = prepass.Stats();
+
+            ImGui::Text("Depth-only draws: %d", stats.draw_calls);
+            ImGui::BulletText("Models with the pre-pass: %d", stats.objects_enabled);
+            ImGui::BulletText("Shaded samples saved: %lld (%.1f%%)", static_cast<long long>(stats.samples_saved), 100.0 * stats.saved_fraction);
+
+            int numObjects = std::min(prepass.NumObjects(), static_cast<int>(objects.size()));
+            for (int o = 0; o < numObjects; o++)
+            {
+                const PrepassObjectStats& object = prepass.ObjectStats(o);
+
+                if (object.overdraw > 0.0)
+                    ImGui::BulletText("%s: overdraw %.2fx%s", objects[o].path.c_str(), object.overdraw, (object.enabled ? " (pre-pass)" : ""));
+            }
+        }
+
+        ImGui::Spacing();
+
+        if (!collapsingHeader)
+            ImGui::TreePop();
+    }
+}
+
+void hzgl::ImGuiControl::RenderShadowWidget(bool* enabled, const ShadowStats& stats, bool collapsingHeader)
+{
+    ImGuiTreeNodeFlags flags = 0;
+
+    if (collapsingHeader)
+        flags |= ImGuiTreeNodeFlags_CollapsingHeader;
+
+    if (ImGui::TreeNodeEx("Shadows", flags))
+    {
+        ImGui::Checkbox("Enabled##shadows", enabled);
+        helpMarker("Cascades for directional lights, six faces for point lights and one view\n"
+                   "for spot lights, packed into one depth atlas. A view is only redrawn\n"
+                   "when its light (or the camera, for cascades) moves or a shape moves\n"
+                   "inside it; \"cast shadows\" in the light settings leaves a light out");
+
+        if (*enabled)
+        {
+            ImGui::Text("Atlas: %d x %d, %.0f%% in use", stats.atlas_size, stats.atlas_size, 100.0 * stats.atlas_usage);
+            ImGui::BulletText("Lights: %d (%d did not fit)", stats.lights, stats.dropped_lights);
+            ImGui::BulletText("Views: %d, redrawn: %d, cached: %d", stats.views, stats.rendered, stats.cached);
+            ImGui::BulletText("Cache hit rate: %.1f%%", 100.0 * stats.hit_rate);
+            ImGui::BulletText("Depth-only draws: %d", stats.draw_calls);
+
+            if (stats.gpu_ms >= 0.0)
+                ImGui::BulletText("CPU: %.3f ms, GPU: %.3f ms (last redraw)", stats.cpu_ms, stats.gpu_ms);
+            else
+                ImGui::BulletText("CPU: %.3f ms", stats.cpu_ms);
+        }
+
+        ImGui::Spacing();
+
+        if (!collapsingHeader)
+            ImGui::TreePop();
+    }
+}
+
+void hzgl::ImGuiControl::RenderEnvironmentWidget(EnvironmentLighting& environment, bool collapsingHeader)
+{
+    ImGuiTreeNodeFlags flags = 0;
+
+    if (collapsingHeader)
+        flags |= ImGuiTreeNodeFlags_CollapsingHeader;
+
+    if (ImGui::TreeNodeEx("Environment Lighting", flags))
+    {
+        if (!environment.IsLoaded())
+        {
+            ImGui::Text("%s", "No environment (--env file.hdr)");
+        }
+        else
+        {
+            bool enabled = environment.Enabled();
+            if (ImGui::Checkbox("Enabled##environment", &enabled))
+                environment.SetEnabled(enabled);
+            helpMarker("SH9 irradiance, a GGX-prefiltered mip chain and the split-sum BRDF\n"
+                       "LUT replace the constant ambient term of the PBR programs");
+
+            float intensity = environment.Intensity();
+            if (ImGui::SliderFloat("Intensity##environment", &intensity, 0.0f, 4.0f, "%.2f"))
+                environment.SetIntensity(intensity);
+
+            const IBLStats& stats = environment.Stats();
+
+            ImGui::Text("%s", environment.Path().c_str());
+            ImGui::BulletText("Maps: %s, LUT: %s", (stats.environment_cached ? "cached" : "computed"), (stats.lut_cached ? "cached" : "computed"));
+            ImGui::BulletText("Total: %.1f ms (hash %.1f ms)", stats.total_ms, stats.hash_ms);
+
+            if (!stats.environment_cached)
+                ImGui::BulletText("Decode %.1f ms, SH (%s) %.1f ms, prefilter %.1f ms", stats.decode_ms, IBLSimdPath(), stats.sh_ms, stats.prefilter_ms);
+            if (!stats.lut_cached)
+                ImGui::BulletText("BRDF LUT %.1f ms", stats.lut_ms);
+
+            ImGui::BulletText("Cache hit rate: %.0f%%", 100.0 * environment.CacheHitRate());
+        }
+
+        ImGui::Spacing();
+
+        if (!collapsingHeader)
+            ImGui::TreePop();
+    }
+}
+
+void hzgl::ImGuiControl::RenderSceneWidget(std::vector<SceneInstance>& instances, SceneGraph& graph, const std::vector<RenderObject>& objects,
+                                           const std::vector<Material>& materials, int oIndex, int mIndex, bool collapsingHeader)
+{
+    if (objects.empty() || instances.empty())
+        return;
+
+    static int selected = 1;
+
+    ImGuiTreeNodeFlags flags = 0;
+
+    if (collapsingHeader)
+        flags |= ImGuiTreeNodeFlags_CollapsingHeader;
+
+    if (ImGui::TreeNodeEx("Scene", flags))
+    {
+        const SceneStats& stats = graph.Stats();
+
+        ImGui::Text("Instances: %d", static_cast<int>(instances.size()));
+        helpMarker("The first instance is the selected model; the others keep their own\n"
+                   "model, material and transform");
+
+        ImGui::Text("Nodes: %d in %d levels (%s)", stats.nodes, stats.levels, SceneSimdPath());
+        ImGui::BulletText("Last update: %d nodes, %.3f ms", stats.updated, stats.update_ms);
+        ImGui::BulletText("Levels split across threads: %d", stats.parallel_levels);
+
+        if (ImGui::Button("Add instance##scene", ImVec2(-1, 0)))
+        {
+            SceneInstance instance;
+            instance.object = oIndex;
+            instance.material = mIndex;
+            instance.position = glm::vec3(1.5f * instances.size(), 0.0f, 0.0f);
+
+            instances.push_back(instance);
+            selected = static_cast<int>(instances.size()) - 1;
+        }
+
+        if (ImGui::Button("Add 10 x 10 grid##scene", ImVec2(-1, 0)))
+            AddInstanceGrid(instances, oIndex, mIndex, 10, 1.5f);
+
+        if (instances.size() > 1 && ImGui::Button("Remove all##scene", ImVec2(-1, 0)))
+        {
+            for (size_t i = 1; i < instances.size(); i++)
+                graph.RemoveSubtree(instances[i].root);
+
+            instances.resize(1);
+        }
+
+        if (instances.size() > 1)
+        {
+            ImGui::Spacing();
+
+            int last = static_cast<int>(instances.size()) - 1;
+            selected = std::min(std::max(selected, 1), last);
+            ImGui::SliderInt("Instance##scene", &selected, 1, last);
+
+            SceneInstance& instance = instances[selected];
+            if (instance.object >= 0 && instance.object < static_cast<int>(objects.size()))
+                ImGui::Text("Model: %s", objects[instance.object].path.c_str());
+
+            // only an edited instance has its matrix rebuilt
+            if (ImGui::DragFloat3("Position##scene", &instance.position[0], 0.01f, 0.0f, 0.0f, "%.2f"))
+                instance.dirty = true;
+            if (ImGui::DragFloat3("Rotation##scene", &instance.rotation[0], 1.0f, -180.0f, 180.0f, "%.0f"))
+                instance.dirty = true;
+            if (ImGui::DragFloat("Scale##scene", &instance.scale, 0.01f, 0.01f, 100.0f, "%.2f"))
+                instance.dirty = true;
+
+            FrameArena& arena = GetFrameArena();
+
+            const char** materialNames = arena.AllocateArray<const char*>(materials.size());
+            for (size_t i = 0; i < materials.size(); i++)
+                materialNames[i] = arena.Format("#%d: %s", static_cast<int>(i) + 1, MaterialTypeName(materials[i].type));
+
+            ImGui::Combo("Material##scene", &instance.material, materialNames, static_cast<int>(materials.size()));
+
+            if (ImGui::Button("Remove instance##scene", ImVec2(-1, 0)))
+            {
+                graph.RemoveSubtree(instance.root);
+                instances.erase(instances.begin() + selected);
+            }
+        }
+
+        ImGui::Spacing();
+
+        if (!collapsingHeader)
+            ImGui::TreePop();
+    }
+}
+
+void hzgl::ImGuiControl::RenderFramePacingWidget(bool* onDemand, bool* turntable, const UtilizationStats& stats, unsigned lastDirty, bool collapsingHeader)
+{
+    ImGuiTreeNodeFlags flags = 0;
+
+    if (collapsingHeader)
+        flags |= ImGuiTreeNodeFlags_CollapsingHeader;
+
+    if (ImGui::TreeNodeEx("Frame Pacing", flags))
+    {
+        ImGui::Checkbox("Render on demand", onDemand);
+        helpMarker("Only draw after a change (camera, lights, materials, program, model,\n"
+                   "input or window events); otherwise sleep until the next event");
+
+        ImGui::Checkbox("Turntable", turntable);
+        helpMarker("The rotating model keeps every frame dirty");
+
+        ImGui::Text("Drawn: %.1f fps", stats.fps);
+        ImGui::BulletText("CPU: %.1f%% of one core", stats.cpu_percent);
+        ImGui::BulletText("GPU: %.1f%%", stats.gpu_percent);
+        char reasons[128];
+        FormatDirtyFlags(lastDirty, reasons, sizeof(reasons));
+        ImGui::TextWrapped("Last frame: %s", reasons);
+
+        ImGui::Spacing();
+
+        if (!collapsingHeader)
+            ImGui::TreePop();
+    }
+}
+
+void hzgl::ImGuiControl::RenderStreamingWidget(MeshStreamer& streamer, bool collapsingHeader)
+{
+    ImGuiTreeNodeFlags flags = 0;
+    flags |= ImGuiTreeNodeFlags_DefaultOpen;
+
+    if (collapsingHeader)
+        flags |= ImGuiTreeNodeFlags_CollapsingHeader;
+
+    if (ImGui::TreeNodeEx("Streaming", flags))
+    {
+        const StreamingStats& stats = streamer.Stats();
+
+        ImGui::TextWrapped("%s", streamer.Path().c_str());
+
+        float pixelError = streamer.PixelError();
+        if (ImGui::SliderFloat("Pixel error", &pixelError, 0.5f, 16.0f, "%.1f px"))
+            streamer.SetPixelError(pixelError);
+        helpMarker("Every chunk is drawn at the coarsest level whose error, projected to\n"
+                   "the screen, stays below this; the GPU budget may force coarser ones");
+
+        ImGui::Text("Chunks: %d, visible: %d, drawn: %d", stats.chunks, stats.visible, stats.drawn);
+        ImGui::BulletText("Triangles: %lld", static_cast<long long>(stats.drawn_triangles));
+        ImGui::BulletText("Resident: %d (%.1f MB on the GPU)", stats.resident, stats.gpu_bytes / (1024.0 * 1024.0));
+        ImGui::BulletText("In flight: %d (%.1f MB)", stats.in_flight, stats.in_flight_bytes / (1024.0 * 1024.0));
+        ImGui::BulletText("Loads: %lld, evictions: %lld", static_cast<long long>(stats.loads), static_cast<long long>(stats.evictions));
+        ImGui::BulletText("Coarser for the budget: %lld", static_cast<long long>(stats.budget_limited));
+        ImGui::BulletText("Read: %.3f ms per chunk, update: %.3f ms", stats.read_ms, stats.update_ms);
+
+        ImGui::Spacing();
+
+        if (!collapsingHeader)
+            ImGui::TreePop();
+    }
+}
+
+void hzgl::ImGuiControl::RenderPointCloudWidget(PointCloud& pointCloud, bool collapsingHeader)
+{
+    ImGuiTreeNodeFlags flags = 0;
+    flags |= ImGuiTreeNodeFlags_DefaultOpen;
+
+    if (collapsingHeader)
+        flags |= ImGuiTreeNodeFlags_CollapsingHeader;
+
+    if (ImGui::TreeNodeEx("Point Cloud", flags))
+    {
+        const PointCloudStats& stats = pointCloud.Stats();
+        PointCloudOptions& options = pointCloud.Options();
+
+        ImGui::TextWrapped("%s", pointCloud.Path().c_str());
+
+        // the GPU budget is raised on the next update to hold what is drawn
+        int budget = static_cast<int>(options.point_budget / 1000);
+        if (ImGui::SliderInt("Point budget", &budget, 100, 100000, "%dk"))
+            options.point_budget = static_cast<int64_t>(budget) * 1000;
+        helpMarker("Points drawn per frame at most, the nodes that cover\n"
+                   "the most of the screen come first");
+
+        ImGui::SliderFloat("Min spacing", &options.min_spacing, 0.5f, 8.0f, "%.1f px");
+        helpMarker("Finer nodes are loaded until the points are this\n"
+                   "close on the screen");
+        ImGui::SliderFloat("Point scale", &options.point_scale, 0.5f, 4.0f, "%.2f");
+
+        ImGui::Text("Nodes: %d, drawn: %d", stats.nodes, stats.drawn);
+        ImGui::BulletText("Points: %lld%s", static_cast<long long>(stats.drawn_points), stats.budget_limited ? " (budget reached)" : "");
+        ImGui::BulletText("Resident: %d (%.1f MB on the GPU)", stats.resident, stats.gpu_bytes / (1024.0 * 1024.0));
+        ImGui::BulletText("In flight: %d (%.1f MB)", stats.in_flight, stats.in_flight_bytes / (1024.0 * 1024.0));
+        ImGui::BulletText("Loads: %lld, evictions: %lld", static_cast<long long>(stats.loads), static_cast<long long>(stats.evictions));
+        ImGui::BulletText("Read: %.3f ms per node, update: %.3f ms", stats.read_ms, stats.update_ms);
+
+        ImGui::Spacing();
+
+        if (!collapsingHeader)
+            ImGui::TreePop();
+    }
+}
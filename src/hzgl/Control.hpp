@@ -3,6 +3,19 @@
 #include "Light.hpp"
 #include "Camera.hpp"
 #include "Material.hpp"
+#include "Memory.hpp"
+#include "Profiler.hpp"
+#include "Occlusion.hpp"
+#include "LightClusters.hpp"
+#include "DepthPrepass.hpp"
+#include "Shadows.hpp"
+#include "Environment.hpp"
+#include "ShaderVariants.hpp"
+#include "Scene.hpp"
+#include "FrameScheduler.hpp"
+#include "Screenshot.hpp"
+#include "Streaming.hpp"
+#include "PointCloud.hpp"
 #include "ResourceManager.hpp"
 
 #include <GLFW/glfw3.h>
@@ -13,8 +26,6 @@
 
 namespace hzgl
 {
-    void TakeScreenshot(int x, int y, int w, int h);
-
     class ImGuiControl {
     private:
         bool _isActive;
@@ -24,6 +35,7 @@ namespace hzgl
 
         // render control widgets
         void helpMarker(const char* desc, bool sameLine = true);
+        void flameGraph(const ProfileFrame& frame);
 
     public:
         ImGuiControl();
@@ -38,7 +50,10 @@ namespace hzgl
         void RenderCameraWidget(Camera& camera);
 
         void RenderModelInfoWidget(const RenderObject& robj);
-        void RenderModelConfigWidget(std::vector<RenderObject>& objects, int* oIndex, bool collapsingHeader = true);
+        // "Unload" and "Load" only ask, the caller acts after the frame: *unloadIndex is the model
+        // to drop (-1 for none), *loadPath a file picked under modelDir (empty for none)
+        void RenderModelConfigWidget(std::vector<RenderObject>& objects, int* oIndex, const std::string& modelDir = "",
+                                     std::string* loadPath = nullptr, int* unloadIndex = nullptr, bool collapsingHeader = true);
 
         void RenderLightInfoWidget(Light& light);
         void RenderLightingConfigWidget(std::vector<Light>& lights, int* lIndex, LightType filterType = HZGL_ANY_LIGHT, bool collapsingHeader = true);
@@ -48,9 +63,24 @@ namespace hzgl
         
         void RenderShaderProgramInfoWidget(ProgramInfo& program);
         void RenderShaderProgramConfigWidget(std::vector<ProgramInfo>& programs, int* pIndex, bool collapsingHeader = true);
+        void RenderShaderVariantWidget(const ShaderVariantStats& stats, int drawnWith, bool collapsingHeader = true);
+
+        void RenderProfilerWidget(bool collapsingHeader = true);
+        void RenderMemoryWidget(bool collapsingHeader = true);
+        void RenderLightClustersWidget(std::vector<Light>& lights, size_t numDefaultLights, const ClusterStats& stats, bool* deferred, bool collapsingHeader = true);
+        void RenderOcclusionWidget(bool* enabled, const OcclusionStats& stats, bool collapsingHeader = true);
+        void RenderDepthPrepassWidget(DepthPrepass& prepass, const std::vector<RenderObject>& objects, bool collapsingHeader = true);
+        void RenderShadowWidget(bool* enabled, const ShadowStats& stats, bool collapsingHeader = true);
+        void RenderEnvironmentWidget(EnvironmentLighting& environment, bool collapsingHeader = true);
+        void RenderSceneWidget(std::vector<SceneInstance>& instances, SceneGraph& graph, const std::vector<RenderObject>& objects,
+                               const std::vector<Material>& materials, int oIndex, int mIndex, bool collapsingHeader = true);
+        void RenderFramePacingWidget(bool* onDemand, bool* turntable, const UtilizationStats& stats, unsigned lastDirty, bool collapsingHeader = true);
+        void RenderStreamingWidget(MeshStreamer& streamer, bool collapsingHeader = true);
+        void RenderPointCloudWidget(PointCloud& pointCloud, bool collapsingHeader = true);
 
         // wrapper around Dear ImGui
         void RenderDragMatrix3(const std::string& label, std::vector<float>& mat);
         void RenderListBox(const std::string& label, const std::vector<std::string>& options, int* selected = nullptr);
+        void RenderListBox(const char* label, const char* const* options, int count, int* selected = nullptr);
     };
 } // namespace hzgl
@@ -0,0 +1,238 @@
+#include "Deferred.hpp"
+
+#include "Shader.hpp"
+#include "Profiler.hpp"
+#include "ShaderVariants.hpp"
+
+#include <vector>
+#include <iostream>
+
+hzgl::DeferredRenderer::DeferredRenderer()
+    : _geometryProgram(0), _emptyVAO(0), _target(0), _viewport(0), _models(0), _finished(false), _linked(false)
+{
+    _gbuffer.id = 0;
+    _gbuffer.width = 0;
+    _gbuffer.height = 0;
+    _gbuffer.depth_attachment = 0;
+    _gbuffer.stencil_attachment = 0;
+    _gbuffer.depth_texture = 0;
+
+    for (int m = 0; m < 2; m++)
+    {
+        _lightingPrograms[m][0] = 0;
+        _lightingPrograms[m][1] = 0;
+    }
+}
+
+hzgl::DeferredRenderer::~DeferredRenderer()
+{
+    // GL objects are deleted in Release(), the context may be gone by now
+}
+
+bool hzgl::DeferredRenderer::Init(const std::string& shaderDir)
+{
+    // kept out of the ResourceManager, they are not meant to be picked in the GUI; nothing waits
+    // for them before Finish()
+    _geometryStages = {
+        {GL_VERTEX_SHADER, shaderDir + "/phong.vert"},
+        {GL_FRAGMENT_SHADER, shaderDir + "/deferred_gbuffer.frag"},
+    };
+    _geometryProgram = SubmitShaderProgram(_geometryStages);
+
+    // the lighting passes come with and without the environment, picked like the forward variants
+    const char* lighting[2] = {"/deferred_phong.frag", "/deferred_pbr.frag"};
+    std::string fullscreen = ReadShaderSource(shaderDir + "/fullscreen.vert");
+
+    for (int m = 0; m < 2; m++)
+    {
+        std::string fragment = ReadShaderSource(shaderDir + lighting[m]);
+
+        for (int ibl = 0; ibl < 2; ibl++)
+        {
+            std::vector<std::string> defines;
+            if (ibl == 1)
+                defines.push_back(ShaderFeatureDefine(HZGL_FEATURE_IBL));
+
+            _lightingPrograms[m][ibl] = LinkShaderProgram({
+                CreateShaderFromSource(fullscreen, GL_VERTEX_SHADER),
+                CreateShaderFromSource(InjectDefines(fragment, defines), GL_FRAGMENT_SHADER),
+            }, true);
+        }
+    }
+
+    glGenVertexArrays(1, &_emptyVAO);
+
+    _finished = false;
+    _linked = false;
+
+    return _emptyVAO != 0;
+}
+
+bool hzgl::DeferredRenderer::Finish()
+{
+    if (_finished)
+        return _linked;
+
+    _finished = true;
+    _linked = true;
+
+    for (GLuint program : {_geometryProgram, _lightingPrograms[0][0], _lightingPrograms[0][1],
+                           _lightingPrograms[1][0], _lightingPrograms[1][1]})
+        _linked = FinishShaderProgram(program) && _linked;
+
+    if (!_linked)
+        std::cerr << "Failed to build the deferred shading programs." << std::endl;
+
+    return _linked;
+}
+
+GLuint hzgl::DeferredRenderer::BeginGeometry()
+{
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &_target);
+    glGetIntegerv(GL_VIEWPORT, &_viewport[0]);
+    _models = 0;
+
+    // one texel per pixel of the viewport, recreated when the window (or a tile) changes size
+    if (_gbuffer.id == 0 || _gbuffer.width != _viewport[2] || _gbuffer.height != _viewport[3])
+    {
+        if (_gbuffer.id != 0)
+            DeleteFBO(&_gbuffer);
+
+        CreateFBO(_viewport[2], _viewport[3], {
+            {GL_TEXTURE_2D, GL_RGBA8, GL_COLOR_ATTACHMENT0},
+            {GL_TEXTURE_2D, GL_RGBA8, GL_COLOR_ATTACHMENT1},
+            {GL_TEXTURE_2D, GL_RGBA8, GL_COLOR_ATTACHMENT2},
+            {GL_TEXTURE_2D, GL_RG16, GL_COLOR_ATTACHMENT3},
+            {GL_TEXTURE_2D, GL_DEPTH_COMPONENT24, GL_DEPTH_ATTACHMENT},
+        }, &_gbuffer);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, _gbuffer.id);
+    glViewport(0, 0, _gbuffer.width, _gbuffer.height);
+
+    // the clear color has to stay out of the G-buffer, empty pixels are found by their depth
+    GLfloat clearColor[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+
+    glUseProgram(_geometryProgram);
+
+    return _geometryProgram;
+}
+
+GLuint hzgl::DeferredRenderer::GeometryProgram() const
+{
+    return _geometryProgram;
+}
+
+const std::vector<hzgl::ShaderStage>& hzgl::DeferredRenderer::GeometryStages() const
+{
+    return _geometryStages;
+}
+
+void hzgl::DeferredRenderer::SetupMaterial(GLuint program, const Material& material)
+{
+    hzgl::SetupMaterial(program, material, "uMaterial");
+    glUniform1i(glGetUniformLocation(program, "uShadingModel"), (material.type == HZGL_PBR_MATERIAL ? 1 : 0));
+
+    _models |= 1u << material.type;
+}
+
+void hzgl::DeferredRenderer::Resolve(LightClusters& clusters, const ShadowAtlas& shadows, const EnvironmentLighting& environment,
+                                     const glm::mat4& view, const glm::mat4& projection, const glm::vec3& eyePosition)
+{
+    HZGL_PROFILE_GPU_SCOPE("Lighting");
+
+    glBindFramebuffer(GL_FRAMEBUFFER, _target);
+    glViewport(_viewport[0], _viewport[1], _viewport[2], _viewport[3]);
+
+    const char* samplers[5] = {"uGBuffer0", "uGBuffer1", "uGBuffer2", "uGBufferNormal", "uGBufferDepth"};
+    GLuint textures[5] = {_gbuffer.color_attachment[0], _gbuffer.color_attachment[1], _gbuffer.color_attachment[2],
+                          _gbuffer.color_attachment[3], _gbuffer.depth_texture};
+
+    for (int i = 0; i < 5; i++)
+    {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+
+    glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+
+    // every covered pixel passes, its depth comes from the G-buffer
+    GLint depthFunc = GL_LESS;
+    glGetIntegerv(GL_DEPTH_FUNC, &depthFunc);
+    glDepthFunc(GL_ALWAYS);
+
+    glBindVertexArray(_emptyVAO);
+
+    // each program discards the pixels of the other shading model
+    const MaterialType models[2] = {HZGL_PHONG_MATERIAL, HZGL_PBR_MATERIAL};
+    int ibl = (environment.Enabled() && environment.IsLoaded()) ? 1 : 0;
+
+    for (int m = 0; m < 2; m++)
+    {
+        if ((_models & (1u << models[m])) == 0)
+            continue;
+
+        GLuint program = _lightingPrograms[m][ibl];
+        glUseProgram(program);
+
+        for (int i = 0; i < 5; i++)
+            glUniform1i(glGetUniformLocation(program, samplers[i]), i);
+
+        // the lighting pass covers the same viewport, so the cluster lookup stays the same
+        clusters.Bind(program, _viewport);
+        shadows.Bind(program);
+        environment.Bind(program);
+
+        glUniformMatrix4fv(glGetUniformLocation(program, "uInverseViewProjection"), 1, GL_FALSE, &inverseViewProjection[0][0]);
+        glUniform3fv(glGetUniformLocation(program, "uEyePosition"), 1, &eyePosition[0]);
+
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+
+    glBindVertexArray(0);
+
+    glDepthFunc(depthFunc);
+
+    for (int i = 0; i < 5; i++)
+    {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+}
+
+const hzgl::FrameBufferInfo& hzgl::DeferredRenderer::GBuffer() const
+{
+    return _gbuffer;
+}
+
+void hzgl::DeferredRenderer::Release()
+{
+    if (_gbuffer.id != 0)
+        DeleteFBO(&_gbuffer);
+
+    for (GLuint* program : {&_geometryProgram, &_lightingPrograms[0][0], &_lightingPrograms[0][1],
+                            &_lightingPrograms[1][0], &_lightingPrograms[1][1]})
+    {
+        if (*program != 0)
+            DeleteShaderProgram(*program);
+
+        *program = 0;
+    }
+
+    if (_emptyVAO != 0)
+        glDeleteVertexArrays(1, &_emptyVAO);
+
+    _emptyVAO = 0;
+    _finished = true;
+    _linked = false;
+    _gbuffer.width = 0;
+    _gbuffer.height = 0;
+}
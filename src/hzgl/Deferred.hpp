@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Material.hpp"
+#include "Framebuffer.hpp"
+#include "LightClusters.hpp"
+#include "Shadows.hpp"
+#include "Environment.hpp"
+#include "Shader.hpp"
+
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+namespace hzgl
+{
+    // deferred shading: the geometry pass writes the material of the closest surface into a
+    // G-buffer, then a fullscreen triangle shades every covered pixel once with the clustered
+    // lights. Layout (20 bytes per pixel):
+    //   color0  RGBA8    albedo/diffuse, ao (PBR) or shininess / 256 (Blinn-Phong)
+    //   color1  RGBA8    metallic, roughness (PBR) or specular (Blinn-Phong)
+    //   color2  RGBA8    ambient (Blinn-Phong), shading model (0: Blinn-Phong, 1: PBR)
+    //   color3  RG16     octahedral normal
+    //   depth   DEPTH24  world position is reconstructed from it
+    class DeferredRenderer
+    {
+    private:
+        FrameBufferInfo _gbuffer;
+        std::vector<ShaderStage> _geometryStages;
+        GLuint _geometryProgram;          // the variant without features, see GeometryStages()
+        GLuint _lightingPrograms[2][2];   // Blinn-Phong, PBR; without, with HZGL_HAS_IBL
+        GLuint _emptyVAO;                 // the fullscreen triangle comes from gl_VertexID
+
+        // what was bound before the geometry pass, the lighting pass draws into it
+        GLint _target;
+        glm::ivec4 _viewport;
+        unsigned _models;                 // bit per MaterialType written this frame
+
+        bool _finished;                   // the link status of the programs was asked for
+        bool _linked;
+
+    public:
+        DeferredRenderer();
+        ~DeferredRenderer();
+
+        DeferredRenderer(const DeferredRenderer&) = delete;
+        DeferredRenderer& operator=(const DeferredRenderer&) = delete;
+
+        // submit the programs from the shaders in shaderDir (needs a context), the driver can
+        // build them while the models load
+        bool Init(const std::string& shaderDir);
+
+        // wait for the programs the first time, then only report whether they all linked; the
+        // caller draws forward instead when they did not
+        bool Finish();
+
+        // bind the G-buffer (resized to the current viewport) and the geometry program, which
+        // takes Model/View/Projection/Normal like the forward programs; only after Finish()
+        GLuint BeginGeometry();
+
+        // the geometry program without features and its stages, which test for the same map
+        // and tangent defines as the forward programs; register them with a ShaderVariantCache
+        // to draw textured, normal-mapped or QTangent shapes (the maps go to the units in
+        // ShaderVariants.hpp)
+        GLuint GeometryProgram() const;
+        const std::vector<ShaderStage>& GeometryStages() const;
+
+        // the material of the next shapes drawn into the G-buffer, of either shading model
+        void SetupMaterial(GLuint program, const Material& material);
+
+        // shade the G-buffer into the framebuffer and viewport that were bound before
+        // BeginGeometry, one pass per shading model that was drawn (with the IBL variant when
+        // the environment is on, as in the forward path); depth is written as well, so depth
+        // readbacks keep working
+        void Resolve(LightClusters& clusters, const ShadowAtlas& shadows, const EnvironmentLighting& environment,
+                     const glm::mat4& view, const glm::mat4& projection, const glm::vec3& eyePosition);
+
+        const FrameBufferInfo& GBuffer() const;
+
+        // delete the GL objects (needs the context that created them)
+        void Release();
+    };
+} // namespace hzgl
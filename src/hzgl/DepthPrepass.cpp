@@ -0,0 +1,343 @@
+#include "DepthPrepass.hpp"
+
+#include "Shader.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+const char* hzgl::PrepassModeName(PrepassMode mode)
+{
+    switch (mode)
+    {
+        case HZGL_PREPASS_OFF:
+            return "off";
+        case HZGL_PREPASS_ON:
+            return "on";
+        case HZGL_PREPASS_AUTO:
+            return "auto";
+        default:
+            return "unknown";
+    }
+}
+
+hzgl::DepthPrepass::DepthPrepass(PrepassMode mode, float threshold, int probeInterval)
+    : _mode(mode), _threshold(threshold), _probeInterval(std::max(probeInterval, 1)), _frame(0),
+      _program(0), _modelLocation(-1), _finished(false), _probing(false), _runObject(-1),
+      _shadingObject(-1), _shadingPrepass(false)
+{
+}
+
+hzgl::DepthPrepass::~DepthPrepass()
+{
+    // GL objects are deleted in Release(), the context may be gone by now
+}
+
+bool hzgl::DepthPrepass::Init(const std::string& shaderDir)
+{
+    // no fragment shader: only depth is written
+    _program = SubmitShaderProgram({
+        {GL_VERTEX_SHADER, shaderDir + "/depth_only.vert"},
+    });
+    _finished = false;
+
+    return _program != 0;
+}
+
+// the driver builds the program while the models load, it is only waited for when first needed
+bool hzgl::DepthPrepass::finishProgram()
+{
+    if (_finished)
+        return _program != 0;
+
+    _finished = true;
+
+    if (_program == 0)
+        return false;
+
+    if (!FinishShaderProgram(_program))
+    {
+        std::cerr << "Failed to build the depth pre-pass program." << std::endl;
+        DeleteShaderProgram(_program);
+        _program = 0;
+        return false;
+    }
+
+    _modelLocation = glGetUniformLocation(_program, "Model");
+
+    return true;
+}
+
+void hzgl::DepthPrepass::SetMode(PrepassMode mode)
+{
+    // measure right away when switching to a mode that reports savings
+    if (mode != _mode)
+        _frame = 0;
+
+    _mode = mode;
+}
+
+hzgl::PrepassMode hzgl::DepthPrepass::Mode() const
+{
+    return _mode;
+}
+
+void hzgl::DepthPrepass::SetThreshold(float threshold)
+{
+    _threshold = std::max(threshold, 1.0f);
+
+    for (auto& object : _objects)
+        object.enabled = (object.overdraw >= _threshold);
+}
+
+float hzgl::DepthPrepass::Threshold() const
+{
+    return _threshold;
+}
+
+void hzgl::DepthPrepass::BeginFrame(int numObjects)
+{
+    // objects that were not there at the last probe are measured as soon as possible
+    if ((int)_objects.size() < numObjects)
+    {
+        _objects.resize(numObjects);
+        _frame = 0;
+    }
+
+    if (!_runs.empty())
+    {
+        // the last query finishes last
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(_runs.back().query, GL_QUERY_RESULT_AVAILABLE, &available);
+
+        if (available == GL_TRUE)
+            collectProbe();
+    }
+
+    _probing = (_mode != HZGL_PREPASS_OFF && finishProgram() && _runs.empty() && _frame % _probeInterval == 0);
+    _frame += 1;
+
+    _stats.draw_calls = 0;
+    _runObject = -1;
+    _shadingObject = -1;
+    _shadingPrepass = false;
+}
+
+bool hzgl::DepthPrepass::Enabled(int object) const
+{
+    if (!_finished || _program == 0 || _mode == HZGL_PREPASS_OFF)
+        return false;
+
+    if (_mode == HZGL_PREPASS_ON || _probing)
+        return true;
+
+    return object >= 0 && object < (int)_objects.size() && _objects[object].enabled;
+}
+
+void hzgl::DepthPrepass::BeginDepthPass(const glm::mat4& view, const glm::mat4& projection)
+{
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+    glUseProgram(_program);
+    glUniformMatrix4fv(glGetUniformLocation(_program, "View"), 1, GL_FALSE, &view[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(_program, "Projection"), 1, GL_FALSE, &projection[0][0]);
+}
+
+void hzgl::DepthPrepass::DrawDepth(int object, const RenderShape& shape, const glm::mat4& world)
+{
+    if (_probing && object != _runObject)
+    {
+        endRun();
+        beginRun(object, 0);
+    }
+
+    glUniformMatrix4fv(_modelLocation, 1, GL_FALSE, &world[0][0]);
+
+    glBindVertexArray(shape.depthVAO);
+    glDrawElements(GL_TRIANGLES, shape.num_indices, shape.index_type, (void*)shape.index_offset);
+
+    _stats.draw_calls += 1;
+}
+
+void hzgl::DepthPrepass::EndDepthPass()
+{
+    endRun();
+
+    glBindVertexArray(0);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+void hzgl::DepthPrepass::ShadeObject(int object)
+{
+    if (object == _shadingObject)
+        return;
+
+    _shadingObject = object;
+    bool prepass = Enabled(object);
+
+    if (_probing)
+    {
+        endRun();
+
+        if (prepass)
+            beginRun(object, 1);
+    }
+
+    // the depth buffer already holds the closest surface, only samples on it pass
+    if (prepass != _shadingPrepass)
+    {
+        glDepthFunc(prepass ? GL_LEQUAL : GL_LESS);
+        glDepthMask(prepass ? GL_FALSE : GL_TRUE);
+        _shadingPrepass = prepass;
+    }
+}
+
+void hzgl::DepthPrepass::EndShading()
+{
+    endRun();
+
+    if (_shadingPrepass)
+    {
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
+
+    _shadingObject = -1;
+    _shadingPrepass = false;
+}
+
+void hzgl::DepthPrepass::beginRun(int object, int pass)
+{
+    if (_runs.size() == _queryPool.size())
+    {
+        GLuint query;
+        glGenQueries(1, &query);
+        _queryPool.push_back(query);
+    }
+
+    GLuint query = _queryPool[_runs.size()];
+    glBeginQuery(GL_SAMPLES_PASSED, query);
+
+    _runs.push_back({object, pass, query});
+    _runObject = object;
+}
+
+void hzgl::DepthPrepass::endRun()
+{
+    if (_runObject < 0)
+        return;
+
+    glEndQuery(GL_SAMPLES_PASSED);
+    _runObject = -1;
+}
+
+void hzgl::DepthPrepass::collectProbe()
+{
+    // depth and shaded samples per object, summed over its instances
+    _samples.assign(2 * _objects.size(), 0);
+
+    for (const auto& run : _runs)
+    {
+        GLuint64 samples = 0;
+        glGetQueryObjectui64v(run.query, GL_QUERY_RESULT, &samples);
+
+        if (run.object >= 0 && run.object < (int)_objects.size())
+            _samples[2 * run.object + run.pass] += static_cast<int64_t>(samples);
+    }
+
+    _runs.clear();
+
+    int64_t depthTotal = 0;
+    int64_t saved = 0;
+    int enabled = 0;
+
+    for (size_t o = 0; o < _objects.size(); o++)
+    {
+        int64_t depthSamples = _samples[2 * o];
+        int64_t shadedSamples = _samples[2 * o + 1];
+
+        // not drawn during the probe, keep what was measured before
+        if (depthSamples == 0)
+            continue;
+
+        auto& object = _objects[o];
+        object.depth_samples = depthSamples;
+        object.shaded_samples = shadedSamples;
+        object.overdraw = static_cast<double>(depthSamples) / std::max<int64_t>(shadedSamples, 1);
+        object.enabled = (object.overdraw >= _threshold);
+
+        if (_mode == HZGL_PREPASS_ON || object.enabled)
+        {
+            depthTotal += depthSamples;
+            saved += depthSamples - shadedSamples;
+            enabled += 1;
+        }
+    }
+
+    _stats.probes += 1;
+    _stats.objects_enabled = enabled;
+    _stats.samples_saved = saved;
+    _stats.saved_fraction = (depthTotal > 0) ? static_cast<double>(saved) / depthTotal : 0.0;
+}
+
+void hzgl::DepthPrepass::RemoveObject(int object)
+{
+    if (object < 0 || object >= (int)_objects.size())
+        return;
+
+    _objects.erase(_objects.begin() + object);
+
+    for (auto& run : _runs)
+    {
+        if (run.object == object)
+            run.object = -1;
+        else if (run.object > object)
+            run.object -= 1;
+    }
+}
+
+void hzgl::DepthPrepass::Clear()
+{
+    _objects.clear();
+
+    for (auto& run : _runs)
+        run.object = -1;
+
+    _stats.objects_enabled = 0;
+    _stats.samples_saved = 0;
+    _stats.saved_fraction = 0.0;
+}
+
+const hzgl::PrepassObjectStats& hzgl::DepthPrepass::ObjectStats(int object) const
+{
+    static const PrepassObjectStats unmeasured = PrepassObjectStats();
+
+    if (object < 0 || object >= (int)_objects.size())
+        return unmeasured;
+
+    return _objects[object];
+}
+
+int hzgl::DepthPrepass::NumObjects() const
+{
+    return static_cast<int>(_objects.size());
+}
+
+const hzgl::PrepassStats& hzgl::DepthPrepass::Stats() const
+{
+    return _stats;
+}
+
+void hzgl::DepthPrepass::Release()
+{
+    if (!_queryPool.empty())
+        glDeleteQueries(static_cast<GLsizei>(_queryPool.size()), _queryPool.data());
+
+    if (_program != 0)
+        DeleteShaderProgram(_program);
+
+    _queryPool.clear();
+    _runs.clear();
+    _program = 0;
+    _probing = false;
+    _runObject = -1;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "ResourceManager.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+namespace hzgl
+{
+    enum PrepassMode
+    {
+        HZGL_PREPASS_OFF,
+        HZGL_PREPASS_ON,
+        HZGL_PREPASS_AUTO           // per object, when the measured overdraw pays for the extra pass
+    };
+
+    // samples counted with occlusion queries during the last probe of an object
+    typedef struct
+    {
+        int64_t depth_samples = 0;      // passing the depth test in draw order: what a single pass shades
+        int64_t shaded_samples = 0;     // left for the shading pass after the pre-pass (the visible ones)
+        double overdraw = 0.0;          // depth_samples / shaded_samples, 0 until measured
+        bool enabled = false;           // decision of the auto mode
+    } PrepassObjectStats;
+
+    typedef struct
+    {
+        int probes = 0;                 // frames that measured every object
+        int objects_enabled = 0;
+        int draw_calls = 0;             // depth-only draws of the last frame
+        int64_t samples_saved = 0;      // shading work avoided by the enabled objects in the last probe
+        double saved_fraction = 0.0;    // of the samples they would have shaded without the pre-pass
+    } PrepassStats;
+
+    const char* PrepassModeName(PrepassMode mode);
+
+    // depth-only pre-pass through the position-only VAO of every shape, followed by a shading
+    // pass that tests with GL_LEQUAL and leaves the depth buffer alone, so every visible sample
+    // is shaded once. In auto mode, every probeInterval frames all objects go through both passes
+    // with occlusion queries around them, and the pre-pass stays on for the objects whose
+    // overdraw is at least threshold. Query results are read a few frames later without stalling.
+    class DepthPrepass
+    {
+    private:
+        typedef struct
+        {
+            int object;
+            int pass;                   // 0: depth, 1: shading
+            GLuint query;
+        } QueryRun;
+
+        PrepassMode _mode;
+        float _threshold;
+        int _probeInterval;
+        int _frame;
+
+        GLuint _program;
+        GLint _modelLocation;
+        bool _finished;                 // the link status of _program was asked for
+
+        bool _probing;                  // queries are issued this frame
+        std::vector<GLuint> _queryPool;
+        std::vector<QueryRun> _runs;    // in flight, read back once the last one is available
+        int _runObject;                 // object of the open query, -1 when none is open
+
+        int _shadingObject;             // object of the last ShadeObject(), -1 outside the shading pass
+        bool _shadingPrepass;
+
+        std::vector<PrepassObjectStats> _objects;
+        std::vector<int64_t> _samples;  // scratch for the results of one probe, two per object
+        PrepassStats _stats;
+
+        bool finishProgram();
+        void beginRun(int object, int pass);
+        void endRun();
+        void collectProbe();
+
+    public:
+        DepthPrepass(PrepassMode mode = HZGL_PREPASS_AUTO, float threshold = 1.3f, int probeInterval = 120);
+        ~DepthPrepass();
+
+        DepthPrepass(const DepthPrepass&) = delete;
+        DepthPrepass& operator=(const DepthPrepass&) = delete;
+
+        // submit the depth-only program from shaderDir (needs a context); it is finished by the
+        // first BeginFrame(), and the pre-pass stays off if it failed to build
+        bool Init(const std::string& shaderDir);
+
+        void SetMode(PrepassMode mode);
+        PrepassMode Mode() const;
+        void SetThreshold(float threshold);
+        float Threshold() const;
+
+        // once per drawn view, before anything else: picks up finished probes and decides
+        // whether this frame measures
+        void BeginFrame(int numObjects);
+
+        // true when the shapes of object go through the pre-pass this frame
+        bool Enabled(int object) const;
+
+        // depth-only pass: color writes are off until EndDepthPass()
+        void BeginDepthPass(const glm::mat4& view, const glm::mat4& projection);
+        void DrawDepth(int object, const RenderShape& shape, const glm::mat4& world);
+        void EndDepthPass();
+
+        // shading pass: switches the depth test for the shapes of each object, in draw order
+        void ShadeObject(int object);
+        void EndShading();
+
+        // an unloaded object: the ones after it move down one index, its queries in flight are
+        // left out of the probe
+        void RemoveObject(int object);
+
+        // every object unloaded at once: the next ones start unmeasured and are probed on their
+        // first frame, the queries in flight are left out of the probe
+        void Clear();
+
+        const PrepassObjectStats& ObjectStats(int object) const;
+        int NumObjects() const;
+        const PrepassStats& Stats() const;
+
+        // delete the GL objects (needs the context that created them)
+        void Release();
+    };
+} // namespace hzgl
@@ -0,0 +1,164 @@
+#include "Environment.hpp"
+
+#include "Memory.hpp"
+#include "Profiler.hpp"
+
+#include <iostream>
+#include <algorithm>
+
+hzgl::EnvironmentLighting::EnvironmentLighting()
+    : _prefiltered(0), _brdfLut(0), _levels(0), _enabled(true), _intensity(1.0f), _cacheHits(0), _cacheLookups(0)
+{
+    for (int k = 0; k < 9; k++)
+        _sh[k] = glm::vec3(0.0f);
+}
+
+hzgl::EnvironmentLighting::~EnvironmentLighting()
+{
+    // GL objects are deleted in Release(), the context may be gone by now
+}
+
+bool hzgl::EnvironmentLighting::Load(const std::string& hdrPath, const std::string& cacheDir, const IBLOptions& options)
+{
+    HZGL_PROFILE_SCOPE("EnvironmentLighting::Load");
+
+    IBLData data;
+    IBLStats stats;
+
+    if (!PrecomputeIBL(hdrPath, cacheDir, options, &data, &stats))
+    {
+        std::cerr << "Failed to load the environment " << hdrPath << std::endl;
+        return false;
+    }
+
+    Release();
+
+    // every roughness level is a mip level, sampled with textureLod(roughness * (levels - 1))
+    glGenTextures(1, &_prefiltered);
+    glBindTexture(GL_TEXTURE_2D, _prefiltered);
+
+    size_t bytes = 0;
+    _levels = static_cast<int>(data.prefiltered.size());
+
+    for (int k = 0; k < _levels; k++)
+    {
+        const HDRImage& level = data.prefiltered[k];
+        glTexImage2D(GL_TEXTURE_2D, k, GL_RGB16F, level.width, level.height, 0, GL_RGB, GL_FLOAT, level.pixels.data());
+        bytes += EstimateTextureBytes(GL_RGB16F, level.width, level.height);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, _levels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    TrackGpuResource({HZGL_GPU_TEXTURE, _prefiltered, bytes, "Environment", hdrPath, "prefiltered"});
+
+    glGenTextures(1, &_brdfLut);
+    glBindTexture(GL_TEXTURE_2D, _brdfLut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, data.lut_size, data.lut_size, 0, GL_RG, GL_FLOAT, data.brdf_lut.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    TrackGpuResource({HZGL_GPU_TEXTURE, _brdfLut, EstimateTextureBytes(GL_RG16F, data.lut_size, data.lut_size),
+                      "Environment", "", "BRDF LUT"});
+
+    for (int k = 0; k < 9; k++)
+        _sh[k] = data.sh[k];
+
+    _path = hdrPath;
+    _stats = stats;
+    _cacheLookups += 2;
+    _cacheHits += (stats.environment_cached ? 1 : 0) + (stats.lut_cached ? 1 : 0);
+
+    std::cout << "Environment " << hdrPath << ": " << stats.total_ms << " ms"
+              << " (maps " << (stats.environment_cached ? "cached" : "computed")
+              << ", LUT " << (stats.lut_cached ? "cached" : "computed")
+              << "; SH " << stats.sh_ms << " ms, prefilter " << stats.prefilter_ms << " ms, LUT " << stats.lut_ms << " ms"
+              << "; cache hit rate " << 100.0 * CacheHitRate() << "%)" << std::endl;
+
+    return true;
+}
+
+bool hzgl::EnvironmentLighting::IsLoaded() const
+{
+    return _prefiltered != 0;
+}
+
+void hzgl::EnvironmentLighting::SetEnabled(bool enabled)
+{
+    _enabled = enabled;
+}
+
+bool hzgl::EnvironmentLighting::Enabled() const
+{
+    return _enabled;
+}
+
+void hzgl::EnvironmentLighting::SetIntensity(float intensity)
+{
+    _intensity = std::max(intensity, 0.0f);
+}
+
+float hzgl::EnvironmentLighting::Intensity() const
+{
+    return _intensity;
+}
+
+const std::string& hzgl::EnvironmentLighting::Path() const
+{
+    return _path;
+}
+
+const hzgl::IBLStats& hzgl::EnvironmentLighting::Stats() const
+{
+    return _stats;
+}
+
+double hzgl::EnvironmentLighting::CacheHitRate() const
+{
+    return (_cacheLookups > 0) ? static_cast<double>(_cacheHits) / _cacheLookups : 0.0;
+}
+
+void hzgl::EnvironmentLighting::Bind(GLuint program, int firstUnit) const
+{
+    glUniform1f(glGetUniformLocation(program, "uIBLIntensity"), _intensity);
+    glUniform1f(glGetUniformLocation(program, "uIBLMaxLod"), static_cast<float>(std::max(_levels - 1, 0)));
+    glUniform3fv(glGetUniformLocation(program, "uIBLSH"), 9, &_sh[0][0]);
+
+    // the samplers get their own units even when unused, two samplers of different types must
+    // not share one
+    glActiveTexture(GL_TEXTURE0 + firstUnit);
+    glBindTexture(GL_TEXTURE_2D, _prefiltered);
+    glUniform1i(glGetUniformLocation(program, "uIBLPrefiltered"), firstUnit);
+
+    glActiveTexture(GL_TEXTURE0 + firstUnit + 1);
+    glBindTexture(GL_TEXTURE_2D, _brdfLut);
+    glUniform1i(glGetUniformLocation(program, "uIBLBrdfLut"), firstUnit + 1);
+
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void hzgl::EnvironmentLighting::Release()
+{
+    if (_prefiltered != 0)
+    {
+        UntrackGpuResource(HZGL_GPU_TEXTURE, _prefiltered);
+        glDeleteTextures(1, &_prefiltered);
+    }
+
+    if (_brdfLut != 0)
+    {
+        UntrackGpuResource(HZGL_GPU_TEXTURE, _brdfLut);
+        glDeleteTextures(1, &_brdfLut);
+    }
+
+    _prefiltered = 0;
+    _brdfLut = 0;
+    _levels = 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "IBL.hpp"
+
+#include <string>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+namespace hzgl
+{
+    // image-based lighting of the PBR programs from an equirectangular .hdr: SH9 irradiance for
+    // the diffuse term, a GGX-prefiltered mip chain and the split-sum BRDF LUT for the specular
+    // term. The precompute runs on the CPU (see IBL.hpp) and its results are cached on disk.
+    class EnvironmentLighting
+    {
+    private:
+        GLuint _prefiltered;
+        GLuint _brdfLut;
+        int _levels;
+        glm::vec3 _sh[9];
+
+        bool _enabled;
+        float _intensity;
+        std::string _path;
+
+        IBLStats _stats;
+        int _cacheHits;                 // environments and LUTs found in the cache since the start
+        int _cacheLookups;
+
+    public:
+        EnvironmentLighting();
+        ~EnvironmentLighting();
+
+        EnvironmentLighting(const EnvironmentLighting&) = delete;
+        EnvironmentLighting& operator=(const EnvironmentLighting&) = delete;
+
+        // precompute (or read from cacheDir) and upload; the previous environment is kept on failure
+        bool Load(const std::string& hdrPath, const std::string& cacheDir, const IBLOptions& options = IBLOptions());
+        bool IsLoaded() const;
+
+        void SetEnabled(bool enabled);
+        bool Enabled() const;
+        void SetIntensity(float intensity);
+        float Intensity() const;
+
+        const std::string& Path() const;
+        const IBLStats& Stats() const;
+        double CacheHitRate() const;
+
+        // set the uIBL* uniforms and bind the two textures to firstUnit and the one after it;
+        // programs built without HZGL_HAS_IBL keep their constant ambient and ignore them
+        void Bind(GLuint program, int firstUnit = 13) const;
+
+        // delete the GL objects (needs the context that created them)
+        void Release();
+    };
+} // namespace hzgl
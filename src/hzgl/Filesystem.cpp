@@ -8,6 +8,8 @@
 #include "Filesystem.hpp"
 
 #include <cstdio>
+#include <cctype>
+#include <algorithm>
 
 #define HZGL_LOG_ERROR(msg) \
     fprintf(stderr, "[ERROR] %s (line %d): %s\n", __FILE__, __LINE__, msg);
@@ -86,6 +88,92 @@ std::string hzgl::GetAbsolutePath(const std::string& relpath)
     return relpath;
 }
 
+std::string hzgl::GetExtension(const std::string& filepath)
+{
+    std::size_t lastDot = filepath.find_last_of('.');
+    std::size_t lastSlash = filepath.find_last_of("/\\");
+
+    if (lastDot == std::string::npos || (lastSlash != std::string::npos && lastDot < lastSlash))
+        return "";
+
+    // lowercase without the dot, e.g. "obj"
+    std::string ext = filepath.substr(lastDot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    return ext;
+}
+
+std::vector<std::string> hzgl::ListFiles(const std::string& dirpath, bool recursive)
+{
+    std::vector<std::string> files;
+
+#if defined(HZGL_CXX17) || defined(HZGL_CXX14)
+    if (!_hzfs::is_directory(dirpath))
+        return files;
+
+    if (recursive)
+    {
+        for (const auto& entry : _hzfs::recursive_directory_iterator(dirpath))
+        {
+            if (_hzfs::is_regular_file(entry.path()))
+                files.push_back(entry.path().generic_string());
+        }
+    }
+    else
+    {
+        for (const auto& entry : _hzfs::directory_iterator(dirpath))
+        {
+            if (_hzfs::is_regular_file(entry.path()))
+                files.push_back(entry.path().generic_string());
+        }
+    }
+
+    // directory iteration order is unspecified
+    std::sort(files.begin(), files.end());
+#elif defined(_WIN32)
+    // TODO
+#elif defined(__APPLE__)
+    // TODO
+#elif defined(__linux__)
+    // TODO
+#endif
+
+    return files;
+}
+
+bool hzgl::IsDirectory(const std::string& path)
+{
+#if defined(HZGL_CXX17) || defined(HZGL_CXX14)
+    return _hzfs::is_directory(path);
+#elif defined(_WIN32)
+    // TODO
+#elif defined(__APPLE__)
+    // TODO
+#elif defined(__linux__)
+    // TODO
+#endif
+
+    return false;
+}
+
+bool hzgl::CreateDirectories(const std::string& dirpath)
+{
+#if defined(HZGL_CXX17) || defined(HZGL_CXX14)
+    // existing directories are fine
+    std::error_code error;
+    _hzfs::create_directories(dirpath, error);
+    return _hzfs::is_directory(dirpath);
+#elif defined(_WIN32)
+    // TODO
+#elif defined(__APPLE__)
+    // TODO
+#elif defined(__linux__)
+    // TODO
+#endif
+
+    return false;
+}
+
 bool hzgl::Copy(const std::string& src, const std::string& dest, bool failIfExists)
 {
 #if defined(HZGL_CXX17) || defined(HZGL_CXX14)
@@ -1,12 +1,17 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 namespace hzgl
 {
     bool Exists(const std::string& filename);
     std::string GetParentPath(const std::string& filepath);
     std::string GetAbsolutePath(const std::string& relpath);
+    std::string GetExtension(const std::string& filepath);
+    std::vector<std::string> ListFiles(const std::string& dirpath, bool recursive = false);
+    bool IsDirectory(const std::string& path);
+    bool CreateDirectories(const std::string& dirpath);
 
     bool Copy(const std::string& src, const std::string& dest, bool failIfExists = true);
     bool Move(const std::string& src, const std::string& dest, bool failIfExists = true);
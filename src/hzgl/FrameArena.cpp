@@ -0,0 +1,131 @@
+#include "FrameArena.hpp"
+
+#include <cstdio>
+#include <cstdint>
+#include <new>
+#include <algorithm>
+
+static size_t hzglAlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+hzgl::FrameArena::FrameArena(size_t capacity)
+    : _block(nullptr), _capacity(capacity), _offset(0), _requested(0), _peak(0)
+{
+    _block = new (std::nothrow) char[_capacity];
+
+    if (_block == nullptr)
+        _capacity = 0;
+}
+
+hzgl::FrameArena::~FrameArena()
+{
+    for (char* block : _overflow)
+        delete[] block;
+
+    delete[] _block;
+}
+
+void* hzgl::FrameArena::Allocate(size_t size, size_t alignment)
+{
+    size = std::max<size_t>(size, 1);
+    _requested += size + alignment;
+
+    // new[] returns blocks aligned to max_align_t, so aligned offsets give aligned addresses
+    size_t offset = hzglAlignUp(_offset, alignment);
+
+    if (offset + size <= _capacity)
+    {
+        _offset = offset + size;
+        return _block + offset;
+    }
+
+    // out of space: hand out a heap block for the rest of this frame (these show up in the
+    // allocation counters, which is the point)
+    char* block = new (std::nothrow) char[size + alignment];
+
+    if (block == nullptr)
+        return nullptr;
+
+    _overflow.push_back(block);
+
+    uintptr_t address = reinterpret_cast<uintptr_t>(block);
+    return reinterpret_cast<void*>(hzglAlignUp(address, alignment));
+}
+
+const char* hzgl::FrameArena::Format(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    const char* str = FormatV(format, args);
+    va_end(args);
+
+    return str;
+}
+
+const char* hzgl::FrameArena::FormatV(const char* format, va_list args)
+{
+    va_list copy;
+    va_copy(copy, args);
+    int length = vsnprintf(nullptr, 0, format, copy);
+    va_end(copy);
+
+    if (length < 0)
+        return "";
+
+    char* str = static_cast<char*>(Allocate(length + 1, 1));
+
+    if (str == nullptr)
+        return "";
+
+    vsnprintf(str, length + 1, format, args);
+
+    return str;
+}
+
+void hzgl::FrameArena::Reset()
+{
+    _peak = std::max(_peak, _requested);
+
+    if (!_overflow.empty())
+    {
+        for (char* block : _overflow)
+            delete[] block;
+
+        _overflow.clear();
+
+        size_t capacity = std::max(2 * _capacity, hzglAlignUp(_requested, 4096));
+
+        if (char* block = new (std::nothrow) char[capacity])
+        {
+            delete[] _block;
+            _block = block;
+            _capacity = capacity;
+        }
+    }
+
+    _offset = 0;
+    _requested = 0;
+}
+
+size_t hzgl::FrameArena::Used() const
+{
+    return _offset;
+}
+
+size_t hzgl::FrameArena::Capacity() const
+{
+    return _capacity;
+}
+
+size_t hzgl::FrameArena::Peak() const
+{
+    return _peak;
+}
+
+hzgl::FrameArena& hzgl::GetFrameArena()
+{
+    static FrameArena arena;
+    return arena;
+}
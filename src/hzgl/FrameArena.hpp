@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdarg>
+#include <type_traits>
+
+namespace hzgl
+{
+    // bump allocator for data that only lives for one frame (labels, name lists, scratch arrays);
+    // Reset() releases everything at once and nothing is ever destroyed
+    class FrameArena
+    {
+    private:
+        char* _block;
+        size_t _capacity;
+        size_t _offset;
+        size_t _requested;              // bytes asked for this frame, including the overflow
+        size_t _peak;
+        std::vector<char*> _overflow;   // heap blocks of a frame that did not fit
+
+    public:
+        explicit FrameArena(size_t capacity = 256 * 1024);
+        ~FrameArena();
+
+        FrameArena(const FrameArena&) = delete;
+        FrameArena& operator=(const FrameArena&) = delete;
+
+        void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+        // uninitialized storage, valid until the next Reset()
+        template <typename T>
+        T* AllocateArray(size_t count)
+        {
+            static_assert(std::is_trivially_destructible<T>::value, "the arena never runs destructors");
+            return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+        }
+
+        // printf into the arena, valid until the next Reset()
+        const char* Format(const char* format, ...);
+        const char* FormatV(const char* format, va_list args);
+
+        // a frame that overflowed grows the block, so the steady state stays in one block
+        void Reset();
+
+        size_t Used() const;
+        size_t Capacity() const;
+        size_t Peak() const;
+    };
+
+    // arena of the render thread, reset at the start of every frame
+    FrameArena& GetFrameArena();
+} // namespace hzgl
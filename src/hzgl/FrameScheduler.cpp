@@ -0,0 +1,272 @@
+#include "FrameScheduler.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <algorithm>
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+static double hzglWallSeconds()
+{
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+double hzgl::ProcessCpuSeconds()
+{
+#if defined(_WIN32)
+    FILETIME creation, exit, kernel, user;
+
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+        return 0.0;
+
+    // 100 ns units
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+
+    return 1e-7 * static_cast<double>(k.QuadPart + u.QuadPart);
+#else
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0.0;
+
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + 1e-6 * (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+#endif
+}
+
+std::string hzgl::DirtyFlagsToString(unsigned flags)
+{
+    char buffer[128];
+    FormatDirtyFlags(flags, buffer, sizeof(buffer));
+
+    return buffer;
+}
+
+void hzgl::FormatDirtyFlags(unsigned flags, char* buffer, size_t size)
+{
+    static const char* names[] = {"camera", "light", "material", "program", "model", "input", "window", "animation"};
+
+    if (size == 0)
+        return;
+
+    size_t length = 0;
+    buffer[0] = '\0';
+
+    for (int bit = 0; bit < 8 && length < size; bit++)
+    {
+        if (flags & (1u << bit))
+        {
+            int written = snprintf(buffer + length, size - length, "%s%s", length == 0 ? "" : ", ", names[bit]);
+            length += std::max(written, 0);
+        }
+    }
+
+    if (length == 0)
+        snprintf(buffer, size, "none");
+}
+
+hzgl::FrameScheduler::FrameScheduler(bool onDemand, int settleFrames)
+    : _onDemand(onDemand), _settleFrames(std::max(settleFrames, 1)), _framesLeft(0),
+      _dirty(HZGL_DIRTY_NONE), _lastDirty(HZGL_DIRTY_NONE)
+{
+    // the first frames always have something to show
+    MarkDirty(HZGL_DIRTY_ALL);
+}
+
+void hzgl::FrameScheduler::SetOnDemand(bool onDemand)
+{
+    _onDemand = onDemand;
+}
+
+bool hzgl::FrameScheduler::OnDemand() const
+{
+    return _onDemand;
+}
+
+void hzgl::FrameScheduler::MarkDirty(unsigned flags)
+{
+    if (flags == HZGL_DIRTY_NONE)
+        return;
+
+    _dirty |= flags;
+    _framesLeft = _settleFrames;
+}
+
+bool hzgl::FrameScheduler::ShouldRender() const
+{
+    return !_onDemand || _framesLeft > 0;
+}
+
+void hzgl::FrameScheduler::FrameRendered()
+{
+    if (_dirty != HZGL_DIRTY_NONE)
+        _lastDirty = _dirty;
+
+    _dirty = HZGL_DIRTY_NONE;
+
+    if (_framesLeft > 0)
+        _framesLeft--;
+}
+
+unsigned hzgl::FrameScheduler::LastDirtyFlags() const
+{
+    return _lastDirty;
+}
+
+hzgl::UtilizationMeter::UtilizationMeter(double window)
+    : _active(-1), _next(0), _initialized(false), _window(window),
+      _windowGpuNs(0), _windowFrames(0), _windowOnDemand(false)
+{
+    std::fill(_queries, _queries + NumQueries, 0);
+    std::fill(_pending, _pending + NumQueries, false);
+
+    _totalGpuNs[0] = _totalGpuNs[1] = 0;
+    _totalCpu[0] = _totalCpu[1] = 0.0;
+
+    _windowStart = hzglWallSeconds();
+    _windowCpu = ProcessCpuSeconds();
+}
+
+hzgl::UtilizationMeter::~UtilizationMeter()
+{
+}
+
+void hzgl::UtilizationMeter::Init()
+{
+    if (_initialized)
+        return;
+
+    glGenQueries(NumQueries, _queries);
+    _initialized = true;
+}
+
+void hzgl::UtilizationMeter::Shutdown()
+{
+    if (!_initialized)
+        return;
+
+    glDeleteQueries(NumQueries, _queries);
+    std::fill(_pending, _pending + NumQueries, false);
+
+    _active = -1;
+    _initialized = false;
+}
+
+void hzgl::UtilizationMeter::collect()
+{
+    for (int i = 0; i < NumQueries; i++)
+    {
+        if (!_pending[i])
+            continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(_queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+
+        if (!available)
+            continue;
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(_queries[i], GL_QUERY_RESULT, &elapsed);
+
+        _windowGpuNs += elapsed;
+        _pending[i] = false;
+    }
+}
+
+void hzgl::UtilizationMeter::BeginFrame()
+{
+    _windowFrames++;
+
+    if (!_initialized)
+        return;
+
+    collect();
+
+    // every query still in flight: skip the GPU timing of this frame rather than wait
+    if (_pending[_next])
+        return;
+
+    glBeginQuery(GL_TIME_ELAPSED, _queries[_next]);
+    _active = _next;
+}
+
+void hzgl::UtilizationMeter::EndFrame()
+{
+    if (_active < 0)
+        return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+
+    _pending[_active] = true;
+    _next = (_active + 1) % NumQueries;
+    _active = -1;
+}
+
+void hzgl::UtilizationMeter::flush(double now)
+{
+    double cpu = ProcessCpuSeconds();
+    double wall = now - _windowStart;
+
+    if (wall > 0.0)
+    {
+        _latest.wall_s = wall;
+        _latest.cpu_percent = 100.0 * (cpu - _windowCpu) / wall;
+        _latest.gpu_percent = 100.0 * (1e-9 * _windowGpuNs) / wall;
+        _latest.fps = _windowFrames / wall;
+        _latest.frames = _windowFrames;
+
+        int mode = _windowOnDemand ? 1 : 0;
+        _totals[mode].wall_s += wall;
+        _totals[mode].frames += _windowFrames;
+        _totalCpu[mode] += cpu - _windowCpu;
+        _totalGpuNs[mode] += _windowGpuNs;
+    }
+
+    _windowStart = now;
+    _windowCpu = cpu;
+    _windowGpuNs = 0;
+    _windowFrames = 0;
+}
+
+void hzgl::UtilizationMeter::Update(bool onDemand)
+{
+    if (_initialized)
+        collect();
+
+    double now = hzglWallSeconds();
+
+    // a mode switch closes the window early so that each total only sees its own mode
+    if (onDemand != _windowOnDemand || now - _windowStart >= _window)
+    {
+        flush(now);
+        _windowOnDemand = onDemand;
+    }
+}
+
+const hzgl::UtilizationStats& hzgl::UtilizationMeter::Latest() const
+{
+    return _latest;
+}
+
+hzgl::UtilizationStats hzgl::UtilizationMeter::Total(bool onDemand) const
+{
+    int mode = onDemand ? 1 : 0;
+    UtilizationStats total = _totals[mode];
+
+    if (total.wall_s > 0.0)
+    {
+        total.cpu_percent = 100.0 * _totalCpu[mode] / total.wall_s;
+        total.gpu_percent = 100.0 * (1e-9 * _totalGpuNs[mode]) / total.wall_s;
+        total.fps = total.frames / total.wall_s;
+    }
+
+    return total;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#include <glad/glad.h>
+
+namespace hzgl
+{
+    // why a frame has to be drawn; several reasons can be pending at once
+    typedef enum
+    {
+        HZGL_DIRTY_NONE = 0,
+        HZGL_DIRTY_CAMERA = 1 << 0,
+        HZGL_DIRTY_LIGHT = 1 << 1,
+        HZGL_DIRTY_MATERIAL = 1 << 2,
+        HZGL_DIRTY_PROGRAM = 1 << 3,
+        HZGL_DIRTY_MODEL = 1 << 4,
+        HZGL_DIRTY_INPUT = 1 << 5,       // keyboard, mouse or ImGui interaction
+        HZGL_DIRTY_WINDOW = 1 << 6,      // resize, expose, focus
+        HZGL_DIRTY_ANIMATION = 1 << 7,
+        HZGL_DIRTY_ALL = 0xff
+    } DirtyFlag;
+
+    typedef struct
+    {
+        double wall_s = 0.0;
+        double cpu_percent = 0.0;        // process CPU time over wall time (100 = one core)
+        double gpu_percent = 0.0;        // GPU time of the drawn frames over wall time
+        double fps = 0.0;                // frames actually drawn
+        uint64_t frames = 0;
+    } UtilizationStats;
+
+    // decides whether the main loop draws: always in continuous mode, only while
+    // something is dirty in on-demand mode
+    class FrameScheduler
+    {
+    private:
+        bool _onDemand;
+        int _settleFrames;
+        int _framesLeft;
+        unsigned _dirty;
+        unsigned _lastDirty;
+
+    public:
+        // ImGui needs a couple of frames to settle after an event (hover, focus, ...)
+        explicit FrameScheduler(bool onDemand = true, int settleFrames = 3);
+
+        void SetOnDemand(bool onDemand);
+        bool OnDemand() const;
+
+        // keep drawing for the next settleFrames frames
+        void MarkDirty(unsigned flags);
+        bool ShouldRender() const;
+        void FrameRendered();
+
+        // reasons behind the most recent change that was drawn
+        unsigned LastDirtyFlags() const;
+    };
+
+    // CPU and GPU utilization over one-second windows, with totals kept per mode so that
+    // continuous and on-demand rendering can be compared
+    class UtilizationMeter
+    {
+    private:
+        static const int NumQueries = 4;
+
+        GLuint _queries[NumQueries];
+        bool _pending[NumQueries];
+        int _active;                     // query of the frame being drawn, -1 if none
+        int _next;
+        bool _initialized;
+
+        double _window;
+        double _windowStart;
+        double _windowCpu;
+        uint64_t _windowGpuNs;
+        uint64_t _windowFrames;
+        bool _windowOnDemand;
+
+        UtilizationStats _latest;
+        UtilizationStats _totals[2];     // continuous, on-demand (sums until Total() is asked)
+        uint64_t _totalGpuNs[2];
+        double _totalCpu[2];
+
+        void collect();
+        void flush(double now);
+
+    public:
+        explicit UtilizationMeter(double window = 1.0);
+        ~UtilizationMeter();
+
+        UtilizationMeter(const UtilizationMeter&) = delete;
+        UtilizationMeter& operator=(const UtilizationMeter&) = delete;
+
+        // GPU timing needs a current context
+        void Init();
+        void Shutdown();
+
+        // bracket the GL work of a drawn frame
+        void BeginFrame();
+        void EndFrame();
+
+        // once per loop iteration, whether a frame was drawn or not
+        void Update(bool onDemand);
+
+        const UtilizationStats& Latest() const;
+        UtilizationStats Total(bool onDemand) const;
+    };
+
+    // e.g. "camera, input"; "none" for HZGL_DIRTY_NONE
+    std::string DirtyFlagsToString(unsigned flags);
+    void FormatDirtyFlags(unsigned flags, char* buffer, size_t size);   // same text, no allocation
+
+    // user + system time consumed by the process so far, in seconds
+    double ProcessCpuSeconds();
+} // namespace hzgl
@@ -1,9 +1,103 @@
 #include "Framebuffer.hpp"
 
+#include "Memory.hpp"
+
 #include <vector>
 #include <string>
 #include <iostream>
 
+static std::string hzglAttachmentName(GLenum attachmentPoint)
+{
+    if (attachmentPoint == GL_DEPTH_ATTACHMENT)
+        return "depth";
+    else if (attachmentPoint == GL_STENCIL_ATTACHMENT)
+        return "stencil";
+    else if (attachmentPoint == GL_DEPTH_STENCIL_ATTACHMENT)
+        return "depth/stencil";
+
+    return "color" + std::to_string(attachmentPoint - GL_COLOR_ATTACHMENT0);
+}
+
+// pixel format and type that go with a sized internal format in glTexImage2D
+static void hzglPixelFormat(GLenum internalFormat, GLenum* format, GLenum* type)
+{
+    switch (internalFormat)
+    {
+        case GL_DEPTH_COMPONENT16:
+        case GL_DEPTH_COMPONENT24:
+        case GL_DEPTH_COMPONENT32F:
+        case GL_DEPTH_COMPONENT:
+            *format = GL_DEPTH_COMPONENT;
+            *type = GL_FLOAT;
+            return;
+        case GL_DEPTH24_STENCIL8:
+        case GL_DEPTH_STENCIL:
+            *format = GL_DEPTH_STENCIL;
+            *type = GL_UNSIGNED_INT_24_8;
+            return;
+        case GL_R8:
+        case GL_R16:
+        case GL_R16F:
+        case GL_R32F:
+        case GL_RED:
+            *format = GL_RED;
+            break;
+        case GL_RG8:
+        case GL_RG16:
+        case GL_RG16F:
+        case GL_RG32F:
+        case GL_RG:
+            *format = GL_RG;
+            break;
+        case GL_RGB8:
+        case GL_RGB16F:
+        case GL_RGB32F:
+        case GL_RGB:
+            *format = GL_RGB;
+            break;
+        // integer formats take the _INTEGER formats, anything else is an invalid operation
+        case GL_R8I:
+        case GL_R8UI:
+        case GL_R16I:
+        case GL_R16UI:
+        case GL_R32I:
+        case GL_R32UI:
+            *format = GL_RED_INTEGER;
+            break;
+        case GL_RG8I:
+        case GL_RG8UI:
+        case GL_RG16I:
+        case GL_RG16UI:
+        case GL_RG32I:
+        case GL_RG32UI:
+            *format = GL_RG_INTEGER;
+            break;
+        case GL_RGB8I:
+        case GL_RGB8UI:
+        case GL_RGB16I:
+        case GL_RGB16UI:
+        case GL_RGB32I:
+        case GL_RGB32UI:
+            *format = GL_RGB_INTEGER;
+            break;
+        case GL_RGBA8I:
+        case GL_RGBA8UI:
+        case GL_RGBA16I:
+        case GL_RGBA16UI:
+        case GL_RGBA32I:
+        case GL_RGBA32UI:
+        case GL_RGB10_A2UI:
+            *format = GL_RGBA_INTEGER;
+            break;
+        default:
+            *format = GL_RGBA;
+            break;
+    }
+
+    // no data is uploaded, the type only has to be valid for the format
+    *type = (internalFormat == GL_RGB10_A2UI) ? GL_UNSIGNED_INT_2_10_10_10_REV : GL_UNSIGNED_BYTE;
+}
+
 GLuint hzgl::CreateFBO(int width, int height, const std::vector<AttachedImage>& attachments, FrameBufferInfo* fbInfo)
 {
     if (fbInfo != nullptr) 
@@ -18,8 +112,11 @@ GLuint hzgl::CreateFBO(int width, int height, const std::vector<AttachedImage>&
         fbInfo->color_attachment.clear();
         fbInfo->depth_attachment = 0;
         fbInfo->stencil_attachment = 0;
+        fbInfo->depth_texture = 0;
     }
 
+    std::vector<GLenum> drawBuffers;
+
     // create a framebuffer object
     GLuint fboID;
     glGenFramebuffers(1, &fboID);
@@ -35,22 +132,46 @@ GLuint hzgl::CreateFBO(int width, int height, const std::vector<AttachedImage>&
     
         if (info.type == GL_TEXTURE_2D)
         {
+            bool isDepth = (info.attachment_point == GL_DEPTH_ATTACHMENT || info.attachment_point == GL_DEPTH_STENCIL_ATTACHMENT);
+
+            GLenum format, type;
+            hzglPixelFormat(info.internal_format, &format, &type);
+
             GLuint texID;
             glGenTextures(1, &texID);
 
+            // depth is read back texel by texel, never filtered
+            GLint filter = isDepth ? GL_NEAREST : GL_LINEAR;
+
             glBindTexture(GL_TEXTURE_2D, texID);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glTexImage2D(GL_TEXTURE_2D, 0, info.internal_format, width, height, 0, info.internal_format, GL_UNSIGNED_BYTE, 0);
+            glTexImage2D(GL_TEXTURE_2D, 0, info.internal_format, width, height, 0, format, type, 0);
             glFramebufferTexture2D(GL_FRAMEBUFFER, info.attachment_point, GL_TEXTURE_2D, texID, 0);
             glBindTexture(GL_TEXTURE_2D, 0);
 
-            if (fbInfo != nullptr) 
+            TrackGpuResource({HZGL_GPU_TEXTURE, texID, EstimateTextureBytes(info.internal_format, width, height),
+                              "Framebuffer " + std::to_string(fboID), "", hzglAttachmentName(info.attachment_point)});
+
+            if (isDepth)
+            {
+                if (fbInfo != nullptr)
+                {
+                    fbInfo->num_depth_attachment += 1;
+                    fbInfo->depth_texture = texID;
+                }
+            }
+            else
             {
-                fbInfo->num_color_attachment += 1;
-                fbInfo->color_attachment.push_back(texID);
+                drawBuffers.push_back(info.attachment_point);
+
+                if (fbInfo != nullptr) 
+                {
+                    fbInfo->num_color_attachment += 1;
+                    fbInfo->color_attachment.push_back(texID);
+                }
             }
         }
 
@@ -64,6 +185,9 @@ GLuint hzgl::CreateFBO(int width, int height, const std::vector<AttachedImage>&
             glFramebufferRenderbuffer(GL_FRAMEBUFFER, info.attachment_point, GL_RENDERBUFFER, rboID);
             glBindRenderbuffer(GL_RENDERBUFFER, 0);
 
+            TrackGpuResource({HZGL_GPU_RENDERBUFFER, rboID, EstimateTextureBytes(info.internal_format, width, height),
+                              "Framebuffer " + std::to_string(fboID), "", hzglAttachmentName(info.attachment_point)});
+
             if (fbInfo != nullptr) {
                 if (info.attachment_point == GL_DEPTH_STENCIL_ATTACHMENT) 
                 {
@@ -84,6 +208,21 @@ GLuint hzgl::CreateFBO(int width, int height, const std::vector<AttachedImage>&
         }
     }
 
+    // every color texture is an output of the fragment shader (G-buffers have several)
+    if (drawBuffers.size() > 1)
+        glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+
+    bool hasColor = !drawBuffers.empty();
+    for (const auto& info : attachments)
+        hasColor = hasColor || (info.attachment_point >= GL_COLOR_ATTACHMENT0 && info.attachment_point <= GL_COLOR_ATTACHMENT15);
+
+    // depth-only targets (e.g. shadow maps) are incomplete with the default draw buffer
+    if (!hasColor)
+    {
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+
     GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
     if (status != GL_FRAMEBUFFER_COMPLETE)
     {
@@ -104,4 +243,41 @@ GLuint hzgl::CreateFBO(int width, int height, FrameBufferInfo* fbInfo)
     };
 
     return CreateFBO(width, height, attachments, fbInfo);
-}
\ No newline at end of file
+}
+
+void hzgl::DeleteFBO(FrameBufferInfo* fbInfo)
+{
+    if (fbInfo == nullptr)
+        return;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &fbInfo->id);
+
+    for (GLuint texID : fbInfo->color_attachment)
+    {
+        glDeleteTextures(1, &texID);
+        UntrackGpuResource(HZGL_GPU_TEXTURE, texID);
+    }
+
+    if (fbInfo->depth_texture != 0)
+    {
+        glDeleteTextures(1, &fbInfo->depth_texture);
+        UntrackGpuResource(HZGL_GPU_TEXTURE, fbInfo->depth_texture);
+    }
+
+    // depth and stencil may share one renderbuffer
+    glDeleteRenderbuffers(1, &fbInfo->depth_attachment);
+    UntrackGpuResource(HZGL_GPU_RENDERBUFFER, fbInfo->depth_attachment);
+
+    if (fbInfo->stencil_attachment != fbInfo->depth_attachment)
+    {
+        glDeleteRenderbuffers(1, &fbInfo->stencil_attachment);
+        UntrackGpuResource(HZGL_GPU_RENDERBUFFER, fbInfo->stencil_attachment);
+    }
+
+    fbInfo->id = 0;
+    fbInfo->color_attachment.clear();
+    fbInfo->depth_attachment = 0;
+    fbInfo->stencil_attachment = 0;
+    fbInfo->depth_texture = 0;
+}
@@ -26,8 +26,14 @@ namespace hzgl
         std::vector<GLuint> color_attachment;
         GLuint depth_attachment;
         GLuint stencil_attachment;
+        GLuint depth_texture;    // depth attached as a texture (e.g. to be sampled later), 0 otherwise
     } FrameBufferInfo;
 
     GLuint CreateFBO(int width, int height, FrameBufferInfo* fbInfo = nullptr);
+    // color textures are drawn to in the order they are listed; a texture on GL_DEPTH_ATTACHMENT
+    // becomes depth_texture
     GLuint CreateFBO(int width, int height, const std::vector<AttachedImage>& attachments, FrameBufferInfo* fbInfo = nullptr);
+
+    // delete the framebuffer together with its attachments
+    void DeleteFBO(FrameBufferInfo* fbInfo);
 } // namespace hzgl
\ No newline at end of file
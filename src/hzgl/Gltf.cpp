@@ -0,0 +1,939 @@
+#include "Gltf.hpp"
+
+#include "Filesystem.hpp"
+#include "Profiler.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+
+//
+// JSON, as much as glTF needs
+//
+
+typedef struct _JsonValue
+{
+    enum Type
+    {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object
+    } type = Null;
+
+    double number = 0.0;            // also 0/1 for Bool
+    std::string string;
+    std::vector<_JsonValue> items;
+    std::vector<std::pair<std::string, _JsonValue>> members;
+
+    const _JsonValue* Find(const char* key) const
+    {
+        for (const auto& member : members)
+        {
+            if (member.first == key)
+                return &member.second;
+        }
+
+        return nullptr;
+    }
+} JsonValue;
+
+static void hzglSkipSpace(const char*& p, const char* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+        p++;
+}
+
+static void hzglAppendUtf8(std::string& out, unsigned code)
+{
+    if (code < 0x80)
+        out += static_cast<char>(code);
+    else if (code < 0x800)
+    {
+        out += static_cast<char>(0xc0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3f));
+    }
+    else if (code < 0x10000)
+    {
+        out += static_cast<char>(0xe0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (code & 0x3f));
+    }
+    else
+    {
+        out += static_cast<char>(0xf0 | (code >> 18));
+        out += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (code & 0x3f));
+    }
+}
+
+static bool hzglParseHex4(const char*& p, const char* end, unsigned* code)
+{
+    if (end - p < 4)
+        return false;
+
+    *code = 0;
+    for (int i = 0; i < 4; i++, p++)
+    {
+        char c = *p;
+        unsigned digit = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : 16;
+
+        if (digit > 15)
+            return false;
+
+        *code = 16 * *code + digit;
+    }
+
+    return true;
+}
+
+static bool hzglParseString(const char*& p, const char* end, std::string& out)
+{
+    if (p >= end || *p != '"')
+        return false;
+
+    p++;
+    out.clear();
+
+    while (p < end && *p != '"')
+    {
+        if (*p != '\\')
+        {
+            out += *p++;
+            continue;
+        }
+
+        if (++p >= end)
+            return false;
+
+        char c = *p++;
+        switch (c)
+        {
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u':
+        {
+            unsigned code;
+            if (!hzglParseHex4(p, end, &code))
+                return false;
+
+            // surrogate pairs
+            if (code >= 0xd800 && code < 0xdc00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u')
+            {
+                p += 2;
+                unsigned low;
+                if (!hzglParseHex4(p, end, &low))
+                    return false;
+
+                code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+            }
+
+            hzglAppendUtf8(out, code);
+            break;
+        }
+        default:
+            out += c;   // \" \\ \/
+            break;
+        }
+    }
+
+    if (p >= end)
+        return false;
+
+    p++;
+    return true;
+}
+
+static bool hzglParseJson(const char*& p, const char* end, JsonValue& value, int depth = 0)
+{
+    hzglSkipSpace(p, end);
+
+    if (p >= end || depth > 64)
+        return false;
+
+    if (*p == '{')
+    {
+        value.type = JsonValue::Object;
+        p++;
+        hzglSkipSpace(p, end);
+
+        if (p < end && *p == '}')
+        {
+            p++;
+            return true;
+        }
+
+        while (true)
+        {
+            hzglSkipSpace(p, end);
+
+            std::pair<std::string, JsonValue> member;
+            if (!hzglParseString(p, end, member.first))
+                return false;
+
+            hzglSkipSpace(p, end);
+            if (p >= end || *p++ != ':')
+                return false;
+
+            if (!hzglParseJson(p, end, member.second, depth + 1))
+                return false;
+
+            value.members.push_back(std::move(member));
+
+            hzglSkipSpace(p, end);
+            if (p < end && *p == ',')
+            {
+                p++;
+                continue;
+            }
+
+            return p < end && *p++ == '}';
+        }
+    }
+
+    if (*p == '[')
+    {
+        value.type = JsonValue::Array;
+        p++;
+        hzglSkipSpace(p, end);
+
+        if (p < end && *p == ']')
+        {
+            p++;
+            return true;
+        }
+
+        while (true)
+        {
+            value.items.emplace_back();
+            if (!hzglParseJson(p, end, value.items.back(), depth + 1))
+                return false;
+
+            hzglSkipSpace(p, end);
+            if (p < end && *p == ',')
+            {
+                p++;
+                continue;
+            }
+
+            return p < end && *p++ == ']';
+        }
+    }
+
+    if (*p == '"')
+    {
+        value.type = JsonValue::String;
+        return hzglParseString(p, end, value.string);
+    }
+
+    const char* words[3] = {"true", "false", "null"};
+    for (int w = 0; w < 3; w++)
+    {
+        size_t length = strlen(words[w]);
+
+        if (static_cast<size_t>(end - p) >= length && strncmp(p, words[w], length) == 0)
+        {
+            value.type = (w < 2) ? JsonValue::Bool : JsonValue::Null;
+            value.number = (w == 0) ? 1.0 : 0.0;
+            p += length;
+            return true;
+        }
+    }
+
+    // the mapping is not null-terminated, so the number is copied out for strtod
+    char number[64];
+    size_t length = 0;
+
+    while (p + length < end && length + 1 < sizeof(number) && p[length] != '\0' && strchr("+-.0123456789eE", p[length]) != nullptr)
+    {
+        number[length] = p[length];
+        length++;
+    }
+
+    number[length] = '\0';
+
+    char* numberEnd = nullptr;
+    value.type = JsonValue::Number;
+    value.number = strtod(number, &numberEnd);
+
+    if (numberEnd == number)
+        return false;
+
+    p += numberEnd - number;
+    return true;
+}
+
+static int hzglJsonInt(const JsonValue* value, int fallback = -1)
+{
+    return (value != nullptr && value->type == JsonValue::Number) ? static_cast<int>(value->number) : fallback;
+}
+
+static size_t hzglJsonSize(const JsonValue* value, size_t fallback = 0)
+{
+    return (value != nullptr && value->type == JsonValue::Number && value->number >= 0.0) ? static_cast<size_t>(value->number) : fallback;
+}
+
+static std::string hzglJsonString(const JsonValue* value)
+{
+    return (value != nullptr && value->type == JsonValue::String) ? value->string : std::string();
+}
+
+static const std::vector<JsonValue>& hzglJsonItems(const JsonValue& root, const char* key)
+{
+    static const std::vector<JsonValue> none;
+
+    const JsonValue* value = root.Find(key);
+    return (value != nullptr && value->type == JsonValue::Array) ? value->items : none;
+}
+
+//
+// buffers
+//
+
+static bool hzglDecodeBase64(const char* p, const char* end, std::vector<uint8_t>& out)
+{
+    out.clear();
+    out.reserve((end - p) / 4 * 3);
+
+    unsigned bits = 0;
+    int count = 0;
+
+    for (; p < end && *p != '='; p++)
+    {
+        char c = *p;
+        int v = (c >= 'A' && c <= 'Z') ? c - 'A' : (c >= 'a' && c <= 'z') ? c - 'a' + 26 : (c >= '0' && c <= '9') ? c - '0' + 52
+              : (c == '+') ? 62 : (c == '/') ? 63 : -1;
+
+        if (v < 0)
+            return false;
+
+        bits = (bits << 6) | static_cast<unsigned>(v);
+        count += 6;
+
+        if (count >= 8)
+        {
+            count -= 8;
+            out.push_back(static_cast<uint8_t>((bits >> count) & 0xff));
+        }
+    }
+
+    return true;
+}
+
+// "%20" and the like in relative URIs
+static std::string hzglDecodeUri(const std::string& uri)
+{
+    std::string path;
+
+    for (size_t i = 0; i < uri.size(); i++)
+    {
+        unsigned code;
+        const char* p = uri.c_str() + i + 1;
+
+        if (uri[i] == '%' && i + 2 < uri.size() && sscanf(p, "%2x", &code) == 1)
+        {
+            path += static_cast<char>(code);
+            i += 2;
+        }
+        else
+            path += uri[i];
+    }
+
+    return path;
+}
+
+static int hzglComponents(const std::string& type)
+{
+    if (type == "SCALAR")
+        return 1;
+    if (type == "VEC2")
+        return 2;
+    if (type == "VEC3")
+        return 3;
+    if (type == "VEC4")
+        return 4;
+
+    return 0;       // matrices are not vertex attributes here
+}
+
+static size_t hzglComponentSize(GLenum type)
+{
+    switch (type)
+    {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE:
+        return 1;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+        return 2;
+    case GL_UNSIGNED_INT:
+    case GL_FLOAT:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+// a normalized integer as the GL maps it: to [-1, 1] for signed types, [0, 1] for unsigned ones
+static float hzglNormalized(GLenum type, float v)
+{
+    switch (type)
+    {
+    case GL_BYTE:
+        return std::max(v / 127.0f, -1.0f);
+    case GL_UNSIGNED_BYTE:
+        return v / 255.0f;
+    case GL_SHORT:
+        return std::max(v / 32767.0f, -1.0f);
+    case GL_UNSIGNED_SHORT:
+        return v / 65535.0f;
+    default:
+        return v;
+    }
+}
+
+//
+// GltfAsset
+//
+
+hzgl::GltfAsset::GltfAsset()
+{
+}
+
+bool hzgl::GltfAsset::Open(const std::string& filepath)
+{
+    HZGL_PROFILE_SCOPE("GltfAsset::Open");
+
+    _path = filepath;
+
+    if (!_file.Open(filepath) || _file.Size() < 12)
+        return false;
+
+    const uint8_t* data = _file.Data();
+    const char* json = reinterpret_cast<const char*>(data);
+    const char* jsonEnd = json + _file.Size();
+    const uint8_t* binary = nullptr;
+    size_t binaryLength = 0;
+
+    // .glb: a 12-byte header, the JSON chunk and an optional binary chunk
+    uint32_t header[3];
+    memcpy(header, data, sizeof(header));
+
+    if (header[0] == 0x46546c67)
+    {
+        if (header[1] != 2 || header[2] > _file.Size() || _file.Size() < 20)
+            return false;
+
+        uint32_t chunk[2];
+        memcpy(chunk, data + 12, sizeof(chunk));
+
+        if (chunk[1] != 0x4e4f534a || 20 + static_cast<size_t>(chunk[0]) > header[2])
+            return false;
+
+        json = reinterpret_cast<const char*>(data + 20);
+        jsonEnd = json + chunk[0];
+
+        size_t next = 20 + ((static_cast<size_t>(chunk[0]) + 3) & ~static_cast<size_t>(3));
+        if (next + 8 <= header[2])
+        {
+            memcpy(chunk, data + next, sizeof(chunk));
+
+            if (chunk[1] == 0x004e4942 && next + 8 + chunk[0] <= header[2])
+            {
+                binary = data + next + 8;
+                binaryLength = chunk[0];
+            }
+        }
+    }
+
+    JsonValue root;
+    {
+        HZGL_PROFILE_SCOPE("ParseJson");
+
+        if (!hzglParseJson(json, jsonEnd, root) || root.type != JsonValue::Object)
+        {
+            std::cerr << filepath << ": not valid glTF JSON" << std::endl;
+            return false;
+        }
+    }
+
+    const JsonValue* asset = root.Find("asset");
+    if (asset == nullptr || hzglJsonString(asset->Find("version")).compare(0, 1, "2") != 0)
+        return false;
+
+    // quantized attributes are plain GL vertex formats, anything else needs a decoder
+    for (const auto& extension : hzglJsonItems(root, "extensionsRequired"))
+    {
+        if (extension.string != "KHR_mesh_quantization")
+            return false;
+    }
+
+    std::string parentpath = GetParentPath(GetAbsolutePath(filepath));
+
+    // buffers: the binary chunk, files next to this one, or data URIs
+    std::vector<std::pair<const uint8_t*, size_t>> buffers;
+
+    for (const auto& buffer : hzglJsonItems(root, "buffers"))
+    {
+        std::string uri = hzglJsonString(buffer.Find("uri"));
+        size_t length = hzglJsonSize(buffer.Find("byteLength"));
+
+        if (uri.empty())
+        {
+            if (binary == nullptr || length > binaryLength)
+                return false;
+
+            buffers.push_back({binary, length});
+        }
+        else if (uri.compare(0, 5, "data:") == 0)
+        {
+            size_t comma = uri.find(',');
+            if (comma == std::string::npos || uri.find(";base64") > comma)
+                return false;
+
+            _decoded.emplace_back();
+            if (!hzglDecodeBase64(uri.c_str() + comma + 1, uri.c_str() + uri.size(), _decoded.back()) || _decoded.back().size() < length)
+                return false;
+
+            buffers.push_back({_decoded.back().data(), length});
+        }
+        else
+        {
+            _external.emplace_back(new MappedFile());
+            if (!_external.back()->Open(parentpath + "/" + hzglDecodeUri(uri)) || _external.back()->Size() < length)
+            {
+                std::cerr << filepath << ": missing buffer " << uri << std::endl;
+                return false;
+            }
+
+            buffers.push_back({_external.back()->Data(), length});
+        }
+    }
+
+    for (const auto& view : hzglJsonItems(root, "bufferViews"))
+    {
+        int buffer = hzglJsonInt(view.Find("buffer"));
+        size_t offset = hzglJsonSize(view.Find("byteOffset"));
+
+        GltfBufferView bufferView;
+        bufferView.length = hzglJsonSize(view.Find("byteLength"));
+        bufferView.stride = hzglJsonInt(view.Find("byteStride"), 0);
+
+        if (buffer < 0 || buffer >= static_cast<int>(buffers.size()) || offset + bufferView.length > buffers[buffer].second
+            || bufferView.stride < 0 || bufferView.stride > 252)
+            return false;
+
+        bufferView.data = buffers[buffer].first + offset;
+        _views.push_back(bufferView);
+    }
+
+    for (const auto& accessor : hzglJsonItems(root, "accessors"))
+    {
+        GltfAccessor a;
+        a.view = hzglJsonInt(accessor.Find("bufferView"));
+        a.offset = hzglJsonSize(accessor.Find("byteOffset"));
+        a.component_type = static_cast<GLenum>(hzglJsonInt(accessor.Find("componentType"), 0));
+        a.components = hzglComponents(hzglJsonString(accessor.Find("type")));
+        a.count = hzglJsonSize(accessor.Find("count"));
+
+        const JsonValue* normalized = accessor.Find("normalized");
+        a.normalized = (normalized != nullptr && normalized->number != 0.0);
+
+        const JsonValue* lo = accessor.Find("min");
+        const JsonValue* hi = accessor.Find("max");
+        for (int k = 0; k < 3; k++)
+        {
+            if (lo != nullptr && hi != nullptr && lo->items.size() > static_cast<size_t>(k) && hi->items.size() > static_cast<size_t>(k))
+            {
+                a.min[k] = static_cast<float>(lo->items[k].number);
+                a.max[k] = static_cast<float>(hi->items[k].number);
+            }
+
+            // the bounds of quantized data are in the stored units
+            if (a.normalized)
+            {
+                a.min[k] = hzglNormalized(a.component_type, a.min[k]);
+                a.max[k] = hzglNormalized(a.component_type, a.max[k]);
+            }
+        }
+
+        // accessors are checked where they are used, this one just has to stay inside its view
+        if (accessor.Find("sparse") == nullptr && a.view >= 0 && a.view < static_cast<int>(_views.size()) && a.components > 0
+            && hzglComponentSize(a.component_type) > 0 && a.count > 0)
+        {
+            size_t size = a.components * hzglComponentSize(a.component_type);
+            size_t stride = (_views[a.view].stride > 0) ? _views[a.view].stride : size;
+
+            if (a.offset + (a.count - 1) * stride + size > _views[a.view].length)
+                a.view = -1;
+        }
+        else
+            a.view = -1;
+
+        _accessors.push_back(a);
+    }
+
+    // images and the textures that point at them
+    for (const auto& image : hzglJsonItems(root, "images"))
+    {
+        GltfImage gltfImage;
+        std::string uri = hzglJsonString(image.Find("uri"));
+
+        gltfImage.view = hzglJsonInt(image.Find("bufferView"));
+        if (gltfImage.view >= static_cast<int>(_views.size()))
+            gltfImage.view = -1;
+
+        // data URIs are left out (no texture rather than another copy of the image)
+        if (!uri.empty() && uri.compare(0, 5, "data:") != 0)
+            gltfImage.path = parentpath + "/" + hzglDecodeUri(uri);
+
+        _images.push_back(gltfImage);
+    }
+
+    std::vector<int> textureImages;
+    for (const auto& texture : hzglJsonItems(root, "textures"))
+    {
+        int source = hzglJsonInt(texture.Find("source"));
+        textureImages.push_back((source >= 0 && source < static_cast<int>(_images.size())) ? source : -1);
+    }
+
+    auto materialImage = [&textureImages](const JsonValue* info) {
+        int texture = (info != nullptr) ? hzglJsonInt(info->Find("index")) : -1;
+        return (texture >= 0 && texture < static_cast<int>(textureImages.size())) ? textureImages[texture] : -1;
+    };
+
+    const std::vector<JsonValue>& materials = hzglJsonItems(root, "materials");
+    const std::vector<JsonValue>& meshes = hzglJsonItems(root, "meshes");
+    const std::vector<JsonValue>& nodes = hzglJsonItems(root, "nodes");
+
+    // the hierarchy: one root above the nodes of the scene, parents first
+    NodeInfo rootNode;
+    rootNode.name = filepath.substr(filepath.find_last_of("/\\") + 1);
+    for (int i = 0; i < 16; i++)
+        rootNode.transform[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+    _nodes.push_back(rootNode);
+
+    std::vector<int> roots;
+    const std::vector<JsonValue>& scenes = hzglJsonItems(root, "scenes");
+    int scene = hzglJsonInt(root.Find("scene"), 0);
+
+    if (scene >= 0 && scene < static_cast<int>(scenes.size()))
+    {
+        for (const auto& node : hzglJsonItems(scenes[scene], "nodes"))
+            roots.push_back(hzglJsonInt(&node));
+    }
+    else
+    {
+        // no scene: every node that is nobody's child
+        std::vector<bool> child(nodes.size(), false);
+        for (const auto& node : nodes)
+        {
+            for (const auto& c : hzglJsonItems(node, "children"))
+            {
+                int index = hzglJsonInt(&c);
+                if (index >= 0 && index < static_cast<int>(nodes.size()))
+                    child[index] = true;
+            }
+        }
+
+        for (size_t n = 0; n < nodes.size(); n++)
+        {
+            if (!child[n])
+                roots.push_back(static_cast<int>(n));
+        }
+    }
+
+    std::vector<bool> visited(nodes.size(), false);
+    bool ok = true;
+
+    std::function<void(int, int)> addNode = [&](int n, int parent) {
+        if (n < 0 || n >= static_cast<int>(nodes.size()) || visited[n])
+            return;
+
+        visited[n] = true;
+
+        const JsonValue& node = nodes[n];
+        NodeInfo info;
+        info.name = hzglJsonString(node.Find("name"));
+        info.parent = parent;
+
+        // column-major either way: a matrix, or translation * rotation * scale
+        const JsonValue* matrix = node.Find("matrix");
+        if (matrix != nullptr && matrix->items.size() == 16)
+        {
+            for (int i = 0; i < 16; i++)
+                info.transform[i] = static_cast<float>(matrix->items[i].number);
+        }
+        else
+        {
+            float t[3] = {0.0f, 0.0f, 0.0f}, r[4] = {0.0f, 0.0f, 0.0f, 1.0f}, s[3] = {1.0f, 1.0f, 1.0f};
+            const JsonValue* values[3] = {node.Find("translation"), node.Find("rotation"), node.Find("scale")};
+            float* targets[3] = {t, r, s};
+
+            for (int v = 0; v < 3; v++)
+            {
+                for (size_t i = 0; values[v] != nullptr && i < values[v]->items.size() && i < (v == 1 ? 4u : 3u); i++)
+                    targets[v][i] = static_cast<float>(values[v]->items[i].number);
+            }
+
+            float x = r[0], y = r[1], z = r[2], w = r[3];
+            float rotation[9] = {
+                1 - 2 * (y * y + z * z), 2 * (x * y + z * w), 2 * (x * z - y * w),
+                2 * (x * y - z * w), 1 - 2 * (x * x + z * z), 2 * (y * z + x * w),
+                2 * (x * z + y * w), 2 * (y * z - x * w), 1 - 2 * (x * x + y * y),
+            };
+
+            for (int c = 0; c < 3; c++)
+            {
+                for (int row = 0; row < 3; row++)
+                    info.transform[4 * c + row] = rotation[3 * c + row] * s[c];
+
+                info.transform[4 * c + 3] = 0.0f;
+            }
+
+            info.transform[12] = t[0];
+            info.transform[13] = t[1];
+            info.transform[14] = t[2];
+            info.transform[15] = 1.0f;
+        }
+
+        int index = static_cast<int>(_nodes.size());
+        _nodes.push_back(std::move(info));
+
+        int mesh = hzglJsonInt(node.Find("mesh"));
+        if (mesh >= 0 && mesh < static_cast<int>(meshes.size()))
+        {
+            const std::vector<JsonValue>& primitives = hzglJsonItems(meshes[mesh], "primitives");
+
+            for (size_t p = 0; p < primitives.size(); p++)
+            {
+                const JsonValue& primitive = primitives[p];
+                const JsonValue* attributes = primitive.Find("attributes");
+
+                GltfPrimitive prim;
+                prim.name = hzglJsonString(meshes[mesh].Find("name"));
+                if (primitives.size() > 1)
+                    prim.name += "#" + std::to_string(p);
+
+                prim.node = index;
+                prim.indices = hzglJsonInt(primitive.Find("indices"));
+
+                if (attributes != nullptr)
+                {
+                    prim.position = hzglJsonInt(attributes->Find("POSITION"));
+                    prim.normal = hzglJsonInt(attributes->Find("NORMAL"));
+                    prim.texcoord = hzglJsonInt(attributes->Find("TEXCOORD_0"));
+                    prim.tangent = hzglJsonInt(attributes->Find("TANGENT"));
+                }
+
+                int material = hzglJsonInt(primitive.Find("material"));
+                if (material >= 0 && material < static_cast<int>(materials.size()))
+                {
+                    const JsonValue* pbr = materials[material].Find("pbrMetallicRoughness");
+                    prim.base_color_image = materialImage((pbr != nullptr) ? pbr->Find("baseColorTexture") : nullptr);
+                    prim.normal_image = materialImage(materials[material].Find("normalTexture"));
+                }
+
+                // triangles with indices, positions and normals, or Assimp gets the file
+                auto valid = [this](int accessor, int minComponents) {
+                    return accessor >= 0 && accessor < static_cast<int>(_accessors.size()) && _accessors[accessor].view >= 0
+                        && _accessors[accessor].components >= minComponents;
+                };
+
+                if (hzglJsonInt(primitive.Find("mode"), 4) != 4 || !valid(prim.position, 3) || !valid(prim.normal, 3) || !valid(prim.indices, 1))
+                {
+                    ok = false;
+                    continue;
+                }
+
+                const GltfAccessor& indices = _accessors[prim.indices];
+                size_t indexSize = hzglComponentSize(indices.component_type);
+
+                // element buffers are tightly packed and aligned
+                if (indices.components != 1 || indices.component_type == GL_FLOAT || indices.component_type == GL_BYTE
+                    || indices.component_type == GL_SHORT || _views[indices.view].stride > static_cast<int>(indexSize)
+                    || indices.offset % indexSize != 0 || indices.count % 3 != 0)
+                {
+                    ok = false;
+                    continue;
+                }
+
+                prim.texcoord = valid(prim.texcoord, 2) ? prim.texcoord : -1;
+                prim.tangent = valid(prim.tangent, 4) ? prim.tangent : -1;
+
+                _primitives.push_back(prim);
+            }
+        }
+
+        for (const auto& c : hzglJsonItems(node, "children"))
+            addNode(hzglJsonInt(&c), index);
+    };
+
+    for (int n : roots)
+        addNode(n, 0);
+
+    if (!ok || _primitives.empty())
+        return false;
+
+    // the index ranges must stay inside the vertices
+    for (const auto& prim : _primitives)
+    {
+        const GltfAccessor& indices = _accessors[prim.indices];
+        const uint8_t* p = Data(prim.indices);
+        size_t count = _accessors[prim.position].count;
+        uint32_t maxIndex = 0;
+
+        for (size_t i = 0; i < indices.count; i++)
+        {
+            uint32_t index = 0;
+            memcpy(&index, p + i * hzglComponentSize(indices.component_type), hzglComponentSize(indices.component_type));
+            maxIndex = std::max(maxIndex, index);
+        }
+
+        if (maxIndex >= count || _accessors[prim.normal].count < count
+            || (prim.texcoord >= 0 && _accessors[prim.texcoord].count < count) || (prim.tangent >= 0 && _accessors[prim.tangent].count < count))
+            return false;
+    }
+
+    return true;
+}
+
+const std::string& hzgl::GltfAsset::Path() const
+{
+    return _path;
+}
+
+const std::vector<hzgl::GltfBufferView>& hzgl::GltfAsset::Views() const
+{
+    return _views;
+}
+
+const std::vector<hzgl::GltfAccessor>& hzgl::GltfAsset::Accessors() const
+{
+    return _accessors;
+}
+
+const std::vector<hzgl::GltfPrimitive>& hzgl::GltfAsset::Primitives() const
+{
+    return _primitives;
+}
+
+const std::vector<hzgl::NodeInfo>& hzgl::GltfAsset::Nodes() const
+{
+    return _nodes;
+}
+
+const std::vector<hzgl::GltfImage>& hzgl::GltfAsset::Images() const
+{
+    return _images;
+}
+
+size_t hzgl::GltfAsset::ElementSize(int accessor) const
+{
+    const GltfAccessor& a = _accessors[accessor];
+    return a.components * hzglComponentSize(a.component_type);
+}
+
+size_t hzgl::GltfAsset::Stride(int accessor) const
+{
+    int stride = _views[_accessors[accessor].view].stride;
+    return (stride > 0) ? stride : ElementSize(accessor);
+}
+
+const uint8_t* hzgl::GltfAsset::Data(int accessor) const
+{
+    const GltfAccessor& a = _accessors[accessor];
+    return _views[a.view].data + a.offset;
+}
+
+void hzgl::GltfAsset::Read(int accessor, size_t i, float* values, int count) const
+{
+    const GltfAccessor& a = _accessors[accessor];
+    const uint8_t* p = Data(accessor) + i * Stride(accessor);
+
+    for (int k = 0; k < count; k++)
+    {
+        if (k >= a.components)
+        {
+            values[k] = 0.0f;
+            continue;
+        }
+
+        switch (a.component_type)
+        {
+        case GL_BYTE:
+        {
+            int8_t v;
+            memcpy(&v, p + k, 1);
+            values[k] = a.normalized ? hzglNormalized(a.component_type, v) : v;
+            break;
+        }
+        case GL_UNSIGNED_BYTE:
+            values[k] = a.normalized ? hzglNormalized(a.component_type, p[k]) : p[k];
+            break;
+        case GL_SHORT:
+        {
+            int16_t v;
+            memcpy(&v, p + 2 * k, 2);
+            values[k] = a.normalized ? hzglNormalized(a.component_type, v) : v;
+            break;
+        }
+        case GL_UNSIGNED_SHORT:
+        {
+            uint16_t v;
+            memcpy(&v, p + 2 * k, 2);
+            values[k] = a.normalized ? hzglNormalized(a.component_type, v) : v;
+            break;
+        }
+        case GL_UNSIGNED_INT:
+        {
+            uint32_t v;
+            memcpy(&v, p + 4 * k, 4);
+            values[k] = static_cast<float>(v);
+            break;
+        }
+        default:
+            memcpy(&values[k], p + 4 * k, 4);
+            break;
+        }
+    }
+}
+
+std::string hzgl::GltfAsset::ImageName(int image) const
+{
+    return _path + "#image" + std::to_string(image);
+}
+
+bool hzgl::GltfAsset::DecodeImage(int image, ImageData* pixels) const
+{
+    if (image < 0 || image >= static_cast<int>(_images.size()))
+        return false;
+
+    const GltfImage& source = _images[image];
+
+    if (source.view >= 0)
+        return hzgl::DecodeImage(_views[source.view].data, _views[source.view].length, pixels, false);
+
+    return !source.path.empty() && Exists(source.path) && hzgl::DecodeImage(source.path, pixels, false);
+}
+
+bool hzgl::IsGltfFile(const std::string& filepath)
+{
+    std::string ext = GetExtension(filepath);
+    return ext == "gltf" || ext == "glb";
+}
+
+bool hzgl::GltfNeedsTangents(const GltfPrimitive& primitive)
+{
+    return primitive.normal_image >= 0 && primitive.texcoord >= 0 && primitive.tangent < 0;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Mesh.hpp"
+#include "Texture.hpp"
+#include "MappedFile.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+namespace hzgl
+{
+    // a byte range of a buffer, in the mapping of the .glb (or of the .bin next to a .gltf)
+    typedef struct
+    {
+        const uint8_t* data = nullptr;
+        size_t length = 0;
+        int stride = 0;                 // 0: tightly packed
+    } GltfBufferView;
+
+    // an accessor as glVertexAttribPointer takes it: glTF component types are the GL enums
+    typedef struct
+    {
+        int view = -1;
+        size_t offset = 0;              // within the view
+        GLenum component_type = GL_FLOAT;
+        int components = 1;
+        bool normalized = false;
+        size_t count = 0;
+        float min[3] = {0.0f, 0.0f, 0.0f};     // POSITION only, normalized like Read()
+        float max[3] = {0.0f, 0.0f, 0.0f};
+    } GltfAccessor;
+
+    typedef struct
+    {
+        std::string name;
+        int node = -1;                  // into Nodes(), one primitive per node that shows its mesh
+        int position = -1;              // accessors, -1 if missing
+        int normal = -1;
+        int texcoord = -1;
+        int tangent = -1;
+        int indices = -1;
+        int base_color_image = -1;      // into the images, -1 if missing
+        int normal_image = -1;
+    } GltfPrimitive;
+
+    typedef struct
+    {
+        std::string path;               // empty when the image is in a buffer view
+        int view = -1;
+    } GltfImage;
+
+    // a glTF 2.0 file (.gltf with .bin files or data URIs, or .glb) read in place: nothing but the
+    // JSON is parsed, and the vertex and index data stay in the mapping until they are uploaded.
+    // Open() turns down what it cannot draw as is (other primitive modes, sparse or missing
+    // accessors, required extensions, meshes without normals), which the caller hands to Assimp
+    class GltfAsset
+    {
+    private:
+        MappedFile _file;
+        std::vector<std::unique_ptr<MappedFile>> _external;     // .bin files
+        std::vector<std::vector<uint8_t>> _decoded;             // data URIs
+
+        std::string _path;
+        std::vector<GltfBufferView> _views;
+        std::vector<GltfAccessor> _accessors;
+        std::vector<GltfPrimitive> _primitives;
+        std::vector<NodeInfo> _nodes;
+        std::vector<GltfImage> _images;
+
+    public:
+        GltfAsset();
+
+        GltfAsset(const GltfAsset&) = delete;
+        GltfAsset& operator=(const GltfAsset&) = delete;
+
+        bool Open(const std::string& filepath);
+
+        const std::string& Path() const;
+        const std::vector<GltfBufferView>& Views() const;
+        const std::vector<GltfAccessor>& Accessors() const;
+        const std::vector<GltfPrimitive>& Primitives() const;
+        const std::vector<NodeInfo>& Nodes() const;     // parents first, like LoadMeshesFromFile
+        const std::vector<GltfImage>& Images() const;
+
+        // bytes of one element of an accessor
+        size_t ElementSize(int accessor) const;
+
+        // bytes from one element of an accessor to the next
+        size_t Stride(int accessor) const;
+
+        // where the first element of an accessor is
+        const uint8_t* Data(int accessor) const;
+
+        // element i of an accessor as floats (normalized integers are mapped to [-1, 1] or [0, 1])
+        void Read(int accessor, size_t i, float* values, int count) const;
+
+        // images belong to the file: their texture names are "<path>#image<N>"
+        std::string ImageName(int image) const;
+
+        // glTF puts the texture origin at the top left, as the images are stored, so they are
+        // not flipped
+        bool DecodeImage(int image, ImageData* pixels) const;
+    };
+
+    // .gltf or .glb
+    bool IsGltfFile(const std::string& filepath);
+
+    // a normal map without TANGENT: the frames cannot be made in place, since the vertices are
+    // split wherever they disagree, so ParseModel converts the primitive to a MeshInfo
+    bool GltfNeedsTangents(const GltfPrimitive& primitive);
+} // namespace hzgl
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace hzgl
+{
+    // a slot of a HandlePool and the generation it was filled in; when the resource goes the
+    // slot's generation moves on, so a handle kept past that is turned away instead of reaching
+    // whatever is put in the slot next
+    template <typename Tag>
+    struct Handle
+    {
+        uint32_t index = 0;
+        uint32_t generation = 0;    // 0 is never handed out
+
+        bool IsValid() const { return generation != 0; }
+
+        bool operator==(const Handle& other) const { return index == other.index && generation == other.generation; }
+        bool operator!=(const Handle& other) const { return !(*this == other); }
+    };
+
+    typedef Handle<struct MeshTag> MeshHandle;
+    typedef Handle<struct TextureTag> TextureHandle;
+    typedef Handle<struct ShaderTag> ShaderHandle;
+    typedef Handle<struct ProgramTag> ProgramHandle;
+
+    // items stored contiguously (removal moves the last one into the gap) behind a table of slots
+    // that map handles to their current position; freed slots are reused, oldest first
+    template <typename T, typename Tag>
+    class HandlePool
+    {
+    private:
+        std::vector<T> _items;
+        std::vector<uint32_t> _itemSlots;       // slot of each item
+        std::vector<uint32_t> _slotItems;       // item of each slot, while it is in use
+        std::vector<uint32_t> _generations;     // of each slot
+        std::vector<uint32_t> _freeSlots;
+        size_t _nextFree = 0;                   // _freeSlots is used as a queue
+
+        bool live(Handle<Tag> handle) const
+        {
+            return handle.generation != 0 && handle.index < _generations.size() && _generations[handle.index] == handle.generation;
+        }
+
+        void retire(uint32_t slot)
+        {
+            // skip 0 on wrap-around so that a default handle stays invalid
+            if (++_generations[slot] == 0)
+                _generations[slot] = 1;
+
+            _freeSlots.push_back(slot);
+        }
+
+    public:
+        HandlePool() = default;
+
+        HandlePool(const HandlePool&) = delete;
+        HandlePool& operator=(const HandlePool&) = delete;
+
+        Handle<Tag> Insert(T&& item)
+        {
+            uint32_t slot;
+
+            if (_nextFree < _freeSlots.size())
+                slot = _freeSlots[_nextFree++];
+            else
+            {
+                slot = static_cast<uint32_t>(_generations.size());
+                _generations.push_back(1);
+                _slotItems.push_back(0);
+            }
+
+            // drop the consumed part of the queue once it is the larger one
+            if (_nextFree > 32 && 2 * _nextFree > _freeSlots.size())
+            {
+                _freeSlots.erase(_freeSlots.begin(), _freeSlots.begin() + _nextFree);
+                _nextFree = 0;
+            }
+
+            _slotItems[slot] = static_cast<uint32_t>(_items.size());
+            _items.push_back(std::move(item));
+            _itemSlots.push_back(slot);
+
+            Handle<Tag> handle;
+            handle.index = slot;
+            handle.generation = _generations[slot];
+
+            return handle;
+        }
+
+        // nullptr for handles that are stale or were never valid
+        T* Get(Handle<Tag> handle)
+        {
+            return live(handle) ? &_items[_slotItems[handle.index]] : nullptr;
+        }
+
+        const T* Get(Handle<Tag> handle) const
+        {
+            return live(handle) ? &_items[_slotItems[handle.index]] : nullptr;
+        }
+
+        bool Contains(Handle<Tag> handle) const
+        {
+            return live(handle);
+        }
+
+        // the item is moved to removed (if given) before its storage is reused
+        bool Remove(Handle<Tag> handle, T* removed = nullptr)
+        {
+            if (!live(handle))
+                return false;
+
+            uint32_t item = _slotItems[handle.index];
+            uint32_t last = static_cast<uint32_t>(_items.size() - 1);
+
+            if (removed != nullptr)
+                *removed = std::move(_items[item]);
+
+            if (item != last)
+            {
+                _items[item] = std::move(_items[last]);
+                _itemSlots[item] = _itemSlots[last];
+                _slotItems[_itemSlots[item]] = item;
+            }
+
+            _items.pop_back();
+            _itemSlots.pop_back();
+            retire(handle.index);
+
+            return true;
+        }
+
+        // invalidates every handle given out so far
+        void Clear()
+        {
+            for (uint32_t slot : _itemSlots)
+                retire(slot);
+
+            _items.clear();
+            _itemSlots.clear();
+        }
+
+        size_t Size() const { return _items.size(); }
+
+        // the items in storage order, which changes when one is removed
+        T& At(size_t i) { return _items[i]; }
+        const T& At(size_t i) const { return _items[i]; }
+
+        Handle<Tag> HandleAt(size_t i) const
+        {
+            Handle<Tag> handle;
+            handle.index = _itemSlots[i];
+            handle.generation = _generations[handle.index];
+            return handle;
+        }
+    };
+} // namespace hzgl
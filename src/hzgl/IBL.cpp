@@ -0,0 +1,717 @@
+#include "IBL.hpp"
+
+#include "Timer.hpp"
+#include "Texture.hpp"
+#include "Profiler.hpp"
+#include "ThreadPool.hpp"
+#include "Filesystem.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <algorithm>
+#include <functional>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #define HZGL_IBL_SSE
+    #include <xmmintrin.h>
+#endif
+
+static const float hzglPi = 3.14159265358979f;
+
+// bump when the layout of the cache files or the precompute changes
+static const uint32_t hzglCacheMagic = 0x4c42495a;     // "ZIBL"
+static const uint32_t hzglCacheVersion = 2;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+} CacheHeader;
+
+const char* hzgl::IBLSimdPath()
+{
+#if defined(HZGL_IBL_SSE)
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
+
+uint64_t hzgl::HashBytes(const void* data, size_t size, uint64_t seed)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+bool hzgl::HashFile(const std::string& filepath, uint64_t* hash)
+{
+    FILE* fp = fopen(filepath.c_str(), "rb");
+
+    if (fp == nullptr)
+        return false;
+
+    std::vector<unsigned char> chunk(1 << 20);
+    uint64_t result = 14695981039346656037ull;
+    size_t n = 0;
+
+    while ((n = fread(chunk.data(), 1, chunk.size(), fp)) > 0)
+        result = HashBytes(chunk.data(), n, result);
+
+    fclose(fp);
+    *hash = result;
+
+    return true;
+}
+
+bool hzgl::LoadHDRImage(const std::string& filepath, HDRImage* image)
+{
+    int width = 0, height = 0, n = 0;
+    float* data = DecodeImageHDR(filepath, &width, &height, &n, 3);
+
+    if (data == nullptr)
+        return false;
+
+    image->width = width;
+    image->height = height;
+    image->pixels.assign(data, data + 3 * static_cast<size_t>(width) * height);
+
+    FreeImageHDR(data);
+
+    return true;
+}
+
+// 2x2 box filter, the last row or column is repeated for odd sizes
+static void hzglHalve(const hzgl::HDRImage& image, hzgl::HDRImage* result)
+{
+    int width = std::max(image.width / 2, 1);
+    int height = std::max(image.height / 2, 1);
+
+    result->width = width;
+    result->height = height;
+    result->pixels.resize(3 * static_cast<size_t>(width) * height);
+
+    for (int y = 0; y < height; y++)
+    {
+        int y0 = std::min(2 * y, image.height - 1);
+        int y1 = std::min(2 * y + 1, image.height - 1);
+
+        for (int x = 0; x < width; x++)
+        {
+            int x0 = std::min(2 * x, image.width - 1);
+            int x1 = std::min(2 * x + 1, image.width - 1);
+
+            for (int c = 0; c < 3; c++)
+            {
+                float sum = image.pixels[3 * (static_cast<size_t>(y0) * image.width + x0) + c]
+                          + image.pixels[3 * (static_cast<size_t>(y0) * image.width + x1) + c]
+                          + image.pixels[3 * (static_cast<size_t>(y1) * image.width + x0) + c]
+                          + image.pixels[3 * (static_cast<size_t>(y1) * image.width + x1) + c];
+
+                result->pixels[3 * (static_cast<size_t>(y) * width + x) + c] = 0.25f * sum;
+            }
+        }
+    }
+}
+
+void hzgl::DownsampleHDR(const HDRImage& image, int maxWidth, HDRImage* result)
+{
+    *result = image;
+
+    while (result->width > maxWidth)
+    {
+        HDRImage half;
+        hzglHalve(*result, &half);
+        *result = std::move(half);
+    }
+}
+
+// direction through the center of pixel (x, y)
+static glm::vec3 hzglTexelDirection(int x, int y, int width, int height)
+{
+    float phi = 2.0f * hzglPi * (x + 0.5f) / width - hzglPi;
+    float theta = hzglPi * (y + 0.5f) / height;
+
+    return glm::vec3(std::sin(theta) * std::sin(phi), std::cos(theta), -std::sin(theta) * std::cos(phi));
+}
+
+// bilinear, wrapping around in longitude
+static glm::vec3 hzglSample(const hzgl::HDRImage& image, const glm::vec3& d)
+{
+    float u = (std::atan2(d.x, -d.z) + hzglPi) / (2.0f * hzglPi);
+    float v = std::acos(glm::clamp(d.y, -1.0f, 1.0f)) / hzglPi;
+
+    float fx = u * image.width - 0.5f;
+    float fy = glm::clamp(v * image.height - 0.5f, 0.0f, static_cast<float>(image.height - 1));
+
+    int x0 = static_cast<int>(std::floor(fx));
+    int y0 = static_cast<int>(fy);
+    float tx = fx - x0;
+    float ty = fy - y0;
+
+    int x1 = (x0 + 1) % image.width;
+    x0 = (x0 + image.width) % image.width;
+    int y1 = std::min(y0 + 1, image.height - 1);
+
+    const float* p00 = &image.pixels[3 * (static_cast<size_t>(y0) * image.width + x0)];
+    const float* p10 = &image.pixels[3 * (static_cast<size_t>(y0) * image.width + x1)];
+    const float* p01 = &image.pixels[3 * (static_cast<size_t>(y1) * image.width + x0)];
+    const float* p11 = &image.pixels[3 * (static_cast<size_t>(y1) * image.width + x1)];
+
+    glm::vec3 result;
+    for (int c = 0; c < 3; c++)
+    {
+        float top = p00[c] + (p10[c] - p00[c]) * tx;
+        float bottom = p01[c] + (p11[c] - p01[c]) * tx;
+        result[c] = top + (bottom - top) * ty;
+    }
+
+    return result;
+}
+
+static glm::vec2 hzglHammersley(uint32_t i, uint32_t n)
+{
+    uint32_t bits = i;
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+
+    return glm::vec2(static_cast<float>(i) / n, bits * 2.3283064365386963e-10f);
+}
+
+// half vector around +z, distributed like the GGX normal distribution
+static glm::vec3 hzglSampleGGX(const glm::vec2& xi, float roughness)
+{
+    float a = roughness * roughness;
+    float phi = 2.0f * hzglPi * xi.x;
+    float cosTheta = std::sqrt((1.0f - xi.y) / (1.0f + (a * a - 1.0f) * xi.y));
+    float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+
+    return glm::vec3(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta);
+}
+
+// rows split into a few bands per worker, body(begin, end, band) runs once per band
+static int hzglBandCount(hzgl::ThreadPool* pool, int rows)
+{
+    return (pool == nullptr) ? 1 : std::max(std::min(rows, 4 * pool->NumThreads()), 1);
+}
+
+static void hzglForBands(hzgl::ThreadPool* pool, int rows, int bands, const std::function<void(int, int, int)>& body)
+{
+    if (pool == nullptr || bands <= 1)
+    {
+        body(0, rows, 0);
+        return;
+    }
+
+    for (int b = 0; b < bands; b++)
+    {
+        int begin = rows * b / bands;
+        int end = rows * (b + 1) / bands;
+        pool->Submit([&body, begin, end, b]() { body(begin, end, b); });
+    }
+
+    pool->Wait();
+}
+
+void hzgl::ProjectIrradianceSH9(const HDRImage& environment, glm::vec3 sh[9], ThreadPool* pool)
+{
+    HZGL_PROFILE_SCOPE("ProjectIrradianceSH9");
+
+    int width = environment.width;
+    int height = environment.height;
+
+    // longitude terms are the same for every row
+    std::vector<float> sinPhi(width), cosPhi(width);
+    for (int x = 0; x < width; x++)
+    {
+        float phi = 2.0f * hzglPi * (x + 0.5f) / width - hzglPi;
+        sinPhi[x] = std::sin(phi);
+        cosPhi[x] = std::cos(phi);
+    }
+
+    // 9 coefficients x 3 channels per band, summed in double at the end
+    int bands = hzglBandCount(pool, height);
+    std::vector<double> partial(27 * bands, 0.0);
+
+    hzglForBands(pool, height, bands, [&](int begin, int end, int band) {
+        double* sums = &partial[27 * band];
+
+        for (int y = begin; y < end; y++)
+        {
+            float theta = hzglPi * (y + 0.5f) / height;
+            float cosTheta = std::cos(theta);
+            float sinTheta = std::sin(theta);
+
+            // solid angle of the texels in this row
+            float weight = (2.0f * hzglPi / width) * (hzglPi / height) * sinTheta;
+
+            const float* row = &environment.pixels[3 * static_cast<size_t>(y) * width];
+            float rowSums[27] = {};
+            int x = 0;
+
+#if defined(HZGL_IBL_SSE)
+            // four texels at a time, one register per basis function and channel
+            __m128 acc[27];
+            for (int k = 0; k < 27; k++)
+                acc[k] = _mm_setzero_ps();
+
+            __m128 vy = _mm_set1_ps(cosTheta);
+            __m128 vs = _mm_set1_ps(sinTheta);
+
+            for (; x + 4 <= width; x += 4)
+            {
+                __m128 vx = _mm_mul_ps(vs, _mm_loadu_ps(&sinPhi[x]));
+                __m128 vz = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(vs, _mm_loadu_ps(&cosPhi[x])));
+
+                __m128 basis[9];
+                basis[0] = _mm_set1_ps(0.282095f);
+                basis[1] = _mm_mul_ps(_mm_set1_ps(0.488603f), vy);
+                basis[2] = _mm_mul_ps(_mm_set1_ps(0.488603f), vz);
+                basis[3] = _mm_mul_ps(_mm_set1_ps(0.488603f), vx);
+                basis[4] = _mm_mul_ps(_mm_set1_ps(1.092548f), _mm_mul_ps(vx, vy));
+                basis[5] = _mm_mul_ps(_mm_set1_ps(1.092548f), _mm_mul_ps(vy, vz));
+                basis[6] = _mm_mul_ps(_mm_set1_ps(0.315392f), _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(3.0f), _mm_mul_ps(vz, vz)), _mm_set1_ps(1.0f)));
+                basis[7] = _mm_mul_ps(_mm_set1_ps(1.092548f), _mm_mul_ps(vx, vz));
+                basis[8] = _mm_mul_ps(_mm_set1_ps(0.546274f), _mm_sub_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)));
+
+                const float* p = &row[3 * x];
+                __m128 color[3];
+                color[0] = _mm_setr_ps(p[0], p[3], p[6], p[9]);
+                color[1] = _mm_setr_ps(p[1], p[4], p[7], p[10]);
+                color[2] = _mm_setr_ps(p[2], p[5], p[8], p[11]);
+
+                for (int k = 0; k < 9; k++)
+                {
+                    acc[3 * k + 0] = _mm_add_ps(acc[3 * k + 0], _mm_mul_ps(basis[k], color[0]));
+                    acc[3 * k + 1] = _mm_add_ps(acc[3 * k + 1], _mm_mul_ps(basis[k], color[1]));
+                    acc[3 * k + 2] = _mm_add_ps(acc[3 * k + 2], _mm_mul_ps(basis[k], color[2]));
+                }
+            }
+
+            for (int k = 0; k < 27; k++)
+            {
+                float lanes[4];
+                _mm_storeu_ps(lanes, acc[k]);
+                rowSums[k] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+            }
+#endif
+
+            for (; x < width; x++)
+            {
+                float dx = sinTheta * sinPhi[x];
+                float dy = cosTheta;
+                float dz = -sinTheta * cosPhi[x];
+
+                float basis[9] = {
+                    0.282095f,
+                    0.488603f * dy, 0.488603f * dz, 0.488603f * dx,
+                    1.092548f * dx * dy, 1.092548f * dy * dz, 0.315392f * (3.0f * dz * dz - 1.0f),
+                    1.092548f * dx * dz, 0.546274f * (dx * dx - dy * dy),
+                };
+
+                for (int k = 0; k < 9; k++)
+                {
+                    rowSums[3 * k + 0] += basis[k] * row[3 * x + 0];
+                    rowSums[3 * k + 1] += basis[k] * row[3 * x + 1];
+                    rowSums[3 * k + 2] += basis[k] * row[3 * x + 2];
+                }
+            }
+
+            for (int k = 0; k < 27; k++)
+                sums[k] += static_cast<double>(weight) * rowSums[k];
+        }
+    });
+
+    // convolution with the clamped cosine (pi, 2pi/3, pi/4 per band), divided by pi
+    const float bandScale[9] = {1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f};
+
+    for (int k = 0; k < 9; k++)
+    {
+        glm::vec3 coefficient(0.0f);
+
+        for (int b = 0; b < bands; b++)
+        {
+            coefficient[0] += static_cast<float>(partial[27 * b + 3 * k + 0]);
+            coefficient[1] += static_cast<float>(partial[27 * b + 3 * k + 1]);
+            coefficient[2] += static_cast<float>(partial[27 * b + 3 * k + 2]);
+        }
+
+        sh[k] = coefficient * bandScale[k];
+    }
+}
+
+glm::vec3 hzgl::EvaluateIrradianceSH9(const glm::vec3 sh[9], const glm::vec3& n)
+{
+    return sh[0] * 0.282095f
+         + sh[1] * (0.488603f * n.y) + sh[2] * (0.488603f * n.z) + sh[3] * (0.488603f * n.x)
+         + sh[4] * (1.092548f * n.x * n.y) + sh[5] * (1.092548f * n.y * n.z)
+         + sh[6] * (0.315392f * (3.0f * n.z * n.z - 1.0f))
+         + sh[7] * (1.092548f * n.x * n.z) + sh[8] * (0.546274f * (n.x * n.x - n.y * n.y));
+}
+
+void hzgl::PrefilterGGX(const HDRImage& environment, const IBLOptions& options, std::vector<HDRImage>* levels, ThreadPool* pool)
+{
+    HZGL_PROFILE_SCOPE("PrefilterGGX");
+
+    // box-filtered chain of the source: wide lobes read from coarse levels instead of taking
+    // more samples (filtered importance sampling)
+    std::vector<HDRImage> source(1, environment);
+    while (source.back().width > 1)
+    {
+        HDRImage half;
+        hzglHalve(source.back(), &half);
+        source.push_back(std::move(half));
+    }
+
+    int maxLod = static_cast<int>(source.size()) - 1;
+    float texelSolidAngle = 4.0f * hzglPi / (static_cast<float>(environment.width) * environment.height);
+
+    typedef struct
+    {
+        glm::vec3 direction;            // around +z, the normal (and view direction)
+        float weight;                   // NdotL
+        int lod;
+    } LobeSample;
+
+    // the levels are the mip chain of one texture: each halves the last one down to 1x1, and
+    // there are no more levels than the chain has
+    int baseWidth = std::max(options.base_width, 1);
+    int chainLength = 1;
+    while ((baseWidth >> chainLength) > 0)
+        chainLength++;
+
+    std::vector<LobeSample> lobe;
+    int numLevels = glm::clamp(options.levels, 1, chainLength);
+    levels->resize(numLevels);
+
+    for (int k = 0; k < numLevels; k++)
+    {
+        HDRImage& level = (*levels)[k];
+        level.width = std::max(baseWidth >> k, 1);
+        level.height = std::max((baseWidth / 2) >> k, 1);
+        level.pixels.resize(3 * static_cast<size_t>(level.width) * level.height);
+
+        float roughness = (numLevels > 1) ? static_cast<float>(k) / (numLevels - 1) : 0.0f;
+
+        lobe.clear();
+
+        if (k == 0)
+        {
+            // a mirror: one lookup in the source level closest to the size of this one
+            float lod = std::log2(static_cast<float>(environment.width) / level.width);
+            lobe.push_back({glm::vec3(0, 0, 1), 1.0f, glm::clamp(static_cast<int>(lod + 0.5f), 0, maxLod)});
+        }
+        else
+        {
+            // the same directions around every normal, with N = V = R
+            float a = roughness * roughness;
+
+            for (int s = 0; s < options.samples; s++)
+            {
+                glm::vec3 h = hzglSampleGGX(hzglHammersley(s, options.samples), roughness);
+                glm::vec3 l = 2.0f * h.z * h - glm::vec3(0, 0, 1);
+
+                if (l.z <= 0.0f)
+                    continue;
+
+                float denominator = h.z * h.z * (a * a - 1.0f) + 1.0f;
+                float pdf = (a * a / (hzglPi * denominator * denominator)) / 4.0f;
+                float sampleSolidAngle = 1.0f / (options.samples * pdf + 0.0001f);
+                float lod = 0.5f * std::log2(sampleSolidAngle / texelSolidAngle) + 1.0f;
+
+                lobe.push_back({l, l.z, glm::clamp(static_cast<int>(lod + 0.5f), 0, maxLod)});
+            }
+        }
+
+        hzglForBands(pool, level.height, hzglBandCount(pool, level.height), [&](int begin, int end, int) {
+            for (int y = begin; y < end; y++)
+            {
+                for (int x = 0; x < level.width; x++)
+                {
+                    glm::vec3 n = hzglTexelDirection(x, y, level.width, level.height);
+                    glm::vec3 up = (std::abs(n.y) < 0.999f) ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0);
+                    glm::vec3 t = glm::normalize(glm::cross(up, n));
+                    glm::vec3 b = glm::cross(n, t);
+
+                    glm::vec3 sum(0.0f);
+                    float weight = 0.0f;
+
+                    for (const auto& sample : lobe)
+                    {
+                        glm::vec3 l = t * sample.direction.x + b * sample.direction.y + n * sample.direction.z;
+                        sum += hzglSample(source[sample.lod], l) * sample.weight;
+                        weight += sample.weight;
+                    }
+
+                    float* out = &level.pixels[3 * (static_cast<size_t>(y) * level.width + x)];
+                    out[0] = sum.x / weight;
+                    out[1] = sum.y / weight;
+                    out[2] = sum.z / weight;
+                }
+            }
+        });
+    }
+}
+
+void hzgl::ComputeBRDFLut(int size, int samples, std::vector<float>* lut, ThreadPool* pool)
+{
+    HZGL_PROFILE_SCOPE("ComputeBRDFLut");
+
+    lut->resize(2 * static_cast<size_t>(size) * size);
+
+    // rows are roughness, columns NdotV
+    hzglForBands(pool, size, hzglBandCount(pool, size), [&](int begin, int end, int) {
+        for (int j = begin; j < end; j++)
+        {
+            float roughness = (j + 0.5f) / size;
+            float k = roughness * roughness / 2.0f;
+
+            for (int i = 0; i < size; i++)
+            {
+                float NdotV = (i + 0.5f) / size;
+                glm::vec3 v(std::sqrt(1.0f - NdotV * NdotV), 0.0f, NdotV);
+
+                float scale = 0.0f;
+                float bias = 0.0f;
+
+                for (int s = 0; s < samples; s++)
+                {
+                    glm::vec3 h = hzglSampleGGX(hzglHammersley(s, samples), roughness);
+                    float VdotH = glm::dot(v, h);
+                    glm::vec3 l = 2.0f * VdotH * h - v;
+
+                    float NdotL = l.z;
+                    if (NdotL <= 0.0f)
+                        continue;
+
+                    VdotH = std::max(VdotH, 0.0f);
+
+                    float G = (NdotV / (NdotV * (1.0f - k) + k)) * (NdotL / (NdotL * (1.0f - k) + k));
+                    float visibility = G * VdotH / (h.z * NdotV);
+                    float fresnel = std::pow(1.0f - VdotH, 5.0f);
+
+                    scale += (1.0f - fresnel) * visibility;
+                    bias += fresnel * visibility;
+                }
+
+                (*lut)[2 * (static_cast<size_t>(j) * size + i) + 0] = scale / samples;
+                (*lut)[2 * (static_cast<size_t>(j) * size + i) + 1] = bias / samples;
+            }
+        }
+    });
+}
+
+static std::string hzglCachePath(const std::string& cacheDir, const char* prefix, uint64_t key)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "%s-%016llx.bin", prefix, static_cast<unsigned long long>(key));
+
+    return cacheDir + "/" + name;
+}
+
+// header, then int32 sizes and float arrays
+static bool hzglWriteCache(const std::string& filepath, uint64_t key, const std::function<bool(FILE*)>& payload)
+{
+    std::string tmppath = filepath + ".tmp";
+    FILE* fp = fopen(tmppath.c_str(), "wb");
+
+    if (fp == nullptr)
+        return false;
+
+    CacheHeader header = {hzglCacheMagic, hzglCacheVersion, key};
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1 && payload(fp);
+    ok = (fclose(fp) == 0) && ok;
+
+    // readers never see half a file
+    if (!ok || std::rename(tmppath.c_str(), filepath.c_str()) != 0)
+    {
+        std::remove(tmppath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+static bool hzglReadCache(const std::string& filepath, uint64_t key, const std::function<bool(FILE*)>& payload)
+{
+    FILE* fp = fopen(filepath.c_str(), "rb");
+
+    if (fp == nullptr)
+        return false;
+
+    CacheHeader header;
+    bool ok = fread(&header, sizeof(header), 1, fp) == 1 && header.magic == hzglCacheMagic
+           && header.version == hzglCacheVersion && header.key == key && payload(fp);
+
+    fclose(fp);
+
+    return ok;
+}
+
+static bool hzglWriteFloats(FILE* fp, const std::vector<float>& values)
+{
+    return values.empty() || fwrite(values.data(), sizeof(float), values.size(), fp) == values.size();
+}
+
+static bool hzglReadFloats(FILE* fp, size_t count, std::vector<float>* values)
+{
+    values->resize(count);
+    return count == 0 || fread(values->data(), sizeof(float), count, fp) == count;
+}
+
+bool hzgl::PrecomputeIBL(const std::string& hdrPath, const std::string& cacheDir, const IBLOptions& options,
+                         IBLData* data, IBLStats* stats)
+{
+    HZGL_PROFILE_SCOPE("PrecomputeIBL");
+
+    SimpleTimer totalTimer;
+    totalTimer.Start();
+
+    SimpleTimer timer;
+    *stats = IBLStats();
+
+    // the content decides, not the name or the modification time
+    timer.Start();
+    uint64_t fileHash = 0;
+
+    if (!HashFile(hdrPath, &fileHash))
+        return false;
+
+    int parameters[4] = {options.working_width, options.base_width, options.levels, options.samples};
+    stats->environment_key = HashBytes(parameters, sizeof(parameters), fileHash);
+    stats->hash_ms = 1000.0 * timer.End();
+
+    int lutParameters[2] = {options.lut_size, options.lut_samples};
+    uint64_t lutKey = HashBytes(lutParameters, sizeof(lutParameters));
+
+    std::string environmentPath = hzglCachePath(cacheDir, "ibl", stats->environment_key);
+    std::string lutPath = hzglCachePath(cacheDir, "brdf", lutKey);
+
+    stats->environment_cached = hzglReadCache(environmentPath, stats->environment_key, [data](FILE* fp) {
+        std::vector<float> sh;
+        int32_t numLevels = 0;
+
+        if (!hzglReadFloats(fp, 27, &sh) || fread(&numLevels, sizeof(numLevels), 1, fp) != 1 || numLevels < 1 || numLevels > 16)
+            return false;
+
+        for (int k = 0; k < 9; k++)
+            data->sh[k] = glm::vec3(sh[3 * k], sh[3 * k + 1], sh[3 * k + 2]);
+
+        data->prefiltered.resize(numLevels);
+
+        for (auto& level : data->prefiltered)
+        {
+            int32_t size[2] = {0, 0};
+
+            if (fread(size, sizeof(size), 1, fp) != 1 || size[0] < 1 || size[1] < 1 || size[0] > 8192 || size[1] > 8192)
+                return false;
+
+            level.width = size[0];
+            level.height = size[1];
+
+            if (!hzglReadFloats(fp, 3 * static_cast<size_t>(size[0]) * size[1], &level.pixels))
+                return false;
+        }
+
+        return true;
+    });
+
+    stats->lut_cached = hzglReadCache(lutPath, lutKey, [data, &options](FILE* fp) {
+        int32_t size = 0;
+
+        if (fread(&size, sizeof(size), 1, fp) != 1 || size != options.lut_size)
+            return false;
+
+        data->lut_size = size;
+        return hzglReadFloats(fp, 2 * static_cast<size_t>(size) * size, &data->brdf_lut);
+    });
+
+    if (stats->environment_cached && stats->lut_cached)
+    {
+        stats->total_ms = 1000.0 * totalTimer.End();
+        return true;
+    }
+
+    int threads = options.threads;
+    if (threads < 0)
+        threads = std::max(static_cast<int>(std::thread::hardware_concurrency()) - 1, 0);
+
+    std::unique_ptr<ThreadPool> pool;
+    if (threads > 0)
+        pool.reset(new ThreadPool(threads, 0, "IBL"));
+
+    CreateDirectories(cacheDir);
+
+    if (!stats->environment_cached)
+    {
+        timer.Start();
+        HDRImage source, environment;
+
+        if (!LoadHDRImage(hdrPath, &source))
+            return false;
+
+        DownsampleHDR(source, options.working_width, &environment);
+        stats->decode_ms = 1000.0 * timer.End();
+
+        timer.Start();
+        ProjectIrradianceSH9(environment, data->sh, pool.get());
+        stats->sh_ms = 1000.0 * timer.End();
+
+        timer.Start();
+        PrefilterGGX(environment, options, &data->prefiltered, pool.get());
+        stats->prefilter_ms = 1000.0 * timer.End();
+
+        hzglWriteCache(environmentPath, stats->environment_key, [data](FILE* fp) {
+            std::vector<float> sh;
+            for (int k = 0; k < 9; k++)
+            {
+                sh.push_back(data->sh[k].x);
+                sh.push_back(data->sh[k].y);
+                sh.push_back(data->sh[k].z);
+            }
+
+            int32_t numLevels = static_cast<int32_t>(data->prefiltered.size());
+            if (!hzglWriteFloats(fp, sh) || fwrite(&numLevels, sizeof(numLevels), 1, fp) != 1)
+                return false;
+
+            for (const auto& level : data->prefiltered)
+            {
+                int32_t size[2] = {level.width, level.height};
+                if (fwrite(size, sizeof(size), 1, fp) != 1 || !hzglWriteFloats(fp, level.pixels))
+                    return false;
+            }
+
+            return true;
+        });
+    }
+
+    if (!stats->lut_cached)
+    {
+        timer.Start();
+        data->lut_size = options.lut_size;
+        ComputeBRDFLut(options.lut_size, options.lut_samples, &data->brdf_lut, pool.get());
+        stats->lut_ms = 1000.0 * timer.End();
+
+        hzglWriteCache(lutPath, lutKey, [data](FILE* fp) {
+            int32_t size = data->lut_size;
+            return fwrite(&size, sizeof(size), 1, fp) == 1 && hzglWriteFloats(fp, data->brdf_lut);
+        });
+    }
+
+    stats->total_ms = 1000.0 * totalTimer.End();
+
+    return true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+namespace hzgl
+{
+    class ThreadPool;
+
+    // linear RGB, equirectangular (longitude along x, the first row looks straight up)
+    typedef struct
+    {
+        int width = 0;
+        int height = 0;
+        std::vector<float> pixels;        // 3 floats per pixel
+    } HDRImage;
+
+    typedef struct
+    {
+        int working_width = 512;          // the environment is box-filtered down to this first
+        int base_width = 256;             // of the sharpest prefiltered level (height is half)
+        int levels = 6;                   // roughness 0, 0.2, ..., 1; at most log2(base_width) + 1
+        int samples = 128;                // GGX samples per prefiltered texel
+        int lut_size = 128;
+        int lut_samples = 256;
+        int threads = -1;                 // workers for the precompute, -1: one per core but one
+    } IBLOptions;
+
+    typedef struct
+    {
+        glm::vec3 sh[9];                  // irradiance / pi: diffuse = albedo * sum(sh[i] * Y_i(n))
+        std::vector<HDRImage> prefiltered; // one image per roughness level
+        int lut_size = 0;
+        std::vector<float> brdf_lut;      // (scale, bias) of F0, by (NdotV, roughness)
+    } IBLData;
+
+    typedef struct
+    {
+        uint64_t environment_key = 0;     // content hash of the .hdr and the options
+        bool environment_cached = false;  // SH and prefiltered maps read from the cache
+        bool lut_cached = false;
+        double hash_ms = 0.0;
+        double decode_ms = 0.0;
+        double sh_ms = 0.0;
+        double prefilter_ms = 0.0;
+        double lut_ms = 0.0;
+        double total_ms = 0.0;
+    } IBLStats;
+
+    // "SSE" or "scalar", whichever the SH projection was compiled with
+    const char* IBLSimdPath();
+
+    // FNV-1a, 64 bits
+    uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+    bool HashFile(const std::string& filepath, uint64_t* hash);
+
+    bool LoadHDRImage(const std::string& filepath, HDRImage* image);
+
+    // 2x2 box filter until the width is at most maxWidth
+    void DownsampleHDR(const HDRImage& image, int maxWidth, HDRImage* result);
+
+    // the CPU precompute, no OpenGL involved; pool may be null (runs on the calling thread)
+    void ProjectIrradianceSH9(const HDRImage& environment, glm::vec3 sh[9], ThreadPool* pool = nullptr);
+    glm::vec3 EvaluateIrradianceSH9(const glm::vec3 sh[9], const glm::vec3& normal);
+    void PrefilterGGX(const HDRImage& environment, const IBLOptions& options, std::vector<HDRImage>* levels, ThreadPool* pool = nullptr);
+    void ComputeBRDFLut(int size, int samples, std::vector<float>* lut, ThreadPool* pool = nullptr);
+
+    // decode, precompute and cache under the content hash of the file in cacheDir (relative to
+    // the working directory); the next run reads it back, the BRDF LUT is shared by all of them
+    bool PrecomputeIBL(const std::string& hdrPath, const std::string& cacheDir, const IBLOptions& options,
+                       IBLData* data, IBLStats* stats);
+} // namespace hzgl
@@ -0,0 +1,663 @@
+#include "Image.hpp"
+
+#include "Profiler.hpp"
+
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#ifdef HZGL_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+#define HZGL_LOG_ERROR(msg) \
+    fprintf(stderr, "[ERROR] %s (line %d): %s\n", __FILE__, __LINE__, msg);
+
+#ifdef HZGL_HAS_ZLIB
+static int hzglPaeth(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = std::abs(p - a);
+    int pb = std::abs(p - b);
+    int pc = std::abs(p - c);
+
+    if (pa <= pb && pa <= pc)
+        return a;
+
+    return (pb <= pc) ? b : c;
+}
+
+// filter one scanline into out (filter byte + row), picking the filter with the smallest sum of |residuals|
+static void hzglFilterRow(const unsigned char* row, const unsigned char* prev, int rowBytes, int bpp, int level,
+                          unsigned char* candidate, unsigned char* out)
+{
+    long bestScore = -1;
+
+    // level 0 stores the data, so filtering would only cost time
+    int lastFilter = (level == 0) ? 0 : 4;
+
+    for (int filter = 0; filter <= lastFilter; filter++)
+    {
+        long score = 0;
+
+        for (int i = 0; i < rowBytes; i++)
+        {
+            int a = (i >= bpp) ? row[i - bpp] : 0;
+            int b = prev ? prev[i] : 0;
+            int c = (prev && i >= bpp) ? prev[i - bpp] : 0;
+            int predicted = 0;
+
+            switch (filter)
+            {
+            case 1: predicted = a; break;
+            case 2: predicted = b; break;
+            case 3: predicted = (a + b) / 2; break;
+            case 4: predicted = hzglPaeth(a, b, c); break;
+            default: break;
+            }
+
+            unsigned char residual = static_cast<unsigned char>(row[i] - predicted);
+            candidate[i] = residual;
+            score += (residual < 128) ? residual : 256 - residual;
+        }
+
+        if (bestScore < 0 || score < bestScore)
+        {
+            bestScore = score;
+            out[0] = static_cast<unsigned char>(filter);
+            memcpy(out + 1, candidate, rowBytes);
+        }
+    }
+}
+
+typedef struct
+{
+    int firstRow = 0;
+    int numRows = 0;
+    bool last = false;
+    std::vector<unsigned char> compressed;
+    uLong adler = 1;
+} hzglDeflateBand;
+
+// raw-deflate one piece of a stream; pieces end on a byte boundary (or the final block) so they can be concatenated
+static void hzglDeflateRaw(const unsigned char* data, size_t size, int level, bool last, hzglDeflateBand& band)
+{
+    band.adler = adler32(1L, data, static_cast<uInt>(size));
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+
+    band.compressed.resize(deflateBound(&stream, static_cast<uLong>(size)) + 16);
+
+    stream.next_in = const_cast<unsigned char*>(data);
+    stream.avail_in = static_cast<uInt>(size);
+    stream.next_out = band.compressed.data();
+    stream.avail_out = static_cast<uInt>(band.compressed.size());
+
+    deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+
+    band.compressed.resize(stream.total_out);
+    deflateEnd(&stream);
+}
+
+// filter and raw-deflate a band of rows
+static void hzglCompressBand(const unsigned char* pixels, int width, int height, int numChannels, const hzgl::PNGOptions& options,
+                             hzglDeflateBand& band)
+{
+    HZGL_PROFILE_SCOPE("DeflateBand");
+
+    int rowBytes = width * numChannels;
+    size_t stride = static_cast<size_t>(rowBytes);
+
+    auto sourceRow = [&](int y) -> const unsigned char* {
+        int r = options.flip_vertically ? height - 1 - y : y;
+        return pixels + r * stride;
+    };
+
+    std::vector<unsigned char> filtered((rowBytes + 1) * static_cast<size_t>(band.numRows));
+    std::vector<unsigned char> candidate(rowBytes);
+
+    for (int i = 0; i < band.numRows; i++)
+    {
+        int y = band.firstRow + i;
+        hzglFilterRow(sourceRow(y), (y > 0) ? sourceRow(y - 1) : nullptr, rowBytes, numChannels,
+                      options.compression_level, candidate.data(), &filtered[i * (rowBytes + 1)]);
+    }
+
+    hzglDeflateRaw(filtered.data(), filtered.size(), options.compression_level, band.last, band);
+}
+
+static uint32_t hzglCrc32(uint32_t crc, const unsigned char* data, size_t length)
+{
+    return static_cast<uint32_t>(crc32(crc, data, static_cast<uInt>(length)));
+}
+#else
+// zlib-compatible checksums for the uncompressed fallback of PNGStreamWriter
+static uint32_t hzglCrc32(uint32_t crc, const unsigned char* data, size_t length)
+{
+    static const std::vector<uint32_t> table = []() {
+        std::vector<uint32_t> t(256);
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            t[n] = c;
+        }
+        return t;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+
+    return ~crc;
+}
+
+static uint32_t hzglAdler32(uint32_t adler, const unsigned char* data, size_t length)
+{
+    uint32_t a = adler & 0xffff;
+    uint32_t b = adler >> 16;
+
+    while (length > 0)
+    {
+        // 5552 is the largest block that cannot overflow before the modulo
+        size_t n = std::min<size_t>(length, 5552);
+        for (size_t i = 0; i < n; i++)
+        {
+            a += data[i];
+            b += a;
+        }
+
+        a %= 65521;
+        b %= 65521;
+        data += n;
+        length -= n;
+    }
+
+    return (b << 16) | a;
+}
+#endif
+
+static void hzglWriteChunk(FILE* fp, const char* type, const unsigned char* data, size_t length)
+{
+    unsigned char header[8] = {
+        static_cast<unsigned char>(length >> 24), static_cast<unsigned char>(length >> 16),
+        static_cast<unsigned char>(length >> 8), static_cast<unsigned char>(length),
+        static_cast<unsigned char>(type[0]), static_cast<unsigned char>(type[1]),
+        static_cast<unsigned char>(type[2]), static_cast<unsigned char>(type[3])
+    };
+
+    uint32_t crc = hzglCrc32(0, header + 4, 4);
+    if (length > 0)
+        crc = hzglCrc32(crc, data, length);
+
+    unsigned char footer[4] = {
+        static_cast<unsigned char>(crc >> 24), static_cast<unsigned char>(crc >> 16),
+        static_cast<unsigned char>(crc >> 8), static_cast<unsigned char>(crc)
+    };
+
+    fwrite(header, 1, 8, fp);
+    if (length > 0)
+        fwrite(data, 1, length, fp);
+    fwrite(footer, 1, 4, fp);
+}
+
+// signature and IHDR (8 bits per channel, no interlacing)
+static void hzglWriteHeader(FILE* fp, int width, int height, int numChannels)
+{
+    const unsigned char colorTypes[] = {0, 4, 2, 6};
+    unsigned char ihdr[13] = {
+        static_cast<unsigned char>(width >> 24), static_cast<unsigned char>(width >> 16),
+        static_cast<unsigned char>(width >> 8), static_cast<unsigned char>(width),
+        static_cast<unsigned char>(height >> 24), static_cast<unsigned char>(height >> 16),
+        static_cast<unsigned char>(height >> 8), static_cast<unsigned char>(height),
+        8, colorTypes[numChannels - 1], 0, 0, 0
+    };
+
+    const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    fwrite(signature, 1, 8, fp);
+
+    hzglWriteChunk(fp, "IHDR", ihdr, sizeof(ihdr));
+}
+
+#ifdef HZGL_HAS_ZLIB
+static bool hzglWritePNGZlib(const std::string& filepath, const unsigned char* pixels, int width, int height, int numChannels,
+                             const hzgl::PNGOptions& options)
+{
+    // bands of at least 64 rows keep the per-band flush overhead negligible
+    int numBands = std::max(1, std::min(options.deflate_threads, height / 64));
+
+    std::vector<hzglDeflateBand> bands(numBands);
+    for (int b = 0; b < numBands; b++)
+    {
+        bands[b].firstRow = static_cast<int>(static_cast<int64_t>(height) * b / numBands);
+        bands[b].numRows = static_cast<int>(static_cast<int64_t>(height) * (b + 1) / numBands) - bands[b].firstRow;
+        bands[b].last = (b == numBands - 1);
+    }
+
+    std::vector<std::thread> threads;
+    for (int b = 1; b < numBands; b++)
+        threads.emplace_back(hzglCompressBand, pixels, width, height, numChannels, std::cref(options), std::ref(bands[b]));
+
+    hzglCompressBand(pixels, width, height, numChannels, options, bands[0]);
+
+    for (auto& thread : threads)
+        thread.join();
+
+    // zlib wrapper around the concatenated raw deflate streams
+    std::vector<unsigned char> idat = {0x78, 0x9c};
+    uLong adler = bands[0].adler;
+
+    for (int b = 0; b < numBands; b++)
+    {
+        idat.insert(idat.end(), bands[b].compressed.begin(), bands[b].compressed.end());
+
+        if (b > 0)
+        {
+            size_t bandBytes = (static_cast<size_t>(width) * numChannels + 1) * bands[b].numRows;
+            adler = adler32_combine(adler, bands[b].adler, static_cast<z_off_t>(bandBytes));
+        }
+    }
+
+    idat.push_back(static_cast<unsigned char>(adler >> 24));
+    idat.push_back(static_cast<unsigned char>(adler >> 16));
+    idat.push_back(static_cast<unsigned char>(adler >> 8));
+    idat.push_back(static_cast<unsigned char>(adler));
+
+    FILE* fp = fopen(filepath.c_str(), "wb");
+
+    if (fp == nullptr)
+        return false;
+
+    hzglWriteHeader(fp, width, height, numChannels);
+    hzglWriteChunk(fp, "IDAT", idat.data(), idat.size());
+    hzglWriteChunk(fp, "IEND", nullptr, 0);
+
+    bool ok = (ferror(fp) == 0);
+    fclose(fp);
+
+    return ok;
+}
+#endif
+
+bool hzgl::WritePNG(const std::string& filepath, const unsigned char* pixels, int width, int height, int numChannels,
+                    const PNGOptions& options)
+{
+    HZGL_PROFILE_SCOPE("WritePNG");
+
+    if (pixels == nullptr || width <= 0 || height <= 0 || numChannels < 1 || numChannels > 4)
+    {
+        HZGL_LOG_ERROR("Invalid image.")
+        return false;
+    }
+
+    bool ok = false;
+
+#ifdef HZGL_HAS_ZLIB
+    PNGOptions clamped = options;
+    clamped.compression_level = std::min(std::max(options.compression_level, 0), 9);
+
+    ok = hzglWritePNGZlib(filepath, pixels, width, height, numChannels, clamped);
+#else
+    // stb keeps the flip flag and compression level in globals, so flip here and leave the
+    // level to SetPNGCompressionLevel, before any encoder thread runs
+    size_t stride = static_cast<size_t>(width) * numChannels;
+    const unsigned char* rows = pixels;
+    std::vector<unsigned char> flipped;
+
+    if (options.flip_vertically)
+    {
+        flipped.resize(stride * height);
+        for (int y = 0; y < height; y++)
+            memcpy(&flipped[y * stride], pixels + (height - 1 - y) * stride, stride);
+        rows = flipped.data();
+    }
+
+    ok = stbi_write_png(filepath.c_str(), width, height, numChannels, rows, static_cast<int>(stride)) != 0;
+#endif
+
+    if (!ok)
+        HZGL_LOG_ERROR("Failed to write the PNG file.")
+
+    return ok;
+}
+
+void hzgl::SetPNGCompressionLevel(int level)
+{
+#ifndef HZGL_HAS_ZLIB
+    stbi_write_png_compression_level = std::min(std::max(level, 1), 9);
+#else
+    (void)level;
+#endif
+}
+
+hzgl::PNGStreamWriter::PNGStreamWriter()
+{
+    _fp = nullptr;
+    _width = 0;
+    _height = 0;
+    _numChannels = 0;
+    _rowsWritten = 0;
+    _adler = 1;
+    _ok = false;
+}
+
+hzgl::PNGStreamWriter::~PNGStreamWriter()
+{
+    if (_fp != nullptr)
+        Close();
+}
+
+bool hzgl::PNGStreamWriter::Open(const std::string& filepath, int width, int height, int numChannels, const PNGOptions& options)
+{
+    if (_fp != nullptr)
+        Close();
+
+    if (width <= 0 || height <= 0 || numChannels < 1 || numChannels > 4)
+    {
+        HZGL_LOG_ERROR("Invalid image.")
+        return false;
+    }
+
+    _fp = fopen(filepath.c_str(), "wb");
+
+    if (_fp == nullptr)
+    {
+        HZGL_LOG_ERROR("Failed to write the PNG file.")
+        return false;
+    }
+
+    _width = width;
+    _height = height;
+    _numChannels = numChannels;
+    _rowsWritten = 0;
+    _adler = 1;
+    _ok = true;
+
+    _options = options;
+    _options.compression_level = std::min(std::max(options.compression_level, 0), 9);
+
+    _prevRow.assign(static_cast<size_t>(width) * numChannels, 0);
+
+    hzglWriteHeader(_fp, width, height, numChannels);
+
+    return true;
+}
+
+bool hzgl::PNGStreamWriter::WriteRows(const unsigned char* pixels, int numRows)
+{
+    HZGL_PROFILE_SCOPE("PNGStreamWriter::WriteRows");
+
+    if (_fp == nullptr || pixels == nullptr || numRows <= 0 || _rowsWritten + numRows > _height)
+    {
+        HZGL_LOG_ERROR("Invalid rows.")
+        _ok = false;
+        return false;
+    }
+
+    int rowBytes = _width * _numChannels;
+    size_t stride = static_cast<size_t>(rowBytes);
+    bool first = (_rowsWritten == 0);
+    bool last = (_rowsWritten + numRows == _height);
+
+    auto sourceRow = [&](int i) -> const unsigned char* {
+        return pixels + (_options.flip_vertically ? numRows - 1 - i : i) * stride;
+    };
+
+    std::vector<unsigned char> filtered((stride + 1) * numRows);
+    std::vector<unsigned char> idat;
+
+    // the zlib header goes in front of the first band, the checksum after the last
+    if (first)
+        idat = {0x78, static_cast<unsigned char>(_options.compression_level == 0 ? 0x01 : 0x9c)};
+
+#ifdef HZGL_HAS_ZLIB
+    std::vector<unsigned char> candidate(rowBytes);
+
+    for (int i = 0; i < numRows; i++)
+    {
+        const unsigned char* prev = (i > 0) ? sourceRow(i - 1) : (first ? nullptr : _prevRow.data());
+        hzglFilterRow(sourceRow(i), prev, rowBytes, _numChannels, _options.compression_level, candidate.data(), &filtered[i * (stride + 1)]);
+    }
+
+    // the filtered rows are independent now, so pieces of the band deflate in parallel
+    int numPieces = std::max(1, std::min(_options.deflate_threads, numRows / 64));
+    std::vector<hzglDeflateBand> pieces(numPieces);
+    std::vector<std::thread> threads;
+
+    for (int p = 0; p < numPieces; p++)
+    {
+        pieces[p].firstRow = static_cast<int>(static_cast<int64_t>(numRows) * p / numPieces);
+        pieces[p].numRows = static_cast<int>(static_cast<int64_t>(numRows) * (p + 1) / numPieces) - pieces[p].firstRow;
+        pieces[p].last = last && (p == numPieces - 1);
+    }
+
+    auto deflatePiece = [&](int p) {
+        hzglDeflateRaw(&filtered[pieces[p].firstRow * (stride + 1)], pieces[p].numRows * (stride + 1),
+                       _options.compression_level, pieces[p].last, pieces[p]);
+    };
+
+    for (int p = 1; p < numPieces; p++)
+        threads.emplace_back(deflatePiece, p);
+
+    deflatePiece(0);
+
+    for (auto& thread : threads)
+        thread.join();
+
+    for (const auto& piece : pieces)
+    {
+        idat.insert(idat.end(), piece.compressed.begin(), piece.compressed.end());
+        _adler = static_cast<uint32_t>(adler32_combine(_adler, piece.adler, static_cast<z_off_t>(piece.numRows * (stride + 1))));
+    }
+#else
+    // no deflate available: unfiltered rows in stored blocks
+    for (int i = 0; i < numRows; i++)
+    {
+        filtered[i * (stride + 1)] = 0;
+        memcpy(&filtered[i * (stride + 1) + 1], sourceRow(i), stride);
+    }
+
+    for (size_t offset = 0; offset < filtered.size(); offset += 65535)
+    {
+        size_t length = std::min<size_t>(65535, filtered.size() - offset);
+        bool final = last && (offset + length == filtered.size());
+
+        idat.insert(idat.end(), {static_cast<unsigned char>(final ? 1 : 0),
+                                 static_cast<unsigned char>(length), static_cast<unsigned char>(length >> 8),
+                                 static_cast<unsigned char>(~length), static_cast<unsigned char>(~length >> 8)});
+        idat.insert(idat.end(), filtered.begin() + offset, filtered.begin() + offset + length);
+    }
+
+    _adler = hzglAdler32(_adler, filtered.data(), filtered.size());
+#endif
+
+    if (last)
+    {
+        idat.push_back(static_cast<unsigned char>(_adler >> 24));
+        idat.push_back(static_cast<unsigned char>(_adler >> 16));
+        idat.push_back(static_cast<unsigned char>(_adler >> 8));
+        idat.push_back(static_cast<unsigned char>(_adler));
+    }
+
+    hzglWriteChunk(_fp, "IDAT", idat.data(), idat.size());
+
+    memcpy(_prevRow.data(), sourceRow(numRows - 1), stride);
+    _rowsWritten += numRows;
+
+    _ok = _ok && (ferror(_fp) == 0);
+
+    return _ok;
+}
+
+bool hzgl::PNGStreamWriter::Close()
+{
+    if (_fp == nullptr)
+        return false;
+
+    bool complete = (_rowsWritten == _height);
+
+    if (!complete)
+        HZGL_LOG_ERROR("The PNG file is incomplete.")
+    else
+        hzglWriteChunk(_fp, "IEND", nullptr, 0);
+
+    bool ok = _ok && complete && (ferror(_fp) == 0);
+
+    fclose(_fp);
+    _fp = nullptr;
+    _prevRow.clear();
+
+    return ok;
+}
+
+bool hzgl::PNGStreamWriter::IsOpen() const
+{
+    return _fp != nullptr;
+}
+
+int hzgl::PNGStreamWriter::RowsWritten() const
+{
+    return _rowsWritten;
+}
+
+bool hzgl::WriteQOI(const std::string& filepath, const unsigned char* pixels, int width, int height, int numChannels,
+                    bool flipVertically)
+{
+    HZGL_PROFILE_SCOPE("WriteQOI");
+
+    if (pixels == nullptr || width <= 0 || height <= 0 || numChannels < 3 || numChannels > 4)
+    {
+        HZGL_LOG_ERROR("Invalid image.")
+        return false;
+    }
+
+    // worst case: one tag byte plus every channel per pixel
+    std::vector<unsigned char> bytes;
+    bytes.reserve(14 + static_cast<size_t>(width) * height * (numChannels + 1) + 8);
+
+    auto pushU32 = [&bytes](uint32_t v) {
+        bytes.push_back(static_cast<unsigned char>(v >> 24));
+        bytes.push_back(static_cast<unsigned char>(v >> 16));
+        bytes.push_back(static_cast<unsigned char>(v >> 8));
+        bytes.push_back(static_cast<unsigned char>(v));
+    };
+
+    bytes.insert(bytes.end(), {'q', 'o', 'i', 'f'});
+    pushU32(static_cast<uint32_t>(width));
+    pushU32(static_cast<uint32_t>(height));
+    bytes.push_back(static_cast<unsigned char>(numChannels));
+    bytes.push_back(0); // sRGB with linear alpha
+
+    unsigned char index[64][4] = {};
+    unsigned char prev[4] = {0, 0, 0, 255};
+    int run = 0;
+
+    size_t stride = static_cast<size_t>(width) * numChannels;
+    size_t numPixels = static_cast<size_t>(width) * height;
+
+    for (int y = 0; y < height; y++)
+    {
+        const unsigned char* row = pixels + (flipVertically ? height - 1 - y : y) * stride;
+
+        for (int x = 0; x < width; x++)
+        {
+            const unsigned char* p = row + x * numChannels;
+            unsigned char px[4] = {p[0], p[1], p[2], (numChannels == 4) ? p[3] : static_cast<unsigned char>(255)};
+
+            bool lastPixel = (static_cast<size_t>(y) * width + x + 1 == numPixels);
+
+            if (memcmp(px, prev, 4) == 0)
+            {
+                run++;
+                if (run == 62 || lastPixel)
+                {
+                    bytes.push_back(static_cast<unsigned char>(0xc0 | (run - 1)));
+                    run = 0;
+                }
+                continue;
+            }
+
+            if (run > 0)
+            {
+                bytes.push_back(static_cast<unsigned char>(0xc0 | (run - 1)));
+                run = 0;
+            }
+
+            int hash = (px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64;
+
+            if (memcmp(index[hash], px, 4) == 0)
+            {
+                bytes.push_back(static_cast<unsigned char>(hash));
+            }
+            else
+            {
+                memcpy(index[hash], px, 4);
+
+                if (px[3] == prev[3])
+                {
+                    int dr = static_cast<signed char>(px[0] - prev[0]);
+                    int dg = static_cast<signed char>(px[1] - prev[1]);
+                    int db = static_cast<signed char>(px[2] - prev[2]);
+                    int drdg = dr - dg;
+                    int dbdg = db - dg;
+
+                    if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                    {
+                        bytes.push_back(static_cast<unsigned char>(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+                    }
+                    else if (dg >= -32 && dg <= 31 && drdg >= -8 && drdg <= 7 && dbdg >= -8 && dbdg <= 7)
+                    {
+                        bytes.push_back(static_cast<unsigned char>(0x80 | (dg + 32)));
+                        bytes.push_back(static_cast<unsigned char>((drdg + 8) << 4 | (dbdg + 8)));
+                    }
+                    else
+                    {
+                        bytes.insert(bytes.end(), {0xfe, px[0], px[1], px[2]});
+                    }
+                }
+                else
+                {
+                    bytes.insert(bytes.end(), {0xff, px[0], px[1], px[2], px[3]});
+                }
+            }
+
+            memcpy(prev, px, 4);
+        }
+    }
+
+    bytes.insert(bytes.end(), {0, 0, 0, 0, 0, 0, 0, 1});
+
+    FILE* fp = fopen(filepath.c_str(), "wb");
+
+    if (fp == nullptr)
+    {
+        HZGL_LOG_ERROR("Failed to write the QOI file.")
+        return false;
+    }
+
+    bool ok = fwrite(bytes.data(), 1, bytes.size(), fp) == bytes.size();
+    fclose(fp);
+
+    return ok;
+}
+
+bool hzgl::HasParallelDeflate()
+{
+#ifdef HZGL_HAS_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+#undef HZGL_LOG_ERROR
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+namespace hzgl
+{
+    typedef struct
+    {
+        int compression_level = 6;   // 0 (store) to 9 (smallest)
+        int deflate_threads = 1;     // > 1 compresses row bands in parallel (needs zlib)
+        bool flip_vertically = true; // rows are bottom-up, as read by glReadPixels
+    } PNGOptions;
+
+    // 8-bit PNG with 1 to 4 channels; safe to call from any thread
+    bool WritePNG(const std::string& filepath, const unsigned char* pixels, int width, int height, int numChannels,
+                  const PNGOptions& options = PNGOptions());
+
+    // without zlib, stb writes the PNGs and reads the compression level from a global: set it
+    // here before the threads that call WritePNG start (WritePNG never changes it)
+    void SetPNGCompressionLevel(int level);
+
+    // writes a PNG band by band so that the whole image never has to be in memory;
+    // bands go top to bottom and flip_vertically applies within each band
+    class PNGStreamWriter
+    {
+    private:
+        FILE* _fp;
+        int _width;
+        int _height;
+        int _numChannels;
+        int _rowsWritten;
+        uint32_t _adler;
+        bool _ok;
+        PNGOptions _options;
+        std::vector<unsigned char> _prevRow;  // the filters of the next band look one row up
+
+    public:
+        PNGStreamWriter();
+        ~PNGStreamWriter();
+
+        PNGStreamWriter(const PNGStreamWriter&) = delete;
+        PNGStreamWriter& operator=(const PNGStreamWriter&) = delete;
+
+        bool Open(const std::string& filepath, int width, int height, int numChannels, const PNGOptions& options = PNGOptions());
+
+        // numRows tightly packed rows; every call is compressed and written right away
+        bool WriteRows(const unsigned char* pixels, int numRows);
+
+        // false when rows are missing or writing failed
+        bool Close();
+
+        bool IsOpen() const;
+        int RowsWritten() const;
+    };
+
+    // QOI ("Quite OK Image") with 3 or 4 channels: lossless, much faster to encode than PNG
+    bool WriteQOI(const std::string& filepath, const unsigned char* pixels, int width, int height, int numChannels,
+                  bool flipVertically = true);
+
+    // true when built with zlib (parallel deflate available)
+    bool HasParallelDeflate();
+} // namespace hzgl
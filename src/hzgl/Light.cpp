@@ -1,5 +1,8 @@
 #include "Light.hpp"
 
+#include <cstdio>
+#include <random>
+
 hzgl::Light::Light(LightType t, const glm::vec3 &pos, const glm::vec3 &col, const glm::vec3 &amb)
     : type(t), position(pos), color(col), ambient(amb)
 {
@@ -14,63 +17,101 @@ hzgl::Light::Light(LightType t, const glm::vec3 &pos, const glm::vec3 &col, cons
     constantAttenuation = 1.0f;
     linearAttenuation = 0.35f;
     quadraticAttenuation = 0.44f;
+
+    castShadows = true;
+}
+
+bool hzgl::Light::operator==(const Light &other) const
+{
+    return isEnabled == other.isEnabled && type == other.type
+        && position == other.position && color == other.color && ambient == other.ambient
+        && coneDirection == other.coneDirection && spotExponent == other.spotExponent && spotCosCutoff == other.spotCosCutoff
+        && constantAttenuation == other.constantAttenuation && linearAttenuation == other.linearAttenuation
+        && quadraticAttenuation == other.quadraticAttenuation && castShadows == other.castShadows;
 }
 
-static GLuint hzglLoc(GLuint program, const std::string& uName)
+bool hzgl::Light::operator!=(const Light &other) const
 {
-    return glGetUniformLocation(program, uName.c_str());
+    return !(*this == other);
 }
 
-std::string hzgl::LightTypeName(LightType type)
+// uniform names are put together on the stack, these setters run every frame
+static GLuint hzglLoc(GLuint program, const char* uName, const char* member)
 {
-    std::string lightType;
+    char name[128];
+    snprintf(name, sizeof(name), "%s.%s", uName, member);
 
+    return glGetUniformLocation(program, name);
+}
+
+const char* hzgl::LightTypeName(LightType type)
+{
     switch (type)
     {
         case HZGL_SPOT_LIGHT:
-            lightType = "Spot light";
-            break;
+            return "Spot light";
         case HZGL_POINT_LIGHT:
-            lightType = "Point light";
-            break;
+            return "Point light";
         case HZGL_DIRECTIONAL_LIGHT:
-            lightType = "Directional light";
-            break;
+            return "Directional light";
         default:
-            lightType = "Unknown type";
-            break;
+            return "Unknown type";
     }
-
-    return lightType;
 }
 
-void hzgl::SetupLight(GLuint program, const Light &light, std::string uName)
+void hzgl::SetupLight(GLuint program, const Light &light, const char* uName)
 {
     // type of the light
-    glUniform1i(hzglLoc(program, uName + ".isEnabled"), (light.isEnabled ? 1 : 0));
-    glUniform1i(hzglLoc(program, uName + ".isLocal"), (light.type == HZGL_DIRECTIONAL_LIGHT ? 0 : 1));
-    glUniform1i(hzglLoc(program, uName + ".isSpot"), (light.type == HZGL_SPOT_LIGHT ? 1 : 0));
+    glUniform1i(hzglLoc(program, uName, "isEnabled"), (light.isEnabled ? 1 : 0));
+    glUniform1i(hzglLoc(program, uName, "isLocal"), (light.type == HZGL_DIRECTIONAL_LIGHT ? 0 : 1));
+    glUniform1i(hzglLoc(program, uName, "isSpot"), (light.type == HZGL_SPOT_LIGHT ? 1 : 0));
 
     // position/direction
-    glUniform3fv(hzglLoc(program, uName + ".position"), 1, &light.position[0]);
+    glUniform3fv(hzglLoc(program, uName, "position"), 1, &light.position[0]);
 
     // light intensities for different components
-    glUniform3fv(hzglLoc(program, uName + ".color"), 1, &light.color[0]);
-    glUniform3fv(hzglLoc(program, uName + ".ambient"), 1, &light.ambient[0]);
+    glUniform3fv(hzglLoc(program, uName, "color"), 1, &light.color[0]);
+    glUniform3fv(hzglLoc(program, uName, "ambient"), 1, &light.ambient[0]);
 
     // cone properties for spot light
-    glUniform3fv(hzglLoc(program, uName + ".coneDirection"), 1, &light.coneDirection[0]);
-    glUniform1f(hzglLoc(program, uName + ".spotExponent"), light.spotExponent);
-    glUniform1f(hzglLoc(program, uName + ".spotCosCutoff"), light.spotCosCutoff);
+    glUniform3fv(hzglLoc(program, uName, "coneDirection"), 1, &light.coneDirection[0]);
+    glUniform1f(hzglLoc(program, uName, "spotExponent"), light.spotExponent);
+    glUniform1f(hzglLoc(program, uName, "spotCosCutoff"), light.spotCosCutoff);
 
     // attenuation factors for local light
-    glUniform1f(hzglLoc(program, uName + ".constantAttenuation"), light.constantAttenuation);
-    glUniform1f(hzglLoc(program, uName + ".linearAttenuation"), light.linearAttenuation);
-    glUniform1f(hzglLoc(program, uName + ".quadraticAttenuation"), light.quadraticAttenuation);
+    glUniform1f(hzglLoc(program, uName, "constantAttenuation"), light.constantAttenuation);
+    glUniform1f(hzglLoc(program, uName, "linearAttenuation"), light.linearAttenuation);
+    glUniform1f(hzglLoc(program, uName, "quadraticAttenuation"), light.quadraticAttenuation);
 }
 
-void hzgl::SetupLightInArray(GLuint program, const Light &light, std::string uArrayName, int index)
+void hzgl::SetupLightInArray(GLuint program, const Light &light, const char* uArrayName, int index)
 {
-    std::string uName = uArrayName + "[" + std::to_string(index) + "]";
+    char uName[96];
+    snprintf(uName, sizeof(uName), "%s[%d]", uArrayName, index);
     SetupLight(program, light, uName);
-}
\ No newline at end of file
+}
+
+void hzgl::AddRandomPointLights(std::vector<Light> &lights, int count, const glm::vec3 &boxMin, const glm::vec3 &boxMax, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    lights.reserve(lights.size() + count);
+
+    for (int i = 0; i < count; i++)
+    {
+        glm::vec3 position = boxMin + (boxMax - boxMin) * glm::vec3(unit(rng), unit(rng), unit(rng));
+        glm::vec3 color = glm::vec3(0.2f) + 0.8f * glm::vec3(unit(rng), unit(rng), unit(rng));
+
+        Light light(HZGL_POINT_LIGHT, position, color, glm::vec3(0.0f));
+
+        // falls below 1/256 within about 3.5 units, so each light only reaches a few clusters
+        light.linearAttenuation = 0.7f;
+        light.quadraticAttenuation = 20.0f;
+
+        // too many and too small to be worth a shadow map each
+        light.castShadows = false;
+
+        lights.push_back(light);
+    }
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -39,11 +40,20 @@ namespace hzgl
         float linearAttenuation;
         float quadraticAttenuation;
 
+        // rendered into the shadow atlas when there is room for it
+        bool castShadows;
+
         Light(LightType t = HZGL_POINT_LIGHT, const glm::vec3 &pos = glm::vec3(0, 1, 0),
               const glm::vec3 &col = glm::vec3(1.0f), const glm::vec3 &amb = glm::vec3(0.2f));
+
+        bool operator==(const Light &other) const;
+        bool operator!=(const Light &other) const;
     };
 
-    std::string LightTypeName(LightType type);
-    void SetupLight(GLuint program, const Light &light, std::string uName = "uLight");
-    void SetupLightInArray(GLuint program, const Light &light, std::string uArrayName = "uLights", int index = 0);
+    const char* LightTypeName(LightType type);
+    void SetupLight(GLuint program, const Light &light, const char* uName = "uLight");
+    void SetupLightInArray(GLuint program, const Light &light, const char* uArrayName = "uLights", int index = 0);
+
+    // append small colored point lights at random positions inside a box (same seed, same lights)
+    void AddRandomPointLights(std::vector<Light> &lights, int count, const glm::vec3 &boxMin, const glm::vec3 &boxMax, unsigned seed = 1);
 } // namespace hzgl
@@ -0,0 +1,513 @@
+#include "LightClusters.hpp"
+
+#include "Timer.hpp"
+#include "Memory.hpp"
+#include "Profiler.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #define HZGL_CLUSTER_SSE
+    #include <xmmintrin.h>
+#endif
+
+float hzgl::LightRange(const Light& light, float cutoff)
+{
+    if (light.type == HZGL_DIRECTIONAL_LIGHT)
+        return -1.0f;
+
+    // attenuation = 1 / (c + l * d + q * d^2), scaled by the brightest channel
+    float brightest = 0.0f;
+    for (int c = 0; c < 3; c++)
+        brightest = std::max(brightest, std::max(light.color[c], light.ambient[c]));
+    float target = brightest / cutoff - light.constantAttenuation;
+
+    if (target <= 0.0f)
+        return 0.0f;
+
+    float l = light.linearAttenuation;
+    float q = light.quadraticAttenuation;
+
+    if (q > 0.0f)
+        return (-l + std::sqrt(l * l + 4.0f * q * target)) / (2.0f * q);
+
+    if (l > 0.0f)
+        return target / l;
+
+    return -1.0f;
+}
+
+const char* hzgl::LightClusterSimdPath()
+{
+#ifdef HZGL_CLUSTER_SSE
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
+
+hzgl::LightClusters::LightClusters(int tilesX, int tilesY, int slices, int numThreads, int parallelThreshold)
+    : _tilesX((std::max(tilesX, 1) + 3) / 4 * 4), _tilesY(std::max(tilesY, 1)), _slices(std::max(slices, 1)),
+      _parallelThreshold(std::max(parallelThreshold, 1)), _near(0.0f), _far(0.0f), _projection(0.0f), _numGlobal(0),
+      _depthPBO(0), _depthFence(nullptr), _depthCapacity(0), _sampleNear(0.0f), _sampleFar(0.0f), _sampleGlobal(0)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        _buffers[i] = 0;
+        _textures[i] = 0;
+        _capacity[i] = 0;
+    }
+
+    _depthSize[0] = _depthSize[1] = 0;
+
+    int numClusters = _tilesX * _tilesY * _slices;
+    _minX.resize(numClusters);
+    _maxX.resize(numClusters);
+    _minY.resize(numClusters);
+    _maxY.resize(numClusters);
+    _minZ.resize(numClusters);
+    _maxZ.resize(numClusters);
+    _grid.resize(2 * numClusters);
+    _bins.resize(_slices);
+
+    _stats.clusters = numClusters;
+
+    if (numThreads > 0)
+        _workers.reset(new ThreadPool(numThreads, 0, "Clusters"));
+}
+
+hzgl::LightClusters::~LightClusters()
+{
+    // GL objects are released explicitly while the context is alive
+}
+
+void hzgl::LightClusters::updateBounds(const glm::mat4& projection)
+{
+    _projection = projection;
+
+    // near and far planes of a perspective projection (also off-center ones)
+    _near = projection[3][2] / (projection[2][2] - 1.0f);
+    _far = projection[3][2] / (projection[2][2] + 1.0f);
+
+    // a view-space point at distance d lands on x_ndc = x * P00 / d - P20, so
+    // x = d * (x_ndc + P20) / P00 (and the same for y)
+    auto viewX = [&](float ndc, float d) { return d * (ndc + projection[2][0]) / projection[0][0]; };
+    auto viewY = [&](float ndc, float d) { return d * (ndc + projection[2][1]) / projection[1][1]; };
+
+    for (int s = 0; s < _slices; s++)
+    {
+        // exponential slices: each one covers the same depth ratio
+        float d0 = _near * std::pow(_far / _near, static_cast<float>(s) / _slices);
+        float d1 = _near * std::pow(_far / _near, static_cast<float>(s + 1) / _slices);
+
+        for (int ty = 0; ty < _tilesY; ty++)
+        {
+            float y0 = -1.0f + 2.0f * ty / _tilesY;
+            float y1 = -1.0f + 2.0f * (ty + 1) / _tilesY;
+
+            for (int tx = 0; tx < _tilesX; tx++)
+            {
+                float x0 = -1.0f + 2.0f * tx / _tilesX;
+                float x1 = -1.0f + 2.0f * (tx + 1) / _tilesX;
+
+                int c = tx + _tilesX * (ty + _tilesY * s);
+
+                _minX[c] = std::min(std::min(viewX(x0, d0), viewX(x0, d1)), std::min(viewX(x1, d0), viewX(x1, d1)));
+                _maxX[c] = std::max(std::max(viewX(x0, d0), viewX(x0, d1)), std::max(viewX(x1, d0), viewX(x1, d1)));
+                _minY[c] = std::min(std::min(viewY(y0, d0), viewY(y0, d1)), std::min(viewY(y1, d0), viewY(y1, d1)));
+                _maxY[c] = std::max(std::max(viewY(y0, d0), viewY(y0, d1)), std::max(viewY(y1, d0), viewY(y1, d1)));
+                _minZ[c] = d0;
+                _maxZ[c] = d1;
+            }
+        }
+    }
+}
+
+void hzgl::LightClusters::binSlices(int first, int last)
+{
+    int perSlice = _tilesX * _tilesY;
+
+    for (int s = first; s < last; s++)
+    {
+        SliceBins& bins = _bins[s];
+        bins.hits.clear();
+
+        int base = s * perSlice;
+        float sliceNear = _minZ[base];
+        float sliceFar = _maxZ[base];
+
+        for (size_t l = 0; l < _spheres.size(); l++)
+        {
+            const glm::vec4& sphere = _spheres[l];
+
+            if (sphere.z + sphere.w < sliceNear || sphere.z - sphere.w > sliceFar)
+                continue;
+
+            uint32_t light = static_cast<uint32_t>(_numGlobal + l);
+            float r2 = sphere.w * sphere.w;
+
+            // squared distance from the center to every cluster box of the slice
+#ifdef HZGL_CLUSTER_SSE
+            __m128 zero = _mm_setzero_ps();
+            __m128 cx = _mm_set1_ps(sphere.x);
+            __m128 cy = _mm_set1_ps(sphere.y);
+            __m128 radius2 = _mm_set1_ps(r2);
+
+            float dz = std::max(std::max(sliceNear - sphere.z, sphere.z - sliceFar), 0.0f);
+            __m128 dz2 = _mm_set1_ps(dz * dz);
+
+            for (int c = 0; c < perSlice; c += 4)
+            {
+                __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&_minX[base + c]), cx),
+                                                  _mm_sub_ps(cx, _mm_loadu_ps(&_maxX[base + c]))), zero);
+                __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&_minY[base + c]), cy),
+                                                  _mm_sub_ps(cy, _mm_loadu_ps(&_maxY[base + c]))), zero);
+                __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), dz2);
+
+                int mask = _mm_movemask_ps(_mm_cmple_ps(d2, radius2));
+
+                for (int k = 0; mask != 0; k++, mask >>= 1)
+                {
+                    if (mask & 1)
+                    {
+                        bins.hits.push_back(static_cast<uint32_t>(c + k));
+                        bins.hits.push_back(light);
+                    }
+                }
+            }
+#else
+            for (int c = 0; c < perSlice; c++)
+            {
+                float dx = std::max(std::max(_minX[base + c] - sphere.x, sphere.x - _maxX[base + c]), 0.0f);
+                float dy = std::max(std::max(_minY[base + c] - sphere.y, sphere.y - _maxY[base + c]), 0.0f);
+                float dz = std::max(std::max(sliceNear - sphere.z, sphere.z - sliceFar), 0.0f);
+
+                if (dx * dx + dy * dy + dz * dz <= r2)
+                {
+                    bins.hits.push_back(static_cast<uint32_t>(c));
+                    bins.hits.push_back(light);
+                }
+            }
+#endif
+        }
+
+        // counting sort by cluster; the lights of a cluster stay in ascending order
+        bins.counts.assign(perSlice, 0);
+        for (size_t h = 0; h < bins.hits.size(); h += 2)
+            bins.counts[bins.hits[h]]++;
+
+        bins.starts.resize(perSlice);
+        uint32_t offset = 0;
+        for (int c = 0; c < perSlice; c++)
+        {
+            bins.starts[c] = offset;
+            offset += bins.counts[c];
+        }
+
+        bins.lists.resize(offset);
+        for (size_t h = 0; h < bins.hits.size(); h += 2)
+            bins.lists[bins.starts[bins.hits[h]]++] = bins.hits[h + 1];
+    }
+}
+
+void hzgl::LightClusters::Build(const std::vector<Light>& lights, const glm::mat4& view, const glm::mat4& projection,
+                                const std::vector<glm::ivec2>* shadows)
+{
+    HZGL_PROFILE_SCOPE("LightClusters::Build");
+
+    SimpleTimer binTimer;
+    binTimer.Start();
+
+    if (projection != _projection)
+        updateBounds(projection);
+
+    _lightData.clear();
+    _spheres.clear();
+
+    // lights without a range go first, every fragment evaluates them
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (size_t l = 0; l < lights.size(); l++)
+        {
+            const Light& light = lights[l];
+            float range = LightRange(light);
+
+            if (!light.isEnabled || range == 0.0f || (range < 0.0f) != (pass == 0))
+                continue;
+
+            _lightData.push_back(glm::vec4(light.position, light.type == HZGL_DIRECTIONAL_LIGHT ? 0.0f : 1.0f));
+            _lightData.push_back(glm::vec4(light.color, light.type == HZGL_SPOT_LIGHT ? 1.0f : 0.0f));
+            _lightData.push_back(glm::vec4(light.ambient, light.spotExponent));
+            _lightData.push_back(glm::vec4(light.coneDirection, light.spotCosCutoff));
+            _lightData.push_back(glm::vec4(light.constantAttenuation, light.linearAttenuation, light.quadraticAttenuation, range));
+
+            // first shadow view and number of views (0: no shadow)
+            glm::ivec2 shadow = (shadows != nullptr && l < shadows->size()) ? (*shadows)[l] : glm::ivec2(0, 0);
+            _lightData.push_back(glm::vec4(float(shadow[0]), float(shadow[1]), 0.0f, 0.0f));
+
+            if (pass == 1)
+            {
+                glm::vec4 center = view * glm::vec4(light.position, 1.0f);
+                _spheres.push_back(glm::vec4(center.x, center.y, -center.z, range));
+            }
+        }
+
+        if (pass == 0)
+            _numGlobal = static_cast<int>(_lightData.size() / 6);
+    }
+
+    // slices are independent, so they split across the workers without any locking
+    if (_workers != nullptr && static_cast<int>(_spheres.size()) >= _parallelThreshold)
+    {
+        int numTasks = std::min(_workers->NumThreads(), _slices);
+        int chunk = (_slices + numTasks - 1) / numTasks;
+
+        for (int first = 0; first < _slices; first += chunk)
+        {
+            int last = std::min(first + chunk, _slices);
+            _workers->Submit([this, first, last]() { binSlices(first, last); });
+        }
+
+        _workers->Wait();
+    }
+    else
+    {
+        binSlices(0, _slices);
+    }
+
+    // one index list for the whole grid
+    int perSlice = _tilesX * _tilesY;
+    _indices.clear();
+
+    _stats.occupied_clusters = 0;
+    _stats.max_per_cluster = 0;
+
+    for (int s = 0; s < _slices; s++)
+    {
+        const SliceBins& bins = _bins[s];
+        uint32_t base = static_cast<uint32_t>(_indices.size());
+
+        for (int c = 0; c < perSlice; c++)
+        {
+            uint32_t count = bins.counts[c];
+
+            // starts were advanced to the end of each list by the sort
+            _grid[2 * (s * perSlice + c) + 0] = base + bins.starts[c] - count;
+            _grid[2 * (s * perSlice + c) + 1] = count;
+
+            _stats.occupied_clusters += (count > 0) ? 1 : 0;
+            _stats.max_per_cluster = std::max(_stats.max_per_cluster, static_cast<int>(count));
+        }
+
+        _indices.insert(_indices.end(), bins.lists.begin(), bins.lists.end());
+    }
+
+    _stats.lights = static_cast<int>(_lightData.size() / 6);
+    _stats.global_lights = _numGlobal;
+    _stats.indices = static_cast<int>(_indices.size());
+    _stats.bin_ms = 1000.0 * binTimer.End();
+
+    HZGL_PROFILE_SCOPE("LightClusters::Upload");
+
+    upload(0, GL_RGBA32F, _lightData.data(), _lightData.size() * sizeof(glm::vec4));
+    upload(1, GL_RG32UI, _grid.data(), _grid.size() * sizeof(uint32_t));
+    upload(2, GL_R32UI, _indices.data(), _indices.size() * sizeof(uint32_t));
+}
+
+void hzgl::LightClusters::upload(int slot, GLenum format, const void* data, size_t size)
+{
+    if (_buffers[slot] == 0)
+    {
+        glGenBuffers(1, &_buffers[slot]);
+        glGenTextures(1, &_textures[slot]);
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, _buffers[slot]);
+
+    // grow by doubling; otherwise orphan the storage so the previous frame can keep reading it
+    if (_capacity[slot] < std::max<size_t>(size, 16))
+    {
+        _capacity[slot] = std::max<size_t>(2 * _capacity[slot], std::max<size_t>(size, 256));
+
+        glBufferData(GL_TEXTURE_BUFFER, _capacity[slot], nullptr, GL_STREAM_DRAW);
+        TrackGpuResource({HZGL_GPU_BUFFER, _buffers[slot], _capacity[slot], "Light clusters", "", "texture buffer"});
+
+        glBindTexture(GL_TEXTURE_BUFFER, _textures[slot]);
+        glTexBuffer(GL_TEXTURE_BUFFER, format, _buffers[slot]);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+    else
+    {
+        glBufferData(GL_TEXTURE_BUFFER, _capacity[slot], nullptr, GL_STREAM_DRAW);
+    }
+
+    if (size > 0)
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void hzgl::LightClusters::Bind(GLuint program, const glm::ivec4& viewport, int firstUnit)
+{
+    const char* samplers[3] = {"uLightData", "uClusterGrid", "uLightIndices"};
+
+    for (int i = 0; i < 3; i++)
+    {
+        glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+        glBindTexture(GL_TEXTURE_BUFFER, _textures[i]);
+        glUniform1i(glGetUniformLocation(program, samplers[i]), firstUnit + i);
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+
+    // slice = log(d) * scale + bias
+    float scale = _slices / std::log(_far / _near);
+    float bias = -scale * std::log(_near);
+
+    glUniform1i(glGetUniformLocation(program, "uNumGlobalLights"), _numGlobal);
+    glUniform3i(glGetUniformLocation(program, "uClusterDims"), _tilesX, _tilesY, _slices);
+    glUniform4f(glGetUniformLocation(program, "uClusterViewport"), float(viewport.x), float(viewport.y), float(viewport.z), float(viewport.w));
+    glUniform4f(glGetUniformLocation(program, "uClusterDepth"), _near, _far, scale, bias);
+}
+
+void hzgl::LightClusters::countFragments(const float* depth, int width, int height)
+{
+    HZGL_PROFILE_SCOPE("LightClusters::countFragments");
+
+    float scale = _slices / std::log(_sampleFar / _sampleNear);
+    float bias = -scale * std::log(_sampleNear);
+
+    double lights = 0.0;
+    int64_t fragments = 0;
+
+    // every 4th pixel in both directions is plenty for an average
+    for (int y = 0; y < height; y += 4)
+    {
+        for (int x = 0; x < width; x += 4)
+        {
+            float z = depth[static_cast<size_t>(y) * width + x];
+
+            // background
+            if (z >= 1.0f)
+                continue;
+
+            float d = _sampleNear * _sampleFar / (_sampleFar - z * (_sampleFar - _sampleNear));
+            int s = std::min(std::max(static_cast<int>(std::floor(std::log(d) * scale + bias)), 0), _slices - 1);
+            int tx = std::min(x * _tilesX / width, _tilesX - 1);
+            int ty = std::min(y * _tilesY / height, _tilesY - 1);
+
+            lights += _sampleGrid[tx + _tilesX * (ty + _tilesY * s)] + _sampleGlobal;
+            fragments++;
+        }
+    }
+
+    _stats.lights_per_fragment = (fragments > 0) ? lights / fragments : 0.0;
+}
+
+void hzgl::LightClusters::SampleDepth(const glm::ivec4& viewport, bool wait)
+{
+    HZGL_PROFILE_SCOPE("LightClusters::SampleDepth");
+
+    // a finished readback is counted before the next one is queued
+    if (_depthFence != nullptr)
+    {
+        GLenum status = glClientWaitSync(_depthFence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED && !wait)
+            return;
+
+        glDeleteSync(_depthFence);
+        _depthFence = nullptr;
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, _depthPBO);
+        const float* depth = static_cast<const float*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+            sizeof(float) * _depthSize[0] * _depthSize[1], GL_MAP_READ_BIT));
+
+        if (depth != nullptr)
+            countFragments(depth, _depthSize[0], _depthSize[1]);
+
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        if (!wait)
+            return;
+    }
+
+    // the counts of the view that was drawn, Build() may run again before the readback is done
+    _sampleGrid.resize(_grid.size() / 2);
+    for (size_t c = 0; c < _sampleGrid.size(); c++)
+        _sampleGrid[c] = _grid[2 * c + 1];
+
+    _sampleNear = _near;
+    _sampleFar = _far;
+    _sampleGlobal = _numGlobal;
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    if (wait)
+    {
+        _depth.resize(static_cast<size_t>(viewport.z) * viewport.w);
+        glReadPixels(viewport.x, viewport.y, viewport.z, viewport.w, GL_DEPTH_COMPONENT, GL_FLOAT, _depth.data());
+        countFragments(_depth.data(), viewport.z, viewport.w);
+        return;
+    }
+
+    size_t size = sizeof(float) * viewport.z * viewport.w;
+
+    if (_depthPBO == 0)
+        glGenBuffers(1, &_depthPBO);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, _depthPBO);
+
+    if (_depthCapacity < size)
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        _depthCapacity = size;
+
+        TrackGpuResource({HZGL_GPU_BUFFER, _depthPBO, size, "Light clusters", "", "pixel pack buffer"});
+    }
+
+    // with a pack buffer bound this only queues the copy
+    glReadPixels(viewport.x, viewport.y, viewport.z, viewport.w, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    _depthFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _depthSize[0] = viewport.z;
+    _depthSize[1] = viewport.w;
+}
+
+const hzgl::ClusterStats& hzgl::LightClusters::Stats() const
+{
+    return _stats;
+}
+
+void hzgl::LightClusters::Release()
+{
+    for (int i = 0; i < 3; i++)
+    {
+        if (_buffers[i] != 0)
+        {
+            UntrackGpuResource(HZGL_GPU_BUFFER, _buffers[i]);
+            glDeleteBuffers(1, &_buffers[i]);
+            glDeleteTextures(1, &_textures[i]);
+        }
+
+        _buffers[i] = 0;
+        _textures[i] = 0;
+        _capacity[i] = 0;
+    }
+
+    if (_depthFence != nullptr)
+        glDeleteSync(_depthFence);
+
+    if (_depthPBO != 0)
+    {
+        UntrackGpuResource(HZGL_GPU_BUFFER, _depthPBO);
+        glDeleteBuffers(1, &_depthPBO);
+    }
+
+    _depthFence = nullptr;
+    _depthPBO = 0;
+    _depthCapacity = 0;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Light.hpp"
+#include "ThreadPool.hpp"
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+namespace hzgl
+{
+    typedef struct
+    {
+        int lights = 0;                   // enabled lights in the light buffer
+        int global_lights = 0;            // directional lights (and local ones that never fade out)
+        int clusters = 0;
+        int occupied_clusters = 0;
+        int indices = 0;                  // entries in all cluster lists
+        int max_per_cluster = 0;
+        double bin_ms = 0.0;              // binning on the CPU, without the upload
+        double lights_per_fragment = -1.0; // from the last depth sample, -1 until there is one
+    } ClusterStats;
+
+    // distance at which the attenuation of a local light brings its brightest channel below
+    // cutoff; negative for lights without falloff (directional lights, zero attenuation terms)
+    float LightRange(const Light& light, float cutoff = 1.0f / 256.0f);
+
+    // "SSE" or "scalar", whichever the sphere/cluster tests were compiled with
+    const char* LightClusterSimdPath();
+
+    // clustered forward lighting: the view frustum is split into tiles on screen and exponential
+    // slices in depth, every local light is binned into the clusters its sphere of influence
+    // touches, and the lists are uploaded as texture buffers so a fragment only evaluates the
+    // lights of its own cluster (plus the global ones)
+    class LightClusters
+    {
+    private:
+        int _tilesX;                      // rounded up to a multiple of 4 (one SSE register)
+        int _tilesY;
+        int _slices;
+        int _parallelThreshold;
+
+        float _near;
+        float _far;
+        glm::mat4 _projection;
+
+        // view-space bounds of every cluster (x fastest, then y, then slice), depth as distance
+        std::vector<float> _minX, _maxX, _minY, _maxY, _minZ, _maxZ;
+
+        // lights of the current view: global ones first, then the local ones
+        std::vector<glm::vec4> _lightData;     // 6 texels per light
+        std::vector<glm::vec4> _spheres;       // view-space center and range of the local lights
+        int _numGlobal;
+
+        // per slice: (cluster in slice, light) pairs, sorted by cluster into lists
+        typedef struct
+        {
+            std::vector<uint32_t> hits;      // cluster, light, cluster, light, ...
+            std::vector<uint32_t> lists;     // lights of cluster 0, then cluster 1, ...
+            std::vector<uint32_t> counts;
+            std::vector<uint32_t> starts;
+        } SliceBins;
+
+        std::vector<SliceBins> _bins;
+        std::vector<uint32_t> _grid;           // offset and count per cluster
+        std::vector<uint32_t> _indices;
+
+        // texture buffers: lights, grid, indices
+        GLuint _buffers[3];
+        GLuint _textures[3];
+        size_t _capacity[3];
+
+        // depth samples for the lights-per-fragment estimate
+        GLuint _depthPBO;
+        GLsync _depthFence;
+        size_t _depthCapacity;
+        int _depthSize[2];
+        float _sampleNear, _sampleFar;
+        int _sampleGlobal;
+        std::vector<uint32_t> _sampleGrid;     // cluster counts of the sampled view
+        std::vector<float> _depth;
+
+        std::unique_ptr<ThreadPool> _workers;
+        ClusterStats _stats;
+
+        void updateBounds(const glm::mat4& projection);
+        void binSlices(int first, int last);
+        void upload(int slot, GLenum format, const void* data, size_t size);
+        void countFragments(const float* depth, int width, int height);
+
+    public:
+        // numThreads 0 bins on the calling thread; with at least parallelThreshold local lights
+        // the slices are split across the workers
+        LightClusters(int tilesX = 16, int tilesY = 9, int slices = 24, int numThreads = 0, int parallelThreshold = 64);
+        ~LightClusters();
+
+        LightClusters(const LightClusters&) = delete;
+        LightClusters& operator=(const LightClusters&) = delete;
+
+        // bin the enabled lights into the clusters of a perspective view and upload the lists;
+        // shadows holds the (first, count) shadow views of every light (see ShadowAtlas)
+        void Build(const std::vector<Light>& lights, const glm::mat4& view, const glm::mat4& projection,
+                   const std::vector<glm::ivec2>* shadows = nullptr);
+
+        // bind the buffers to texture units firstUnit..firstUnit+2 and set the uniforms of the
+        // program in use; viewport is the one the fragments are drawn into
+        void Bind(GLuint program, const glm::ivec4& viewport, int firstUnit = 8);
+
+        // read back the depth of the last Build()'s view to count the lights evaluated per
+        // fragment; without wait the result arrives with a later call
+        void SampleDepth(const glm::ivec4& viewport, bool wait = false);
+
+        const ClusterStats& Stats() const;
+
+        // delete the GL objects (needs the context that created them)
+        void Release();
+    };
+} // namespace hzgl
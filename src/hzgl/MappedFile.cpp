@@ -0,0 +1,256 @@
+#include "MappedFile.hpp"
+
+#include <cstdio>
+#include <algorithm>
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+#define HZGL_LOG_ERROR(msg) \
+    fprintf(stderr, "[ERROR] %s (line %d): %s\n", __FILE__, __LINE__, msg);
+
+// page-aligned [begin, end) covering the range, clamped to the mapping
+static void hzglPageRange(size_t offset, size_t length, size_t size, size_t* begin, size_t* end)
+{
+    static size_t pageSize = 0;
+
+    if (pageSize == 0)
+    {
+#if defined(_WIN32)
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        pageSize = info.dwPageSize;
+#else
+        pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    }
+
+    offset = std::min(offset, size);
+    length = std::min(length, size - offset);
+
+    *begin = offset / pageSize * pageSize;
+    *end = (length > 0) ? offset + length : *begin;
+}
+
+hzgl::MappedFile::MappedFile()
+    : _data(nullptr), _size(0), _writable(false)
+#if defined(_WIN32)
+    , _file(INVALID_HANDLE_VALUE), _mapping(nullptr)
+#else
+    , _fd(-1)
+#endif
+{
+}
+
+hzgl::MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool hzgl::MappedFile::Open(const std::string& filepath)
+{
+    Close();
+
+#if defined(_WIN32)
+    _file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (_file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(_file, &size))
+    {
+        Close();
+        return false;
+    }
+
+    _size = static_cast<size_t>(size.QuadPart);
+
+    // an empty file cannot be mapped, but is a valid (empty) view
+    if (_size == 0)
+        return true;
+
+    _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    _data = (_mapping != nullptr) ? static_cast<uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+#else
+    _fd = open(filepath.c_str(), O_RDONLY);
+    if (_fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(_fd, &info) != 0)
+    {
+        Close();
+        return false;
+    }
+
+    _size = static_cast<size_t>(info.st_size);
+
+    if (_size == 0)
+        return true;
+
+    void* data = mmap(nullptr, _size, PROT_READ, MAP_SHARED, _fd, 0);
+    _data = (data != MAP_FAILED) ? static_cast<uint8_t*>(data) : nullptr;
+#endif
+
+    if (_data == nullptr)
+    {
+        HZGL_LOG_ERROR("Failed to map the file.")
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+bool hzgl::MappedFile::Create(const std::string& filepath, size_t size)
+{
+    Close();
+
+    if (size == 0)
+        return false;
+
+#if defined(_WIN32)
+    _file = CreateFileA(filepath.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (_file == INVALID_HANDLE_VALUE)
+        return false;
+
+    // the mapping extends the file to its size
+    LARGE_INTEGER length;
+    length.QuadPart = static_cast<LONGLONG>(size);
+
+    _mapping = CreateFileMappingA(_file, nullptr, PAGE_READWRITE, length.HighPart, length.LowPart, nullptr);
+    _data = (_mapping != nullptr) ? static_cast<uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0)) : nullptr;
+#else
+    _fd = open(filepath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (_fd < 0)
+        return false;
+
+    // sparse: no disk space is used before the pages are written
+    if (ftruncate(_fd, static_cast<off_t>(size)) != 0)
+    {
+        Close();
+        return false;
+    }
+
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    _data = (data != MAP_FAILED) ? static_cast<uint8_t*>(data) : nullptr;
+#endif
+
+    if (_data == nullptr)
+    {
+        HZGL_LOG_ERROR("Failed to map the file.")
+        Close();
+        return false;
+    }
+
+    _size = size;
+    _writable = true;
+
+    return true;
+}
+
+void hzgl::MappedFile::Close()
+{
+#if defined(_WIN32)
+    if (_data != nullptr)
+        UnmapViewOfFile(_data);
+    if (_mapping != nullptr)
+        CloseHandle(_mapping);
+    if (_file != INVALID_HANDLE_VALUE)
+        CloseHandle(_file);
+
+    _mapping = nullptr;
+    _file = INVALID_HANDLE_VALUE;
+#else
+    if (_data != nullptr)
+        munmap(_data, _size);
+    if (_fd >= 0)
+        close(_fd);
+
+    _fd = -1;
+#endif
+
+    _data = nullptr;
+    _size = 0;
+    _writable = false;
+}
+
+bool hzgl::MappedFile::IsOpen() const
+{
+#if defined(_WIN32)
+    return _file != INVALID_HANDLE_VALUE;
+#else
+    return _fd >= 0;
+#endif
+}
+
+const uint8_t* hzgl::MappedFile::Data() const
+{
+    return _data;
+}
+
+uint8_t* hzgl::MappedFile::MutableData()
+{
+    return _writable ? _data : nullptr;
+}
+
+size_t hzgl::MappedFile::Size() const
+{
+    return _size;
+}
+
+void hzgl::MappedFile::AdviseSequential(size_t offset, size_t length)
+{
+    size_t begin, end;
+    hzglPageRange(offset, length, _size, &begin, &end);
+
+    if (_data == nullptr || end <= begin)
+        return;
+
+#if !defined(_WIN32)
+    madvise(_data + begin, end - begin, MADV_SEQUENTIAL);
+#endif
+}
+
+void hzgl::MappedFile::Prefetch(size_t offset, size_t length)
+{
+    size_t begin, end;
+    hzglPageRange(offset, length, _size, &begin, &end);
+
+    if (_data == nullptr || end <= begin)
+        return;
+
+#if defined(_WIN32)
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = _data + begin;
+    range.NumberOfBytes = end - begin;
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    madvise(_data + begin, end - begin, MADV_WILLNEED);
+#endif
+}
+
+void hzgl::MappedFile::Evict(size_t offset, size_t length)
+{
+    size_t begin, end;
+    hzglPageRange(offset, length, _size, &begin, &end);
+
+    if (_data == nullptr || end <= begin)
+        return;
+
+#if defined(_WIN32)
+    // unlocking pages that are not locked takes them out of the working set
+    VirtualUnlock(_data + begin, end - begin);
+#else
+    // shared file pages: written ones stay in the page cache and reach the file as usual
+    madvise(_data + begin, end - begin, MADV_DONTNEED);
+#endif
+}
+
+#undef HZGL_LOG_ERROR
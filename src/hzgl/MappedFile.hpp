@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace hzgl
+{
+    // a whole file mapped into the address space, read-only or (created at a fixed size)
+    // read-write. Pages come in on first touch and count towards the resident set until the
+    // system needs them back, or until Evict() drops them
+    class MappedFile
+    {
+    private:
+        uint8_t* _data;
+        size_t _size;
+        bool _writable;
+#if defined(_WIN32)
+        void* _file;
+        void* _mapping;
+#else
+        int _fd;
+#endif
+
+    public:
+        MappedFile();
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool Open(const std::string& filepath);
+
+        // create (or truncate) the file at the given size, e.g. as scratch space
+        bool Create(const std::string& filepath, size_t size);
+
+        void Close();
+
+        bool IsOpen() const;
+        const uint8_t* Data() const;
+        uint8_t* MutableData();             // nullptr unless created
+        size_t Size() const;
+
+        // hints for a range about to be read front to back, or soon
+        void AdviseSequential(size_t offset, size_t length);
+        void Prefetch(size_t offset, size_t length);
+
+        // take the pages of a range out of the resident set; the data stays in the file (written
+        // pages included) and is read back from the page cache or the disk when touched again
+        void Evict(size_t offset, size_t length);
+    };
+} // namespace hzgl
@@ -0,0 +1,646 @@
+#include "MappedMesh.hpp"
+
+#include "Ply.hpp"
+#include "Timer.hpp"
+#include "Profiler.hpp"
+#include "ThreadPool.hpp"
+#include "MappedFile.hpp"
+
+#include <atomic>
+#include <limits>
+#include <cstring>
+#include <numeric>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+
+#if defined(__SSSE3__)
+    #define HZGL_MAPPED_MESH_SSSE3
+    #include <tmmintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define HZGL_MAPPED_MESH_SSE2
+    #include <emmintrin.h>
+#endif
+
+// a range split into a few chunks per worker, body(begin, end) runs once per chunk
+static void hzglForChunks(hzgl::ThreadPool* pool, size_t count, const std::function<void(size_t, size_t)>& body)
+{
+    size_t chunks = (pool == nullptr) ? 1 : std::min(count / 4096 + 1, static_cast<size_t>(4 * pool->NumThreads()));
+
+    if (chunks <= 1)
+    {
+        body(0, count);
+        return;
+    }
+
+    for (size_t c = 0; c < chunks; c++)
+    {
+        size_t begin = count * c / chunks;
+        size_t end = count * (c + 1) / chunks;
+        pool->Submit([&body, begin, end]() { body(begin, end); });
+    }
+
+    pool->Wait();
+}
+
+// n 32-bit words from src (any alignment) to dst, with the bytes of each reversed
+static void hzglSwap32(const uint8_t* src, uint32_t* dst, size_t n)
+{
+    size_t i = 0;
+
+#if defined(HZGL_MAPPED_MESH_SSSE3)
+    const __m128i order = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_shuffle_epi8(words, order));
+    }
+#elif defined(HZGL_MAPPED_MESH_SSE2)
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i));
+
+        // the bytes within each 16-bit half, then the halves
+        words = _mm_or_si128(_mm_slli_epi16(words, 8), _mm_srli_epi16(words, 8));
+        words = _mm_shufflehi_epi16(_mm_shufflelo_epi16(words, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), words);
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        const uint8_t* p = src + 4 * i;
+        dst[i] = (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    }
+}
+
+static inline float hzglPlyFloat(const uint8_t* p, const hzgl::PlyProperty& property, bool bigEndian)
+{
+    if (property.is_float && property.size == 4 && !bigEndian)
+    {
+        float value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    return static_cast<float>(hzgl::ReadPlyScalar(p, property, bigEndian));
+}
+
+static inline uint32_t hzglPlyIndex(const uint8_t* p, int size, bool bigEndian)
+{
+    if (size == 4 && !bigEndian)
+    {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    return static_cast<uint32_t>(hzgl::ReadPlyUnsigned(p, size, bigEndian));
+}
+
+static std::string hzglMeshName(const std::string& filepath)
+{
+    std::string name = filepath.substr(filepath.find_last_of("/\\") + 1);
+    return name.substr(0, name.find_last_of('.'));
+}
+
+//
+// PLY
+//
+
+// the first pair of texture coordinates under any of the usual names
+static bool hzglFindTexcoords(const hzgl::PlyElement& vertices, int* u, int* v)
+{
+    const char* names[][2] = {{"s", "t"}, {"u", "v"}, {"texture_u", "texture_v"}, {"texture_s", "texture_t"}};
+
+    for (const auto& pair : names)
+    {
+        *u = hzgl::FindPlyProperty(vertices, pair[0]);
+        *v = hzgl::FindPlyProperty(vertices, pair[1]);
+
+        if (*u >= 0 && *v >= 0)
+            return true;
+    }
+
+    return false;
+}
+
+// faces of any size, one after another: fans of triangles, false on a bad index or the end of the file
+static bool hzglReadPolygons(const uint8_t* data, size_t size, size_t offset, const hzgl::PlyElement& face, int list, bool bigEndian,
+                             int64_t numVertices, std::vector<unsigned>& indices)
+{
+    // a face takes a byte at least, whatever the header claims
+    indices.clear();
+    indices.reserve(std::min(3 * static_cast<size_t>(face.count), (offset < size) ? size - offset : 0));
+
+    std::vector<uint32_t> corners;
+
+    for (int64_t f = 0; f < face.count; f++)
+    {
+        offset = hzgl::ReadPlyFace(data, size, offset, face, list, bigEndian, corners);
+
+        if (offset == 0)
+            return false;
+
+        for (uint32_t corner : corners)
+        {
+            if (corner >= numVertices)
+                return false;
+        }
+
+        for (size_t i = 2; i < corners.size(); i++)
+            indices.insert(indices.end(), {corners[0], corners[i - 1], corners[i]});
+    }
+
+    return true;
+}
+
+bool hzgl::ReadPlyMesh(const std::string& filepath, MeshInfo& mesh, ThreadPool* pool, MeshReadStats* stats)
+{
+    HZGL_PROFILE_SCOPE("ReadPlyMesh");
+
+    MeshReadStats localStats;
+    MeshReadStats& st = (stats != nullptr) ? *stats : localStats;
+    st = MeshReadStats();
+
+    SimpleTimer totalTimer, timer;
+    totalTimer.Start();
+    timer.Start();
+
+    MappedFile file;
+    PlyHeader header;
+
+    if (!file.Open(filepath) || !ReadPlyHeader(file.Data(), file.Size(), &header) || !header.binary)
+        return false;
+
+    int vertex = FindPlyElement(header, "vertex");
+    int face = FindPlyElement(header, "face");
+
+    if (vertex < 0 || face < 0)
+        return false;
+
+    const PlyElement& vertices = header.elements[vertex];
+    const PlyElement& faces = header.elements[face];
+    size_t vertexOffset = PlyElementOffset(header, vertex);
+    size_t faceOffset = PlyElementOffset(header, face);
+
+    // the vertices have to be a table, the faces only have to come right after fixed-size elements
+    if (vertexOffset == 0 || faceOffset == 0 || vertices.stride == 0 || vertexOffset + vertices.count * vertices.stride > file.Size())
+        return false;
+
+    // MeshInfo counts vertices in an int
+    if (vertices.count > std::numeric_limits<int>::max())
+    {
+        std::cerr << filepath << ": too many vertices for one mesh" << std::endl;
+        return false;
+    }
+
+    int position[3] = {FindPlyProperty(vertices, "x"), FindPlyProperty(vertices, "y"), FindPlyProperty(vertices, "z")};
+    int normal[3] = {FindPlyProperty(vertices, "nx"), FindPlyProperty(vertices, "ny"), FindPlyProperty(vertices, "nz")};
+    int texcoord[2] = {-1, -1};
+
+    int list = FindPlyFaceIndices(faces);
+
+    if (position[0] < 0 || position[1] < 0 || position[2] < 0 || list < 0)
+        return false;
+
+    bool hasNormals = normal[0] >= 0 && normal[1] >= 0 && normal[2] >= 0;
+    bool hasTexcoords = hzglFindTexcoords(vertices, &texcoord[0], &texcoord[1]);
+    bool bigEndian = header.big_endian;
+
+    // the same texture comment Assimp reads
+    std::string head(reinterpret_cast<const char*>(file.Data()), header.data_offset);
+    size_t comment = head.find("comment TextureFile ");
+
+    mesh = MeshInfo();
+    mesh.name = hzglMeshName(filepath);
+    mesh.num_vertices = static_cast<int>(vertices.count);
+    mesh.shading_mode = hasTexcoords ? HZGL_NORMAL_MAPPING : HZGL_PHONG;
+
+    if (comment != std::string::npos)
+    {
+        size_t begin = comment + strlen("comment TextureFile ");
+        std::string texture = head.substr(begin, head.find_first_of("\r\n", begin) - begin);
+        std::string parentpath = filepath.substr(0, filepath.find_last_of("/\\") + 1);
+
+        mesh.texpath["diffuse"] = parentpath + texture;
+    }
+
+    st.input_vertices = vertices.count;
+    st.output_vertices = vertices.count;
+    st.byte_swapped = bigEndian;
+    st.header_ms = 1000.0 * timer.End();
+
+    // vertices: whole words are swapped a block at a time, the fields are then read in host order
+    timer.Start();
+
+    bool words = bigEndian && vertices.stride % 4 == 0
+              && std::all_of(vertices.properties.begin(), vertices.properties.end(), [](const PlyProperty& p) { return p.size == 4; });
+
+    mesh.positions.resize(3 * vertices.count);
+    mesh.normals.resize(hasNormals ? 3 * vertices.count : 0);
+    mesh.texcoords.resize(hasTexcoords ? 2 * vertices.count : 0);
+
+    hzglForChunks(pool, static_cast<size_t>(vertices.count), [&](size_t begin, size_t end) {
+        const size_t block = 4096;
+        std::vector<uint32_t> swapped(words ? block * vertices.stride / 4 : 0);
+
+        for (size_t first = begin; first < end; first += block)
+        {
+            size_t count = std::min(block, end - first);
+            const uint8_t* src = file.Data() + vertexOffset + first * vertices.stride;
+            bool order = bigEndian;
+
+            if (words)
+            {
+                hzglSwap32(src, swapped.data(), count * vertices.stride / 4);
+                src = reinterpret_cast<const uint8_t*>(swapped.data());
+                order = false;
+            }
+
+            for (size_t i = 0; i < count; i++)
+            {
+                const uint8_t* p = src + i * vertices.stride;
+                size_t v = first + i;
+
+                for (int k = 0; k < 3; k++)
+                {
+                    const PlyProperty& property = vertices.properties[position[k]];
+                    mesh.positions[3 * v + k] = hzglPlyFloat(p + property.offset, property, order);
+                }
+
+                for (int k = 0; hasNormals && k < 3; k++)
+                {
+                    const PlyProperty& property = vertices.properties[normal[k]];
+                    mesh.normals[3 * v + k] = hzglPlyFloat(p + property.offset, property, order);
+                }
+
+                for (int k = 0; hasTexcoords && k < 2; k++)
+                {
+                    const PlyProperty& property = vertices.properties[texcoord[k]];
+                    mesh.texcoords[2 * v + k] = hzglPlyFloat(p + property.offset, property, order);
+                }
+            }
+        }
+    });
+
+    st.vertices_ms = 1000.0 * timer.End();
+
+    // faces: if every face is a triangle they all have the same size and can be read in ranges;
+    // that is checked on the way, and a file with anything else is read again one face at a time
+    timer.Start();
+
+    const PlyProperty& indexList = faces.properties[list];
+    size_t record = 0, listOffset = 0;
+    bool otherLists = false;
+
+    for (int k = 0; k < static_cast<int>(faces.properties.size()); k++)
+    {
+        const PlyProperty& property = faces.properties[k];
+
+        if (k == list)
+            listOffset = record;
+
+        if (k != list && property.count_size > 0)
+            otherLists = true;
+
+        record += (k == list) ? property.count_size + 3 * property.size : property.size;
+    }
+
+    bool triangles = !otherLists && faceOffset + faces.count * record <= file.Size();
+    std::atomic<bool> outOfRange(false);
+
+    if (triangles)
+    {
+        std::atomic<bool> polygons(false);
+        mesh.indices.resize(3 * faces.count);
+
+        hzglForChunks(pool, static_cast<size_t>(faces.count), [&](size_t begin, size_t end) {
+            const uint8_t* data = file.Data() + faceOffset + listOffset;
+            uint32_t maxIndex = 0;
+
+            for (size_t f = begin; f < end; f++)
+            {
+                const uint8_t* p = data + f * record;
+
+                if (ReadPlyUnsigned(p, indexList.count_size, bigEndian) != 3)
+                {
+                    polygons = true;
+                    return;
+                }
+
+                p += indexList.count_size;
+
+                for (int k = 0; k < 3; k++)
+                {
+                    uint32_t index = hzglPlyIndex(p + k * indexList.size, indexList.size, bigEndian);
+                    mesh.indices[3 * f + k] = index;
+                    maxIndex = std::max(maxIndex, index);
+                }
+            }
+
+            if (end > begin && maxIndex >= vertices.count)
+                outOfRange = true;
+        });
+
+        triangles = !polygons;
+    }
+
+    if (!triangles)
+        outOfRange = !hzglReadPolygons(file.Data(), file.Size(), faceOffset, faces, list, bigEndian, vertices.count, mesh.indices);
+
+    // and the renderer counts indices in one
+    if (mesh.indices.size() > static_cast<size_t>(std::numeric_limits<int>::max()))
+    {
+        std::cerr << filepath << ": too many triangles for one mesh" << std::endl;
+        mesh = MeshInfo();
+        return false;
+    }
+
+    st.triangles_only = triangles;
+    st.triangles = static_cast<int64_t>(mesh.indices.size() / 3);
+    st.faces_ms = 1000.0 * timer.End();
+    st.total_ms = 1000.0 * totalTimer.End();
+
+    if (outOfRange)
+    {
+        std::cerr << filepath << ": face data runs past the vertices or the file" << std::endl;
+        mesh = MeshInfo();
+        return false;
+    }
+
+    return true;
+}
+
+//
+// STL
+//
+
+// bit pattern of a coordinate, with -0 and +0 made equal
+static uint32_t hzglBits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    return (bits == 0x80000000u) ? 0u : bits;
+}
+
+// a corner by the bits of its position, as the weld moves it around
+typedef struct
+{
+    uint32_t bits[3];
+    uint32_t corner;
+} hzglCornerKey;
+
+static hzglCornerKey hzglKey(const float* p, size_t corner)
+{
+    return {{hzglBits(p[0]), hzglBits(p[1]), hzglBits(p[2])}, static_cast<uint32_t>(corner)};
+}
+
+static uint64_t hzglHashKey(const hzglCornerKey& key)
+{
+    uint64_t h = key.bits[0] * 0x9e3779b97f4a7c15ull;
+    h ^= key.bits[1] * 0xc2b2ae3d27d4eb4full;
+    h ^= key.bits[2] * 0x165667b19e3779f9ull;
+
+    // murmur3 finalizer: every input bit reaches the top bits (partition) and the low bits (slot)
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+
+    return h;
+}
+
+static bool hzglSamePosition(const hzglCornerKey& a, const hzglCornerKey& b)
+{
+    return a.bits[0] == b.bits[0] && a.bits[1] == b.bits[1] && a.bits[2] == b.bits[2];
+}
+
+bool hzgl::ReadStlMesh(const std::string& filepath, MeshInfo& mesh, ThreadPool* pool, MeshReadStats* stats)
+{
+    HZGL_PROFILE_SCOPE("ReadStlMesh");
+
+    MeshReadStats localStats;
+    MeshReadStats& st = (stats != nullptr) ? *stats : localStats;
+    st = MeshReadStats();
+
+    SimpleTimer totalTimer, timer;
+    totalTimer.Start();
+    timer.Start();
+
+    MappedFile file;
+
+    if (!file.Open(filepath) || file.Size() < 84)
+        return false;
+
+    // an 80-byte header, the triangle count, then 50 bytes per triangle: normal, corners, attribute
+    // bytes. ASCII files start with "solid", and so do some binary ones, so the size decides
+    uint32_t numTriangles;
+    memcpy(&numTriangles, file.Data() + 80, sizeof(numTriangles));
+
+    size_t expected = 84 + 50 * static_cast<size_t>(numTriangles);
+    bool ascii = strncmp(reinterpret_cast<const char*>(file.Data()), "solid", 5) == 0 && expected != file.Size();
+
+    // the corners (an upper bound of the vertices) have to fit the int counts of MeshInfo
+    if (ascii || expected > file.Size() || numTriangles == 0 || 3ull * numTriangles > static_cast<uint64_t>(std::numeric_limits<int>::max()))
+        return false;
+
+    size_t numCorners = 3 * static_cast<size_t>(numTriangles);
+
+    st.input_vertices = static_cast<int64_t>(numCorners);
+    st.triangles = numTriangles;
+    st.header_ms = 1000.0 * timer.End();
+
+    timer.Start();
+
+    // corner c of the 50-byte records, straight from the mapping
+    const uint8_t* records = file.Data() + 84;
+
+    auto cornerKey = [records](size_t c) {
+        float position[3];
+        memcpy(position, records + 50 * (c / 3) + 12 + 12 * (c % 3), sizeof(position));
+
+        return hzglKey(position, c);
+    };
+
+    // weld: corners go to partitions by the top bits of their hash (stable, so in corner order
+    // within each), every partition finds the first corner at each position with its own hash
+    // table, and the vertices are numbered in the order their first corner comes in
+    // partitions of about 32k corners keep each hash table in the cache, and there are a few per worker
+    int numPartitions = 1;
+    while (numPartitions < 1024 && (numPartitions * size_t(32768) < numCorners || (pool != nullptr && numPartitions < 8 * pool->NumThreads())))
+        numPartitions *= 2;
+
+    int partitionShift = 64;
+    for (int p = numPartitions; p > 1; p /= 2)
+        partitionShift--;
+
+    auto partitionOf = [partitionShift](const hzglCornerKey& key) {
+        return (partitionShift == 64) ? 0 : static_cast<int>(hzglHashKey(key) >> partitionShift);
+    };
+
+    size_t numChunks = (pool == nullptr) ? 1 : std::min(numCorners / 4096 + 1, static_cast<size_t>(4 * pool->NumThreads()));
+    std::vector<size_t> histogram(numChunks * numPartitions, 0);
+
+    auto forEachChunk = [&](const std::function<void(size_t, size_t, size_t)>& body) {
+        for (size_t chunk = 0; chunk < numChunks; chunk++)
+        {
+            size_t begin = numCorners * chunk / numChunks;
+            size_t end = numCorners * (chunk + 1) / numChunks;
+
+            if (pool != nullptr && numChunks > 1)
+                pool->Submit([&body, chunk, begin, end]() { body(chunk, begin, end); });
+            else
+                body(chunk, begin, end);
+        }
+
+        if (pool != nullptr && numChunks > 1)
+            pool->Wait();
+    };
+
+    forEachChunk([&](size_t chunk, size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++)
+            histogram[chunk * numPartitions + partitionOf(cornerKey(c))] += 1;
+    });
+
+    // where each chunk writes into each partition, partitions one after another
+    std::vector<size_t> partitionStart(numPartitions + 1, 0);
+    {
+        size_t offset = 0;
+
+        for (int p = 0; p < numPartitions; p++)
+        {
+            partitionStart[p] = offset;
+
+            for (size_t chunk = 0; chunk < numChunks; chunk++)
+            {
+                size_t count = histogram[chunk * numPartitions + p];
+                histogram[chunk * numPartitions + p] = offset;
+                offset += count;
+            }
+        }
+
+        partitionStart[numPartitions] = offset;
+    }
+
+    // the positions travel with the corners, so that a partition is welded without leaving its range
+    std::vector<hzglCornerKey> keys(numCorners);
+
+    forEachChunk([&](size_t chunk, size_t begin, size_t end) {
+        size_t* next = &histogram[chunk * numPartitions];
+
+        for (size_t c = begin; c < end; c++)
+        {
+            hzglCornerKey key = cornerKey(c);
+            keys[next[partitionOf(key)]++] = key;
+        }
+    });
+
+    std::vector<size_t>().swap(histogram);
+
+    // first[c]: the first corner at the position of corner c
+    std::vector<uint32_t> first(numCorners);
+
+    auto weldPartition = [&](int p) {
+        std::vector<uint32_t> table;
+
+        {
+            size_t count = partitionStart[p + 1] - partitionStart[p];
+            size_t capacity = 16;
+            while (capacity < 2 * count)
+                capacity *= 2;
+
+            table.assign(capacity, std::numeric_limits<uint32_t>::max());
+
+            const hzglCornerKey* partition = &keys[partitionStart[p]];
+
+            for (uint32_t i = 0; i < count; i++)
+            {
+                size_t slot = hzglHashKey(partition[i]) & (capacity - 1);
+
+                while (table[slot] != std::numeric_limits<uint32_t>::max() && !hzglSamePosition(partition[table[slot]], partition[i]))
+                    slot = (slot + 1) & (capacity - 1);
+
+                if (table[slot] == std::numeric_limits<uint32_t>::max())
+                    table[slot] = i;
+
+                first[partition[i].corner] = partition[table[slot]].corner;
+            }
+        }
+    };
+
+    for (int p = 0; p < numPartitions; p++)
+    {
+        if (pool != nullptr && numPartitions > 1)
+            pool->Submit([&weldPartition, p]() { weldPartition(p); });
+        else
+            weldPartition(p);
+    }
+
+    if (pool != nullptr && numPartitions > 1)
+        pool->Wait();
+
+    std::vector<hzglCornerKey>().swap(keys);
+
+    // vertex numbers: a prefix sum over the corners that come first at their position
+    std::vector<size_t> chunkFirsts(numChunks + 1, 0);
+
+    forEachChunk([&](size_t chunk, size_t begin, size_t end) {
+        size_t count = 0;
+        for (size_t c = begin; c < end; c++)
+            count += (first[c] == c) ? 1 : 0;
+
+        chunkFirsts[chunk + 1] = count;
+    });
+
+    std::partial_sum(chunkFirsts.begin(), chunkFirsts.end(), chunkFirsts.begin());
+
+    size_t numVertices = chunkFirsts[numChunks];
+    std::vector<uint32_t> vertexOf(numCorners);
+
+    mesh = MeshInfo();
+    mesh.name = hzglMeshName(filepath);
+    mesh.num_vertices = static_cast<int>(numVertices);
+    mesh.shading_mode = HZGL_PHONG;
+    mesh.positions.resize(3 * numVertices);
+    mesh.indices.resize(numCorners);
+
+    forEachChunk([&](size_t chunk, size_t begin, size_t end) {
+        uint32_t next = static_cast<uint32_t>(chunkFirsts[chunk]);
+
+        for (size_t c = begin; c < end; c++)
+        {
+            if (first[c] != c)
+                continue;
+
+            vertexOf[c] = next;
+            memcpy(&mesh.positions[3 * static_cast<size_t>(next)], records + 50 * (c / 3) + 12 + 12 * (c % 3), 3 * sizeof(float));
+            next++;
+        }
+    });
+
+    // first[c] <= c, so every first corner has its number by now
+    hzglForChunks(pool, numCorners, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++)
+            mesh.indices[c] = vertexOf[first[c]];
+    });
+
+    st.output_vertices = static_cast<int64_t>(numVertices);
+    st.vertices_ms = 1000.0 * timer.End();
+    st.total_ms = 1000.0 * totalTimer.End();
+
+    return true;
+}
+
+const char* hzgl::MappedMeshSimdPath()
+{
+#if defined(HZGL_MAPPED_MESH_SSSE3)
+    return "SSSE3";
+#elif defined(HZGL_MAPPED_MESH_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Mesh.hpp"
+
+#include <string>
+#include <cstdint>
+
+namespace hzgl
+{
+    class ThreadPool;
+
+    typedef struct
+    {
+        int64_t input_vertices = 0;     // STL: three per triangle
+        int64_t output_vertices = 0;
+        int64_t triangles = 0;
+        bool byte_swapped = false;      // big-endian PLY
+        bool triangles_only = true;     // faces read in parallel without a pass to find where they start
+        double header_ms = 0.0;
+        double vertices_ms = 0.0;       // STL: reading the corners and welding them
+        double faces_ms = 0.0;
+        double total_ms = 0.0;
+    } MeshReadStats;
+
+    // binary PLY (either byte order) straight from a mapping into a MeshInfo: positions, and
+    // normals and texcoords when the vertices have them, with polygons fanned into triangles.
+    // Vertex and face ranges are parsed on the pool when there is one. Returns false for what it
+    // leaves to Assimp (ASCII files, lists on vertices, indices out of range)
+    bool ReadPlyMesh(const std::string& filepath, MeshInfo& mesh, ThreadPool* pool = nullptr, MeshReadStats* stats = nullptr);
+
+    // binary STL, with the corners welded by position in parallel hash tables (the facet normals
+    // are dropped, GenerateTangentFrames rebuilds them with its crease angle). False for ASCII STL
+    bool ReadStlMesh(const std::string& filepath, MeshInfo& mesh, ThreadPool* pool = nullptr, MeshReadStats* stats = nullptr);
+
+    // "SSSE3", "SSE2" or "scalar", whichever the byte swap was compiled with
+    const char* MappedMeshSimdPath();
+} // namespace hzgl
@@ -1,5 +1,7 @@
 #include "Material.hpp"
 
+#include <cstdio>
+
 hzgl::Material::Material(MaterialType t): type(t) 
 {
     if (type == HZGL_PHONG_MATERIAL)
@@ -24,29 +26,47 @@ void hzgl::Material::InitPBR(const glm::vec3 &pAlbedo, float pMetallic, float pR
     ao = pAo;
 }
 
-static GLuint hzglLoc(GLuint program, const std::string& uName)
+bool hzgl::Material::operator==(const Material& other) const
 {
-    return glGetUniformLocation(program, uName.c_str());
+    if (type != other.type)
+        return false;
+
+    // only the parameters of its own shading model are initialized
+    bool samePhong = ambient == other.ambient && diffuse == other.diffuse && specular == other.specular && shininess == other.shininess;
+    bool samePBR = albedo == other.albedo && metallic == other.metallic && roughness == other.roughness && ao == other.ao;
+
+    if (type == HZGL_PHONG_MATERIAL)
+        return samePhong;
+    else if (type == HZGL_PBR_MATERIAL)
+        return samePBR;
+
+    return samePhong && samePBR;
 }
 
-std::string hzgl::MaterialTypeName(MaterialType type)
+bool hzgl::Material::operator!=(const Material& other) const
 {
-    std::string matType;
+    return !(*this == other);
+}
 
+static GLuint hzglLoc(GLuint program, const char* uName, const char* member)
+{
+    char name[128];
+    snprintf(name, sizeof(name), "%s.%s", uName, member);
+
+    return glGetUniformLocation(program, name);
+}
+
+const char* hzgl::MaterialTypeName(MaterialType type)
+{
     switch (type)
     {
         case HZGL_PHONG_MATERIAL:
-            matType = "Phong Material";
-            break;
+            return "Phong Material";
         case HZGL_PBR_MATERIAL:
-            matType = "PBR Material";
-            break;
+            return "PBR Material";
         default:
-            matType = "Unknown type";
-            break;
+            return "Unknown type";
     }
-
-    return matType;
 }
 
 // references:
@@ -238,28 +258,29 @@ hzgl::Material hzgl::CreatesSampleMaterial(MaterialType type, const std::string
     return material;
 }
 
-void hzgl::SetupMaterial(GLuint program, const Material &material, std::string uName)
+void hzgl::SetupMaterial(GLuint program, const Material &material, const char* uName)
 {
     glUseProgram(program);
 
     if (material.type == HZGL_PHONG_MATERIAL)
     {
-        glUniform3fv(hzglLoc(program, uName + ".ambient"), 1, &material.ambient[0]);
-        glUniform3fv(hzglLoc(program, uName + ".diffuse"), 1, &material.diffuse[0]);
-        glUniform3fv(hzglLoc(program, uName + ".specular"), 1, &material.specular[0]);
-        glUniform1f(hzglLoc(program, uName + ".shininess"), material.shininess);
+        glUniform3fv(hzglLoc(program, uName, "ambient"), 1, &material.ambient[0]);
+        glUniform3fv(hzglLoc(program, uName, "diffuse"), 1, &material.diffuse[0]);
+        glUniform3fv(hzglLoc(program, uName, "specular"), 1, &material.specular[0]);
+        glUniform1f(hzglLoc(program, uName, "shininess"), material.shininess);
     }
     else if (material.type == HZGL_PBR_MATERIAL)
     {
-        glUniform3fv(hzglLoc(program, uName + ".albedo"), 1, &material.albedo[0]);
-        glUniform1f(hzglLoc(program, uName + ".metallic"), material.metallic);
-        glUniform1f(hzglLoc(program, uName + ".roughness"), material.roughness);
-        glUniform1f(hzglLoc(program, uName + ".ao"), material.ao);
+        glUniform3fv(hzglLoc(program, uName, "albedo"), 1, &material.albedo[0]);
+        glUniform1f(hzglLoc(program, uName, "metallic"), material.metallic);
+        glUniform1f(hzglLoc(program, uName, "roughness"), material.roughness);
+        glUniform1f(hzglLoc(program, uName, "ao"), material.ao);
     }
 }
 
-void hzgl::SetupMaterialInArray(GLuint program, const Material& material, std::string uArrayName, int index) 
+void hzgl::SetupMaterialInArray(GLuint program, const Material& material, const char* uArrayName, int index) 
 {
-    std::string uName = uArrayName + "[" + std::to_string(index) + "]";
+    char uName[96];
+    snprintf(uName, sizeof(uName), "%s[%d]", uArrayName, index);
     SetupMaterial(program, material, uName);
 }
\ No newline at end of file
@@ -40,10 +40,13 @@ namespace hzgl
                      float pMetallic = 0.5, float pRoughness = 0.5, float pAo = 1.0); 
 
         Material(MaterialType t = HZGL_PHONG_MATERIAL);
+
+        bool operator==(const Material& other) const;
+        bool operator!=(const Material& other) const;
     };
 
-    std::string MaterialTypeName(MaterialType type);
+    const char* MaterialTypeName(MaterialType type);
     Material CreatesSampleMaterial(MaterialType type, const std::string &name);
-    void SetupMaterial(GLuint program, const Material &material, std::string uName = "uMaterial");
-    void SetupMaterialInArray(GLuint program, const Material &material, std::string uArrayName = "uMaterials", int index = 0);
+    void SetupMaterial(GLuint program, const Material &material, const char* uName = "uMaterial");
+    void SetupMaterialInArray(GLuint program, const Material &material, const char* uArrayName = "uMaterials", int index = 0);
 } // namespace hzgl
\ No newline at end of file
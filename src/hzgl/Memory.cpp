@@ -0,0 +1,555 @@
+#include "Memory.hpp"
+
+#include <new>
+#include <mutex>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <unordered_map>
+
+#if defined(_WIN32)
+    #include <windows.h>
+    #include <psapi.h>
+#elif defined(__APPLE__)
+    #include <mach/mach.h>
+    #include <sys/resource.h>
+#endif
+
+#define HZGL_LOG_ERROR(msg) \
+    fprintf(stderr, "[ERROR] %s (line %d): %s\n", __FILE__, __LINE__, msg);
+
+// constant-initialized, so they are usable before any static constructor runs
+static std::atomic<uint64_t> s_heapCurrent{0};
+static std::atomic<uint64_t> s_heapPeak{0};
+static std::atomic<uint64_t> s_heapWindowPeak{0};
+static std::atomic<uint64_t> s_heapLive{0};
+static std::atomic<uint64_t> s_heapAllocations{0};
+static std::atomic<uint64_t> s_heapTotalBytes{0};
+
+// per thread, so that a frame only counts what the render thread itself allocated
+static thread_local uint64_t t_allocations = 0;
+static thread_local uint64_t t_allocationBytes = 0;
+static thread_local hzgl::AllocationCount t_frameStart;
+static thread_local hzgl::AllocationCount t_lastFrame;
+
+static void hzglAtomicMax(std::atomic<uint64_t>& target, uint64_t value)
+{
+    uint64_t prev = target.load(std::memory_order_relaxed);
+    while (prev < value && !target.compare_exchange_weak(prev, value, std::memory_order_relaxed))
+        ;
+}
+
+#ifdef HZGL_TRACK_HEAP
+// every block carries its size in a header so that delete can account for it
+static constexpr size_t HZGL_HEAP_HEADER = alignof(std::max_align_t);
+
+static void* hzglTrackedAlloc(size_t size)
+{
+    void* block = std::malloc(size + HZGL_HEAP_HEADER);
+
+    if (block == nullptr)
+        return nullptr;
+
+    *static_cast<size_t*>(block) = size;
+
+    uint64_t current = s_heapCurrent.fetch_add(size, std::memory_order_relaxed) + size;
+    s_heapLive.fetch_add(1, std::memory_order_relaxed);
+    s_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    s_heapTotalBytes.fetch_add(size, std::memory_order_relaxed);
+
+    hzglAtomicMax(s_heapPeak, current);
+    hzglAtomicMax(s_heapWindowPeak, current);
+
+    t_allocations++;
+    t_allocationBytes += size;
+
+    return static_cast<char*>(block) + HZGL_HEAP_HEADER;
+}
+
+static void hzglTrackedFree(void* ptr)
+{
+    if (ptr == nullptr)
+        return;
+
+    void* block = static_cast<char*>(ptr) - HZGL_HEAP_HEADER;
+    size_t size = *static_cast<size_t*>(block);
+
+    s_heapCurrent.fetch_sub(size, std::memory_order_relaxed);
+    s_heapLive.fetch_sub(1, std::memory_order_relaxed);
+
+    std::free(block);
+}
+
+void* operator new(std::size_t size)
+{
+    if (void* ptr = hzglTrackedAlloc(size))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    if (void* ptr = hzglTrackedAlloc(size))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    hzglTrackedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    hzglTrackedFree(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    hzglTrackedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    hzglTrackedFree(ptr);
+}
+#endif
+
+typedef struct
+{
+    std::mutex mutex;
+    std::vector<hzgl::LoadMemoryRecord> loads;
+    std::unordered_map<uint64_t, hzgl::GpuResourceRecord> gpuResources;
+} hzglMemoryRegistry;
+
+static hzglMemoryRegistry& hzglRegistry()
+{
+    static hzglMemoryRegistry registry;
+    return registry;
+}
+
+static uint64_t hzglResourceKey(hzgl::GpuResourceType type, GLuint id)
+{
+    return (static_cast<uint64_t>(type) << 32) | id;
+}
+
+static std::string hzglEscape(const std::string& str)
+{
+    std::string escaped;
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+hzgl::HeapWatermark::HeapWatermark()
+{
+    _finished = false;
+    _base = s_heapCurrent.load(std::memory_order_relaxed);
+    _baseAllocations = s_heapAllocations.load(std::memory_order_relaxed);
+
+    // start a new window; the enclosing one is restored in Finish()
+    _savedPeak = s_heapWindowPeak.exchange(_base, std::memory_order_relaxed);
+}
+
+hzgl::HeapWatermark::~HeapWatermark()
+{
+    if (!_finished)
+        Finish();
+}
+
+hzgl::HeapUsage hzgl::HeapWatermark::Finish()
+{
+    HeapUsage usage;
+
+    if (_finished)
+        return usage;
+
+    uint64_t windowPeak = s_heapWindowPeak.load(std::memory_order_relaxed);
+    uint64_t current = s_heapCurrent.load(std::memory_order_relaxed);
+
+    usage.peak_bytes = windowPeak > _base ? windowPeak - _base : 0;
+    usage.retained_bytes = static_cast<int64_t>(current) - static_cast<int64_t>(_base);
+    usage.allocations = s_heapAllocations.load(std::memory_order_relaxed) - _baseAllocations;
+
+    hzglAtomicMax(s_heapWindowPeak, _savedPeak);
+    _finished = true;
+
+    return usage;
+}
+
+bool hzgl::HeapTrackingEnabled()
+{
+#ifdef HZGL_TRACK_HEAP
+    return true;
+#else
+    return false;
+#endif
+}
+
+hzgl::HeapStats hzgl::GetHeapStats()
+{
+    HeapStats stats;
+    stats.current_bytes = s_heapCurrent.load(std::memory_order_relaxed);
+    stats.peak_bytes = s_heapPeak.load(std::memory_order_relaxed);
+    stats.live_allocations = s_heapLive.load(std::memory_order_relaxed);
+    stats.total_allocations = s_heapAllocations.load(std::memory_order_relaxed);
+    stats.total_bytes = s_heapTotalBytes.load(std::memory_order_relaxed);
+
+    return stats;
+}
+
+hzgl::AllocationCount hzgl::ThreadAllocations()
+{
+    AllocationCount count;
+    count.allocations = t_allocations;
+    count.bytes = t_allocationBytes;
+
+    return count;
+}
+
+void hzgl::BeginAllocationFrame()
+{
+    t_frameStart = ThreadAllocations();
+}
+
+hzgl::AllocationCount hzgl::EndAllocationFrame()
+{
+    AllocationCount now = ThreadAllocations();
+
+    t_lastFrame.allocations = now.allocations - t_frameStart.allocations;
+    t_lastFrame.bytes = now.bytes - t_frameStart.bytes;
+
+    return t_lastFrame;
+}
+
+hzgl::AllocationCount hzgl::LastFrameAllocations()
+{
+    return t_lastFrame;
+}
+
+hzgl::ProcessMemory hzgl::GetProcessMemory()
+{
+    ProcessMemory memory;
+
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        memory.resident_bytes = counters.WorkingSetSize;
+        memory.peak_resident_bytes = counters.PeakWorkingSetSize;
+    }
+#elif defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) == KERN_SUCCESS)
+        memory.resident_bytes = info.resident_size;
+
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        memory.peak_resident_bytes = static_cast<uint64_t>(usage.ru_maxrss);
+#elif defined(__linux__)
+    FILE* fp = fopen("/proc/self/status", "r");
+    char line[256];
+
+    while (fp != nullptr && fgets(line, sizeof(line), fp) != nullptr)
+    {
+        unsigned long long kb = 0;
+
+        if (sscanf(line, "VmRSS: %llu kB", &kb) == 1)
+            memory.resident_bytes = 1024ull * kb;
+        else if (sscanf(line, "VmHWM: %llu kB", &kb) == 1)
+            memory.peak_resident_bytes = 1024ull * kb;
+    }
+
+    if (fp != nullptr)
+        fclose(fp);
+#endif
+
+    return memory;
+}
+
+void hzgl::RecordLoadMemory(const std::string& name, const std::string& kind, const HeapUsage& usage)
+{
+    auto& registry = hzglRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    registry.loads.push_back({name, kind, usage});
+}
+
+std::vector<hzgl::LoadMemoryRecord> hzgl::GetLoadMemoryRecords()
+{
+    auto& registry = hzglRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    return registry.loads;
+}
+
+void hzgl::GetLoadMemoryRecords(std::vector<LoadMemoryRecord>& records)
+{
+    auto& registry = hzglRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    // element-wise assignment keeps the string buffers of the previous call
+    records.resize(registry.loads.size());
+    std::copy(registry.loads.begin(), registry.loads.end(), records.begin());
+}
+
+void hzgl::TrackGpuResource(const GpuResourceRecord& record)
+{
+    if (record.id == 0)
+        return;
+
+    auto& registry = hzglRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    registry.gpuResources[hzglResourceKey(record.type, record.id)] = record;
+}
+
+void hzgl::UntrackGpuResource(GpuResourceType type, GLuint id)
+{
+    auto& registry = hzglRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    registry.gpuResources.erase(hzglResourceKey(type, id));
+}
+
+std::vector<hzgl::GpuResourceRecord> hzgl::GetGpuResources()
+{
+    std::vector<GpuResourceRecord> resources;
+    GetGpuResources(resources);
+
+    return resources;
+}
+
+void hzgl::GetGpuResources(std::vector<GpuResourceRecord>& resources)
+{
+    {
+        auto& registry = hzglRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        resources.resize(registry.gpuResources.size());
+
+        size_t i = 0;
+        for (const auto& pair : registry.gpuResources)
+            resources[i++] = pair.second;
+    }
+
+    std::sort(resources.begin(), resources.end(), [](const GpuResourceRecord& a, const GpuResourceRecord& b) {
+        if (a.owner != b.owner)
+            return a.owner < b.owner;
+        if (a.shape != b.shape)
+            return a.shape < b.shape;
+        if (a.type != b.type)
+            return a.type < b.type;
+        return a.id < b.id;
+    });
+}
+
+size_t hzgl::GetGpuBytes(GpuResourceType type)
+{
+    auto& registry = hzglRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    size_t bytes = 0;
+    for (const auto& pair : registry.gpuResources)
+    {
+        if (pair.second.type == type)
+            bytes += pair.second.bytes;
+    }
+
+    return bytes;
+}
+
+size_t hzgl::GetTotalGpuBytes()
+{
+    auto& registry = hzglRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    size_t bytes = 0;
+    for (const auto& pair : registry.gpuResources)
+        bytes += pair.second.bytes;
+
+    return bytes;
+}
+
+const char* hzgl::GpuResourceTypeName(GpuResourceType type)
+{
+    switch (type)
+    {
+    case HZGL_GPU_BUFFER:
+        return "buffer";
+    case HZGL_GPU_TEXTURE:
+        return "texture";
+    case HZGL_GPU_RENDERBUFFER:
+        return "renderbuffer";
+    case HZGL_GPU_PROGRAM:
+        return "program";
+    default:
+        return "unknown";
+    }
+}
+
+size_t hzgl::BytesPerPixel(GLenum internalFormat)
+{
+    switch (internalFormat)
+    {
+    case GL_RED:
+    case GL_R8:
+    case GL_STENCIL_INDEX8:
+        return 1;
+    case GL_RG:
+    case GL_RG8:
+    case GL_R16F:
+    case GL_DEPTH_COMPONENT16:
+        return 2;
+    case GL_RGB:
+    case GL_RGB8:
+    case GL_SRGB8:
+    case GL_RGBA:
+    case GL_RGBA8:
+    case GL_SRGB8_ALPHA8:
+    case GL_RG16:
+    case GL_RG16F:
+    case GL_R32F:
+    case GL_R11F_G11F_B10F:
+    case GL_DEPTH_COMPONENT:
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32F:
+    case GL_DEPTH_STENCIL:
+    case GL_DEPTH24_STENCIL8:
+        return 4;
+    case GL_RGB16F:
+    case GL_RGBA16F:
+    case GL_RG32F:
+    case GL_DEPTH32F_STENCIL8:
+        return 8;
+    case GL_RGB32F:
+    case GL_RGBA32F:
+        return 16;
+    default:
+        return 4;
+    }
+}
+
+int hzgl::MipLevelCount(int width, int height)
+{
+    int levels = 1;
+    int size = std::max(width, height);
+
+    while (size > 1)
+    {
+        size /= 2;
+        levels++;
+    }
+
+    return levels;
+}
+
+size_t hzgl::EstimateTextureBytes(GLenum internalFormat, int width, int height, int levels)
+{
+    // levels <= 0 means a complete mip chain
+    if (levels <= 0)
+        levels = MipLevelCount(width, height);
+
+    size_t bytes = 0;
+    size_t bpp = BytesPerPixel(internalFormat);
+
+    for (int l = 0; l < levels; l++)
+    {
+        bytes += bpp * static_cast<size_t>(width) * height;
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+
+    return bytes;
+}
+
+bool hzgl::WriteMemoryReport(const std::string& filepath)
+{
+    FILE* fp = fopen(filepath.c_str(), "w");
+
+    if (fp == nullptr)
+    {
+        HZGL_LOG_ERROR("Failed to open the memory report.")
+        return false;
+    }
+
+    HeapStats heap = GetHeapStats();
+    std::vector<GpuResourceRecord> resources = GetGpuResources();
+    std::vector<LoadMemoryRecord> loads = GetLoadMemoryRecords();
+
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"heap\": {\"tracked\": %s, \"current_bytes\": %llu, \"peak_bytes\": %llu, \"live_allocations\": %llu, "
+                "\"total_allocations\": %llu, \"total_bytes\": %llu},\n",
+            HeapTrackingEnabled() ? "true" : "false",
+            static_cast<unsigned long long>(heap.current_bytes), static_cast<unsigned long long>(heap.peak_bytes),
+            static_cast<unsigned long long>(heap.live_allocations), static_cast<unsigned long long>(heap.total_allocations),
+            static_cast<unsigned long long>(heap.total_bytes));
+
+    fprintf(fp, "  \"gpu_bytes\": {");
+    size_t total = 0;
+    for (int t = 0; t < HZGL_GPU_NUM_TYPES; t++)
+    {
+        size_t bytes = 0;
+        for (const auto& r : resources)
+        {
+            if (r.type == t)
+                bytes += r.bytes;
+        }
+
+        total += bytes;
+        fprintf(fp, "\"%s\": %llu, ", GpuResourceTypeName(static_cast<GpuResourceType>(t)), static_cast<unsigned long long>(bytes));
+    }
+    fprintf(fp, "\"total\": %llu},\n", static_cast<unsigned long long>(total));
+
+    fprintf(fp, "  \"loads\": [");
+    for (size_t i = 0; i < loads.size(); i++)
+    {
+        const auto& l = loads[i];
+        fprintf(fp, "%s\n    {\"name\": \"%s\", \"kind\": \"%s\", \"peak_bytes\": %llu, \"retained_bytes\": %lld, \"allocations\": %llu}",
+                (i > 0 ? "," : ""), hzglEscape(l.name).c_str(), hzglEscape(l.kind).c_str(),
+                static_cast<unsigned long long>(l.heap.peak_bytes), static_cast<long long>(l.heap.retained_bytes),
+                static_cast<unsigned long long>(l.heap.allocations));
+    }
+    fprintf(fp, "\n  ],\n");
+
+    // resources are sorted by owner, so each owner is written as one group
+    fprintf(fp, "  \"owners\": [");
+    for (size_t i = 0; i < resources.size();)
+    {
+        const std::string& owner = resources[i].owner;
+
+        size_t ownerBytes = 0;
+        size_t end = i;
+        while (end < resources.size() && resources[end].owner == owner)
+            ownerBytes += resources[end++].bytes;
+
+        fprintf(fp, "%s\n    {\"owner\": \"%s\", \"bytes\": %llu, \"resources\": [", (i > 0 ? "," : ""),
+                hzglEscape(owner).c_str(), static_cast<unsigned long long>(ownerBytes));
+
+        for (size_t r = i; r < end; r++)
+        {
+            const auto& res = resources[r];
+            fprintf(fp, "%s\n      {\"type\": \"%s\", \"id\": %u, \"shape\": \"%s\", \"label\": \"%s\", \"bytes\": %llu}",
+                    (r > i ? "," : ""), GpuResourceTypeName(res.type), res.id, hzglEscape(res.shape).c_str(),
+                    hzglEscape(res.label).c_str(), static_cast<unsigned long long>(res.bytes));
+        }
+
+        fprintf(fp, "\n    ]}");
+        i = end;
+    }
+    fprintf(fp, "\n  ]\n}\n");
+
+    fclose(fp);
+
+    return true;
+}
+
+#undef HZGL_LOG_ERROR
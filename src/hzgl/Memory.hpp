@@ -0,0 +1,122 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <glad/glad.h>
+
+namespace hzgl
+{
+    typedef enum
+    {
+        HZGL_GPU_BUFFER,
+        HZGL_GPU_TEXTURE,
+        HZGL_GPU_RENDERBUFFER,
+        HZGL_GPU_PROGRAM,
+        HZGL_GPU_NUM_TYPES
+    } GpuResourceType;
+
+    typedef struct
+    {
+        uint64_t current_bytes = 0;     // live heap bytes
+        uint64_t peak_bytes = 0;        // high-water mark since startup
+        uint64_t live_allocations = 0;
+        uint64_t total_allocations = 0; // cumulative
+        uint64_t total_bytes = 0;       // cumulative
+    } HeapStats;
+
+    typedef struct
+    {
+        uint64_t peak_bytes = 0;        // highest heap usage above the starting point
+        int64_t retained_bytes = 0;     // heap growth that survived the scope (steady state)
+        uint64_t allocations = 0;
+    } HeapUsage;
+
+    typedef struct
+    {
+        uint64_t allocations = 0;       // operator new calls
+        uint64_t bytes = 0;
+    } AllocationCount;
+
+    typedef struct
+    {
+        uint64_t resident_bytes = 0;    // of the whole process, mapped files included
+        uint64_t peak_resident_bytes = 0;
+    } ProcessMemory;
+
+    typedef struct
+    {
+        std::string name;               // e.g. file path of the model or texture
+        std::string kind;               // e.g. "model", "texture"
+        HeapUsage heap;
+    } LoadMemoryRecord;
+
+    typedef struct
+    {
+        GpuResourceType type;
+        GLuint id = 0;
+        size_t bytes = 0;               // estimated driver allocation
+        std::string owner;              // e.g. model name, "Textures", "Framebuffer 3"
+        std::string shape;              // sub-group within the owner (may be empty)
+        std::string label;              // e.g. "positions", "color0"
+    } GpuResourceRecord;
+
+    // measures heap usage between construction and Finish(), scopes may be nested
+    class HeapWatermark
+    {
+    private:
+        uint64_t _base;
+        uint64_t _baseAllocations;
+        uint64_t _savedPeak;
+        bool _finished;
+
+    public:
+        HeapWatermark();
+        ~HeapWatermark();
+
+        HeapUsage Finish();
+
+        HeapWatermark(const HeapWatermark&) = delete;
+        HeapWatermark& operator=(const HeapWatermark&) = delete;
+    };
+
+    // false when built without HZGL_TRACK_HEAP (all heap numbers are then zero)
+    bool HeapTrackingEnabled();
+    HeapStats GetHeapStats();
+
+    // operator new calls made by the calling thread so far
+    AllocationCount ThreadAllocations();
+
+    // allocations of the calling thread between the two calls, kept for LastFrameAllocations()
+    void BeginAllocationFrame();
+    AllocationCount EndAllocationFrame();
+    AllocationCount LastFrameAllocations();
+
+    // resident set size as the OS reports it (zeros where unsupported)
+    ProcessMemory GetProcessMemory();
+
+    void RecordLoadMemory(const std::string& name, const std::string& kind, const HeapUsage& usage);
+    std::vector<LoadMemoryRecord> GetLoadMemoryRecords();
+    void GetLoadMemoryRecords(std::vector<LoadMemoryRecord>& records); // reuses the capacity of records
+
+    // registry of GPU allocations, keyed by (type, id)
+    void TrackGpuResource(const GpuResourceRecord& record);
+    void UntrackGpuResource(GpuResourceType type, GLuint id);
+
+    // sorted by owner, then shape
+    std::vector<GpuResourceRecord> GetGpuResources();
+    void GetGpuResources(std::vector<GpuResourceRecord>& resources);   // reuses the capacity of resources
+    size_t GetGpuBytes(GpuResourceType type);
+    size_t GetTotalGpuBytes();
+
+    const char* GpuResourceTypeName(GpuResourceType type);
+
+    // size estimates (drivers usually pad 3-component formats to 4)
+    size_t BytesPerPixel(GLenum internalFormat);
+    int MipLevelCount(int width, int height);
+    size_t EstimateTextureBytes(GLenum internalFormat, int width, int height, int levels = 1);
+
+    bool WriteMemoryReport(const std::string& filepath);
+} // namespace hzgl
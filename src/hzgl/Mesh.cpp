@@ -1,13 +1,21 @@
 #include "Mesh.hpp"
 
+#include "Tangents.hpp"
+#include "MappedMesh.hpp"
 #include "Filesystem.hpp"
+#include "Profiler.hpp"
+#include "ThreadPool.hpp"
 
 #include <map>
 #include <string>
 #include <cstdio>
+#include <fstream>
 #include <vector>
+#include <utility>
 #include <iostream>
+#include <algorithm>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -67,15 +75,19 @@ static std::string hzglTextureTypeName(aiTextureType type)
 
 static void hzglProcessAiMesh(const aiScene *scene, const aiMesh *mesh, std::vector<hzgl::MeshInfo> &loadedShapes, std::string parentpath = "")
 {
+    HZGL_PROFILE_SCOPE("ProcessAiMesh");
+
     hzgl::MeshInfo meshInfo;
     meshInfo.name = mesh->mName.C_Str();
     meshInfo.num_vertices = mesh->mNumVertices;
-    meshInfo.shading_mode = hzgl::HZGL_NORMAL_MAPPING;
 
-    // allocate space for geometry data
-    meshInfo.normals.resize(meshInfo.num_vertices * 3, 0);
+    // normal maps need texcoords (the tangent frames are generated in LoadMeshesFromFile)
+    meshInfo.shading_mode = mesh->mTextureCoords[0] ? hzgl::HZGL_NORMAL_MAPPING : hzgl::HZGL_PHONG;
+
+    // allocate space for geometry data, normals and texcoords only if the file has them
+    meshInfo.normals.resize(mesh->HasNormals() ? meshInfo.num_vertices * 3 : 0, 0);
     meshInfo.positions.resize(meshInfo.num_vertices * 3, 0);
-    meshInfo.texcoords.resize(meshInfo.num_vertices * 2, 0);
+    meshInfo.texcoords.resize(mesh->mTextureCoords[0] ? meshInfo.num_vertices * 2 : 0, 0);
     meshInfo.indices.resize(mesh->mNumFaces * 3, 0);
 
     for (unsigned i = 0; i < mesh->mNumVertices; i++)
@@ -126,23 +138,44 @@ static void hzglProcessAiMesh(const aiScene *scene, const aiMesh *mesh, std::vec
         }
     }
 
-    loadedShapes.push_back(meshInfo);
+    loadedShapes.push_back(std::move(meshInfo));
 }
 
-static void hzglProcessAiNode(const aiScene *scene, const aiNode *node, std::vector<hzgl::MeshInfo> &loadedShapes, const aiMatrix4x4 &accTransform = aiMatrix4x4(), std::string parentpath = "")
+static void hzglProcessAiNode(const aiScene *scene, const aiNode *node, std::vector<hzgl::MeshInfo> &loadedShapes, std::vector<hzgl::NodeInfo> &nodes,
+                              int parent = -1, std::string parentpath = "")
 {
-    aiMatrix4x4 transform = node->mTransformation * accTransform;
+    // keep the hierarchy: every node stores its transform relative to the parent
+    hzgl::NodeInfo nodeInfo;
+    nodeInfo.name = node->mName.C_Str();
+    nodeInfo.parent = parent;
+
+    // Assimp matrices are row-major
+    const aiMatrix4x4 &m = node->mTransformation;
+    for (int r = 0; r < 4; r++)
+    {
+        for (int c = 0; c < 4; c++)
+            nodeInfo.transform[c * 4 + r] = m[r][c];
+    }
+
+    int nodeIndex = static_cast<int>(nodes.size());
+    nodes.push_back(std::move(nodeInfo));
 
     // process the meshes referred by the current node
     for (unsigned m = 0; m < node->mNumMeshes; m++)
     {
         unsigned mIndex = node->mMeshes[m];
         hzglProcessAiMesh(scene, scene->mMeshes[mIndex], loadedShapes, parentpath);
+        loadedShapes.back().node = nodeIndex;
     }
 
     // recursively process all the children nodes
     for (unsigned c = 0; c < node->mNumChildren; c++)
-        hzglProcessAiNode(scene, node->mChildren[c], loadedShapes, transform, parentpath);
+        hzglProcessAiNode(scene, node->mChildren[c], loadedShapes, nodes, nodeIndex, parentpath);
+}
+
+void hzgl::ProcessAiMesh(const aiScene *scene, const aiMesh *mesh, std::vector<MeshInfo> &meshes, const std::string &parentpath)
+{
+    hzglProcessAiMesh(scene, mesh, meshes, parentpath);
 }
 
 std::string hzgl::ShadingModeName(ShadingMode mode)
@@ -171,23 +204,112 @@ std::string hzgl::ShadingModeName(ShadingMode mode)
     return shadingMode;
 }
 
-void hzgl::LoadMeshesFromFile(const std::string &filepath, std::vector<hzgl::MeshInfo> &loadedShapes)
+// binary PLY or STL without Assimp, under a single root node; false leaves the file to Assimp
+static bool hzglReadMappedMesh(const std::string &filepath, std::vector<hzgl::MeshInfo> &loadedShapes, std::vector<hzgl::NodeInfo> &nodes,
+                               hzgl::ThreadPool *pool)
 {
+    std::string ext = hzgl::GetExtension(filepath);
+    hzgl::MeshInfo mesh;
+
+    if (!(ext == "ply" && hzgl::ReadPlyMesh(filepath, mesh, pool)) && !(ext == "stl" && hzgl::ReadStlMesh(filepath, mesh, pool)))
+        return false;
+
+    hzgl::NodeInfo root;
+    root.name = filepath.substr(filepath.find_last_of("/\\") + 1);
+    for (int i = 0; i < 16; i++)
+        root.transform[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+
+    mesh.node = static_cast<int>(nodes.size());
+    nodes.push_back(root);
+    loadedShapes.push_back(std::move(mesh));
+
+    return true;
+}
+
+void hzgl::LoadMeshesFromFile(const std::string &filepath, std::vector<hzgl::MeshInfo> &loadedShapes, std::vector<hzgl::NodeInfo> *nodes,
+                              bool mappedReaders, ThreadPool *pool)
+{
+    HZGL_PROFILE_SCOPE("LoadMeshesFromFile");
+
     std::string abspath = GetAbsolutePath(filepath);
     std::string parentpath = GetParentPath(filepath);
 
-    Assimp::Importer importer;
+    // mesh node indices refer to this list even when the caller does not want it
+    std::vector<NodeInfo> localNodes;
+    std::vector<NodeInfo> &loadedNodes = (nodes != nullptr) ? *nodes : localNodes;
 
-    auto flags = aiProcess_Triangulate | aiProcess_GenNormals | aiProcess_GenUVCoords;
-    const aiScene *scene = importer.ReadFile(abspath, flags);
+    size_t first = loadedShapes.size();
 
-    // If the import failed, report it
-    if (scene == nullptr || !scene->HasMeshes() || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE)
+    std::string ext = GetExtension(filepath);
+    bool mapped = mappedReaders && (ext == "ply" || ext == "stl");
+
+    // large models are spread over the pool, from parsing to the tangent frames; a few MB of
+    // PLY or STL is around 100k triangles
+    bool large = mapped && std::ifstream(abspath, std::ios::binary | std::ios::ate).tellg() >= 4 * 1024 * 1024;
+
+    if (!mapped || !hzglReadMappedMesh(abspath, loadedShapes, loadedNodes, large ? pool : nullptr))
     {
-        std::cerr << importer.GetErrorString() << std::endl;
-        return;
+        Assimp::Importer importer;
+
+        // normals are generated below, with a crease angle and on more than one thread
+        auto flags = aiProcess_Triangulate | aiProcess_GenUVCoords;
+        const aiScene *scene = nullptr;
+        {
+            HZGL_PROFILE_SCOPE("Assimp::ReadFile");
+            scene = importer.ReadFile(abspath, flags);
+        }
+
+        // If the import failed, report it
+        if (scene == nullptr || !scene->HasMeshes() || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE)
+        {
+            std::cerr << importer.GetErrorString() << std::endl;
+            return;
+        }
+
+        hzglProcessAiNode(scene, scene->mRootNode, loadedShapes, loadedNodes, -1, parentpath);
     }
 
-    aiMatrix4x4 accTransform;
-    hzglProcessAiNode(scene, scene->mRootNode, loadedShapes, accTransform, parentpath);
-}
\ No newline at end of file
+    // normals where the file has none and tangent frames
+    size_t numTriangles = 0;
+    for (size_t i = first; i < loadedShapes.size(); i++)
+        numTriangles += loadedShapes[i].indices.size() / 3;
+
+    large = numTriangles >= 100000;
+
+    for (size_t i = first; i < loadedShapes.size(); i++)
+        GenerateTangentFrames(loadedShapes[i], TangentFrameOptions(), large ? pool : nullptr);
+}
+
+bool hzgl::IsSupportedMeshFormat(const std::string &filepath)
+{
+    std::string ext = GetExtension(filepath);
+
+    if (ext.empty())
+        return false;
+
+    // the extensions of every importer are listed once ("*.3ds;*.obj;..."), an Importer per file
+    // was most of the time spent scanning a large directory
+    static const std::unordered_set<std::string> extensions = []() {
+        std::string list;
+        Assimp::Importer importer;
+        importer.GetExtensionList(list);
+
+        std::unordered_set<std::string> set;
+        std::transform(list.begin(), list.end(), list.begin(), [](unsigned char c) { return std::tolower(c); });
+
+        for (size_t begin = 0; begin < list.size();)
+        {
+            size_t end = std::min(list.find(';', begin), list.size());
+            std::string pattern = list.substr(begin, end - begin);
+
+            if (pattern.compare(0, 2, "*.") == 0)
+                set.insert(pattern.substr(2));
+
+            begin = end + 1;
+        }
+
+        return set;
+    }();
+
+    return extensions.count(ext) > 0;
+}
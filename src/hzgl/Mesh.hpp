@@ -2,10 +2,16 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
 #include <unordered_map>
 
+struct aiMesh;
+struct aiScene;
+
 namespace hzgl
 {
+    class ThreadPool;
+
     typedef enum
     {
         HZGL_FLAT,
@@ -14,16 +20,26 @@ namespace hzgl
         HZGL_PBR
     } ShadingMode;
 
+    // one node of the imported hierarchy
+    typedef struct
+    {
+        std::string name;
+        int parent = -1;            // index into the node list (parents come first), -1 for the root
+        float transform[16];        // relative to the parent, column-major
+    } NodeInfo;
+
     typedef struct
     {
         // Metadata
         std::string name;
+        int node = -1;              // node that places the mesh, index into the node list
 
         // Geometry
         int num_vertices;
         std::vector<float> positions;
         std::vector<float> normals;
-        std::vector<float> texcoords;
+        std::vector<float> texcoords;               // empty when the file has none
+        std::vector<int16_t> qtangents;             // 4 x snorm16 per vertex (see Tangents.hpp), empty without texcoords
         std::vector<unsigned> indices;
 
         // Material
@@ -32,5 +48,16 @@ namespace hzgl
     } MeshInfo;
 
     std::string ShadingModeName(ShadingMode mode);
-    void LoadMeshesFromFile(const std::string &filepath, std::vector<MeshInfo> &meshes);
+    // binary PLY and STL are read through a mapping (see MappedMesh.hpp) unless mappedReaders is
+    // false, everything else through Assimp. Large models are split across pool, without one they
+    // are read on the calling thread; pool must not be the one the caller runs on (its Wait()
+    // would never return)
+    void LoadMeshesFromFile(const std::string &filepath, std::vector<MeshInfo> &meshes, std::vector<NodeInfo> *nodes = nullptr,
+                            bool mappedReaders = true, ThreadPool *pool = nullptr);
+
+    // true when Assimp has an importer for the extension of filepath
+    bool IsSupportedMeshFormat(const std::string &filepath);
+
+    // convert a single Assimp mesh (exposed for benchmarking the conversion on its own)
+    void ProcessAiMesh(const aiScene *scene, const aiMesh *mesh, std::vector<MeshInfo> &meshes, const std::string &parentpath = "");
 } // namespace hzgl
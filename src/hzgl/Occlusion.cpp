@@ -0,0 +1,551 @@
+#include "Occlusion.hpp"
+
+#include "Timer.hpp"
+#include "Profiler.hpp"
+
+#include <cmath>
+#include <limits>
+#include <cstring>
+#include <numeric>
+#include <algorithm>
+#include <unordered_map>
+
+#if defined(__AVX2__)
+    #define HZGL_OCCLUSION_AVX2
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define HZGL_OCCLUSION_SSE2
+    #include <emmintrin.h>
+#endif
+
+// clip-space corners of a box; returns false when the box is outside one of the frustum planes
+static bool hzglProjectBox(const hzgl::BoundingBox& box, const glm::mat4& mvp, glm::vec4 corners[8])
+{
+    int outside[6] = {0, 0, 0, 0, 0, 0};
+
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec4 p((i & 1) ? box.max.x : box.min.x,
+                    (i & 2) ? box.max.y : box.min.y,
+                    (i & 4) ? box.max.z : box.min.z, 1.0f);
+
+        corners[i] = mvp * p;
+        const glm::vec4& c = corners[i];
+
+        outside[0] += (c.x < -c.w);
+        outside[1] += (c.x > c.w);
+        outside[2] += (c.y < -c.w);
+        outside[3] += (c.y > c.w);
+        outside[4] += (c.z < -c.w);
+        outside[5] += (c.z > c.w);
+    }
+
+    for (int plane = 0; plane < 6; plane++)
+    {
+        if (outside[plane] == 8)
+            return false;
+    }
+
+    return true;
+}
+
+hzgl::BoundingBox hzgl::ComputeBounds(const std::vector<float>& positions)
+{
+    BoundingBox box;
+
+    if (positions.size() < 3)
+        return box;
+
+    box.min = box.max = glm::vec3(positions[0], positions[1], positions[2]);
+
+    for (size_t i = 3; i + 2 < positions.size(); i += 3)
+    {
+        glm::vec3 p(positions[i], positions[i + 1], positions[i + 2]);
+        box.min = glm::min(box.min, p);
+        box.max = glm::max(box.max, p);
+    }
+
+    return box;
+}
+
+void hzgl::BuildOccluder(const std::vector<float>& positions, const std::vector<unsigned>& indices, int maxTriangles,
+                         OccluderMesh* occluder)
+{
+    BuildOccluder(reinterpret_cast<const uint8_t*>(positions.data()), 3 * sizeof(float), indices.data(), sizeof(unsigned),
+                  indices.size(), maxTriangles, occluder);
+}
+
+void hzgl::BuildOccluder(const uint8_t* positions, size_t stride, const void* indices, int indexSize, size_t numIndices,
+                         int maxTriangles, OccluderMesh* occluder)
+{
+    HZGL_PROFILE_SCOPE("BuildOccluder");
+
+    auto index = [indices, indexSize](size_t i) -> unsigned {
+        if (indexSize == 1)
+            return static_cast<const uint8_t*>(indices)[i];
+        if (indexSize == 2)
+            return static_cast<const uint16_t*>(indices)[i];
+
+        return static_cast<const uint32_t*>(indices)[i];
+    };
+
+    // strides of a glTF buffer view only guarantee 4-byte alignment
+    auto vertex = [positions, stride](unsigned v) {
+        glm::vec3 p;
+        memcpy(&p[0], positions + v * stride, 3 * sizeof(float));
+        return p;
+    };
+
+    size_t numTriangles = numIndices / 3;
+    size_t keep = std::min(numTriangles, static_cast<size_t>(std::max(maxTriangles, 0)));
+
+    std::vector<uint32_t> order(numTriangles);
+    std::iota(order.begin(), order.end(), 0);
+
+    if (keep < numTriangles)
+    {
+        std::vector<float> area(numTriangles);
+
+        for (size_t t = 0; t < numTriangles; t++)
+        {
+            glm::vec3 a = vertex(index(3 * t + 0));
+            glm::vec3 n = glm::cross(vertex(index(3 * t + 1)) - a, vertex(index(3 * t + 2)) - a);
+            area[t] = glm::dot(n, n);
+        }
+
+        std::nth_element(order.begin(), order.begin() + keep, order.end(),
+                         [&area](uint32_t a, uint32_t b) { return area[a] > area[b]; });
+        order.resize(keep);
+    }
+
+    // compact the vertices that are still referenced
+    std::unordered_map<unsigned, unsigned> remap;
+
+    occluder->positions.clear();
+    occluder->indices.clear();
+    occluder->indices.reserve(3 * keep);
+
+    for (uint32_t t : order)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned v = index(3 * t + k);
+            auto it = remap.find(v);
+
+            if (it == remap.end())
+            {
+                it = remap.emplace(v, static_cast<unsigned>(occluder->positions.size() / 3)).first;
+
+                glm::vec3 p = vertex(v);
+                occluder->positions.insert(occluder->positions.end(), {p.x, p.y, p.z});
+            }
+
+            occluder->indices.push_back(it->second);
+        }
+    }
+
+    occluder->bounds = ComputeBounds(occluder->positions);
+}
+
+const char* hzgl::OcclusionSimdPath()
+{
+#if defined(HZGL_OCCLUSION_AVX2)
+    return "AVX2";
+#elif defined(HZGL_OCCLUSION_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+hzgl::OcclusionCuller::OcclusionCuller(int width, int height, int numThreads)
+{
+    _width = (std::max(width, 8) + 7) & ~7;
+    _height = std::max(height, 1);
+    _tilesX = (_width + TileWidth - 1) / TileWidth;
+    _tilesY = (_height + TileHeight - 1) / TileHeight;
+    _viewProj = glm::mat4(1.0f);
+
+    _depth.assign(static_cast<size_t>(_width) * _height, 1.0f);
+    _bins.resize(_tilesX * _tilesY);
+
+    if (numThreads > 0)
+        _workers.reset(new ThreadPool(numThreads, 0, "Occlusion"));
+}
+
+hzgl::OcclusionCuller::~OcclusionCuller()
+{
+}
+
+void hzgl::OcclusionCuller::BeginFrame(const glm::mat4& viewProj)
+{
+    _viewProj = viewProj;
+    _stats = OcclusionStats();
+
+    std::fill(_depth.begin(), _depth.end(), 1.0f);
+    _triangles.clear();
+
+    for (auto& bin : _bins)
+        bin.clear();
+}
+
+void hzgl::OcclusionCuller::AddOccluder(const OccluderMesh& occluder, const glm::mat4& model)
+{
+    HZGL_PROFILE_SCOPE("AddOccluder");
+
+    SimpleTimer setupTimer;
+    setupTimer.Start();
+
+    glm::mat4 mvp = _viewProj * model;
+    size_t numVertices = occluder.positions.size() / 3;
+
+    _clip.resize(numVertices);
+    for (size_t v = 0; v < numVertices; v++)
+        _clip[v] = mvp * glm::vec4(occluder.positions[3 * v], occluder.positions[3 * v + 1], occluder.positions[3 * v + 2], 1.0f);
+
+    size_t first = _triangles.size();
+    _kept.clear();
+
+    for (size_t t = 0; t + 2 < occluder.indices.size(); t += 3)
+    {
+        const glm::vec4* c[3] = {&_clip[occluder.indices[t]], &_clip[occluder.indices[t + 1]], &_clip[occluder.indices[t + 2]]};
+
+        // triangles reaching the near plane are dropped rather than clipped: fewer occluders is always safe
+        bool nearPlane = false;
+        for (int k = 0; k < 3; k++)
+            nearPlane = nearPlane || (c[k]->w <= 1e-6f) || (c[k]->z < -c[k]->w);
+
+        if (nearPlane)
+            continue;
+
+        Triangle tri;
+        for (int k = 0; k < 3; k++)
+        {
+            float invW = 1.0f / c[k]->w;
+            tri.x[k] = (c[k]->x * invW * 0.5f + 0.5f) * _width;
+            tri.y[k] = (c[k]->y * invW * 0.5f + 0.5f) * _height;
+            tri.z[k] = c[k]->z * invW * 0.5f + 0.5f;
+        }
+
+        // counter-clockwise is front facing, as with glCullFace(GL_BACK)
+        float area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - (tri.x[2] - tri.x[0]) * (tri.y[1] - tri.y[0]);
+        if (!(area > 0.0f))
+            continue;
+
+        // pixels whose centers can be covered
+        float minX = std::min({tri.x[0], tri.x[1], tri.x[2]});
+        float maxX = std::max({tri.x[0], tri.x[1], tri.x[2]});
+        float minY = std::min({tri.y[0], tri.y[1], tri.y[2]});
+        float maxY = std::max({tri.y[0], tri.y[1], tri.y[2]});
+
+        tri.minX = std::max(0, static_cast<int>(std::ceil(minX - 0.5f)));
+        tri.maxX = std::min(_width - 1, static_cast<int>(std::floor(maxX - 0.5f)));
+        tri.minY = std::max(0, static_cast<int>(std::ceil(minY - 0.5f)));
+        tri.maxY = std::min(_height - 1, static_cast<int>(std::floor(maxY - 0.5f)));
+
+        if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+            continue;
+
+        _triangles.push_back(tri);
+        _kept.push_back(static_cast<uint32_t>(t));
+    }
+
+    // directed edges of the triangles kept: an edge whose reverse is among them is inside the
+    // silhouette (vertices are shared, BuildOccluder compacts them)
+    _edges.clear();
+
+    for (uint32_t t : _kept)
+    {
+        for (int e = 0; e < 3; e++)
+            _edges.push_back(static_cast<uint64_t>(occluder.indices[t + e]) << 32 | occluder.indices[t + (e + 1) % 3]);
+    }
+
+    std::sort(_edges.begin(), _edges.end());
+
+    for (size_t i = 0; i < _kept.size(); i++)
+    {
+        Triangle& tri = _triangles[first + i];
+        uint32_t t = _kept[i];
+
+        for (int e = 0; e < 3; e++)
+        {
+            uint64_t reverse = static_cast<uint64_t>(occluder.indices[t + (e + 1) % 3]) << 32 | occluder.indices[t + e];
+            tri.shared[e] = std::binary_search(_edges.begin(), _edges.end(), reverse);
+        }
+
+        uint32_t index = static_cast<uint32_t>(first + i);
+
+        for (int ty = tri.minY / TileHeight; ty <= tri.maxY / TileHeight; ty++)
+        {
+            for (int tx = tri.minX / TileWidth; tx <= tri.maxX / TileWidth; tx++)
+                _bins[ty * _tilesX + tx].push_back(index);
+        }
+    }
+
+    _stats.occluders++;
+    _stats.occluder_triangles = static_cast<int64_t>(_triangles.size());
+    _stats.raster_ms += 1000.0 * setupTimer.End();
+}
+
+void hzgl::OcclusionCuller::rasterizeTile(int tile)
+{
+    int tileX0 = (tile % _tilesX) * TileWidth;
+    int tileY0 = (tile / _tilesX) * TileHeight;
+    int tileX1 = std::min(tileX0 + TileWidth, _width) - 1;
+    int tileY1 = std::min(tileY0 + TileHeight, _height) - 1;
+
+    for (uint32_t index : _bins[tile])
+    {
+        const Triangle& tri = _triangles[index];
+
+        // edge functions E(x, y) = A x + B y + C, positive inside
+        float A[3], B[3], C[3];
+        for (int e = 0; e < 3; e++)
+        {
+            int a = e;
+            int b = (e + 1) % 3;
+            A[e] = -(tri.y[b] - tri.y[a]);
+            B[e] = tri.x[b] - tri.x[a];
+            C[e] = -(A[e] * tri.x[a] + B[e] * tri.y[a]);
+
+            // on the silhouette, only pixels the triangle covers entirely: moved inwards by half a
+            // pixel along both axes, the edge holds at all four corners when it holds at the center.
+            // Pixels on an edge shared with another triangle are covered by the two together
+            if (!tri.shared[e])
+                C[e] -= 0.5f * (std::fabs(A[e]) + std::fabs(B[e]));
+        }
+
+        // depth plane z = z0 + dzdx (x - x0) + dzdy (y - y0)
+        float dx1 = tri.x[1] - tri.x[0], dy1 = tri.y[1] - tri.y[0];
+        float dx2 = tri.x[2] - tri.x[0], dy2 = tri.y[2] - tri.y[0];
+        float det = dx1 * dy2 - dx2 * dy1;
+        float dzdx = ((tri.z[1] - tri.z[0]) * dy2 - (tri.z[2] - tri.z[0]) * dy1) / det;
+        float dzdy = (dx1 * (tri.z[2] - tri.z[0]) - dx2 * (tri.z[1] - tri.z[0])) / det;
+        float zC = tri.z[0] - dzdx * tri.x[0] - dzdy * tri.y[0];
+
+        // and the farthest depth of the plane within the pixel, not the one at its center
+        zC += 0.5f * (std::fabs(dzdx) + std::fabs(dzdy));
+
+        int x0 = std::max(tri.minX, tileX0) & ~7;   // tiles start on a multiple of 8
+        int x1 = std::min(tri.maxX, tileX1);
+        int y0 = std::max(tri.minY, tileY0);
+        int y1 = std::min(tri.maxY, tileY1);
+
+        for (int y = y0; y <= y1; y++)
+        {
+            float py = y + 0.5f;
+            float e0 = B[0] * py + C[0];
+            float e1 = B[1] * py + C[1];
+            float e2 = B[2] * py + C[2];
+            float zRow = dzdy * py + zC;
+            float* row = &_depth[static_cast<size_t>(y) * _width];
+
+#if defined(HZGL_OCCLUSION_AVX2)
+            const __m256 lanes = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+            const __m256 zero = _mm256_setzero_ps();
+
+            for (int x = x0; x <= x1; x += 8)
+            {
+                __m256 px = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), lanes);
+
+                __m256 w0 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(A[0]), px), _mm256_set1_ps(e0));
+                __m256 w1 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(A[1]), px), _mm256_set1_ps(e1));
+                __m256 w2 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(A[2]), px), _mm256_set1_ps(e2));
+
+                __m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(w0, zero, _CMP_GE_OQ), _mm256_cmp_ps(w1, zero, _CMP_GE_OQ)),
+                                              _mm256_cmp_ps(w2, zero, _CMP_GE_OQ));
+
+                if (_mm256_movemask_ps(inside) == 0)
+                    continue;
+
+                __m256 z = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(dzdx), px), _mm256_set1_ps(zRow));
+                __m256 depth = _mm256_loadu_ps(row + x);
+                _mm256_storeu_ps(row + x, _mm256_blendv_ps(depth, _mm256_min_ps(depth, z), inside));
+            }
+#elif defined(HZGL_OCCLUSION_SSE2)
+            const __m128 lanes = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+            const __m128 zero = _mm_setzero_ps();
+
+            for (int x = x0; x <= x1; x += 4)
+            {
+                __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lanes);
+
+                __m128 w0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A[0]), px), _mm_set1_ps(e0));
+                __m128 w1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A[1]), px), _mm_set1_ps(e1));
+                __m128 w2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A[2]), px), _mm_set1_ps(e2));
+
+                __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)), _mm_cmpge_ps(w2, zero));
+
+                if (_mm_movemask_ps(inside) == 0)
+                    continue;
+
+                // no blendv before SSE4.1
+                __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(dzdx), px), _mm_set1_ps(zRow));
+                __m128 depth = _mm_loadu_ps(row + x);
+                __m128 nearer = _mm_min_ps(depth, z);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, depth)));
+            }
+#else
+            for (int x = x0; x <= x1; x++)
+            {
+                float px = x + 0.5f;
+
+                if (A[0] * px + e0 >= 0.0f && A[1] * px + e1 >= 0.0f && A[2] * px + e2 >= 0.0f)
+                    row[x] = std::min(row[x], dzdx * px + zRow);
+            }
+#endif
+        }
+    }
+}
+
+void hzgl::OcclusionCuller::RasterizeOccluders()
+{
+    HZGL_PROFILE_SCOPE("RasterizeOccluders");
+
+    SimpleTimer rasterTimer;
+    rasterTimer.Start();
+
+    int numTiles = _tilesX * _tilesY;
+
+    if (_workers != nullptr)
+    {
+        // one task per tile: tiles own disjoint pixels, so no synchronization is needed
+        for (int tile = 0; tile < numTiles; tile++)
+        {
+            if (!_bins[tile].empty())
+                _workers->Submit([this, tile]() { rasterizeTile(tile); });
+        }
+
+        _workers->Wait();
+    }
+    else
+    {
+        for (int tile = 0; tile < numTiles; tile++)
+            rasterizeTile(tile);
+    }
+
+    _stats.raster_ms += 1000.0 * rasterTimer.End();
+}
+
+bool hzgl::OcclusionCuller::IsVisible(const BoundingBox& box, const glm::mat4& model)
+{
+    SimpleTimer testTimer;
+    testTimer.Start();
+
+    _stats.tested++;
+
+    glm::vec4 corners[8];
+
+    if (!hzglProjectBox(box, _viewProj * model, corners))
+    {
+        _stats.frustum_culled++;
+        _stats.test_ms += 1000.0 * testTimer.End();
+        return false;
+    }
+
+    float minX = std::numeric_limits<float>::max(), maxX = -minX;
+    float minY = minX, maxY = -minX;
+    float minZ = minX;
+
+    bool visible = false;
+
+    for (int i = 0; i < 8 && !visible; i++)
+    {
+        // a box reaching the near plane is too close to test
+        if (corners[i].w <= 1e-6f || corners[i].z < -corners[i].w)
+        {
+            visible = true;
+            break;
+        }
+
+        float invW = 1.0f / corners[i].w;
+        float x = (corners[i].x * invW * 0.5f + 0.5f) * _width;
+        float y = (corners[i].y * invW * 0.5f + 0.5f) * _height;
+
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        minZ = std::min(minZ, corners[i].z * invW * 0.5f + 0.5f);
+    }
+
+    if (!visible)
+    {
+        // every pixel the rectangle touches must be covered by something nearer than the box
+        int x0 = std::max(0, static_cast<int>(std::floor(minX)));
+        int x1 = std::min(_width - 1, static_cast<int>(std::floor(maxX)));
+        int y0 = std::max(0, static_cast<int>(std::floor(minY)));
+        int y1 = std::min(_height - 1, static_cast<int>(std::floor(maxY)));
+
+        visible = (x0 > x1 || y0 > y1);
+
+        for (int y = y0; y <= y1 && !visible; y++)
+        {
+            const float* row = &_depth[static_cast<size_t>(y) * _width];
+
+            for (int x = x0; x <= x1; x++)
+            {
+                if (row[x] >= minZ)
+                {
+                    visible = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (!visible)
+        _stats.occlusion_culled++;
+
+    _stats.test_ms += 1000.0 * testTimer.End();
+
+    return visible;
+}
+
+float hzgl::OcclusionCuller::ScreenCoverage(const BoundingBox& box, const glm::mat4& model) const
+{
+    glm::vec4 corners[8];
+
+    if (!hzglProjectBox(box, _viewProj * model, corners))
+        return 0.0f;
+
+    float minX = 1.0f, maxX = -1.0f, minY = 1.0f, maxY = -1.0f;
+
+    for (int i = 0; i < 8; i++)
+    {
+        // close enough to reach the near plane: surely a big occluder
+        if (corners[i].w <= 1e-6f)
+            return 1.0f;
+
+        minX = std::min(minX, corners[i].x / corners[i].w);
+        maxX = std::max(maxX, corners[i].x / corners[i].w);
+        minY = std::min(minY, corners[i].y / corners[i].w);
+        maxY = std::max(maxY, corners[i].y / corners[i].w);
+    }
+
+    // clamp to the screen, which is 2 x 2 in normalized device coordinates
+    float w = std::min(maxX, 1.0f) - std::max(minX, -1.0f);
+    float h = std::min(maxY, 1.0f) - std::max(minY, -1.0f);
+
+    return (w > 0.0f && h > 0.0f) ? 0.25f * w * h : 0.0f;
+}
+
+const hzgl::OcclusionStats& hzgl::OcclusionCuller::Stats() const
+{
+    return _stats;
+}
+
+const std::vector<float>& hzgl::OcclusionCuller::DepthBuffer() const
+{
+    return _depth;
+}
+
+int hzgl::OcclusionCuller::Width() const
+{
+    return _width;
+}
+
+int hzgl::OcclusionCuller::Height() const
+{
+    return _height;
+}
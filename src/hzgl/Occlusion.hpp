@@ -0,0 +1,118 @@
+#pragma once
+
+#include "ThreadPool.hpp"
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+namespace hzgl
+{
+    typedef struct
+    {
+        glm::vec3 min = glm::vec3(0.0f);
+        glm::vec3 max = glm::vec3(0.0f);
+    } BoundingBox;
+
+    // reduced triangle set that fills the CPU depth buffer in place of the full mesh
+    typedef struct
+    {
+        std::vector<float> positions;     // xyz
+        std::vector<unsigned> indices;
+        BoundingBox bounds;
+    } OccluderMesh;
+
+    typedef struct
+    {
+        int occluders = 0;
+        int64_t occluder_triangles = 0;   // after near-plane, frustum and back-face rejection
+        int tested = 0;
+        int frustum_culled = 0;
+        int occlusion_culled = 0;
+        double raster_ms = 0.0;           // triangle setup, binning and rasterization
+        double test_ms = 0.0;
+    } OcclusionStats;
+
+    BoundingBox ComputeBounds(const std::vector<float>& positions);
+
+    // keep the (up to) maxTriangles largest triangles of a mesh; a subset of the surface can only
+    // hide less than the surface itself, so culling against it stays conservative
+    void BuildOccluder(const std::vector<float>& positions, const std::vector<unsigned>& indices, int maxTriangles,
+                       OccluderMesh* occluder);
+
+    // the same from vertex data as it sits in a file: float xyz every stride bytes, and indices of
+    // indexSize (1, 2 or 4) bytes
+    void BuildOccluder(const uint8_t* positions, size_t stride, const void* indices, int indexSize, size_t numIndices,
+                       int maxTriangles, OccluderMesh* occluder);
+
+    // "AVX2", "SSE2" or "scalar", whichever the rasterizer was compiled with
+    const char* OcclusionSimdPath();
+
+    // software depth buffer at a low resolution: large occluders are rasterized into it (screen tiles
+    // in parallel) and bounding boxes are tested against it before their draw calls are issued.
+    // An occluder only fills the pixels it covers entirely (along its silhouette, edges shared by two
+    // of its triangles are sampled at pixel centers), at the farthest depth of the plane in each, and
+    // a box is tested on every pixel it touches, so nothing visible is culled. Nothing here touches
+    // OpenGL.
+    class OcclusionCuller
+    {
+    private:
+        typedef struct
+        {
+            float x[3], y[3], z[3];       // pixels (y up) and depth in [0, 1]
+            int minX, minY, maxX, maxY;   // covered pixels, inclusive
+            bool shared[3];               // edge k (vertex k to k + 1) is shared with another triangle
+        } Triangle;
+
+        int _width;                        // rounded up to a multiple of 8 (one AVX register)
+        int _height;
+        int _tilesX;
+        int _tilesY;
+        glm::mat4 _viewProj;
+
+        std::vector<float> _depth;         // 1 is the far plane
+        std::vector<Triangle> _triangles;
+        std::vector<std::vector<uint32_t>> _bins;  // triangles overlapping each tile
+        std::vector<glm::vec4> _clip;      // scratch for vertex transforms
+        std::vector<uint32_t> _kept;       // scratch: first index of each triangle kept from an occluder
+        std::vector<uint64_t> _edges;      // scratch: its directed edges, sorted
+
+        std::unique_ptr<ThreadPool> _workers;
+        OcclusionStats _stats;
+
+        void rasterizeTile(int tile);
+
+    public:
+        static const int TileWidth = 64;
+        static const int TileHeight = 32;
+
+        // numThreads 0 rasterizes on the calling thread
+        OcclusionCuller(int width = 256, int height = 128, int numThreads = 0);
+        ~OcclusionCuller();
+
+        OcclusionCuller(const OcclusionCuller&) = delete;
+        OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+        // clear the depth buffer and the statistics
+        void BeginFrame(const glm::mat4& viewProj);
+
+        // transform, clip and bin the triangles of an occluder
+        void AddOccluder(const OccluderMesh& occluder, const glm::mat4& model);
+
+        // fill the depth buffer with every occluder added since BeginFrame
+        void RasterizeOccluders();
+
+        // false when the box is outside the frustum or hidden behind the occluders
+        bool IsVisible(const BoundingBox& box, const glm::mat4& model);
+
+        // fraction of the screen covered by the projected box (for picking occluders)
+        float ScreenCoverage(const BoundingBox& box, const glm::mat4& model) const;
+
+        const OcclusionStats& Stats() const;
+        const std::vector<float>& DepthBuffer() const;
+        int Width() const;
+        int Height() const;
+    };
+} // namespace hzgl
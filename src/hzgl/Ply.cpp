@@ -0,0 +1,190 @@
+#include "Ply.hpp"
+
+#include <sstream>
+#include <algorithm>
+
+static int hzglPlyTypeSize(const std::string& type, bool* isFloat, bool* isSigned)
+{
+    *isFloat = (type == "float" || type == "float32" || type == "double" || type == "float64");
+    *isSigned = *isFloat || type == "char" || type == "int8" || type == "short" || type == "int16" || type == "int" || type == "int32";
+
+    if (type == "char" || type == "uchar" || type == "int8" || type == "uint8")
+        return 1;
+    if (type == "short" || type == "ushort" || type == "int16" || type == "uint16")
+        return 2;
+    if (type == "int" || type == "uint" || type == "int32" || type == "uint32" || type == "float" || type == "float32")
+        return 4;
+    if (type == "double" || type == "float64")
+        return 8;
+
+    return 0;
+}
+
+bool hzgl::ReadPlyHeader(const uint8_t* data, size_t size, PlyHeader* header)
+{
+    const char* text = reinterpret_cast<const char*>(data);
+    size = std::min<size_t>(size, 64 * 1024);
+
+    if (size < 4 || strncmp(text, "ply", 3) != 0)
+        return false;
+
+    std::string head(text, size);
+    size_t end = head.find("end_header");
+    if (end == std::string::npos)
+        return false;
+
+    size_t newline = head.find('\n', end);
+    if (newline == std::string::npos)
+        return false;
+
+    *header = PlyHeader();
+    header->data_offset = newline + 1;
+
+    std::istringstream lines(head.substr(0, end));
+    std::string line;
+
+    while (std::getline(lines, line))
+    {
+        std::istringstream words(line);
+        std::string keyword;
+        words >> keyword;
+
+        if (keyword == "format")
+        {
+            std::string format;
+            words >> format;
+            header->binary = (format == "binary_little_endian" || format == "binary_big_endian");
+            header->big_endian = (format == "binary_big_endian");
+        }
+        else if (keyword == "element")
+        {
+            PlyElement element;
+            words >> element.name >> element.count;
+            header->elements.push_back(element);
+        }
+        else if (keyword == "property" && !header->elements.empty())
+        {
+            PlyElement& element = header->elements.back();
+            PlyProperty property;
+            std::string type;
+            words >> type;
+
+            if (type == "list")
+            {
+                std::string countType, itemType;
+                words >> countType >> itemType >> property.name;
+
+                bool countFloat, countSigned;
+                property.count_size = hzglPlyTypeSize(countType, &countFloat, &countSigned);
+                property.size = hzglPlyTypeSize(itemType, &property.is_float, &property.is_signed);
+
+                if (property.count_size == 0 || countFloat)
+                    return false;
+            }
+            else
+            {
+                words >> property.name;
+                property.size = hzglPlyTypeSize(type, &property.is_float, &property.is_signed);
+            }
+
+            if (property.size == 0)
+                return false;
+
+            // offsets and the stride only hold up to the first list
+            bool fixed = element.properties.empty() || element.stride > 0;
+            property.offset = fixed ? element.stride : 0;
+            element.stride = (fixed && property.count_size == 0) ? element.stride + property.size : 0;
+
+            element.properties.push_back(property);
+        }
+    }
+
+    return true;
+}
+
+int hzgl::FindPlyElement(const PlyHeader& header, const std::string& name)
+{
+    for (int e = 0; e < static_cast<int>(header.elements.size()); e++)
+    {
+        if (header.elements[e].name == name)
+            return e;
+    }
+
+    return -1;
+}
+
+int hzgl::FindPlyProperty(const PlyElement& element, const std::string& name)
+{
+    for (int p = 0; p < static_cast<int>(element.properties.size()); p++)
+    {
+        if (element.properties[p].name == name)
+            return p;
+    }
+
+    return -1;
+}
+
+size_t hzgl::PlyElementOffset(const PlyHeader& header, int element)
+{
+    if (!header.binary || element < 0 || element >= static_cast<int>(header.elements.size()))
+        return 0;
+
+    size_t offset = header.data_offset;
+
+    for (int e = 0; e < element; e++)
+    {
+        const PlyElement& before = header.elements[e];
+
+        if (before.stride == 0 && before.count > 0)
+            return 0;
+
+        offset += static_cast<size_t>(before.count) * before.stride;
+    }
+
+    return offset;
+}
+
+int hzgl::FindPlyFaceIndices(const PlyElement& face)
+{
+    int list = FindPlyProperty(face, "vertex_indices");
+    if (list < 0)
+        list = FindPlyProperty(face, "vertex_index");
+
+    if (list < 0 || face.properties[list].count_size == 0 || face.properties[list].is_float)
+        return -1;
+
+    return list;
+}
+
+size_t hzgl::ReadPlyFace(const uint8_t* data, size_t size, size_t offset, const PlyElement& face, int list, bool bigEndian,
+                         std::vector<uint32_t>& corners)
+{
+    corners.clear();
+
+    for (int k = 0; k < static_cast<int>(face.properties.size()); k++)
+    {
+        const PlyProperty& property = face.properties[k];
+
+        if (property.count_size == 0)
+        {
+            offset += property.size;
+            continue;
+        }
+
+        if (offset + property.count_size > size)
+            return 0;
+
+        uint64_t count = ReadPlyUnsigned(data + offset, property.count_size, bigEndian);
+        offset += property.count_size;
+
+        if (count > (size - offset) / property.size)
+            return 0;
+
+        for (uint64_t i = 0; k == list && i < count; i++)
+            corners.push_back(static_cast<uint32_t>(ReadPlyUnsigned(data + offset + i * property.size, property.size, bigEndian)));
+
+        offset += count * property.size;
+    }
+
+    return (offset <= size) ? offset : 0;
+}
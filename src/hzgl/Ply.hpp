@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace hzgl
+{
+    typedef struct
+    {
+        std::string name;
+        int size = 0;                   // bytes of a scalar, or of every item of a list
+        int count_size = 0;             // bytes of the item count, lists only
+        bool is_float = false;
+        bool is_signed = false;
+        size_t offset = 0;              // from the start of the element, scalars before any list only
+    } PlyProperty;
+
+    typedef struct
+    {
+        std::string name;
+        int64_t count = 0;
+        std::vector<PlyProperty> properties;
+        size_t stride = 0;              // bytes of one element in a binary file, 0 if it has lists
+    } PlyElement;
+
+    typedef struct
+    {
+        bool binary = false;
+        bool big_endian = false;
+        size_t data_offset = 0;         // first byte after end_header
+        std::vector<PlyElement> elements;
+    } PlyHeader;
+
+    // the header of a PLY file held in memory (e.g. mapped); false if it is not one
+    bool ReadPlyHeader(const uint8_t* data, size_t size, PlyHeader* header);
+
+    // -1 if missing
+    int FindPlyElement(const PlyHeader& header, const std::string& name);
+    int FindPlyProperty(const PlyElement& element, const std::string& name);
+
+    // where an element starts in a binary file, if every element before it has a fixed size;
+    // 0 otherwise (the data never starts at 0)
+    size_t PlyElementOffset(const PlyHeader& header, int element);
+
+    // the list of vertex indices of a face element, "vertex_indices" or "vertex_index"; -1 if it
+    // has neither, or its items are not integers
+    int FindPlyFaceIndices(const PlyElement& face);
+
+    // one face of a binary file: the items of the list property go to corners (not checked
+    // against the vertex count), the other properties are skipped. The offset of the next face,
+    // 0 if the file ends first
+    size_t ReadPlyFace(const uint8_t* data, size_t size, size_t offset, const PlyElement& face, int list, bool bigEndian,
+                       std::vector<uint32_t>& corners);
+
+    // scalars of a binary file, in its byte order
+    inline uint64_t ReadPlyUnsigned(const uint8_t* p, int size, bool bigEndian)
+    {
+        uint64_t value = 0;
+
+        for (int i = 0; i < size; i++)
+            value |= static_cast<uint64_t>(p[bigEndian ? size - 1 - i : i]) << (8 * i);
+
+        return value;
+    }
+
+    inline double ReadPlyScalar(const uint8_t* p, const PlyProperty& property, bool bigEndian)
+    {
+        uint64_t bits = ReadPlyUnsigned(p, property.size, bigEndian);
+
+        if (property.is_float && property.size == 8)
+        {
+            double value;
+            memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        if (property.is_float)
+        {
+            uint32_t bits32 = static_cast<uint32_t>(bits);
+            float value;
+            memcpy(&value, &bits32, sizeof(value));
+            return value;
+        }
+
+        // sign-extend from the width of the property
+        if (property.is_signed && property.size < 8 && (bits >> (8 * property.size - 1)) != 0)
+            return static_cast<double>(static_cast<int64_t>(bits | (~0ull << (8 * property.size))));
+
+        return static_cast<double>(bits);
+    }
+} // namespace hzgl
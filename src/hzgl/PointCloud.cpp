@@ -0,0 +1,1418 @@
+#include "PointCloud.hpp"
+
+#include "Ply.hpp"
+#include "Timer.hpp"
+#include "Memory.hpp"
+#include "Shader.hpp"
+#include "Profiler.hpp"
+#include "ThreadPool.hpp"
+
+#include <cmath>
+#include <mutex>
+#include <atomic>
+#include <random>
+#include <cstdio>
+#include <limits>
+#include <thread>
+#include <cstring>
+#include <cstddef>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+static const char hzglPointMagic[8] = {'H', 'Z', 'P', 'O', 'I', 'N', 'T', '1'};
+static const uint32_t hzglPointVersion = 1;
+static const int hzglCountLevels = 7;       // points are counted on a 128^3 grid to cut the chunks
+static const int hzglMaxDepth = 24;         // below this the points are (nearly) on top of each other
+
+//
+// input points
+//
+
+// the points of a mapped binary PLY or XYZ text file
+typedef struct
+{
+    hzgl::MappedFile file;
+    bool ply = false;               // else XYZ
+    bool big_endian = false;
+    bool has_colors = false;
+    size_t begin = 0;               // bytes of the points
+    size_t end = 0;
+    size_t stride = 0;              // PLY only
+    hzgl::PlyProperty position[3];
+    hzgl::PlyProperty color[3];
+} PointSource;
+
+// what the decoders produce, before the origin is known
+typedef struct
+{
+    double position[3];
+    uint8_t color[4];
+} InputPoint;
+
+static bool hzglOpenPointSource(const std::string& filepath, PointSource& source)
+{
+    if (!source.file.Open(filepath) || source.file.Size() == 0)
+    {
+        std::cerr << "Failed to open " << filepath << std::endl;
+        return false;
+    }
+
+    hzgl::PlyHeader header;
+
+    if (!hzgl::ReadPlyHeader(source.file.Data(), source.file.Size(), &header))
+    {
+        // anything that is not PLY is read as lines of numbers
+        source.begin = 0;
+        source.end = source.file.Size();
+        return true;
+    }
+
+    int vertex = hzgl::FindPlyElement(header, "vertex");
+
+    if (!header.binary || vertex < 0 || header.elements[vertex].stride == 0 || hzgl::PlyElementOffset(header, vertex) == 0)
+    {
+        std::cerr << filepath << ": only binary PLY files with fixed-size vertices are supported" << std::endl;
+        return false;
+    }
+
+    const hzgl::PlyElement& vertices = header.elements[vertex];
+    const char* positionNames[3] = {"x", "y", "z"};
+    const char* colorNames[3] = {"red", "green", "blue"};
+
+    source.has_colors = true;
+
+    for (int k = 0; k < 3; k++)
+    {
+        int p = hzgl::FindPlyProperty(vertices, positionNames[k]);
+        if (p < 0)
+        {
+            std::cerr << filepath << " has no " << positionNames[k] << " coordinates" << std::endl;
+            return false;
+        }
+
+        source.position[k] = vertices.properties[p];
+
+        int c = hzgl::FindPlyProperty(vertices, colorNames[k]);
+        if (c < 0)
+            c = hzgl::FindPlyProperty(vertices, std::string("diffuse_") + colorNames[k]);
+
+        if (c >= 0)
+            source.color[k] = vertices.properties[c];
+        else
+            source.has_colors = false;
+    }
+
+    source.ply = true;
+    source.big_endian = header.big_endian;
+    source.stride = vertices.stride;
+    source.begin = hzgl::PlyElementOffset(header, vertex);
+    source.end = std::min(source.file.Size(), source.begin + static_cast<size_t>(vertices.count) * source.stride);
+    source.end = source.begin + (source.end - source.begin) / source.stride * source.stride;
+
+    return true;
+}
+
+// [begin, end) ranges of about unit bytes that start on a point (a line of an XYZ file)
+static std::vector<std::pair<size_t, size_t>> hzglPointRanges(const PointSource& source, size_t unit)
+{
+    std::vector<std::pair<size_t, size_t>> ranges;
+    const uint8_t* data = source.file.Data();
+
+    if (source.ply)
+        unit = std::max<size_t>(unit / source.stride, 1) * source.stride;
+
+    size_t begin = source.begin;
+
+    while (begin < source.end)
+    {
+        size_t end = std::min(source.end, begin + unit);
+
+        if (!source.ply)
+        {
+            while (end < source.end && data[end - 1] != '\n')
+                end++;
+        }
+
+        ranges.push_back({begin, end});
+        begin = end;
+    }
+
+    return ranges;
+}
+
+// a number of an XYZ line, no further than end (the mapping is not null-terminated)
+static bool hzglParseNumber(const char*& p, const char* end, double* value)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == ',' || *p == ';'))
+        p++;
+
+    const char* start = p;
+    double sign = 1.0;
+
+    if (p < end && (*p == '-' || *p == '+'))
+        sign = (*p++ == '-') ? -1.0 : 1.0;
+
+    double mantissa = 0.0;
+    int digits = 0, exponent = 0;
+
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+        mantissa = 10.0 * mantissa + (*p++ - '0');
+        digits++;
+    }
+
+    if (p < end && *p == '.')
+    {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9')
+        {
+            mantissa = 10.0 * mantissa + (*p++ - '0');
+            exponent--;
+            digits++;
+        }
+    }
+
+    if (digits == 0)
+    {
+        p = start;
+        return false;
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char* e = p++;
+        int expSign = 1, value = 0;
+
+        if (p < end && (*p == '-' || *p == '+'))
+            expSign = (*p++ == '-') ? -1 : 1;
+
+        if (p < end && *p >= '0' && *p <= '9')
+        {
+            while (p < end && *p >= '0' && *p <= '9')
+                value = std::min(10 * value + (*p++ - '0'), 1000);
+
+            exponent += expSign * value;
+        }
+        else
+            p = e;
+    }
+
+    *value = sign * mantissa * std::pow(10.0, exponent);
+    return true;
+}
+
+// the points of one range; a line of an XYZ file without three numbers is skipped. True if any
+// point has a color of its own
+static bool hzglDecodePoints(const PointSource& source, size_t begin, size_t end, std::vector<InputPoint>& points)
+{
+    points.clear();
+
+    const uint8_t* data = source.file.Data();
+
+    if (source.ply)
+    {
+        points.resize((end - begin) / source.stride);
+
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            const uint8_t* vertex = data + begin + i * source.stride;
+            InputPoint& point = points[i];
+
+            for (int k = 0; k < 3; k++)
+                point.position[k] = hzgl::ReadPlyScalar(vertex + source.position[k].offset, source.position[k], source.big_endian);
+
+            for (int k = 0; k < 3; k++)
+            {
+                if (!source.has_colors)
+                    point.color[k] = 200;
+                else
+                {
+                    double c = hzgl::ReadPlyScalar(vertex + source.color[k].offset, source.color[k], source.big_endian);
+                    point.color[k] = static_cast<uint8_t>(std::min(std::max(source.color[k].is_float ? 255.0 * c : c, 0.0), 255.0));
+                }
+            }
+
+            point.color[3] = 255;
+        }
+
+        return source.has_colors && !points.empty();
+    }
+
+    bool colored = false;
+
+    const char* p = reinterpret_cast<const char*>(data + begin);
+    const char* last = reinterpret_cast<const char*>(data + end);
+
+    while (p < last)
+    {
+        const char* lineEnd = static_cast<const char*>(memchr(p, '\n', last - p));
+        if (lineEnd == nullptr)
+            lineEnd = last;
+
+        double values[6];
+        int count = 0;
+
+        while (count < 6 && hzglParseNumber(p, lineEnd, &values[count]))
+            count++;
+
+        if (count >= 3)
+        {
+            colored = colored || count >= 6;
+
+            InputPoint point;
+
+            for (int k = 0; k < 3; k++)
+            {
+                point.position[k] = values[k];
+                point.color[k] = (count >= 6) ? static_cast<uint8_t>(std::min(std::max(values[3 + k], 0.0), 255.0)) : 200;
+            }
+
+            point.color[3] = 255;
+            points.push_back(point);
+        }
+
+        p = lineEnd + 1;
+    }
+
+    return colored;
+}
+
+// calls fn(points, colored) for every range on the threads of the pool, dropping the pages of the range
+// after; at most as many ranges as there are threads are decoded at once
+static void hzglForEachRange(PointSource& source, const std::vector<std::pair<size_t, size_t>>& ranges, hzgl::ThreadPool& pool,
+                             const std::function<void(const std::vector<InputPoint>&, bool)>& fn)
+{
+    source.file.AdviseSequential(source.begin, source.end - source.begin);
+
+    for (const auto& range : ranges)
+    {
+        pool.Submit([&source, range, &fn]() {
+            HZGL_PROFILE_SCOPE("DecodePoints");
+
+            // one buffer per worker, reused across ranges
+            static thread_local std::vector<InputPoint> points;
+
+            bool colored = hzglDecodePoints(source, range.first, range.second, points);
+            source.file.Evict(range.first, range.second - range.first);
+
+            fn(points, colored);
+        });
+    }
+
+    pool.Wait();
+}
+
+//
+// octree
+//
+
+// a node of the tree as it is built; the points of chunk roots and of the nodes above them stay
+// in memory until the level above has sampled from them, all others are written as soon as
+// their subtree is done
+typedef struct
+{
+    int depth = 0;
+    uint64_t key = 0;               // cell of the node at its depth, 21 bits per axis
+    uint64_t offset = 0;
+    uint32_t num_points = 0;
+    int children[8] = {-1, -1, -1, -1, -1, -1, -1, -1};     // within the same list
+    std::vector<hzgl::PointVertex> points;
+} BuildNode;
+
+static uint64_t hzglNodeKey(const glm::ivec3& cell)
+{
+    return (static_cast<uint64_t>(cell.x) << 42) | (static_cast<uint64_t>(cell.y) << 21) | static_cast<uint64_t>(cell.z);
+}
+
+static glm::ivec3 hzglNodeCell(uint64_t key)
+{
+    return glm::ivec3(static_cast<int>((key >> 42) & 0x1fffff), static_cast<int>((key >> 21) & 0x1fffff), static_cast<int>(key & 0x1fffff));
+}
+
+// moves the first point of every cell of a grid over the cube to the front of [begin, end);
+// returns the end of those. The points come in random order, so that is a random one per cell
+static size_t hzglSampleCells(hzgl::PointVertex* points, size_t begin, size_t end, const glm::vec3& lo, float size, int grid,
+                              std::vector<uint64_t>& taken)
+{
+    taken.assign((static_cast<size_t>(grid) * grid * grid + 63) / 64, 0);
+
+    float scale = grid / size;
+    size_t accepted = begin;
+
+    for (size_t i = begin; i < end; i++)
+    {
+        glm::ivec3 c = glm::clamp(glm::ivec3((glm::vec3(points[i].position[0], points[i].position[1], points[i].position[2]) - lo) * scale),
+                                  glm::ivec3(0), glm::ivec3(grid - 1));
+        size_t cell = (static_cast<size_t>(c.z) * grid + c.y) * grid + c.x;
+
+        if (taken[cell / 64] & (1ull << (cell % 64)))
+            continue;
+
+        taken[cell / 64] |= 1ull << (cell % 64);
+        std::swap(points[accepted++], points[i]);
+    }
+
+    return accepted;
+}
+
+// splits [begin, end) by octant of the cube and returns the 9 bounds
+static void hzglSplitOctants(hzgl::PointVertex* points, size_t begin, size_t end, const glm::vec3& center, size_t bounds[9])
+{
+    auto lower = [&center](int axis) {
+        return [&center, axis](const hzgl::PointVertex& p) { return p.position[axis] < center[axis]; };
+    };
+
+    bounds[0] = begin;
+    bounds[8] = end;
+    bounds[4] = std::partition(points + begin, points + end, lower(2)) - points;
+
+    for (int z = 0; z < 2; z++)
+    {
+        bounds[4 * z + 2] = std::partition(points + bounds[4 * z], points + bounds[4 * z + 4], lower(1)) - points;
+
+        for (int y = 0; y < 2; y++)
+            bounds[4 * z + 2 * y + 1] = std::partition(points + bounds[4 * z + 2 * y], points + bounds[4 * z + 2 * y + 2], lower(0)) - points;
+    }
+}
+
+typedef struct
+{
+    float root_size;
+    int grid;
+    int max_node_points;
+} TreeParams;
+
+// the subtree of one node over [begin, end); every node but the first is written to blob
+static int hzglBuildSubtree(hzgl::PointVertex* points, size_t begin, size_t end, int depth, const glm::ivec3& cell,
+                            const TreeParams& params, std::vector<BuildNode>& nodes, std::vector<uint8_t>& blob, std::vector<uint64_t>& taken)
+{
+    int index = static_cast<int>(nodes.size());
+    nodes.push_back(BuildNode());
+    nodes[index].depth = depth;
+    nodes[index].key = hzglNodeKey(cell);
+
+    float size = params.root_size / static_cast<float>(1u << depth);
+    glm::vec3 lo = glm::vec3(cell) * size;
+
+    size_t kept = end;
+    if (end - begin > static_cast<size_t>(params.max_node_points) && depth < hzglMaxDepth)
+        kept = hzglSampleCells(points, begin, end, lo, size, params.grid, taken);
+
+    nodes[index].num_points = static_cast<uint32_t>(kept - begin);
+
+    if (index == 0)
+        nodes[index].points.assign(points + begin, points + kept);
+    else
+    {
+        nodes[index].offset = blob.size();
+        blob.insert(blob.end(), reinterpret_cast<const uint8_t*>(points + begin), reinterpret_cast<const uint8_t*>(points + kept));
+    }
+
+    if (kept == end)
+        return index;
+
+    size_t bounds[9];
+    hzglSplitOctants(points, kept, end, lo + glm::vec3(0.5f * size), bounds);
+
+    for (int k = 0; k < 8; k++)
+    {
+        if (bounds[k + 1] == bounds[k])
+            continue;
+
+        glm::ivec3 child = 2 * cell + glm::ivec3(k & 1, (k >> 1) & 1, (k >> 2) & 1);
+        int c = hzglBuildSubtree(points, bounds[k], bounds[k + 1], depth + 1, child, params, nodes, blob, taken);
+        nodes[index].children[k] = c;
+    }
+
+    return index;
+}
+
+bool hzgl::BuildPointOctree(const std::string& inputPath, const std::string& outputPath, const PointBuildOptions& options, PointBuildStats* stats)
+{
+    HZGL_PROFILE_SCOPE("BuildPointOctree");
+
+    PointBuildStats result;
+    SimpleTimer totalTimer, timer;
+    totalTimer.Start();
+
+    PointSource source;
+    if (!hzglOpenPointSource(inputPath, source))
+        return false;
+
+    int threads = (options.threads > 0) ? options.threads : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    size_t budget = std::max<size_t>(options.memory_budget_mb, 64) * 1024 * 1024;
+
+    // a quarter of the budget for the input windows being decoded, the rest for the chunks
+    size_t unit = std::min<size_t>(std::max<size_t>(budget / (4 * threads), 1 << 20), 64 << 20);
+    int64_t chunkPoints = std::max<int64_t>(static_cast<int64_t>(budget / 2 / (threads * 2 * sizeof(PointVertex))), 4 * options.max_node_points);
+
+    std::vector<std::pair<size_t, size_t>> ranges = hzglPointRanges(source, unit);
+    ThreadPool pool(threads, static_cast<size_t>(threads), "Points");
+    std::mutex mutex;
+
+    // pass 1: bounds
+    timer.Start();
+
+    glm::dvec3 lo(std::numeric_limits<double>::max()), hi(-std::numeric_limits<double>::max());
+    int64_t numPoints = 0;
+    bool hasColors = false;
+
+    hzglForEachRange(source, ranges, pool, [&](const std::vector<InputPoint>& points, bool colored) {
+        glm::dvec3 rangeLo(std::numeric_limits<double>::max()), rangeHi(-std::numeric_limits<double>::max());
+
+        for (const auto& point : points)
+        {
+            glm::dvec3 p(point.position[0], point.position[1], point.position[2]);
+            rangeLo = glm::min(rangeLo, p);
+            rangeHi = glm::max(rangeHi, p);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        lo = glm::min(lo, rangeLo);
+        hi = glm::max(hi, rangeHi);
+        numPoints += static_cast<int64_t>(points.size());
+        hasColors = hasColors || colored;
+    });
+
+    if (numPoints == 0)
+    {
+        std::cerr << inputPath << " has no points" << std::endl;
+        return false;
+    }
+
+    result.input_points = numPoints;
+    result.has_colors = hasColors;
+
+    // a cube at the minimum, a little larger so that the maximum falls inside
+    glm::dvec3 extent = hi - lo;
+    float rootSize = static_cast<float>(std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-6)) * 1.0001);
+
+    // ... and points per cell of the counting grid
+    const int countGrid = 1 << hzglCountLevels;
+    std::vector<std::atomic<uint64_t>> counts(static_cast<size_t>(countGrid) * countGrid * countGrid);
+    for (auto& count : counts)
+        count.store(0, std::memory_order_relaxed);
+
+    auto countCell = [&](const InputPoint& point) {
+        glm::vec3 p(static_cast<float>(point.position[0] - lo.x), static_cast<float>(point.position[1] - lo.y), static_cast<float>(point.position[2] - lo.z));
+        glm::ivec3 c = glm::clamp(glm::ivec3(p * (countGrid / rootSize)), glm::ivec3(0), glm::ivec3(countGrid - 1));
+        return (static_cast<size_t>(c.z) * countGrid + c.y) * countGrid + c.x;
+    };
+
+    hzglForEachRange(source, ranges, pool, [&](const std::vector<InputPoint>& points, bool) {
+        for (const auto& point : points)
+            counts[countCell(point)].fetch_add(1, std::memory_order_relaxed);
+    });
+
+    result.scan_ms = 1000.0 * timer.End();
+
+    // chunks: the largest cells of the counting pyramid with at most chunkPoints points
+    std::vector<std::vector<uint64_t>> pyramid(hzglCountLevels + 1);
+    pyramid[hzglCountLevels].resize(counts.size());
+    for (size_t i = 0; i < counts.size(); i++)
+        pyramid[hzglCountLevels][i] = counts[i].load(std::memory_order_relaxed);
+
+    for (int level = hzglCountLevels - 1; level >= 0; level--)
+    {
+        int n = 1 << level;
+        pyramid[level].assign(static_cast<size_t>(n) * n * n, 0);
+
+        for (int z = 0; z < 2 * n; z++)
+            for (int y = 0; y < 2 * n; y++)
+                for (int x = 0; x < 2 * n; x++)
+                    pyramid[level][(static_cast<size_t>(z / 2) * n + y / 2) * n + x / 2] += pyramid[level + 1][(static_cast<size_t>(z) * 2 * n + y) * 2 * n + x];
+    }
+
+    typedef struct
+    {
+        int depth;
+        glm::ivec3 cell;
+        int64_t points;
+    } Chunk;
+
+    std::vector<Chunk> chunks;
+    std::vector<int> cellChunk(counts.size(), -1);
+    std::function<void(int, const glm::ivec3&)> split = [&](int depth, const glm::ivec3& cell) {
+        int n = 1 << depth;
+        uint64_t count = pyramid[depth][(static_cast<size_t>(cell.z) * n + cell.y) * n + cell.x];
+
+        if (count == 0)
+            return;
+
+        if (static_cast<int64_t>(count) > chunkPoints && depth < hzglCountLevels)
+        {
+            for (int k = 0; k < 8; k++)
+                split(depth + 1, 2 * cell + glm::ivec3(k & 1, (k >> 1) & 1, (k >> 2) & 1));
+
+            return;
+        }
+
+        // every counting cell inside belongs to this chunk
+        int span = 1 << (hzglCountLevels - depth);
+        for (int z = 0; z < span; z++)
+            for (int y = 0; y < span; y++)
+                for (int x = 0; x < span; x++)
+                {
+                    glm::ivec3 c = cell * span + glm::ivec3(x, y, z);
+                    cellChunk[(static_cast<size_t>(c.z) * countGrid + c.y) * countGrid + c.x] = static_cast<int>(chunks.size());
+                }
+
+        chunks.push_back({depth, cell, static_cast<int64_t>(count)});
+    };
+
+    split(0, glm::ivec3(0));
+    std::vector<std::atomic<uint64_t>>().swap(counts);
+
+    int numChunks = static_cast<int>(chunks.size());
+    result.chunks = numChunks;
+
+    // pass 2: every point to the range of its chunk in a scratch file
+    timer.Start();
+
+    std::vector<int64_t> chunkFirst(numChunks + 1, 0);
+    for (int c = 0; c < numChunks; c++)
+        chunkFirst[c + 1] = chunkFirst[c] + chunks[c].points;
+
+    std::string scratchPath = outputPath + ".scratch";
+    MappedFile scratch;
+
+    if (!scratch.Create(scratchPath, static_cast<size_t>(numPoints) * sizeof(PointVertex)))
+    {
+        std::cerr << "Failed to create " << scratchPath << std::endl;
+        return false;
+    }
+
+    std::vector<std::atomic<int64_t>> cursors(numChunks);
+    for (int c = 0; c < numChunks; c++)
+        cursors[c].store(chunkFirst[c], std::memory_order_relaxed);
+
+    PointVertex* scratchPoints = reinterpret_cast<PointVertex*>(scratch.MutableData());
+    std::atomic<size_t> written{0};
+    size_t window = budget / 4;
+
+    hzglForEachRange(source, ranges, pool, [&](const std::vector<InputPoint>& points, bool) {
+        for (const auto& point : points)
+        {
+            int chunk = cellChunk[countCell(point)];
+            int64_t slot = cursors[chunk].fetch_add(1, std::memory_order_relaxed);
+
+            // the counts were taken from the same points, but the file may have changed since
+            if (slot >= chunkFirst[chunk + 1])
+                continue;
+
+            PointVertex& vertex = scratchPoints[slot];
+            for (int k = 0; k < 3; k++)
+                vertex.position[k] = static_cast<float>(point.position[k] - lo[k]);
+            memcpy(vertex.color, point.color, sizeof(vertex.color));
+        }
+
+        // written pages go to the file in the background, only dropping them is up to us
+        if (written.fetch_add(points.size() * sizeof(PointVertex)) + points.size() * sizeof(PointVertex) >= window)
+        {
+            written.store(0);
+            scratch.Evict(0, scratch.Size());
+        }
+    });
+
+    scratch.Evict(0, scratch.Size());
+    source.file.Close();
+
+    result.scatter_ms = 1000.0 * timer.End();
+
+    // pass 3: the subtree of every chunk, written as it is done
+    timer.Start();
+
+    std::string tmppath = outputPath + ".tmp";
+    FILE* fp = fopen(tmppath.c_str(), "wb");
+
+    if (fp == nullptr)
+    {
+        std::cerr << "Failed to create " << tmppath << std::endl;
+        scratch.Close();
+        std::remove(scratchPath.c_str());
+        return false;
+    }
+
+    PointFileHeader header = {};
+    memcpy(header.magic, hzglPointMagic, sizeof(header.magic));
+    header.version = hzglPointVersion;
+    header.num_points = static_cast<uint64_t>(numPoints);
+    header.size = rootSize;
+    header.grid = static_cast<uint32_t>(std::max(options.grid, 2));
+    header.has_colors = hasColors ? 1 : 0;
+    for (int k = 0; k < 3; k++)
+    {
+        header.origin[k] = lo[k];
+        header.bounds_max[k] = static_cast<float>(hi[k] - lo[k]);
+    }
+
+    TreeParams params = {rootSize, static_cast<int>(header.grid), std::max(options.max_node_points, 256)};
+
+    // the table goes at the end, the header is written again once its offset is known
+    bool writeOk = fwrite(&header, sizeof(header), 1, fp) == 1;
+    uint64_t fileOffset = sizeof(header);
+    std::vector<std::vector<BuildNode>> subtrees(numChunks);
+
+    for (int c = 0; c < numChunks; c++)
+    {
+        pool.Submit([&, c]() {
+            HZGL_PROFILE_SCOPE("BuildPointChunk");
+
+            size_t first = static_cast<size_t>(chunkFirst[c]);
+            size_t count = static_cast<size_t>(chunkFirst[c + 1] - chunkFirst[c]);
+
+            std::vector<PointVertex> points(reinterpret_cast<const PointVertex*>(scratch.Data()) + first,
+                                            reinterpret_cast<const PointVertex*>(scratch.Data()) + first + count);
+            scratch.Evict(first * sizeof(PointVertex), count * sizeof(PointVertex));
+
+            // the same order on every run
+            std::mt19937 random(static_cast<uint32_t>(c));
+            std::shuffle(points.begin(), points.end(), random);
+
+            std::vector<BuildNode> nodes;
+            std::vector<uint8_t> blob;
+            std::vector<uint64_t> taken;
+            hzglBuildSubtree(points.data(), 0, points.size(), chunks[c].depth, chunks[c].cell, params, nodes, blob, taken);
+
+            std::vector<PointVertex>().swap(points);
+
+            std::lock_guard<std::mutex> lock(mutex);
+
+            for (size_t n = 1; n < nodes.size(); n++)
+                nodes[n].offset += fileOffset;
+
+            writeOk = writeOk && (blob.empty() || fwrite(blob.data(), 1, blob.size(), fp) == blob.size());
+            fileOffset += blob.size();
+            subtrees[c].swap(nodes);
+        });
+    }
+
+    pool.Wait();
+
+    scratch.Close();
+    std::remove(scratchPath.c_str());
+
+    // the levels above the chunks, bottom up: a node takes one point per cell of its grid from
+    // the points its children hold (which are already a sample), and they lose those
+    std::unordered_map<uint64_t, BuildNode*> top;       // chunk roots and the nodes above them, by depth and cell
+    std::vector<std::unique_ptr<BuildNode>> upper;
+    int chunkDepth = 0;
+
+    // nodes up here are no deeper than the counting grid, their cells take 7 bits per axis
+    auto topKey = [](int depth, uint64_t key) { return key * 32 + static_cast<uint64_t>(depth); };
+
+    for (int c = 0; c < numChunks; c++)
+    {
+        top[topKey(chunks[c].depth, subtrees[c][0].key)] = &subtrees[c][0];
+        chunkDepth = std::max(chunkDepth, chunks[c].depth);
+    }
+
+    // the points of a node up here go to the file once nothing is taken from them any more
+    auto writeTop = [&](BuildNode& node) {
+        node.offset = fileOffset;
+        node.num_points = static_cast<uint32_t>(node.points.size());
+
+        size_t bytes = node.points.size() * sizeof(PointVertex);
+        writeOk = writeOk && (bytes == 0 || fwrite(node.points.data(), 1, bytes, fp) == bytes);
+        fileOffset += bytes;
+
+        std::vector<PointVertex>().swap(node.points);
+    };
+
+    std::vector<uint64_t> taken;
+
+    for (int depth = chunkDepth - 1; depth >= 0; depth--)
+    {
+        // parents of the nodes one level down that do not exist yet
+        std::vector<std::pair<uint64_t, BuildNode*>> level;
+        for (const auto& entry : top)
+        {
+            if (entry.second->depth == depth + 1)
+                level.push_back(entry);
+        }
+
+        for (const auto& entry : level)
+        {
+            glm::ivec3 cell = hzglNodeCell(entry.second->key) / 2;
+            uint64_t parentKey = topKey(depth, hzglNodeKey(cell));
+
+            if (top.count(parentKey) == 0)
+            {
+                upper.emplace_back(new BuildNode());
+                upper.back()->depth = depth;
+                upper.back()->key = hzglNodeKey(cell);
+                top[parentKey] = upper.back().get();
+            }
+        }
+
+        for (auto& node : upper)
+        {
+            if (node->depth != depth)
+                continue;
+
+            glm::ivec3 cell = hzglNodeCell(node->key);
+            float size = rootSize / static_cast<float>(1u << depth);
+            glm::vec3 nodeLo = glm::vec3(cell) * size;
+
+            taken.assign((static_cast<size_t>(params.grid) * params.grid * params.grid + 63) / 64, 0);
+
+            for (int k = 0; k < 8; k++)
+            {
+                auto child = top.find(topKey(depth + 1, hzglNodeKey(2 * cell + glm::ivec3(k & 1, (k >> 1) & 1, (k >> 2) & 1))));
+                if (child == top.end())
+                    continue;
+
+                // the grid cells of the node each lie in one child, so taking the children in
+                // turn does not favour any of them
+                std::vector<PointVertex>& points = child->second->points;
+                size_t kept = 0;
+
+                for (size_t i = 0; i < points.size(); i++)
+                {
+                    glm::vec3 p(points[i].position[0], points[i].position[1], points[i].position[2]);
+                    glm::ivec3 c = glm::clamp(glm::ivec3((p - nodeLo) * (params.grid / size)), glm::ivec3(0), glm::ivec3(params.grid - 1));
+                    size_t bit = (static_cast<size_t>(c.z) * params.grid + c.y) * params.grid + c.x;
+
+                    if (taken[bit / 64] & (1ull << (bit % 64)))
+                        points[kept++] = points[i];
+                    else
+                    {
+                        taken[bit / 64] |= 1ull << (bit % 64);
+                        node->points.push_back(points[i]);
+                    }
+                }
+
+                points.resize(kept);
+            }
+        }
+
+        // the level below has given up its points
+        for (auto& entry : level)
+            writeTop(*entry.second);
+    }
+
+    // and the root, which nothing samples from
+    for (auto& entry : top)
+    {
+        if (entry.second->depth == 0)
+            writeTop(*entry.second);
+    }
+
+    // global indices: the nodes kept in memory first (root at 0), then the rest of every subtree
+    std::vector<BuildNode*> ordered;
+    for (auto& entry : top)
+        ordered.push_back(entry.second);
+
+    std::sort(ordered.begin(), ordered.end(), [](const BuildNode* a, const BuildNode* b) {
+        return a->depth != b->depth ? a->depth < b->depth : a->key < b->key;
+    });
+
+    std::unordered_map<const BuildNode*, int> topIndex;
+    for (size_t i = 0; i < ordered.size(); i++)
+        topIndex[ordered[i]] = static_cast<int>(i);
+
+    std::vector<int> subtreeBase(numChunks, 0);
+    int64_t numNodes = static_cast<int64_t>(ordered.size());
+
+    for (int c = 0; c < numChunks; c++)
+    {
+        subtreeBase[c] = static_cast<int>(numNodes) - 1;     // the local root is not part of it
+        numNodes += static_cast<int64_t>(subtrees[c].size()) - 1;
+    }
+
+    std::vector<PointNodeRecord> records(static_cast<size_t>(numNodes));
+
+    auto fillRecord = [&](PointNodeRecord& record, const BuildNode& node) {
+        float size = rootSize / static_cast<float>(1u << node.depth);
+        glm::ivec3 cell = hzglNodeCell(node.key);
+
+        record.offset = node.offset;
+        record.num_points = node.num_points;
+        record.depth = static_cast<uint32_t>(node.depth);
+        for (int k = 0; k < 3; k++)
+            record.min[k] = cell[k] * size;
+        for (int k = 0; k < 8; k++)
+            record.children[k] = -1;
+
+        result.max_depth = std::max(result.max_depth, node.depth);
+    };
+
+    for (size_t i = 0; i < ordered.size(); i++)
+    {
+        const BuildNode& node = *ordered[i];
+
+        fillRecord(records[i], node);
+
+        for (int k = 0; k < 8; k++)
+        {
+            auto child = top.find(topKey(node.depth + 1, hzglNodeKey(2 * hzglNodeCell(node.key) + glm::ivec3(k & 1, (k >> 1) & 1, (k >> 2) & 1))));
+            if (child != top.end())
+                records[i].children[k] = topIndex[child->second];
+        }
+    }
+
+    // chunk roots point into their subtrees
+    for (int c = 0; c < numChunks; c++)
+    {
+        const std::vector<BuildNode>& nodes = subtrees[c];
+        int root = topIndex[&subtrees[c][0]];
+
+        for (size_t n = 0; n < nodes.size(); n++)
+        {
+            int index = (n == 0) ? root : subtreeBase[c] + static_cast<int>(n);
+
+            if (n > 0)
+                fillRecord(records[index], nodes[n]);
+
+            for (int k = 0; k < 8; k++)
+            {
+                if (nodes[n].children[k] >= 0)
+                    records[index].children[k] = subtreeBase[c] + nodes[n].children[k];
+            }
+        }
+    }
+
+    header.num_nodes = static_cast<uint32_t>(numNodes);
+    header.table_offset = fileOffset;
+
+    writeOk = writeOk && fwrite(records.data(), sizeof(PointNodeRecord), records.size(), fp) == records.size();
+    writeOk = writeOk && fseek(fp, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, fp) == 1;
+    writeOk = (fclose(fp) == 0) && writeOk;
+
+    // readers never see half a file
+    std::remove(outputPath.c_str());
+    if (!writeOk || std::rename(tmppath.c_str(), outputPath.c_str()) != 0)
+    {
+        std::cerr << "Failed to write " << outputPath << std::endl;
+        std::remove(tmppath.c_str());
+        return false;
+    }
+
+    result.nodes = numNodes;
+    result.output_bytes = static_cast<int64_t>(fileOffset + records.size() * sizeof(PointNodeRecord));
+    result.build_ms = 1000.0 * timer.End();
+    result.total_ms = 1000.0 * totalTimer.End();
+    result.peak_rss_mb = GetProcessMemory().peak_resident_bytes / (1024.0 * 1024.0);
+
+    if (stats != nullptr)
+        *stats = result;
+
+    return true;
+}
+
+//
+// rendering
+//
+
+hzgl::PointCloud::PointCloud()
+    : _header(), _frame(0), _readMs(0.0), _reads(0), _program(0), _model(1.0f), _pixelsPerUnit(1.0f)
+{
+}
+
+hzgl::PointCloud::~PointCloud()
+{
+    // GL objects are deleted in Release(), the context may be gone by now; the transfers still
+    // write into this object
+    if (_io != nullptr)
+        _io->Wait();
+}
+
+bool hzgl::PointCloud::Init(const std::string& shaderDir)
+{
+    _program = CreateShaderProgram({
+        {GL_VERTEX_SHADER, shaderDir + "/points.vert"},
+        {GL_FRAGMENT_SHADER, shaderDir + "/points.frag"},
+    });
+
+    GLint linkStatus = GL_FALSE;
+    glGetProgramiv(_program, GL_LINK_STATUS, &linkStatus);
+
+    if (linkStatus != GL_TRUE)
+    {
+        std::cerr << "Failed to build the point cloud program." << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool hzgl::PointCloud::Open(const std::string& filepath, const PointCloudOptions& options)
+{
+    HZGL_PROFILE_SCOPE("PointCloud::Open");
+
+    unload();
+
+    if (!_file.Open(filepath) || _file.Size() < sizeof(PointFileHeader))
+    {
+        std::cerr << "Failed to open " << filepath << std::endl;
+        _file.Close();
+        return false;
+    }
+
+    memcpy(&_header, _file.Data(), sizeof(_header));
+
+    if (memcmp(_header.magic, hzglPointMagic, sizeof(hzglPointMagic)) != 0 || _header.version != hzglPointVersion || _header.num_nodes == 0
+        || _header.table_offset + static_cast<uint64_t>(_header.num_nodes) * sizeof(PointNodeRecord) > _file.Size())
+    {
+        std::cerr << filepath << " is not a point octree (see --preprocess-points)" << std::endl;
+        _file.Close();
+        return false;
+    }
+
+    _records.resize(_header.num_nodes);
+    memcpy(_records.data(), _file.Data() + _header.table_offset, _records.size() * sizeof(PointNodeRecord));
+    _file.Evict(_header.table_offset, _records.size() * sizeof(PointNodeRecord));
+
+    // nodes that point outside the file (or at nodes that do not exist) are left out
+    for (auto& record : _records)
+    {
+        if (record.offset + static_cast<uint64_t>(record.num_points) * sizeof(PointVertex) > _header.table_offset)
+            record.num_points = 0;
+
+        for (int k = 0; k < 8; k++)
+        {
+            if (record.children[k] >= static_cast<int32_t>(_records.size()) || record.children[k] == 0)
+                record.children[k] = -1;
+        }
+    }
+
+    _nodes.assign(_records.size(), Node());
+    _path = filepath;
+    _options = options;
+    _stats = PointCloudStats();
+    _stats.nodes = static_cast<int>(_records.size());
+    _frame = 0;
+    _readMs = 0.0;
+    _reads = 0;
+
+    _io.reset(new ThreadPool(std::max(1, options.io_threads), 0, "PointStreaming"));
+
+    std::cout << "Point cloud " << filepath << ": " << _header.num_points << " points in " << _header.num_nodes << " nodes" << std::endl;
+
+    return true;
+}
+
+bool hzgl::PointCloud::IsOpen() const
+{
+    return _file.IsOpen();
+}
+
+glm::vec3 hzgl::PointCloud::Center() const
+{
+    return 0.5f * glm::vec3(_header.bounds_max[0], _header.bounds_max[1], _header.bounds_max[2]);
+}
+
+float hzgl::PointCloud::Radius() const
+{
+    return std::max(0.5f * glm::length(glm::vec3(_header.bounds_max[0], _header.bounds_max[1], _header.bounds_max[2])), 1e-6f);
+}
+
+hzgl::PointCloudOptions& hzgl::PointCloud::Options()
+{
+    return _options;
+}
+
+size_t hzgl::PointCloud::nodeBytes(int node) const
+{
+    return static_cast<size_t>(_records[node].num_points) * sizeof(PointVertex);
+}
+
+void hzgl::PointCloud::releaseNode(Node& node)
+{
+    if (node.buffer != 0)
+    {
+        _stats.gpu_bytes -= nodeBytes(static_cast<int>(&node - _nodes.data()));
+        UntrackGpuResource(HZGL_GPU_BUFFER, node.buffer);
+        glDeleteBuffers(1, &node.buffer);
+    }
+
+    if (node.VAO != 0)
+        glDeleteVertexArrays(1, &node.VAO);
+
+    node.buffer = 0;
+    node.VAO = 0;
+    node.resident = false;
+}
+
+void hzgl::PointCloud::startTransfer(int n)
+{
+    Node& node = _nodes[n];
+    size_t bytes = nodeBytes(n);
+
+    // the I/O thread writes straight into the buffer, the driver gets it on unmap
+    glGenBuffers(1, &node.loadBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, node.loadBuffer);
+    glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STATIC_DRAW);
+    void* target = glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (target == nullptr)
+    {
+        glDeleteBuffers(1, &node.loadBuffer);
+        node.loadBuffer = 0;
+        return;
+    }
+
+    node.loading = true;
+
+    _stats.in_flight += 1;
+    _stats.in_flight_bytes += bytes;
+
+    size_t offset = static_cast<size_t>(_records[n].offset);
+
+    _io->Submit([this, n, target, offset, bytes]() {
+        HZGL_PROFILE_SCOPE("StreamPoints");
+
+        SimpleTimer timer;
+        timer.Start();
+
+        _file.Prefetch(offset, bytes);
+        memcpy(target, _file.Data() + offset, bytes);
+        _file.Evict(offset, bytes);
+
+        Transfer transfer = {n, 1000.0 * timer.End()};
+
+        std::lock_guard<std::mutex> lock(_doneMutex);
+        _done.push_back(transfer);
+    });
+}
+
+void hzgl::PointCloud::finishTransfers()
+{
+    {
+        std::lock_guard<std::mutex> lock(_doneMutex);
+        _finished.swap(_done);
+    }
+
+    for (const Transfer& transfer : _finished)
+    {
+        Node& node = _nodes[transfer.node];
+        size_t bytes = nodeBytes(transfer.node);
+
+        glBindBuffer(GL_ARRAY_BUFFER, node.loadBuffer);
+        bool ok = glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE;
+
+        _stats.in_flight -= 1;
+        _stats.in_flight_bytes -= bytes;
+        _readMs += transfer.ms;
+        _reads += 1;
+        node.loading = false;
+
+        // the contents are undefined after a failed unmap: asked for again
+        if (!ok)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glDeleteBuffers(1, &node.loadBuffer);
+            node.loadBuffer = 0;
+            continue;
+        }
+
+        glGenVertexArrays(1, &node.VAO);
+        glBindVertexArray(node.VAO);
+
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PointVertex), (void*)(0));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PointVertex), (void*)(offsetof(PointVertex, color)));
+        glEnableVertexAttribArray(1);
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        node.buffer = node.loadBuffer;
+        node.loadBuffer = 0;
+        node.resident = true;
+
+        _stats.gpu_bytes += bytes;
+        _stats.loads += 1;
+
+        TrackGpuResource({HZGL_GPU_BUFFER, node.buffer, bytes, "PointCloud", _path, "node " + std::to_string(transfer.node)});
+    }
+
+    _finished.clear();
+
+    _stats.read_ms = (_reads > 0) ? _readMs / _reads : 0.0;
+}
+
+void hzgl::PointCloud::Update(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, int viewportHeight)
+{
+    if (!IsOpen())
+        return;
+
+    HZGL_PROFILE_SCOPE("PointCloud::Update");
+
+    SimpleTimer timer;
+    timer.Start();
+
+    finishTransfers();
+
+    _frame += 1;
+    _model = model;
+
+    // the nodes drawn in one frame must fit, whatever the point budget was set to since
+    _options.gpu_budget_mb = std::max(_options.gpu_budget_mb, static_cast<size_t>(_options.point_budget) * sizeof(PointVertex) / (1024 * 1024) + 16);
+    _pixelsPerUnit = 0.5f * viewportHeight * projection[1][1];
+
+    // everything in the space of the file: the eye, and the frustum planes of the combined matrix
+    glm::mat4 modelView = view * model;
+    glm::vec3 eye = glm::vec3(glm::inverse(modelView) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    glm::mat4 clip = projection * modelView;
+
+    glm::vec4 planes[6];
+    for (int i = 0; i < 3; i++)
+    {
+        planes[2 * i] = glm::vec4(clip[0][3] + clip[0][i], clip[1][3] + clip[1][i], clip[2][3] + clip[2][i], clip[3][3] + clip[3][i]);
+        planes[2 * i + 1] = glm::vec4(clip[0][3] - clip[0][i], clip[1][3] - clip[1][i], clip[2][3] - clip[2][i], clip[3][3] - clip[3][i]);
+    }
+
+    // object-space units per world unit do not matter: the ratio of a size to a distance is the
+    // same in both (for a uniform scale)
+    auto priority = [&](int n, float* spacingPixels) {
+        const PointNodeRecord& record = _records[n];
+        float size = _header.size / static_cast<float>(1u << record.depth);
+        glm::vec3 lo(record.min[0], record.min[1], record.min[2]);
+        glm::vec3 hi = lo + glm::vec3(size);
+
+        for (int p = 0; p < 6; p++)
+        {
+            glm::vec3 corner(planes[p].x >= 0.0f ? hi.x : lo.x, planes[p].y >= 0.0f ? hi.y : lo.y, planes[p].z >= 0.0f ? hi.z : lo.z);
+            if (glm::dot(glm::vec3(planes[p]), corner) + planes[p].w < 0.0f)
+                return -1.0f;
+        }
+
+        float distance = std::max(glm::length(glm::max(glm::max(lo - eye, eye - hi), glm::vec3(0.0f))), 1e-6f * _header.size);
+
+        *spacingPixels = size / _header.grid * _pixelsPerUnit / distance;
+        return size * _pixelsPerUnit / distance;
+    };
+
+    // nodes in order of their size on screen, from the root down while they are resident, until
+    // the points are close enough or the budget is spent
+    for (int n : _selected)
+        _nodes[n].selected = false;
+
+    _selected.clear();
+    _queue.clear();
+
+    std::vector<int> wanted;        // not resident yet, most important first
+    int64_t points = 0;
+    float spacing = 0.0f;
+
+    _stats.budget_limited = false;
+
+    if (priority(0, &spacing) >= 0.0f)
+        _queue.push_back({priority(0, &spacing), 0});
+
+    while (!_queue.empty())
+    {
+        std::pop_heap(_queue.begin(), _queue.end());
+        int n = _queue.back().second;
+        _queue.pop_back();
+
+        if (points + _records[n].num_points > _options.point_budget)
+        {
+            _stats.budget_limited = true;
+            break;
+        }
+
+        Node& node = _nodes[n];
+        node.lastUsed = _frame;
+
+        // a node whose points all went up has nothing to load, but its children still count
+        if (!node.resident && _records[n].num_points > 0)
+        {
+            if (!node.loading)
+                wanted.push_back(n);
+
+            continue;
+        }
+
+        node.selected = true;
+        _selected.push_back(n);
+        points += _records[n].num_points;
+
+        priority(n, &spacing);
+        if (spacing <= _options.min_spacing)
+            continue;
+
+        for (int k = 0; k < 8; k++)
+        {
+            int child = _records[n].children[k];
+            float childPriority = (child >= 0) ? priority(child, &spacing) : -1.0f;
+
+            if (childPriority >= 0.0f)
+            {
+                _queue.push_back({childPriority, child});
+                std::push_heap(_queue.begin(), _queue.end());
+            }
+        }
+    }
+
+    // splat sizes: a node whose children are all drawn is covered at least as densely as the
+    // coarsest of them; children come after their parents in the selection
+    for (size_t i = _selected.size(); i-- > 0;)
+    {
+        int n = _selected[i];
+        int depth = std::numeric_limits<int>::max();
+        bool covered = false;
+
+        for (int k = 0; k < 8; k++)
+        {
+            int child = _records[n].children[k];
+            if (child < 0)
+                continue;
+
+            if (!_nodes[child].selected)
+            {
+                covered = false;
+                break;
+            }
+
+            covered = true;
+            depth = std::min(depth, _nodes[child].drawDepth);
+        }
+
+        _nodes[n].drawDepth = covered ? depth : static_cast<int>(_records[n].depth);
+    }
+
+    // room is made for each transfer as it is issued, counting the ones in flight: the nodes used
+    // longest ago go first, never the ones of this frame
+    size_t gpuBudget = _options.gpu_budget_mb * 1024 * 1024;
+    size_t cpuBudget = _options.cpu_budget_mb * 1024 * 1024;
+    size_t uploadBudget = _options.upload_mb_per_frame * 1024 * 1024;
+    size_t reserved = _stats.gpu_bytes + _stats.in_flight_bytes;
+    size_t submitted = 0;
+
+    _evictable.clear();
+    size_t nextEvictable = 0;
+    bool listed = false;
+
+    for (int n : wanted)
+    {
+        size_t bytes = nodeBytes(n);
+
+        // at least one transfer is always allowed, so a node larger than the budgets still comes in
+        bool idle = (_stats.in_flight == 0 && submitted == 0);
+
+        if (!idle && (_stats.in_flight_bytes + bytes > cpuBudget || submitted + bytes > uploadBudget))
+            break;
+
+        if (reserved + bytes > gpuBudget && !listed)
+        {
+            for (size_t k = 0; k < _nodes.size(); k++)
+            {
+                if (_nodes[k].resident && _nodes[k].lastUsed < _frame)
+                    _evictable.push_back(static_cast<int>(k));
+            }
+
+            std::sort(_evictable.begin(), _evictable.end(), [this](int a, int b) { return _nodes[a].lastUsed < _nodes[b].lastUsed; });
+            listed = true;
+        }
+
+        while (reserved + bytes > gpuBudget && nextEvictable < _evictable.size())
+        {
+            int old = _evictable[nextEvictable++];
+
+            reserved -= nodeBytes(old);
+            releaseNode(_nodes[old]);
+            _stats.evictions += 1;
+        }
+
+        if (!idle && reserved + bytes > gpuBudget)
+            break;
+
+        startTransfer(n);
+        reserved += bytes;
+        submitted += bytes;
+    }
+
+    _stats.resident = 0;
+    for (const auto& node : _nodes)
+        _stats.resident += node.resident ? 1 : 0;
+
+    _stats.update_ms = 1000.0 * timer.End();
+}
+
+void hzgl::PointCloud::Draw(const glm::mat4& view, const glm::mat4& projection)
+{
+    if (!IsOpen() || _program == 0)
+        return;
+
+    HZGL_PROFILE_SCOPE("PointCloud::Draw");
+
+    _stats.drawn = 0;
+    _stats.drawn_points = 0;
+
+    // spacing is given in world units
+    float modelScale = glm::length(glm::vec3(_model[0]));
+
+    glUseProgram(_program);
+    hzgl::SetMatrixv(_program, "Model", 4, &_model[0][0]);
+    hzgl::SetMatrixv(_program, "View", 4, const_cast<float*>(&view[0][0]));
+    hzgl::SetMatrixv(_program, "Projection", 4, const_cast<float*>(&projection[0][0]));
+    hzgl::SetFloat(_program, "uPixelsPerUnit", 1, _pixelsPerUnit * _options.point_scale);
+    hzgl::SetFloat(_program, "uMaxPointSize", 1, _options.max_point_size);
+
+    GLint spacingLocation = glGetUniformLocation(_program, "uSpacing");
+
+    glEnable(GL_PROGRAM_POINT_SIZE);
+
+    for (int n : _selected)
+    {
+        const Node& node = _nodes[n];
+
+        if (!node.resident)
+            continue;
+
+        glUniform1f(spacingLocation, modelScale * _header.size / static_cast<float>(1u << node.drawDepth) / _header.grid);
+
+        glBindVertexArray(node.VAO);
+        glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(_records[n].num_points));
+
+        _stats.drawn += 1;
+        _stats.drawn_points += _records[n].num_points;
+    }
+
+    glDisable(GL_PROGRAM_POINT_SIZE);
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
+
+const hzgl::PointCloudStats& hzgl::PointCloud::Stats() const
+{
+    return _stats;
+}
+
+const std::string& hzgl::PointCloud::Path() const
+{
+    return _path;
+}
+
+void hzgl::PointCloud::unload()
+{
+    if (_io != nullptr)
+    {
+        _io->Wait();
+        finishTransfers();
+    }
+
+    for (auto& node : _nodes)
+        releaseNode(node);
+
+    _nodes.clear();
+    _records.clear();
+    _selected.clear();
+    _stats = PointCloudStats();
+    _file.Close();
+}
+
+void hzgl::PointCloud::Release()
+{
+    unload();
+
+    if (_program != 0)
+        glDeleteProgram(_program);
+
+    _program = 0;
+}
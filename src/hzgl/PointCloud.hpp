@@ -0,0 +1,199 @@
+#pragma once
+
+#include "MappedFile.hpp"
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+namespace hzgl
+{
+    class ThreadPool;
+
+    // .hzpoints: a header, the points of every octree node one node after another, then the node
+    // table. A node keeps at most one point per cell of a grid over its cube and passes the rest
+    // down, so drawing a node and its ancestors gives all of the points in it
+    typedef struct
+    {
+        char magic[8];                  // "HZPOINT1"
+        uint32_t version;
+        uint32_t num_nodes;             // node 0 is the root
+        uint64_t num_points;
+        uint64_t table_offset;
+        double origin[3];               // the points are stored relative to it
+        float size;                     // edge of the root cube, which starts at the origin
+        uint32_t grid;                  // sampling cells per side of a node
+        float bounds_max[3];            // of the points, relative to the origin
+        uint32_t has_colors;
+    } PointFileHeader;
+
+    typedef struct
+    {
+        uint64_t offset;
+        uint32_t num_points;
+        uint32_t depth;
+        int32_t children[8];            // octant k (x: bit 0, y: bit 1, z: bit 2), -1: none
+        float min[3];                   // corner of the cube, relative to the origin
+        uint32_t reserved;
+    } PointNodeRecord;
+
+    // read by the point shaders as a vec3 and a normalized vec4
+    typedef struct
+    {
+        float position[3];
+        uint8_t color[4];
+    } PointVertex;
+
+    typedef struct
+    {
+        int max_node_points = 20000;        // nodes with more get children
+        int grid = 128;                     // sampling cells per side of a node
+        size_t memory_budget_mb = 1024;     // input, scratch and chunks in memory at once
+        int threads = 0;                    // 0: one per core
+    } PointBuildOptions;
+
+    typedef struct
+    {
+        int64_t input_points = 0;
+        int64_t nodes = 0;
+        int max_depth = 0;
+        int chunks = 0;                     // subtrees built independently
+        int64_t output_bytes = 0;
+        bool has_colors = false;
+        double scan_ms = 0.0;               // bounds and counts per cell
+        double scatter_ms = 0.0;            // points to the scratch file, by chunk
+        double build_ms = 0.0;              // subtrees, the levels above them and writing
+        double total_ms = 0.0;
+        double peak_rss_mb = 0.0;
+    } PointBuildStats;
+
+    // build a .hzpoints file from a binary PLY (a vertex element with x, y, z and optionally red,
+    // green, blue) or an XYZ text file ("x y z [r g b]" per line, colors 0-255). The input is
+    // read through a mapping in parallel windows and never held in memory as a whole
+    bool BuildPointOctree(const std::string& inputPath, const std::string& outputPath,
+                          const PointBuildOptions& options = PointBuildOptions(), PointBuildStats* stats = nullptr);
+
+    typedef struct
+    {
+        int64_t point_budget = 10000000;    // drawn per frame
+        float min_spacing = 1.0f;           // pixels between points at which children are no longer needed
+        float point_scale = 1.5f;           // splat size over the spacing of its node on screen
+        float max_point_size = 32.0f;       // pixels
+        size_t gpu_budget_mb = 512;         // resident nodes and those in flight, raised to hold the point budget
+        size_t cpu_budget_mb = 64;          // transfers in flight
+        size_t upload_mb_per_frame = 64;
+        int io_threads = 2;
+    } PointCloudOptions;
+
+    typedef struct
+    {
+        int nodes = 0;
+        int resident = 0;
+        int drawn = 0;                      // nodes, by the last Draw()
+        int in_flight = 0;
+        int64_t drawn_points = 0;
+        size_t gpu_bytes = 0;
+        size_t in_flight_bytes = 0;
+        int64_t loads = 0;                  // since Open()
+        int64_t evictions = 0;
+        bool budget_limited = false;        // the point budget stopped the last selection
+        double read_ms = 0.0;               // mean time of a transfer on the I/O threads
+        double update_ms = 0.0;             // last Update() on the render thread
+    } PointCloudStats;
+
+    // draws a .hzpoints file of any size: every Update() walks the octree from the nodes that
+    // cover most of the screen, down to where the points are min_spacing pixels apart or the point
+    // budget is spent, and loads the nodes it reaches (as MeshStreamer does for mesh chunks).
+    // Points are round splats sized to the spacing of the finest level drawn around them
+    class PointCloud
+    {
+    private:
+        typedef struct
+        {
+            GLuint VAO = 0;
+            GLuint buffer = 0;
+            bool resident = false;
+
+            bool loading = false;
+            GLuint loadBuffer = 0;
+
+            int64_t lastUsed = -1;      // frame of the last selection
+            bool selected = false;
+            int drawDepth = 0;          // the splat size of the node follows this level
+        } Node;
+
+        typedef struct
+        {
+            int node;
+            double ms;
+        } Transfer;
+
+        MappedFile _file;
+        PointFileHeader _header;
+        std::vector<PointNodeRecord> _records;
+        std::vector<Node> _nodes;
+        std::vector<int> _selected;                 // in the order they were reached
+        std::vector<std::pair<float, int>> _queue;  // scratch for Update()
+        std::vector<int> _evictable;                // resident, not used this frame, oldest first
+        std::string _path;
+
+        PointCloudOptions _options;
+        PointCloudStats _stats;
+        int64_t _frame;
+        double _readMs;
+        int64_t _reads;
+
+        GLuint _program;
+        glm::mat4 _model;
+        float _pixelsPerUnit;       // at a distance of 1, for the last Update()
+
+        std::mutex _doneMutex;
+        std::vector<Transfer> _done;                // filled by the I/O threads
+        std::vector<Transfer> _finished;
+
+        // last, so that its threads are joined before anything they touch is destroyed
+        std::unique_ptr<ThreadPool> _io;
+
+        size_t nodeBytes(int node) const;
+        void finishTransfers();
+        void startTransfer(int node);
+        void releaseNode(Node& node);
+        void unload();
+
+    public:
+        PointCloud();
+        ~PointCloud();
+
+        PointCloud(const PointCloud&) = delete;
+        PointCloud& operator=(const PointCloud&) = delete;
+
+        // the splat program, needed before Draw()
+        bool Init(const std::string& shaderDir);
+
+        bool Open(const std::string& filepath, const PointCloudOptions& options = PointCloudOptions());
+        bool IsOpen() const;
+
+        // of the points in the space of the file (relative to the origin), to frame them
+        glm::vec3 Center() const;
+        float Radius() const;
+
+        PointCloudOptions& Options();
+
+        // pick the nodes for a view and move data; viewportHeight in pixels
+        void Update(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, int viewportHeight);
+
+        // the selected resident nodes, with the splat program
+        void Draw(const glm::mat4& view, const glm::mat4& projection);
+
+        const PointCloudStats& Stats() const;
+        const std::string& Path() const;
+
+        // wait for the transfers and delete the GL objects (needs the context that created them)
+        void Release();
+    };
+} // namespace hzgl
@@ -0,0 +1,465 @@
+#include "Profiler.hpp"
+#include "Memory.hpp"
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <cstdio>
+#include <iostream>
+#include <algorithm>
+
+#include <glad/glad.h>
+
+#define HZGL_LOG_ERROR(msg) \
+    fprintf(stderr, "[ERROR] %s (line %d): %s\n", __FILE__, __LINE__, msg);
+
+static const uint64_t HZGL_RING_CAPACITY = 1 << 14; // events per thread (power of two)
+static const int HZGL_GPU_LATENCY = 4;              // frames between issuing and reading queries
+static const int HZGL_HISTORY_FRAMES = 240;         // frames kept for the panel and trace export
+static const int HZGL_GPU_RESYNC_INTERVAL = 256;    // frames between GPU/CPU clock re-syncs
+static const uint32_t HZGL_GPU_THREAD_ID = 1000;    // pseudo thread used for GPU events in traces
+
+// single-producer/single-consumer ring: the owning thread pushes, ProfilerEndFrame() drains
+typedef struct _hzglProfileRing
+{
+    std::unique_ptr<hzgl::ProfileEvent[]> events;
+    std::atomic<uint64_t> head{0};
+    std::atomic<uint64_t> tail{0};
+    std::atomic<uint64_t> dropped{0};
+    uint32_t thread_id = 0;
+    std::string name;
+} hzglProfileRing;
+
+typedef struct
+{
+    const char* name;
+    uint32_t depth;
+    GLuint begin_query;
+    GLuint end_query;
+} hzglGpuMarker;
+
+typedef struct
+{
+    uint64_t frame = 0;
+    bool pending = false;
+    size_t num_used = 0;
+    std::vector<GLuint> queries;
+    std::vector<hzglGpuMarker> markers;
+} hzglGpuSlot;
+
+static const std::chrono::steady_clock::time_point g_epoch = std::chrono::steady_clock::now();
+
+// the mutex only guards registration and draining, never the recording path
+static std::mutex g_ringsMutex;
+static std::vector<std::unique_ptr<hzglProfileRing>> g_rings;
+static thread_local hzglProfileRing* t_ring = nullptr;
+static thread_local uint32_t t_depth = 0;
+
+static bool g_inFrame = false;
+static uint64_t g_frameIndex = 0;
+static uint64_t g_frameStart = 0;
+static bool g_firstFrameStarted = false;
+static hzgl::ProfileFrame g_history[HZGL_HISTORY_FRAMES];
+static std::vector<hzgl::ProfileEvent> g_startupEvents;
+static const hzgl::ProfileFrame* g_latestFrame = nullptr;
+
+static bool g_gpuEnabled = false;
+static int64_t g_gpuOffset = 0;
+static uint32_t g_gpuDepth = 0;
+static hzglGpuSlot g_gpuSlots[HZGL_GPU_LATENCY];
+
+static hzglProfileRing* hzglThreadRing()
+{
+    if (t_ring != nullptr)
+        return t_ring;
+
+    std::unique_ptr<hzglProfileRing> ring(new hzglProfileRing());
+    ring->events.reset(new hzgl::ProfileEvent[HZGL_RING_CAPACITY]);
+
+    std::lock_guard<std::mutex> lock(g_ringsMutex);
+    ring->thread_id = static_cast<uint32_t>(g_rings.size());
+    ring->name = "Thread " + std::to_string(ring->thread_id);
+
+    t_ring = ring.get();
+    g_rings.push_back(std::move(ring));
+
+    return t_ring;
+}
+
+static void hzglPushEvent(hzglProfileRing* ring, const hzgl::ProfileEvent& event)
+{
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+
+    // drop the event instead of blocking when the consumer falls behind
+    if (head - ring->tail.load(std::memory_order_acquire) >= HZGL_RING_CAPACITY)
+    {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    ring->events[head & (HZGL_RING_CAPACITY - 1)] = event;
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+static void hzglDrainRings(std::vector<hzgl::ProfileEvent>& events)
+{
+    std::lock_guard<std::mutex> lock(g_ringsMutex);
+
+    for (auto& ring : g_rings)
+    {
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+
+        for (uint64_t i = tail; i < head; i++)
+            events.push_back(ring->events[i & (HZGL_RING_CAPACITY - 1)]);
+
+        ring->tail.store(head, std::memory_order_release);
+    }
+}
+
+static bool hzglEarlierStart(const hzgl::ProfileEvent& a, const hzgl::ProfileEvent& b)
+{
+    if (a.start_ns != b.start_ns)
+        return a.start_ns < b.start_ns;
+
+    return a.depth < b.depth;
+}
+
+static void hzglSyncGpuClock()
+{
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    g_gpuOffset = static_cast<int64_t>(gpuNow) - static_cast<int64_t>(hzgl::ProfilerNow());
+}
+
+// read back a slot issued HZGL_GPU_LATENCY - 1 frames ago, dropping it if not ready yet
+static void hzglCollectGpuSlot(hzglGpuSlot& slot)
+{
+    if (!slot.pending)
+        return;
+
+    slot.pending = false;
+
+    hzgl::ProfileFrame& frame = g_history[slot.frame % HZGL_HISTORY_FRAMES];
+    bool frameValid = (frame.index == slot.frame);
+
+    GLuint available = GL_TRUE;
+    if (!slot.markers.empty())
+        glGetQueryObjectuiv(slot.markers.back().end_query, GL_QUERY_RESULT_AVAILABLE, &available);
+
+    if (frameValid)
+    {
+        frame.gpu_events.clear();
+        frame.gpu_ready = true;
+    }
+
+    if (available == GL_TRUE && frameValid)
+    {
+        for (const auto& marker : slot.markers)
+        {
+            GLuint64 gpuStart = 0, gpuEnd = 0;
+            glGetQueryObjectui64v(marker.begin_query, GL_QUERY_RESULT, &gpuStart);
+            glGetQueryObjectui64v(marker.end_query, GL_QUERY_RESULT, &gpuEnd);
+
+            hzgl::ProfileEvent event;
+            event.name = marker.name;
+            event.start_ns = static_cast<uint64_t>(std::max<int64_t>(0, static_cast<int64_t>(gpuStart) - g_gpuOffset));
+            event.end_ns = static_cast<uint64_t>(std::max<int64_t>(0, static_cast<int64_t>(gpuEnd) - g_gpuOffset));
+            event.thread_id = HZGL_GPU_THREAD_ID;
+            event.depth = marker.depth;
+            event.allocations = 0;
+
+            frame.gpu_events.push_back(event);
+        }
+    }
+
+    slot.markers.clear();
+    slot.num_used = 0;
+
+    if (frameValid)
+        g_latestFrame = &frame;
+}
+
+static void hzglWriteJsonString(FILE* fp, const char* str)
+{
+    fputc('"', fp);
+    for (const char* c = str; *c != '\0'; c++)
+    {
+        if (*c == '"' || *c == '\\')
+            fputc('\\', fp);
+        fputc(*c, fp);
+    }
+    fputc('"', fp);
+}
+
+static void hzglWriteTraceEvent(FILE* fp, const hzgl::ProfileEvent& event, bool& first)
+{
+    fprintf(fp, "%s\n    {\"name\": ", first ? "" : ",");
+    hzglWriteJsonString(fp, event.name);
+    fprintf(fp, ", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 0, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f",
+            event.thread_id == HZGL_GPU_THREAD_ID ? "gpu" : "cpu", event.thread_id,
+            event.start_ns / 1000.0, (event.end_ns - event.start_ns) / 1000.0);
+
+    if (event.allocations > 0)
+        fprintf(fp, ", \"args\": {\"allocations\": %u}", event.allocations);
+
+    fprintf(fp, "}");
+    first = false;
+}
+
+hzgl::ProfileScope::ProfileScope(const char* name) : _name(name)
+{
+    _allocations = ThreadAllocations().allocations;
+    _start = ProfilerNow();
+    t_depth++;
+}
+
+hzgl::ProfileScope::~ProfileScope()
+{
+    t_depth--;
+
+    uint64_t allocations = ThreadAllocations().allocations - _allocations;
+    hzglProfileRing* ring = hzglThreadRing();
+
+    ProfileEvent event;
+    event.name = _name;
+    event.start_ns = _start;
+    event.end_ns = ProfilerNow();
+    event.thread_id = ring->thread_id;
+    event.depth = t_depth;
+    event.allocations = static_cast<uint32_t>(std::min<uint64_t>(allocations, UINT32_MAX));
+
+    hzglPushEvent(ring, event);
+}
+
+hzgl::GpuProfileScope::GpuProfileScope(const char* name) : _index(-1)
+{
+    if (!g_gpuEnabled || !g_inFrame)
+        return;
+
+    hzglGpuSlot& slot = g_gpuSlots[g_frameIndex % HZGL_GPU_LATENCY];
+
+    // recycle query objects from earlier frames, only generating new ones when needed
+    if (slot.num_used + 2 > slot.queries.size())
+    {
+        size_t oldSize = slot.queries.size();
+        slot.queries.resize(oldSize + 32);
+        glGenQueries(32, &slot.queries[oldSize]);
+    }
+
+    hzglGpuMarker marker;
+    marker.name = name;
+    marker.depth = g_gpuDepth++;
+    marker.begin_query = slot.queries[slot.num_used++];
+    marker.end_query = slot.queries[slot.num_used++];
+
+    glQueryCounter(marker.begin_query, GL_TIMESTAMP);
+
+    _index = static_cast<int>(slot.markers.size());
+    slot.markers.push_back(marker);
+}
+
+hzgl::GpuProfileScope::~GpuProfileScope()
+{
+    if (_index < 0)
+        return;
+
+    hzglGpuSlot& slot = g_gpuSlots[g_frameIndex % HZGL_GPU_LATENCY];
+    glQueryCounter(slot.markers[_index].end_query, GL_TIMESTAMP);
+    g_gpuDepth--;
+}
+
+uint64_t hzgl::ProfilerNow()
+{
+    auto elapsed = std::chrono::steady_clock::now() - g_epoch;
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+void hzgl::ProfilerSetThreadName(const char* name)
+{
+    hzglProfileRing* ring = hzglThreadRing();
+
+    std::lock_guard<std::mutex> lock(g_ringsMutex);
+    ring->name = name;
+}
+
+const char* hzgl::ProfilerThreadName(uint32_t threadID)
+{
+    if (threadID == HZGL_GPU_THREAD_ID)
+        return "GPU";
+
+    std::lock_guard<std::mutex> lock(g_ringsMutex);
+
+    if (threadID >= g_rings.size())
+        return "Unknown";
+
+    return g_rings[threadID]->name.c_str();
+}
+
+void hzgl::ProfilerInitGPU()
+{
+    if (g_gpuEnabled)
+        return;
+
+    hzglSyncGpuClock();
+    g_gpuEnabled = true;
+}
+
+void hzgl::ProfilerShutdownGPU()
+{
+    if (!g_gpuEnabled)
+        return;
+
+    for (auto& slot : g_gpuSlots)
+    {
+        if (!slot.queries.empty())
+            glDeleteQueries(static_cast<GLsizei>(slot.queries.size()), slot.queries.data());
+
+        slot.queries.clear();
+        slot.markers.clear();
+        slot.num_used = 0;
+        slot.pending = false;
+    }
+
+    g_gpuEnabled = false;
+}
+
+void hzgl::ProfilerBeginFrame()
+{
+    if (!g_firstFrameStarted)
+    {
+        // everything recorded so far belongs to start-up (loaders, shader compilation, ...)
+        hzglDrainRings(g_startupEvents);
+        std::sort(g_startupEvents.begin(), g_startupEvents.end(), hzglEarlierStart);
+        g_firstFrameStarted = true;
+    }
+
+    g_inFrame = true;
+    g_gpuDepth = 0;
+    g_frameStart = ProfilerNow();
+}
+
+void hzgl::ProfilerEndFrame()
+{
+    if (!g_inFrame)
+        return;
+
+    g_inFrame = false;
+
+    ProfileFrame& frame = g_history[g_frameIndex % HZGL_HISTORY_FRAMES];
+    frame.index = g_frameIndex;
+    frame.start_ns = g_frameStart;
+    frame.end_ns = ProfilerNow();
+    frame.gpu_ready = false;
+    frame.cpu_events.clear();
+    frame.gpu_events.clear();
+
+    hzglDrainRings(frame.cpu_events);
+    std::sort(frame.cpu_events.begin(), frame.cpu_events.end(), hzglEarlierStart);
+
+    if (g_gpuEnabled)
+    {
+        hzglGpuSlot& current = g_gpuSlots[g_frameIndex % HZGL_GPU_LATENCY];
+        current.frame = g_frameIndex;
+        current.pending = true;
+
+        // the next frame reuses the oldest slot, so its results are collected now
+        hzglCollectGpuSlot(g_gpuSlots[(g_frameIndex + 1) % HZGL_GPU_LATENCY]);
+
+        if (g_frameIndex % HZGL_GPU_RESYNC_INTERVAL == 0)
+            hzglSyncGpuClock();
+    }
+    else
+    {
+        frame.gpu_ready = true;
+        g_latestFrame = &frame;
+    }
+
+    g_frameIndex++;
+}
+
+const hzgl::ProfileFrame* hzgl::ProfilerLatestFrame()
+{
+    return g_latestFrame;
+}
+
+const hzgl::ProfileFrame* hzgl::ProfilerLastFrame()
+{
+    if (g_frameIndex == 0)
+        return nullptr;
+
+    return &g_history[(g_frameIndex - 1) % HZGL_HISTORY_FRAMES];
+}
+
+void hzgl::ProfilerFrameTimes(std::vector<float>& frameTimes)
+{
+    frameTimes.clear();
+
+    uint64_t count = std::min<uint64_t>(g_frameIndex, HZGL_HISTORY_FRAMES);
+    for (uint64_t i = g_frameIndex - count; i < g_frameIndex; i++)
+    {
+        const ProfileFrame& frame = g_history[i % HZGL_HISTORY_FRAMES];
+        frameTimes.push_back((frame.end_ns - frame.start_ns) / 1e6f);
+    }
+}
+
+const std::vector<hzgl::ProfileEvent>& hzgl::ProfilerStartupEvents()
+{
+    return g_startupEvents;
+}
+
+bool hzgl::ExportChromeTrace(const std::string& filepath)
+{
+    FILE* fp = fopen(filepath.c_str(), "w");
+
+    if (fp == nullptr)
+    {
+        HZGL_LOG_ERROR("Failed to open the trace file.")
+        return false;
+    }
+
+    bool first = true;
+    fprintf(fp, "{\n  \"displayTimeUnit\": \"ms\",\n  \"traceEvents\": [");
+
+    // name the lanes so chrome://tracing and Perfetto show readable rows
+    {
+        std::lock_guard<std::mutex> lock(g_ringsMutex);
+        for (const auto& ring : g_rings)
+        {
+            fprintf(fp, "%s\n    {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %u, \"args\": {\"name\": ",
+                    first ? "" : ",", ring->thread_id);
+            hzglWriteJsonString(fp, ring->name.c_str());
+            fprintf(fp, "}}");
+            first = false;
+        }
+    }
+
+    fprintf(fp, "%s\n    {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %u, \"args\": {\"name\": \"GPU\"}}",
+            first ? "" : ",", HZGL_GPU_THREAD_ID);
+    first = false;
+
+    for (const auto& event : g_startupEvents)
+        hzglWriteTraceEvent(fp, event, first);
+
+    uint64_t count = std::min<uint64_t>(g_frameIndex, HZGL_HISTORY_FRAMES);
+    for (uint64_t i = g_frameIndex - count; i < g_frameIndex; i++)
+    {
+        const ProfileFrame& frame = g_history[i % HZGL_HISTORY_FRAMES];
+
+        for (const auto& event : frame.cpu_events)
+            hzglWriteTraceEvent(fp, event, first);
+
+        for (const auto& event : frame.gpu_events)
+            hzglWriteTraceEvent(fp, event, first);
+    }
+
+    fprintf(fp, "\n  ]\n}\n");
+    fclose(fp);
+
+    std::cout << "Chrome trace written to " << filepath << std::endl;
+
+    return true;
+}
+
+#undef HZGL_LOG_ERROR
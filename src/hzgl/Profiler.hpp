@@ -0,0 +1,104 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+namespace hzgl
+{
+    typedef struct
+    {
+        const char* name;   // must outlive the profiler (e.g. string literal)
+        uint64_t start_ns;  // relative to the profiler epoch
+        uint64_t end_ns;
+        uint32_t thread_id; // index into ProfilerThreadName()
+        uint32_t depth;     // nesting level within the thread
+        uint32_t allocations; // operator new calls inside the scope (CPU events with HZGL_TRACK_HEAP)
+    } ProfileEvent;
+
+    typedef struct
+    {
+        uint64_t index = 0;
+        uint64_t start_ns = 0;
+        uint64_t end_ns = 0;
+        bool gpu_ready = false;
+        std::vector<ProfileEvent> cpu_events;
+        std::vector<ProfileEvent> gpu_events;
+    } ProfileFrame;
+
+    // records a CPU marker for the lifetime of the object
+    class ProfileScope
+    {
+    private:
+        const char* _name;
+        uint64_t _start;
+        uint64_t _allocations;
+
+    public:
+        explicit ProfileScope(const char* name);
+        ~ProfileScope();
+
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+    };
+
+    // records a GPU marker (timestamp queries) for the lifetime of the object
+    class GpuProfileScope
+    {
+    private:
+        int _index;
+
+    public:
+        explicit GpuProfileScope(const char* name);
+        ~GpuProfileScope();
+
+        GpuProfileScope(const GpuProfileScope&) = delete;
+        GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+    };
+
+    // nanoseconds since the profiler epoch
+    uint64_t ProfilerNow();
+
+    // label the calling thread in the flame graph and trace export
+    void ProfilerSetThreadName(const char* name);
+    const char* ProfilerThreadName(uint32_t threadID);
+
+    // GPU markers are ignored until this is called with a current context
+    void ProfilerInitGPU();
+    void ProfilerShutdownGPU();
+
+    void ProfilerBeginFrame();
+    void ProfilerEndFrame();
+
+    // most recent frame whose GPU results have been read back
+    const ProfileFrame* ProfilerLatestFrame();
+
+    // frame closed by the last ProfilerEndFrame(), its GPU events may still be pending
+    const ProfileFrame* ProfilerLastFrame();
+
+    // CPU frame durations (in ms) of the recorded history, oldest first
+    void ProfilerFrameTimes(std::vector<float>& frameTimes);
+
+    // events recorded before the first frame (e.g. loaders during init)
+    const std::vector<ProfileEvent>& ProfilerStartupEvents();
+
+    bool ExportChromeTrace(const std::string& filepath);
+} // namespace hzgl
+
+#define HZGL_PROFILE_CONCAT_IMPL(a, b) a##b
+#define HZGL_PROFILE_CONCAT(a, b) HZGL_PROFILE_CONCAT_IMPL(a, b)
+
+#ifdef HZGL_ENABLE_PROFILER
+#define HZGL_PROFILE_SCOPE(name) \
+    hzgl::ProfileScope HZGL_PROFILE_CONCAT(_hzglProfileScope, __LINE__)(name)
+#define HZGL_PROFILE_GPU_SCOPE(name) \
+    hzgl::ProfileScope HZGL_PROFILE_CONCAT(_hzglProfileScope, __LINE__)(name); \
+    hzgl::GpuProfileScope HZGL_PROFILE_CONCAT(_hzglGpuProfileScope, __LINE__)(name)
+#else
+#define HZGL_PROFILE_SCOPE(name)
+#define HZGL_PROFILE_GPU_SCOPE(name)
+#endif
+
+#define HZGL_PROFILE_FUNCTION() HZGL_PROFILE_SCOPE(__func__)
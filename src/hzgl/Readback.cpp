@@ -0,0 +1,149 @@
+#include "Readback.hpp"
+
+#include "Memory.hpp"
+#include "Profiler.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+hzgl::AsyncReadback::AsyncReadback(int numSlots)
+{
+    _sequence = 0;
+    _slots.resize(std::max(1, numSlots));
+}
+
+hzgl::AsyncReadback::~AsyncReadback()
+{
+    // GL objects are deleted in Release(), the context may be gone by now
+}
+
+bool hzgl::AsyncReadback::Request(int x, int y, int width, int height, GLenum readBuffer, uint64_t tag)
+{
+    HZGL_PROFILE_SCOPE("AsyncReadback::Request");
+
+    auto it = std::find_if(_slots.begin(), _slots.end(), [](const Slot& slot) { return slot.fence == nullptr; });
+
+    if (it == _slots.end())
+        return false;
+
+    Slot& slot = *it;
+    size_t size = 4 * static_cast<size_t>(width) * height;
+
+    if (slot.pbo == 0)
+        glGenBuffers(1, &slot.pbo);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+
+    // only reallocate when the image grows
+    if (slot.capacity < size)
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        slot.capacity = size;
+
+        TrackGpuResource({HZGL_GPU_BUFFER, slot.pbo, size, "Readback", "", "pixel pack buffer"});
+    }
+
+    GLint packAlignment = 4;
+    glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+
+    glReadBuffer(readBuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    // with a pack buffer bound this only queues the copy
+    glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.width = width;
+    slot.height = height;
+    slot.tag = tag;
+    slot.sequence = _sequence++;
+
+    return true;
+}
+
+int hzgl::AsyncReadback::Collect(std::vector<ReadbackImage>& images, bool wait, int maxImages, std::vector<uint64_t>* failed)
+{
+    HZGL_PROFILE_SCOPE("AsyncReadback::Collect");
+
+    std::vector<Slot*> pending;
+    for (auto& slot : _slots)
+    {
+        if (slot.fence != nullptr)
+            pending.push_back(&slot);
+    }
+
+    std::sort(pending.begin(), pending.end(), [](const Slot* a, const Slot* b) { return a->sequence < b->sequence; });
+
+    int collected = 0;
+
+    for (Slot* slot : pending)
+    {
+        if (maxImages >= 0 && collected >= maxImages)
+            break;
+
+        // keep the results in order: stop at the first readback that is still in flight
+        GLuint64 timeout = wait ? 1000000000ull : 0;
+        GLenum status = glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+
+        glDeleteSync(slot->fence);
+        slot->fence = nullptr;
+
+        size_t size = 4 * static_cast<size_t>(slot->width) * slot->height;
+
+        ReadbackImage image;
+        image.width = slot->width;
+        image.height = slot->height;
+        image.tag = slot->tag;
+        image.pixels = std::make_shared<std::vector<unsigned char>>(size);
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+        void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+
+        if (mapped != nullptr)
+        {
+            memcpy(image.pixels->data(), mapped, size);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+
+            images.push_back(std::move(image));
+        }
+        else if (failed != nullptr)
+            failed->push_back(slot->tag);
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        collected++;
+    }
+
+    return collected;
+}
+
+int hzgl::AsyncReadback::NumPending() const
+{
+    return static_cast<int>(std::count_if(_slots.begin(), _slots.end(), [](const Slot& slot) { return slot.fence != nullptr; }));
+}
+
+int hzgl::AsyncReadback::NumSlots() const
+{
+    return static_cast<int>(_slots.size());
+}
+
+void hzgl::AsyncReadback::Release()
+{
+    for (auto& slot : _slots)
+    {
+        if (slot.fence != nullptr)
+            glDeleteSync(slot.fence);
+
+        if (slot.pbo != 0)
+        {
+            glDeleteBuffers(1, &slot.pbo);
+            UntrackGpuResource(HZGL_GPU_BUFFER, slot.pbo);
+        }
+
+        slot = Slot();
+    }
+}
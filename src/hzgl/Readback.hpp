@@ -0,0 +1,58 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+namespace hzgl
+{
+    typedef struct
+    {
+        int width = 0;
+        int height = 0;
+        uint64_t tag = 0;   // caller-defined, e.g. frame number
+        std::shared_ptr<std::vector<unsigned char>> pixels;  // RGBA8, bottom-up
+    } ReadbackImage;
+
+    // asynchronous glReadPixels through a ring of pixel-pack buffers guarded by fences
+    class AsyncReadback
+    {
+    private:
+        typedef struct
+        {
+            GLuint pbo = 0;
+            GLsync fence = nullptr;
+            size_t capacity = 0;
+            int width = 0;
+            int height = 0;
+            uint64_t tag = 0;
+            uint64_t sequence = 0;
+        } Slot;
+
+        std::vector<Slot> _slots;
+        uint64_t _sequence;
+
+    public:
+        explicit AsyncReadback(int numSlots = 3);
+        ~AsyncReadback();
+
+        AsyncReadback(const AsyncReadback&) = delete;
+        AsyncReadback& operator=(const AsyncReadback&) = delete;
+
+        // queue a readback of the bound read framebuffer; false when every slot is in flight
+        bool Request(int x, int y, int width, int height, GLenum readBuffer, uint64_t tag = 0);
+
+        // move finished readbacks (oldest first) into images; wait blocks on the oldest fence. A
+        // readback whose buffer cannot be mapped is lost, its tag goes to failed instead. Returns
+        // the number of slots freed (maxImages counts both kinds)
+        int Collect(std::vector<ReadbackImage>& images, bool wait = false, int maxImages = -1, std::vector<uint64_t>* failed = nullptr);
+
+        int NumPending() const;
+        int NumSlots() const;
+
+        // delete the GL objects (needs the context that created them)
+        void Release();
+    };
+} // namespace hzgl
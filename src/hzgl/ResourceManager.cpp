@@ -1,8 +1,13 @@
 #include "ResourceManager.hpp"
 
+#include "Memory.hpp"
+#include "Tangents.hpp"
 #include "Filesystem.hpp"
+#include "Profiler.hpp"
 
 #include <cstdio>
+#include <cstring>
+#include <thread>
 #include <iostream>
 #include <algorithm>
 
@@ -12,7 +17,10 @@
     fprintf(stderr, "[ERROR] %s (line %d): %s\n", __FILE__, __LINE__, msg);
 
 hzgl::ResourceManager::ResourceManager()
+    : _meshWorkersStarted(false)
 {
+    // no threads here: the manager may be a global, constructed before main() and before the
+    // profiler the workers register with
 }
 
 hzgl::ResourceManager::~ResourceManager()
@@ -20,102 +28,287 @@ hzgl::ResourceManager::~ResourceManager()
     ReleaseAll();
 }
 
+hzgl::ThreadPool* hzgl::ResourceManager::meshWorkers()
+{
+    // shared by every model loaded through here, rather than a pool per file
+    if (!_meshWorkersStarted)
+    {
+        int threads = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+
+        if (threads > 0)
+            _meshWorkers.reset(new ThreadPool(threads, 0, "Mesh"));
+
+        _meshWorkersStarted = true;
+    }
+
+    return _meshWorkers.get();
+}
+
 void hzgl::ResourceManager::ReleaseAll()
 {
-    // delete all used VBOs
+    // delete all used VBOs (and EBOs) and VAOs
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glDeleteBuffers(static_cast<GLsizei>(_usedVBOs.size()), _usedVBOs.data());
-
-    // delete all used VAOs
     glBindVertexArray(0);
-    glDeleteVertexArrays(static_cast<GLsizei>(_usedVAOs.size()), _usedVAOs.data());
+    for (size_t i = 0; i < _models.Size(); i++)
+    {
+        const Model &model = _models.At(i);
+
+        glDeleteBuffers(static_cast<GLsizei>(model.buffers.size()), model.buffers.data());
+        glDeleteVertexArrays(static_cast<GLsizei>(model.arrays.size()), model.arrays.data());
+
+        for (GLuint id : model.buffers)
+            UntrackGpuResource(HZGL_GPU_BUFFER, id);
+    }
 
     // delete all shader programs
     glUseProgram(0);
-    for (const auto &pair : _programInfo)
-        glDeleteProgram(pair.second.id);
+    for (size_t i = 0; i < _programs.Size(); i++)
+    {
+        DeleteShaderProgram(_programs.At(i).id);
+        UntrackGpuResource(HZGL_GPU_PROGRAM, _programs.At(i).id);
+    }
 
     // delete all stages
-    for (const auto &pair : _shaderInfo)
-        glDeleteShader(pair.second.id);
+    for (size_t i = 0; i < _shaders.Size(); i++)
+        glDeleteShader(_shaders.At(i).id);
 
     // delete all loaded textures
     glBindTexture(GL_TEXTURE_2D, 0);
-    for (const auto &pair : _textureInfo)
-        glDeleteTextures(1, &pair.second.id);
+    for (size_t i = 0; i < _textures.Size(); i++)
+    {
+        glDeleteTextures(1, &_textures.At(i).info.id);
+        UntrackGpuResource(HZGL_GPU_TEXTURE, _textures.At(i).info.id);
+    }
+
+    // forget the handles so that a later call (e.g. from the destructor) is harmless
+    _models.Clear();
+    _textures.Clear();
+    _shaders.Clear();
+    _programs.Clear();
+    _modelNames.clear();
+    _textureNames.clear();
+    _shaderNames.clear();
+    _programNames.clear();
+    _loadedMeshes.clear();
+    _loadedTextures.clear();
+    _loadedPrograms.clear();
+}
+
+// a glTF primitive copied out of the mapping, with the tangent frames the Assimp path would give it
+static void hzglGltfToMesh(const hzgl::GltfAsset &asset, const hzgl::GltfPrimitive &primitive, hzgl::MeshInfo &mesh)
+{
+    const hzgl::GltfAccessor &positions = asset.Accessors()[primitive.position];
+    const hzgl::GltfAccessor &indices = asset.Accessors()[primitive.indices];
+
+    mesh.name = primitive.name;
+    mesh.node = primitive.node;
+    mesh.num_vertices = static_cast<int>(positions.count);
+    mesh.shading_mode = hzgl::HZGL_NORMAL_MAPPING;
+    mesh.positions.resize(3 * positions.count);
+    mesh.normals.resize(3 * positions.count);
+    mesh.texcoords.resize(2 * positions.count);
+    mesh.indices.resize(indices.count);
+
+    for (size_t v = 0; v < positions.count; v++)
+    {
+        asset.Read(primitive.position, v, &mesh.positions[3 * v], 3);
+        asset.Read(primitive.normal, v, &mesh.normals[3 * v], 3);
+        asset.Read(primitive.texcoord, v, &mesh.texcoords[2 * v], 2);
+    }
+
+    // unsigned byte, short or int, tightly packed (checked by Open)
+    const uint8_t *data = asset.Data(primitive.indices);
+    size_t indexSize = asset.ElementSize(primitive.indices);
+
+    for (size_t i = 0; i < indices.count; i++)
+    {
+        uint32_t index = 0;
+        memcpy(&index, data + i * indexSize, indexSize);
+        mesh.indices[i] = index;
+    }
+
+    if (primitive.base_color_image >= 0)
+        mesh.texpath["diffuse"] = asset.ImageName(primitive.base_color_image);
+    mesh.texpath["normals"] = asset.ImageName(primitive.normal_image);
+
+    hzgl::GenerateTangentFrames(mesh);
+    mesh.num_vertices = static_cast<int>(mesh.positions.size() / 3);
 }
 
-GLuint hzgl::ResourceManager::LoadTexture(const std::string &filepath, GLenum type)
+void hzgl::ParseModel(const std::string &filepath, ParsedModel &model, bool decodeTextures, ThreadPool *pool)
 {
+    HZGL_PROFILE_SCOPE("ParseModel");
+
+    model.path = filepath;
+
+    // glTF the viewer can draw as stored is kept mapped and uploaded without conversion
+    if (IsGltfFile(filepath))
+    {
+        std::shared_ptr<GltfAsset> asset = std::make_shared<GltfAsset>();
+
+        if (asset->Open(filepath))
+        {
+            model.gltf = asset;
+            model.nodes = asset->Nodes();
+
+            for (size_t i = 0; decodeTextures && i < asset->Images().size(); i++)
+            {
+                ImageData image;
+                if (asset->DecodeImage(static_cast<int>(i), &image))
+                    model.images[asset->ImageName(static_cast<int>(i))] = image;
+            }
+
+            // the few primitives that need tangent frames become shapes, the mapping is gone by
+            // the time they are uploaded, so their images are decoded here either way
+            for (const auto &primitive : asset->Primitives())
+            {
+                if (!GltfNeedsTangents(primitive))
+                    continue;
+
+                model.shapes.emplace_back();
+                hzglGltfToMesh(*asset, primitive, model.shapes.back());
+
+                for (int image : {primitive.base_color_image, primitive.normal_image})
+                {
+                    ImageData pixels;
+                    if (image >= 0 && model.images.find(asset->ImageName(image)) == model.images.end() && asset->DecodeImage(image, &pixels))
+                        model.images[asset->ImageName(image)] = pixels;
+                }
+            }
+
+            return;
+        }
+    }
+
+    LoadMeshesFromFile(filepath, model.shapes, &model.nodes, true, pool);
+
+    if (!decodeTextures)
+        return;
+
+    for (const auto &shape : model.shapes)
+    {
+        for (const auto &pair : shape.texpath)
+        {
+            const auto &path = pair.second;
+
+            if (path.empty() || model.images.find(path) != model.images.end() || !Exists(path))
+                continue;
+
+            ImageData image;
+            if (DecodeImage(path, &image))
+                model.images[path] = image;
+        }
+    }
+}
+
+hzgl::TextureHandle hzgl::ResourceManager::LoadTexture(const std::string &filepath, GLenum type)
+{
+    return loadTexture(filepath, type, "Textures", "", filepath);
+}
+
+hzgl::TextureHandle hzgl::ResourceManager::loadTexture(const std::string &filepath, GLenum type, const std::string &owner, const std::string &shape,
+                                                       const std::string &label, const ImageData *image)
+{
+    HZGL_PROFILE_SCOPE("LoadTexture");
+
     // avoid loading the same texture multiple times
-    if (_textureInfo.find(filepath) != _textureInfo.end())
-        return _textureInfo[filepath].id;
+    auto loaded = _textureNames.find(filepath);
+    if (loaded != _textureNames.end())
+    {
+        _textures.Get(loaded->second)->refs++;
+        return loaded->second;
+    }
 
     std::cout << "Loading texture from " << filepath << std::endl;
 
-    if (!Exists(filepath))
+    if (image == nullptr && !Exists(filepath))
     {
         HZGL_LOG_ERROR("File does not exist.")
-        return 0;
+        return TextureHandle();
     }
 
-    TextureInfo texInfo;
-    TextureFromFile(filepath, type, &texInfo);
+    HeapWatermark watermark;
+
+    TextureInfo texInfo = {};
+
+    if (image != nullptr)
+        TextureFromPixels(image->pixels.get(), image->width, image->height, image->num_channels, filepath, type, &texInfo);
+    else
+        TextureFromFile(filepath, type, &texInfo);
+
+    if (texInfo.id == 0)
+        return TextureHandle();
+
+    // shared textures are accounted to whoever loaded them first
+    GpuResourceRecord record;
+    record.type = HZGL_GPU_TEXTURE;
+    record.id = texInfo.id;
+    record.bytes = EstimateTextureBytes(texInfo.internal_format, texInfo.width, texInfo.height, texInfo.num_levels);
+    record.owner = owner;
+    record.shape = shape;
+    record.label = label;
+    TrackGpuResource(record);
+
+    RecordLoadMemory(filepath, "texture", watermark.Finish());
+
+    Texture texture;
+    texture.info = texInfo;
+    texture.filepath = filepath;
+    texture.refs = 1;
+
+    TextureHandle handle = _textures.Insert(std::move(texture));
 
     _loadedTextures.push_back(filepath);
-    _textureInfo[filepath] = texInfo;
+    _textureNames[filepath] = handle;
 
-    return texInfo.id;
+    return handle;
 }
 
-GLuint hzgl::ResourceManager::LoadShader(const std::string &filepath, GLenum shaderType)
+hzgl::ShaderHandle hzgl::ResourceManager::LoadShader(const std::string &filepath, GLenum shaderType)
 {
+    HZGL_PROFILE_SCOPE("LoadShader");
+
     // avoid loading the same shader multiple times
-    if (_shaderInfo.find(filepath) != _shaderInfo.end())
-        return _shaderInfo[filepath].id;
+    auto loaded = _shaderNames.find(filepath);
+    if (loaded != _shaderNames.end())
+        return loaded->second;
 
     std::cout << "Loading shader from " << filepath << std::endl;
 
     if (!Exists(filepath))
     {
         HZGL_LOG_ERROR("File does not exist.")
-        return 0;
+        return ShaderHandle();
     }
 
     ShaderInfo shaderInfo;
     shaderInfo.filepath = filepath;
     shaderInfo.id = CreateShader(filepath, shaderType);
 
-    _shaderInfo[filepath] = shaderInfo;
+    ShaderHandle handle = _shaders.Insert(std::move(shaderInfo));
+    _shaderNames[filepath] = handle;
 
-    return shaderInfo.id;
+    return handle;
 }
 
-GLuint hzgl::ResourceManager::LoadShaderProgram(std::vector<ShaderStage> stages, const char *name)
+hzgl::ProgramHandle hzgl::ResourceManager::LoadShaderProgram(std::vector<ShaderStage> stages, const char *name)
 {
-    GLuint programID = glCreateProgram();
+    HZGL_PROFILE_SCOPE("LoadShaderProgram");
+
+    std::vector<GLuint> shaders;
 
     for (auto &stage : stages)
     {
-        GLuint shaderID = LoadShader(stage.filepath, stage.type);
-        glAttachShader(programID, shaderID);
-        stage.id = shaderID;
+        stage.id = GetShaderID(LoadShader(stage.filepath, stage.type));
+        shaders.push_back(stage.id);
     }
 
-    glLinkProgram(programID);
-
-    GLint infoLogLength;
-    GLint linkStatus = GL_FALSE;
-
-    glGetProgramiv(programID, GL_LINK_STATUS, &linkStatus);
-    glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &infoLogLength);
-
-    if (infoLogLength > 0)
+    // the shaders are shared between programs, so they stay alive; nothing waits for the link,
+    // see FinishShaderPrograms()
+    GLuint programID;
     {
-        char *infoLog = new char[infoLogLength + 1];
-        glGetProgramInfoLog(programID, infoLogLength, NULL, infoLog);
-        std::cout << infoLog << std::endl;
-        delete[] infoLog;
+        HZGL_PROFILE_SCOPE("LinkProgram");
+        programID = LinkShaderProgram(shaders, false);
     }
 
     std::string programName;
@@ -130,19 +323,110 @@ GLuint hzgl::ResourceManager::LoadShaderProgram(std::vector<ShaderStage> stages,
     progInfo.stages = stages;
     progInfo.name = programName;
 
+    // a program loaded again under its name replaces the old one
+    auto loaded = _programNames.find(programName);
+    if (loaded != _programNames.end())
+        Unload(loaded->second);
+
+    ProgramHandle handle = _programs.Insert(std::move(progInfo));
+
     _loadedPrograms.push_back(programName);
-    _programInfo[programName] = progInfo;
+    _programNames[programName] = handle;
 
-    return progInfo.id;
+    return handle;
 }
 
-void hzgl::ResourceManager::LoadModel(const std::string &filepath, std::vector<RenderObject> &objects, const char* name, bool duplicateAllowed)
+int hzgl::ResourceManager::FinishShaderPrograms(bool wait)
+{
+    int pending = 0;
+
+    for (size_t i = 0; i < _programs.Size(); i++)
+    {
+        ProgramInfo &progInfo = _programs.At(i);
+        const std::string &programName = progInfo.name;
+
+        if (progInfo.finished)
+            continue;
+
+        if (!wait && !ShaderProgramReady(progInfo.id))
+        {
+            pending += 1;
+            continue;
+        }
+
+        progInfo.linked = FinishShaderProgram(progInfo.id);
+        progInfo.finished = true;
+
+        if (!progInfo.linked)
+            std::cerr << "Failed to build the program " << programName << std::endl;
+
+        // the linked binary is the closest thing to a driver-side size we can query
+        GLint binaryLength = 0;
+        glGetProgramiv(progInfo.id, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+
+        GpuResourceRecord record;
+        record.type = HZGL_GPU_PROGRAM;
+        record.id = progInfo.id;
+        record.bytes = static_cast<size_t>(std::max(binaryLength, 0));
+        record.owner = "Programs";
+        record.label = programName;
+        TrackGpuResource(record);
+    }
+
+    return pending;
+}
+
+hzgl::MeshHandle hzgl::ResourceManager::LoadModel(const std::string &filepath, std::vector<RenderObject> &objects, const char* name, bool duplicateAllowed)
+{
+    // duplicates are told apart by the name they are kept under
+    std::string objectName = name ? std::string(name) : filepath;
+
+    if (!duplicateAllowed && _modelNames.find(objectName) != _modelNames.end())
+        return MeshHandle();
+
+    HZGL_PROFILE_SCOPE("LoadModel");
+
+    std::cout << "Loading meshes from " << filepath << std::endl;
+
+    HeapWatermark watermark;
+
+    // textures are decoded one at a time while uploading, which keeps the peak lower
+    ParsedModel model;
+    ParseModel(filepath, model, false, meshWorkers());
+
+    MeshHandle handle = uploadModel(model, objectName, objects);
+
+    RecordLoadMemory(objectName, "model", watermark.Finish());
+
+    return handle;
+}
+
+hzgl::MeshHandle hzgl::ResourceManager::LoadModel(ParsedModel &model, std::vector<RenderObject> &objects, const char* name, bool duplicateAllowed)
+{
+    std::string objectName = name ? std::string(name) : model.path;
+
+    if (!duplicateAllowed && _modelNames.find(objectName) != _modelNames.end())
+        return MeshHandle();
+
+    HZGL_PROFILE_SCOPE("LoadModel");
+
+    HeapWatermark watermark;
+
+    MeshHandle handle = uploadModel(model, objectName, objects);
+
+    RecordLoadMemory(objectName, "model", watermark.Finish());
+
+    return handle;
+}
+
+hzgl::MeshHandle hzgl::ResourceManager::uploadModel(ParsedModel &model, const std::string &objectName, std::vector<RenderObject> &objects)
 {
     enum Buffer_IDs
     {
         Position = 0,
         Normal,
         TexCoord,
+        QTangent,
         NumBuffers
     };
 
@@ -151,21 +435,27 @@ void hzgl::ResourceManager::LoadModel(const std::string &filepath, std::vector<R
         vPosition = 0,
         vNormal,
         vTexCoord,
+        vQTangent,
         NumAttribs
     };
 
-    if (!duplicateAllowed && _renderObjects.find(filepath) != _renderObjects.end())
-        return;
+    std::vector<MeshInfo> &shapes = model.shapes;
 
-    std::cout << "Loading meshes from " << filepath << std::endl;
+    // what Unload() needs, the shapes themselves go to the caller
+    Model owned;
+    owned.name = objectName;
+    owned.path = model.path;
 
-    std::vector<MeshInfo> shapes;
+    RenderObject renderObject;
+    renderObject.shapes.reserve(shapes.size());
 
-    LoadMeshesFromFile(filepath, shapes);
+    if (model.gltf)
+        uploadGltf(model, objectName, owned, renderObject);
 
-    RenderObject renderObject;
-    for (const auto &shape : shapes)
+    for (auto &shape : shapes)
     {
+        HZGL_PROFILE_SCOPE("UploadShape");
+
         RenderShape renderShape;
         renderShape.name = shape.name;
         renderShape.num_indices = shape.indices.size();
@@ -173,6 +463,8 @@ void hzgl::ResourceManager::LoadModel(const std::string &filepath, std::vector<R
         renderShape.shading_mode = shape.shading_mode;
         renderShape.has_normals = shape.normals.size() > 0;
         renderShape.has_texcoords = shape.texcoords.size() > 0;
+        renderShape.has_tangents = shape.qtangents.size() > 0;
+        renderShape.node = shape.node;
 
         GLuint Buffers[NumBuffers] = {};
 
@@ -186,63 +478,452 @@ void hzgl::ResourceManager::LoadModel(const std::string &filepath, std::vector<R
         glBindBuffer(GL_ARRAY_BUFFER, Buffers[Position]);
         glBufferData(GL_ARRAY_BUFFER, sizeof(float) * shape.positions.size(), shape.positions.data(), GL_STATIC_DRAW);
 
+        // the QTangent carries the normal as well, so the float3 stream is left empty next to it
+        size_t normalBytes = renderShape.has_tangents ? 0 : sizeof(float) * shape.normals.size();
+
         glBindBuffer(GL_ARRAY_BUFFER, Buffers[Normal]);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * shape.normals.size(), shape.normals.data(), GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, normalBytes, shape.normals.data(), GL_STATIC_DRAW);
 
         glBindBuffer(GL_ARRAY_BUFFER, Buffers[TexCoord]);
         glBufferData(GL_ARRAY_BUFFER, sizeof(float) * shape.texcoords.size(), shape.texcoords.data(), GL_STATIC_DRAW);
 
+        glBindBuffer(GL_ARRAY_BUFFER, Buffers[QTangent]);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(int16_t) * shape.qtangents.size(), shape.qtangents.data(), GL_STATIC_DRAW);
+
         // VBO plumbing (assume the layout to be fixed)
         glBindBuffer(GL_ARRAY_BUFFER, Buffers[Position]);
         glVertexAttribPointer(vPosition, 3, GL_FLOAT, GL_FALSE, 0, (void *)(0));
         glEnableVertexAttribArray(vPosition);
 
-        glBindBuffer(GL_ARRAY_BUFFER, Buffers[Normal]);
-        glVertexAttribPointer(vNormal, 3, GL_FLOAT, GL_FALSE, 0, (void *)(0));
-        glEnableVertexAttribArray(vNormal);
+        // optional streams stay disabled (the shaders read constants) when the mesh has none
+        if (!renderShape.has_tangents)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, Buffers[Normal]);
+            glVertexAttribPointer(vNormal, 3, GL_FLOAT, GL_FALSE, 0, (void *)(0));
+            glEnableVertexAttribArray(vNormal);
+        }
 
-        glBindBuffer(GL_ARRAY_BUFFER, Buffers[TexCoord]);
-        glVertexAttribPointer(vTexCoord, 2, GL_FLOAT, GL_FALSE, 0, (void *)(0));
-        glEnableVertexAttribArray(vTexCoord);
+        if (renderShape.has_texcoords)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, Buffers[TexCoord]);
+            glVertexAttribPointer(vTexCoord, 2, GL_FLOAT, GL_FALSE, 0, (void *)(0));
+            glEnableVertexAttribArray(vTexCoord);
+        }
+
+        if (renderShape.has_tangents)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, Buffers[QTangent]);
+            glVertexAttribPointer(vQTangent, 4, GL_SHORT, GL_TRUE, 0, (void *)(0));
+            glEnableVertexAttribArray(vQTangent);
+        }
 
         glGenBuffers(1, &renderShape.EBO);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderShape.EBO);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * shape.indices.size(), shape.indices.data(), GL_STATIC_DRAW);
 
+        // same positions and indices, but the vertex fetch of a depth-only pass skips the other streams
+        glGenVertexArrays(1, &renderShape.depthVAO);
+        glBindVertexArray(renderShape.depthVAO);
+
+        glBindBuffer(GL_ARRAY_BUFFER, Buffers[Position]);
+        glVertexAttribPointer(vPosition, 3, GL_FLOAT, GL_FALSE, 0, (void *)(0));
+        glEnableVertexAttribArray(vPosition);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderShape.EBO);
+
         glBindVertexArray(0);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
 
+        const std::pair<const char*, size_t> bufferSizes[] = {
+            {"positions", sizeof(float) * shape.positions.size()},
+            {"normals", normalBytes},
+            {"texcoords", sizeof(float) * shape.texcoords.size()},
+            {"qtangents", sizeof(int16_t) * shape.qtangents.size()},
+        };
+
+        for (int i = 0; i < NumBuffers; i++)
+            TrackGpuResource({HZGL_GPU_BUFFER, Buffers[i], bufferSizes[i].second, objectName, shape.name, bufferSizes[i].first});
+
+        TrackGpuResource({HZGL_GPU_BUFFER, renderShape.EBO, sizeof(unsigned int) * shape.indices.size(), objectName, shape.name, "indices"});
+
+        // keep a few large triangles on the CPU for the software occlusion culler
+        renderShape.bounds = ComputeBounds(shape.positions);
+        renderShape.occluder.reset(new OccluderMesh());
+        BuildOccluder(shape.positions, shape.indices, 1024, renderShape.occluder.get());
+
+        // the GPU owns the geometry now, so drop the CPU copy before the next shape is uploaded
+        std::vector<float>().swap(shape.positions);
+        std::vector<float>().swap(shape.normals);
+        std::vector<float>().swap(shape.texcoords);
+        std::vector<int16_t>().swap(shape.qtangents);
+        std::vector<unsigned>().swap(shape.indices);
+
         for (const auto &pair : shape.texpath)
         {
             const auto &type = pair.first;
             const auto &path = pair.second;
 
             // load each texture image and convert it to OpenGL handle
+            auto image = model.images.find(path);
+            const ImageData *pixels = (image != model.images.end()) ? &image->second : nullptr;
+
+            TextureHandle texture;
             if (!path.empty())
-                renderShape.texture[type] = LoadTexture(path, GL_TEXTURE_2D);
-            else
-                renderShape.texture[type] = 0;
+                texture = loadTexture(path, GL_TEXTURE_2D, objectName, shape.name, type, pixels);
+
+            if (texture.IsValid())
+                owned.textures.push_back(texture);
+
+            renderShape.texture[type] = GetTextureID(texture);
 
             if (renderShape.texture[type] > 0)
                 renderShape.has_textures = true;
         }
 
         // keep track of the OpenGL handles used
-        _usedVAOs.push_back(renderShape.VAO);
+        owned.arrays.push_back(renderShape.VAO);
+        owned.arrays.push_back(renderShape.depthVAO);
 
         for (int i = 0; i < NumBuffers; i++)
-            _usedVBOs.push_back(Buffers[i]);
+            owned.buffers.push_back(Buffers[i]);
+
+        owned.buffers.push_back(renderShape.EBO);
 
-        renderObject.shapes.push_back(renderShape);
+        renderObject.shapes.push_back(std::move(renderShape));
     }
 
-    renderObject.path = filepath;
+    shapes.clear();
+    model.images.clear();
+
+    MeshHandle handle = _models.Insert(std::move(owned));
+
+    renderObject.path = model.path;
     renderObject.num_shapes = renderObject.shapes.size();
+    renderObject.handle = handle;
+    renderObject.nodes.swap(model.nodes);
 
-    objects.push_back(renderObject);
+    _loadedMeshes.push_back(model.path);
+    _modelNames[objectName] = handle;
 
-    _loadedMeshes.push_back(filepath);
-    _renderObjects[(name ? std::string(name) : filepath)] = renderObject;
+    objects.push_back(std::move(renderObject));
+
+    return handle;
+}
+
+void hzgl::ResourceManager::uploadGltf(ParsedModel &model, const std::string &objectName, Model &owned, RenderObject &renderObject)
+{
+    enum Attrib_IDs
+    {
+        vPosition = 0,
+        vNormal,
+        vTexCoord,
+        vQTangent,
+        NumAttribs
+    };
+
+    const GltfAsset &asset = *model.gltf;
+    const std::vector<GltfBufferView> &views = asset.Views();
+    const std::vector<GltfAccessor> &accessors = asset.Accessors();
+
+    // one buffer per buffer view, straight from the mapping; meshes that share a view share its buffer
+    std::vector<GLuint> viewBuffers(views.size(), 0);
+
+    auto viewBuffer = [&](int accessor, const std::string &shape, const char *label) {
+        int view = accessors[accessor].view;
+
+        if (viewBuffers[view] == 0)
+        {
+            // the VAO of the shape is bound, GL_ARRAY_BUFFER is not part of its state
+            glGenBuffers(1, &viewBuffers[view]);
+            glBindBuffer(GL_ARRAY_BUFFER, viewBuffers[view]);
+            glBufferData(GL_ARRAY_BUFFER, views[view].length, views[view].data, GL_STATIC_DRAW);
+
+            TrackGpuResource({HZGL_GPU_BUFFER, viewBuffers[view], views[view].length, objectName, shape, label});
+            owned.buffers.push_back(viewBuffers[view]);
+        }
+
+        return viewBuffers[view];
+    };
+
+    auto attribute = [&](GLuint index, int accessor, const std::string &shape, const char *label) {
+        const GltfAccessor &a = accessors[accessor];
+        int stride = views[a.view].stride;
+
+        glBindBuffer(GL_ARRAY_BUFFER, viewBuffer(accessor, shape, label));
+        glVertexAttribPointer(index, a.components, a.component_type, a.normalized ? GL_TRUE : GL_FALSE, stride, (void *)(a.offset));
+        glEnableVertexAttribArray(index);
+    };
+
+    for (const auto &primitive : asset.Primitives())
+    {
+        HZGL_PROFILE_SCOPE("UploadShape");
+
+        // ParseModel made a shape of it
+        if (GltfNeedsTangents(primitive))
+            continue;
+
+        const GltfAccessor &positions = accessors[primitive.position];
+        const GltfAccessor &indices = accessors[primitive.indices];
+
+        RenderShape renderShape;
+        renderShape.name = primitive.name;
+        renderShape.num_indices = static_cast<int>(indices.count);
+        renderShape.num_vertices = static_cast<int>(positions.count);
+        renderShape.shading_mode = (primitive.texcoord >= 0) ? HZGL_NORMAL_MAPPING : HZGL_PHONG;
+        renderShape.has_normals = true;
+        renderShape.has_texcoords = primitive.texcoord >= 0;
+        renderShape.node = primitive.node;
+
+        // the frame only matters with a normal map to rotate
+        renderShape.has_tangents = primitive.tangent >= 0 && primitive.normal_image >= 0 && renderShape.has_texcoords;
+
+        glGenVertexArrays(1, &renderShape.VAO);
+        glBindVertexArray(renderShape.VAO);
+
+        attribute(vPosition, primitive.position, primitive.name, "positions");
+        // decoded from the QTangent when there is one
+        if (!renderShape.has_tangents)
+            attribute(vNormal, primitive.normal, primitive.name, "normals");
+
+        if (renderShape.has_texcoords)
+            attribute(vTexCoord, primitive.texcoord, primitive.name, "texcoords");
+
+        // glTF tangents are xyz + handedness, the shaders take QTangents, so this stream is converted
+        if (renderShape.has_tangents)
+        {
+            std::vector<int16_t> qtangents(4 * positions.count);
+
+            for (size_t v = 0; v < positions.count; v++)
+            {
+                float n[3], t[4];
+                asset.Read(primitive.normal, v, n, 3);
+                asset.Read(primitive.tangent, v, t, 4);
+
+                EncodeQTangent(glm::vec3(n[0], n[1], n[2]), glm::vec3(t[0], t[1], t[2]), t[3], &qtangents[4 * v]);
+            }
+
+            GLuint buffer;
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(int16_t) * qtangents.size(), qtangents.data(), GL_STATIC_DRAW);
+            glVertexAttribPointer(vQTangent, 4, GL_SHORT, GL_TRUE, 0, (void *)(0));
+            glEnableVertexAttribArray(vQTangent);
+
+            TrackGpuResource({HZGL_GPU_BUFFER, buffer, sizeof(int16_t) * qtangents.size(), objectName, primitive.name, "qtangents"});
+            owned.buffers.push_back(buffer);
+        }
+
+        // indices are drawn from their view as stored, 8-bit ones included
+        renderShape.EBO = viewBuffer(primitive.indices, primitive.name, "indices");
+        renderShape.index_type = indices.component_type;
+        renderShape.index_offset = indices.offset;
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderShape.EBO);
+
+        // same positions and indices, but the vertex fetch of a depth-only pass skips the other streams
+        glGenVertexArrays(1, &renderShape.depthVAO);
+        glBindVertexArray(renderShape.depthVAO);
+
+        attribute(vPosition, primitive.position, primitive.name, "positions");
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderShape.EBO);
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        // POSITION always has its bounds in the file; the occluder is read from the mapping
+        renderShape.bounds.min = glm::vec3(positions.min[0], positions.min[1], positions.min[2]);
+        renderShape.bounds.max = glm::vec3(positions.max[0], positions.max[1], positions.max[2]);
+        renderShape.occluder.reset(new OccluderMesh());
+
+        // quantized positions (KHR_mesh_quantization) are unpacked for it first
+        if (positions.component_type == GL_FLOAT)
+        {
+            BuildOccluder(asset.Data(primitive.position), asset.Stride(primitive.position), asset.Data(primitive.indices),
+                          static_cast<int>(asset.ElementSize(primitive.indices)), indices.count, 1024, renderShape.occluder.get());
+        }
+        else
+        {
+            std::vector<float> unpacked(3 * positions.count);
+
+            for (size_t v = 0; v < positions.count; v++)
+                asset.Read(primitive.position, v, &unpacked[3 * v], 3);
+
+            BuildOccluder(reinterpret_cast<const uint8_t *>(unpacked.data()), 3 * sizeof(float), asset.Data(primitive.indices),
+                          static_cast<int>(asset.ElementSize(primitive.indices)), indices.count, 1024, renderShape.occluder.get());
+        }
+
+        const std::pair<const char*, int> images[] = {
+            {"diffuse", primitive.base_color_image},
+            {"normals", primitive.normal_image},
+        };
+
+        for (const auto &pair : images)
+        {
+            const auto &type = pair.first;
+
+            if (pair.second < 0)
+                continue;
+
+            // decoded by ParseModel, or here one at a time
+            std::string name = asset.ImageName(pair.second);
+            auto image = model.images.find(name);
+
+            ImageData decoded;
+            const ImageData *pixels = (image != model.images.end()) ? &image->second : nullptr;
+
+            if (pixels == nullptr && _textureNames.find(name) == _textureNames.end())
+            {
+                if (!asset.DecodeImage(pair.second, &decoded))
+                    continue;
+
+                pixels = &decoded;
+            }
+
+            TextureHandle texture = loadTexture(name, GL_TEXTURE_2D, objectName, primitive.name, type, pixels);
+
+            if (texture.IsValid())
+                owned.textures.push_back(texture);
+
+            renderShape.texture[type] = GetTextureID(texture);
+
+            if (renderShape.texture[type] > 0)
+                renderShape.has_textures = true;
+        }
+
+        owned.arrays.push_back(renderShape.VAO);
+        owned.arrays.push_back(renderShape.depthVAO);
+
+        renderObject.shapes.push_back(std::move(renderShape));
+    }
+
+    // the GPU has the data, the mapping can go
+    model.gltf.reset();
+}
+
+bool hzgl::ResourceManager::Unload(MeshHandle handle)
+{
+    Model model;
+
+    if (!_models.Remove(handle, &model))
+    {
+        HZGL_LOG_ERROR("Stale model handle.")
+        return false;
+    }
+
+    HZGL_PROFILE_SCOPE("UnloadModel");
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // the driver defers the deletion until pending draws are done
+    glDeleteBuffers(static_cast<GLsizei>(model.buffers.size()), model.buffers.data());
+    glDeleteVertexArrays(static_cast<GLsizei>(model.arrays.size()), model.arrays.data());
+
+    for (GLuint id : model.buffers)
+        UntrackGpuResource(HZGL_GPU_BUFFER, id);
+
+    for (TextureHandle texture : model.textures)
+        Unload(texture);
+
+    auto mesh = std::find(_loadedMeshes.begin(), _loadedMeshes.end(), model.path);
+    if (mesh != _loadedMeshes.end())
+        _loadedMeshes.erase(mesh);
+
+    // a duplicate loaded later under the same name may have taken it over
+    auto name = _modelNames.find(model.name);
+    if (name != _modelNames.end() && name->second == handle)
+        _modelNames.erase(name);
+
+    return true;
+}
+
+bool hzgl::ResourceManager::Unload(TextureHandle handle)
+{
+    Texture *texture = _textures.Get(handle);
+
+    if (texture == nullptr)
+    {
+        HZGL_LOG_ERROR("Stale texture handle.")
+        return false;
+    }
+
+    if (--texture->refs > 0)
+        return true;
+
+    glDeleteTextures(1, &texture->info.id);
+    UntrackGpuResource(HZGL_GPU_TEXTURE, texture->info.id);
+
+    _loadedTextures.erase(std::remove(_loadedTextures.begin(), _loadedTextures.end(), texture->filepath), _loadedTextures.end());
+    _textureNames.erase(texture->filepath);
+    _textures.Remove(handle);
+
+    return true;
+}
+
+bool hzgl::ResourceManager::Unload(ShaderHandle handle)
+{
+    ShaderInfo *shader = _shaders.Get(handle);
+
+    if (shader == nullptr)
+    {
+        HZGL_LOG_ERROR("Stale shader handle.")
+        return false;
+    }
+
+    // programs it is attached to keep working, the driver deletes it when they go
+    glDeleteShader(shader->id);
+
+    _shaderNames.erase(shader->filepath);
+    _shaders.Remove(handle);
+
+    return true;
+}
+
+bool hzgl::ResourceManager::Unload(ProgramHandle handle)
+{
+    ProgramInfo *program = _programs.Get(handle);
+
+    if (program == nullptr)
+    {
+        HZGL_LOG_ERROR("Stale program handle.")
+        return false;
+    }
+
+    DeleteShaderProgram(program->id);
+    UntrackGpuResource(HZGL_GPU_PROGRAM, program->id);
+
+    auto name = std::find(_loadedPrograms.begin(), _loadedPrograms.end(), program->name);
+    if (name != _loadedPrograms.end())
+        _loadedPrograms.erase(name);
+
+    _programNames.erase(program->name);
+    _programs.Remove(handle);
+
+    return true;
+}
+
+bool hzgl::ResourceManager::Unload(RenderObject &object)
+{
+    bool unloaded = Unload(object.handle);
+
+    // swap with empty ones so that the capacity goes too, not only the size
+    std::vector<RenderShape>().swap(object.shapes);
+    std::vector<NodeInfo>().swap(object.nodes);
+    object.num_shapes = 0;
+    object.handle = MeshHandle();
+
+    return unloaded;
+}
+
+bool hzgl::ResourceManager::UnloadModel(const std::string &name)
+{
+    auto object = _modelNames.find(name);
+
+    if (object == _modelNames.end())
+    {
+        HZGL_LOG_ERROR("Invalid name.")
+        return false;
+    }
+
+    return Unload(object->second);
 }
 
 std::vector<std::string> hzgl::ResourceManager::GetLoadedMeshesNames()
@@ -260,6 +941,35 @@ std::vector<std::string> hzgl::ResourceManager::GetLoadedShaderProgramNames()
     return _loadedPrograms;
 }
 
+GLuint hzgl::ResourceManager::GetTextureID(TextureHandle handle) const
+{
+    const Texture *texture = _textures.Get(handle);
+    return (texture != nullptr) ? texture->info.id : 0;
+}
+
+GLuint hzgl::ResourceManager::GetShaderID(ShaderHandle handle) const
+{
+    const ShaderInfo *shader = _shaders.Get(handle);
+    return (shader != nullptr) ? shader->id : 0;
+}
+
+GLuint hzgl::ResourceManager::GetProgramID(ProgramHandle handle) const
+{
+    const ProgramInfo *program = _programs.Get(handle);
+    return (program != nullptr) ? program->id : 0;
+}
+
+const hzgl::TextureInfo* hzgl::ResourceManager::GetTextureInfo(TextureHandle handle) const
+{
+    const Texture *texture = _textures.Get(handle);
+    return (texture != nullptr) ? &texture->info : nullptr;
+}
+
+const hzgl::ProgramInfo* hzgl::ResourceManager::GetProgramInfo(ProgramHandle handle) const
+{
+    return _programs.Get(handle);
+}
+
 GLuint hzgl::ResourceManager::GetProgramID(int index)
 {
     if (index < 0 || index >= _loadedPrograms.size())
@@ -275,13 +985,15 @@ GLuint hzgl::ResourceManager::GetProgramID(int index)
 
 GLuint hzgl::ResourceManager::GetProgramID(const std::string& name)
 {
-    if (_programInfo.find(name) == _programInfo.end())
+    auto program = _programNames.find(name);
+
+    if (program == _programNames.end())
     {
         HZGL_LOG_ERROR("Invalid name.")
         return 0;
     }
 
-    return _programInfo[name].id;
+    return GetProgramID(program->second);
 }
 
 const hzgl::ProgramInfo& hzgl::ResourceManager::GetProgramInfo(int index)
@@ -299,13 +1011,15 @@ const hzgl::ProgramInfo& hzgl::ResourceManager::GetProgramInfo(int index)
 
 const hzgl::ProgramInfo& hzgl::ResourceManager::GetProgramInfo(const std::string& name)
 {
-    if (_programInfo.find(name) == _programInfo.end())
+    auto program = _programNames.find(name);
+
+    if (program == _programNames.end())
     {
         HZGL_LOG_ERROR("Invalid name.")
         return GetProgramInfo(0);
     }
 
-    return _programInfo[name];
+    return *_programs.Get(program->second);
 }
 
 GLuint hzgl::ResourceManager::GetTextureID(int index)
@@ -323,13 +1037,15 @@ GLuint hzgl::ResourceManager::GetTextureID(int index)
 
 GLuint hzgl::ResourceManager::GetTextureID(const std::string& name)
 {
-    if (_textureInfo.find(name) == _textureInfo.end())
+    auto texture = _textureNames.find(name);
+
+    if (texture == _textureNames.end())
     {
         HZGL_LOG_ERROR("Invalid name.")
         return 0;
     }
 
-    return _textureInfo[name].id;
+    return GetTextureID(texture->second);
 }
 
 int hzgl::ResourceManager::GetTextureWidth(int index){
@@ -346,13 +1062,15 @@ int hzgl::ResourceManager::GetTextureWidth(int index){
 
 int hzgl::ResourceManager::GetTextureWidth(const std::string& name)
 {
-    if (_textureInfo.find(name) == _textureInfo.end())
+    auto texture = _textureNames.find(name);
+
+    if (texture == _textureNames.end())
     {
         HZGL_LOG_ERROR("Invalid name.")
         return 0;
     }
 
-    return _textureInfo[name].width;
+    return _textures.Get(texture->second)->info.width;
 }
 
 int hzgl::ResourceManager::GetTextureHeight(int index){
@@ -369,13 +1087,15 @@ int hzgl::ResourceManager::GetTextureHeight(int index){
 
 int hzgl::ResourceManager::GetTextureHeight(const std::string& name)
 {
-    if (_textureInfo.find(name) == _textureInfo.end())
+    auto texture = _textureNames.find(name);
+
+    if (texture == _textureNames.end())
     {
         HZGL_LOG_ERROR("Invalid name.")
         return 0;
     }
 
-    return _textureInfo[name].height;
+    return _textures.Get(texture->second)->info.height;
 }
 
 #undef HZGL_LOG_ERROR
@@ -1,9 +1,14 @@
 #pragma once
 
 #include "Mesh.hpp"
+#include "Handle.hpp"
 #include "Shader.hpp"
 #include "Texture.hpp"
+#include "Gltf.hpp"
+#include "Occlusion.hpp"
+#include "ThreadPool.hpp"
 
+#include <memory>
 #include <string>
 #include <unordered_map>
 
@@ -19,24 +24,57 @@ namespace hzgl
         int num_vertices = 0;
         bool has_normals = false;
         bool has_texcoords = false;
+        bool has_tangents = false;  // QTangents in attribute 3, the normals come from them (attribute 1 is off)
         bool has_textures = false;
+        int node = -1;              // index into RenderObject::nodes
+
+        // Occlusion culling (object space)
+        BoundingBox bounds;
+        std::unique_ptr<OccluderMesh> occluder;
 
         // OpenGL related
         GLuint VAO = 0;
+        GLuint depthVAO = 0;        // position stream only, for depth-only passes
         GLuint EBO = 0;
+        GLenum index_type = GL_UNSIGNED_INT;
+        size_t index_offset = 0;    // bytes into the EBO (a glTF buffer view holds more than one mesh)
         ShadingMode shading_mode;
         std::unordered_map<std::string, GLuint> texture;
     } RenderShape;
 
+    // move-only: the GL objects belong to the resource manager, which frees them when the handle
+    // is unloaded, and a copy would outlive them
     typedef struct _RenderObject
     {
         // Metadata
         std::string path = "";
         int num_shapes = 0;
+        MeshHandle handle;              // see ResourceManager::Unload
 
         std::vector<RenderShape> shapes;
+        std::vector<NodeInfo> nodes;    // imported hierarchy (see SceneGraph::AddNodes)
+
+        _RenderObject() = default;
+        _RenderObject(const _RenderObject&) = delete;
+        _RenderObject& operator=(const _RenderObject&) = delete;
+        _RenderObject(_RenderObject&&) = default;
+        _RenderObject& operator=(_RenderObject&&) = default;
     } RenderObject;
 
+    // CPU side of a model: everything that can be prepared without an OpenGL context
+    typedef struct _ParsedModel
+    {
+        std::string path = "";
+        std::vector<MeshInfo> shapes;
+        std::vector<NodeInfo> nodes;
+        std::unordered_map<std::string, ImageData> images;  // texture path -> decoded pixels
+        std::shared_ptr<GltfAsset> gltf;                    // glTF read in place, shapes only for primitives that need tangents
+    } ParsedModel;
+
+    // parse a model file (and optionally decode its textures); safe to call from worker threads,
+    // large meshes are split across pool (see LoadMeshesFromFile)
+    void ParseModel(const std::string& filepath, ParsedModel& model, bool decodeTextures = true, ThreadPool* pool = nullptr);
+
     typedef struct _ShaderInfo
     {
         GLuint id = 0;
@@ -48,42 +86,111 @@ namespace hzgl
         GLuint id = 0;
         std::string name = "";
         std::vector<ShaderStage> stages;
+        bool finished = false;      // status asked for (see ResourceManager::FinishShaderPrograms)
+        bool linked = false;
         // TODO: a list of uniform variables
     } ProgramInfo;
 
     class ResourceManager
     {
     private:
-        std::vector<GLuint> _usedVAOs;                // OpenGL handle
-        std::vector<GLuint> _usedVBOs;                // OpenGL handle
+        typedef struct
+        {
+            TextureInfo info;
+            std::string filepath;
+            int refs = 0;                           // shapes (and LoadTexture calls) using it
+        } Texture;
+
+        typedef struct
+        {
+            std::string name;                       // given to LoadModel
+            std::string path;
+            std::vector<GLuint> buffers;            // VBOs and EBOs
+            std::vector<GLuint> arrays;             // VAOs
+            std::vector<TextureHandle> textures;    // one reference each
+        } Model;
+
+        HandlePool<Model, MeshTag> _models;
+        HandlePool<Texture, TextureTag> _textures;
+        HandlePool<ShaderInfo, ShaderTag> _shaders;
+        HandlePool<ProgramInfo, ProgramTag> _programs;
+
+        std::unordered_map<std::string, MeshHandle> _modelNames;
+        std::unordered_map<std::string, TextureHandle> _textureNames;   // by filepath
+        std::unordered_map<std::string, ShaderHandle> _shaderNames;     // by filepath
+        std::unordered_map<std::string, ProgramHandle> _programNames;
+
+        // in load order, for the getters by index
         std::vector<std::string> _loadedMeshes;       // filepath of the 3D model
-        std::vector<std::string> _loadedShaders;      // filepath of the shader source
         std::vector<std::string> _loadedTextures;     // filepath of the texture image
         std::vector<std::string> _loadedPrograms;     // unique "name" for the program
 
-        std::unordered_map<std::string, ShaderInfo> _shaderInfo;
-        std::unordered_map<std::string, ProgramInfo> _programInfo;
-        std::unordered_map<std::string, TextureInfo> _textureInfo;
-        std::unordered_map<std::string, RenderObject> _renderObjects;
+        std::unique_ptr<ThreadPool> _meshWorkers;    // large models are parsed on these (none on one core)
+        bool _meshWorkersStarted;
+
+        // the workers, started by the first model loaded (nullptr on one core)
+        ThreadPool* meshWorkers();
+
+        // owner/shape/label group the texture in the memory registry
+        TextureHandle loadTexture(const std::string& filepath, GLenum type, const std::string& owner, const std::string& shape, const std::string& label,
+                                  const ImageData* image = nullptr);
+        MeshHandle uploadModel(ParsedModel& model, const std::string& objectName, std::vector<RenderObject>& objects);
+        void uploadGltf(ParsedModel& model, const std::string& objectName, Model& owned, RenderObject& renderObject);
 
     public:
         ResourceManager();
         ~ResourceManager();
 
-        // manual memory release
+        ResourceManager(const ResourceManager&) = delete;
+        ResourceManager& operator=(const ResourceManager&) = delete;
+
+        // manual memory release; every handle given out so far becomes stale
         void ReleaseAll();
 
-        // loading assets from files
-        GLuint LoadTexture(const std::string& filepath, GLenum type);
-        GLuint LoadShader(const std::string& filepath, GLenum shaderType);
-        GLuint LoadShaderProgram(std::vector<ShaderStage> shaders, const char* name = nullptr);
-        void LoadModel(const std::string& filepath, std::vector<RenderObject>& objects, const char* name = nullptr, bool duplicateAllowed = false);
+        // loading assets from files; asking for a file again gives the handle it already has (for
+        // textures that is one more reference, to be given back through Unload)
+        TextureHandle LoadTexture(const std::string& filepath, GLenum type);
+        ShaderHandle LoadShader(const std::string& filepath, GLenum shaderType);
+        ProgramHandle LoadShaderProgram(std::vector<ShaderStage> shaders, const char* name = nullptr);
+
+        // programs are linked without waiting for the driver: this asks for the status of the
+        // ones that are done (or of all, waiting for them) and returns how many are still building
+        int FinishShaderPrograms(bool wait);
+
+        // an invalid handle if a model was loaded under the same name before (and duplicateAllowed
+        // is false); the name is the filepath unless one is given
+        MeshHandle LoadModel(const std::string& filepath, std::vector<RenderObject>& objects, const char* name = nullptr, bool duplicateAllowed = false);
+
+        // upload a model prepared by ParseModel; the CPU geometry is released as it goes
+        MeshHandle LoadModel(ParsedModel& model, std::vector<RenderObject>& objects, const char* name = nullptr, bool duplicateAllowed = false);
+
+        // free what the handle stands for; false if it is stale. A model takes its buffers and
+        // VAOs and one reference of each of its textures with it, a texture goes once the last
+        // reference does
+        bool Unload(MeshHandle handle);
+        bool Unload(TextureHandle handle);
+        bool Unload(ShaderHandle handle);
+        bool Unload(ProgramHandle handle);
+
+        // the same for the model of a RenderObject, whose CPU side (shapes, occluders, nodes) is
+        // released too; the object is left empty, for the caller to erase
+        bool Unload(RenderObject& object);
+
+        // name is the one given to LoadModel (the filepath by default)
+        bool UnloadModel(const std::string& name);
 
         // public getters
         std::vector<std::string> GetLoadedMeshesNames();
         std::vector<std::string> GetLoadedTextureNames();
         std::vector<std::string> GetLoadedShaderProgramNames();
 
+        // 0 (or nullptr) for stale handles
+        GLuint GetTextureID(TextureHandle handle) const;
+        GLuint GetShaderID(ShaderHandle handle) const;
+        GLuint GetProgramID(ProgramHandle handle) const;
+        const TextureInfo* GetTextureInfo(TextureHandle handle) const;
+        const ProgramInfo* GetProgramInfo(ProgramHandle handle) const;
+
         GLuint GetProgramID(int index);
         GLuint GetProgramID(const std::string& name);
 
@@ -0,0 +1,426 @@
+#include "Scene.hpp"
+
+#include "Timer.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #define HZGL_SCENE_SSE
+    #include <xmmintrin.h>
+#endif
+
+// out = a * b for column-major 4x4 matrices (out must not alias a or b)
+static void hzglMultiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+{
+#ifdef HZGL_SCENE_SSE
+    const float* pa = glm::value_ptr(a);
+    const float* pb = glm::value_ptr(b);
+    float* po = glm::value_ptr(out);
+
+    __m128 a0 = _mm_loadu_ps(pa + 0);
+    __m128 a1 = _mm_loadu_ps(pa + 4);
+    __m128 a2 = _mm_loadu_ps(pa + 8);
+    __m128 a3 = _mm_loadu_ps(pa + 12);
+
+    // each column of the result is a combination of the columns of a
+    for (int c = 0; c < 4; c++)
+    {
+        __m128 col = _mm_mul_ps(a0, _mm_set1_ps(pb[4 * c + 0]));
+        col = _mm_add_ps(col, _mm_mul_ps(a1, _mm_set1_ps(pb[4 * c + 1])));
+        col = _mm_add_ps(col, _mm_mul_ps(a2, _mm_set1_ps(pb[4 * c + 2])));
+        col = _mm_add_ps(col, _mm_mul_ps(a3, _mm_set1_ps(pb[4 * c + 3])));
+        _mm_storeu_ps(po + 4 * c, col);
+    }
+#else
+    out = a * b;
+#endif
+}
+
+static void hzglUpdateWorld(const int* positions, size_t count, const int* parent, const glm::mat4* local, glm::mat4* world)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        int p = positions[i];
+
+        if (parent[p] < 0)
+            world[p] = local[p];
+        else
+            hzglMultiply(world[parent[p]], local[p], world[p]);
+    }
+}
+
+// handed out for invalid handles instead of reading out of bounds
+static const glm::mat4 g_identity(1.0f);
+
+const char* hzgl::SceneSimdPath()
+{
+#ifdef HZGL_SCENE_SSE
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
+
+hzgl::SceneGraph::SceneGraph(int numThreads, int parallelThreshold)
+    : _structureChanged(false), _pass(0), _numLevels(0), _parallelThreshold(std::max(parallelThreshold, 1))
+{
+    if (numThreads > 0)
+        _workers.reset(new ThreadPool(numThreads, 0, "Scene"));
+}
+
+hzgl::SceneGraph::~SceneGraph()
+{
+}
+
+hzgl::NodeId hzgl::SceneGraph::AddNode(NodeId parent, const glm::mat4& local)
+{
+    NodeId id;
+
+    if (!_freeIds.empty())
+    {
+        id = _freeIds.back();
+        _freeIds.pop_back();
+    }
+    else
+    {
+        id = static_cast<NodeId>(_position.size());
+        _position.push_back(-1);
+    }
+
+    // appended for now (parents still come first); relayout() restores the level order
+    int position = static_cast<int>(_parent.size());
+    int parentPosition = IsValid(parent) ? _position[parent] : -1;
+
+    _parent.push_back(parentPosition);
+    _firstChild.push_back(0);
+    _numChildren.push_back(0);
+    _depth.push_back(parentPosition >= 0 ? _depth[parentPosition] + 1 : 0);
+    _id.push_back(id);
+    _local.push_back(local);
+    _world.push_back(local);
+    _visited.push_back(0);
+    _alive.push_back(1);
+
+    _position[id] = position;
+    _structureChanged = true;
+
+    return id;
+}
+
+void hzgl::SceneGraph::AddNodes(NodeId parent, const std::vector<NodeInfo>& nodes, std::vector<NodeId>& ids)
+{
+    ids.resize(nodes.size());
+
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        // importers list parents first; anything else is attached to parent directly
+        int p = nodes[i].parent;
+        NodeId nodeParent = (p >= 0 && p < static_cast<int>(i)) ? ids[p] : parent;
+
+        ids[i] = AddNode(nodeParent, glm::make_mat4(nodes[i].transform));
+    }
+}
+
+void hzgl::SceneGraph::RemoveSubtree(NodeId node)
+{
+    if (!IsValid(node))
+        return;
+
+    int first = _position[node];
+    _alive[first] = 0;
+
+    // parents come before children, so one forward sweep reaches every descendant
+    for (size_t i = first + 1; i < _parent.size(); i++)
+    {
+        if (_alive[i] && _parent[i] >= first && !_alive[_parent[i]])
+            _alive[i] = 0;
+    }
+
+    for (size_t i = first; i < _parent.size(); i++)
+    {
+        if (!_alive[i] && _position[_id[i]] == static_cast<int>(i))
+        {
+            _position[_id[i]] = -1;
+            _freeIds.push_back(_id[i]);
+        }
+    }
+
+    _structureChanged = true;
+}
+
+void hzgl::SceneGraph::Clear()
+{
+    _parent.clear();
+    _firstChild.clear();
+    _numChildren.clear();
+    _depth.clear();
+    _id.clear();
+    _local.clear();
+    _world.clear();
+    _visited.clear();
+    _alive.clear();
+    _position.clear();
+    _freeIds.clear();
+    _queued.clear();
+
+    _structureChanged = false;
+    _numLevels = 0;
+    _stats = SceneStats();
+}
+
+void hzgl::SceneGraph::SetLocal(NodeId node, const glm::mat4& local)
+{
+    if (!IsValid(node))
+        return;
+
+    int position = _position[node];
+
+    _local[position] = local;
+    _queued.push_back(position);
+}
+
+const glm::mat4& hzgl::SceneGraph::Local(NodeId node) const
+{
+    return IsValid(node) ? _local[_position[node]] : g_identity;
+}
+
+const glm::mat4& hzgl::SceneGraph::World(NodeId node) const
+{
+    return IsValid(node) ? _world[_position[node]] : g_identity;
+}
+
+hzgl::NodeId hzgl::SceneGraph::Parent(NodeId node) const
+{
+    if (!IsValid(node))
+        return InvalidNode;
+
+    int parent = _parent[_position[node]];
+    return parent >= 0 ? _id[parent] : InvalidNode;
+}
+
+bool hzgl::SceneGraph::IsValid(NodeId node) const
+{
+    return node >= 0 && node < static_cast<NodeId>(_position.size()) && _position[node] >= 0;
+}
+
+int hzgl::SceneGraph::Size() const
+{
+    return static_cast<int>(_position.size() - _freeIds.size());
+}
+
+void hzgl::SceneGraph::relayout()
+{
+    HZGL_PROFILE_SCOPE("SceneGraph::relayout");
+
+    int n = static_cast<int>(_parent.size());
+
+    // children of every live node as ranges of one array (in insertion order)
+    std::vector<int> childStart(n + 1, 0);
+    for (int i = 0; i < n; i++)
+    {
+        if (_alive[i] && _parent[i] >= 0)
+            childStart[_parent[i] + 1]++;
+    }
+
+    for (int i = 0; i < n; i++)
+        childStart[i + 1] += childStart[i];
+
+    std::vector<int> fill(childStart.begin(), childStart.end() - 1);
+    _scratch.resize(childStart[n]);
+
+    for (int i = 0; i < n; i++)
+    {
+        if (_alive[i] && _parent[i] >= 0)
+            _scratch[fill[_parent[i]]++] = i;
+    }
+
+    // breadth-first order: roots, then every level in turn
+    std::vector<int> order;
+    order.reserve(n);
+
+    for (int i = 0; i < n; i++)
+    {
+        if (_alive[i] && _parent[i] < 0)
+            order.push_back(i);
+    }
+
+    std::vector<int> newPosition(n, -1);
+    std::vector<int> firstChild, numChildren;
+    firstChild.reserve(n);
+    numChildren.reserve(n);
+
+    for (size_t head = 0; head < order.size(); head++)
+    {
+        int old = order[head];
+        newPosition[old] = static_cast<int>(head);
+
+        firstChild.push_back(static_cast<int>(order.size()));
+        numChildren.push_back(childStart[old + 1] - childStart[old]);
+
+        for (int c = childStart[old]; c < childStart[old + 1]; c++)
+            order.push_back(_scratch[c]);
+    }
+
+    int m = static_cast<int>(order.size());
+
+    std::vector<int> parent(m), depth(m);
+    std::vector<NodeId> id(m);
+    std::vector<glm::mat4> local(m);
+
+    _numLevels = 0;
+
+    for (int p = 0; p < m; p++)
+    {
+        int old = order[p];
+
+        parent[p] = _parent[old] >= 0 ? newPosition[_parent[old]] : -1;
+        depth[p] = parent[p] >= 0 ? depth[parent[p]] + 1 : 0;
+        id[p] = _id[old];
+        local[p] = _local[old];
+
+        _position[id[p]] = p;
+        _numLevels = std::max(_numLevels, depth[p] + 1);
+    }
+
+    _parent.swap(parent);
+    _firstChild.swap(firstChild);
+    _numChildren.swap(numChildren);
+    _depth.swap(depth);
+    _id.swap(id);
+    _local.swap(local);
+
+    _world.resize(m);
+    _visited.assign(m, 0);
+    _alive.assign(m, 1);
+
+    // everything moved, so every root (and with it the whole scene) is recomputed
+    _queued.clear();
+    for (int p = 0; p < m && _parent[p] < 0; p++)
+        _queued.push_back(p);
+
+    _structureChanged = false;
+}
+
+void hzgl::SceneGraph::updateLevel(const std::vector<int>& positions)
+{
+    size_t count = positions.size();
+    _stats.updated += static_cast<int>(count);
+
+    if (_workers == nullptr || count < static_cast<size_t>(_parallelThreshold))
+    {
+        hzglUpdateWorld(positions.data(), count, _parent.data(), _local.data(), _world.data());
+        return;
+    }
+
+    // nodes of one level only read the level above, so the level splits into independent chunks
+    size_t numTasks = static_cast<size_t>(_workers->NumThreads());
+    size_t chunk = (count + numTasks - 1) / numTasks;
+
+    for (size_t begin = 0; begin < count; begin += chunk)
+    {
+        const int* first = positions.data() + begin;
+        size_t num = std::min(chunk, count - begin);
+
+        _workers->Submit([this, first, num]() {
+            hzglUpdateWorld(first, num, _parent.data(), _local.data(), _world.data());
+        });
+    }
+
+    _workers->Wait();
+    _stats.parallel_levels++;
+}
+
+void hzgl::SceneGraph::Update()
+{
+    HZGL_PROFILE_SCOPE("SceneGraph::Update");
+
+    SimpleTimer updateTimer;
+    updateTimer.Start();
+
+    _stats.relayout = _structureChanged;
+    _stats.updated = 0;
+    _stats.parallel_levels = 0;
+
+    if (_structureChanged)
+        relayout();
+
+    if (!_queued.empty())
+    {
+        _pass++;
+
+        // positions follow the level order, so sorting them also sorts them by depth
+        std::sort(_queued.begin(), _queued.end());
+        _queued.erase(std::unique(_queued.begin(), _queued.end()), _queued.end());
+
+        size_t q = 0;
+        int depth = 0;
+        _level.clear();
+
+        while (q < _queued.size() || !_level.empty())
+        {
+            // nothing left from the levels above: jump to the next queued node
+            if (_level.empty())
+                depth = _depth[_queued[q]];
+
+            for (; q < _queued.size() && _depth[_queued[q]] == depth; q++)
+            {
+                int p = _queued[q];
+
+                // already reached through a queued ancestor
+                if (_visited[p] == _pass)
+                    continue;
+
+                _visited[p] = _pass;
+                _level.push_back(p);
+            }
+
+            updateLevel(_level);
+
+            // the children of this level form the next one
+            _nextLevel.clear();
+            for (int p : _level)
+            {
+                for (int c = _firstChild[p]; c < _firstChild[p] + _numChildren[p]; c++)
+                {
+                    _visited[c] = _pass;
+                    _nextLevel.push_back(c);
+                }
+            }
+
+            _level.swap(_nextLevel);
+            depth++;
+        }
+
+        _queued.clear();
+    }
+
+    _stats.nodes = static_cast<int>(_parent.size());
+    _stats.levels = _numLevels;
+    _stats.update_ms = 1000.0 * updateTimer.End();
+}
+
+const hzgl::SceneStats& hzgl::SceneGraph::Stats() const
+{
+    return _stats;
+}
+
+void hzgl::AddInstanceGrid(std::vector<SceneInstance>& instances, int object, int material, int n, float spacing)
+{
+    instances.reserve(instances.size() + static_cast<size_t>(n) * n);
+
+    for (int row = 0; row < n; row++)
+    {
+        for (int col = 0; col < n; col++)
+        {
+            SceneInstance instance;
+            instance.object = object;
+            instance.material = material;
+            instance.position = glm::vec3((col - 0.5f * (n - 1)) * spacing, 0.0f, -(row + 1) * spacing);
+
+            instances.push_back(instance);
+        }
+    }
+}
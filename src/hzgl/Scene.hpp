@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Mesh.hpp"
+#include "ThreadPool.hpp"
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+namespace hzgl
+{
+    // stable handle of a scene node (survives the re-ordering done by SceneGraph::Update)
+    typedef int NodeId;
+    const NodeId InvalidNode = -1;
+
+    typedef struct
+    {
+        int nodes = 0;
+        int levels = 0;
+        int updated = 0;                  // world matrices recomputed by the last Update()
+        int parallel_levels = 0;          // levels wide enough to be split across the workers
+        bool relayout = false;            // nodes were added or removed since the previous Update()
+        double update_ms = 0.0;
+    } SceneStats;
+
+    // transform hierarchy kept as structure of arrays in level order: parents come before their
+    // children and the children of a node are contiguous. Changing a local transform only queues
+    // the node; Update() then walks the dirty subtrees one level at a time, so its cost follows
+    // what changed rather than the size of the scene. Nothing here touches OpenGL.
+    class SceneGraph
+    {
+    private:
+        // per node, indexed by position in level order
+        std::vector<int> _parent;          // -1 for roots
+        std::vector<int> _firstChild;
+        std::vector<int> _numChildren;
+        std::vector<int> _depth;
+        std::vector<NodeId> _id;           // position -> handle
+        std::vector<glm::mat4> _local;
+        std::vector<glm::mat4> _world;
+        std::vector<uint32_t> _visited;    // last update pass that reached the node
+        std::vector<char> _alive;
+
+        // per handle
+        std::vector<int> _position;        // handle -> position, -1 for free handles
+        std::vector<NodeId> _freeIds;
+
+        std::vector<int> _queued;          // positions whose local transform changed
+        std::vector<int> _level;           // scratch: positions of the level being updated
+        std::vector<int> _nextLevel;
+        std::vector<int> _scratch;         // scratch for relayout()
+
+        bool _structureChanged;
+        uint32_t _pass;
+        int _numLevels;
+        int _parallelThreshold;
+
+        std::unique_ptr<ThreadPool> _workers;
+        SceneStats _stats;
+
+        void relayout();
+        void updateLevel(const std::vector<int>& positions);
+
+    public:
+        // numThreads 0 updates on the calling thread; levels with at least parallelThreshold
+        // dirty nodes are split across the workers
+        explicit SceneGraph(int numThreads = 0, int parallelThreshold = 8192);
+        ~SceneGraph();
+
+        SceneGraph(const SceneGraph&) = delete;
+        SceneGraph& operator=(const SceneGraph&) = delete;
+
+        NodeId AddNode(NodeId parent, const glm::mat4& local = glm::mat4(1.0f));
+
+        // add an imported hierarchy (NodeInfo::parent indexes into nodes) below parent;
+        // ids receives the handle of every entry of nodes
+        void AddNodes(NodeId parent, const std::vector<NodeInfo>& nodes, std::vector<NodeId>& ids);
+
+        // remove a node together with everything below it
+        void RemoveSubtree(NodeId node);
+        void Clear();
+
+        void SetLocal(NodeId node, const glm::mat4& local);
+        const glm::mat4& Local(NodeId node) const;
+
+        // valid after Update()
+        const glm::mat4& World(NodeId node) const;
+
+        NodeId Parent(NodeId node) const;
+        bool IsValid(NodeId node) const;
+        int Size() const;
+
+        // recompute the world matrices of every queued node and its descendants
+        void Update();
+
+        const SceneStats& Stats() const;
+    };
+
+    // a model placed in the scene: a root node with its own transform and material, and the
+    // imported hierarchy of the model below it
+    typedef struct
+    {
+        int object = -1;                  // index into the RenderObject list
+        int material = 0;
+        NodeId root = InvalidNode;
+        std::vector<NodeId> nodes;        // handle of every RenderObject::nodes entry
+
+        glm::vec3 position = glm::vec3(0.0f);
+        glm::vec3 rotation = glm::vec3(0.0f);   // Euler angles in degrees
+        float scale = 1.0f;
+        bool dirty = true;                      // position, rotation or scale changed since the last draw
+    } SceneInstance;
+
+    // append n x n instances of an object in rows behind the origin (their nodes are created
+    // the first time they are drawn)
+    void AddInstanceGrid(std::vector<SceneInstance>& instances, int object, int material, int n, float spacing);
+
+    // "SSE" or "scalar", whichever the matrix products were compiled with
+    const char* SceneSimdPath();
+} // namespace hzgl
@@ -0,0 +1,357 @@
+#include "Screenshot.hpp"
+
+#include "Profiler.hpp"
+#include "Readback.hpp"
+#include "ThreadPool.hpp"
+#include "Framebuffer.hpp"
+
+#include <ctime>
+#include <atomic>
+#include <memory>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+
+// disable MSVC warnings
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#endif
+
+typedef struct
+{
+    hzgl::ScreenshotOptions options;
+    std::unique_ptr<hzgl::AsyncReadback> readback;
+    std::unique_ptr<hzgl::ThreadPool> encoder;
+    std::unordered_map<uint64_t, std::string> filepaths;  // tag -> output file
+    uint64_t nextTag = 0;
+    std::string lastStem;
+    int stemCount = 0;
+    int dropped = 0;
+    std::atomic<int> saved{0};
+} hzglScreenshotState;
+
+static hzglScreenshotState& hzglScreenshots()
+{
+    static hzglScreenshotState state;
+    return state;
+}
+
+std::string hzgl::TimestampStem(const std::string& prefix)
+{
+    const std::time_t now = std::time(nullptr);
+
+    const std::tm *now_tm = std::localtime(&now);
+
+    int year = now_tm->tm_year + 1900;
+    int month = now_tm->tm_mon + 1;
+    int day = now_tm->tm_mday;
+    int hour = now_tm->tm_hour;
+    int minute = now_tm->tm_min;
+    int second = now_tm->tm_sec;
+
+    std::stringstream timestamp;
+
+    timestamp << prefix
+              << "-" << year << "-" << month << "-" << day
+              << "-" << hour << "-" << minute << "-" << second;
+
+    return timestamp.str();
+}
+
+void hzgl::SetScreenshotOptions(const ScreenshotOptions& options)
+{
+    auto& state = hzglScreenshots();
+
+    if (state.readback == nullptr)
+        state.options = options;
+}
+
+bool hzgl::TakeScreenshot(int x, int y, int w, int h, GLenum readBuffer, const std::string& filepath)
+{
+    HZGL_PROFILE_SCOPE("TakeScreenshot");
+
+    auto& state = hzglScreenshots();
+
+    if (state.readback == nullptr)
+    {
+        SetPNGCompressionLevel(state.options.png.compression_level);
+        state.readback.reset(new AsyncReadback(state.options.max_in_flight));
+        state.encoder.reset(new ThreadPool(state.options.encoder_threads, state.options.max_queued, "Encoder"));
+    }
+
+    std::string path = filepath;
+
+    if (path.empty())
+    {
+        // a burst within the same second gets numbered files
+        std::string stem = TimestampStem("Screenshot");
+        state.stemCount = (stem == state.lastStem) ? state.stemCount + 1 : 0;
+        state.lastStem = stem;
+
+        path = (state.stemCount > 0) ? stem + "-" + std::to_string(state.stemCount) + ".png" : stem + ".png";
+    }
+
+    uint64_t tag = state.nextTag++;
+
+    if (!state.readback->Request(x, y, w, h, readBuffer, tag))
+    {
+        state.dropped++;
+        std::cerr << "Screenshot dropped: too many captures in flight" << std::endl;
+        return false;
+    }
+
+    state.filepaths[tag] = path;
+
+    return true;
+}
+
+void hzgl::UpdateScreenshots()
+{
+    auto& state = hzglScreenshots();
+
+    if (state.readback == nullptr || state.readback->NumPending() == 0)
+        return;
+
+    HZGL_PROFILE_SCOPE("UpdateScreenshots");
+
+    // leave images in their PBOs while the encoder queue is full (no stall, no drop)
+    size_t queued = state.encoder->QueueDepth();
+    size_t capacity = state.encoder->Capacity();
+    int room = (capacity == 0) ? -1 : static_cast<int>(capacity > queued ? capacity - queued : 0);
+
+    if (room == 0)
+        return;
+
+    std::vector<ReadbackImage> images;
+    std::vector<uint64_t> failed;
+    state.readback->Collect(images, false, room, &failed);
+
+    for (uint64_t tag : failed)
+    {
+        state.dropped++;
+        std::cerr << "Screenshot dropped: " << state.filepaths[tag] << " could not be read back" << std::endl;
+        state.filepaths.erase(tag);
+    }
+
+    for (auto& image : images)
+    {
+        std::string path = state.filepaths[image.tag];
+        state.filepaths.erase(image.tag);
+
+        PNGOptions png = state.options.png;
+        std::atomic<int>* saved = &state.saved;
+
+        state.encoder->Submit([image, path, png, saved]() {
+            HZGL_PROFILE_SCOPE("EncodeScreenshot");
+
+            if (WritePNG(path, image.pixels->data(), image.width, image.height, 4, png))
+            {
+                saved->fetch_add(1);
+                std::cout << "Screenshot saved to " << path << std::endl;
+            }
+        });
+    }
+}
+
+void hzgl::ShutdownScreenshots()
+{
+    auto& state = hzglScreenshots();
+
+    if (state.readback == nullptr)
+        return;
+
+    // whatever is still in flight is encoded right here
+    std::vector<ReadbackImage> images;
+    std::vector<uint64_t> failed;
+    state.readback->Collect(images, true, -1, &failed);
+
+    state.dropped += static_cast<int>(failed.size());
+
+    for (auto& image : images)
+    {
+        if (WritePNG(state.filepaths[image.tag], image.pixels->data(), image.width, image.height, 4, state.options.png))
+            state.saved.fetch_add(1);
+    }
+
+    state.encoder->Wait();
+
+    state.readback->Release();
+    state.readback.reset();
+    state.encoder.reset();
+    state.filepaths.clear();
+}
+
+hzgl::ScreenshotStats hzgl::GetScreenshotStats()
+{
+    auto& state = hzglScreenshots();
+
+    ScreenshotStats stats;
+    stats.saved = state.saved.load();
+    stats.dropped = state.dropped;
+
+    if (state.readback != nullptr)
+    {
+        stats.pending_readbacks = state.readback->NumPending();
+        stats.queued_encodes = state.encoder->QueueDepth();
+    }
+
+    return stats;
+}
+
+// box-filter a (supersampled) tile into its place in the band; both are bottom-up RGBA
+static void hzglPlaceTile(const hzgl::ReadbackImage& tile, int factor, int x0, int bandWidth, unsigned char* band)
+{
+    int width = tile.width / factor;
+    int height = tile.height / factor;
+    int weight = factor * factor;
+    const unsigned char* src = tile.pixels->data();
+
+    for (int y = 0; y < height; y++)
+    {
+        unsigned char* dst = band + (static_cast<size_t>(y) * bandWidth + x0) * 4;
+
+        for (int x = 0; x < width; x++)
+        {
+            int sum[4] = {0, 0, 0, 0};
+
+            for (int sy = 0; sy < factor; sy++)
+            {
+                const unsigned char* p = src + (static_cast<size_t>(y * factor + sy) * tile.width + x * factor) * 4;
+
+                for (int sx = 0; sx < factor; sx++, p += 4)
+                {
+                    sum[0] += p[0];
+                    sum[1] += p[1];
+                    sum[2] += p[2];
+                    sum[3] += p[3];
+                }
+            }
+
+            for (int c = 0; c < 4; c++)
+                dst[4 * x + c] = static_cast<unsigned char>((sum[c] + weight / 2) / weight);
+        }
+    }
+}
+
+bool hzgl::TakeTiledScreenshot(const std::string& filepath, Camera camera, const TileRenderFunc& render,
+                               const TiledScreenshotOptions& options)
+{
+    HZGL_PROFILE_SCOPE("TakeTiledScreenshot");
+
+    int width = options.width;
+    int height = options.height;
+    int factor = std::max(1, options.supersampling);
+
+    if (width <= 0 || height <= 0)
+    {
+        std::cerr << "Invalid size for a tiled screenshot" << std::endl;
+        return false;
+    }
+
+    // the largest tile the driver can render and attach
+    GLint maxViewport[2] = {0, 0};
+    GLint maxRenderbuffer = 0;
+    GLint maxTexture = 0;
+    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, maxViewport);
+    glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxRenderbuffer);
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexture);
+
+    int maxTile = std::max(1, std::min({maxViewport[0], maxViewport[1], maxRenderbuffer, maxTexture}) / factor);
+    int tileWidth = std::min({(options.tile_width > 0) ? options.tile_width : width, width, maxTile});
+    int tileHeight = std::min({std::max(options.tile_height, 1), height, maxTile});
+
+    GLint previousFBO = 0;
+    GLint viewport[4] = {0, 0, 0, 0};
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFBO);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    // one target for every tile
+    FrameBufferInfo fbInfo;
+    if (CreateFBO(tileWidth * factor, tileHeight * factor, &fbInfo) == 0)
+    {
+        DeleteFBO(&fbInfo);
+        glBindFramebuffer(GL_FRAMEBUFFER, previousFBO);
+        return false;
+    }
+
+    // bands are read back bottom-up, the writer flips them
+    PNGOptions png = options.png;
+    png.flip_vertically = true;
+
+    PNGStreamWriter writer;
+    if (!writer.Open(filepath, width, height, 4, png))
+    {
+        DeleteFBO(&fbInfo);
+        glBindFramebuffer(GL_FRAMEBUFFER, previousFBO);
+        return false;
+    }
+
+    std::cout << "Rendering a " << width << "x" << height << " screenshot in " << tileWidth << "x" << tileHeight << " tiles";
+    if (factor > 1)
+        std::cout << " at " << factor << "x" << factor << " supersampling";
+    std::cout << std::endl;
+
+    camera.aspect_ratio = static_cast<float>(width) / static_cast<float>(height);
+
+    AsyncReadback readback(2);
+    std::vector<ReadbackImage> tiles;
+    std::vector<unsigned char> band;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbInfo.id);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+
+    // the PNG is written top to bottom
+    for (int top = height; top > 0; top -= tileHeight)
+    {
+        int y0 = std::max(0, top - tileHeight);
+        int bandHeight = top - y0;
+
+        band.assign(static_cast<size_t>(width) * bandHeight * 4, 0);
+
+        for (int x0 = 0; x0 < width; x0 += tileWidth)
+        {
+            HZGL_PROFILE_SCOPE("RenderTile");
+
+            int w = std::min(tileWidth, width - x0);
+
+            glViewport(0, 0, w * factor, bandHeight * factor);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            render(camera.GetTileProjMatrix(static_cast<float>(x0) / width, static_cast<float>(y0) / height,
+                                            static_cast<float>(x0 + w) / width, static_cast<float>(top) / height));
+
+            // the previous tile is copied out while this one renders
+            if (readback.NumPending() == readback.NumSlots())
+                readback.Collect(tiles, true, 1);
+
+            readback.Request(0, 0, w * factor, bandHeight * factor, GL_COLOR_ATTACHMENT0, static_cast<uint64_t>(x0));
+
+            for (const auto& tile : tiles)
+                hzglPlaceTile(tile, factor, static_cast<int>(tile.tag), width, band.data());
+            tiles.clear();
+        }
+
+        readback.Collect(tiles, true);
+
+        for (const auto& tile : tiles)
+            hzglPlaceTile(tile, factor, static_cast<int>(tile.tag), width, band.data());
+        tiles.clear();
+
+        if (!writer.WriteRows(band.data(), bandHeight))
+            break;
+    }
+
+    readback.Release();
+
+    DeleteFBO(&fbInfo);
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFBO);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    bool ok = writer.Close();
+
+    if (ok)
+        std::cout << "Screenshot saved to " << filepath << std::endl;
+
+    return ok;
+}
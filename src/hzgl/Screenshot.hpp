@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Image.hpp"
+#include "Camera.hpp"
+
+#include <string>
+#include <functional>
+
+#include <glad/glad.h>
+
+namespace hzgl
+{
+    typedef struct
+    {
+        int max_in_flight = 3;    // readbacks waiting for the GPU (PBO slots)
+        int max_queued = 8;       // images waiting for the encoder
+        int encoder_threads = 1;
+        PNGOptions png;
+    } ScreenshotOptions;
+
+    typedef struct
+    {
+        int pending_readbacks = 0;
+        size_t queued_encodes = 0;
+        int saved = 0;
+        int dropped = 0;          // requests made while every PBO slot was busy
+    } ScreenshotStats;
+
+    // e.g. "Screenshot-2024-5-17-13-2-45"
+    std::string TimestampStem(const std::string& prefix);
+
+    // takes effect before the first capture (or after ShutdownScreenshots)
+    void SetScreenshotOptions(const ScreenshotOptions& options);
+
+    // queue a capture; the pixels are read back and encoded over the next frames
+    bool TakeScreenshot(int x, int y, int w, int h, GLenum readBuffer = GL_FRONT, const std::string& filepath = "");
+
+    // call once per frame: hands finished readbacks to the encoder threads
+    void UpdateScreenshots();
+
+    // finish every pending capture and release the PBOs (needs the context)
+    void ShutdownScreenshots();
+
+    ScreenshotStats GetScreenshotStats();
+
+    typedef struct
+    {
+        int width = 7680;
+        int height = 4320;
+        int tile_width = 0;       // 0: as wide as the driver allows
+        int tile_height = 256;    // rows per band; the band buffer holds width * tile_height pixels
+        int supersampling = 1;    // tiles are rendered N x N times larger and box-filtered down
+        PNGOptions png;
+    } TiledScreenshotOptions;
+
+    // draw the scene into the bound framebuffer and viewport with the given projection matrix
+    typedef std::function<void(const glm::mat4& projection)> TileRenderFunc;
+
+    // render an image larger than any framebuffer tile by tile (off-center projections of camera,
+    // with its aspect ratio replaced by width / height) and stream it into a PNG band by band
+    bool TakeTiledScreenshot(const std::string& filepath, Camera camera, const TileRenderFunc& render,
+                             const TiledScreenshotOptions& options = TiledScreenshotOptions());
+} // namespace hzgl
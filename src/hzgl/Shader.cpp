@@ -1,13 +1,86 @@
 #include "Shader.hpp"
 
+#include "Profiler.hpp"
+
 #include <cassert>
+#include <cstring>
+#include <algorithm>
 #include <sstream>
 #include <fstream>
 #include <iostream>
+#include <unordered_map>
 
 #include <glad/glad.h>
 
-static std::string readFile(const std::string& filepath)
+// GL_KHR_parallel_shader_compile (same value in the ARB extension), not every glad has it
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef struct
+{
+    std::vector<GLuint> shaders;    // still attached, for the logs
+    bool deleteShaders;
+} hzglPendingProgram;
+
+// set once a context is current, see InitParallelShaderCompile()
+static bool hzglParallelCompile = false;
+
+// programs linked but not asked for their status yet
+static std::unordered_map<GLuint, hzglPendingProgram>& hzglPendingPrograms()
+{
+    static std::unordered_map<GLuint, hzglPendingProgram> programs;
+    return programs;
+}
+
+static std::string hzglReadShaderFile(const std::string& filepath, int depth);
+
+// replace every line #include "name" with the file next to the including one; the #line
+// directives keep compile errors at the line numbers of whichever file they are in
+static std::string hzglExpandIncludes(const std::string& source, const std::string& filepath, int depth)
+{
+    size_t slash = filepath.find_last_of("/\\");
+    std::string directory = (slash == std::string::npos) ? "" : filepath.substr(0, slash + 1);
+
+    std::istringstream lines(source);
+    std::ostringstream result;
+    std::string line;
+    int lineNumber = 0;
+
+    while (std::getline(lines, line))
+    {
+        lineNumber++;
+
+        size_t start = line.find_first_not_of(" \t");
+        size_t open = line.find('"');
+        size_t close = line.rfind('"');
+
+        if (start == std::string::npos || line.compare(start, 8, "#include") != 0 || open == std::string::npos || close <= open)
+        {
+            result << line << '\n';
+            continue;
+        }
+
+        std::string includePath = directory + line.substr(open + 1, close - open - 1);
+        std::string included = (depth < 8) ? hzglReadShaderFile(includePath, depth + 1) : "";
+
+        if (included.empty())
+        {
+            std::cerr << "[ERROR] cannot include " << includePath << " in " << filepath << std::endl;
+            result << line << '\n';
+            continue;
+        }
+
+        result << "#line 1\n" << included;
+        if (included.back() != '\n')
+            result << '\n';
+        result << "#line " << lineNumber + 1 << '\n';
+    }
+
+    return result.str();
+}
+
+static std::string hzglReadShaderFile(const std::string& filepath, int depth)
 {
     std::string fileContent;
     std::ifstream fileStream(filepath, std::ios::in);
@@ -20,58 +93,155 @@ static std::string readFile(const std::string& filepath)
         fileStream.close();
     }
 
-    return fileContent;
+    if (fileContent.find("#include") == std::string::npos)
+        return fileContent;
+
+    return hzglExpandIncludes(fileContent, filepath, depth);
+}
+
+std::string hzgl::ReadShaderSource(const std::string& filepath)
+{
+    return hzglReadShaderFile(filepath, 0);
+}
+
+std::string hzgl::InjectDefines(const std::string& source, const std::vector<std::string>& defines)
+{
+    if (defines.empty())
+        return source;
+
+    std::string block;
+    for (const auto& define : defines)
+        block += "#define " + define + "\n";
+
+    // after the end of the #version line, or at the very top if there is none
+    std::string result = source;
+    size_t version = result.find("#version");
+
+    if (version == std::string::npos)
+        return block + result;
+
+    size_t lineEnd = result.find('\n', version);
+
+    if (lineEnd == std::string::npos)
+        return result + "\n" + block;
+
+    // keep the line numbers of compile errors those of the file
+    int nextLine = static_cast<int>(std::count(result.begin(), result.begin() + lineEnd + 1, '\n')) + 1;
+    result.insert(lineEnd + 1, block + "#line " + std::to_string(nextLine) + "\n");
+
+    return result;
 }
 
 GLuint hzgl::CreateShader(const std::string& filepath, GLenum shaderType)
 {
-    std::string shaderCode = readFile(filepath);
+    HZGL_PROFILE_SCOPE("CreateShader");
+
+    std::string shaderCode = ReadShaderSource(filepath);
 
     if (shaderCode.empty())
         return 0;
 
+    return CreateShaderFromSource(shaderCode, shaderType);
+}
+
+GLuint hzgl::CreateShaderFromSource(const std::string& source, GLenum shaderType)
+{
     GLuint shaderID = glCreateShader(shaderType);
 
-    const char* shaderCodePointer = shaderCode.c_str();
+    // no status query here: it would wait for the compile, the log is printed when the
+    // program it goes into is finished
+    const char* shaderCodePointer = source.c_str();
     glShaderSource(shaderID, 1, &shaderCodePointer, NULL);
     glCompileShader(shaderID);
 
-    GLint infoLogLength;
-    GLint compileStatus = GL_FALSE;
+    return shaderID;
+}
 
-    glGetShaderiv(shaderID, GL_COMPILE_STATUS, &compileStatus);
-    glGetShaderiv(shaderID, GL_INFO_LOG_LENGTH, &infoLogLength);
-    if (infoLogLength > 0)
+bool hzgl::InitParallelShaderCompile(bool enabled)
+{
+    hzglParallelCompile = false;
+
+    GLint numExtensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+
+    for (GLint i = 0; i < numExtensions && enabled; i++)
     {
-        char* infoLog = new char[infoLogLength + 1];
-        glGetShaderInfoLog(shaderID, infoLogLength, NULL, infoLog);
-        std::cout << infoLog << std::endl;
-        delete[] infoLog;
+        const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+
+        if (name != nullptr && (strcmp(name, "GL_KHR_parallel_shader_compile") == 0 || strcmp(name, "GL_ARB_parallel_shader_compile") == 0))
+            hzglParallelCompile = true;
     }
 
-    return shaderID;
+    return hzglParallelCompile;
 }
 
-GLuint hzgl::CreateShaderProgram(std::vector<ShaderStage> stages, std::vector<const char*> feedbackVaryings)
+bool hzgl::ParallelShaderCompileEnabled()
+{
+    return hzglParallelCompile;
+}
+
+GLuint hzgl::LinkShaderProgram(const std::vector<GLuint>& shaders, bool deleteShaders, std::vector<const char*> feedbackVaryings)
 {
     GLuint programID = glCreateProgram();
 
-    for (auto& stage : stages)
-    {
-        GLuint shaderID = CreateShader(stage.filepath, stage.type);
+    for (GLuint shaderID : shaders)
         glAttachShader(programID, shaderID);
-        stage.id = shaderID;
-    }
 
     if (!feedbackVaryings.empty())
         glTransformFeedbackVaryings(programID, feedbackVaryings.size(), feedbackVaryings.data(), GL_INTERLEAVED_ATTRIBS);
 
     glLinkProgram(programID);
 
-    GLint infoLogLength;
+    hzglPendingPrograms()[programID] = {shaders, deleteShaders};
+
+    return programID;
+}
+
+bool hzgl::ShaderProgramReady(GLuint programID)
+{
+    auto& pending = hzglPendingPrograms();
+
+    if (!hzglParallelCompile || pending.find(programID) == pending.end())
+        return true;
+
+    GLint completed = GL_FALSE;
+    glGetProgramiv(programID, GL_COMPLETION_STATUS_KHR, &completed);
+
+    return completed == GL_TRUE;
+}
+
+bool hzgl::FinishShaderProgram(GLuint programID)
+{
+    auto& pending = hzglPendingPrograms();
+    auto it = pending.find(programID);
+
     GLint linkStatus = GL_FALSE;
 
+    if (it == pending.end())
+    {
+        glGetProgramiv(programID, GL_LINK_STATUS, &linkStatus);
+        return linkStatus == GL_TRUE;
+    }
+
+    HZGL_PROFILE_SCOPE("FinishShaderProgram");
+
+    // waits for the driver if the program is still being built
     glGetProgramiv(programID, GL_LINK_STATUS, &linkStatus);
+
+    GLint infoLogLength;
+
+    for (GLuint shaderID : it->second.shaders)
+    {
+        glGetShaderiv(shaderID, GL_INFO_LOG_LENGTH, &infoLogLength);
+        if (infoLogLength > 0)
+        {
+            char* infoLog = new char[infoLogLength + 1];
+            glGetShaderInfoLog(shaderID, infoLogLength, NULL, infoLog);
+            std::cout << infoLog << std::endl;
+            delete[] infoLog;
+        }
+    }
+
     glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &infoLogLength);
 
     if (infoLogLength > 0)
@@ -82,12 +252,63 @@ GLuint hzgl::CreateShaderProgram(std::vector<ShaderStage> stages, std::vector<co
         delete[] infoLog;
     }
 
+    for (GLuint shaderID : it->second.shaders)
+    {
+        glDetachShader(programID, shaderID);
+
+        if (it->second.deleteShaders)
+            glDeleteShader(shaderID);
+    }
+
+    pending.erase(it);
+
+    return linkStatus == GL_TRUE;
+}
+
+int hzgl::PendingShaderPrograms()
+{
+    return static_cast<int>(hzglPendingPrograms().size());
+}
+
+void hzgl::DeleteShaderProgram(GLuint programID)
+{
+    auto& pending = hzglPendingPrograms();
+    auto it = pending.find(programID);
+
+    if (it != pending.end())
+    {
+        for (GLuint shaderID : it->second.shaders)
+        {
+            glDetachShader(programID, shaderID);
+
+            if (it->second.deleteShaders)
+                glDeleteShader(shaderID);
+        }
+
+        pending.erase(it);
+    }
+
+    glDeleteProgram(programID);
+}
+
+GLuint hzgl::SubmitShaderProgram(std::vector<ShaderStage> stages, std::vector<const char*> feedbackVaryings)
+{
+    std::vector<GLuint> shaders;
+
     for (auto& stage : stages)
     {
-        glDetachShader(programID, stage.id);
-        glDeleteShader(stage.id);
+        stage.id = CreateShader(stage.filepath, stage.type);
+        shaders.push_back(stage.id);
     }
 
+    return LinkShaderProgram(shaders, true, feedbackVaryings);
+}
+
+GLuint hzgl::CreateShaderProgram(std::vector<ShaderStage> stages, std::vector<const char*> feedbackVaryings)
+{
+    GLuint programID = SubmitShaderProgram(stages, feedbackVaryings);
+    FinishShaderProgram(programID);
+
     return programID;
 }
 
@@ -14,7 +14,41 @@ namespace hzgl
         GLuint id;
     } ShaderStage;
 
+    // contents of a shader file with its #include "name" lines expanded (names are relative to
+    // the file), empty if it cannot be read
+    std::string ReadShaderSource(const std::string& filepath);
+
+    // "#define NAME" lines right after the #version line, which has to stay the first one
+    std::string InjectDefines(const std::string& source, const std::vector<std::string>& defines);
+
+    // submit a shader for compilation; its status and log are only asked for by FinishShaderProgram()
     GLuint CreateShader(const std::string& filepath, GLenum shaderType);
+    GLuint CreateShaderFromSource(const std::string& source, GLenum shaderType);
+
+    // with GL_KHR_parallel_shader_compile (or the ARB one) the driver builds programs on its own
+    // threads and ShaderProgramReady() can poll them; needs a current context, enabled = false
+    // keeps every program serial (for comparison)
+    bool InitParallelShaderCompile(bool enabled = true);
+    bool ParallelShaderCompileEnabled();
+
+    // link without waiting for the result; the shaders stay attached until FinishShaderProgram()
+    GLuint LinkShaderProgram(const std::vector<GLuint>& shaders, bool deleteShaders, std::vector<const char*> feedbackVaryings={});
+
+    // true when FinishShaderProgram() would not wait (always, without parallel compile)
+    bool ShaderProgramReady(GLuint programID);
+
+    // wait for the program if needed, print the logs and detach its shaders; true if it linked
+    bool FinishShaderProgram(GLuint programID);
+    int PendingShaderPrograms();
+
+    // glDeleteProgram() that also forgets a program never finished, detaching its shaders (and
+    // deleting the ones it owns); ids are reused, a stale entry would pass for the next program
+    void DeleteShaderProgram(GLuint programID);
+
+    // the shaders of the stages, compiled and linked without waiting (deleted once finished)
+    GLuint SubmitShaderProgram(std::vector<ShaderStage> stages, std::vector<const char*> feedbackVaryings={});
+
+    // compile, link and finish in one go
     GLuint CreateShaderProgram(std::vector<ShaderStage> stages, std::vector<const char*> feedbackVaryings={});
 
     void SetSampler(GLuint programID, const char* uName, GLuint texID, int unit);
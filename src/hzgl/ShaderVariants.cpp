@@ -0,0 +1,349 @@
+#include "ShaderVariants.hpp"
+
+#include "Timer.hpp"
+#include "Memory.hpp"
+#include "Profiler.hpp"
+
+#include <iostream>
+#include <algorithm>
+
+static uint64_t hzglVariantKey(int source, unsigned features)
+{
+    return (static_cast<uint64_t>(source) << 32) | features;
+}
+
+const char* hzgl::ShaderFeatureDefine(unsigned feature)
+{
+    switch (feature)
+    {
+        case HZGL_FEATURE_TEXCOORDS:
+            return "HZGL_HAS_TEXCOORDS";
+        case HZGL_FEATURE_BASE_COLOR_MAP:
+            return "HZGL_HAS_BASE_COLOR_MAP";
+        case HZGL_FEATURE_NORMAL_MAP:
+            return "HZGL_HAS_NORMAL_MAP";
+        case HZGL_FEATURE_SHADOWS:
+            return "HZGL_HAS_SHADOWS";
+        case HZGL_FEATURE_IBL:
+            return "HZGL_HAS_IBL";
+        case HZGL_FEATURE_TANGENTS:
+            return "HZGL_HAS_TANGENTS";
+        default:
+            return "";
+    }
+}
+
+GLuint hzgl::ShapeTexture(const RenderShape& shape, unsigned feature)
+{
+    // Assimp names: "base" for glTF, "diffuse" for OBJ (map_Kd); OBJ files mostly put their
+    // normal maps under bump, which Assimp reports as a height map
+    static const char* baseColorKeys[] = {"base", "diffuse"};
+    static const char* normalMapKeys[] = {"normal", "normals", "height"};
+
+    if (feature != HZGL_FEATURE_BASE_COLOR_MAP && feature != HZGL_FEATURE_NORMAL_MAP)
+        return 0;
+
+    const char** keys = (feature == HZGL_FEATURE_BASE_COLOR_MAP) ? baseColorKeys : normalMapKeys;
+    int numKeys = (feature == HZGL_FEATURE_BASE_COLOR_MAP) ? 2 : 3;
+
+    for (int k = 0; k < numKeys; k++)
+    {
+        auto it = shape.texture.find(keys[k]);
+        if (it != shape.texture.end() && it->second != 0)
+            return it->second;
+    }
+
+    return 0;
+}
+
+unsigned hzgl::ShapeFeatures(const RenderShape& shape)
+{
+    unsigned features = 0;
+
+    if (shape.has_texcoords)
+        features |= HZGL_FEATURE_TEXCOORDS;
+
+    if (shape.has_tangents)
+        features |= HZGL_FEATURE_TANGENTS;
+
+    if (!shape.has_textures)
+        return features;
+
+    if (ShapeTexture(shape, HZGL_FEATURE_BASE_COLOR_MAP) != 0)
+        features |= HZGL_FEATURE_BASE_COLOR_MAP;
+
+    if (shape.shading_mode == HZGL_NORMAL_MAPPING && ShapeTexture(shape, HZGL_FEATURE_NORMAL_MAP) != 0)
+        features |= HZGL_FEATURE_NORMAL_MAP;
+
+    return features;
+}
+
+hzgl::ShaderVariantCache::ShaderVariantCache()
+{
+}
+
+hzgl::ShaderVariantCache::~ShaderVariantCache()
+{
+    // GL objects are deleted in Release(), the context may be gone by now
+}
+
+int hzgl::ShaderVariantCache::Register(const std::string& name, const std::vector<ShaderStage>& stages, GLuint baseProgram)
+{
+    Source source;
+    source.name = name;
+    source.stages = stages;
+    source.base = baseProgram;
+
+    for (const auto& stage : stages)
+    {
+        source.sources.push_back(ReadShaderSource(stage.filepath));
+
+        for (int f = 0; f < HZGL_NUM_SHADER_FEATURES; f++)
+        {
+            if (source.sources.back().find(ShaderFeatureDefine(1u << f)) != std::string::npos)
+                source.used |= (1u << f);
+        }
+    }
+
+    int index = static_cast<int>(_sources.size());
+    _sources.push_back(std::move(source));
+
+    _variants[hzglVariantKey(index, 0)] = baseProgram;
+    _stats.sources += 1;
+    _stats.variants += 1;
+
+    return index;
+}
+
+unsigned hzgl::ShaderVariantCache::Minimal(int source, unsigned features) const
+{
+    if (source < 0 || source >= static_cast<int>(_sources.size()))
+        return 0;
+
+    const unsigned maps = HZGL_FEATURE_BASE_COLOR_MAP | HZGL_FEATURE_NORMAL_MAP;
+    unsigned minimal = features & _sources[source].used;
+
+    // the maps are read at the texcoords, which are of no use without a map
+    if ((minimal & HZGL_FEATURE_TEXCOORDS) == 0 && (_sources[source].used & HZGL_FEATURE_TEXCOORDS) != 0)
+        minimal &= ~maps;
+    if ((minimal & maps) == 0)
+        minimal &= ~HZGL_FEATURE_TEXCOORDS;
+
+    // tangents stay: a shape with QTangents has no normal stream, its normals come from them
+
+    return minimal;
+}
+
+std::string hzgl::ShaderVariantCache::label(uint64_t key) const
+{
+    unsigned features = static_cast<unsigned>(key & 0xffffffffu);
+    std::string result = _sources[static_cast<int>(key >> 32)].name;
+    int count = 0;
+
+    for (int f = 0; f < HZGL_NUM_SHADER_FEATURES; f++)
+    {
+        if ((features & (1u << f)) != 0)
+            result += std::string(count++ == 0 ? " [" : ", ") + (ShaderFeatureDefine(1u << f) + 9);
+    }
+
+    return (count > 0) ? result + "]" : result;
+}
+
+void hzgl::ShaderVariantCache::submit(uint64_t key)
+{
+    HZGL_PROFILE_SCOPE("SubmitShaderVariant");
+
+    const Source& src = _sources[static_cast<int>(key >> 32)];
+    unsigned features = static_cast<unsigned>(key & 0xffffffffu);
+
+    SimpleTimer timer;
+    timer.Start();
+
+    std::vector<std::string> defines;
+
+    for (int f = 0; f < HZGL_NUM_SHADER_FEATURES; f++)
+    {
+        if ((features & (1u << f)) != 0)
+            defines.push_back(ShaderFeatureDefine(1u << f));
+    }
+
+    std::vector<GLuint> shaders;
+
+    for (size_t i = 0; i < src.stages.size(); i++)
+        shaders.push_back(CreateShaderFromSource(InjectDefines(src.sources[i], defines), src.stages[i].type));
+
+    _variants[key] = LinkShaderProgram(shaders, true);
+    _compiling.push_back(key);
+    _stats.variants += 1;
+
+    _stats.compile_ms += 1000.0 * timer.End();
+}
+
+void hzgl::ShaderVariantCache::finish(uint64_t key)
+{
+    const Source& src = _sources[static_cast<int>(key >> 32)];
+    GLuint programID = _variants[key];
+
+    SimpleTimer timer;
+    timer.Start();
+
+    bool linked = FinishShaderProgram(programID);
+
+    _stats.last_compile_ms = 1000.0 * timer.End();
+    _stats.compile_ms += _stats.last_compile_ms;
+
+    _compiling.erase(std::find(_compiling.begin(), _compiling.end(), key));
+
+    if (!linked)
+    {
+        // drawn with the base program rather than not at all
+        std::cerr << "Failed to build the shader variant " << label(key) << std::endl;
+        glDeleteProgram(programID);
+        _variants[key] = src.base;
+        _stats.failed += 1;
+        return;
+    }
+
+    GLint binaryLength = 0;
+    glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+
+    TrackGpuResource({HZGL_GPU_PROGRAM, programID, static_cast<size_t>(std::max(binaryLength, 0)), "Programs", "", label(key)});
+}
+
+GLuint hzgl::ShaderVariantCache::Get(int source, unsigned features)
+{
+    if (source < 0 || source >= static_cast<int>(_sources.size()))
+        return 0;
+
+    _stats.requests += 1;
+
+    uint64_t requestKey = hzglVariantKey(source, features);
+    unsigned minimal = Minimal(source, features);
+
+    // a feature set seen for the first time, but handled by a variant for fewer bits (find
+    // first: emplace would allocate a node on every call)
+    if (_requested.find(requestKey) == _requested.end())
+    {
+        _requested.insert(requestKey);
+
+        if (minimal != features)
+            _stats.shared += 1;
+    }
+
+    uint64_t key = hzglVariantKey(source, minimal);
+    auto it = _variants.find(key);
+
+    if (it != _variants.end())
+        _stats.hits += 1;
+    else
+    {
+        // no need to compile it again later
+        auto queued = std::find(_queue.begin(), _queue.end(), key);
+        if (queued != _queue.end())
+            _queue.erase(queued);
+
+        submit(key);
+    }
+
+    // first use of a variant still being built: wait for it
+    if (!_compiling.empty() && std::find(_compiling.begin(), _compiling.end(), key) != _compiling.end())
+        finish(key);
+
+    _stats.pending = static_cast<int>(_queue.size() + _compiling.size());
+
+    return _variants[key];
+}
+
+void hzgl::ShaderVariantCache::Warm(int source, unsigned features)
+{
+    if (source < 0 || source >= static_cast<int>(_sources.size()))
+        return;
+
+    uint64_t key = hzglVariantKey(source, Minimal(source, features));
+
+    if (_variants.find(key) != _variants.end() || std::find(_queue.begin(), _queue.end(), key) != _queue.end())
+        return;
+
+    _queue.push_back(key);
+    _stats.pending = static_cast<int>(_queue.size() + _compiling.size());
+}
+
+int hzgl::ShaderVariantCache::CompilePending(double budgetMs)
+{
+    if (_queue.empty() && _compiling.empty())
+        return 0;
+
+    SimpleTimer timer;
+    timer.Start();
+
+    int finished = 0;
+
+    // the ones the driver built in the background since the last call
+    for (size_t i = 0; i < _compiling.size();)
+    {
+        if (ShaderProgramReady(_variants[_compiling[i]]))
+        {
+            finish(_compiling[i]);
+            finished += 1;
+        }
+        else
+            i++;
+    }
+
+    // with parallel compile submitting is cheap and the whole queue goes to the driver at
+    // once; without, every variant is built here, one after the other
+    int submitted = 0;
+
+    while (!_queue.empty() && (submitted == 0 || 1000.0 * timer.Now() < budgetMs))
+    {
+        uint64_t key = _queue.front();
+        _queue.erase(_queue.begin());
+
+        submit(key);
+        submitted += 1;
+
+        if (!ParallelShaderCompileEnabled())
+        {
+            finish(key);
+            finished += 1;
+        }
+    }
+
+    _stats.pending = static_cast<int>(_queue.size() + _compiling.size());
+
+    return finished;
+}
+
+const hzgl::ShaderVariantStats& hzgl::ShaderVariantCache::Stats() const
+{
+    return _stats;
+}
+
+void hzgl::ShaderVariantCache::Release()
+{
+    // variants still being built are deleted with the others, after their shaders
+    for (uint64_t key : _compiling)
+        FinishShaderProgram(_variants[key]);
+
+    for (const auto& pair : _variants)
+    {
+        int source = static_cast<int>(pair.first >> 32);
+
+        // base programs belong to the resource manager, failed variants fell back to them
+        if (pair.second == 0 || pair.second == _sources[source].base)
+            continue;
+
+        UntrackGpuResource(HZGL_GPU_PROGRAM, pair.second);
+        glDeleteProgram(pair.second);
+    }
+
+    _variants.clear();
+    _queue.clear();
+    _compiling.clear();
+
+    for (int s = 0; s < static_cast<int>(_sources.size()); s++)
+        _variants[hzglVariantKey(s, 0)] = _sources[s].base;
+
+    _stats.variants = static_cast<int>(_sources.size());
+    _stats.pending = 0;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "Shader.hpp"
+#include "ResourceManager.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <glad/glad.h>
+
+namespace hzgl
+{
+    // what a program can be specialized for; each bit is a "#define HZGL_HAS_..." put after the
+    // #version line of every stage, so the sources test for it with #ifdef
+    enum ShaderFeature
+    {
+        HZGL_FEATURE_TEXCOORDS      = 1 << 0,
+        HZGL_FEATURE_BASE_COLOR_MAP = 1 << 1,   // uBaseColorMap, needs texcoords
+        HZGL_FEATURE_NORMAL_MAP     = 1 << 2,   // uNormalMap (tangent space), needs texcoords
+        HZGL_FEATURE_SHADOWS        = 1 << 3,
+        HZGL_FEATURE_IBL            = 1 << 4,
+        HZGL_FEATURE_TANGENTS       = 1 << 5,   // vQTangent in place of vNormal
+        HZGL_NUM_SHADER_FEATURES    = 6
+    };
+
+    // texture units of the material maps
+    const int HZGL_BASE_COLOR_UNIT = 5;
+    const int HZGL_NORMAL_MAP_UNIT = 6;
+
+    const char* ShaderFeatureDefine(unsigned feature);
+
+    // the features that depend on the shape alone: texture presence, texcoords, tangents and shading mode
+    unsigned ShapeFeatures(const RenderShape& shape);
+
+    // the texture of a shape for HZGL_FEATURE_BASE_COLOR_MAP or HZGL_FEATURE_NORMAL_MAP, 0 if none
+    GLuint ShapeTexture(const RenderShape& shape, unsigned feature);
+
+    typedef struct
+    {
+        int sources = 0;                // registered programs
+        int variants = 0;               // compiled (or adopted) programs
+        int64_t requests = 0;           // Get() calls since the start
+        int64_t hits = 0;               // ... answered from the cache
+        int shared = 0;                 // distinct feature sets that got a variant compiled for fewer bits
+        int pending = 0;                // queued by Warm() or still being built
+        int failed = 0;                 // variants that did not link (the base program is used instead)
+        double compile_ms = 0.0;        // render thread time spent on variants since the start
+        double last_compile_ms = 0.0;   // waiting for the last variant to finish
+    } ShaderVariantStats;
+
+    // variants of shader programs by feature bitmask, compiled the first time they are asked for
+    // (or ahead of time through Warm()) and kept until Release(). Bits a program never tests for
+    // are dropped from the key, so feature sets that compile to the same code share one program.
+    class ShaderVariantCache
+    {
+    private:
+        typedef struct
+        {
+            std::string name;
+            std::vector<ShaderStage> stages;
+            std::vector<std::string> sources;   // read once, when registered
+            unsigned used = 0;                  // features some stage tests for
+            GLuint base = 0;                    // the program without defines, owned by the caller
+        } Source;
+
+        std::vector<Source> _sources;
+        std::unordered_map<uint64_t, GLuint> _variants;     // (source, minimal features)
+        std::unordered_set<uint64_t> _requested;            // (source, features) ever asked for
+        std::vector<uint64_t> _queue;                       // waiting for CompilePending()
+        std::vector<uint64_t> _compiling;                   // submitted, status not asked for yet
+        ShaderVariantStats _stats;
+
+        std::string label(uint64_t key) const;
+        void submit(uint64_t key);
+        void finish(uint64_t key);
+
+    public:
+        ShaderVariantCache();
+        ~ShaderVariantCache();
+
+        ShaderVariantCache(const ShaderVariantCache&) = delete;
+        ShaderVariantCache& operator=(const ShaderVariantCache&) = delete;
+
+        // sources of a program that was built without defines (it becomes the variant of no
+        // features, and stays owned by whoever built it); returns the index used below
+        int Register(const std::string& name, const std::vector<ShaderStage>& stages, GLuint baseProgram);
+
+        // the features of the smallest variant that handles the requested ones
+        unsigned Minimal(int source, unsigned features) const;
+
+        // the variant program, compiled now if it is not in the cache
+        GLuint Get(int source, unsigned features);
+
+        // queue a variant for CompilePending(), e.g. for every shape of a model just loaded
+        void Warm(int source, unsigned features);
+
+        // finish the variants the driver is done with, then submit queued ones until budgetMs is
+        // used up (at least one if any is queued); returns how many were finished
+        int CompilePending(double budgetMs);
+
+        const ShaderVariantStats& Stats() const;
+
+        // delete the compiled variants (needs the context that created them)
+        void Release();
+    };
+} // namespace hzgl
@@ -0,0 +1,719 @@
+#include "Shadows.hpp"
+
+#include "Shader.hpp"
+#include "Memory.hpp"
+#include "Profiler.hpp"
+#include "Timer.hpp"
+#include "LightClusters.hpp"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <iostream>
+
+#include <glm/gtx/transform.hpp>
+
+// every other bit of x, packed together (the x or y half of a Morton code)
+static int hzglCompactBits(uint32_t x)
+{
+    x &= 0x55555555;
+    x = (x | (x >> 1)) & 0x33333333;
+    x = (x | (x >> 2)) & 0x0f0f0f0f;
+    x = (x | (x >> 4)) & 0x00ff00ff;
+    x = (x | (x >> 8)) & 0x0000ffff;
+
+    return static_cast<int>(x);
+}
+
+static hzgl::BoundingBox hzglTransformBox(const hzgl::BoundingBox& box, const glm::mat4& world)
+{
+    hzgl::BoundingBox result;
+    result.min = glm::vec3(std::numeric_limits<float>::max());
+    result.max = glm::vec3(-std::numeric_limits<float>::max());
+
+    for (int c = 0; c < 8; c++)
+    {
+        glm::vec3 corner((c & 1) ? box.max.x : box.min.x, (c & 2) ? box.max.y : box.min.y, (c & 4) ? box.max.z : box.min.z);
+        glm::vec4 p = world * glm::vec4(corner, 1.0f);
+
+        result.min = glm::min(result.min, glm::vec3(p.x, p.y, p.z));
+        result.max = glm::max(result.max, glm::vec3(p.x, p.y, p.z));
+    }
+
+    return result;
+}
+
+// false only when all corners of the box are outside the same clip plane
+static bool hzglIntersects(const glm::mat4& viewProjection, const hzgl::BoundingBox& box)
+{
+    int outside[6] = {0, 0, 0, 0, 0, 0};
+
+    for (int c = 0; c < 8; c++)
+    {
+        glm::vec3 corner((c & 1) ? box.max.x : box.min.x, (c & 2) ? box.max.y : box.min.y, (c & 4) ? box.max.z : box.min.z);
+        glm::vec4 p = viewProjection * glm::vec4(corner, 1.0f);
+
+        outside[0] += (p.x < -p.w) ? 1 : 0;
+        outside[1] += (p.x > p.w) ? 1 : 0;
+        outside[2] += (p.y < -p.w) ? 1 : 0;
+        outside[3] += (p.y > p.w) ? 1 : 0;
+        outside[4] += (p.z < -p.w) ? 1 : 0;
+        outside[5] += (p.z > p.w) ? 1 : 0;
+    }
+
+    for (int i = 0; i < 6; i++)
+    {
+        if (outside[i] == 8)
+            return false;
+    }
+
+    return true;
+}
+
+static glm::vec3 hzglUpVector(const glm::vec3& forward)
+{
+    return (std::abs(forward.y) > 0.99f) ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+}
+
+hzgl::ShadowAtlas::ShadowAtlas(int size, int cascades, float shadowDistance)
+    : _size(512), _cascades(std::min(std::max(cascades, 1), 8)), _shadowDistance(shadowDistance), _cascadeLambda(0.7f),
+      _program(0), _modelLocation(-1), _viewLocation(-1), _projectionLocation(-1),
+      _finished(false), _viewBuffer(0), _viewTexture(0), _viewCapacity(0), _allDirty(true), _timeNext(0)
+{
+    // tiles are packed in Morton order, which needs a power of two
+    while (_size * 2 <= size)
+        _size *= 2;
+
+    _atlas.id = 0;
+    _atlas.width = 0;
+    _atlas.height = 0;
+    _atlas.depth_attachment = 0;
+    _atlas.stencil_attachment = 0;
+    _atlas.depth_texture = 0;
+
+    for (int i = 0; i < 3; i++)
+    {
+        _timeQueries[i][0] = _timeQueries[i][1] = 0;
+        _timePending[i] = false;
+    }
+
+    _stats.atlas_size = _size;
+}
+
+hzgl::ShadowAtlas::~ShadowAtlas()
+{
+    // GL objects are deleted in Release(), the context may be gone by now
+}
+
+bool hzgl::ShadowAtlas::Init(const std::string& shaderDir)
+{
+    // the same depth-only program as the pre-pass, kept out of the ResourceManager
+    _program = SubmitShaderProgram({
+        {GL_VERTEX_SHADER, shaderDir + "/depth_only.vert"},
+    });
+    _finished = false;
+
+    if (CreateFBO(_size, _size, {{GL_TEXTURE_2D, GL_DEPTH_COMPONENT24, GL_DEPTH_ATTACHMENT}}, &_atlas) == 0)
+    {
+        std::cerr << "Failed to create the shadow atlas." << std::endl;
+        return false;
+    }
+
+    // sampled with depth comparison, the hardware filters the four results
+    glBindTexture(GL_TEXTURE_2D, _atlas.depth_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenQueries(6, &_timeQueries[0][0]);
+
+    // the view buffer exists before the first update, so binding it is always valid
+    upload();
+
+    return true;
+}
+
+// the driver builds the program while the models load, it is only waited for when first needed
+bool hzgl::ShadowAtlas::finishProgram()
+{
+    if (_finished)
+        return _program != 0;
+
+    _finished = true;
+
+    if (_program == 0)
+        return false;
+
+    if (!FinishShaderProgram(_program))
+    {
+        std::cerr << "Failed to build the shadow map program." << std::endl;
+        DeleteShaderProgram(_program);
+        _program = 0;
+        return false;
+    }
+
+    _modelLocation = glGetUniformLocation(_program, "Model");
+    _viewLocation = glGetUniformLocation(_program, "View");
+    _projectionLocation = glGetUniformLocation(_program, "Projection");
+
+    return true;
+}
+
+void hzgl::ShadowAtlas::Update(const std::vector<Light>& lights, const std::vector<ShadowCaster>& casters,
+                               const glm::mat4& view, const glm::mat4& projection)
+{
+    HZGL_PROFILE_SCOPE("ShadowAtlas::Update");
+
+    if (!finishProgram())
+        return;
+
+    SimpleTimer timer;
+    timer.Start();
+
+    collectTiming();
+
+    request(lights);
+    pack();
+
+    BoundingBox sceneBounds;
+    collectCasters(casters, &sceneBounds);
+    fitViews(lights, sceneBounds, view, projection);
+
+    render(casters);
+    upload();
+
+    _stats.cpu_ms = 1000.0 * timer.End();
+}
+
+void hzgl::ShadowAtlas::request(const std::vector<Light>& lights)
+{
+    _requests.clear();
+
+    for (int i = 0; i < (int)lights.size(); i++)
+    {
+        const Light& light = lights[i];
+
+        if (!light.isEnabled || !light.castShadows)
+            continue;
+
+        if (light.type == HZGL_DIRECTIONAL_LIGHT)
+            _requests.push_back({i, _cascades, _size / 4});
+        else if (light.type == HZGL_SPOT_LIGHT)
+            _requests.push_back({i, 1, _size / 4});
+        else
+            _requests.push_back({i, 6, _size / 8});
+    }
+
+    // directional lights cover the whole view, they are the last to lose resolution
+    std::stable_sort(_requests.begin(), _requests.end(), [&lights](const Request& a, const Request& b) {
+        return lights[a.light].type == HZGL_DIRECTIONAL_LIGHT && lights[b.light].type != HZGL_DIRECTIONAL_LIGHT;
+    });
+
+    int wanted = static_cast<int>(_requests.size());
+    int minTile = std::max(_size / 32, 16);
+    int64_t capacity = static_cast<int64_t>(_size) * _size;
+
+    auto area = [this]() {
+        int64_t texels = 0;
+        for (const auto& r : _requests)
+            texels += static_cast<int64_t>(r.views) * r.size * r.size;
+        return texels;
+    };
+
+    // halve the tiles of the last lights until everything fits, then leave lights out
+    int64_t texels = area();
+    while (texels > capacity)
+    {
+        int r = static_cast<int>(_requests.size()) - 1;
+        while (r >= 0 && _requests[r].size <= minTile)
+            r--;
+
+        if (r >= 0)
+            _requests[r].size /= 2;
+        else
+            _requests.pop_back();
+
+        texels = area();
+    }
+
+    _stats.lights = static_cast<int>(_requests.size());
+    _stats.dropped_lights = wanted - _stats.lights;
+    _stats.atlas_usage = static_cast<double>(texels) / capacity;
+
+    // first view and count per light, views are grouped in the order of the requests
+    _lightViews.assign(lights.size(), glm::ivec2(0, 0));
+
+    int first = 0;
+    for (const auto& r : _requests)
+    {
+        _lightViews[r.light] = glm::ivec2(first, r.views);
+        first += r.views;
+    }
+}
+
+void hzgl::ShadowAtlas::pack()
+{
+    bool same = (_requests.size() == _layout.size());
+    for (size_t i = 0; same && i < _requests.size(); i++)
+    {
+        same = _requests[i].light == _layout[i].light && _requests[i].views == _layout[i].views
+            && _requests[i].size == _layout[i].size;
+    }
+
+    if (same)
+        return;
+
+    // a new layout moves tiles around, nothing in the atlas can be reused
+    _layout = _requests;
+    _views.clear();
+
+    for (const auto& r : _layout)
+    {
+        for (int v = 0; v < r.views; v++)
+            _views.push_back({glm::mat4(0.0f), glm::ivec4(0, 0, r.size, r.size), 0.0f, false});
+    }
+
+    // largest tiles first: every tile then starts at a multiple of its own cell count along the
+    // Morton curve, which makes it a square block of cells
+    _order.resize(_views.size());
+    for (size_t i = 0; i < _order.size(); i++)
+        _order[i] = static_cast<int>(i);
+
+    std::stable_sort(_order.begin(), _order.end(), [this](int a, int b) { return _views[a].tile[2] > _views[b].tile[2]; });
+
+    int minTile = std::max(_size / 32, 16);
+    uint32_t cursor = 0;
+
+    for (int i : _order)
+    {
+        int cells = _views[i].tile[2] / minTile;
+
+        _views[i].tile[0] = hzglCompactBits(cursor) * minTile;
+        _views[i].tile[1] = hzglCompactBits(cursor >> 1) * minTile;
+        cursor += static_cast<uint32_t>(cells * cells);
+    }
+}
+
+void hzgl::ShadowAtlas::collectCasters(const std::vector<ShadowCaster>& casters, BoundingBox* sceneBounds)
+{
+    sceneBounds->min = glm::vec3(std::numeric_limits<float>::max());
+    sceneBounds->max = glm::vec3(-std::numeric_limits<float>::max());
+
+    // a caster that was added, removed or replaced may touch any view
+    _allDirty = _allDirty || (casters.size() != _lastShapes.size());
+    _dirty.clear();
+    _bounds.resize(casters.size());
+
+    for (size_t i = 0; i < casters.size(); i++)
+    {
+        const RenderShape* shape = casters[i].shape;
+        const glm::mat4& world = *casters[i].world;
+
+        _bounds[i] = hzglTransformBox(shape->bounds, world);
+        sceneBounds->min = glm::min(sceneBounds->min, _bounds[i].min);
+        sceneBounds->max = glm::max(sceneBounds->max, _bounds[i].max);
+
+        if (_allDirty)
+            continue;
+
+        if (_lastShapes[i] != shape)
+        {
+            _allDirty = true;
+        }
+        else if (_lastWorld[i] != world)
+        {
+            // the views that saw it before or see it now
+            _dirty.push_back(_lastBounds[i]);
+            _dirty.push_back(_bounds[i]);
+        }
+    }
+
+    _lastShapes.resize(casters.size());
+    _lastWorld.resize(casters.size());
+
+    for (size_t i = 0; i < casters.size(); i++)
+    {
+        _lastShapes[i] = casters[i].shape;
+        _lastWorld[i] = *casters[i].world;
+    }
+
+    _lastBounds.assign(_bounds.begin(), _bounds.end());
+}
+
+void hzgl::ShadowAtlas::fitViews(const std::vector<Light>& lights, const BoundingBox& sceneBounds,
+                                 const glm::mat4& view, const glm::mat4& projection)
+{
+    bool hasCasters = sceneBounds.min.x <= sceneBounds.max.x;
+
+    // near and far planes of a perspective projection (also off-center ones)
+    float near = projection[3][2] / (projection[2][2] - 1.0f);
+    float far = std::min(projection[3][2] / (projection[2][2] + 1.0f), near + _shadowDistance);
+
+    // view-space corner rays of the frustum, scaled to a depth of 1
+    glm::mat4 inverseProjection = glm::inverse(projection);
+    glm::mat4 inverseView = glm::inverse(view);
+    glm::vec3 rays[4];
+
+    for (int k = 0; k < 4; k++)
+    {
+        glm::vec4 p = inverseProjection * glm::vec4((k & 1) ? 1.0f : -1.0f, (k & 2) ? 1.0f : -1.0f, -1.0f, 1.0f);
+        rays[k] = glm::vec3(p.x, p.y, p.z) / (-p.z);
+    }
+
+    int v = 0;
+
+    for (const auto& r : _layout)
+    {
+        const Light& light = lights[r.light];
+
+        for (int k = 0; k < r.views; k++, v++)
+        {
+            ShadowView& shadowView = _views[v];
+            int resolution = shadowView.tile[2];
+            glm::mat4 viewProjection;
+
+            if (light.type == HZGL_DIRECTIONAL_LIGHT)
+            {
+                // practical split scheme: a blend of logarithmic and uniform slices
+                float t0 = static_cast<float>(k) / r.views;
+                float t1 = static_cast<float>(k + 1) / r.views;
+                float d0 = _cascadeLambda * near * std::pow(far / near, t0) + (1.0f - _cascadeLambda) * (near + (far - near) * t0);
+                float d1 = _cascadeLambda * near * std::pow(far / near, t1) + (1.0f - _cascadeLambda) * (near + (far - near) * t1);
+
+                glm::vec3 corners[8];
+                glm::vec3 center(0.0f);
+
+                for (int c = 0; c < 8; c++)
+                {
+                    glm::vec3 p = rays[c & 3] * ((c < 4) ? d0 : d1);
+                    glm::vec4 world = inverseView * glm::vec4(p, 1.0f);
+
+                    corners[c] = glm::vec3(world.x, world.y, world.z);
+                    center += corners[c] / 8.0f;
+                }
+
+                // the bounding sphere keeps the size of the cascade fixed while the camera turns
+                float radius = 0.0f;
+                for (int c = 0; c < 8; c++)
+                    radius = std::max(radius, glm::length(corners[c] - center));
+
+                radius = std::ceil(radius * 16.0f) / 16.0f;
+
+                glm::vec3 forward = glm::normalize(light.position);
+                glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), forward, hzglUpVector(forward));
+
+                // move in whole texels, so the depth of a static scene stays put when the camera moves
+                glm::vec4 origin = lightView * glm::vec4(center, 1.0f);
+                float texel = 2.0f * radius / resolution;
+                origin.x = std::floor(origin.x / texel) * texel;
+                origin.y = std::floor(origin.y / texel) * texel;
+
+                // depth covers every caster between the light and the slice
+                float zNear = -origin.z - radius;
+                float zFar = -origin.z + radius;
+
+                if (hasCasters)
+                {
+                    for (int c = 0; c < 8; c++)
+                    {
+                        glm::vec3 corner((c & 1) ? sceneBounds.max.x : sceneBounds.min.x, (c & 2) ? sceneBounds.max.y : sceneBounds.min.y,
+                                         (c & 4) ? sceneBounds.max.z : sceneBounds.min.z);
+                        float z = (lightView * glm::vec4(corner, 1.0f)).z;
+
+                        zNear = std::min(zNear, -z);
+                        zFar = std::max(zFar, -z);
+                    }
+                }
+
+                glm::mat4 lightProjection = glm::ortho(origin.x - radius, origin.x + radius, origin.y - radius, origin.y + radius,
+                                                       std::floor(zNear) - 1.0f, std::ceil(zFar) + 1.0f);
+
+                viewProjection = lightProjection * lightView;
+                shadowView.texelSize = texel;
+            }
+            else if (light.type == HZGL_SPOT_LIGHT)
+            {
+                float range = LightRange(light);
+                float zFar = (range > 0.0f) ? range : _shadowDistance;
+                float fov = 2.0f * std::acos(glm::clamp(light.spotCosCutoff, 0.17f, 1.0f)) + glm::radians(2.0f);
+
+                glm::vec3 forward = glm::normalize(light.coneDirection);
+                glm::mat4 lightView = glm::lookAt(light.position, light.position + forward, hzglUpVector(forward));
+                glm::mat4 lightProjection = glm::perspective(fov, 1.0f, glm::clamp(zFar * 0.005f, 0.01f, 0.5f), zFar);
+
+                viewProjection = lightProjection * lightView;
+                shadowView.texelSize = 2.0f * std::tan(0.5f * fov) / resolution;
+            }
+            else
+            {
+                // +X, -X, +Y, -Y, +Z, -Z like the faces of a cube map
+                static const glm::vec3 axes[6] = {
+                    glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0),
+                    glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1),
+                };
+
+                static const glm::vec3 ups[6] = {
+                    glm::vec3(0, -1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1),
+                    glm::vec3(0, 0, -1), glm::vec3(0, -1, 0), glm::vec3(0, -1, 0),
+                };
+
+                float range = LightRange(light);
+                float zFar = (range > 0.0f) ? range : _shadowDistance;
+
+                glm::mat4 lightView = glm::lookAt(light.position, light.position + axes[k], ups[k]);
+                glm::mat4 lightProjection = glm::perspective(glm::radians(90.0f), 1.0f, glm::clamp(zFar * 0.005f, 0.01f, 0.5f), zFar);
+
+                viewProjection = lightProjection * lightView;
+                shadowView.texelSize = 2.0f / resolution;
+            }
+
+            if (viewProjection != shadowView.viewProjection)
+            {
+                shadowView.viewProjection = viewProjection;
+                shadowView.valid = false;
+            }
+        }
+    }
+}
+
+void hzgl::ShadowAtlas::render(const std::vector<ShadowCaster>& casters)
+{
+    _stats.views = static_cast<int>(_views.size());
+    _stats.rendered = 0;
+    _stats.cached = 0;
+    _stats.draw_calls = 0;
+
+    // a view is out of date when its matrix changed or a caster moved inside it
+    for (auto& shadowView : _views)
+    {
+        bool stale = !shadowView.valid || _allDirty;
+
+        for (size_t i = 0; !stale && i < _dirty.size(); i++)
+            stale = hzglIntersects(shadowView.viewProjection, _dirty[i]);
+
+        shadowView.valid = !stale;
+        _stats.rendered += stale ? 1 : 0;
+        _stats.cached += stale ? 0 : 1;
+    }
+
+    _allDirty = false;
+    _stats.total_rendered += _stats.rendered;
+    _stats.total_cached += _stats.cached;
+
+    int64_t total = _stats.total_rendered + _stats.total_cached;
+    _stats.hit_rate = (total > 0) ? static_cast<double>(_stats.total_cached) / total : 0.0;
+
+    if (_stats.rendered == 0)
+        return;
+
+    HZGL_PROFILE_GPU_SCOPE("Shadows");
+
+    int slot = _timeNext;
+    bool timed = !_timePending[slot];
+
+    if (timed)
+        glQueryCounter(_timeQueries[slot][0], GL_TIMESTAMP);
+
+    GLint target = 0;
+    GLint viewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, _atlas.id);
+    glEnable(GL_SCISSOR_TEST);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(1.1f, 4.0f);
+
+    // open meshes cast shadows from both sides
+    glDisable(GL_CULL_FACE);
+
+    glm::mat4 identity(1.0f);
+    glUseProgram(_program);
+    glUniformMatrix4fv(_viewLocation, 1, GL_FALSE, &identity[0][0]);
+
+    for (auto& shadowView : _views)
+    {
+        if (shadowView.valid)
+            continue;
+
+        const glm::ivec4& tile = shadowView.tile;
+        glViewport(tile[0], tile[1], tile[2], tile[3]);
+        glScissor(tile[0], tile[1], tile[2], tile[3]);
+        glClear(GL_DEPTH_BUFFER_BIT);
+
+        glUniformMatrix4fv(_projectionLocation, 1, GL_FALSE, &shadowView.viewProjection[0][0]);
+
+        for (size_t i = 0; i < casters.size(); i++)
+        {
+            const RenderShape& shape = *casters[i].shape;
+
+            if (shape.depthVAO == 0 || !hzglIntersects(shadowView.viewProjection, _bounds[i]))
+                continue;
+
+            glUniformMatrix4fv(_modelLocation, 1, GL_FALSE, &(*casters[i].world)[0][0]);
+            glBindVertexArray(shape.depthVAO);
+            glDrawElements(GL_TRIANGLES, shape.num_indices, shape.index_type, (void*)shape.index_offset);
+
+            _stats.draw_calls += 1;
+        }
+
+        shadowView.valid = true;
+    }
+
+    glBindVertexArray(0);
+
+    if (cullFace == GL_TRUE)
+        glEnable(GL_CULL_FACE);
+
+    glPolygonOffset(0.0f, 0.0f);
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDisable(GL_SCISSOR_TEST);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    if (timed)
+    {
+        glQueryCounter(_timeQueries[slot][1], GL_TIMESTAMP);
+        _timePending[slot] = true;
+        _timeNext = (_timeNext + 1) % 3;
+    }
+}
+
+void hzgl::ShadowAtlas::upload()
+{
+    _viewData.clear();
+
+    for (const auto& shadowView : _views)
+    {
+        const glm::mat4& m = shadowView.viewProjection;
+        float scale = 1.0f / _size;
+
+        _viewData.push_back(m[0]);
+        _viewData.push_back(m[1]);
+        _viewData.push_back(m[2]);
+        _viewData.push_back(m[3]);
+        _viewData.push_back(glm::vec4(shadowView.tile[0] * scale, shadowView.tile[1] * scale, shadowView.tile[2] * scale, shadowView.tile[3] * scale));
+        _viewData.push_back(glm::vec4(shadowView.texelSize, 0.0f, 0.0f, 0.0f));
+    }
+
+    size_t size = _viewData.size() * sizeof(glm::vec4);
+
+    if (_viewBuffer == 0)
+    {
+        glGenBuffers(1, &_viewBuffer);
+        glGenTextures(1, &_viewTexture);
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, _viewBuffer);
+
+    // grow by doubling; otherwise orphan the storage so the previous frame can keep reading it
+    if (_viewCapacity < std::max<size_t>(size, 16))
+    {
+        _viewCapacity = std::max<size_t>(2 * _viewCapacity, std::max<size_t>(size, 256));
+
+        glBufferData(GL_TEXTURE_BUFFER, _viewCapacity, nullptr, GL_STREAM_DRAW);
+        TrackGpuResource({HZGL_GPU_BUFFER, _viewBuffer, _viewCapacity, "Shadow atlas", "", "texture buffer"});
+
+        glBindTexture(GL_TEXTURE_BUFFER, _viewTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, _viewBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+    else
+    {
+        glBufferData(GL_TEXTURE_BUFFER, _viewCapacity, nullptr, GL_STREAM_DRAW);
+    }
+
+    if (size > 0)
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, size, _viewData.data());
+
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void hzgl::ShadowAtlas::collectTiming()
+{
+    // timestamps of earlier frames, read once the GPU got past them
+    for (int i = 0; i < 3; i++)
+    {
+        if (!_timePending[i])
+            continue;
+
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(_timeQueries[i][1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+        if (available != GL_TRUE)
+            continue;
+
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(_timeQueries[i][0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(_timeQueries[i][1], GL_QUERY_RESULT, &end);
+
+        _stats.gpu_ms = static_cast<double>(end - begin) / 1.0e6;
+        _timePending[i] = false;
+    }
+}
+
+const std::vector<glm::ivec2>& hzgl::ShadowAtlas::LightViews() const
+{
+    return _lightViews;
+}
+
+void hzgl::ShadowAtlas::Bind(GLuint program, int firstUnit) const
+{
+    glActiveTexture(GL_TEXTURE0 + firstUnit);
+    glBindTexture(GL_TEXTURE_2D, _atlas.depth_texture);
+    glUniform1i(glGetUniformLocation(program, "uShadowAtlas"), firstUnit);
+
+    glActiveTexture(GL_TEXTURE0 + firstUnit + 1);
+    glBindTexture(GL_TEXTURE_BUFFER, _viewTexture);
+    glUniform1i(glGetUniformLocation(program, "uShadowViews"), firstUnit + 1);
+
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void hzgl::ShadowAtlas::Invalidate()
+{
+    for (auto& shadowView : _views)
+        shadowView.valid = false;
+}
+
+const hzgl::ShadowStats& hzgl::ShadowAtlas::Stats() const
+{
+    return _stats;
+}
+
+void hzgl::ShadowAtlas::Release()
+{
+    if (_atlas.id != 0)
+        DeleteFBO(&_atlas);
+
+    if (_program != 0)
+        DeleteShaderProgram(_program);
+
+    if (_viewBuffer != 0)
+    {
+        UntrackGpuResource(HZGL_GPU_BUFFER, _viewBuffer);
+        glDeleteBuffers(1, &_viewBuffer);
+        glDeleteTextures(1, &_viewTexture);
+    }
+
+    if (_timeQueries[0][0] != 0)
+        glDeleteQueries(6, &_timeQueries[0][0]);
+
+    for (int i = 0; i < 3; i++)
+    {
+        _timeQueries[i][0] = _timeQueries[i][1] = 0;
+        _timePending[i] = false;
+    }
+
+    _program = 0;
+    _viewBuffer = 0;
+    _viewTexture = 0;
+    _viewCapacity = 0;
+    _layout.clear();
+    _views.clear();
+    _allDirty = true;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "Light.hpp"
+#include "Occlusion.hpp"
+#include "Framebuffer.hpp"
+#include "ResourceManager.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+namespace hzgl
+{
+    // a shape drawn into the shadow maps, the world matrix has to outlive Update()
+    typedef struct
+    {
+        const RenderShape* shape;
+        const glm::mat4* world;
+    } ShadowCaster;
+
+    typedef struct
+    {
+        int lights = 0;                   // lights with shadow views in the atlas
+        int dropped_lights = 0;           // shadow casters that did not fit, lit without shadows
+        int views = 0;                    // cascades, cube faces and spot views
+        int rendered = 0;                 // views drawn by the last update
+        int cached = 0;                   // views reused from the atlas by the last update
+        int64_t total_rendered = 0;
+        int64_t total_cached = 0;
+        double hit_rate = 0.0;            // total_cached / (total_cached + total_rendered)
+        int draw_calls = 0;               // depth-only draws of the last update
+        double cpu_ms = 0.0;              // view setup, invalidation and submission
+        double gpu_ms = -1.0;             // of the last shadow pass that drew, -1 until known
+        int atlas_size = 0;
+        double atlas_usage = 0.0;         // fraction of the atlas covered by tiles
+    } ShadowStats;
+
+    // shadow maps of every light in one depth atlas of fixed size, so their memory is bounded:
+    // a directional light gets cascades fitted to slices of the view frustum, a point light six
+    // 90 degree faces (the layout of a cube map), a spot light one perspective view. Tiles are
+    // powers of two packed in Morton order; when they do not fit, the last lights get smaller
+    // tiles and then none at all. A view keeps its depth across frames and is only redrawn
+    // when its matrix changes or a caster moves through its volume.
+    class ShadowAtlas
+    {
+    private:
+        typedef struct
+        {
+            int light;
+            int views;                    // 1 (spot), 6 (point) or the number of cascades
+            int size;                     // of each tile, in texels
+        } Request;
+
+        typedef struct
+        {
+            glm::mat4 viewProjection;
+            glm::ivec4 tile;              // x, y, width, height in texels
+            float texelSize;              // world-space size of a texel at distance 1
+            bool valid;                   // the atlas holds the depth of viewProjection
+        } ShadowView;
+
+        int _size;
+        int _cascades;
+        float _shadowDistance;
+        float _cascadeLambda;
+
+        FrameBufferInfo _atlas;
+        GLuint _program;
+        GLint _modelLocation;
+        GLint _viewLocation;
+        GLint _projectionLocation;
+        bool _finished;                   // the link status of _program was asked for
+
+        GLuint _viewBuffer;
+        GLuint _viewTexture;
+        size_t _viewCapacity;
+
+        std::vector<Request> _requests;   // this update, compared with _layout
+        std::vector<Request> _layout;     // what the tiles were packed for
+        std::vector<ShadowView> _views;   // grouped by light, in light order
+        std::vector<glm::ivec2> _lightViews;
+        std::vector<glm::vec4> _viewData; // 6 texels per view
+        std::vector<int> _order;          // scratch for packing
+
+        // casters of the last update, to find the ones that moved
+        std::vector<const RenderShape*> _lastShapes;
+        std::vector<glm::mat4> _lastWorld;
+        std::vector<BoundingBox> _lastBounds;
+        std::vector<BoundingBox> _bounds;
+        std::vector<BoundingBox> _dirty;  // world boxes (before and after) of moved casters
+        bool _allDirty;
+
+        GLuint _timeQueries[3][2];
+        bool _timePending[3];
+        int _timeNext;
+
+        ShadowStats _stats;
+
+        bool finishProgram();
+        void request(const std::vector<Light>& lights);
+        void pack();
+        void collectCasters(const std::vector<ShadowCaster>& casters, BoundingBox* sceneBounds);
+        void fitViews(const std::vector<Light>& lights, const BoundingBox& sceneBounds,
+                      const glm::mat4& view, const glm::mat4& projection);
+        void render(const std::vector<ShadowCaster>& casters);
+        void upload();
+        void collectTiming();
+
+    public:
+        ShadowAtlas(int size = 4096, int cascades = 4, float shadowDistance = 30.0f);
+        ~ShadowAtlas();
+
+        ShadowAtlas(const ShadowAtlas&) = delete;
+        ShadowAtlas& operator=(const ShadowAtlas&) = delete;
+
+        // allocate the atlas and submit the depth-only program from shaderDir (needs a context);
+        // the first Update() finishes the program, and renders nothing if it failed to build
+        bool Init(const std::string& shaderDir);
+
+        // fit the views of every enabled light with castShadows to the camera and redraw the
+        // ones that are out of date; the depth test, viewport and framebuffer are restored
+        void Update(const std::vector<Light>& lights, const std::vector<ShadowCaster>& casters,
+                    const glm::mat4& view, const glm::mat4& projection);
+
+        // per light of the last update: first view and number of views, (0, 0) for none;
+        // goes to LightClusters::Build() with the same light list
+        const std::vector<glm::ivec2>& LightViews() const;
+
+        // bind the atlas and the view buffer to the uShadowAtlas and uShadowViews samplers
+        // (two texture units starting at firstUnit)
+        void Bind(GLuint program, int firstUnit = 11) const;
+
+        // drop every cached view, e.g. after the shadow settings changed
+        void Invalidate();
+
+        const ShadowStats& Stats() const;
+
+        // delete the GL objects (needs the context that created them)
+        void Release();
+    };
+} // namespace hzgl
@@ -0,0 +1,1340 @@
+#include "Streaming.hpp"
+
+#include "Ply.hpp"
+#include "Mesh.hpp"
+#include "Timer.hpp"
+#include "Memory.hpp"
+#include "Profiler.hpp"
+#include "ThreadPool.hpp"
+
+#include <cmath>
+#include <mutex>
+#include <cstdio>
+#include <limits>
+#include <thread>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+
+static const char hzglChunkMagic[8] = {'H', 'Z', 'C', 'H', 'U', 'N', 'K', '1'};
+static const uint32_t hzglChunkVersion = 1;
+static const size_t hzglChunkAlignment = 4096;     // every level starts on a page
+
+static size_t hzglAlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+//
+// binary PLY, read in place
+//
+
+typedef struct
+{
+    bool big_endian = false;
+    const hzgl::PlyElement* face = nullptr;
+    int index_property = -1;        // the vertex_indices list of the face element
+    size_t vertex_offset = 0;       // where the (fixed-size) vertices start
+    size_t vertex_stride = 0;
+    hzgl::PlyProperty position[3];
+    size_t face_offset = 0;
+} PlyLayout;
+
+// only the binary encodings with fixed-size vertices followed by the faces; anything else goes
+// through Assimp
+static bool hzglTriangleLayout(const hzgl::PlyHeader& header, size_t fileSize, PlyLayout* ply)
+{
+    int vertex = hzgl::FindPlyElement(header, "vertex");
+    int face = hzgl::FindPlyElement(header, "face");
+
+    if (!header.binary || vertex < 0 || face < 0)
+        return false;
+
+    const hzgl::PlyElement& vertices = header.elements[vertex];
+    ply->vertex_offset = hzgl::PlyElementOffset(header, vertex);
+    ply->vertex_stride = vertices.stride;
+    ply->face_offset = hzgl::PlyElementOffset(header, face);
+
+    if (ply->vertex_offset == 0 || ply->vertex_stride == 0 || ply->face_offset == 0)
+        return false;
+
+    for (int k = 0; k < 3; k++)
+    {
+        int property = hzgl::FindPlyProperty(vertices, std::string(1, static_cast<char>('x' + k)));
+        if (property < 0 || !vertices.properties[property].is_float)
+            return false;
+
+        ply->position[k] = vertices.properties[property];
+    }
+
+    ply->big_endian = header.big_endian;
+    ply->face = &header.elements[face];
+    ply->index_property = hzgl::FindPlyFaceIndices(*ply->face);
+
+    return ply->index_property >= 0 && ply->vertex_offset + static_cast<size_t>(vertices.count) * ply->vertex_stride <= fileSize;
+}
+
+//
+// input triangles
+//
+
+// the triangles of the input, from a mapped binary PLY or, for any other format, from Assimp
+typedef struct
+{
+    hzgl::MappedFile file;
+    hzgl::PlyHeader header;
+    PlyLayout ply;
+    bool mapped = false;
+    int64_t num_vertices = 0;
+    std::vector<float> positions;   // Assimp input only
+    std::vector<unsigned> indices;
+} TriangleSource;
+
+static bool hzglOpenTriangleSource(const std::string& filepath, TriangleSource& source)
+{
+    if (source.file.Open(filepath) && hzgl::ReadPlyHeader(source.file.Data(), source.file.Size(), &source.header)
+        && hzglTriangleLayout(source.header, source.file.Size(), &source.ply))
+    {
+        source.mapped = true;
+        source.num_vertices = source.header.elements[hzgl::FindPlyElement(source.header, "vertex")].count;
+        return true;
+    }
+
+    source.file.Close();
+
+    std::cout << "Not a binary PLY file, loading " << filepath << " into memory" << std::endl;
+
+    std::vector<hzgl::MeshInfo> meshes;
+    hzgl::LoadMeshesFromFile(filepath, meshes);
+
+    for (auto& mesh : meshes)
+    {
+        unsigned base = static_cast<unsigned>(source.positions.size() / 3);
+
+        source.positions.insert(source.positions.end(), mesh.positions.begin(), mesh.positions.end());
+        for (unsigned index : mesh.indices)
+            source.indices.push_back(base + index);
+
+        mesh = hzgl::MeshInfo();
+    }
+
+    source.num_vertices = static_cast<int64_t>(source.positions.size() / 3);
+
+    return !source.indices.empty();
+}
+
+static glm::vec3 hzglSourcePosition(const TriangleSource& source, int64_t index)
+{
+    if (!source.mapped)
+        return glm::vec3(source.positions[3 * index], source.positions[3 * index + 1], source.positions[3 * index + 2]);
+
+    const PlyLayout& ply = source.ply;
+    const uint8_t* vertex = source.file.Data() + ply.vertex_offset + static_cast<size_t>(index) * ply.vertex_stride;
+
+    return glm::vec3(static_cast<float>(hzgl::ReadPlyScalar(vertex + ply.position[0].offset, ply.position[0], ply.big_endian)),
+                     static_cast<float>(hzgl::ReadPlyScalar(vertex + ply.position[1].offset, ply.position[1], ply.big_endian)),
+                     static_cast<float>(hzgl::ReadPlyScalar(vertex + ply.position[2].offset, ply.position[2], ply.big_endian)));
+}
+
+// every vertex once, front to back, dropping the pages behind every window bytes
+static void hzglSourceBounds(TriangleSource& source, size_t window, glm::vec3* lo, glm::vec3* hi)
+{
+    *lo = glm::vec3(std::numeric_limits<float>::max());
+    *hi = glm::vec3(-std::numeric_limits<float>::max());
+
+    size_t begin = source.ply.vertex_offset;
+    size_t windowStart = begin;
+
+    if (source.mapped)
+        source.file.AdviseSequential(begin, static_cast<size_t>(source.num_vertices) * source.ply.vertex_stride);
+
+    for (int64_t v = 0; v < source.num_vertices; v++)
+    {
+        glm::vec3 p = hzglSourcePosition(source, v);
+        *lo = glm::min(*lo, p);
+        *hi = glm::max(*hi, p);
+
+        size_t position = begin + static_cast<size_t>(v + 1) * source.ply.vertex_stride;
+
+        if (source.mapped && position - windowStart >= window)
+        {
+            source.file.Evict(windowStart, position - windowStart);
+            windowStart = position;
+        }
+    }
+
+    if (source.mapped)
+        source.file.Evict(begin, static_cast<size_t>(source.num_vertices) * source.ply.vertex_stride);
+}
+
+// calls triangle() with the corners of every triangle (polygons as fans) in file order; the
+// face pages behind are dropped every window bytes and so are the vertex pages, which come back
+// as needed (scans keep faces close to the vertices they use, so that is not many).
+// False if the file ends early
+static bool hzglForEachTriangle(TriangleSource& source, size_t window, const std::function<void(const glm::vec3*)>& triangle)
+{
+    glm::vec3 corners[3];
+
+    if (!source.mapped)
+    {
+        for (size_t i = 0; i + 2 < source.indices.size(); i += 3)
+        {
+            for (int k = 0; k < 3; k++)
+                corners[k] = hzglSourcePosition(source, source.indices[i + k]);
+
+            triangle(corners);
+        }
+
+        return true;
+    }
+
+    const PlyLayout& ply = source.ply;
+    const hzgl::PlyElement& face = *ply.face;
+    const uint8_t* data = source.file.Data();
+    size_t size = source.file.Size();
+    size_t vertexBytes = static_cast<size_t>(source.num_vertices) * ply.vertex_stride;
+
+    size_t p = ply.face_offset;
+    size_t windowStart = p;
+    std::vector<uint32_t> polygon;
+
+    source.file.AdviseSequential(p, size - p);
+
+    for (int64_t f = 0; f < face.count; f++)
+    {
+        p = hzgl::ReadPlyFace(data, size, p, face, ply.index_property, ply.big_endian, polygon);
+
+        if (p == 0)
+            return false;
+
+        for (size_t i = 1; i + 1 < polygon.size(); i++)
+        {
+            if (polygon[0] >= source.num_vertices || polygon[i] >= source.num_vertices || polygon[i + 1] >= source.num_vertices)
+                continue;
+
+            corners[0] = hzglSourcePosition(source, polygon[0]);
+            corners[1] = hzglSourcePosition(source, polygon[i]);
+            corners[2] = hzglSourcePosition(source, polygon[i + 1]);
+
+            triangle(corners);
+        }
+
+        if (p - windowStart >= window)
+        {
+            source.file.Evict(windowStart, p - windowStart);
+            source.file.Evict(ply.vertex_offset, vertexBytes);
+            windowStart = p;
+        }
+    }
+
+    source.file.Evict(windowStart, p - windowStart);
+    source.file.Evict(ply.vertex_offset, vertexBytes);
+
+    return true;
+}
+
+//
+// partition
+//
+
+// cells of at most 64 per side over the bounds, the chunks are boxes of cells
+typedef struct
+{
+    glm::vec3 origin;
+    float cell = 1.0f;
+    glm::ivec3 dims;
+} ChunkGrid;
+
+// cells of a cell too dense to be a chunk on its own, 8 per side
+static const int hzglFineCells = 8 * 8 * 8;
+
+static int hzglCellIndex(const ChunkGrid& grid, const glm::vec3* corners)
+{
+    glm::vec3 centroid = (corners[0] + corners[1] + corners[2]) / 3.0f;
+    glm::ivec3 c = glm::clamp(glm::ivec3(glm::floor((centroid - grid.origin) / grid.cell)), glm::ivec3(0), grid.dims - 1);
+
+    return (c.z * grid.dims.y + c.y) * grid.dims.x + c.x;
+}
+
+static ChunkGrid hzglFineGrid(const ChunkGrid& grid, int cell)
+{
+    glm::ivec3 c(cell % grid.dims.x, (cell / grid.dims.x) % grid.dims.y, cell / (grid.dims.x * grid.dims.y));
+
+    ChunkGrid fine;
+    fine.origin = grid.origin + glm::vec3(c) * grid.cell;
+    fine.cell = grid.cell / 8.0f;
+    fine.dims = glm::ivec3(8);
+
+    return fine;
+}
+
+// the summed-volume table of the triangles per cell, one larger than the grid on every side
+static std::vector<int64_t> hzglSummedVolume(const int64_t* counts, const glm::ivec3& dims)
+{
+    glm::ivec3 satDims = dims + 1;
+    std::vector<int64_t> sat(static_cast<size_t>(satDims.x) * satDims.y * satDims.z, 0);
+
+    auto at = [&](int i, int j, int k) -> int64_t& { return sat[(static_cast<size_t>(k) * satDims.y + j) * satDims.x + i]; };
+
+    for (int z = 1; z <= dims.z; z++)
+        for (int y = 1; y <= dims.y; y++)
+            for (int x = 1; x <= dims.x; x++)
+            {
+                at(x, y, z) = counts[((z - 1) * dims.y + (y - 1)) * dims.x + (x - 1)]
+                            + at(x - 1, y, z) + at(x, y - 1, z) + at(x, y, z - 1)
+                            - at(x - 1, y - 1, z) - at(x - 1, y, z - 1) - at(x, y - 1, z - 1)
+                            + at(x - 1, y - 1, z - 1);
+            }
+
+    return sat;
+}
+
+// triangles in the cells [lo, hi), from the summed-volume table
+static int64_t hzglBoxCount(const std::vector<int64_t>& sat, const glm::ivec3& dims, const glm::ivec3& lo, const glm::ivec3& hi)
+{
+    auto at = [&](int x, int y, int z) { return sat[(static_cast<size_t>(z) * (dims.y + 1) + y) * (dims.x + 1) + x]; };
+
+    return at(hi.x, hi.y, hi.z) - at(lo.x, hi.y, hi.z) - at(hi.x, lo.y, hi.z) - at(hi.x, hi.y, lo.z)
+         + at(lo.x, lo.y, hi.z) + at(lo.x, hi.y, lo.z) + at(hi.x, lo.y, lo.z) - at(lo.x, lo.y, lo.z);
+}
+
+// halve the box along its longest side (in cells) at the median triangle until a box holds
+// no more than target triangles; every non-empty box becomes a chunk, except a single cell with
+// more than that, which keeps -1 for the caller to split further
+static void hzglSplitCells(const std::vector<int64_t>& sat, const glm::ivec3& dims, const glm::ivec3& lo, const glm::ivec3& hi,
+                           int64_t target, std::vector<int>& cellChunk, std::vector<int64_t>& chunkTriangles)
+{
+    int64_t count = hzglBoxCount(sat, dims, lo, hi);
+
+    if (count == 0)
+        return;
+
+    glm::ivec3 extent = hi - lo;
+
+    if (count > target && extent.x == 1 && extent.y == 1 && extent.z == 1)
+        return;
+
+    if (count <= target)
+    {
+        int chunk = static_cast<int>(chunkTriangles.size());
+        chunkTriangles.push_back(count);
+
+        for (int z = lo.z; z < hi.z; z++)
+            for (int y = lo.y; y < hi.y; y++)
+                for (int x = lo.x; x < hi.x; x++)
+                    cellChunk[(z * dims.y + y) * dims.x + x] = chunk;
+
+        return;
+    }
+
+    int axis = 0;
+    for (int a = 1; a < 3; a++)
+    {
+        if (extent[a] > extent[axis])
+            axis = a;
+    }
+
+    int split = hi[axis] - 1;
+
+    for (int k = lo[axis] + 1; k < hi[axis]; k++)
+    {
+        glm::ivec3 half = hi;
+        half[axis] = k;
+
+        if (2 * hzglBoxCount(sat, dims, lo, half) >= count)
+        {
+            split = k;
+            break;
+        }
+    }
+
+    glm::ivec3 upperLo = lo, lowerHi = hi;
+    lowerHi[axis] = split;
+    upperLo[axis] = split;
+
+    hzglSplitCells(sat, dims, lo, lowerHi, target, cellChunk, chunkTriangles);
+    hzglSplitCells(sat, dims, upperLo, hi, target, cellChunk, chunkTriangles);
+}
+
+//
+// levels of a chunk
+//
+
+typedef struct
+{
+    uint32_t x, y, z;
+    uint32_t corner;
+} WeldKey;
+
+typedef struct
+{
+    int64_t x, y, z;
+    uint32_t vertex;
+} ClusterKey;
+
+static void hzglAppendLevel(std::vector<uint8_t>& blob, const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices,
+                            float error, hzgl::ChunkLevel* level)
+{
+    // area-weighted face normals
+    std::vector<glm::vec3> normals(positions.size(), glm::vec3(0.0f));
+
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        glm::vec3 n = glm::cross(positions[indices[i + 1]] - positions[indices[i]], positions[indices[i + 2]] - positions[indices[i]]);
+
+        for (int k = 0; k < 3; k++)
+            normals[indices[i + k]] += n;
+    }
+
+    blob.resize(hzglAlignUp(blob.size(), hzglChunkAlignment));
+
+    level->offset = blob.size();
+    level->num_vertices = static_cast<uint32_t>(positions.size());
+    level->num_indices = static_cast<uint32_t>(indices.size());
+    level->index_size = (positions.size() <= 65536) ? 2 : 4;
+    level->error = error;
+
+    blob.resize(blob.size() + positions.size() * sizeof(hzgl::ChunkVertex) + indices.size() * level->index_size);
+
+    uint8_t* out = blob.data() + level->offset;
+
+    for (size_t v = 0; v < positions.size(); v++)
+    {
+        float length = glm::length(normals[v]);
+        glm::vec3 n = (length > 0.0f) ? normals[v] / length : glm::vec3(0.0f, 0.0f, 1.0f);
+
+        hzgl::ChunkVertex vertex;
+        memcpy(vertex.position, &positions[v][0], sizeof(vertex.position));
+        for (int k = 0; k < 3; k++)
+            vertex.normal[k] = static_cast<int16_t>(std::round(32767.0f * glm::clamp(n[k], -1.0f, 1.0f)));
+        vertex.normal[3] = 0;
+
+        memcpy(out, &vertex, sizeof(vertex));
+        out += sizeof(vertex);
+    }
+
+    for (uint32_t index : indices)
+    {
+        if (level->index_size == 2)
+        {
+            uint16_t small = static_cast<uint16_t>(index);
+            memcpy(out, &small, sizeof(small));
+        }
+        else
+            memcpy(out, &index, sizeof(index));
+
+        out += level->index_size;
+    }
+}
+
+// level 0 is the welded input, level l clusters the vertices of level 0 on a grid of cells
+// baseCell * 2^l; the grid is the same for every chunk, so neighbours at one level share their
+// border vertices, and an error below a pixel keeps the cracks between levels below one too
+static void hzglBuildChunk(const float* triangles, size_t numTriangles, float baseCell, int numLevels,
+                           std::vector<uint8_t>& blob, hzgl::ChunkRecord* record)
+{
+    std::vector<WeldKey> keys(3 * numTriangles);
+
+    for (size_t c = 0; c < keys.size(); c++)
+    {
+        // + 0.0f turns -0 into 0, so both weld
+        float p[3] = {triangles[3 * c] + 0.0f, triangles[3 * c + 1] + 0.0f, triangles[3 * c + 2] + 0.0f};
+        memcpy(&keys[c].x, p, sizeof(p));
+        keys[c].corner = static_cast<uint32_t>(c);
+    }
+
+    std::sort(keys.begin(), keys.end(), [](const WeldKey& a, const WeldKey& b) {
+        return a.x != b.x ? a.x < b.x : (a.y != b.y ? a.y < b.y : a.z < b.z);
+    });
+
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> cornerVertex(keys.size());
+
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        if (i == 0 || keys[i].x != keys[i - 1].x || keys[i].y != keys[i - 1].y || keys[i].z != keys[i - 1].z)
+            positions.push_back(glm::vec3(triangles[3 * keys[i].corner], triangles[3 * keys[i].corner + 1], triangles[3 * keys[i].corner + 2]));
+
+        cornerVertex[keys[i].corner] = static_cast<uint32_t>(positions.size() - 1);
+    }
+
+    std::vector<WeldKey>().swap(keys);
+
+    std::vector<uint32_t> indices;
+    indices.reserve(cornerVertex.size());
+
+    for (size_t i = 0; i < cornerVertex.size(); i += 3)
+    {
+        uint32_t a = cornerVertex[i], b = cornerVertex[i + 1], c = cornerVertex[i + 2];
+
+        if (a != b && b != c && a != c)
+            indices.insert(indices.end(), {a, b, c});
+    }
+
+    if (indices.empty())
+        return;
+
+    hzglAppendLevel(blob, positions, indices, 0.0f, &record->levels[0]);
+
+    std::vector<ClusterKey> clusters(positions.size());
+    std::vector<uint32_t> vertexCluster(positions.size());
+    std::vector<glm::vec3> lodPositions;
+    std::vector<uint32_t> lodIndices;
+
+    for (int l = 1; l < numLevels; l++)
+    {
+        float cell = baseCell * static_cast<float>(1 << l);
+
+        for (size_t v = 0; v < positions.size(); v++)
+        {
+            glm::vec3 c = glm::floor(positions[v] / cell);
+            clusters[v] = {static_cast<int64_t>(c.x), static_cast<int64_t>(c.y), static_cast<int64_t>(c.z), static_cast<uint32_t>(v)};
+        }
+
+        std::sort(clusters.begin(), clusters.end(), [](const ClusterKey& a, const ClusterKey& b) {
+            return a.x != b.x ? a.x < b.x : (a.y != b.y ? a.y < b.y : a.z < b.z);
+        });
+
+        // every cluster is drawn at the mean of its vertices
+        lodPositions.clear();
+        std::vector<int> members;
+
+        for (size_t i = 0; i < clusters.size(); i++)
+        {
+            if (i == 0 || clusters[i].x != clusters[i - 1].x || clusters[i].y != clusters[i - 1].y || clusters[i].z != clusters[i - 1].z)
+            {
+                lodPositions.push_back(glm::vec3(0.0f));
+                members.push_back(0);
+            }
+
+            lodPositions.back() += positions[clusters[i].vertex];
+            members.back() += 1;
+            vertexCluster[clusters[i].vertex] = static_cast<uint32_t>(lodPositions.size() - 1);
+        }
+
+        for (size_t k = 0; k < lodPositions.size(); k++)
+            lodPositions[k] /= static_cast<float>(members[k]);
+
+        lodIndices.clear();
+
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            uint32_t a = vertexCluster[indices[i]], b = vertexCluster[indices[i + 1]], c = vertexCluster[indices[i + 2]];
+
+            if (a != b && b != c && a != c)
+                lodIndices.insert(lodIndices.end(), {a, b, c});
+        }
+
+        // nothing left at this size: the coarser levels repeat the last one
+        if (lodIndices.empty())
+        {
+            record->levels[l] = record->levels[l - 1];
+            continue;
+        }
+
+        // a vertex moves by at most the diagonal of its cell
+        hzglAppendLevel(blob, lodPositions, lodIndices, cell * std::sqrt(3.0f), &record->levels[l]);
+    }
+
+    blob.resize(hzglAlignUp(blob.size(), hzglChunkAlignment));
+}
+
+// what building a chunk takes per triangle: the weld keys, the corner map, the welded and
+// clustered copies and the levels written out, with room to spare
+static const size_t hzglBuildBytesPerTriangle = 256;
+
+bool hzgl::BuildChunkedMesh(const std::string& inputPath, const std::string& outputPath, const ChunkBuildOptions& options, ChunkBuildStats* stats)
+{
+    HZGL_PROFILE_SCOPE("BuildChunkedMesh");
+
+    ChunkBuildStats result;
+    SimpleTimer totalTimer, timer;
+    totalTimer.Start();
+
+    int numLevels = std::max(1, std::min(options.levels, HZGL_MAX_CHUNK_LEVELS));
+
+    // input and scratch pages resident at once are kept to a quarter of the budget each, the
+    // chunks being built get the other half, and no chunk is larger than that on its own
+    size_t budget = std::max<size_t>(16, options.memory_budget_mb) * 1024 * 1024;
+    size_t window = budget / 4;
+    size_t buildBudget = budget / 2;
+    int64_t target = std::max<int64_t>(256, std::min<int64_t>(options.triangles_per_chunk, buildBudget / hzglBuildBytesPerTriangle));
+
+    TriangleSource source;
+
+    if (!hzglOpenTriangleSource(inputPath, source))
+    {
+        std::cerr << "Failed to read triangles from " << inputPath << std::endl;
+        return false;
+    }
+
+    result.streamed_input = source.mapped;
+    result.input_vertices = source.num_vertices;
+
+    // pass 1: bounds, then triangles per cell and the mean edge length
+    timer.Start();
+
+    glm::vec3 lo, hi;
+    hzglSourceBounds(source, window, &lo, &hi);
+
+    if (lo.x > hi.x)
+    {
+        std::cerr << inputPath << " has no vertices" << std::endl;
+        return false;
+    }
+
+    ChunkGrid grid;
+    glm::vec3 extent = hi - lo;
+    grid.origin = lo;
+    grid.cell = std::max(std::max(extent.x, std::max(extent.y, extent.z)) / 64.0f, 1e-20f);
+    grid.dims = glm::clamp(glm::ivec3(glm::ceil(extent / grid.cell)), glm::ivec3(1), glm::ivec3(64));
+
+    size_t numCells = static_cast<size_t>(grid.dims.x) * grid.dims.y * grid.dims.z;
+    std::vector<int64_t> cellCounts(numCells, 0);
+    double edgeSum = 0.0;
+    int64_t numTriangles = 0;
+
+    bool ok = hzglForEachTriangle(source, window, [&](const glm::vec3* v) {
+        cellCounts[hzglCellIndex(grid, v)] += 1;
+        edgeSum += glm::length(v[1] - v[0]) + glm::length(v[2] - v[1]) + glm::length(v[0] - v[2]);
+        numTriangles += 1;
+    });
+
+    if (!ok || numTriangles == 0)
+    {
+        std::cerr << inputPath << (ok ? " has no triangles" : " ends in the middle of the faces") << std::endl;
+        return false;
+    }
+
+    result.input_triangles = numTriangles;
+    result.scan_ms = 1000.0 * timer.End();
+
+    float baseCell = static_cast<float>(edgeSum / (3.0 * numTriangles));
+
+    // chunks: boxes of cells
+    std::vector<int> cellChunk(numCells, -1);
+    std::vector<int64_t> chunkTriangles;
+    hzglSplitCells(hzglSummedVolume(cellCounts.data(), grid.dims), grid.dims, glm::ivec3(0), grid.dims, target, cellChunk, chunkTriangles);
+
+    // a cell with more than target triangles on its own is split the same way on a finer grid,
+    // counted in one more pass; a fine cell still too dense is cut into runs of target triangles
+    // in the order the passes meet them
+    std::vector<int> cellFine(numCells, -1);
+    int numDense = 0;
+
+    for (size_t cell = 0; cell < numCells; cell++)
+    {
+        if (cellChunk[cell] < 0 && cellCounts[cell] > 0)
+            cellFine[cell] = hzglFineCells * numDense++;
+    }
+
+    std::vector<int64_t> fineCounts(static_cast<size_t>(numDense) * hzglFineCells, 0);
+    std::vector<int> fineChunk(fineCounts.size(), -1);
+    std::vector<bool> fineRuns(fineCounts.size(), false);
+
+    if (numDense > 0)
+    {
+        timer.Start();
+
+        ok = hzglForEachTriangle(source, window, [&](const glm::vec3* v) {
+            int cell = hzglCellIndex(grid, v);
+
+            if (cellFine[cell] >= 0)
+                fineCounts[cellFine[cell] + hzglCellIndex(hzglFineGrid(grid, cell), v)] += 1;
+        });
+
+        if (!ok)
+        {
+            std::cerr << inputPath << " ends in the middle of the faces" << std::endl;
+            return false;
+        }
+
+        const glm::ivec3 fineDims(8);
+        std::vector<int> chunks(hzglFineCells);
+
+        for (size_t cell = 0; cell < numCells; cell++)
+        {
+            if (cellFine[cell] < 0)
+                continue;
+
+            const int64_t* counts = fineCounts.data() + cellFine[cell];
+
+            std::fill(chunks.begin(), chunks.end(), -1);
+            hzglSplitCells(hzglSummedVolume(counts, fineDims), fineDims, glm::ivec3(0), fineDims, target, chunks, chunkTriangles);
+
+            for (int f = 0; f < hzglFineCells; f++)
+            {
+                int fine = cellFine[cell] + f;
+                fineChunk[fine] = chunks[f];
+
+                if (chunks[f] >= 0 || counts[f] == 0)
+                    continue;
+
+                fineChunk[fine] = static_cast<int>(chunkTriangles.size());
+                fineRuns[fine] = true;
+
+                for (int64_t left = counts[f]; left > 0; left -= target)
+                    chunkTriangles.push_back(std::min(left, target));
+            }
+        }
+
+        // from here on, the triangles of every run met so far
+        std::fill(fineCounts.begin(), fineCounts.end(), 0);
+
+        result.scan_ms += 1000.0 * timer.End();
+    }
+
+    int numChunks = static_cast<int>(chunkTriangles.size());
+    result.chunks = numChunks;
+    result.dense_cells = numDense;
+    result.max_chunk_triangles = *std::max_element(chunkTriangles.begin(), chunkTriangles.end());
+
+    // pass 2: every triangle to the range of its chunk in a scratch file
+    timer.Start();
+
+    std::vector<int64_t> chunkFirst(numChunks + 1, 0);
+    for (int c = 0; c < numChunks; c++)
+        chunkFirst[c + 1] = chunkFirst[c] + chunkTriangles[c];
+
+    const size_t triangleBytes = 9 * sizeof(float);
+    std::string scratchPath = outputPath + ".scratch";
+    MappedFile scratch;
+
+    if (!scratch.Create(scratchPath, static_cast<size_t>(numTriangles) * triangleBytes))
+    {
+        std::cerr << "Failed to create " << scratchPath << std::endl;
+        return false;
+    }
+
+    std::vector<int64_t> cursor(chunkFirst.begin(), chunkFirst.end() - 1);
+    std::vector<glm::vec3> chunkMin(numChunks, glm::vec3(std::numeric_limits<float>::max()));
+    std::vector<glm::vec3> chunkMax(numChunks, glm::vec3(-std::numeric_limits<float>::max()));
+    uint8_t* scratchData = scratch.MutableData();
+    size_t written = 0;
+
+    ok = hzglForEachTriangle(source, window, [&](const glm::vec3* v) {
+        int cell = hzglCellIndex(grid, v);
+        int chunk = cellChunk[cell];
+
+        if (chunk < 0)
+        {
+            int fine = cellFine[cell] + hzglCellIndex(hzglFineGrid(grid, cell), v);
+            chunk = fineChunk[fine];
+
+            if (fineRuns[fine])
+                chunk += static_cast<int>(fineCounts[fine]++ / target);
+        }
+
+        memcpy(scratchData + static_cast<size_t>(cursor[chunk]++) * triangleBytes, v, triangleBytes);
+
+        for (int k = 0; k < 3; k++)
+        {
+            chunkMin[chunk] = glm::min(chunkMin[chunk], v[k]);
+            chunkMax[chunk] = glm::max(chunkMax[chunk], v[k]);
+        }
+
+        // written pages go to the file in the background, only dropping them is up to us
+        written += triangleBytes;
+        if (written >= window)
+        {
+            scratch.Evict(0, scratch.Size());
+            written = 0;
+        }
+    });
+
+    scratch.Evict(0, scratch.Size());
+    source.file.Close();
+    std::vector<float>().swap(source.positions);
+    std::vector<unsigned>().swap(source.indices);
+
+    result.scatter_ms = 1000.0 * timer.End();
+
+    if (!ok)
+    {
+        scratch.Close();
+        std::remove(scratchPath.c_str());
+        return false;
+    }
+
+    // pass 3: the levels of every chunk, written as they are done
+    timer.Start();
+
+    std::string tmppath = outputPath + ".tmp";
+    FILE* fp = fopen(tmppath.c_str(), "wb");
+
+    if (fp == nullptr)
+    {
+        std::cerr << "Failed to create " << tmppath << std::endl;
+        scratch.Close();
+        std::remove(scratchPath.c_str());
+        return false;
+    }
+
+    ChunkFileHeader header = {};
+    memcpy(header.magic, hzglChunkMagic, sizeof(header.magic));
+    header.version = hzglChunkVersion;
+    header.num_chunks = static_cast<uint32_t>(numChunks);
+    header.num_levels = static_cast<uint32_t>(numLevels);
+    memcpy(header.bounds_min, &lo[0], sizeof(header.bounds_min));
+    memcpy(header.bounds_max, &hi[0], sizeof(header.bounds_max));
+    header.num_triangles = static_cast<uint64_t>(numTriangles);
+
+    std::vector<ChunkRecord> records(numChunks);
+    size_t tableBytes = hzglAlignUp(sizeof(header) + records.size() * sizeof(ChunkRecord), hzglChunkAlignment);
+
+    // the table is written last, once the offsets are known
+    std::vector<uint8_t> zeros(tableBytes, 0);
+    bool writeOk = fwrite(zeros.data(), 1, zeros.size(), fp) == zeros.size();
+    uint64_t fileOffset = tableBytes;
+    std::mutex writeMutex;
+
+    // the memory of the chunks being built, against buildBudget
+    std::mutex buildMutex;
+    std::condition_variable buildDone;
+    size_t building = 0;
+
+    {
+        int threads = (options.threads > 0) ? options.threads : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        ThreadPool pool(threads, static_cast<size_t>(threads), "Chunks");
+
+        for (int c = 0; c < numChunks; c++)
+        {
+            // a chunk is handed out once what it takes fits next to the ones still building; one
+            // on its own always does
+            size_t bytes = static_cast<size_t>(chunkTriangles[c]) * hzglBuildBytesPerTriangle;
+
+            {
+                std::unique_lock<std::mutex> lock(buildMutex);
+                buildDone.wait(lock, [&]() { return building == 0 || building + bytes <= buildBudget; });
+                building += bytes;
+            }
+
+            pool.Submit([&, c, bytes]() {
+                HZGL_PROFILE_SCOPE("BuildChunk");
+
+                ChunkRecord record = {};
+                memcpy(record.bounds_min, &chunkMin[c][0], sizeof(record.bounds_min));
+                memcpy(record.bounds_max, &chunkMax[c][0], sizeof(record.bounds_max));
+
+                size_t offset = static_cast<size_t>(chunkFirst[c]) * triangleBytes;
+                size_t count = static_cast<size_t>(chunkTriangles[c]);
+
+                std::vector<uint8_t> blob;
+                hzglBuildChunk(reinterpret_cast<const float*>(scratch.Data() + offset), count, baseCell, numLevels, blob, &record);
+                scratch.Evict(offset, count * triangleBytes);
+
+                {
+                    std::lock_guard<std::mutex> lock(writeMutex);
+
+                    for (int l = 0; l < numLevels; l++)
+                        record.levels[l].offset += fileOffset;
+
+                    writeOk = writeOk && (blob.empty() || fwrite(blob.data(), 1, blob.size(), fp) == blob.size());
+                    fileOffset += blob.size();
+                    records[c] = record;
+                }
+
+                std::vector<uint8_t>().swap(blob);
+
+                std::lock_guard<std::mutex> lock(buildMutex);
+                building -= bytes;
+                buildDone.notify_all();
+            });
+        }
+
+        pool.Wait();
+    }
+
+    writeOk = writeOk && fseek(fp, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, fp) == 1
+           && fwrite(records.data(), sizeof(ChunkRecord), records.size(), fp) == records.size();
+    writeOk = (fclose(fp) == 0) && writeOk;
+
+    scratch.Close();
+    std::remove(scratchPath.c_str());
+
+    // readers never see half a file
+    std::remove(outputPath.c_str());
+    if (!writeOk || std::rename(tmppath.c_str(), outputPath.c_str()) != 0)
+    {
+        std::cerr << "Failed to write " << outputPath << std::endl;
+        std::remove(tmppath.c_str());
+        return false;
+    }
+
+    result.build_ms = 1000.0 * timer.End();
+    result.total_ms = 1000.0 * totalTimer.End();
+    result.output_bytes = static_cast<int64_t>(fileOffset);
+    result.peak_rss_mb = GetProcessMemory().peak_resident_bytes / (1024.0 * 1024.0);
+
+    if (stats != nullptr)
+        *stats = result;
+
+    return true;
+}
+
+//
+// streaming
+//
+
+hzgl::MeshStreamer::MeshStreamer()
+    : _header(), _readMs(0.0), _reads(0)
+{
+}
+
+hzgl::MeshStreamer::~MeshStreamer()
+{
+    // GL objects are deleted in Release(), the context may be gone by now; the transfers still
+    // write into this object
+    if (_io != nullptr)
+        _io->Wait();
+}
+
+bool hzgl::MeshStreamer::Open(const std::string& filepath, const StreamingOptions& options)
+{
+    HZGL_PROFILE_SCOPE("MeshStreamer::Open");
+
+    Release();
+
+    if (!_file.Open(filepath) || _file.Size() < sizeof(ChunkFileHeader))
+    {
+        std::cerr << "Failed to open " << filepath << std::endl;
+        _file.Close();
+        return false;
+    }
+
+    memcpy(&_header, _file.Data(), sizeof(_header));
+
+    size_t tableEnd = sizeof(_header) + static_cast<size_t>(_header.num_chunks) * sizeof(ChunkRecord);
+
+    if (memcmp(_header.magic, hzglChunkMagic, sizeof(hzglChunkMagic)) != 0 || _header.version != hzglChunkVersion
+        || _header.num_levels < 1 || _header.num_levels > HZGL_MAX_CHUNK_LEVELS || tableEnd > _file.Size())
+    {
+        std::cerr << filepath << " is not a chunked mesh (see --preprocess)" << std::endl;
+        _file.Close();
+        return false;
+    }
+
+    _records.resize(_header.num_chunks);
+    memcpy(_records.data(), _file.Data() + sizeof(_header), _records.size() * sizeof(ChunkRecord));
+    _file.Evict(0, tableEnd);
+
+    // a level that points outside the file is left out
+    for (auto& record : _records)
+    {
+        for (uint32_t l = 0; l < _header.num_levels; l++)
+        {
+            ChunkLevel& level = record.levels[l];
+            size_t bytes = static_cast<size_t>(level.num_vertices) * sizeof(ChunkVertex) + static_cast<size_t>(level.num_indices) * level.index_size;
+
+            if ((level.index_size != 2 && level.index_size != 4) || level.offset + bytes > _file.Size())
+                level = ChunkLevel();
+        }
+    }
+
+    _chunks.assign(_records.size(), Chunk());
+    _order.reserve(_records.size());
+    _path = filepath;
+    _options = options;
+    _stats = StreamingStats();
+    _stats.chunks = static_cast<int>(_records.size());
+    _readMs = 0.0;
+    _reads = 0;
+
+    _io.reset(new ThreadPool(std::max(1, options.io_threads), 0, "Streaming"));
+
+    std::cout << "Streaming " << filepath << ": " << _header.num_chunks << " chunks, " << _header.num_levels << " levels, "
+              << _header.num_triangles << " triangles" << std::endl;
+
+    return true;
+}
+
+bool hzgl::MeshStreamer::IsOpen() const
+{
+    return _file.IsOpen();
+}
+
+glm::vec3 hzgl::MeshStreamer::Center() const
+{
+    return 0.5f * (glm::vec3(_header.bounds_min[0], _header.bounds_min[1], _header.bounds_min[2])
+                 + glm::vec3(_header.bounds_max[0], _header.bounds_max[1], _header.bounds_max[2]));
+}
+
+float hzgl::MeshStreamer::Radius() const
+{
+    glm::vec3 extent = glm::vec3(_header.bounds_max[0], _header.bounds_max[1], _header.bounds_max[2])
+                     - glm::vec3(_header.bounds_min[0], _header.bounds_min[1], _header.bounds_min[2]);
+
+    return std::max(0.5f * glm::length(extent), 1e-6f);
+}
+
+void hzgl::MeshStreamer::SetPixelError(float pixels)
+{
+    _options.pixel_error = std::max(pixels, 0.1f);
+}
+
+float hzgl::MeshStreamer::PixelError() const
+{
+    return _options.pixel_error;
+}
+
+size_t hzgl::MeshStreamer::levelBytes(int chunk, int level) const
+{
+    const ChunkLevel& l = _records[chunk].levels[level];
+
+    return static_cast<size_t>(l.num_vertices) * sizeof(ChunkVertex) + static_cast<size_t>(l.num_indices) * l.index_size;
+}
+
+void hzgl::MeshStreamer::releaseChunk(Chunk& chunk)
+{
+    if (chunk.buffer != 0)
+    {
+        UntrackGpuResource(HZGL_GPU_BUFFER, chunk.buffer);
+        glDeleteBuffers(1, &chunk.buffer);
+    }
+
+    if (chunk.VAO != 0)
+        glDeleteVertexArrays(1, &chunk.VAO);
+
+    _stats.gpu_bytes -= chunk.bytes;
+
+    chunk.level = -1;
+    chunk.buffer = 0;
+    chunk.VAO = 0;
+    chunk.bytes = 0;
+}
+
+void hzgl::MeshStreamer::startTransfer(int c, int level)
+{
+    Chunk& chunk = _chunks[c];
+    size_t bytes = levelBytes(c, level);
+
+    // the I/O thread writes straight into the buffer, the driver gets it on unmap
+    glGenBuffers(1, &chunk.loadBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, chunk.loadBuffer);
+    glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STATIC_DRAW);
+    void* target = glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (target == nullptr)
+    {
+        glDeleteBuffers(1, &chunk.loadBuffer);
+        chunk.loadBuffer = 0;
+        return;
+    }
+
+    chunk.loading = level;
+    chunk.loadBytes = bytes;
+
+    _stats.in_flight += 1;
+    _stats.in_flight_bytes += bytes;
+
+    size_t offset = static_cast<size_t>(_records[c].levels[level].offset);
+
+    _io->Submit([this, c, target, offset, bytes]() {
+        HZGL_PROFILE_SCOPE("StreamChunk");
+
+        SimpleTimer timer;
+        timer.Start();
+
+        _file.Prefetch(offset, bytes);
+        memcpy(target, _file.Data() + offset, bytes);
+
+        // the copy on the GPU side is the one that is kept
+        _file.Evict(offset, bytes);
+
+        Transfer transfer = {c, true, 1000.0 * timer.End()};
+
+        std::lock_guard<std::mutex> lock(_doneMutex);
+        _done.push_back(transfer);
+    });
+}
+
+void hzgl::MeshStreamer::finishTransfers()
+{
+    {
+        std::lock_guard<std::mutex> lock(_doneMutex);
+        _finished.swap(_done);
+    }
+
+    for (const Transfer& transfer : _finished)
+    {
+        Chunk& chunk = _chunks[transfer.chunk];
+
+        glBindBuffer(GL_ARRAY_BUFFER, chunk.loadBuffer);
+        bool ok = transfer.ok && glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE;
+
+        _stats.in_flight -= 1;
+        _stats.in_flight_bytes -= chunk.loadBytes;
+        _readMs += transfer.ms;
+        _reads += 1;
+
+        // the contents are undefined after a failed unmap (e.g. a mode switch): asked for again
+        if (!ok)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glDeleteBuffers(1, &chunk.loadBuffer);
+            chunk.loadBuffer = 0;
+            chunk.loading = -1;
+            continue;
+        }
+
+        releaseChunk(chunk);
+
+        glGenVertexArrays(1, &chunk.VAO);
+        glBindVertexArray(chunk.VAO);
+
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ChunkVertex), (void*)(0));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_SHORT, GL_TRUE, sizeof(ChunkVertex), (void*)(offsetof(ChunkVertex, normal)));
+        glEnableVertexAttribArray(1);
+
+        // the indices follow the vertices in the same buffer
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, chunk.loadBuffer);
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        chunk.level = chunk.loading;
+        chunk.buffer = chunk.loadBuffer;
+        chunk.bytes = chunk.loadBytes;
+        chunk.loading = -1;
+        chunk.loadBuffer = 0;
+
+        _stats.gpu_bytes += chunk.bytes;
+        _stats.loads += 1;
+
+        TrackGpuResource({HZGL_GPU_BUFFER, chunk.buffer, chunk.bytes, "Streaming", _path,
+                          "chunk " + std::to_string(transfer.chunk) + " level " + std::to_string(chunk.level)});
+    }
+
+    _finished.clear();
+
+    _stats.read_ms = (_reads > 0) ? _readMs / _reads : 0.0;
+}
+
+void hzgl::MeshStreamer::Update(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, int viewportHeight)
+{
+    if (!IsOpen())
+        return;
+
+    HZGL_PROFILE_SCOPE("MeshStreamer::Update");
+
+    SimpleTimer timer;
+    timer.Start();
+
+    finishTransfers();
+
+    // everything in object space: the eye, and the frustum planes of the combined matrix
+    glm::mat4 modelView = view * model;
+    glm::vec3 eye = glm::vec3(glm::inverse(modelView) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    glm::mat4 clip = projection * modelView;
+
+    glm::vec4 planes[6];
+    for (int i = 0; i < 3; i++)
+    {
+        planes[2 * i] = glm::vec4(clip[0][3] + clip[0][i], clip[1][3] + clip[1][i], clip[2][3] + clip[2][i], clip[3][3] + clip[3][i]);
+        planes[2 * i + 1] = glm::vec4(clip[0][3] - clip[0][i], clip[1][3] - clip[1][i], clip[2][3] - clip[2][i], clip[3][3] - clip[3][i]);
+    }
+
+    // pixels per unit of object space at distance 1 (with a uniform scale in model, the ratio of
+    // the error to the distance does not depend on it)
+    float pixelsPerUnit = 0.5f * viewportHeight * projection[1][1];
+    int coarsest = static_cast<int>(_header.num_levels) - 1;
+
+    _stats.visible = 0;
+
+    for (size_t c = 0; c < _chunks.size(); c++)
+    {
+        Chunk& chunk = _chunks[c];
+        const ChunkRecord& record = _records[c];
+
+        chunk.target = -1;
+        chunk.visible = false;
+        chunk.priority = 0.0f;
+
+        if (record.levels[0].num_indices == 0)
+            continue;
+
+        glm::vec3 lo(record.bounds_min[0], record.bounds_min[1], record.bounds_min[2]);
+        glm::vec3 hi(record.bounds_max[0], record.bounds_max[1], record.bounds_max[2]);
+
+        chunk.visible = true;
+        for (int p = 0; p < 6 && chunk.visible; p++)
+        {
+            glm::vec3 corner(planes[p].x >= 0.0f ? hi.x : lo.x, planes[p].y >= 0.0f ? hi.y : lo.y, planes[p].z >= 0.0f ? hi.z : lo.z);
+            chunk.visible = glm::dot(glm::vec3(planes[p]), corner) + planes[p].w >= 0.0f;
+        }
+
+        float distance = std::max(glm::length(glm::max(glm::max(lo - eye, eye - hi), glm::vec3(0.0f))), 1e-6f);
+        float radius = 0.5f * glm::length(hi - lo);
+
+        // the coarsest level whose error stays below the threshold on screen; chunks out of
+        // view keep the coarsest one around, for when the camera turns
+        int level = coarsest;
+
+        if (chunk.visible)
+        {
+            while (level > 0 && record.levels[level].error * pixelsPerUnit > _options.pixel_error * distance)
+                level--;
+        }
+
+        chunk.target = level;
+        chunk.priority = radius * pixelsPerUnit / distance * (chunk.visible ? 1.0f : 0.01f);
+
+        if (chunk.visible)
+            _stats.visible += 1;
+    }
+
+    // the GPU budget goes to the chunks that cover most of the screen first; one that does not
+    // fit at its level gets a coarser one, or none
+    _order.resize(_chunks.size());
+    for (size_t c = 0; c < _chunks.size(); c++)
+        _order[c] = static_cast<int>(c);
+
+    std::sort(_order.begin(), _order.end(), [this](int a, int b) { return _chunks[a].priority > _chunks[b].priority; });
+
+    size_t gpuBudget = _options.gpu_budget_mb * 1024 * 1024;
+    size_t cpuBudget = _options.cpu_budget_mb * 1024 * 1024;
+    size_t uploadBudget = _options.upload_mb_per_frame * 1024 * 1024;
+    size_t assigned = 0;
+    size_t submitted = 0;
+
+    _stats.budget_limited = 0;
+
+    for (int c : _order)
+    {
+        Chunk& chunk = _chunks[c];
+
+        if (chunk.target < 0)
+            continue;
+
+        int level = chunk.target;
+        while (level < coarsest && assigned + levelBytes(c, level) > gpuBudget)
+            level++;
+
+        if (level != chunk.target)
+            _stats.budget_limited += 1;
+
+        if (assigned + levelBytes(c, level) > gpuBudget)
+        {
+            chunk.target = -1;
+            continue;
+        }
+
+        chunk.target = level;
+        assigned += levelBytes(c, level);
+    }
+
+    // out of the budget: gone now
+    for (Chunk& chunk : _chunks)
+    {
+        if (chunk.target < 0 && chunk.level >= 0)
+        {
+            releaseChunk(chunk);
+            _stats.evictions += 1;
+        }
+    }
+
+    // changed: the resident level stays until the new one is in, so both count against the GPU
+    // budget while it loads. A transfer that does not fit waits for others to finish and free
+    // their old levels; with nothing in flight, the old level goes first
+    size_t reserved = _stats.gpu_bytes + _stats.in_flight_bytes;
+
+    for (int c : _order)
+    {
+        Chunk& chunk = _chunks[c];
+
+        if (chunk.target < 0 || chunk.level == chunk.target || chunk.loading >= 0)
+            continue;
+
+        // nothing there yet: the coarsest level first, it is small and fills the hole quickly
+        int level = (chunk.level < 0 && chunk.target < coarsest && chunk.visible) ? coarsest : chunk.target;
+        size_t bytes = levelBytes(c, level);
+
+        // at least one transfer is always allowed, so a level larger than the budgets still comes in
+        bool idle = (_stats.in_flight == 0 && submitted == 0);
+
+        if (!idle && (_stats.in_flight_bytes + bytes > cpuBudget || submitted + bytes > uploadBudget))
+            break;
+
+        if (reserved + bytes > gpuBudget)
+        {
+            if (!idle || chunk.level < 0 || reserved - chunk.bytes + bytes > gpuBudget)
+                continue;
+
+            reserved -= chunk.bytes;
+            releaseChunk(chunk);
+            _stats.evictions += 1;
+        }
+
+        startTransfer(c, level);
+        reserved += bytes;
+        submitted += bytes;
+    }
+
+    _stats.resident = 0;
+    for (const auto& chunk : _chunks)
+        _stats.resident += (chunk.level >= 0) ? 1 : 0;
+
+    _stats.update_ms = 1000.0 * timer.End();
+}
+
+void hzgl::MeshStreamer::Draw()
+{
+    if (!IsOpen())
+        return;
+
+    HZGL_PROFILE_SCOPE("MeshStreamer::Draw");
+
+    _stats.drawn = 0;
+    _stats.drawn_triangles = 0;
+
+    for (size_t c = 0; c < _chunks.size(); c++)
+    {
+        const Chunk& chunk = _chunks[c];
+
+        if (!chunk.visible || chunk.level < 0)
+            continue;
+
+        const ChunkLevel& level = _records[c].levels[chunk.level];
+        GLenum indexType = (level.index_size == 2) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+        glBindVertexArray(chunk.VAO);
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(level.num_indices), indexType,
+                       (void*)(static_cast<size_t>(level.num_vertices) * sizeof(ChunkVertex)));
+
+        _stats.drawn += 1;
+        _stats.drawn_triangles += level.num_indices / 3;
+    }
+
+    glBindVertexArray(0);
+}
+
+const hzgl::StreamingStats& hzgl::MeshStreamer::Stats() const
+{
+    return _stats;
+}
+
+const std::string& hzgl::MeshStreamer::Path() const
+{
+    return _path;
+}
+
+void hzgl::MeshStreamer::Release()
+{
+    if (_io != nullptr)
+    {
+        _io->Wait();
+        finishTransfers();
+    }
+
+    for (auto& chunk : _chunks)
+        releaseChunk(chunk);
+
+    _chunks.clear();
+    _records.clear();
+    _stats = StreamingStats();
+    _file.Close();
+}
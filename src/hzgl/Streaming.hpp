@@ -0,0 +1,198 @@
+#pragma once
+
+#include "MappedFile.hpp"
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+namespace hzgl
+{
+    class ThreadPool;
+
+    const int HZGL_MAX_CHUNK_LEVELS = 8;
+
+    // .hzchunks: a header, the chunk table, then the vertices and indices of every level of every
+    // chunk, each level at a page-aligned offset so that it can be mapped and dropped on its own
+    typedef struct
+    {
+        char magic[8];                  // "HZCHUNK1"
+        uint32_t version;
+        uint32_t num_chunks;
+        uint32_t num_levels;            // of every chunk
+        uint32_t reserved;
+        float bounds_min[3];
+        float bounds_max[3];
+        uint64_t num_triangles;         // at the finest level
+    } ChunkFileHeader;
+
+    typedef struct
+    {
+        uint64_t offset;                // of the vertices, the indices follow
+        uint32_t num_vertices;
+        uint32_t num_indices;
+        uint32_t index_size;            // 2 or 4 bytes
+        float error;                    // world-space distance to the finest level
+    } ChunkLevel;
+
+    typedef struct
+    {
+        float bounds_min[3];
+        float bounds_max[3];
+        ChunkLevel levels[HZGL_MAX_CHUNK_LEVELS];   // finest first
+    } ChunkRecord;
+
+    // position, then the normal as normalized shorts (w unused), read as vec3 by the shaders
+    typedef struct
+    {
+        float position[3];
+        int16_t normal[4];
+    } ChunkVertex;
+
+    typedef struct
+    {
+        int triangles_per_chunk = 65536;    // at most, at the finest level (less if the budget asks for it)
+        int levels = 5;                     // each about a quarter of the triangles of the previous
+        size_t memory_budget_mb = 1024;     // input and scratch pages resident at once, and the chunks being built
+        int threads = 0;                    // chunk workers, 0: one per core
+    } ChunkBuildOptions;
+
+    typedef struct
+    {
+        int64_t input_vertices = 0;
+        int64_t input_triangles = 0;
+        int chunks = 0;
+        int64_t max_chunk_triangles = 0;
+        int dense_cells = 0;                // cells of the coarse grid split on a finer one
+        int64_t output_bytes = 0;
+        bool streamed_input = false;        // false: the input went through Assimp, in memory
+        double scan_ms = 0.0;               // bounds and cell counts, fine cells included
+        double scatter_ms = 0.0;            // triangles to the scratch file, by chunk
+        double build_ms = 0.0;              // welding, levels and writing
+        double total_ms = 0.0;
+        double peak_rss_mb = 0.0;
+    } ChunkBuildStats;
+
+    // split a mesh into spatially coherent chunks of about triangles_per_chunk triangles, with
+    // coarser levels made by clustering vertices on a grid, and write them to a .hzchunks file.
+    // Binary PLY input is read through a mapping and never held in memory as a whole; other
+    // formats are loaded through Assimp first
+    bool BuildChunkedMesh(const std::string& inputPath, const std::string& outputPath,
+                          const ChunkBuildOptions& options = ChunkBuildOptions(), ChunkBuildStats* stats = nullptr);
+
+    typedef struct
+    {
+        size_t gpu_budget_mb = 512;         // vertex and index buffers of the resident levels and those in flight
+        size_t cpu_budget_mb = 64;          // transfers in flight
+        float pixel_error = 1.0f;           // finest level needed when its error is above this
+        size_t upload_mb_per_frame = 64;    // buffers mapped for transfers per Update()
+        int io_threads = 2;
+    } StreamingOptions;
+
+    typedef struct
+    {
+        int chunks = 0;
+        int resident = 0;                   // chunks with a level on the GPU
+        int visible = 0;                    // inside the frustum
+        int drawn = 0;                      // visible and resident, by the last Draw()
+        int in_flight = 0;                  // transfers not finished yet
+        int64_t drawn_triangles = 0;
+        size_t gpu_bytes = 0;
+        size_t in_flight_bytes = 0;
+        int64_t loads = 0;                  // since Open()
+        int64_t evictions = 0;
+        int64_t budget_limited = 0;         // chunks drawn coarser than wanted for the GPU budget
+        double read_ms = 0.0;               // mean time of a transfer on the I/O threads
+        double update_ms = 0.0;             // last Update() on the render thread
+    } StreamingStats;
+
+    // draws a .hzchunks file of any size: every Update() picks a level for each chunk from its
+    // projected error, fits the result into the GPU budget (the chunks closest to the camera first),
+    // and streams levels in and out; a level in flight counts against the budget along with the
+    // one it replaces. Transfers copy from the mapped file into mapped GL buffers on
+    // I/O threads, and the file pages they read are dropped right after
+    class MeshStreamer
+    {
+    private:
+        typedef struct
+        {
+            int level = -1;             // resident level, -1: none
+            GLuint VAO = 0;
+            GLuint buffer = 0;          // vertices, then indices
+            size_t bytes = 0;
+
+            int loading = -1;           // level in flight, -1: none
+            GLuint loadBuffer = 0;
+            size_t loadBytes = 0;
+
+            int target = -1;            // chosen by the last Update()
+            bool visible = false;
+            float priority = 0.0f;
+        } Chunk;
+
+        typedef struct
+        {
+            int chunk;
+            bool ok;
+            double ms;
+        } Transfer;
+
+        MappedFile _file;
+        ChunkFileHeader _header;
+        std::vector<ChunkRecord> _records;
+        std::vector<Chunk> _chunks;
+        std::vector<int> _order;                // scratch for Update()
+        std::string _path;
+
+        StreamingOptions _options;
+        StreamingStats _stats;
+        double _readMs;
+        int64_t _reads;
+
+        std::mutex _doneMutex;
+        std::vector<Transfer> _done;            // filled by the I/O threads
+        std::vector<Transfer> _finished;        // swapped with _done by the render thread
+
+        // last, so that its threads are joined before anything they touch is destroyed
+        std::unique_ptr<ThreadPool> _io;
+
+        size_t levelBytes(int chunk, int level) const;
+        void finishTransfers();
+        void startTransfer(int chunk, int level);
+        void releaseChunk(Chunk& chunk);
+
+    public:
+        MeshStreamer();
+        ~MeshStreamer();
+
+        MeshStreamer(const MeshStreamer&) = delete;
+        MeshStreamer& operator=(const MeshStreamer&) = delete;
+
+        bool Open(const std::string& filepath, const StreamingOptions& options = StreamingOptions());
+        bool IsOpen() const;
+
+        // center and radius of the bounds, to frame the mesh
+        glm::vec3 Center() const;
+        float Radius() const;
+
+        void SetPixelError(float pixels);
+        float PixelError() const;
+
+        // pick the levels for a view and move data; viewportHeight in pixels
+        void Update(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, int viewportHeight);
+
+        // the visible chunks, with whatever program is in use (positions at 0, normals at 1)
+        void Draw();
+
+        const StreamingStats& Stats() const;
+        const std::string& Path() const;
+
+        // wait for the transfers and delete the GL objects (needs the context that created them)
+        void Release();
+    };
+} // namespace hzgl
@@ -0,0 +1,597 @@
+#include "Tangents.hpp"
+
+#include "Timer.hpp"
+#include "Profiler.hpp"
+#include "ThreadPool.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <algorithm>
+#include <functional>
+
+// a range split into a few chunks per worker, body(begin, end) runs once per chunk
+static void hzglForChunks(hzgl::ThreadPool* pool, size_t count, const std::function<void(size_t, size_t)>& body)
+{
+    size_t chunks = (pool == nullptr) ? 1 : std::min(count / 1024 + 1, static_cast<size_t>(4 * pool->NumThreads()));
+
+    if (chunks <= 1)
+    {
+        body(0, count);
+        return;
+    }
+
+    for (size_t c = 0; c < chunks; c++)
+    {
+        size_t begin = count * c / chunks;
+        size_t end = count * (c + 1) / chunks;
+        pool->Submit([&body, begin, end]() { body(begin, end); });
+    }
+
+    pool->Wait();
+}
+
+// bit pattern of a coordinate, with -0 and +0 made equal
+static uint32_t hzglBits(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    return (bits == 0x80000000u) ? 0u : bits;
+}
+
+typedef struct
+{
+    uint32_t bits[3];
+    unsigned vertex;
+} hzglPositionKey;
+
+static bool hzglKeyLess(const hzglPositionKey& a, const hzglPositionKey& b)
+{
+    if (a.bits[0] != b.bits[0])
+        return a.bits[0] < b.bits[0];
+    if (a.bits[1] != b.bits[1])
+        return a.bits[1] < b.bits[1];
+
+    return a.bits[2] < b.bits[2];
+}
+
+// vertices ordered by position: chunks sorted in parallel, then merged pairwise
+static void hzglSortByPosition(std::vector<hzglPositionKey>& keys, hzgl::ThreadPool* pool)
+{
+    size_t count = keys.size();
+    size_t chunks = (pool == nullptr) ? 1 : std::min(count / 4096 + 1, static_cast<size_t>(pool->NumThreads()));
+
+    if (chunks <= 1)
+    {
+        std::sort(keys.begin(), keys.end(), hzglKeyLess);
+        return;
+    }
+
+    std::vector<size_t> bounds;
+    for (size_t c = 0; c <= chunks; c++)
+        bounds.push_back(count * c / chunks);
+
+    for (size_t c = 0; c < chunks; c++)
+    {
+        auto begin = keys.begin() + bounds[c];
+        auto end = keys.begin() + bounds[c + 1];
+        pool->Submit([begin, end]() { std::sort(begin, end, hzglKeyLess); });
+    }
+
+    pool->Wait();
+
+    while (bounds.size() > 2)
+    {
+        std::vector<size_t> merged;
+
+        for (size_t b = 0; b + 2 < bounds.size(); b += 2)
+        {
+            auto begin = keys.begin() + bounds[b];
+            auto middle = keys.begin() + bounds[b + 1];
+            auto end = keys.begin() + bounds[b + 2];
+            pool->Submit([begin, middle, end]() { std::inplace_merge(begin, middle, end, hzglKeyLess); });
+            merged.push_back(bounds[b]);
+        }
+
+        // an odd run is carried over to the next round
+        if ((bounds.size() - 1) % 2 == 1)
+            merged.push_back(bounds[bounds.size() - 2]);
+
+        merged.push_back(count);
+        pool->Wait();
+
+        bounds.swap(merged);
+    }
+}
+
+static glm::vec3 hzglVec3(const std::vector<float>& data, unsigned i)
+{
+    return glm::vec3(data[3 * static_cast<size_t>(i)], data[3 * static_cast<size_t>(i) + 1], data[3 * static_cast<size_t>(i) + 2]);
+}
+
+static glm::vec2 hzglVec2(const std::vector<float>& data, unsigned i)
+{
+    return glm::vec2(data[2 * static_cast<size_t>(i)], data[2 * static_cast<size_t>(i) + 1]);
+}
+
+// any unit vector orthogonal to n
+static glm::vec3 hzglPerpendicular(const glm::vec3& n)
+{
+    glm::vec3 axis = (std::abs(n.x) < 0.9f) ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    return glm::normalize(glm::cross(n, axis));
+}
+
+static float hzglAngle(glm::vec3 a, glm::vec3 b)
+{
+    float length = glm::length(a) * glm::length(b);
+
+    if (length <= 0.0f)
+        return 0.0f;
+
+    return std::acos(std::min(std::max(glm::dot(a, b) / length, -1.0f), 1.0f));
+}
+
+void hzgl::EncodeQTangent(const glm::vec3& normal, const glm::vec3& tangent, float sign, int16_t q[4])
+{
+    glm::vec3 n = glm::normalize(normal);
+    glm::vec3 t = tangent - glm::dot(tangent, n) * n;
+
+    t = (glm::length(t) > 1e-6f) ? glm::normalize(t) : hzglPerpendicular(n);
+    glm::vec3 b = glm::cross(n, t);
+
+    // the rotation with the columns t, b, n as a quaternion (x, y, z, w)
+    float x, y, z, w;
+    float trace = t.x + b.y + n.z;
+
+    if (trace > 0.0f)
+    {
+        float s = 0.5f / std::sqrt(trace + 1.0f);
+        w = 0.25f / s;
+        x = (b.z - n.y) * s;
+        y = (n.x - t.z) * s;
+        z = (t.y - b.x) * s;
+    }
+    else if (t.x > b.y && t.x > n.z)
+    {
+        float s = 2.0f * std::sqrt(1.0f + t.x - b.y - n.z);
+        w = (b.z - n.y) / s;
+        x = 0.25f * s;
+        y = (b.x + t.y) / s;
+        z = (n.x + t.z) / s;
+    }
+    else if (b.y > n.z)
+    {
+        float s = 2.0f * std::sqrt(1.0f + b.y - t.x - n.z);
+        w = (n.x - t.z) / s;
+        x = (b.x + t.y) / s;
+        y = 0.25f * s;
+        z = (n.y + b.z) / s;
+    }
+    else
+    {
+        float s = 2.0f * std::sqrt(1.0f + n.z - t.x - b.y);
+        w = (t.y - b.x) / s;
+        x = (n.x + t.z) / s;
+        y = (n.y + b.z) / s;
+        z = 0.25f * s;
+    }
+
+    float length = std::sqrt(x * x + y * y + z * z + w * w);
+    float scale = (w < 0.0f ? -1.0f : 1.0f) / length;
+    x *= scale;
+    y *= scale;
+    z *= scale;
+    w *= scale;
+
+    // w may not round to 0, the sign of w is the handedness
+    const float bias = 1.0f / 32767.0f;
+
+    if (w < bias)
+    {
+        float xyz = std::sqrt(x * x + y * y + z * z);
+        float f = (xyz > 0.0f) ? std::sqrt(1.0f - bias * bias) / xyz : 0.0f;
+        x *= f;
+        y *= f;
+        z *= f;
+        w = bias;
+    }
+
+    float s = (sign < 0.0f) ? -1.0f : 1.0f;
+    float values[4] = {s * x, s * y, s * z, s * w};
+
+    for (int k = 0; k < 4; k++)
+        q[k] = static_cast<int16_t>(std::lround(std::min(std::max(values[k], -1.0f), 1.0f) * 32767.0f));
+}
+
+void hzgl::DecodeQTangent(const int16_t q[4], glm::vec3* normal, glm::vec3* tangent, float* sign)
+{
+    glm::vec4 v = glm::normalize(glm::vec4(q[0], q[1], q[2], q[3]));
+
+    float x = v.x, y = v.y, z = v.z, w = v.w;
+
+    *tangent = glm::vec3(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y));
+    *normal = glm::vec3(2.0f * (x * z + w * y), 2.0f * (y * z - w * x), 1.0f - 2.0f * (x * x + y * y));
+    *sign = (q[3] < 0) ? -1.0f : 1.0f;
+}
+
+void hzgl::GenerateTangentFrames(MeshInfo& mesh, const TangentFrameOptions& options, ThreadPool* pool, TangentFrameStats* stats)
+{
+    HZGL_PROFILE_SCOPE("GenerateTangentFrames");
+
+    TangentFrameStats localStats;
+    TangentFrameStats& st = (stats != nullptr) ? *stats : localStats;
+    st = TangentFrameStats();
+
+    SimpleTimer totalTimer, timer;
+    totalTimer.Start();
+
+    size_t numVertices = mesh.positions.size() / 3;
+    size_t numCorners = mesh.indices.size() - mesh.indices.size() % 3;
+    size_t numFaces = numCorners / 3;
+
+    st.input_vertices = static_cast<int>(numVertices);
+    st.output_vertices = static_cast<int>(numVertices);
+
+    if (numFaces == 0)
+        return;
+
+    bool fileNormals = options.keep_normals && mesh.normals.size() == 3 * numVertices;
+    bool hasTexcoords = mesh.texcoords.size() == 2 * numVertices;
+    bool tangents = options.tangents && hasTexcoords;
+
+    const std::vector<float>& positions = mesh.positions;
+    const std::vector<unsigned>& indices = mesh.indices;
+
+    // weld: one group per distinct position, and the corners of each group (in corner order)
+    timer.Start();
+
+    std::vector<hzglPositionKey> keys(numVertices);
+
+    hzglForChunks(pool, numVertices, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; v++)
+        {
+            for (int k = 0; k < 3; k++)
+                keys[v].bits[k] = hzglBits(positions[3 * v + k]);
+
+            keys[v].vertex = static_cast<unsigned>(v);
+        }
+    });
+
+    hzglSortByPosition(keys, pool);
+
+    std::vector<unsigned> vertexGroup(numVertices);
+    unsigned numGroups = 0;
+
+    for (size_t i = 0; i < numVertices; i++)
+    {
+        if (i > 0 && (hzglKeyLess(keys[i - 1], keys[i]) || hzglKeyLess(keys[i], keys[i - 1])))
+            numGroups += 1;
+
+        vertexGroup[keys[i].vertex] = numGroups;
+    }
+
+    numGroups += 1;
+    std::vector<hzglPositionKey>().swap(keys);
+
+    std::vector<unsigned> groupStart(numGroups + 1, 0);
+    std::vector<unsigned> groupCorners(numCorners);
+
+    for (size_t c = 0; c < numCorners; c++)
+        groupStart[vertexGroup[indices[c]] + 1] += 1;
+
+    std::partial_sum(groupStart.begin(), groupStart.end(), groupStart.begin());
+
+    {
+        std::vector<unsigned> next(groupStart.begin(), groupStart.end() - 1);
+
+        for (size_t c = 0; c < numCorners; c++)
+            groupCorners[next[vertexGroup[indices[c]]]++] = static_cast<unsigned>(c);
+    }
+
+    std::vector<unsigned>().swap(vertexGroup);
+    st.weld_ms = 1000.0 * timer.End();
+
+    // per face: unit normal, dP/du (MikkTSpace vOs) with the orientation of the UV mapping, and
+    // the angle at each corner
+    timer.Start();
+
+    std::vector<glm::vec3> faceNormals(numFaces);
+    std::vector<glm::vec3> faceTangents(tangents ? numFaces : 0);
+    std::vector<signed char> faceSigns(tangents ? numFaces : 0);
+    std::vector<float> cornerAngles(numCorners);
+
+    hzglForChunks(pool, numFaces, [&](size_t begin, size_t end) {
+        for (size_t f = begin; f < end; f++)
+        {
+            const unsigned* idx = &indices[3 * f];
+            glm::vec3 p[3] = {hzglVec3(positions, idx[0]), hzglVec3(positions, idx[1]), hzglVec3(positions, idx[2])};
+
+            glm::vec3 n = glm::cross(p[1] - p[0], p[2] - p[0]);
+            float length = glm::length(n);
+            faceNormals[f] = (length > 0.0f) ? n / length : glm::vec3(0.0f);
+
+            for (int k = 0; k < 3; k++)
+                cornerAngles[3 * f + k] = hzglAngle(p[(k + 1) % 3] - p[k], p[(k + 2) % 3] - p[k]);
+
+            if (!tangents)
+                continue;
+
+            glm::vec2 t[3] = {hzglVec2(mesh.texcoords, idx[0]), hzglVec2(mesh.texcoords, idx[1]), hzglVec2(mesh.texcoords, idx[2])};
+            glm::vec3 d1 = p[1] - p[0];
+            glm::vec3 d2 = p[2] - p[0];
+            glm::vec2 t21 = t[1] - t[0];
+            glm::vec2 t31 = t[2] - t[0];
+
+            float area = t21.x * t31.y - t21.y * t31.x;
+            glm::vec3 os = t31.y * d1 - t21.y * d2;
+            float lengthOs = glm::length(os);
+
+            // degenerate UVs give no direction and join any frame at their vertices
+            faceSigns[f] = (area > 0.0f) ? 1 : ((area < 0.0f) ? -1 : 0);
+            faceTangents[f] = (area != 0.0f && lengthOs > 0.0f) ? os * (((area > 0.0f) ? 1.0f : -1.0f) / lengthOs) : glm::vec3(0.0f);
+        }
+    });
+
+    // per corner normal: the faces around its position within the crease angle of its own face,
+    // weighted by their angle at that position (or the normal of the file)
+    std::vector<glm::vec3> cornerNormals(numCorners);
+    float cosCrease = std::cos(glm::radians(std::min(std::max(options.crease_angle, 0.0f), 180.0f)));
+
+    hzglForChunks(pool, numGroups, [&](size_t begin, size_t end) {
+        std::vector<glm::vec3> clusterNormals, clusterSums;
+        std::vector<unsigned> cornerCluster;
+
+        for (size_t g = begin; g < end; g++)
+        {
+            const unsigned* corners = &groupCorners[groupStart[g]];
+            unsigned count = groupStart[g + 1] - groupStart[g];
+
+            if (fileNormals)
+            {
+                for (unsigned i = 0; i < count; i++)
+                {
+                    glm::vec3 n = hzglVec3(mesh.normals, indices[corners[i]]);
+                    cornerNormals[corners[i]] = (glm::length(n) > 0.0f) ? glm::normalize(n) : faceNormals[corners[i] / 3];
+                }
+
+                continue;
+            }
+
+            if (count <= 64)
+            {
+                for (unsigned i = 0; i < count; i++)
+                {
+                    glm::vec3 fi = faceNormals[corners[i] / 3];
+                    glm::vec3 sum(0.0f);
+
+                    for (unsigned j = 0; j < count; j++)
+                    {
+                        glm::vec3 fj = faceNormals[corners[j] / 3];
+
+                        if (glm::dot(fi, fj) >= cosCrease)
+                            sum += cornerAngles[corners[j]] * fj;
+                    }
+
+                    cornerNormals[corners[i]] = sum;
+                }
+            }
+            else
+            {
+                // fan centers: faces join the first cluster within the crease angle, which keeps
+                // the cost linear in the number of faces around the position
+                clusterNormals.clear();
+                clusterSums.clear();
+                cornerCluster.resize(count);
+
+                for (unsigned i = 0; i < count; i++)
+                {
+                    glm::vec3 fi = faceNormals[corners[i] / 3];
+                    unsigned k = 0;
+
+                    while (k < clusterNormals.size() && glm::dot(clusterNormals[k], fi) < cosCrease)
+                        k++;
+
+                    if (k == clusterNormals.size())
+                    {
+                        clusterNormals.push_back(fi);
+                        clusterSums.push_back(glm::vec3(0.0f));
+                    }
+
+                    clusterSums[k] += cornerAngles[corners[i]] * fi;
+                    cornerCluster[i] = k;
+                }
+
+                for (unsigned i = 0; i < count; i++)
+                    cornerNormals[corners[i]] = clusterSums[cornerCluster[i]];
+            }
+
+            for (unsigned i = 0; i < count; i++)
+            {
+                glm::vec3& n = cornerNormals[corners[i]];
+
+                if (glm::length(n) > 0.0f)
+                {
+                    n = glm::normalize(n);
+                    continue;
+                }
+
+                // a degenerate face: smooth over everything at the position
+                glm::vec3 sum(0.0f);
+                for (unsigned j = 0; j < count; j++)
+                    sum += cornerAngles[corners[j]] * faceNormals[corners[j] / 3];
+
+                n = (glm::length(sum) > 0.0f) ? glm::normalize(sum) : glm::vec3(0.0f, 1.0f, 0.0f);
+            }
+        }
+    });
+
+    st.normals_ms = 1000.0 * timer.End();
+
+    // corners at one position share a vertex when normal and UV match and the UV mapping has the
+    // same orientation; rep is the first corner of each vertex
+    timer.Start();
+
+    std::vector<unsigned> rep(numCorners);
+
+    hzglForChunks(pool, numGroups, [&](size_t begin, size_t end) {
+        std::vector<unsigned> reps;
+
+        auto same = [&](unsigned a, unsigned b) {
+            if (cornerNormals[a] != cornerNormals[b])
+                return false;
+
+            return !hasTexcoords || hzglVec2(mesh.texcoords, indices[a]) == hzglVec2(mesh.texcoords, indices[b]);
+        };
+
+        for (size_t g = begin; g < end; g++)
+        {
+            const unsigned* corners = &groupCorners[groupStart[g]];
+            unsigned count = groupStart[g + 1] - groupStart[g];
+
+            reps.clear();
+
+            // corners with an orientation first, the ones with degenerate UVs join any of them
+            for (int pass = 0; pass < 2; pass++)
+            {
+                for (unsigned i = 0; i < count; i++)
+                {
+                    unsigned c = corners[i];
+                    int sign = tangents ? faceSigns[c / 3] : 1;
+
+                    if ((pass == 0) != (sign != 0))
+                        continue;
+
+                    rep[c] = c;
+
+                    for (unsigned r : reps)
+                    {
+                        if ((pass == 1 || faceSigns.empty() || faceSigns[r / 3] == sign) && same(c, r))
+                        {
+                            rep[c] = r;
+                            break;
+                        }
+                    }
+
+                    if (rep[c] == c)
+                        reps.push_back(c);
+                }
+            }
+        }
+    });
+
+    std::vector<unsigned> vertexOf(numCorners);
+    std::vector<unsigned> vertexCorners;
+    vertexCorners.reserve(numVertices);
+
+    for (size_t c = 0; c < numCorners; c++)
+    {
+        if (rep[c] != c)
+            continue;
+
+        vertexOf[c] = static_cast<unsigned>(vertexCorners.size());
+        vertexCorners.push_back(static_cast<unsigned>(c));
+    }
+
+    size_t numOutput = vertexCorners.size();
+
+    std::vector<unsigned>().swap(groupStart);
+    std::vector<unsigned>().swap(groupCorners);
+
+    // the new vertices, in the order their first corner appears
+    std::vector<float> newPositions(3 * numOutput);
+    std::vector<float> newNormals(3 * numOutput);
+    std::vector<float> newTexcoords(hasTexcoords ? 2 * numOutput : 0);
+    std::vector<int16_t> newQTangents(tangents ? 4 * numOutput : 0);
+
+    hzglForChunks(pool, numOutput, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; v++)
+        {
+            unsigned c = vertexCorners[v];
+            unsigned i = indices[c];
+
+            for (int k = 0; k < 3; k++)
+            {
+                newPositions[3 * v + k] = positions[3 * static_cast<size_t>(i) + k];
+                newNormals[3 * v + k] = cornerNormals[c][k];
+            }
+
+            if (hasTexcoords)
+            {
+                newTexcoords[2 * v + 0] = mesh.texcoords[2 * static_cast<size_t>(i) + 0];
+                newTexcoords[2 * v + 1] = mesh.texcoords[2 * static_cast<size_t>(i) + 1];
+            }
+        }
+    });
+
+    std::vector<unsigned> newIndices(numCorners);
+
+    hzglForChunks(pool, numCorners, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++)
+            newIndices[c] = vertexOf[rep[c]];
+    });
+
+    std::vector<unsigned>().swap(rep);
+    std::vector<unsigned>().swap(vertexOf);
+
+    // per vertex tangent: dP/du of its faces, projected on the plane of the vertex normal and
+    // weighted by the angle of the projected edges (EvalTspace of MikkTSpace). The contribution
+    // of each corner replaces its normal (in face order, so the reads stay sequential), then
+    // they are summed up per vertex.
+    if (tangents)
+    {
+        hzglForChunks(pool, numFaces, [&](size_t begin, size_t end) {
+            for (size_t f = begin; f < end; f++)
+            {
+                const unsigned* idx = &indices[3 * f];
+                glm::vec3 p[3] = {hzglVec3(positions, idx[0]), hzglVec3(positions, idx[1]), hzglVec3(positions, idx[2])};
+
+                for (int k = 0; k < 3; k++)
+                {
+                    glm::vec3& n = cornerNormals[3 * f + k];
+                    glm::vec3 os = faceTangents[f] - glm::dot(faceTangents[f], n) * n;
+
+                    if (glm::length(os) <= 0.0f)
+                    {
+                        n = glm::vec3(0.0f);
+                        continue;
+                    }
+
+                    glm::vec3 e1 = p[(k + 1) % 3] - p[k];
+                    glm::vec3 e2 = p[(k + 2) % 3] - p[k];
+
+                    e1 -= glm::dot(e1, n) * n;
+                    e2 -= glm::dot(e2, n) * n;
+
+                    n = hzglAngle(e1, e2) * glm::normalize(os);
+                }
+            }
+        });
+
+        std::vector<glm::vec3> tangentSums(numOutput, glm::vec3(0.0f));
+
+        for (size_t c = 0; c < numCorners; c++)
+            tangentSums[newIndices[c]] += cornerNormals[c];
+
+        hzglForChunks(pool, numOutput, [&](size_t begin, size_t end) {
+            for (size_t v = begin; v < end; v++)
+            {
+                glm::vec3 n(newNormals[3 * v], newNormals[3 * v + 1], newNormals[3 * v + 2]);
+                float sign = (faceSigns[vertexCorners[v] / 3] < 0) ? -1.0f : 1.0f;
+
+                EncodeQTangent(n, tangentSums[v], sign, &newQTangents[4 * v]);
+            }
+        });
+    }
+
+    mesh.indices.swap(newIndices);
+    mesh.positions.swap(newPositions);
+    mesh.normals.swap(newNormals);
+    mesh.texcoords.swap(newTexcoords);
+    mesh.qtangents.swap(newQTangents);
+    mesh.num_vertices = static_cast<int>(numOutput);
+
+    st.tangents_ms = 1000.0 * timer.End();
+    st.output_vertices = static_cast<int>(numOutput);
+    st.total_ms = 1000.0 * totalTimer.End();
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Mesh.hpp"
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+namespace hzgl
+{
+    class ThreadPool;
+
+    typedef struct
+    {
+        float crease_angle = 60.0f;     // degrees; faces meeting at a sharper angle keep their own normals
+        bool keep_normals = true;       // use the normals of the file when it has them
+        bool tangents = true;           // QTangents for the meshes with texcoords
+    } TangentFrameOptions;
+
+    typedef struct
+    {
+        int input_vertices = 0;
+        int output_vertices = 0;        // after welding, and splitting at creases, UV seams and mirrors
+        double weld_ms = 0.0;
+        double normals_ms = 0.0;
+        double tangents_ms = 0.0;
+        double total_ms = 0.0;
+    } TangentFrameStats;
+
+    // a tangent frame in 4 x snorm16: the rotation (tangent, cross(normal, tangent), normal) as a
+    // unit quaternion, w kept away from 0 so its sign can carry the handedness of the bitangent
+    void EncodeQTangent(const glm::vec3& normal, const glm::vec3& tangent, float sign, int16_t q[4]);
+    void DecodeQTangent(const int16_t q[4], glm::vec3* normal, glm::vec3* tangent, float* sign);
+
+    // angle-weighted smooth normals (unless the file has some) and MikkTSpace tangents of a
+    // triangle mesh. Vertices at the same position are welded, then split again where faces meet
+    // at more than the crease angle, at UV seams and where the UV mapping is mirrored; the mesh is
+    // rewritten in place. pool may be null (runs on the calling thread).
+    void GenerateTangentFrames(MeshInfo& mesh, const TangentFrameOptions& options = TangentFrameOptions(),
+                               ThreadPool* pool = nullptr, TangentFrameStats* stats = nullptr);
+} // namespace hzgl
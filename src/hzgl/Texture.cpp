@@ -1,5 +1,8 @@
 #include "Texture.hpp"
 
+#include "Memory.hpp"
+#include "Profiler.hpp"
+
 #include <string>
 #include <iostream>
 #include <algorithm>
@@ -46,11 +49,66 @@ static GLenum hzglImageFormat(const std::string &filepath, int numChannels)
     }
 }
 
+unsigned char* hzgl::DecodeImage(const std::string &filepath, int* width, int* height, int* numChannels, bool flipVertically)
+{
+    HZGL_PROFILE_SCOPE("DecodeImage");
+
+    // the per-thread flag: prefetch workers decode glTF images (unflipped) and other textures at once
+    stbi_set_flip_vertically_on_load_thread(flipVertically);
+    return stbi_load(filepath.c_str(), width, height, numChannels, 0);
+}
+
+void hzgl::FreeImage(unsigned char* data)
+{
+    stbi_image_free(data);
+}
+
+float* hzgl::DecodeImageHDR(const std::string &filepath, int* width, int* height, int* numChannels, int desiredChannels, bool flipVertically)
+{
+    HZGL_PROFILE_SCOPE("DecodeImageHDR");
+
+    stbi_set_flip_vertically_on_load_thread(flipVertically);
+    return stbi_loadf(filepath.c_str(), width, height, numChannels, desiredChannels);
+}
+
+void hzgl::FreeImageHDR(float* data)
+{
+    stbi_image_free(data);
+}
+
+bool hzgl::DecodeImage(const std::string &filepath, ImageData* image, bool flipVertically)
+{
+    unsigned char* data = DecodeImage(filepath, &image->width, &image->height, &image->num_channels, flipVertically);
+
+    if (data == nullptr)
+        return false;
+
+    image->pixels.reset(data, FreeImage);
+
+    return true;
+}
+
+bool hzgl::DecodeImage(const unsigned char* data, size_t size, ImageData* image, bool flipVertically)
+{
+    HZGL_PROFILE_SCOPE("DecodeImage");
+
+    stbi_set_flip_vertically_on_load_thread(flipVertically);
+    unsigned char* pixels = stbi_load_from_memory(data, static_cast<int>(size), &image->width, &image->height, &image->num_channels, 0);
+
+    if (pixels == nullptr)
+        return false;
+
+    image->pixels.reset(pixels, FreeImage);
+
+    return true;
+}
+
 GLuint hzgl::TextureFromFile(const std::string &filepath, GLenum type, TextureInfo* texInfo)
 {
+    HZGL_PROFILE_SCOPE("TextureFromFile");
+
     int width, height, n;
-    stbi_set_flip_vertically_on_load(true);
-    unsigned char *data = stbi_load(filepath.c_str(), &width, &height, &n, 0);
+    unsigned char *data = DecodeImage(filepath, &width, &height, &n);
 
     if (!data)
     {
@@ -58,6 +116,17 @@ GLuint hzgl::TextureFromFile(const std::string &filepath, GLenum type, TextureIn
         return 0;
     }
 
+    GLuint texID = TextureFromPixels(data, width, height, n, filepath, type, texInfo);
+
+    FreeImage(data);
+
+    return texID;
+}
+
+GLuint hzgl::TextureFromPixels(const unsigned char* data, int width, int height, int n, const std::string &filepath, GLenum type, TextureInfo* texInfo)
+{
+    HZGL_PROFILE_SCOPE("TextureFromPixels");
+
     GLuint format, internalFormat;
 
     if (n == 1)
@@ -90,9 +159,9 @@ GLuint hzgl::TextureFromFile(const std::string &filepath, GLenum type, TextureIn
         texInfo->width = width;
         texInfo->height = height;
         texInfo->num_channels = n;
+        texInfo->num_levels = MipLevelCount(width, height);
+        texInfo->internal_format = format;
     }
 
-    stbi_image_free(data);
-
     return texID;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <memory>
 
 #include <glad/glad.h>
 
@@ -11,8 +12,35 @@ namespace hzgl
         int width;
         int height;
         int num_channels;
+        int num_levels;          // mip levels allocated by the driver
+        GLenum internal_format;
         std::string filepath;
     } TextureInfo;
 
+    // pixels decoded off the GL thread
+    typedef struct {
+        int width = 0;
+        int height = 0;
+        int num_channels = 0;
+        std::shared_ptr<unsigned char> pixels;  // freed with FreeImage
+    } ImageData;
+
+    // decode an image without touching OpenGL (release the pixels with FreeImage)
+    unsigned char* DecodeImage(const std::string& filepath, int* width, int* height, int* numChannels, bool flipVertically = true);
+    void FreeImage(unsigned char* data);
+
+    // linear float pixels of a Radiance .hdr (8-bit images are converted), freed with FreeImageHDR
+    float* DecodeImageHDR(const std::string& filepath, int* width, int* height, int* numChannels, int desiredChannels = 0,
+                          bool flipVertically = false);
+    void FreeImageHDR(float* data);
+    bool DecodeImage(const std::string& filepath, ImageData* image, bool flipVertically = true);
+
+    // an encoded image already in memory (e.g. embedded in a model file)
+    bool DecodeImage(const unsigned char* data, size_t size, ImageData* image, bool flipVertically = true);
+
     GLuint TextureFromFile(const std::string& filepath, GLenum type = GL_TEXTURE_2D, TextureInfo* texInfo = nullptr);
+
+    // upload pixels decoded elsewhere (e.g. on a worker thread); filepath is only used as metadata
+    GLuint TextureFromPixels(const unsigned char* data, int width, int height, int numChannels, const std::string& filepath,
+                             GLenum type = GL_TEXTURE_2D, TextureInfo* texInfo = nullptr);
 } // namespace hzgl
@@ -0,0 +1,122 @@
+#include "ThreadPool.hpp"
+
+#include "Profiler.hpp"
+
+#include <utility>
+#include <algorithm>
+
+hzgl::ThreadPool::ThreadPool(int numThreads, size_t capacity, const char* name)
+{
+    _capacity = capacity;
+    _numBusy = 0;
+    _stopping = false;
+    _name = name;
+
+    numThreads = std::max(1, numThreads);
+
+    for (int i = 0; i < numThreads; i++)
+        _workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+hzgl::ThreadPool::~ThreadPool()
+{
+    // finish whatever is queued, then let the workers exit
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+
+    _taskAvailable.notify_all();
+
+    for (auto& worker : _workers)
+        worker.join();
+}
+
+void hzgl::ThreadPool::workerLoop()
+{
+    ProfilerSetThreadName(_name);
+
+    while (true)
+    {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _taskAvailable.wait(lock, [this]() { return _stopping || !_tasks.empty(); });
+
+            if (_tasks.empty())
+                return;
+
+            task = std::move(_tasks.front());
+            _tasks.pop_front();
+            _numBusy++;
+        }
+
+        _spaceAvailable.notify_one();
+
+        task();
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _numBusy--;
+
+            if (_numBusy == 0 && _tasks.empty())
+                _idle.notify_all();
+        }
+    }
+}
+
+void hzgl::ThreadPool::Submit(std::function<void()> task)
+{
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _spaceAvailable.wait(lock, [this]() { return _capacity == 0 || _tasks.size() < _capacity; });
+        _tasks.push_back(std::move(task));
+    }
+
+    _taskAvailable.notify_one();
+}
+
+bool hzgl::ThreadPool::TrySubmit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if (_capacity > 0 && _tasks.size() >= _capacity)
+            return false;
+
+        _tasks.push_back(std::move(task));
+    }
+
+    _taskAvailable.notify_one();
+
+    return true;
+}
+
+void hzgl::ThreadPool::Wait()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _idle.wait(lock, [this]() { return _numBusy == 0 && _tasks.empty(); });
+}
+
+size_t hzgl::ThreadPool::QueueDepth() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _tasks.size();
+}
+
+int hzgl::ThreadPool::NumBusy() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _numBusy;
+}
+
+int hzgl::ThreadPool::NumThreads() const
+{
+    return static_cast<int>(_workers.size());
+}
+
+size_t hzgl::ThreadPool::Capacity() const
+{
+    return _capacity;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+namespace hzgl
+{
+    // fixed set of worker threads fed by a FIFO queue that can be bounded
+    class ThreadPool
+    {
+    private:
+        std::vector<std::thread> _workers;
+        std::deque<std::function<void()>> _tasks;
+
+        mutable std::mutex _mutex;
+        std::condition_variable _taskAvailable;
+        std::condition_variable _spaceAvailable;
+        std::condition_variable _idle;
+
+        size_t _capacity;   // 0: unbounded
+        int _numBusy;
+        bool _stopping;
+        const char* _name;  // thread name in the profiler (string literal)
+
+        void workerLoop();
+
+    public:
+        explicit ThreadPool(int numThreads, size_t capacity = 0, const char* name = "Worker");
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // blocks while the queue is full
+        void Submit(std::function<void()> task);
+
+        // returns false instead of blocking when the queue is full
+        bool TrySubmit(std::function<void()> task);
+
+        // wait until the queue is empty and every worker is idle
+        void Wait();
+
+        size_t QueueDepth() const;
+        int NumBusy() const;
+        int NumThreads() const;
+        size_t Capacity() const;
+    };
+} // namespace hzgl
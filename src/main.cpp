@@ -2,7 +2,18 @@
 #include <GLFW/glfw3.h>
 
 #include <cmath>
+#include <cerrno>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <cstring>
+#include <atomic>
+#include <memory>
+#include <thread>
 #include <iostream>
+#include <algorithm>
+#include <type_traits>
+#include <unordered_map>
 
 #if defined(DEBUG) || defined(_DEBUG)
 #define GLM_FORCE_MESSAGES
@@ -14,15 +25,37 @@
 #include "hzgl/Timer.hpp"
 #include "hzgl/Light.hpp"
 #include "hzgl/Material.hpp"
+#include "hzgl/Batch.hpp"
 #include "hzgl/Camera.hpp"
+#include "hzgl/Capture.hpp"
+#include "hzgl/Context.hpp"
 #include "hzgl/Control.hpp"
+#include "hzgl/Memory.hpp"
+#include "hzgl/Occlusion.hpp"
+#include "hzgl/Profiler.hpp"
+#include "hzgl/Readback.hpp"
+#include "hzgl/Scene.hpp"
+#include "hzgl/LightClusters.hpp"
+#include "hzgl/Deferred.hpp"
+#include "hzgl/DepthPrepass.hpp"
+#include "hzgl/Shadows.hpp"
+#include "hzgl/Environment.hpp"
+#include "hzgl/ShaderVariants.hpp"
+#include "hzgl/Screenshot.hpp"
+#include "hzgl/Streaming.hpp"
+#include "hzgl/PointCloud.hpp"
+#include "hzgl/Benchmark.hpp"
+#include "hzgl/Filesystem.hpp"
+#include "hzgl/Framebuffer.hpp"
+#include "hzgl/FrameArena.hpp"
+#include "hzgl/FrameScheduler.hpp"
 #include "hzgl/ResourceManager.hpp"
 
 static int SCR_WIDTH = 1280;
 static int SCR_HEIGHT = 720;
 static float deltaTime = 0.0f;
 
-GLFWwindow* window;
+GLFWwindow* window = nullptr;
 
 hzgl::SimpleTimer timer;
 hzgl::ImGuiControl guiControl;
@@ -31,149 +64,1796 @@ std::vector<hzgl::Light> lights;
 std::vector<hzgl::Material> materials;
 std::vector<hzgl::ProgramInfo> programs;
 std::vector<hzgl::RenderObject> objects;
+int phongProgram = -1;          // programs that take lights and a material, looked up once in init()
+int pbrProgram = -1;
+int geometryVariants = -1;      // source of the G-buffer program in shaderVariants, -1 without deferred
 hzgl::Camera camera(glm::vec3(0, 0, 3), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0), 45.0f,
     static_cast<float>(0.75f * SCR_WIDTH) / static_cast<float>(SCR_HEIGHT));
 
+hzgl::DrawStats drawStats;
+hzgl::TiledScreenshotOptions hiresOptions;
+bool hiresRequested = false;
+bool occlusionCulling = false;
+std::unique_ptr<hzgl::OcclusionCuller> occlusionCuller;
+std::unique_ptr<hzgl::LightClusters> lightClusters;
+size_t numDefaultLights = 0;                   // lights added after these can be removed in the GUI
+int extraLights = 0;                           // --lights: random point lights around the scene
+std::unique_ptr<hzgl::DeferredRenderer> deferredRenderer;
+bool deferredShading = false;                  // --deferred: lit programs shade from a G-buffer
+std::unique_ptr<hzgl::DepthPrepass> depthPrepass;
+hzgl::PrepassMode prepassMode = hzgl::HZGL_PREPASS_OFF;   // --prepass off|on|auto
+std::unique_ptr<hzgl::ShadowAtlas> shadowAtlas;
+bool shadowsEnabled = true;                    // --no-shadows: lit programs without shadow maps
+std::unique_ptr<hzgl::EnvironmentLighting> environment;
+std::unique_ptr<hzgl::ShaderVariantCache> shaderVariants;   // specializations of the programs, by index
+std::string environmentPath = "";              // --env: .hdr lighting the PBR programs
+std::unique_ptr<hzgl::SceneGraph> sceneGraph;
+std::vector<hzgl::SceneInstance> instances;   // [0] is the selected model
+int sceneGrid = 0;                             // --grid: extra instances of the first model
+hzgl::FrameScheduler scheduler;
+hzgl::UtilizationMeter utilization;
+bool renderOnDemand = true;     // idle in glfwWaitEventsTimeout when nothing changed
+bool turntable = false;         // --turntable: auto-rotate the model (keeps every frame dirty)
+std::vector<std::pair<std::string, double>> loadTimes;
+bool parallelShaderCompile = true;             // --no-parallel-compile: wait for every program in turn
+hzgl::SimpleTimer startupTimer;                // started in main(), read after the first frame
+double timeToFirstFrame = -1.0;                // ms, negative until the first frame is done
+std::unique_ptr<hzgl::MeshStreamer> streamer;  // --stream: a chunked mesh instead of the models
+std::string streamPath = "";
+hzgl::StreamingOptions streamingOptions;
+std::unique_ptr<hzgl::PointCloud> pointCloud;  // --points: an octree of points drawn over the scene
+std::string pointsPath = "";
+hzgl::PointCloudOptions pointCloudOptions;
+
+typedef struct
+{
+    bool benchmark = false;
+    std::string script = "";      // empty: every model with every program
+    std::string output = "benchmark.json";
+    std::string golden = "";      // directory holding step-<i>.png
+    std::string memoryReport = "";  // JSON dump of CPU/GPU memory after loading
+    bool updateGolden = false;
+    double tolerance = 2.0;       // maximum RMSE (8-bit units)
+    int width = 1280;
+    int height = 720;
+    int frames = 120;             // frames per step of the default sequence
+
+    // --capture: offscreen turntable rendered at a fixed time step
+    std::string capture = "";     // frame prefix, .y4m path, "-" or "|command"
+    hzgl::CaptureFormat captureFormat = hzgl::HZGL_CAPTURE_PNG;
+    int captureFrames = 360;      // one full turn
+    int fps = 30;
+    int model = 0;
+    std::string program = "";
+
+    // --batch: thumbnails / multi-view renders of a directory or manifest of models
+    std::string batch = "";
+    std::string batchOutput = "thumbnails";
+    int views = 1;
+    float elevation = 20.0f;
+    int jobs = 0;                 // worker threads, 0: one per core
+
+    // --hires: one tiled screenshot of a model (the H key does the same in the viewer)
+    std::string hires = "";
+    int hiresWidth = 7680;
+    int hiresHeight = 4320;
+    int supersampling = 1;
+
+    bool occlusion = false;       // software occlusion culling in every mode
+    int grid = 0;                 // N x N extra instances of the first model in every mode
+    int lights = 0;               // random point lights on top of the default ones in every mode
+    bool deferred = false;        // deferred shading for the lit programs in every mode
+    hzgl::PrepassMode prepass = hzgl::HZGL_PREPASS_OFF;   // depth pre-pass in every mode
+    bool shadows = true;          // shadow maps for the lit programs in every mode
+    std::string environment = ""; // equirectangular .hdr for image-based lighting in every mode
+    bool parallelCompile = true;  // let the driver build the programs in the background
+
+    // interactive viewer
+    bool continuous = false;      // redraw every frame even when nothing changed
+    bool turntable = false;       // off so that the viewer can idle (and shadow maps stay cached)
+
+    int allocCheck = 0;           // --alloc-check: offscreen frames that must not allocate
+
+    // --preprocess: split a mesh into the chunks and levels --stream draws, then exit
+    std::string preprocess = "";
+    std::string preprocessOutput = "";  // default: the input path + .hzchunks
+    hzgl::ChunkBuildOptions chunkBuild;
+
+    // --stream: a .hzchunks file in the viewer, in place of the default models
+    std::string stream = "";
+    hzgl::StreamingOptions streaming;
+
+    // --preprocess-points: build the octree --points draws from a PLY or XYZ file, then exit
+    std::string preprocessPoints = "";
+    hzgl::PointBuildOptions pointBuild;
+
+    // --points: a .hzpoints file in the viewer and the benchmark
+    std::string points = "";
+    hzgl::PointCloudOptions pointCloud;
+} CommandLineOptions;
+
+// what the previous frame showed, to find out which GUI edits need new frames
+typedef struct
+{
+    glm::mat4 view = glm::mat4(0.0f);
+    glm::mat4 projection = glm::mat4(0.0f);
+    int oIndex = -1;
+    int pIndex = -1;
+    int mIndex = -1;
+    bool deferred = false;
+    bool shadows = false;
+    bool environment = false;
+    float environmentIntensity = 0.0f;
+    std::vector<hzgl::Light> lights;
+    std::vector<hzgl::Material> materials;
+} SceneState;
+
 static void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 
-static void init(void)
+// false if the file is loaded already
+static bool loadModel(const std::string& filepath)
+{
+    hzgl::SimpleTimer loadTimer;
+    loadTimer.Start();
+
+    bool loaded = resources.LoadModel(filepath, objects).IsValid();
+
+    loadTimes.push_back({filepath, 1000.0 * loadTimer.End()});
+
+    return loaded;
+}
+
+// queue the variants a model will ask for, they are compiled in spare time
+static void warmVariants(const hzgl::RenderObject& object)
+{
+    unsigned sceneFeatures = (shadowsEnabled ? hzgl::HZGL_FEATURE_SHADOWS : 0u) | (environment->IsLoaded() ? hzgl::HZGL_FEATURE_IBL : 0u);
+
+    for (int p : {phongProgram, pbrProgram, (deferredShading ? geometryVariants : -1)})
+    {
+        for (const auto &shape : object.shapes)
+            shaderVariants->Warm(p, sceneFeatures | hzgl::ShapeFeatures(shape));
+    }
+}
+
+static void init(bool loadDefaultModels = true)
+{
+    HZGL_PROFILE_SCOPE("init");
+
+    // asked for before any program is submitted
+    hzgl::InitParallelShaderCompile(parallelShaderCompile);
+
+    // submit the shader programs first, the driver builds them while the models are loading
+    resources.LoadShaderProgram({
+        {GL_VERTEX_SHADER, "../assets/shaders/passthrough.vert"},
+        {GL_FRAGMENT_SHADER, "../assets/shaders/passthrough.frag"},
+        }, "Rendering Normal");
+
+    resources.LoadShaderProgram({
+        {GL_VERTEX_SHADER, "../assets/shaders/phong.vert"},
+        {GL_FRAGMENT_SHADER, "../assets/shaders/phong.frag"},
+        }, "Blinn-Phong Shading");
+
+    resources.LoadShaderProgram({
+        {GL_VERTEX_SHADER, "../assets/shaders/pbr_basic.vert"},
+        {GL_FRAGMENT_SHADER, "../assets/shaders/pbr_basic.frag"},
+        }, "Basic PBR (Analytic lights)");
+
+    // G-buffer and lighting programs for the deferred path, waited for with the others below
+    deferredRenderer.reset(new hzgl::DeferredRenderer());
+    bool deferredSubmitted = deferredRenderer->Init("../assets/shaders");
+
+    // depth-only program for the pre-pass, which is simply never enabled if it fails to build;
+    // it is finished by the first frame that asks for it
+    depthPrepass.reset(new hzgl::DepthPrepass(prepassMode));
+    depthPrepass->Init("../assets/shaders");
+
+    // same for the shadow atlas: lit programs simply find no shadow views in it
+    shadowAtlas.reset(new hzgl::ShadowAtlas());
+    shadowAtlas->Init("../assets/shaders");
+
+    // load meshes from OBJ files (the batch renderer brings its own), picking up the programs
+    // that are done in between
+    if (loadDefaultModels)
+    {
+        for (const char* filepath : {"../assets/models/bunny.obj", "../assets/models/buddha.obj",
+                                     "../assets/models/dragon.obj", "../assets/models/mori_knob/testObj.obj"})
+        {
+            loadModel(filepath);
+            resources.FinishShaderPrograms(false);
+        }
+    }
+
+    // low-resolution CPU depth buffer, rasterized by a few worker threads
+    int cullThreads = std::min(4, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+    occlusionCuller.reset(new hzgl::OcclusionCuller(256, 128, std::max(cullThreads, 0)));
+
+    // wide levels of the transform hierarchy are split across the same number of threads
+    sceneGraph.reset(new hzgl::SceneGraph(std::max(cullThreads, 0)));
+
+    // and so are the depth slices of the light clusters
+    lightClusters.reset(new hzgl::LightClusters(16, 9, 24, std::max(cullThreads, 0)));
+
+    // the first frame needs them all; the copies in programs are taken after this
+    resources.FinishShaderPrograms(true);
+
+    // forward only if the deferred programs failed to build
+    if (!deferredSubmitted || !deferredRenderer->Finish())
+    {
+        deferredRenderer->Release();
+        deferredRenderer.reset();
+        deferredShading = false;
+    }
+
+    std::cout << "Parallel shader compile: " << (hzgl::ParallelShaderCompileEnabled() ? "on" : "off")
+              << (parallelShaderCompile ? "" : " (disabled)") << std::endl;
+
+    for (const auto &pName : resources.GetLoadedShaderProgramNames())
+        programs.push_back(resources.GetProgramInfo(pName));
+
+    for (int p = 0; p < (int)programs.size(); p++)
+    {
+        if (programs[p].name == "Blinn-Phong Shading")
+            phongProgram = p;
+        else if (programs[p].name == "Basic PBR (Analytic lights)")
+            pbrProgram = p;
+    }
+
+    // the programs above are the variants without features, the others are built when needed
+    shaderVariants.reset(new hzgl::ShaderVariantCache());
+    for (const auto &program : programs)
+        shaderVariants->Register(program.name, program.stages, program.id);
+
+    // and so is the G-buffer program, for the maps and tangents of the shapes drawn deferred
+    if (deferredRenderer != nullptr)
+        geometryVariants = shaderVariants->Register("Deferred G-buffer", deferredRenderer->GeometryStages(), deferredRenderer->GeometryProgram());
+
+    // precomputed once per .hdr, later runs read the maps from cache/ibl in the working directory
+    environment.reset(new hzgl::EnvironmentLighting());
+    if (!environmentPath.empty())
+        environment->Load(environmentPath, "cache/ibl");
+
+    // queue the variants the loaded models will ask for, they are compiled in spare time
+    for (const auto &object : objects)
+        warmVariants(object);
+
+    // no GUI in headless mode
+    if (window != nullptr)
+    {
+        guiControl.Init(window, "#version 410");
+
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        framebuffer_size_callback(window, width, height);
+    }
+
+    lights.push_back(
+        hzgl::Light(hzgl::HZGL_POINT_LIGHT, glm::vec3(0.0f, 0.0f, 3.0f)));
+
+    lights.push_back(
+        hzgl::Light(hzgl::HZGL_POINT_LIGHT, glm::vec3(2.0f, 2.0f, 2.0f)));
+
+    lights.push_back(
+        hzgl::Light(hzgl::HZGL_DIRECTIONAL_LIGHT, glm::vec3(0.0f, -1.0f, -2.0f), glm::vec3(0.5f)));
+
+    numDefaultLights = lights.size();
+
+    if (extraLights > 0)
+    {
+        // spread over the selected model and the rows of --grid behind it
+        float halfWidth = std::max(2.0f, 0.75f * sceneGrid);
+        hzgl::AddRandomPointLights(lights, extraLights, glm::vec3(-halfWidth, -1.0f, -1.5f * sceneGrid - 2.0f),
+                                   glm::vec3(halfWidth, 2.0f, 2.0f));
+    }
+
+    materials.push_back(hzgl::CreatesSampleMaterial(hzgl::HZGL_PHONG_MATERIAL, "turquoise"));
+    materials.push_back(hzgl::CreatesSampleMaterial(hzgl::HZGL_PHONG_MATERIAL, "pearl"));
+    materials.push_back(hzgl::CreatesSampleMaterial(hzgl::HZGL_PHONG_MATERIAL, "bronze"));
+    materials.push_back(hzgl::Material(hzgl::MaterialType::HZGL_PBR_MATERIAL));
+
+    glClearColor(0.98f, 0.98f, 0.98f, 1.0f);
+
+    // enable optional functionalities
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_BACK);
+
+    if (sceneGrid > 0 && !objects.empty())
+    {
+        instances.resize(1);
+        hzgl::AddInstanceGrid(instances, 0, 0, sceneGrid, 1.5f);
+    }
+
+    // only the chunk table is read here, the levels come in as the view asks for them
+    if (!streamPath.empty())
+    {
+        streamer.reset(new hzgl::MeshStreamer());
+        if (!streamer->Open(streamPath, streamingOptions))
+            streamer.reset();
+    }
+
+    if (!pointsPath.empty())
+    {
+        pointCloud.reset(new hzgl::PointCloud());
+        if (!pointCloud->Init("../assets/shaders") || !pointCloud->Open(pointsPath, pointCloudOptions))
+        {
+            pointCloud->Release();
+            pointCloud.reset();
+        }
+    }
+}
+
+// (re)build the nodes of an instance when it shows a different model; the new root still
+// needs its transform
+static void placeInstance(hzgl::SceneInstance& instance, int object)
+{
+    if (instance.object == object && sceneGraph->IsValid(instance.root))
+        return;
+
+    sceneGraph->RemoveSubtree(instance.root);
+
+    instance.object = object;
+    instance.root = sceneGraph->AddNode(hzgl::InvalidNode);
+    instance.dirty = true;
+    sceneGraph->AddNodes(instance.root, objects[object].nodes, instance.nodes);
+}
+
+// forget every instance (the batch renderer replaces the models under them)
+static void resetScene()
+{
+    sceneGraph->Clear();
+    instances.clear();
+}
+
+// drop a model picked in the "Assets" section: the instances of it go too (the first one is
+// placed again with the next selection), those of the models after it follow the indices down
+static void unloadModel(int object)
+{
+    if (object < 0 || object >= (int)objects.size())
+        return;
+
+    resources.Unload(objects[object]);
+    objects.erase(objects.begin() + object);
+    depthPrepass->RemoveObject(object);
+
+    for (size_t i = instances.size(); i-- > 0;)
+    {
+        if (instances[i].object > object)
+        {
+            instances[i].object -= 1;
+            continue;
+        }
+
+        if (instances[i].object < object)
+            continue;
+
+        sceneGraph->RemoveSubtree(instances[i].root);
+
+        if (i == 0)
+        {
+            instances[0].object = -1;
+            instances[0].root = hzgl::InvalidNode;
+        }
+        else
+            instances.erase(instances.begin() + i);
+    }
+}
+
+static glm::mat4 instanceMatrix(const hzgl::SceneInstance& instance)
+{
+    return glm::translate(instance.position)
+         * glm::rotate(glm::radians(instance.rotation.y), glm::vec3(0, 1, 0))
+         * glm::rotate(glm::radians(instance.rotation.x), glm::vec3(1, 0, 0))
+         * glm::rotate(glm::radians(instance.rotation.z), glm::vec3(0, 0, 1))
+         * glm::scale(glm::vec3(instance.scale));
+}
+
+// only moved instances are queued, so a still scene costs nothing to update
+static void setInstanceTransform(const hzgl::SceneInstance& instance, const glm::mat4& local)
+{
+    if (sceneGraph->Local(instance.root) != local)
+        sceneGraph->SetLocal(instance.root, local);
+}
+
+// issue the draw calls of the scene into the current framebuffer and viewport: the selected
+// object (instance 0, placed by Model) and every instance added in the "Scene" panel
+static void drawScene(int oIndex, int pIndex, int mIndex, glm::mat4 Model, glm::mat4 Projection)
+{
+    HZGL_PROFILE_GPU_SCOPE("Scene");
+
+    glm::mat4 View = camera.GetViewMatrix();
+
+    if (instances.empty())
+        instances.resize(1);
+
+    instances[0].material = mIndex;
+
+    // no models at all when streaming
+    if (oIndex >= 0 && oIndex < (int)objects.size())
+    {
+        placeInstance(instances[0], oIndex);
+        setInstanceTransform(instances[0], Model);
+    }
+
+    for (size_t i = 1; i < instances.size(); i++)
+    {
+        // models may have been unloaded under an instance
+        if (instances[i].object < 0 || instances[i].object >= (int)objects.size())
+            continue;
+
+        placeInstance(instances[i], instances[i].object);
+
+        // the matrix is only rebuilt for instances edited in the "Scene" panel
+        if (instances[i].dirty)
+        {
+            setInstanceTransform(instances[i], instanceMatrix(instances[i]));
+            instances[i].dirty = false;
+        }
+    }
+
+    sceneGraph->Update();
+
+    // every shape of every instance, with the world matrix of its node
+    typedef struct
+    {
+        const hzgl::RenderShape* shape;
+        const glm::mat4* world;
+        int material;
+        int object;
+    } DrawItem;
+
+    static std::vector<DrawItem> items;
+    items.clear();
+
+    bool lit = (pIndex == phongProgram || pIndex == pbrProgram);
+
+    for (const auto &instance : instances)
+    {
+        if (instance.object < 0 || instance.object >= (int)objects.size())
+            continue;
+
+        // every instance is shaded with the model of its own material
+        int material = instance.material;
+        if (material < 0 || material >= (int)materials.size())
+            material = mIndex;
+
+        for (const auto &shape : objects[instance.object].shapes)
+        {
+            hzgl::NodeId node = (shape.node >= 0 && shape.node < (int)instance.nodes.size()) ? instance.nodes[shape.node] : instance.root;
+            items.push_back({&shape, &sceneGraph->World(node), material, instance.object});
+        }
+    }
+
+    // shapes covering a good part of the screen occlude, every shape is tested against them
+    static std::vector<char> visible;
+    visible.assign(items.size(), 1);
+
+    if (occlusionCulling && occlusionCuller != nullptr)
+    {
+        HZGL_PROFILE_SCOPE("OcclusionCulling");
+
+        occlusionCuller->BeginFrame(Projection * View);
+
+        for (const auto &item : items)
+        {
+            if (item.shape->occluder != nullptr && occlusionCuller->ScreenCoverage(item.shape->bounds, *item.world) > 0.02f)
+                occlusionCuller->AddOccluder(*item.shape->occluder, *item.world);
+        }
+
+        occlusionCuller->RasterizeOccluders();
+
+        for (size_t i = 0; i < items.size(); i++)
+            visible[i] = occlusionCuller->IsVisible(items[i].shape->bounds, *items[i].world);
+    }
+
+    // shadow maps of the lights, from every shape (also the ones hidden from the camera); views
+    // that are still up to date are kept from earlier frames
+    bool shadowed = lit && shadowsEnabled;
+
+    if (shadowed)
+    {
+        static std::vector<hzgl::ShadowCaster> casters;
+        casters.clear();
+
+        for (const auto &item : items)
+            casters.push_back({item.shape, item.world});
+
+        shadowAtlas->Update(lights, casters, View, Projection);
+
+        drawStats.shadow_views_rendered = shadowAtlas->Stats().rendered;
+        drawStats.shadow_hit_rate = shadowAtlas->Stats().hit_rate;
+        drawStats.shadow_ms = shadowAtlas->Stats().cpu_ms;
+    }
+
+    // lit programs can go through the G-buffer instead, the lights are applied in Resolve()
+    bool deferred = lit && deferredShading && deferredRenderer != nullptr;
+
+    GLuint program = programs[pIndex].id;
+
+    if (deferred)
+        program = deferredRenderer->BeginGeometry();
+
+    // depth of every visible shape first (of the models where it pays off), from positions only
+    depthPrepass->BeginFrame(static_cast<int>(objects.size()));
+
+    {
+        HZGL_PROFILE_GPU_SCOPE("DepthPrepass");
+
+        bool started = false;
+
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            if (!visible[i] || !depthPrepass->Enabled(items[i].object))
+                continue;
+
+            if (!started)
+            {
+                depthPrepass->BeginDepthPass(View, Projection);
+                started = true;
+            }
+
+            depthPrepass->DrawDepth(items[i].object, *items[i].shape, *items[i].world);
+        }
+
+        if (started)
+            depthPrepass->EndDepthPass();
+
+        drawStats.prepass_draw_calls = depthPrepass->Stats().draw_calls;
+    }
+
+    // the smallest variant of the program for the features of every shape, of the lit program
+    // that matches its material (the G-buffer program for all of them when deferred); the shapes
+    // are drawn program by program
+    unsigned sceneFeatures = 0;
+
+    if (shadowed)
+        sceneFeatures |= hzgl::HZGL_FEATURE_SHADOWS;
+    if (environment->Enabled() && environment->IsLoaded())
+        sceneFeatures |= hzgl::HZGL_FEATURE_IBL;
+
+    static std::vector<unsigned> itemFeatures;
+    static std::vector<int> itemPasses;       // index into passes, -1 for culled shapes
+    static std::vector<GLuint> passes;
+    itemFeatures.assign(items.size(), 0);
+    itemPasses.assign(items.size(), -1);
+    passes.clear();
+
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        if (!visible[i])
+        {
+            drawStats.culled += 1;
+            continue;
+        }
+
+        int itemProgram = pIndex;
+
+        if (deferred)
+            itemProgram = geometryVariants;
+        else if (lit)
+        {
+            int modelProgram = (materials[items[i].material].type == hzgl::HZGL_PBR_MATERIAL) ? pbrProgram : phongProgram;
+            itemProgram = (modelProgram >= 0) ? modelProgram : pIndex;
+        }
+
+        // the G-buffer program tests for no scene features, Minimal() drops them
+        unsigned features = sceneFeatures | hzgl::ShapeFeatures(*items[i].shape);
+        itemFeatures[i] = shaderVariants->Minimal(itemProgram, features);
+        GLuint shapeProgram = shaderVariants->Get(itemProgram, features);
+
+        // a handful of passes at most, a linear search is fine
+        auto pass = std::find(passes.begin(), passes.end(), shapeProgram);
+        itemPasses[i] = static_cast<int>(pass - passes.begin());
+
+        if (pass == passes.end())
+            passes.push_back(shapeProgram);
+    }
+
+    // the streamed mesh, scaled into the unit sphere like the models, takes the program of a
+    // shape without maps; its levels are picked (and loaded) for this view
+    GLuint streamProgram = 0;
+    glm::mat4 streamModel = Model;
+
+    if (streamer != nullptr)
+    {
+        glm::ivec4 viewport;
+        glGetIntegerv(GL_VIEWPORT, &viewport[0]);
+
+        streamModel = Model * glm::scale(glm::vec3(1.0f / streamer->Radius())) * glm::translate(-streamer->Center());
+        streamer->Update(streamModel, View, Projection, viewport[3]);
+
+        streamProgram = deferred ? program : shaderVariants->Get(pIndex, sceneFeatures);
+
+        if (std::find(passes.begin(), passes.end(), streamProgram) == passes.end())
+            passes.push_back(streamProgram);
+    }
+
+    drawStats.shader_variants = static_cast<int>(passes.size());
+
+    // the visible shapes bucketed by pass (counting sort, draw order kept within a pass): the
+    // shapes of pass p are passItems[passStart[p]] to passItems[passStart[p + 1] - 1]
+    static std::vector<int> passStart;
+    static std::vector<int> passItems;
+    passStart.assign(passes.size() + 1, 0);
+
+    for (int pass : itemPasses)
+    {
+        if (pass >= 0)
+            passStart[pass + 1] += 1;
+    }
+
+    for (size_t p = 1; p < passStart.size(); p++)
+        passStart[p] += passStart[p - 1];
+
+    passItems.resize(passStart.back());
+
+    {
+        static std::vector<int> next;
+        next.assign(passStart.begin(), passStart.end() - 1);
+
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            if (itemPasses[i] >= 0)
+                passItems[next[itemPasses[i]]++] = static_cast<int>(i);
+        }
+    }
+
+    if (lit)
+    {
+        // lights are binned for the view (and the tile of a hires screenshot) being drawn
+        lightClusters->Build(lights, View, Projection, shadowed ? &shadowAtlas->LightViews() : nullptr);
+
+        drawStats.lights = lightClusters->Stats().lights;
+        drawStats.light_bin_ms = lightClusters->Stats().bin_ms;
+    }
+
+    {
+        HZGL_PROFILE_GPU_SCOPE("Draw");
+
+        for (size_t p = 0; p < passes.size(); p++)
+        {
+            GLuint pass = passes[p];
+            glUseProgram(pass);
+
+            {
+                HZGL_PROFILE_SCOPE("Uniforms");
+
+                hzgl::SetMatrixv(pass, "View", 4, &View[0][0]);
+                hzgl::SetMatrixv(pass, "Projection", 4, &Projection[0][0]);
+
+                if (lit && !deferred)
+                {
+                    glm::ivec4 viewport;
+                    glGetIntegerv(GL_VIEWPORT, &viewport[0]);
+
+                    lightClusters->Bind(pass, viewport);
+                    shadowAtlas->Bind(pass);
+                    environment->Bind(pass);
+                    hzgl::SetFloatv(pass, "uEyePosition", 3, &camera.position[0]);
+                }
+
+                if (lit)
+                {
+                    // not found (-1) in variants without the maps, which is fine
+                    glUniform1i(glGetUniformLocation(pass, "uBaseColorMap"), hzgl::HZGL_BASE_COLOR_UNIT);
+                    glUniform1i(glGetUniformLocation(pass, "uNormalMap"), hzgl::HZGL_NORMAL_MAP_UNIT);
+                }
+            }
+
+            // looked up once per program, these two change with every shape
+            GLint modelLocation = glGetUniformLocation(pass, "Model");
+            GLint normalLocation = glGetUniformLocation(pass, "Normal");
+
+            const glm::mat4* lastWorld = nullptr;
+            int lastMaterial = -1;
+            GLuint lastMaps[2] = {0, 0};
+
+            for (int k = passStart[p]; k < passStart[p + 1]; k++)
+            {
+                int i = passItems[k];
+                const auto &item = items[i];
+
+                // shapes of one node share their matrices
+                if (item.world != lastWorld)
+                {
+                    glm::mat4 Normal = glm::transpose(glm::inverse(*item.world));
+
+                    glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &(*item.world)[0][0]);
+                    glUniformMatrix4fv(normalLocation, 1, GL_FALSE, &Normal[0][0]);
+                    lastWorld = item.world;
+                }
+
+                if (lit && item.material != lastMaterial)
+                {
+                    if (deferred)
+                        deferredRenderer->SetupMaterial(pass, materials[item.material]);
+                    else
+                        hzgl::SetupMaterial(pass, materials[item.material], "uMaterial");
+
+                    lastMaterial = item.material;
+                }
+
+                const unsigned mapFeatures[2] = {hzgl::HZGL_FEATURE_BASE_COLOR_MAP, hzgl::HZGL_FEATURE_NORMAL_MAP};
+                const int mapUnits[2] = {hzgl::HZGL_BASE_COLOR_UNIT, hzgl::HZGL_NORMAL_MAP_UNIT};
+
+                for (int m = 0; m < 2; m++)
+                {
+                    if ((itemFeatures[i] & mapFeatures[m]) == 0)
+                        continue;
+
+                    GLuint texture = hzgl::ShapeTexture(*item.shape, mapFeatures[m]);
+                    if (texture != lastMaps[m])
+                    {
+                        glActiveTexture(GL_TEXTURE0 + mapUnits[m]);
+                        glBindTexture(GL_TEXTURE_2D, texture);
+                        glActiveTexture(GL_TEXTURE0);
+                        lastMaps[m] = texture;
+                    }
+                }
+
+                depthPrepass->ShadeObject(item.object);
+
+                glBindVertexArray(item.shape->VAO);
+                glDrawElements(GL_TRIANGLES, item.shape->num_indices, item.shape->index_type, (void*)item.shape->index_offset);
+
+                drawStats.draw_calls += 1;
+                drawStats.triangles += item.shape->num_indices / 3;
+            }
+
+            if (streamer != nullptr && pass == streamProgram)
+            {
+                HZGL_PROFILE_GPU_SCOPE("Streaming");
+
+                glm::mat4 Normal = glm::transpose(glm::inverse(streamModel));
+
+                glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &streamModel[0][0]);
+                glUniformMatrix4fv(normalLocation, 1, GL_FALSE, &Normal[0][0]);
+
+                if (lit && deferred)
+                    deferredRenderer->SetupMaterial(pass, materials[mIndex]);
+                else if (lit)
+                    hzgl::SetupMaterial(pass, materials[mIndex], "uMaterial");
+
+                // the chunks are not in the depth pre-pass (nor in the shadow maps)
+                depthPrepass->EndShading();
+                streamer->Draw();
+
+                drawStats.draw_calls += streamer->Stats().drawn;
+                drawStats.triangles += streamer->Stats().drawn_triangles;
+            }
+        }
+
+        depthPrepass->EndShading();
+    }
+
+    glBindVertexArray(0);
+
+    if (deferred)
+        deferredRenderer->Resolve(*lightClusters, *shadowAtlas, *environment, View, Projection, camera.position);
+
+    // points are not lit, they go over the resolved image and test against its depth; scaled into
+    // the unit sphere like the streamed mesh
+    if (pointCloud != nullptr)
+    {
+        HZGL_PROFILE_GPU_SCOPE("Points");
+
+        glm::ivec4 viewport;
+        glGetIntegerv(GL_VIEWPORT, &viewport[0]);
+
+        glm::mat4 pointsModel = Model * glm::scale(glm::vec3(1.0f / pointCloud->Radius())) * glm::translate(-pointCloud->Center());
+        pointCloud->Update(pointsModel, View, Projection, viewport[3]);
+        pointCloud->Draw(View, Projection);
+
+        drawStats.draw_calls += pointCloud->Stats().drawn;
+        drawStats.points += pointCloud->Stats().drawn_points;
+    }
+
+    glUseProgram(0);
+}
+
+// dirty flags for everything that differs from the last frame (copies reuse their capacity)
+static unsigned sceneChanges(SceneState& last, int oIndex, int pIndex, int mIndex)
+{
+    unsigned flags = hzgl::HZGL_DIRTY_NONE;
+
+    glm::mat4 view = camera.GetViewMatrix();
+    glm::mat4 projection = camera.GetProjMatrix();
+
+    if (view != last.view || projection != last.projection)
+        flags |= hzgl::HZGL_DIRTY_CAMERA;
+    if (oIndex != last.oIndex)
+        flags |= hzgl::HZGL_DIRTY_MODEL;
+    if (pIndex != last.pIndex || deferredShading != last.deferred || shadowsEnabled != last.shadows
+        || environment->Enabled() != last.environment || environment->Intensity() != last.environmentIntensity)
+        flags |= hzgl::HZGL_DIRTY_PROGRAM;
+    if (mIndex != last.mIndex || materials != last.materials)
+        flags |= hzgl::HZGL_DIRTY_MATERIAL;
+    if (lights != last.lights)
+        flags |= hzgl::HZGL_DIRTY_LIGHT;
+
+    if (flags != hzgl::HZGL_DIRTY_NONE)
+    {
+        last.view = view;
+        last.projection = projection;
+        last.oIndex = oIndex;
+        last.pIndex = pIndex;
+        last.mIndex = mIndex;
+        last.deferred = deferredShading;
+        last.shadows = shadowsEnabled;
+        last.environment = environment->Enabled();
+        last.environmentIntensity = environment->Intensity();
+        last.lights = lights;
+        last.materials = materials;
+    }
+
+    return flags;
+}
+
+static void display(void)
+{
+    static int lIndex = 0; // light
+    static int mIndex = 0; // material
+    static int oIndex = 0; // render object
+    static int pIndex = 0; // shader program
+
+    static float rotation = 0.0f;
+    static SceneState lastScene;
+
+    // asked for in the "Assets" section, done once the GUI is drawn
+    std::string loadRequest;
+    int unloadRequest = -1;
+
+    HZGL_PROFILE_SCOPE("display");
+
+    // the GUI comes before the scene, so it shows the previous frame
+    int lastShaderVariants = drawStats.shader_variants;
+    drawStats = hzgl::DrawStats();
+
+    deltaTime = static_cast<float>(timer.Tick());
+
+    // the first frame after idling must not jump by the whole idle time
+    if (turntable)
+    {
+        rotation += 10.0f * std::min(deltaTime, 0.1f);
+        if (rotation > 360.0f) rotation -= 360.0f;
+
+        scheduler.MarkDirty(hzgl::HZGL_DIRTY_ANIMATION);
+    }
+
+    {
+        HZGL_PROFILE_GPU_SCOPE("Clear");
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    // no GUI in headless mode (--alloc-check runs this frame offscreen)
+    if (window != nullptr)
+    {
+        glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+        guiControl.BeginFrame(true);
+        {	
+            HZGL_PROFILE_SCOPE("ImGui");
+
+            guiControl.RenderCameraWidget(camera);
+            guiControl.RenderModelConfigWidget(objects, &oIndex, "../assets/models", &loadRequest, &unloadRequest);
+            guiControl.RenderShaderProgramConfigWidget(programs, &pIndex);
+            guiControl.RenderShaderVariantWidget(shaderVariants->Stats(), lastShaderVariants);
+
+            if (pIndex == phongProgram)
+            {
+                guiControl.RenderLightingConfigWidget(lights, &lIndex, hzgl::HZGL_ANY_LIGHT);
+                guiControl.RenderMaterialConfigWidget(materials, &mIndex, hzgl::HZGL_PHONG_MATERIAL);
+            }
+            else if (pIndex == pbrProgram)
+            {
+                guiControl.RenderLightingConfigWidget(lights, &lIndex, hzgl::HZGL_ANY_LIGHT);
+                guiControl.RenderMaterialConfigWidget(materials, &mIndex, hzgl::HZGL_PBR_MATERIAL);
+                guiControl.RenderEnvironmentWidget(*environment);
+            }
+
+            guiControl.RenderProfilerWidget();
+            guiControl.RenderMemoryWidget();
+            guiControl.RenderSceneWidget(instances, *sceneGraph, objects, materials, oIndex, mIndex);
+            guiControl.RenderLightClustersWidget(lights, numDefaultLights, lightClusters->Stats(), &deferredShading);
+            guiControl.RenderOcclusionWidget(&occlusionCulling, occlusionCuller->Stats());
+            guiControl.RenderDepthPrepassWidget(*depthPrepass, objects);
+            guiControl.RenderShadowWidget(&shadowsEnabled, shadowAtlas->Stats());
+            guiControl.RenderFramePacingWidget(&renderOnDemand, &turntable, utilization.Latest(), scheduler.LastDirtyFlags());
+
+            if (streamer != nullptr)
+                guiControl.RenderStreamingWidget(*streamer);
+            if (pointCloud != nullptr)
+                guiControl.RenderPointCloudWidget(*pointCloud);
+        }
+        {
+            HZGL_PROFILE_GPU_SCOPE("ImGui::Render");
+            guiControl.EndFrame();
+        }
+
+        // a widget being dragged keeps drawing even while the mouse rests
+        if (ImGui::IsAnyItemActive())
+            scheduler.MarkDirty(hzgl::HZGL_DIRTY_INPUT);
+    }
+
+    if (unloadRequest >= 0)
+    {
+        unloadModel(unloadRequest);
+        oIndex = std::min(oIndex, (int)objects.size() - 1);
+        scheduler.MarkDirty(hzgl::HZGL_DIRTY_MODEL);
+    }
+
+    if (!loadRequest.empty())
+    {
+        if (loadModel(loadRequest))
+            warmVariants(objects.back());
+        else
+            std::cerr << loadRequest << " is loaded already" << std::endl;
+
+        scheduler.MarkDirty(hzgl::HZGL_DIRTY_MODEL);
+    }
+
+    scheduler.SetOnDemand(renderOnDemand);
+    scheduler.MarkDirty(sceneChanges(lastScene, oIndex, pIndex, mIndex));
+
+    glViewport(0, 0, static_cast<int>(0.75f * SCR_WIDTH), SCR_HEIGHT);
+    glm::mat4 Model = glm::rotate(glm::radians(rotation), glm::vec3(0, 1, 0));
+    drawScene(oIndex, pIndex, mIndex, Model, camera.GetProjMatrix());
+
+    // keep drawing until the chunks asked for are in
+    if (streamer != nullptr && streamer->Stats().in_flight > 0)
+        scheduler.MarkDirty(hzgl::HZGL_DIRTY_MODEL);
+    if (pointCloud != nullptr && pointCloud->Stats().in_flight > 0)
+        scheduler.MarkDirty(hzgl::HZGL_DIRTY_MODEL);
+
+    // lights per fragment, from a depth readback every 30 frames (collected a few frames later)
+    static int sampleFrame = 0;
+    if ((pIndex == phongProgram || pIndex == pbrProgram) && ++sampleFrame % 30 == 0)
+    {
+        glm::ivec4 viewport;
+        glGetIntegerv(GL_VIEWPORT, &viewport[0]);
+        lightClusters->SampleDepth(viewport);
+    }
+
+    // print-quality render of the current view, tile by tile
+    if (hiresRequested)
+    {
+        hiresRequested = false;
+        hzgl::TakeTiledScreenshot(hzgl::TimestampStem("Screenshot") + "-hires.png", camera,
+                                  [&](const glm::mat4& projection) { drawScene(oIndex, pIndex, mIndex, Model, projection); },
+                                  hiresOptions);
+    }
+}
+
+// a numeric flag: the whole value has to be a number that fits T, and values below minimum
+// are raised to it
+template <typename T>
+static bool parseNumber(const std::string& flag, const char* value, T* result, T minimum = std::numeric_limits<T>::lowest())
+{
+    char* end = nullptr;
+    errno = 0;
+
+    long double parsed = std::is_integral<T>::value ? static_cast<long double>(strtoll(value, &end, 10)) : strtold(value, &end);
+
+    if (end == value || *end != '\0' || errno == ERANGE || !(parsed >= std::numeric_limits<T>::lowest() && parsed <= std::numeric_limits<T>::max()))
+    {
+        std::cerr << "Invalid value for " << flag << ": " << value << std::endl;
+        return false;
+    }
+
+    *result = std::max(minimum, static_cast<T>(parsed));
+
+    return true;
+}
+
+static bool parseArguments(int argc, char** argv, CommandLineOptions& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if (arg == "--benchmark")
+            options.benchmark = true;
+        else if (arg == "--script" && hasValue)
+            options.script = argv[++i];
+        else if (arg == "--output" && hasValue)
+            options.output = argv[++i];
+        else if (arg == "--memory-report" && hasValue)
+            options.memoryReport = argv[++i];
+        else if (arg == "--golden" && hasValue)
+            options.golden = argv[++i];
+        else if (arg == "--update-golden")
+            options.updateGolden = true;
+        else if (arg == "--tolerance" && hasValue)
+        {
+            if (!parseNumber(arg, argv[++i], &options.tolerance, 0.0))
+                return false;
+        }
+        else if (arg == "--frames" && hasValue)
+        {
+            if (!parseNumber(arg, argv[++i], &options.frames, 1))
+                return false;
+        }
+        else if (arg == "--capture" && hasValue)
+            options.capture = argv[++i];
+        else if (arg == "--capture-format" && hasValue)
+        {
+            if (!hzgl::CaptureFormatFromName(argv[++i], &options.captureFormat))
+            {
+                std::cerr << "Unknown capture format: " << argv[i] << " (png, qoi or y4m)" << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--capture-frames" && hasValue)
+        {
+            if (!parseNumber(arg, argv[++i], &options.captureFrames, 1))
+                return false;
+        }
+        else if (arg == "--fps" && hasValue)
+        {
+            if (!parseNumber(arg, argv[++i], &options.fps, 1))
+                return false;
+        }
+        else if (arg == "--model" && hasValue)
+        {
+            if (!parseNumber(arg, argv[++i], &options.model))
+                return false;
+        }
+        else if (arg == "--program" && hasValue)
+            options.program = argv[++i];
+        else if (arg == "--batch" && hasValue)
+            options.batch = argv[++i];
+        else if (arg == "--batch-output" && hasValue)
+            options.batchOutput = argv[++i];
+        else if (arg == "--views" && hasValue)
+        {
+            if (!parseNumber(arg, argv[++i], &options.views, 1))
+                return false;
+        }
+        else if (arg == "--elevation" && hasValue)
+        {
+            if (!parseNumber(arg, argv[++i], &options.elevation))
+                return false;
+        }
+        else if (arg == "--jobs" && hasValue)
+        {
+            if (!parseNumber(arg, argv[++i], &options.jobs, 1))
+                return false;
+        }
+        else if (arg == "--hires" && hasValue)
+            options.hires = argv[++i];
+        else if (arg == "--hires-size" && hasValue)
+        {
+            if (sscanf(argv[++i], "%dx%d", &options.hiresWidth, &options.hiresHeight) != 2 || options.hiresWidth <= 0 || options.hiresHeight <= 0)
+            {
+                std::cerr << "Invalid value for " << arg << ": " << argv[i] << " (WIDTHxHEIGHT)" << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--supersample" && hasValue)
+        {
+            if (!parseNumber(arg, argv[++i], &options.supersampling, 1))
+                return false;
+        }
+        else if (arg == "--occlusion")
+            options.occlusion = true;
+        else if (arg == "--grid" && hasValue)
+        {
+            if (!parseNumber(arg, argv[++i], &options.grid, 0))
+                return false;
+        }
+        else if (arg == "--lights" && hasValue)
+        {
+            if (!parseNumber(arg, argv[++i], &options.lights, 0))
+                return false;
+        }
+        else if (arg == "--deferred")
+            options.deferred = true;
+        else if (arg == "--no-shadows")
+            options.shadows = false;
+        else if (arg == "--env" && hasValue)
+            options.environment = argv[++i];
+        else if (arg == "--no-parallel-compile")
+            options.parallelCompile = false;
+        else if (arg == "--prepass" && hasValue)
+        {
+            std::string mode = argv[++i];
+
+            if (mode == "off")
+                options.prepass = hzgl::HZGL_PREPASS_OFF;
+            else if (mode == "on")
+                options.prepass = hzgl::HZGL_PREPASS_ON;
+            else if (mode == "auto")
+                options.prepass = hzgl::HZGL_PREPASS_AUTO;
+            else
+            {
+                std::cerr << "Invalid value for " << arg << ": " << mode << " (off, on or auto)" << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--continuous")
+            options.continuous = true;
+        else if (arg == "--turntable")
+            options.turntable = true;
+        else if (arg == "--no-turntable")
+            options.turntable = false;
+        else if (arg == "--alloc-check" && hasValue)
+        {
+            if (!parseNumber(arg, argv[++i], &options.allocCheck, 1))
+                return false;
+        }
+        else if (arg == "--preprocess" && hasValue)
+            options.preprocess = argv[++i];
+        else if (arg == "--preprocess-output" && hasValue)
+            options.preprocessOutput = argv[++i];
+        else if (arg == "--chunk-triangles" && hasValue)
+        {
+            if (!parseNumber(arg, argv[++i], &options.chunkBuild.triangles_per_chunk, 256))
+                return false;
+        }
+        else if (arg == "--memory-budget" && hasValue)
+        {
+            int megabytes = 0;
+            if (!parseNumber(arg, argv[++i], &megabytes, 16))
+                return false;
+
+            options.chunkBuild.memory_budget_mb = static_cast<size_t>(megabytes);
+            options.pointBuild.memory_budget_mb = options.chunkBuild.memory_budget_mb;
+        }
+        else if (arg == "--stream" && hasValue)
+            options.stream = argv[++i];
+        else if (arg == "--stream-gpu-mb" && hasValue)
+        {
+            int megabytes = 0;
+            if (!parseNumber(arg, argv[++i], &megabytes, 16))
+                return false;
+            options.streaming.gpu_budget_mb = static_cast<size_t>(megabytes);
+        }
+        else if (arg == "--stream-cpu-mb" && hasValue)
+        {
+            int megabytes = 0;
+            if (!parseNumber(arg, argv[++i], &megabytes, 4))
+                return false;
+            options.streaming.cpu_budget_mb = static_cast<size_t>(megabytes);
+        }
+        else if (arg == "--preprocess-points" && hasValue)
+            options.preprocessPoints = argv[++i];
+        else if (arg == "--points" && hasValue)
+            options.points = argv[++i];
+        else if (arg == "--point-budget" && hasValue)
+        {
+            if (!parseNumber(arg, argv[++i], &options.pointCloud.point_budget, int64_t(100000)))
+                return false;
+        }
+        else if (arg == "--size" && hasValue)
+        {
+            if (sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2 || options.width <= 0 || options.height <= 0)
+            {
+                std::cerr << "Invalid value for " << arg << ": " << argv[i] << " (WIDTHxHEIGHT)" << std::endl;
+                return false;
+            }
+        }
+        else
+        {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// pick the first material that matches the shading model of the program
+static int defaultMaterial(int pIndex)
+{
+    hzgl::MaterialType type = (pIndex == pbrProgram)
+                            ? hzgl::HZGL_PBR_MATERIAL
+                            : hzgl::HZGL_PHONG_MATERIAL;
+
+    for (int i = 0; i < (int)materials.size(); i++)
+    {
+        if (materials[i].type == type)
+            return i;
+    }
+
+    return 0;
+}
+
+// the first program when no name is given, -1 (reported) for a name that is not loaded
+static int programIndex(const std::string& name)
+{
+    if (name.empty())
+        return 0;
+
+    for (int p = 0; p < (int)programs.size(); p++)
+    {
+        if (programs[p].name == name)
+            return p;
+    }
+
+    std::cerr << "Unknown shader program: \"" << name << "\"" << std::endl;
+    return -1;
+}
+
+// create an offscreen context and load everything at the requested resolution
+static bool initHeadless(const CommandLineOptions& options, hzgl::HeadlessContext* context, bool loadDefaultModels = true)
+{
+    if (!hzgl::CreateHeadlessContext(context))
+        return false;
+
+    hzgl::ProfilerInitGPU();
+
+    SCR_WIDTH = options.width;
+    SCR_HEIGHT = options.height;
+    camera.aspect_ratio = static_cast<float>(SCR_WIDTH) / static_cast<float>(SCR_HEIGHT);
+
+    init(loadDefaultModels);
+
+    return true;
+}
+
+// release what init() created and the context, on every way out of every mode; init() may have
+// stopped part way, so any of the renderers can still be missing
+static void shutdown(hzgl::HeadlessContext* context = nullptr)
+{
+    if (lightClusters != nullptr)
+        lightClusters->Release();
+    if (deferredRenderer != nullptr)
+        deferredRenderer->Release();
+    if (depthPrepass != nullptr)
+        depthPrepass->Release();
+    if (shadowAtlas != nullptr)
+        shadowAtlas->Release();
+    if (environment != nullptr)
+        environment->Release();
+    if (shaderVariants != nullptr)
+        shaderVariants->Release();
+    if (streamer != nullptr)
+        streamer->Release();
+    if (pointCloud != nullptr)
+        pointCloud->Release();
+
+    lightClusters.reset();
+    deferredRenderer.reset();
+    depthPrepass.reset();
+    shadowAtlas.reset();
+    environment.reset();
+    shaderVariants.reset();
+    streamer.reset();
+    pointCloud.reset();
+
+    hzgl::ProfilerShutdownGPU();
+    resources.ReleaseAll();
+
+    // the headless modes own their context, the viewer its GLFW window
+    if (context != nullptr)
+        hzgl::DestroyHeadlessContext(context);
+    else
+        glfwTerminate();
+}
+
+// replay a scripted camera/model/program sequence offscreen and report frame statistics
+static int runBenchmark(const CommandLineOptions& options)
+{
+    hzgl::HeadlessContext context;
+
+    // a streamed mesh or a point cloud is measured on its own
+    if (!initHeadless(options, &context, streamPath.empty() && pointsPath.empty()))
+        return -1;
+
+    std::vector<hzgl::BenchmarkStep> steps;
+
+    if (!options.script.empty())
+    {
+        if (!hzgl::LoadBenchmarkScript(options.script, steps))
+        {
+            shutdown(&context);
+            return -1;
+        }
+    }
+    else
+    {
+        for (int o = 0; o < (int)objects.size(); o++)
+        {
+            for (const auto& program : programs)
+            {
+                hzgl::BenchmarkStep step;
+                step.model = o;
+                step.program = program.name;
+                step.frames = options.frames;
+                steps.push_back(step);
+            }
+        }
+
+        if (objects.empty())
+        {
+            hzgl::BenchmarkStep step;
+            step.frames = options.frames;
+            steps.push_back(step);
+        }
+    }
+
+    // a misspelled program would otherwise be benchmarked as another one
+    for (const auto& step : steps)
+    {
+        if (programIndex(step.program) < 0)
+        {
+            shutdown(&context);
+            return -1;
+        }
+    }
+
+    hzgl::FrameBufferInfo fbInfo;
+    GLuint fbo = hzgl::CreateFBO(SCR_WIDTH, SCR_HEIGHT, &fbInfo);
+
+    if (fbo == 0)
+    {
+        shutdown(&context);
+        return -1;
+    }
+
+    if (!options.memoryReport.empty() && hzgl::WriteMemoryReport(options.memoryReport))
+        std::cout << "Memory report written to " << options.memoryReport << std::endl;
+
+    hzgl::BenchmarkReport report;
+    report.renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    report.version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    report.width = SCR_WIDTH;
+    report.height = SCR_HEIGHT;
+    report.load_times_ms = loadTimes;
+    report.parallel_shader_compile = hzgl::ParallelShaderCompileEnabled();
+
+    std::cout << "Benchmarking on " << report.renderer << std::endl;
+
+    bool goldenPassed = true;
+    int pIndex = 0;
+    bool deferredDefault = deferredShading;
+    std::vector<double> allFrameTimes;
+    std::vector<unsigned char> pixels(4 * SCR_WIDTH * SCR_HEIGHT);
+
+    hzgl::SimpleTimer wallTimer;
+    wallTimer.Start();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+
+    for (size_t s = 0; s < steps.size(); s++)
+    {
+        hzgl::BenchmarkStep step = steps[s];
+        step.model = std::min(std::max(step.model, 0), (int)objects.size() - 1);
+
+        if (!step.program.empty())
+            pIndex = programIndex(step.program);
+        step.program = programs[pIndex].name;
+
+        // without a shading key a step keeps the path given on the command line
+        deferredShading = step.shading.empty() ? deferredDefault : (step.shading == "deferred");
+        bool lit = (pIndex == phongProgram || pIndex == pbrProgram);
+        step.shading = (lit && deferredShading && deferredRenderer != nullptr) ? "deferred" : "forward";
+
+        int mIndex = defaultMaterial(pIndex);
+
+        std::vector<double> frameTimes;
+        hzgl::DrawStats stepStats;
+
+        for (int f = 0; f < step.frames; f++)
+        {
+            hzgl::ProfilerBeginFrame();
+
+            // deterministic camera path so golden images are reproducible
+            float angle = glm::radians(step.orbit_degrees * f / step.frames);
+            camera.position = glm::vec3(step.radius * std::sin(angle), step.height, step.radius * std::cos(angle));
+            camera.target = glm::vec3(0, 0, 0);
+
+            hzgl::SimpleTimer frameTimer;
+            frameTimer.Start();
+
+            drawStats = hzgl::DrawStats();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            drawScene(step.model, pIndex, mIndex, glm::mat4(1.0f), camera.GetProjMatrix());
+
+            // nothing is presented, so wait for the GPU to include its work in the frame time
+            glFinish();
+
+            if (timeToFirstFrame < 0.0)
+                timeToFirstFrame = 1000.0 * startupTimer.Now();
+
+            frameTimes.push_back(1000.0 * frameTimer.End());
+            stepStats = drawStats;
+
+            hzgl::ProfilerEndFrame();
+        }
+
+        // the last frame of the step is still in the depth buffer
+        if (lit)
+        {
+            lightClusters->SampleDepth(glm::ivec4(0, 0, SCR_WIDTH, SCR_HEIGHT), true);
+            stepStats.lights_per_fragment = lightClusters->Stats().lights_per_fragment;
+        }
+
+        hzgl::BenchmarkStepResult result;
+        result.step = step;
+        result.draw_stats = stepStats;
+        result.frame_time_ms = hzgl::SummarizeFrameTimes(frameTimes);
+
+        if (!options.golden.empty())
+        {
+            glReadPixels(0, 0, SCR_WIDTH, SCR_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+            std::string goldenPath = options.golden + "/step-" + std::to_string(s) + ".png";
+            result.golden = hzgl::CompareWithGolden(goldenPath, pixels.data(), SCR_WIDTH, SCR_HEIGHT,
+                                                    options.tolerance, options.updateGolden);
+
+            if (!result.golden.passed)
+            {
+                std::cerr << "Golden image mismatch for step " << s << " (RMSE " << result.golden.rmse << ")" << std::endl;
+                goldenPassed = false;
+            }
+        }
+
+        std::string stepPath = !objects.empty() ? objects[step.model].path : (!pointsPath.empty() ? pointsPath : streamPath);
+
+        std::cout << "Step " << s << ": " << stepPath << " / " << step.program << " (" << step.shading << ")"
+                  << ", p50 " << result.frame_time_ms.p50 << " ms, p99 " << result.frame_time_ms.p99 << " ms" << std::endl;
+
+        allFrameTimes.insert(allFrameTimes.end(), frameTimes.begin(), frameTimes.end());
+        report.steps.push_back(result);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    report.wall_time_s = wallTimer.End();
+    report.time_to_first_frame_ms = timeToFirstFrame;
+    report.total_frames = static_cast<int>(allFrameTimes.size());
+    report.frame_time_ms = hzgl::SummarizeFrameTimes(allFrameTimes);
+
+    if (hzgl::WriteBenchmarkReport(options.output, report))
+        std::cout << "Benchmark report written to " << options.output << std::endl;
+
+    hzgl::DeleteFBO(&fbInfo);
+
+    shutdown(&context);
+
+    return goldenPassed ? 0 : 1;
+}
+
+// render a turntable offscreen at a fixed time step and stream the frames to disk or a pipe
+static int runCapture(const CommandLineOptions& options)
 {
-    // load meshes from OBJ files
-    resources.LoadModel("../assets/models/bunny.obj", objects);
-    resources.LoadModel("../assets/models/buddha.obj", objects);
-    resources.LoadModel("../assets/models/dragon.obj", objects);
-    resources.LoadModel("../assets/models/mori_knob/testObj.obj", objects);
+    hzgl::HeadlessContext context;
 
-    // prepare the shader programs
-    resources.LoadShaderProgram({
-        {GL_VERTEX_SHADER, "../assets/shaders/passthrough.vert"},
-        {GL_FRAGMENT_SHADER, "../assets/shaders/passthrough.frag"},
-        }, "Rendering Normal");
+    if (!initHeadless(options, &context))
+        return -1;
 
-    resources.LoadShaderProgram({
-        {GL_VERTEX_SHADER, "../assets/shaders/phong.vert"},
-        {GL_FRAGMENT_SHADER, "../assets/shaders/phong.frag"},
-        }, "Blinn-Phong Shading");
+    int pIndex = programIndex(options.program);
 
-    resources.LoadShaderProgram({
-        {GL_VERTEX_SHADER, "../assets/shaders/pbr_basic.vert"},
-        {GL_FRAGMENT_SHADER, "../assets/shaders/pbr_basic.frag"},
-        }, "Basic PBR (Analytic lights)");
+    hzgl::FrameBufferInfo fbInfo;
+    GLuint fbo = hzgl::CreateFBO(SCR_WIDTH, SCR_HEIGHT, &fbInfo);
 
-    for (const auto &pName : resources.GetLoadedShaderProgramNames())
-        programs.push_back(resources.GetProgramInfo(pName));
+    if (fbo == 0 || objects.empty() || pIndex < 0)
+    {
+        if (fbo != 0)
+            hzgl::DeleteFBO(&fbInfo);
 
-    guiControl.Init(window, "#version 410");
+        shutdown(&context);
+        return -1;
+    }
 
-    int width, height;
-    glfwGetFramebufferSize(window, &width, &height);
-    framebuffer_size_callback(window, width, height);
+    int oIndex = std::min(std::max(options.model, 0), (int)objects.size() - 1);
+    int mIndex = defaultMaterial(pIndex);
 
-    lights.push_back(
-        hzgl::Light(hzgl::HZGL_POINT_LIGHT, glm::vec3(0.0f, 0.0f, 3.0f)));
+    hzgl::CaptureOptions captureOptions;
+    captureOptions.format = options.captureFormat;
+    captureOptions.output = options.capture;
+    captureOptions.width = SCR_WIDTH;
+    captureOptions.height = SCR_HEIGHT;
+    captureOptions.fps = options.fps;
+    captureOptions.encoder_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
 
-    lights.push_back(
-        hzgl::Light(hzgl::HZGL_POINT_LIGHT, glm::vec3(2.0f, 2.0f, 2.0f)));
+    hzgl::FrameCapture capture;
 
-    lights.push_back(
-        hzgl::Light(hzgl::HZGL_DIRECTIONAL_LIGHT, glm::vec3(0.0f, -1.0f, -2.0f), glm::vec3(0.5f)));
+    if (!capture.Begin(captureOptions))
+    {
+        hzgl::DeleteFBO(&fbInfo);
+        shutdown(&context);
+        return -1;
+    }
 
-    materials.push_back(hzgl::CreatesSampleMaterial(hzgl::HZGL_PHONG_MATERIAL, "turquoise"));
-    materials.push_back(hzgl::CreatesSampleMaterial(hzgl::HZGL_PHONG_MATERIAL, "pearl"));
-    materials.push_back(hzgl::CreatesSampleMaterial(hzgl::HZGL_PHONG_MATERIAL, "bronze"));
-    materials.push_back(hzgl::Material(hzgl::MaterialType::HZGL_PBR_MATERIAL));
+    // progress goes to stderr so that "--capture -" can stream Y4M on stdout
+    std::cerr << "Capturing " << options.captureFrames << " frames of " << objects[oIndex].path
+              << " / " << programs[pIndex].name << std::endl;
 
-    glClearColor(0.98f, 0.98f, 0.98f, 1.0f);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
 
-    // enable optional functionalities
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
+    // simulation time advances by exactly one step per frame, regardless of how long a frame takes
+    double simulationTime = 0.0;
+    double duration = options.captureFrames * capture.TimeStep();
 
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
+    for (int f = 0; f < options.captureFrames; f++)
+    {
+        hzgl::ProfilerBeginFrame();
+
+        float rotation = static_cast<float>(360.0 * simulationTime / duration);
+
+        drawStats = hzgl::DrawStats();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        drawScene(oIndex, pIndex, mIndex, glm::rotate(glm::radians(rotation), glm::vec3(0, 1, 0)), camera.GetProjMatrix());
+
+        capture.CaptureFrame(GL_COLOR_ATTACHMENT0);
+        simulationTime += capture.TimeStep();
+
+        hzgl::ProfilerEndFrame();
+
+        if ((f + 1) % options.fps == 0)
+        {
+            hzgl::CaptureStats stats = capture.Stats();
+            std::cerr << "Frame " << f + 1 << "/" << options.captureFrames << ": " << stats.frames_per_s << " frames/s, "
+                      << stats.pending_readbacks << " readbacks, " << stats.queued_encodes << " queued encodes" << std::endl;
+        }
+    }
+
+    hzgl::CaptureStats stats = capture.End();
+
+    std::cerr << "Captured " << stats.frames_written << " frames in " << stats.elapsed_s << " s ("
+              << stats.frames_per_s << " frames/s), render thread stalled " << stats.stall_s << " s, "
+              << "max encoder queue depth " << stats.max_queued_encodes << std::endl;
+
+    if (stats.frames_dropped > 0)
+        std::cerr << stats.frames_dropped << " frames lost in failed readbacks" << std::endl;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    hzgl::DeleteFBO(&fbInfo);
+
+    shutdown(&context);
+
+    return (stats.frames_written == options.captureFrames) ? 0 : 1;
 }
 
-static void display(void)
+// render every model of a directory or manifest from a few fixed views; parsing runs on workers
+// ahead of the GL thread, encoding behind it, and each model is evicted once its views are queued
+static int runBatch(const CommandLineOptions& options)
 {
-    static int lIndex = 0; // light
-    static int mIndex = 0; // material
-    static int oIndex = 0; // render object
-    static int pIndex = 0; // shader program
+    if (options.captureFormat == hzgl::HZGL_CAPTURE_Y4M)
+    {
+        std::cerr << "--batch writes images, use --capture-format png or qoi" << std::endl;
+        return -1;
+    }
 
-    static float rotation = 0.0f;
+    hzgl::HeadlessContext context;
 
-    deltaTime = static_cast<float>(timer.Tick());
-    rotation += 10.0f * deltaTime;
-    if (rotation > 360.0f) rotation -= 360.0f;
+    if (!initHeadless(options, &context, false))
+        return -1;
 
-    const auto modelNames = resources.GetLoadedMeshesNames();
-    const auto programNames = resources.GetLoadedShaderProgramNames();
+    int pIndex = programIndex(options.program);
 
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    if (pIndex < 0)
+    {
+        shutdown(&context);
+        return -1;
+    }
 
-    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
-    guiControl.BeginFrame(true);
-    {	
-        guiControl.RenderCameraWidget(camera);
-        guiControl.RenderModelConfigWidget(objects, &oIndex);
-        guiControl.RenderShaderProgramConfigWidget(programs, &pIndex);
+    std::vector<std::string> inputs;
 
-            if (programNames[pIndex] == "Blinn-Phong Shading")
-            {
-            guiControl.RenderLightingConfigWidget(lights, &lIndex, hzgl::HZGL_ANY_LIGHT);
-            guiControl.RenderMaterialConfigWidget(materials, &mIndex, hzgl::HZGL_PHONG_MATERIAL);
-            }
-            else if (programNames[pIndex] == "Basic PBR (Analytic lights)")
-            {
-            guiControl.RenderLightingConfigWidget(lights, &lIndex, hzgl::HZGL_ANY_LIGHT);
-            guiControl.RenderMaterialConfigWidget(materials, &mIndex, hzgl::HZGL_PBR_MATERIAL);
-        }
+    if (!hzgl::CollectBatchInputs(options.batch, inputs) || inputs.empty())
+    {
+        std::cerr << "No models found in " << options.batch << std::endl;
+        shutdown(&context);
+        return -1;
     }
-    guiControl.EndFrame();
 
-    GLuint program = programs[pIndex].id;
+    if (!hzgl::CreateDirectories(options.batchOutput))
+    {
+        std::cerr << "Failed to create " << options.batchOutput << std::endl;
+        shutdown(&context);
+        return -1;
+    }
 
-    glUseProgram(program);
+    hzgl::FrameBufferInfo fbInfo;
+    GLuint fbo = hzgl::CreateFBO(SCR_WIDTH, SCR_HEIGHT, &fbInfo);
 
-    glm::mat4 Model = glm::rotate(glm::radians(rotation), glm::vec3(0, 1, 0));
-    glm::mat4 View = camera.GetViewMatrix();
-    glm::mat4 Projection = camera.GetProjMatrix();
-    glm::mat4 Normal = glm::transpose(glm::inverse(Model));
+    if (fbo == 0)
+    {
+        shutdown(&context);
+        return -1;
+    }
+
+    std::string root = hzgl::IsDirectory(options.batch) ? options.batch : hzgl::GetParentPath(options.batch);
+
+    int mIndex = defaultMaterial(pIndex);
+
+    hzgl::BatchViewSpec spec;
+    spec.views = options.views;
+    spec.elevation = options.elevation;
+
+    bool qoi = (options.captureFormat == hzgl::HZGL_CAPTURE_QOI);
 
-    hzgl::SetMatrixv(program, "Model", 4, &Model[0][0]);
-    hzgl::SetMatrixv(program, "View", 4, &View[0][0]);
-    hzgl::SetMatrixv(program, "Projection", 4, &Projection[0][0]);
-    hzgl::SetMatrixv(program, "Normal", 4, &Normal[0][0]);
+    // split the cores between the parsers and the encoders
+    int jobs = (options.jobs > 0) ? options.jobs : std::max(2, (int)std::thread::hardware_concurrency());
+    int parseThreads = std::max(1, jobs / 2);
+    int encodeThreads = std::max(1, jobs - parseThreads);
 
-    if (programs[pIndex].name == "Blinn-Phong Shading" 
-     || programs[pIndex].name == "Basic PBR (Analytic lights)")
+    hzgl::ModelPrefetcher prefetcher(inputs, parseThreads, 2 * parseThreads);
+    hzgl::AsyncReadback readback(3);
+    hzgl::SetPNGCompressionLevel(hzgl::PNGOptions().compression_level);
+    hzgl::ThreadPool encoder(encodeThreads, 4 * encodeThreads, "Encoder");
+
+    std::unordered_map<uint64_t, std::string> outputs;  // readback tag -> image path
+    std::vector<uint64_t> lost;                          // readbacks that could not be mapped
+    std::atomic<int> written(0);
+    uint64_t nextTag = 0;
+
+    auto encode = [&](std::vector<hzgl::ReadbackImage>& images) {
+        for (uint64_t tag : lost)
+            outputs.erase(tag);
+        lost.clear();
+
+        for (auto& image : images)
+        {
+            std::string path = outputs[image.tag];
+            outputs.erase(image.tag);
+
+            encoder.Submit([image, path, qoi, &written]() {
+                bool ok = qoi ? hzgl::WriteQOI(path, image.pixels->data(), image.width, image.height, 4)
+                              : hzgl::WritePNG(path, image.pixels->data(), image.width, image.height, 4);
+                if (ok)
+                    written.fetch_add(1);
+            });
+        }
+
+        images.clear();
+    };
+
+    std::cout << "Rendering " << inputs.size() << " models x " << spec.views << " views with "
+              << programs[pIndex].name << " (" << parseThreads << " loaders, " << encodeThreads << " encoders)" << std::endl;
+
+    int rendered = 0;
+    int failed = 0;
+    double parseTime = 0.0;
+    double uploadTime = 0.0;
+
+    hzgl::SimpleTimer wallTimer;
+    wallTimer.Start();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+
+    hzgl::BatchItem item;
+    std::vector<hzgl::ReadbackImage> images;
+
+    while (prefetcher.Next(item))
     {
-        int numLights = std::min(10, (int)lights.size());
-        for (int i = 0; i < numLights; i++)
-            hzgl::SetupLightInArray(program, lights[i], "uLight", i);
+        parseTime += item.parse_ms;
+
+        if (item.radius <= 0.0f)
+        {
+            std::cerr << "Skipping " << item.model.path << ": nothing to render" << std::endl;
+            failed++;
+            continue;
+        }
+
+        hzgl::ProfilerBeginFrame();
+
+        hzgl::SimpleTimer uploadTimer;
+        uploadTimer.Start();
+
+        objects.clear();
+        resetScene();
+        depthPrepass->Clear();
+        resources.LoadModel(item.model, objects);
+
+        uploadTime += 1000.0 * uploadTimer.End();
+
+        // scale the model into the unit sphere so one camera setup frames every asset
+        glm::mat4 Model = glm::scale(glm::vec3(1.0f / item.radius)) * glm::translate(-item.center);
+        std::string name = hzgl::BatchOutputName(root, item.model.path);
+
+        for (int v = 0; v < spec.views; v++)
+        {
+            camera.position = hzgl::BatchViewPosition(spec, v, camera.vfov);
+            camera.target = glm::vec3(0, 0, 0);
+
+            drawStats = hzgl::DrawStats();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            drawScene(0, pIndex, mIndex, Model, camera.GetProjMatrix());
+
+            // only wait for the GPU when every readback slot is still busy
+            readback.Collect(images, false, -1, &lost);
+            if (readback.NumPending() == readback.NumSlots())
+                readback.Collect(images, true, 1, &lost);
+            encode(images);
+
+            std::string suffix = (spec.views > 1) ? "-" + std::to_string(v) : "";
+            outputs[nextTag] = options.batchOutput + "/" + name + suffix + (qoi ? ".qoi" : ".png");
+            readback.Request(0, 0, SCR_WIDTH, SCR_HEIGHT, GL_COLOR_ATTACHMENT0, nextTag++);
+        }
+
+        // the draws are queued, so the buffers can go (the driver frees them when it is done)
+        for (auto& object : objects)
+            resources.Unload(object);
+        objects.clear();
+        item = hzgl::BatchItem();
+
+        rendered++;
+
+        hzgl::ProfilerEndFrame();
+
+        if (rendered % 100 == 0)
+        {
+            std::cout << rendered + failed << "/" << inputs.size() << " models, "
+                      << rendered / wallTimer.Now() << " assets/s, "
+                      << encoder.QueueDepth() << " queued encodes" << std::endl;
+        }
+    }
+
+    // drain the pipeline
+    readback.Collect(images, true, -1, &lost);
+    encode(images);
+    encoder.Wait();
+    readback.Release();
 
-        hzgl::SetupMaterial(program, materials[mIndex], "uMaterial");
-        hzgl::SetFloatv(program, "uEyePosition", 3, &camera.position[0]);
+    double seconds = wallTimer.End();
+
+    std::cout << "Rendered " << rendered << " models (" << failed << " failed), " << written.load() << " images in "
+              << seconds << " s: " << rendered / seconds << " assets/s, " << written.load() / seconds << " images/s" << std::endl;
+
+    if (rendered > 0)
+    {
+        std::cout << "Mean parse " << parseTime / (rendered + failed) << " ms (on " << parseThreads << " threads), "
+                  << "mean upload " << uploadTime / rendered << " ms" << std::endl;
     }
 
-    glViewport(0, 0, static_cast<int>(0.75f * SCR_WIDTH), SCR_HEIGHT);
-    for (int i = 0; i < objects[oIndex].num_shapes; i++)
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    hzgl::DeleteFBO(&fbInfo);
+
+    shutdown(&context);
+
+    return (failed == 0) ? 0 : 1;
+}
+
+// render one model into a tiled screenshot without opening a window
+static int runHiresScreenshot(const CommandLineOptions& options)
+{
+    hzgl::HeadlessContext context;
+
+    if (!initHeadless(options, &context))
+        return -1;
+
+    int pIndex = programIndex(options.program);
+
+    if (objects.empty() || pIndex < 0)
     {
-        const auto &shape = objects[oIndex].shapes[i];
-        glBindVertexArray(shape.VAO);
-        glDrawElements(GL_TRIANGLES, shape.num_indices, GL_UNSIGNED_INT, 0);
+        shutdown(&context);
+        return -1;
     }
 
-    glBindVertexArray(0);
-    glUseProgram(0);
+    int oIndex = std::min(std::max(options.model, 0), (int)objects.size() - 1);
+    int mIndex = defaultMaterial(pIndex);
+
+    hzgl::SimpleTimer hiresTimer;
+    hiresTimer.Start();
+
+    bool ok = hzgl::TakeTiledScreenshot(options.hires, camera,
+                                        [&](const glm::mat4& projection) { drawScene(oIndex, pIndex, mIndex, glm::mat4(1.0f), projection); },
+                                        hiresOptions);
+
+    std::cout << "Tiled screenshot took " << hiresTimer.End() << " s" << std::endl;
+
+    shutdown(&context);
+
+    return ok ? 0 : 1;
 }
 
-int main(void)
+// the viewer window with its callbacks and GL functions; the allocation check uses a hidden one
+// so that its frames run the GUI as well
+static bool createWindow(bool visible)
 {
     // initialize GLFW
     if (!glfwInit())
-        return -1;
+        return false;
 
     // use OpenGL 4.1 Core
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
@@ -186,6 +1866,7 @@ int main(void)
 
     // use 8x multi-sampling
     glfwWindowHint(GLFW_SAMPLES, 8);
+    glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
 
     // create a windowed mode window and its OpenGL context
     window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "OBJ Viewer", NULL, NULL);
@@ -193,7 +1874,7 @@ int main(void)
     {
         std::cerr << "Failed to create window." << std::endl;
         glfwTerminate();
-        return -1;
+        return false;
     }
 
     // make the window's context current
@@ -206,28 +1887,287 @@ int main(void)
     glfwSetKeyCallback(window, key_callback);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
+    // any other input wakes the on-demand loop (ImGui chains these callbacks in init())
+    glfwSetCursorPosCallback(window, [](GLFWwindow*, double, double) { scheduler.MarkDirty(hzgl::HZGL_DIRTY_INPUT); });
+    glfwSetMouseButtonCallback(window, [](GLFWwindow*, int, int, int) { scheduler.MarkDirty(hzgl::HZGL_DIRTY_INPUT); });
+    glfwSetScrollCallback(window, [](GLFWwindow*, double, double) { scheduler.MarkDirty(hzgl::HZGL_DIRTY_INPUT); });
+    glfwSetCharCallback(window, [](GLFWwindow*, unsigned int) { scheduler.MarkDirty(hzgl::HZGL_DIRTY_INPUT); });
+    glfwSetWindowFocusCallback(window, [](GLFWwindow*, int) { scheduler.MarkDirty(hzgl::HZGL_DIRTY_WINDOW); });
+    glfwSetWindowRefreshCallback(window, [](GLFWwindow*) { scheduler.MarkDirty(hzgl::HZGL_DIRTY_WINDOW); });
+
     // load GL functions using GLAD
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
     {
         std::cout << "Failed to initialize GLAD" << std::endl;
+        glfwTerminate();
+        return false;
+    }
+
+    return true;
+}
+
+// run the frame of the viewer (GUI included) in a hidden window, in continuous mode, and fail if
+// any frame after the warm-up touches the heap
+static int runAllocationCheck(const CommandLineOptions& options)
+{
+    if (!hzgl::HeapTrackingEnabled())
+    {
+        std::cerr << "--alloc-check needs a build with HZGL_TRACK_HEAP=ON" << std::endl;
+        return -1;
+    }
+
+    SCR_WIDTH = options.width;
+    SCR_HEIGHT = options.height;
+
+    if (!createWindow(false))
+        return -1;
+
+    hzgl::ProfilerInitGPU();
+
+    streamPath = options.stream;
+    streamingOptions = options.streaming;
+    pointsPath = options.points;
+    pointCloudOptions = options.pointCloud;
+
+    init(streamPath.empty() && pointsPath.empty());
+
+    // long enough for every container to reach its final capacity, including the profiler history
+    const int warmupFrames = 300;
+
+    int failedFrames = 0;
+    uint64_t allocations = 0;
+
+    for (int f = 0; f < warmupFrames + options.allocCheck; f++)
+    {
+        hzgl::BeginAllocationFrame();
+        hzgl::GetFrameArena().Reset();
+        hzgl::ProfilerBeginFrame();
+
+        // the same steps as the loop in main()
+        display();
+        glfwSwapBuffers(window);
+        scheduler.FrameRendered();
+        shaderVariants->CompilePending(2.0);
+        glfwPollEvents();
+        hzgl::UpdateScreenshots();
+
+        hzgl::ProfilerEndFrame();
+        hzgl::AllocationCount count = hzgl::EndAllocationFrame();
+
+        if (f < warmupFrames || count.allocations == 0)
+            continue;
+
+        // the scopes of the first offending frame are usually enough to find the culprit
+        if (failedFrames++ == 0)
+        {
+            std::cerr << "Frame " << f << ": " << count.allocations << " allocations (" << count.bytes << " bytes)" << std::endl;
+
+            const hzgl::ProfileFrame* frame = hzgl::ProfilerLastFrame();
+
+            for (size_t e = 0; frame != nullptr && e < frame->cpu_events.size(); e++)
+            {
+                const hzgl::ProfileEvent& event = frame->cpu_events[e];
+
+                if (event.allocations > 0)
+                    std::cerr << std::string(2 * (event.depth + 1), ' ') << event.name << ": " << event.allocations << std::endl;
+            }
+        }
+
+        allocations += count.allocations;
+    }
+
+    std::cout << options.allocCheck << " frames after " << warmupFrames << " warm-up frames: "
+              << failedFrames << " allocated (" << allocations << " allocations in total), arena peak "
+              << hzgl::GetFrameArena().Peak() << " bytes" << std::endl;
+
+    shutdown();
+
+    return failedFrames == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    hzgl::ProfilerSetThreadName("Main");
+    startupTimer.Start();
+
+    CommandLineOptions options;
+
+    if (!parseArguments(argc, argv, options))
         return -1;
+
+    occlusionCulling = options.occlusion;
+    sceneGrid = options.grid;
+    extraLights = options.lights;
+    deferredShading = options.deferred;
+    prepassMode = options.prepass;
+    shadowsEnabled = options.shadows;
+    environmentPath = options.environment;
+    parallelShaderCompile = options.parallelCompile;
+    renderOnDemand = !options.continuous;
+    turntable = options.turntable;
+
+    if (!options.preprocess.empty())
+    {
+        std::string output = options.preprocessOutput.empty() ? options.preprocess + ".hzchunks" : options.preprocessOutput;
+        hzgl::ChunkBuildStats stats;
+
+        if (!hzgl::BuildChunkedMesh(options.preprocess, output, options.chunkBuild, &stats))
+            return -1;
+
+        std::cout << output << ": " << stats.chunks << " chunks (at most " << stats.max_chunk_triangles << " triangles, "
+                  << stats.dense_cells << " dense cells split further) from " << stats.input_triangles << " triangles, "
+                  << stats.output_bytes / (1024.0 * 1024.0) << " MB in " << stats.total_ms << " ms (scan " << stats.scan_ms
+                  << ", scatter " << stats.scatter_ms << ", build " << stats.build_ms << "), peak RSS " << stats.peak_rss_mb << " MB"
+                  << (stats.streamed_input ? "" : " (input loaded in memory)") << std::endl;
+
+        if (stats.streamed_input && stats.peak_rss_mb > options.chunkBuild.memory_budget_mb)
+            std::cout << "Warning: peak RSS above the memory budget of " << options.chunkBuild.memory_budget_mb << " MB" << std::endl;
+
+        return 0;
+    }
+
+    if (!options.preprocessPoints.empty())
+    {
+        std::string output = options.preprocessOutput.empty() ? options.preprocessPoints + ".hzpoints" : options.preprocessOutput;
+        hzgl::PointBuildStats stats;
+
+        if (!hzgl::BuildPointOctree(options.preprocessPoints, output, options.pointBuild, &stats))
+            return -1;
+
+        std::cout << output << ": " << stats.nodes << " nodes (depth " << stats.max_depth << ", " << stats.chunks << " chunks) from "
+                  << stats.input_points << " points, " << stats.output_bytes / (1024.0 * 1024.0) << " MB in " << stats.total_ms
+                  << " ms (scan " << stats.scan_ms << ", scatter " << stats.scatter_ms << ", build " << stats.build_ms
+                  << "), peak RSS " << stats.peak_rss_mb << " MB" << std::endl;
+
+        return 0;
+    }
+
+    if (options.benchmark)
+    {
+        streamPath = options.stream;
+        streamingOptions = options.streaming;
+        pointsPath = options.points;
+        pointCloudOptions = options.pointCloud;
+
+        return runBenchmark(options);
     }
 
-    init();
+    if (!options.capture.empty())
+    {
+        // Y4M on stdout: everything that would be logged there (context creation, loaders) goes
+        // to stderr from here on
+        if (options.capture == "-")
+            std::cout.rdbuf(std::cerr.rdbuf());
+
+        return runCapture(options);
+    }
+
+    if (!options.batch.empty())
+        return runBatch(options);
+
+    hiresOptions.width = options.hiresWidth;
+    hiresOptions.height = options.hiresHeight;
+    hiresOptions.supersampling = options.supersampling;
+    hiresOptions.png.deflate_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    if (!options.hires.empty())
+        return runHiresScreenshot(options);
+
+    if (options.allocCheck > 0)
+        return runAllocationCheck(options);
+
+    if (!createWindow(true))
+        return -1;
+
+    // GPU markers need a current context
+    hzgl::ProfilerInitGPU();
+    utilization.Init();
+
+    // encode screenshots in the background, splitting large images across a few deflate threads
+    hzgl::ScreenshotOptions screenshotOptions;
+    screenshotOptions.png.deflate_threads = std::max(1u, std::min(4u, std::thread::hardware_concurrency()));
+    hzgl::SetScreenshotOptions(screenshotOptions);
+
+    streamPath = options.stream;
+    streamingOptions = options.streaming;
+    pointsPath = options.points;
+    pointCloudOptions = options.pointCloud;
+
+    init(streamPath.empty() && pointsPath.empty());
 
     // loop until the user closes the window
     while (!glfwWindowShouldClose(window))
     {
+        if (!scheduler.ShouldRender())
+        {
+            // nothing changed: warm up queued shader variants, then sleep until an event arrives,
+            // waking up now and then for the screenshots still being read back and encoded
+            if (shaderVariants->CompilePending(8.0) > 0)
+                glfwPollEvents();
+            else if (shaderVariants->Stats().pending > 0)
+                glfwWaitEventsTimeout(0.01);    // still building in the driver
+            else
+                glfwWaitEventsTimeout(0.25);
+
+            hzgl::UpdateScreenshots();
+            utilization.Update(scheduler.OnDemand());
+            continue;
+        }
+
+        hzgl::BeginAllocationFrame();
+        hzgl::GetFrameArena().Reset();
+        hzgl::ProfilerBeginFrame();
+        utilization.BeginFrame();
+
         display();
 
+        utilization.EndFrame();
+
         // swap front and back buffers
-        glfwSwapBuffers(window);
+        {
+            HZGL_PROFILE_SCOPE("SwapBuffers");
+            glfwSwapBuffers(window);
+        }
+
+        if (timeToFirstFrame < 0.0)
+        {
+            timeToFirstFrame = 1000.0 * startupTimer.Now();
+            std::cout << "Time to first frame: " << timeToFirstFrame << " ms (parallel shader compile "
+                      << (hzgl::ParallelShaderCompileEnabled() ? "on" : "off") << ")" << std::endl;
+        }
+
+        scheduler.FrameRendered();
+
+        // a few queued shader variants per frame, for when the scene never idles (turntable)
+        shaderVariants->CompilePending(2.0);
 
         // poll for and process events
-        glfwPollEvents();
+        {
+            HZGL_PROFILE_SCOPE("PollEvents");
+            glfwPollEvents();
+        }
+
+        hzgl::UpdateScreenshots();
+        hzgl::ProfilerEndFrame();
+        hzgl::EndAllocationFrame();
+        utilization.Update(scheduler.OnDemand());
+    }
+
+    // compare the cost of both modes over the whole session
+    for (bool onDemand : {false, true})
+    {
+        hzgl::UtilizationStats total = utilization.Total(onDemand);
+
+        if (total.wall_s > 0.0)
+        {
+            std::cout << (onDemand ? "On-demand" : "Continuous") << ": " << total.wall_s << " s, "
+                      << total.fps << " fps, CPU " << total.cpu_percent << "%, GPU " << total.gpu_percent << "%" << std::endl;
+        }
     }
 
-    glfwTerminate();
+    hzgl::ShutdownScreenshots();
+    utilization.Shutdown();
+    shutdown();
 
     return 0;
 }
@@ -237,6 +2177,8 @@ static void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     if (width == 0 || height == 0)
         return;
 
+    scheduler.MarkDirty(hzgl::HZGL_DIRTY_WINDOW);
+
     SCR_WIDTH = width;
     SCR_HEIGHT = height;
 
@@ -249,6 +2191,8 @@ static void key_callback(GLFWwindow* window, int key, int scancode, int action,
     int width, height;
     glfwGetFramebufferSize(window, &width, &height);
 
+    scheduler.MarkDirty(hzgl::HZGL_DIRTY_INPUT);
+
     if (action == GLFW_PRESS)
     {
         switch (key)
@@ -261,6 +2205,9 @@ static void key_callback(GLFWwindow* window, int key, int scancode, int action,
         case GLFW_KEY_PRINT_SCREEN:
             hzgl::TakeScreenshot(0, 0, width, height);
             break;
+        case GLFW_KEY_H:
+            hiresRequested = true;
+            break;
         default:
             break;
         }
@@ -0,0 +1,877 @@
+// Checks of the CPU-side parts that need neither a window nor an OpenGL context. ctest runs each
+// one on its own (hzgl_tests <name>); without arguments every check runs.
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <cstring>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+
+#include <glm/glm.hpp>
+
+#include "hzgl/IBL.hpp"
+#include "hzgl/Mesh.hpp"
+#include "hzgl/Handle.hpp"
+#include "hzgl/MappedMesh.hpp"
+#include "hzgl/Occlusion.hpp"
+#include "hzgl/Tangents.hpp"
+#include "hzgl/ThreadPool.hpp"
+#include "hzgl/Streaming.hpp"
+#include "hzgl/MappedFile.hpp"
+
+#define HZGL_CHECK(expr)                                                                    \
+    if (!(expr))                                                                            \
+    {                                                                                       \
+        fprintf(stderr, "[FAIL] %s (line %d): %s\n", __FILE__, __LINE__, #expr);            \
+        return false;                                                                       \
+    }
+
+typedef struct
+{
+    std::string name;
+    std::function<bool()> run;
+} TestCase;
+
+// the culler below is 64 x 32 pixels with an identity view-projection, so pixel coordinates map
+// straight to normalized device coordinates
+static const int OcclusionWidth = 64;
+static const int OcclusionHeight = 32;
+
+static glm::vec3 occlusionPoint(float px, float py, float depth)
+{
+    return glm::vec3(2.0f * px / OcclusionWidth - 1.0f, 2.0f * py / OcclusionHeight - 1.0f, 2.0f * depth - 1.0f);
+}
+
+// a box over the pixel rectangle [x0, x1] x [y0, y1] between two depths
+static hzgl::BoundingBox occlusionBox(float x0, float x1, float y0, float y1, float depth0, float depth1)
+{
+    hzgl::BoundingBox box;
+    box.min = occlusionPoint(x0, y0, depth0);
+    box.max = occlusionPoint(x1, y1, depth1);
+    return box;
+}
+
+// counter-clockwise triangles over pixel coordinates, the depth given per vertex
+static void addTriangle(hzgl::OccluderMesh& mesh, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+    unsigned first = static_cast<unsigned>(mesh.positions.size() / 3);
+
+    for (const glm::vec3& p : {a, b, c})
+    {
+        glm::vec3 q = occlusionPoint(p.x, p.y, p.z);
+        mesh.positions.insert(mesh.positions.end(), {q.x, q.y, q.z});
+    }
+
+    mesh.indices.insert(mesh.indices.end(), {first, first + 1, first + 2});
+}
+
+// two triangles sharing the diagonal (and its vertices); depth0 on the left side, depth1 on the right
+static hzgl::OccluderMesh occluderQuad(float x0, float x1, float y0, float y1, float depth0, float depth1)
+{
+    hzgl::OccluderMesh mesh;
+
+    for (const glm::vec3& p : {glm::vec3(x0, y0, depth0), glm::vec3(x1, y0, depth1), glm::vec3(x1, y1, depth1), glm::vec3(x0, y1, depth0)})
+    {
+        glm::vec3 q = occlusionPoint(p.x, p.y, p.z);
+        mesh.positions.insert(mesh.positions.end(), {q.x, q.y, q.z});
+    }
+
+    mesh.indices = {0, 1, 2, 0, 2, 3};
+    return mesh;
+}
+
+static bool occlusionVisible(const hzgl::OccluderMesh& occluder, const hzgl::BoundingBox& box, int numThreads)
+{
+    hzgl::OcclusionCuller culler(OcclusionWidth, OcclusionHeight, numThreads);
+
+    culler.BeginFrame(glm::mat4(1.0f));
+    culler.AddOccluder(occluder, glm::mat4(1.0f));
+    culler.RasterizeOccluders();
+
+    return culler.IsVisible(box, glm::mat4(1.0f));
+}
+
+// IsVisible never hides a box that is partly in front of the occluders or beside them, least of
+// all at their silhouettes where pixels are only partly covered
+static bool testOcclusion()
+{
+    for (int numThreads : {0, 2})
+    {
+        // a full-screen wall at depth 0.5
+        hzgl::OccluderMesh wall = occluderQuad(0.0f, 64.0f, 0.0f, 32.0f, 0.5f, 0.5f);
+
+        HZGL_CHECK(!occlusionVisible(wall, occlusionBox(20.0f, 40.0f, 10.0f, 20.0f, 0.7f, 0.9f), numThreads));
+        HZGL_CHECK(occlusionVisible(wall, occlusionBox(20.0f, 40.0f, 10.0f, 20.0f, 0.2f, 0.3f), numThreads));
+        HZGL_CHECK(occlusionVisible(wall, occlusionBox(20.0f, 40.0f, 10.0f, 20.0f, 0.4f, 0.6f), numThreads));
+
+        // its shared diagonal does not open a gap
+        HZGL_CHECK(!occlusionVisible(wall, occlusionBox(30.2f, 33.8f, 14.2f, 17.8f, 0.7f, 0.9f), numThreads));
+
+        // a vertical silhouette edge at x = 40.7: pixel 40 has its center covered, but not its right
+        // part, where the box is
+        hzgl::OccluderMesh left = occluderQuad(0.0f, 40.7f, 0.0f, 32.0f, 0.5f, 0.5f);
+
+        HZGL_CHECK(occlusionVisible(left, occlusionBox(40.75f, 40.95f, 10.0f, 20.0f, 0.7f, 0.9f), numThreads));
+        HZGL_CHECK(!occlusionVisible(left, occlusionBox(20.0f, 39.9f, 10.0f, 20.0f, 0.7f, 0.9f), numThreads));
+
+        // the same with a horizontal one at y = 20.6
+        hzgl::OccluderMesh bottom = occluderQuad(0.0f, 64.0f, 0.0f, 20.6f, 0.5f, 0.5f);
+
+        HZGL_CHECK(occlusionVisible(bottom, occlusionBox(10.0f, 30.0f, 20.7f, 20.9f, 0.7f, 0.9f), numThreads));
+        HZGL_CHECK(!occlusionVisible(bottom, occlusionBox(10.0f, 30.0f, 5.0f, 19.9f, 0.7f, 0.9f), numThreads));
+
+        // a diagonal one, x / 64 + y / 32 = 1: the center of pixel (40, 11) is inside, the corner
+        // of that pixel the box is in is not
+        hzgl::OccluderMesh corner;
+        addTriangle(corner, glm::vec3(0.0f, 0.0f, 0.5f), glm::vec3(64.0f, 0.0f, 0.5f), glm::vec3(0.0f, 32.0f, 0.5f));
+
+        HZGL_CHECK(occlusionVisible(corner, occlusionBox(40.9f, 40.99f, 11.9f, 11.99f, 0.7f, 0.9f), numThreads));
+        HZGL_CHECK(!occlusionVisible(corner, occlusionBox(5.0f, 20.0f, 5.0f, 10.0f, 0.7f, 0.9f), numThreads));
+
+        // a wall sloping away to the right (depth x / 64): in pixel 10 the box is behind the wall
+        // at the pixel center but in front of it at the right end of the pixel
+        hzgl::OccluderMesh slope = occluderQuad(0.0f, 64.0f, 0.0f, 32.0f, 0.0f, 1.0f);
+
+        HZGL_CHECK(occlusionVisible(slope, occlusionBox(10.6f, 10.9f, 10.0f, 11.0f, 0.168f, 0.2f), numThreads));
+        HZGL_CHECK(!occlusionVisible(slope, occlusionBox(10.6f, 10.9f, 10.0f, 11.0f, 0.5f, 0.6f), numThreads));
+
+        // nothing to hide behind
+        HZGL_CHECK(occlusionVisible(hzgl::OccluderMesh(), occlusionBox(20.0f, 40.0f, 10.0f, 20.0f, 0.7f, 0.9f), numThreads));
+
+        // outside the frustum
+        HZGL_CHECK(!occlusionVisible(hzgl::OccluderMesh(), occlusionBox(70.0f, 80.0f, 10.0f, 20.0f, 0.7f, 0.9f), numThreads));
+    }
+
+    return true;
+}
+
+// a binary little-endian PLY of n x n quads (faces of four corners) over [0, 1] x [0, 1] at z = 0,
+// with one more vertex no face uses at (100, 100, 100)
+static bool writeQuadGrid(const std::string& filepath, int n)
+{
+    FILE* fp = fopen(filepath.c_str(), "wb");
+    if (fp == nullptr)
+        return false;
+
+    fprintf(fp, "ply\nformat binary_little_endian 1.0\nelement vertex %d\nproperty float x\nproperty float y\nproperty float z\n"
+                "element face %d\nproperty list uchar int vertex_indices\nend_header\n", (n + 1) * (n + 1) + 1, n * n);
+
+    for (int y = 0; y <= n; y++)
+        for (int x = 0; x <= n; x++)
+        {
+            float p[3] = {static_cast<float>(x) / n, static_cast<float>(y) / n, 0.0f};
+            fwrite(p, sizeof(p), 1, fp);
+        }
+
+    float far[3] = {100.0f, 100.0f, 100.0f};
+    fwrite(far, sizeof(far), 1, fp);
+
+    for (int y = 0; y < n; y++)
+        for (int x = 0; x < n; x++)
+        {
+            uint8_t count = 4;
+            int32_t corners[4] = {y * (n + 1) + x, y * (n + 1) + x + 1, (y + 1) * (n + 1) + x + 1, (y + 1) * (n + 1) + x};
+            fwrite(&count, 1, 1, fp);
+            fwrite(corners, sizeof(corners), 1, fp);
+        }
+
+    return fclose(fp) == 0;
+}
+
+// a mesh through BuildChunkedMesh and back: the far vertex leaves the whole grid in one cell of
+// the coarse grid, so it is split on the fine grid and in file order, and no chunk may be larger
+// than asked for. Level 0 has to hold every triangle, with its area, at its place
+static bool testStreaming()
+{
+    const int n = 64;
+    const std::string input = "hzgl_tests_grid.ply";
+    const std::string output = "hzgl_tests_grid.hzchunks";
+
+    HZGL_CHECK(writeQuadGrid(input, n));
+
+    hzgl::ChunkBuildOptions options;
+    options.triangles_per_chunk = 256;
+    options.levels = 3;
+    options.memory_budget_mb = 16;
+    options.threads = 2;
+
+    hzgl::ChunkBuildStats stats;
+    bool built = hzgl::BuildChunkedMesh(input, output, options, &stats);
+    std::remove(input.c_str());
+
+    HZGL_CHECK(built);
+    HZGL_CHECK(stats.streamed_input);
+    HZGL_CHECK(stats.input_triangles == 2 * n * n);
+    HZGL_CHECK(stats.dense_cells == 1);
+    HZGL_CHECK(stats.max_chunk_triangles <= options.triangles_per_chunk);
+    HZGL_CHECK(stats.chunks >= 2 * n * n / options.triangles_per_chunk);
+
+    hzgl::MappedFile file;
+    HZGL_CHECK(file.Open(output));
+
+    hzgl::ChunkFileHeader header;
+    HZGL_CHECK(file.Size() >= sizeof(header));
+    memcpy(&header, file.Data(), sizeof(header));
+
+    HZGL_CHECK(memcmp(header.magic, "HZCHUNK1", 8) == 0);
+    HZGL_CHECK(header.num_chunks == static_cast<uint32_t>(stats.chunks));
+    HZGL_CHECK(header.num_levels == static_cast<uint32_t>(options.levels));
+    HZGL_CHECK(header.num_triangles == static_cast<uint64_t>(2 * n * n));
+    HZGL_CHECK(header.bounds_max[0] == 100.0f && header.bounds_min[0] == 0.0f);
+    HZGL_CHECK(file.Size() >= sizeof(header) + header.num_chunks * sizeof(hzgl::ChunkRecord));
+
+    std::vector<hzgl::ChunkRecord> records(header.num_chunks);
+    memcpy(records.data(), file.Data() + sizeof(header), records.size() * sizeof(hzgl::ChunkRecord));
+
+    uint64_t triangles = 0;
+    double area = 0.0;
+
+    for (const auto& record : records)
+    {
+        for (uint32_t l = 0; l < header.num_levels; l++)
+        {
+            const hzgl::ChunkLevel& level = record.levels[l];
+
+            HZGL_CHECK(level.offset % 4096 == 0);
+            HZGL_CHECK(level.index_size == 2 || level.index_size == 4);
+            HZGL_CHECK(level.num_indices % 3 == 0);
+            HZGL_CHECK(level.offset + level.num_vertices * sizeof(hzgl::ChunkVertex) + level.num_indices * level.index_size <= file.Size());
+            HZGL_CHECK(l == 0 ? level.error == 0.0f : level.error >= record.levels[l - 1].error);
+
+            const uint8_t* vertices = file.Data() + level.offset;
+            const uint8_t* indices = vertices + level.num_vertices * sizeof(hzgl::ChunkVertex);
+            std::vector<glm::vec3> positions(level.num_vertices);
+
+            for (uint32_t v = 0; v < level.num_vertices; v++)
+            {
+                hzgl::ChunkVertex vertex;
+                memcpy(&vertex, vertices + v * sizeof(vertex), sizeof(vertex));
+                positions[v] = glm::vec3(vertex.position[0], vertex.position[1], vertex.position[2]);
+
+                // every level stays within the bounds of the chunk, and the finest one faces +z
+                for (int k = 0; k < 3; k++)
+                    HZGL_CHECK(positions[v][k] >= record.bounds_min[k] && positions[v][k] <= record.bounds_max[k]);
+
+                HZGL_CHECK(l > 0 || vertex.normal[2] == 32767);
+            }
+
+            for (uint32_t i = 0; i + 2 < level.num_indices; i += 3)
+            {
+                uint32_t corner[3];
+
+                for (int k = 0; k < 3; k++)
+                {
+                    uint16_t small = 0;
+                    if (level.index_size == 2)
+                        memcpy(&small, indices + (i + k) * 2, 2);
+                    else
+                        memcpy(&corner[k], indices + (i + k) * 4, 4);
+
+                    corner[k] = (level.index_size == 2) ? small : corner[k];
+                    HZGL_CHECK(corner[k] < level.num_vertices);
+                }
+
+                if (l == 0)
+                    area += 0.5 * glm::length(glm::cross(positions[corner[1]] - positions[corner[0]], positions[corner[2]] - positions[corner[0]]));
+            }
+
+            if (l == 0)
+                triangles += level.num_indices / 3;
+        }
+    }
+
+    file.Close();
+    std::remove(output.c_str());
+
+    HZGL_CHECK(triangles == static_cast<uint64_t>(2 * n * n));
+    HZGL_CHECK(std::abs(area - 1.0) < 1e-3);
+
+    return true;
+}
+
+static float cornerAngle(const glm::vec3& a, const glm::vec3& b)
+{
+    return std::acos(std::min(std::max(glm::dot(glm::normalize(a), glm::normalize(b)), -1.0f), 1.0f));
+}
+
+// the frames of a welded mesh, the slow way: angle-weighted face normals, and per corner dP/du of
+// the face projected on the vertex normal, weighted by the angle of the projected edges (as in
+// EvalTspace of MikkTSpace)
+static void referenceFrames(const hzgl::MeshInfo& mesh, std::vector<glm::vec3>& normals, std::vector<glm::vec3>& tangents, std::vector<float>& signs)
+{
+    size_t numVertices = mesh.positions.size() / 3;
+    normals.assign(numVertices, glm::vec3(0.0f));
+    tangents.assign(numVertices, glm::vec3(0.0f));
+    signs.assign(numVertices, 0.0f);
+
+    auto position = [&mesh](unsigned i) { return glm::vec3(mesh.positions[3 * i], mesh.positions[3 * i + 1], mesh.positions[3 * i + 2]); };
+    auto texcoord = [&mesh](unsigned i) { return glm::vec2(mesh.texcoords[2 * i], mesh.texcoords[2 * i + 1]); };
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (size_t f = 0; f + 2 < mesh.indices.size(); f += 3)
+        {
+            const unsigned* idx = &mesh.indices[f];
+            glm::vec3 p[3] = {position(idx[0]), position(idx[1]), position(idx[2])};
+            glm::vec2 t[3] = {texcoord(idx[0]), texcoord(idx[1]), texcoord(idx[2])};
+
+            glm::vec3 d1 = p[1] - p[0], d2 = p[2] - p[0];
+            glm::vec2 t21 = t[1] - t[0], t31 = t[2] - t[0];
+            float area = t21.x * t31.y - t21.y * t31.x;
+            glm::vec3 dPdu = glm::normalize((t31.y * d1 - t21.y * d2) / area);
+
+            for (int k = 0; k < 3; k++)
+            {
+                glm::vec3 e1 = p[(k + 1) % 3] - p[k];
+                glm::vec3 e2 = p[(k + 2) % 3] - p[k];
+
+                if (pass == 0)
+                {
+                    normals[idx[k]] += cornerAngle(e1, e2) * glm::normalize(glm::cross(d1, d2));
+                    continue;
+                }
+
+                glm::vec3 n = normals[idx[k]];
+                e1 -= glm::dot(e1, n) * n;
+                e2 -= glm::dot(e2, n) * n;
+
+                tangents[idx[k]] += cornerAngle(e1, e2) * glm::normalize(dPdu - glm::dot(dPdu, n) * n);
+                signs[idx[k]] = (area < 0.0f) ? -1.0f : 1.0f;
+            }
+        }
+
+        for (size_t v = 0; pass == 0 && v < numVertices; v++)
+            normals[v] = glm::normalize(normals[v]);
+    }
+
+    for (size_t v = 0; v < numVertices; v++)
+        tangents[v] = glm::normalize(tangents[v] - glm::dot(tangents[v], normals[v]) * normals[v]);
+}
+
+static bool closeTo(const glm::vec3& a, const glm::vec3& b, float tolerance)
+{
+    return glm::length(a - b) <= tolerance;
+}
+
+// generated frames against referenceFrames on a jittered height field with a curved (but nowhere
+// mirrored) UV mapping, on the calling thread and on a pool; then a strip mirrored in u halfway,
+// which has to split the vertices on the mirror line, and the QTangent round trip
+static bool testTangents()
+{
+    const int n = 24;
+
+    hzgl::MeshInfo field;
+
+    for (int z = 0; z <= n; z++)
+        for (int x = 0; x <= n; x++)
+        {
+            // a fixed jitter of up to a third of a cell, away from the border
+            bool inner = (x > 0 && x < n && z > 0 && z < n);
+            float jx = inner ? 0.3f * std::sin(12.9898f * x + 78.233f * z) / n : 0.0f;
+            float jz = inner ? 0.3f * std::cos(39.3468f * x + 11.135f * z) / n : 0.0f;
+            float px = static_cast<float>(x) / n + jx;
+            float pz = static_cast<float>(z) / n + jz;
+
+            field.positions.insert(field.positions.end(), {px, 0.1f * std::sin(3.0f * px) * std::cos(2.0f * pz), pz});
+            field.texcoords.insert(field.texcoords.end(), {px + 0.2f * pz * pz, 1.3f * pz + 0.1f * std::sin(4.0f * px)});
+        }
+
+    for (int z = 0; z < n; z++)
+        for (int x = 0; x < n; x++)
+        {
+            unsigned i00 = z * (n + 1) + x, i10 = i00 + 1, i01 = i00 + (n + 1), i11 = i01 + 1;
+            field.indices.insert(field.indices.end(), {i00, i01, i10, i10, i01, i11});
+        }
+
+    field.num_vertices = (n + 1) * (n + 1);
+
+    std::vector<glm::vec3> normals, tangents;
+    std::vector<float> signs;
+    referenceFrames(field, normals, tangents, signs);
+
+    hzgl::ThreadPool pool(3, 0, "Tangents");
+
+    for (hzgl::ThreadPool* workers : {static_cast<hzgl::ThreadPool*>(nullptr), &pool})
+    {
+        hzgl::MeshInfo mesh = field;
+        hzgl::GenerateTangentFrames(mesh, hzgl::TangentFrameOptions(), workers);
+
+        // nothing to split: the same vertices, in the order of their first corner
+        HZGL_CHECK(mesh.num_vertices == field.num_vertices);
+        HZGL_CHECK(mesh.indices.size() == field.indices.size());
+        HZGL_CHECK(mesh.qtangents.size() == 4 * static_cast<size_t>(mesh.num_vertices));
+
+        std::vector<int> original(mesh.num_vertices, -1);
+
+        for (size_t c = 0; c < mesh.indices.size(); c++)
+        {
+            int& o = original[mesh.indices[c]];
+            HZGL_CHECK(o == -1 || o == static_cast<int>(field.indices[c]));
+            o = static_cast<int>(field.indices[c]);
+        }
+
+        for (int v = 0; v < mesh.num_vertices; v++)
+        {
+            int o = original[v];
+            HZGL_CHECK(o >= 0 && mesh.positions[3 * v] == field.positions[3 * o] && mesh.positions[3 * v + 2] == field.positions[3 * o + 2]);
+
+            glm::vec3 normal, tangent;
+            float sign;
+            hzgl::DecodeQTangent(&mesh.qtangents[4 * v], &normal, &tangent, &sign);
+
+            glm::vec3 stored(mesh.normals[3 * v], mesh.normals[3 * v + 1], mesh.normals[3 * v + 2]);
+
+            // the shaders take the normal from the QTangent alone
+            HZGL_CHECK(closeTo(stored, normals[o], 1e-4f));
+            HZGL_CHECK(closeTo(normal, normals[o], 1e-3f));
+            HZGL_CHECK(closeTo(tangent, tangents[o], 1e-3f));
+            HZGL_CHECK(sign == signs[o]);
+        }
+    }
+
+    // two quads side by side, u = x on the left and 2 - x on the right: the two vertices on x = 1
+    // have the same position, normal and UV on both sides, but not the same handedness
+    hzgl::MeshInfo strip;
+    strip.positions = {0, 0, 0, 1, 0, 0, 2, 0, 0, 0, 0, 1, 1, 0, 1, 2, 0, 1};
+    strip.texcoords = {0, 0, 1, 0, 0, 0, 0, 1, 1, 1, 0, 1};
+    strip.indices = {0, 3, 1, 1, 3, 4, 1, 4, 2, 2, 4, 5};
+    strip.num_vertices = 6;
+
+    hzgl::GenerateTangentFrames(strip);
+    HZGL_CHECK(strip.num_vertices == 8);
+
+    int mirrored = 0;
+
+    for (int v = 0; v < strip.num_vertices; v++)
+    {
+        glm::vec3 normal, tangent;
+        float sign;
+        hzgl::DecodeQTangent(&strip.qtangents[4 * v], &normal, &tangent, &sign);
+
+        // dP/du is +x on the left and -x on the right
+        bool right = (strip.positions[3 * v] > 1.0f) || (strip.positions[3 * v] == 1.0f && tangent.x < 0.0f);
+        HZGL_CHECK(closeTo(normal, glm::vec3(0.0f, 1.0f, 0.0f), 1e-3f));
+        HZGL_CHECK(closeTo(tangent, glm::vec3(right ? -1.0f : 1.0f, 0.0f, 0.0f), 1e-3f));
+
+        HZGL_CHECK((sign > 0.0f) == right);
+
+        mirrored += right ? 1 : 0;
+    }
+
+    HZGL_CHECK(mirrored == 4);
+
+    // w = 0 (half turns) in both handednesses included
+    const glm::vec3 frames[][2] = {
+        {glm::vec3(0, 0, 1), glm::vec3(1, 0, 0)},
+        {glm::vec3(0, 0, -1), glm::vec3(1, 0, 0)},
+        {glm::normalize(glm::vec3(1, 2, 3)), glm::normalize(glm::vec3(3, 0, -1))},
+        {glm::normalize(glm::vec3(-1, -1, 0.1f)), glm::normalize(glm::vec3(0.5f, -0.5f, 1))},
+    };
+
+    for (const auto& frame : frames)
+    {
+        for (float sign : {1.0f, -1.0f})
+        {
+            int16_t q[4];
+            hzgl::EncodeQTangent(frame[0], frame[1], sign, q);
+
+            glm::vec3 normal, tangent;
+            float decoded;
+            hzgl::DecodeQTangent(q, &normal, &tangent, &decoded);
+
+            HZGL_CHECK(closeTo(normal, frame[0], 1e-3f));
+            HZGL_CHECK(closeTo(tangent, glm::normalize(frame[1] - glm::dot(frame[1], frame[0]) * frame[0]), 1e-3f));
+            HZGL_CHECK(decoded == sign);
+        }
+    }
+
+    return true;
+}
+
+// a binary PLY of the given polygons (float positions, int indices behind a uchar count) in
+// either byte order, without its last cut bytes
+static bool writePolygonPly(const std::string& filepath, const std::vector<float>& positions, const std::vector<std::vector<int>>& faces,
+                            bool bigEndian, size_t cut = 0)
+{
+    char header[256];
+    snprintf(header, sizeof(header), "ply\nformat %s 1.0\nelement vertex %d\nproperty float x\nproperty float y\nproperty float z\n"
+             "element face %d\nproperty list uchar int vertex_indices\nend_header\n", bigEndian ? "binary_big_endian" : "binary_little_endian",
+             static_cast<int>(positions.size() / 3), static_cast<int>(faces.size()));
+
+    std::vector<uint8_t> bytes(header, header + strlen(header));
+
+    auto append = [&bytes, bigEndian](const void* value, size_t size) {
+        const uint8_t* p = static_cast<const uint8_t*>(value);
+        for (size_t i = 0; i < size; i++)
+            bytes.push_back(p[bigEndian ? size - 1 - i : i]);
+    };
+
+    for (float p : positions)
+        append(&p, sizeof(p));
+
+    for (const auto& face : faces)
+    {
+        uint8_t count = static_cast<uint8_t>(face.size());
+        append(&count, 1);
+
+        for (int32_t corner : face)
+            append(&corner, sizeof(corner));
+    }
+
+    FILE* fp = fopen(filepath.c_str(), "wb");
+    if (fp == nullptr)
+        return false;
+
+    fwrite(bytes.data(), 1, bytes.size() - std::min(cut, bytes.size()), fp);
+
+    return fclose(fp) == 0;
+}
+
+static bool writeText(const std::string& filepath, const char* text)
+{
+    FILE* fp = fopen(filepath.c_str(), "wb");
+    if (fp == nullptr)
+        return false;
+
+    fputs(text, fp);
+
+    return fclose(fp) == 0;
+}
+
+// the mapped PLY and STL readers on small files: mixed polygons are fanned in both byte orders
+// and on a pool, truncated files are refused, ASCII files are left to Assimp, which
+// LoadMeshesFromFile then reads
+static bool testMeshReaders()
+{
+    const std::string ply = "hzgl_tests_reader.ply";
+    const std::string stl = "hzgl_tests_reader.stl";
+
+    const std::vector<float> positions = {0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, -1, 1, 0, -1, 0, 0, -1, -1, 0};
+    const std::vector<std::vector<int>> polygons = {{0, 1, 2}, {0, 2, 3, 4}, {0, 4, 5, 6, 1}};
+    const std::vector<unsigned> fanned = {0, 1, 2, 0, 2, 3, 0, 3, 4, 0, 4, 5, 0, 5, 6, 0, 6, 1};
+    const std::vector<std::vector<int>> triangles = {{0, 1, 2}, {0, 2, 3}, {6, 1, 0}};
+
+    hzgl::ThreadPool pool(2, 0, "Mesh");
+
+    for (bool bigEndian : {false, true})
+    {
+        for (hzgl::ThreadPool* workers : {static_cast<hzgl::ThreadPool*>(nullptr), &pool})
+        {
+            hzgl::MeshInfo mesh;
+            hzgl::MeshReadStats stats;
+
+            HZGL_CHECK(writePolygonPly(ply, positions, polygons, bigEndian));
+            HZGL_CHECK(hzgl::ReadPlyMesh(ply, mesh, workers, &stats));
+            HZGL_CHECK(mesh.positions == positions);
+            HZGL_CHECK(mesh.indices == fanned);
+            HZGL_CHECK(mesh.num_vertices == 7);
+            HZGL_CHECK(!stats.triangles_only && stats.triangles == 6);
+            HZGL_CHECK(stats.byte_swapped == bigEndian);
+
+            // triangles only: the parallel path
+            HZGL_CHECK(writePolygonPly(ply, positions, triangles, bigEndian));
+            HZGL_CHECK(hzgl::ReadPlyMesh(ply, mesh, workers, &stats));
+            HZGL_CHECK(mesh.indices == std::vector<unsigned>({0, 1, 2, 0, 2, 3, 6, 1, 0}));
+            HZGL_CHECK(stats.triangles_only);
+        }
+
+        // the last index cut in half, in the polygon and in the triangle layout
+        for (const auto* faces : {&polygons, &triangles})
+        {
+            hzgl::MeshInfo mesh;
+
+            HZGL_CHECK(writePolygonPly(ply, positions, *faces, bigEndian, 2));
+            HZGL_CHECK(!hzgl::ReadPlyMesh(ply, mesh));
+            HZGL_CHECK(mesh.indices.empty());
+        }
+
+        // an index past the vertices
+        hzgl::MeshInfo mesh;
+        HZGL_CHECK(writePolygonPly(ply, positions, {{0, 1, 7}}, bigEndian));
+        HZGL_CHECK(!hzgl::ReadPlyMesh(ply, mesh));
+    }
+
+    // binary STL of two triangles, then the same without its last bytes
+    {
+        std::vector<uint8_t> bytes(84, 0);
+        uint32_t count = 2;
+        memcpy(&bytes[80], &count, sizeof(count));
+
+        const float corners[2][9] = {{0, 0, 0, 1, 0, 0, 1, 1, 0}, {0, 0, 0, 1, 1, 0, 0, 1, 0}};
+
+        for (const auto& triangle : corners)
+        {
+            float record[12] = {0, 0, 1};
+            memcpy(&record[3], triangle, sizeof(triangle));
+
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(record);
+            bytes.insert(bytes.end(), p, p + sizeof(record));
+            bytes.insert(bytes.end(), {0, 0});
+        }
+
+        for (size_t cut : {0, 10})
+        {
+            FILE* fp = fopen(stl.c_str(), "wb");
+            HZGL_CHECK(fp != nullptr);
+            fwrite(bytes.data(), 1, bytes.size() - cut, fp);
+            HZGL_CHECK(fclose(fp) == 0);
+
+            hzgl::MeshInfo mesh;
+            bool read = hzgl::ReadStlMesh(stl, mesh);
+
+            // the shared corners are welded
+            HZGL_CHECK(read == (cut == 0));
+            HZGL_CHECK(cut != 0 || (mesh.num_vertices == 4 && mesh.indices.size() == 6));
+        }
+    }
+
+    // ASCII: refused by the mapped readers, read by Assimp
+    HZGL_CHECK(writeText(ply, "ply\nformat ascii 1.0\nelement vertex 4\nproperty float x\nproperty float y\nproperty float z\n"
+                              "element face 1\nproperty list uchar int vertex_indices\nend_header\n"
+                              "0 0 0\n1 0 0\n1 1 0\n0 1 0\n4 0 1 2 3\n"));
+    HZGL_CHECK(writeText(stl, "solid quad\nfacet normal 0 0 1\nouter loop\nvertex 0 0 0\nvertex 1 0 0\nvertex 1 1 0\nendloop\nendfacet\n"
+                              "facet normal 0 0 1\nouter loop\nvertex 0 0 0\nvertex 1 1 0\nvertex 0 1 0\nendloop\nendfacet\nendsolid quad\n"));
+
+    for (const std::string& filepath : {ply, stl})
+    {
+        hzgl::MeshInfo direct;
+        HZGL_CHECK(!(filepath == ply ? hzgl::ReadPlyMesh(filepath, direct) : hzgl::ReadStlMesh(filepath, direct)));
+
+        std::vector<hzgl::MeshInfo> meshes;
+        hzgl::LoadMeshesFromFile(filepath, meshes);
+
+        HZGL_CHECK(meshes.size() == 1);
+        HZGL_CHECK(meshes[0].indices.size() == 6 && meshes[0].num_vertices == 4);
+    }
+
+    std::remove(ply.c_str());
+    std::remove(stl.c_str());
+
+    return true;
+}
+
+// longitude along x, the first row looks straight up (the layout of hzgl::HDRImage)
+static glm::vec3 environmentDirection(int x, int y, int width, int height)
+{
+    const float pi = 3.14159265f;
+    float phi = 2.0f * pi * (x + 0.5f) / width - pi;
+    float theta = pi * (y + 0.5f) / height;
+
+    return glm::vec3(std::sin(theta) * std::sin(phi), std::cos(theta), -std::sin(theta) * std::cos(phi));
+}
+
+static void environmentImage(int width, const std::function<float(const glm::vec3&)>& f, hzgl::HDRImage& image)
+{
+    image.width = width;
+    image.height = width / 2;
+    image.pixels.resize(3 * static_cast<size_t>(image.width) * image.height);
+
+    for (int y = 0; y < image.height; y++)
+    {
+        for (int x = 0; x < image.width; x++)
+        {
+            float value = f(environmentDirection(x, y, image.width, image.height));
+            float* p = &image.pixels[3 * (static_cast<size_t>(y) * image.width + x)];
+            p[0] = p[1] = p[2] = value;
+        }
+    }
+}
+
+// average over the row whose direction is closest to the given angle from +y
+static float rowAverage(const hzgl::HDRImage& image, float theta)
+{
+    int y = glm::clamp(static_cast<int>(theta / 3.14159265f * image.height), 0, image.height - 1);
+
+    float sum = 0.0f;
+    for (int x = 0; x < image.width; x++)
+        sum += image.pixels[3 * (static_cast<size_t>(y) * image.width + x)];
+
+    return sum / image.width;
+}
+
+static bool testIBL()
+{
+    hzgl::ThreadPool pool(3, 0, "Test");
+    hzgl::HDRImage image;
+    glm::vec3 sh[9];
+
+    // each band 2 function is an eigenfunction of the cosine convolution: the irradiance / pi is
+    // the function scaled by 1/4, and every other coefficient stays zero
+    typedef struct
+    {
+        int index;
+        std::function<float(const glm::vec3&)> f;
+    } BandTwo;
+
+    const std::vector<BandTwo> bandTwo = {
+        {4, [](const glm::vec3& d) { return d.x * d.y; }},
+        {5, [](const glm::vec3& d) { return d.y * d.z; }},
+        {6, [](const glm::vec3& d) { return 3.0f * d.z * d.z - 1.0f; }},
+        {7, [](const glm::vec3& d) { return d.x * d.z; }},
+        {8, [](const glm::vec3& d) { return d.x * d.x - d.y * d.y; }},
+    };
+
+    const std::vector<glm::vec3> normals = {
+        glm::vec3(0, 1, 0), glm::vec3(0, -1, 0), glm::vec3(1, 0, 0), glm::vec3(0, 0, -1),
+        glm::normalize(glm::vec3(1, 1, 1)), glm::normalize(glm::vec3(-1, 2, 0.5f)), glm::normalize(glm::vec3(0.3f, -0.2f, 1)),
+    };
+
+    for (const auto& band : bandTwo)
+    {
+        environmentImage(256, band.f, image);
+        hzgl::ProjectIrradianceSH9(image, sh, &pool);
+
+        for (int k = 0; k < 9; k++)
+        {
+            if (k != band.index)
+                HZGL_CHECK(closeTo(sh[k], glm::vec3(0.0f), 1e-3f));
+        }
+
+        for (const auto& n : normals)
+            HZGL_CHECK(closeTo(hzgl::EvaluateIrradianceSH9(sh, n), glm::vec3(0.25f * band.f(n)), 5e-3f));
+    }
+
+    // a bright cap of 10 degrees around +y: the mirror level keeps it sharp, the rough ones fall
+    // off away from it, and every level is dimmer at the cap and brighter around it than the last
+    environmentImage(256, [](const glm::vec3& d) { return (d.y > std::cos(glm::radians(10.0f))) ? 1.0f : 0.0f; }, image);
+
+    hzgl::IBLOptions options;
+    options.base_width = 128;
+    options.levels = 3;
+    options.samples = 256;
+
+    std::vector<hzgl::HDRImage> levels;
+    hzgl::PrefilterGGX(image, options, &levels, &pool);
+
+    HZGL_CHECK(levels.size() == 3);
+    HZGL_CHECK(rowAverage(levels[0], 0.0f) > 0.9f);
+    HZGL_CHECK(rowAverage(levels[0], glm::radians(45.0f)) < 1e-3f);
+
+    for (size_t k = 1; k < levels.size(); k++)
+    {
+        for (int angle = 15; angle <= 90; angle += 15)
+            HZGL_CHECK(rowAverage(levels[k], glm::radians(static_cast<float>(angle))) < rowAverage(levels[k], glm::radians(angle - 15.0f)));
+
+        HZGL_CHECK(rowAverage(levels[k], 0.0f) < rowAverage(levels[k - 1], 0.0f));
+        HZGL_CHECK(rowAverage(levels[k], glm::radians(45.0f)) > rowAverage(levels[k - 1], glm::radians(45.0f)));
+    }
+
+    // the lobe never reaches behind the normal
+    for (const auto& level : levels)
+        HZGL_CHECK(rowAverage(level, glm::radians(150.0f)) < 1e-3f);
+
+    // the levels are one mip chain: small maps stop at 1x1 instead of repeating a size
+    options.base_width = 8;
+    options.levels = 6;
+    hzgl::PrefilterGGX(image, options, &levels, &pool);
+
+    HZGL_CHECK(levels.size() == 4);
+    for (size_t k = 0; k < levels.size(); k++)
+    {
+        HZGL_CHECK(levels[k].width == std::max(8 >> k, 1));
+        HZGL_CHECK(levels[k].height == std::max(4 >> k, 1));
+        HZGL_CHECK(levels[k].pixels.size() == 3 * static_cast<size_t>(levels[k].width) * levels[k].height);
+    }
+
+    return true;
+}
+
+static bool testHandles()
+{
+    hzgl::HandlePool<std::string, hzgl::MeshTag> pool;
+
+    HZGL_CHECK(!hzgl::MeshHandle().IsValid());
+    HZGL_CHECK(pool.Get(hzgl::MeshHandle()) == nullptr);
+
+    hzgl::MeshHandle a = pool.Insert("a");
+    hzgl::MeshHandle b = pool.Insert("b");
+    hzgl::MeshHandle c = pool.Insert("c");
+
+    HZGL_CHECK(a.IsValid() && b.IsValid() && c.IsValid());
+    HZGL_CHECK(*pool.Get(a) == "a" && *pool.Get(b) == "b" && *pool.Get(c) == "c");
+
+    // the last item moves into the gap, the handles of the others still find theirs
+    std::string removed;
+    HZGL_CHECK(pool.Remove(b, &removed) && removed == "b");
+    HZGL_CHECK(pool.Size() == 2);
+    HZGL_CHECK(pool.Get(b) == nullptr && !pool.Contains(b));
+    HZGL_CHECK(*pool.Get(a) == "a" && *pool.Get(c) == "c");
+    HZGL_CHECK(!pool.Remove(b));
+
+    for (size_t i = 0; i < pool.Size(); i++)
+        HZGL_CHECK(*pool.Get(pool.HandleAt(i)) == pool.At(i));
+
+    // the freed slot is reused under a new generation: the stale handle stays turned away
+    hzgl::MeshHandle d = pool.Insert("d");
+    HZGL_CHECK(d.index == b.index && d.generation != b.generation);
+    HZGL_CHECK(pool.Get(b) == nullptr && *pool.Get(d) == "d");
+
+    // a handle with a slot that was never handed out
+    hzgl::MeshHandle unknown;
+    unknown.index = 1000;
+    unknown.generation = 1;
+    HZGL_CHECK(pool.Get(unknown) == nullptr && !pool.Remove(unknown));
+
+    // the oldest free slot is reused first
+    HZGL_CHECK(pool.Remove(a) && pool.Remove(c));
+    HZGL_CHECK(pool.Insert("e").index == a.index);
+    HZGL_CHECK(pool.Insert("f").index == c.index);
+
+    // clearing invalidates everything given out, also once the slots are filled again
+    std::vector<hzgl::MeshHandle> before = {d, pool.HandleAt(1), pool.HandleAt(2)};
+    pool.Clear();
+    HZGL_CHECK(pool.Size() == 0);
+
+    for (int i = 0; i < 3; i++)
+        pool.Insert("g");
+
+    for (const auto& handle : before)
+        HZGL_CHECK(pool.Get(handle) == nullptr);
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const std::vector<TestCase> tests = {
+        {"occlusion", testOcclusion},
+        {"streaming", testStreaming},
+        {"tangents", testTangents},
+        {"meshreaders", testMeshReaders},
+        {"ibl", testIBL},
+        {"handles", testHandles},
+    };
+
+    std::vector<std::string> names(argv + 1, argv + argc);
+
+    for (const auto& name : names)
+    {
+        bool known = false;
+        for (const auto& test : tests)
+            known = known || (test.name == name);
+
+        if (!known)
+        {
+            std::cerr << "unknown test: " << name << std::endl;
+            return -1;
+        }
+    }
+
+    int failed = 0;
+
+    for (const auto& test : tests)
+    {
+        if (!names.empty() && std::find(names.begin(), names.end(), test.name) == names.end())
+            continue;
+
+        bool passed = test.run();
+        printf("%-24s %s\n", test.name.c_str(), passed ? "passed" : "FAILED");
+
+        failed += passed ? 0 : 1;
+    }
+
+    return (failed == 0) ? 0 : 1;
+}